@@ -2549,5 +2549,25 @@ typedef struct  {
 void breakTime(uint32_t time, DateTimeFields &tm);  // break 32 bit time into DateTimeFields
 uint32_t makeTime(const DateTimeFields &tm); // convert DateTimeFields to 32 bit time
 
+// A pin number fixed at compile time.  Each function resolves to the port
+// register and bit directly, even when N arrives through other templates,
+// for example TeensyPin<LED_BUILTIN>::write(HIGH).  Named TeensyPin since
+// libraries like FastLED have their own Pin class.  Here write() is
+// digitalWrite(), which also turns off PWM on the pin; writeFast() doesn't.
+// On Teensy 3 and 4, write() is digitalWriteFast().
+template <uint8_t N>
+class TeensyPin
+{
+public:
+	enum { number = N };
+	static void mode(uint8_t mode) __attribute__((always_inline)) { pinMode(N, mode); }
+	static void write(uint8_t val) __attribute__((always_inline)) { digitalWrite(N, val); }
+	static void writeFast(uint8_t val) __attribute__((always_inline)) { digitalWriteFast(N, val); }
+	static void high(void) __attribute__((always_inline)) { digitalWriteFast(N, HIGH); }
+	static void low(void) __attribute__((always_inline)) { digitalWriteFast(N, LOW); }
+	static void toggle(void) __attribute__((always_inline)) { digitalToggleFast(N); }
+	static uint8_t read(void) __attribute__((always_inline)) { return digitalReadFast(N); }
+};
+
 #endif // __cplusplus
 #endif
@@ -1,5 +1,11 @@
 #include <WProgram.h>
 
+// called after each loop(), so USB types can send data buffered during it
+void _loop_end_hook(void) __attribute__((weak));
+void _loop_end_hook(void)
+{
+}
+
 //int main(void) __attribute__((noreturn));
 int main(void)
 {
@@ -9,6 +15,7 @@ int main(void)
     
 	while (1) {
 		loop();
+		_loop_end_hook();
 	}
 }
 
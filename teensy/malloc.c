@@ -38,6 +38,7 @@
 #include <inttypes.h>
 #include <string.h>
 #include <avr/io.h>
+#include "wiring.h"
 
 extern char __heap_start;
 extern char __heap_end;
@@ -69,6 +70,50 @@ struct __freelist *__flp;	// freelist pointer (head of freelist)
 // this is useful for tracking the worst case memory allocation
 //char *__brkval_maximum = 0;
 
+/*
+ * Small blocks are rounded up to 8, 16 or 32 bytes and kept on a list
+ * per size when freed, so the many small allocations made by String and
+ * similar code take constant time and reuse the same blocks, rather than
+ * walking the freelist and splitting it into unusable fragments.  The
+ * lists are only returned to the freelist if memory runs out.  The
+ * rounding costs RAM, which Teensy 2.0 has little of, so this is off
+ * unless built with MALLOC_BUCKETS=1.
+ */
+#ifndef MALLOC_BUCKETS
+#define MALLOC_BUCKETS 0
+#endif
+#if MALLOC_BUCKETS
+#define BUCKET_COUNT 3
+#define BUCKET_SIZE(n) ((size_t)8 << (n))
+static struct __freelist *__bucket[BUCKET_COUNT];
+static uint8_t __bucket_flushing;
+
+static inline uint8_t bucket_index(size_t len)
+{
+	if (len <= 8) return 0;
+	if (len <= 16) return 1;
+	if (len <= 32) return 2;
+	return BUCKET_COUNT;
+}
+
+static uint8_t bucket_flush(void)
+{
+	struct __freelist *fp;
+	uint8_t b, any=0;
+
+	__bucket_flushing = 1;
+	for (b=0; b < BUCKET_COUNT; b++) {
+		while ((fp = __bucket[b]) != NULL) {
+			__bucket[b] = fp->nx;
+			free(&(fp->nx));
+			any = 1;
+		}
+	}
+	__bucket_flushing = 0;
+	return any;
+}
+#endif
+
 
 void *
 malloc(size_t len)
@@ -76,6 +121,19 @@ malloc(size_t len)
 	struct __freelist *fp1, *fp2, *sfp1=NULL, *sfp2=NULL;
 	char *cp;
 	size_t s, avail;
+#if MALLOC_BUCKETS
+	uint8_t b;
+
+	b = bucket_index(len);
+	if (b < BUCKET_COUNT) {
+		len = BUCKET_SIZE(b);
+		fp1 = __bucket[b];
+		if (fp1) {
+			__bucket[b] = fp1->nx;
+			return &(fp1->nx);
+		}
+	}
+#endif
 
 	/*
 	 * Our minimum chunk size is the size of a pointer (plus the
@@ -186,8 +244,13 @@ malloc(size_t len)
 		return &(fp1->nx);
 	}
 	/*
-	 * Step 4: There's no help, just fail. :-/
+	 * Step 4: Give the small block lists back to the freelist and
+	 * try again.  If there were none, there's no help, just fail. :-/
 	 */
+#if MALLOC_BUCKETS
+	if (bucket_flush())
+		return malloc(len);
+#endif
 	return 0;
 }
 
@@ -207,6 +270,21 @@ free(void *p)
 	fpnew = (struct __freelist *)cpnew;
 	fpnew->nx = 0;
 
+#if MALLOC_BUCKETS
+	/*
+	 * Small blocks go to their list, unless on top of the heap where
+	 * lowering __brkval gives the space back to everyone.
+	 */
+	if (!__bucket_flushing && (char *)p + fpnew->sz != __brkval) {
+		uint8_t b = bucket_index(fpnew->sz);
+		if (b < BUCKET_COUNT && fpnew->sz == BUCKET_SIZE(b)) {
+			fpnew->nx = __bucket[b];
+			__bucket[b] = fpnew;
+			return;
+		}
+	}
+#endif
+
 	/*
 	 * Trivial case first: if there's no freelist yet, our entry
 	 * will be the only one on it.  If this is the last entry, we
@@ -386,3 +464,29 @@ realloc(void *ptr, size_t len)
 	return memp;
 }
 
+
+void
+malloc_stats(struct malloc_stats_struct *stats)
+{
+	struct __freelist *fp;
+	char *top, *sp;
+
+	memset(stats, 0, sizeof(*stats));
+	top = __brkval ? __brkval : __malloc_heap_start;
+	stats->heap_used = top - __malloc_heap_start;
+	for (fp = __flp; fp; fp = fp->nx) {
+		stats->free_list += fp->sz;
+		if (fp->sz > stats->free_largest)
+			stats->free_largest = fp->sz;
+	}
+#if MALLOC_BUCKETS
+	uint8_t b;
+	for (b=0; b < BUCKET_COUNT; b++) {
+		for (fp = __bucket[b]; fp; fp = fp->nx)
+			stats->bucket_free += BUCKET_SIZE(b);
+	}
+#endif
+	sp = STACK_POINTER();
+	if (sp > top)
+		stats->stack_gap = sp - top;
+}
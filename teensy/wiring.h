@@ -103,6 +103,16 @@ void detachInterrupt(uint8_t);
 void setup(void);
 void loop(void);
 
+// heap usage, from malloc.c
+struct malloc_stats_struct {
+	size_t heap_used;	// bytes between heap start and the top of the heap
+	size_t free_list;	// bytes free below the top of the heap
+	size_t free_largest;	// largest single free chunk
+	size_t bucket_free;	// bytes free in the small block lists
+	size_t stack_gap;	// bytes between the heap top and the stack
+};
+void malloc_stats(struct malloc_stats_struct *stats);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -0,0 +1,357 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "AnalogStream.h"
+#include "DMAChannel.h"
+#include "core_pins.h"
+
+extern "C" uint8_t analog_pin_channel(uint8_t pin);
+extern "C" void analogWriteDAC0(int val);
+extern "C" void analogWriteDAC1(int val);
+
+#if defined(KINETISK)
+
+#define PDB_USER_ADC0  1
+#define PDB_USER_ADC1  2
+#define PDB_USER_DAC   4
+#define PDB_CH_PRETRIG0  0x0101 // pre-trigger 0 enabled, no delay (TOS=1, EN=1)
+
+static AnalogStream *adc_stream[2];
+static DMAChannel adc0_dma(false);
+#ifdef HAS_KINETIS_ADC1
+static DMAChannel adc1_dma(false);
+#endif
+static DMAChannel dac_dma(false);
+DACStream * DACStream::active = nullptr;
+
+static uint8_t pdb_users = 0;
+static bool pdb_running = false;
+static uint32_t pdb_config;
+static uint32_t pdb_mod;
+
+// The PDB runs from F_BUS, with a 16 bit counter and a 1 to 128 prescaler.
+// The first user sets the rate, which every other user must match.
+static bool pdb_start(uint8_t user, float rate)
+{
+	uint32_t cycles, prescale=0, config, mod;
+
+	if (!(rate > 0.0f)) return false;
+	cycles = (float)F_BUS / rate + 0.5f;
+	if (cycles < 2) return false;
+	while ((cycles >> prescale) > 65536) {
+		if (++prescale > 7) return false;
+	}
+	mod = (cycles >> prescale) - 1;
+	config = PDB_SC_TRGSEL(15) | PDB_SC_PDBEN | PDB_SC_CONT | PDB_SC_PRESCALER(prescale);
+	if (pdb_users & ~user) {
+		if (config != pdb_config || mod != pdb_mod) return false;
+	} else {
+		SIM_SCGC6 |= SIM_SCGC6_PDB;
+		PDB0_SC = 0;
+		PDB0_MOD = mod;
+		PDB0_IDLY = 0;
+		pdb_config = config;
+		pdb_mod = mod;
+	}
+	pdb_users |= user;
+	return true;
+}
+
+// Apply channel changes, and start the timer if it isn't running
+static void pdb_update(void)
+{
+	uint32_t config = pdb_config;
+
+	if (pdb_users & PDB_USER_DAC) config |= PDB_SC_DMAEN;
+	PDB0_SC = config | PDB_SC_LDOK;
+	if (!pdb_running) {
+		PDB0_SC = config | PDB_SC_SWTRIG;
+		pdb_running = true;
+	}
+}
+
+static void pdb_stop(uint8_t user)
+{
+	pdb_users &= ~user;
+	if (pdb_users) {
+		pdb_update();
+	} else {
+		PDB0_SC = 0;
+		PDB0_CH0C1 = 0;
+		PDB0_CH1C1 = 0;
+		pdb_running = false;
+	}
+}
+
+bool AnalogStream::begin(uint8_t pin, float rate, uint16_t *buf, uint32_t len,
+	void (*funct)(const uint16_t *samples, uint32_t count))
+{
+	uint8_t ch;
+	int n;
+
+	if (adc >= 0) end();
+	if (!buf || !funct || len < 2 || (len & 1) || len > 32767) return false;
+	ch = analog_pin_channel(pin);
+	if (ch == 255) return false;
+	n = (ch & 0x80) ? 1 : 0;
+#ifndef HAS_KINETIS_ADC1
+	if (n) return false;
+#endif
+	if (adc_stream[n]) return false;
+	if (!pdb_start(n ? PDB_USER_ADC1 : PDB_USER_ADC0, rate)) return false;
+
+	buffer = buf;
+	count = len;
+	callback = funct;
+	overrun_count = 0;
+	next_half = 0;
+	adc = n;
+	adc_stream[n] = this;
+
+	// DMA copies each result into the ring, with interrupts at each half
+	DMAChannel *dma = &adc0_dma;
+#ifdef HAS_KINETIS_ADC1
+	if (n) dma = &adc1_dma;
+#endif
+	dma->begin();
+	dma->TCD->SADDR = &ADC0_RA;
+#ifdef HAS_KINETIS_ADC1
+	if (n) dma->TCD->SADDR = &ADC1_RA;
+#endif
+	dma->TCD->SOFF = 0;
+	dma->TCD->ATTR = DMA_TCD_ATTR_SSIZE(1) | DMA_TCD_ATTR_DSIZE(1);
+	dma->TCD->NBYTES = 2;
+	dma->TCD->SLAST = 0;
+	dma->TCD->DADDR = buf;
+	dma->TCD->DOFF = 2;
+	dma->TCD->CITER = len;
+	dma->TCD->BITER = len;
+	dma->TCD->DLASTSGA = -(len * 2);
+	dma->TCD->CSR = DMA_TCD_CSR_INTHALF | DMA_TCD_CSR_INTMAJOR;
+#ifdef HAS_KINETIS_ADC1
+	dma->triggerAtHardwareEvent(n ? DMAMUX_SOURCE_ADC1 : DMAMUX_SOURCE_ADC0);
+#else
+	dma->triggerAtHardwareEvent(DMAMUX_SOURCE_ADC0);
+#endif
+	dma->attachInterrupt(n ? isr1 : isr0);
+	dma->enable();
+
+	// PDB pre-trigger 0 of channel n starts a conversion of SC1A on ADCn
+#ifdef HAS_KINETIS_ADC1
+	if (n) {
+		if (ch & 0x40) {
+			ADC1_CFG2 &= ~ADC_CFG2_MUXSEL;
+		} else {
+			ADC1_CFG2 |= ADC_CFG2_MUXSEL;
+		}
+		ADC1_SC2 |= ADC_SC2_ADTRG | ADC_SC2_DMAEN;
+		ADC1_SC1A = ch & 0x3F;
+		PDB0_CH1C1 = PDB_CH_PRETRIG0;
+	} else
+#endif
+	{
+		ADC0_SC2 |= ADC_SC2_ADTRG | ADC_SC2_DMAEN;
+		ADC0_SC1A = ch & 0x3F;
+		PDB0_CH0C1 = PDB_CH_PRETRIG0;
+	}
+	pdb_update();
+	return true;
+}
+
+void AnalogStream::end()
+{
+	if (adc < 0) return;
+	DMAChannel *dma = &adc0_dma;
+#ifdef HAS_KINETIS_ADC1
+	if (adc) {
+		dma = &adc1_dma;
+		PDB0_CH1C1 = 0;
+		pdb_stop(PDB_USER_ADC1);
+		ADC1_SC2 &= ~(ADC_SC2_ADTRG | ADC_SC2_DMAEN);
+	} else
+#endif
+	{
+		PDB0_CH0C1 = 0;
+		pdb_stop(PDB_USER_ADC0);
+		ADC0_SC2 &= ~(ADC_SC2_ADTRG | ADC_SC2_DMAEN);
+	}
+	dma->disable();
+	dma->detachInterrupt();
+	dma->clearInterrupt();
+	adc_stream[adc] = nullptr;
+	adc = -1;
+}
+
+void AnalogStream::isr0()
+{
+	adc0_dma.clearInterrupt();
+	if (adc_stream[0]) adc_stream[0]->isr();
+}
+
+void AnalogStream::isr1()
+{
+#ifdef HAS_KINETIS_ADC1
+	adc1_dma.clearInterrupt();
+	if (adc_stream[1]) adc_stream[1]->isr();
+#endif
+}
+
+void AnalogStream::isr()
+{
+	DMAChannel *dma = &adc0_dma;
+#ifdef HAS_KINETIS_ADC1
+	if (adc) dma = &adc1_dma;
+#endif
+	uint32_t half = count / 2;
+	// while DMA fills the second half, the first is complete
+	uint8_t done = ((uint16_t *)dma->TCD->DADDR < buffer + half) ? 1 : 0;
+	if (done != next_half) overrun_count++;
+	next_half = done ^ 1;
+	(*callback)(buffer + done * half, half);
+}
+
+bool DACStream::begin(uint8_t dac, float rate, uint16_t *buf, uint32_t len,
+	void (*funct)(uint16_t *samples, uint32_t count))
+{
+#if defined(__MK20DX256__) || defined(__MK64FX512__) || defined(__MK66FX1M0__)
+	volatile void *data;
+
+	if (active) return false;
+	if (!buf || len < 2 || (len & 1) || len > 32767) return false;
+	if (dac == 0) {
+		analogWriteDAC0(buf[0]); // turns on DAC0 with the right reference
+		data = &DAC0_DAT0L;
+#if defined(__MK64FX512__) || defined(__MK66FX1M0__)
+	} else if (dac == 1) {
+		analogWriteDAC1(buf[0]);
+		data = &DAC1_DAT0L;
+#endif
+	} else {
+		return false;
+	}
+	if (!pdb_start(PDB_USER_DAC, rate)) return false;
+
+	buffer = buf;
+	count = len;
+	callback = funct;
+	overrun_count = 0;
+	next_half = 0;
+	active = this;
+
+	dac_dma.begin();
+	dac_dma.TCD->SADDR = buf;
+	dac_dma.TCD->SOFF = 2;
+	dac_dma.TCD->ATTR = DMA_TCD_ATTR_SSIZE(1) | DMA_TCD_ATTR_DSIZE(1);
+	dac_dma.TCD->NBYTES = 2;
+	dac_dma.TCD->SLAST = -(len * 2);
+	dac_dma.TCD->DADDR = data;
+	dac_dma.TCD->DOFF = 0;
+	dac_dma.TCD->CITER = len;
+	dac_dma.TCD->BITER = len;
+	dac_dma.TCD->DLASTSGA = 0;
+	if (funct) {
+		dac_dma.TCD->CSR = DMA_TCD_CSR_INTHALF | DMA_TCD_CSR_INTMAJOR;
+		dac_dma.attachInterrupt(isr);
+	} else {
+		dac_dma.TCD->CSR = 0;
+	}
+	dac_dma.triggerAtHardwareEvent(DMAMUX_SOURCE_PDB);
+	dac_dma.enable();
+	pdb_update();
+	return true;
+#else
+	return false;
+#endif
+}
+
+void DACStream::end()
+{
+	if (active != this) return;
+	pdb_stop(PDB_USER_DAC);
+	dac_dma.disable();
+	dac_dma.detachInterrupt();
+	dac_dma.clearInterrupt();
+	active = nullptr;
+}
+
+void DACStream::isr()
+{
+	DACStream *s = active;
+	dac_dma.clearInterrupt();
+	if (!s || !s->callback) return;
+	uint32_t half = s->count / 2;
+	// while DMA plays the second half, the first may be refilled
+	uint8_t done = ((uint16_t *)dac_dma.TCD->SADDR < s->buffer + half) ? 1 : 0;
+	if (done != s->next_half) s->overrun_count++;
+	s->next_half = done ^ 1;
+	(*s->callback)(s->buffer + done * half, half);
+}
+
+#else // KINETISL has no PDB
+
+DACStream * DACStream::active = nullptr;
+
+bool AnalogStream::begin(uint8_t pin, float rate, uint16_t *buf, uint32_t len,
+	void (*funct)(const uint16_t *samples, uint32_t count))
+{
+	return false;
+}
+
+void AnalogStream::end()
+{
+}
+
+void AnalogStream::isr0()
+{
+}
+
+void AnalogStream::isr1()
+{
+}
+
+void AnalogStream::isr()
+{
+}
+
+bool DACStream::begin(uint8_t dac, float rate, uint16_t *buf, uint32_t len,
+	void (*funct)(uint16_t *samples, uint32_t count))
+{
+	return false;
+}
+
+void DACStream::end()
+{
+}
+
+void DACStream::isr()
+{
+}
+
+#endif
@@ -0,0 +1,105 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef AnalogStream_h_
+#define AnalogStream_h_
+
+#include <stdint.h>
+
+// Continuous sampling of an analog pin, with no CPU time used per sample.
+// The PDB timer triggers the ADC at the sample rate and DMA copies each
+// result into a ring buffer.  Each time half of the buffer fills, the
+// callback receives that half from the DMA interrupt:
+//
+//   uint16_t buffer[1024];
+//   void block(const uint16_t *samples, uint32_t count) { ... }
+//   stream.begin(A0, 100000, buffer, 1024, block);
+//
+// count must be even.  The callback must finish with the samples before
+// the other half of the buffer is full.  Samples use the resolution and
+// averaging set by analogReadResolution() and analogReadAveraging(), but
+// without the extra shift analogRead() applies for 9, 11 or 13-15 bits.
+//
+// Each ADC runs one stream, so Teensy 3.1-3.6 can sample 2 pins at once
+// with the pins on different ADCs.  While streaming, analogRead() returns
+// 0 for pins on that ADC.  All streams and DACStream share the PDB timer,
+// so they must use the same rate.
+class AnalogStream {
+public:
+	constexpr AnalogStream() {}
+	~AnalogStream() { end(); }
+	bool begin(uint8_t pin, float rate, uint16_t *buffer, uint32_t count,
+		void (*callback)(const uint16_t *samples, uint32_t count));
+	void end();
+	// blocks lost because the callback did not run in time
+	uint32_t overruns() const { return overrun_count; }
+	operator bool() const { return adc >= 0; }
+private:
+	static void isr0();
+	static void isr1();
+	void isr();
+	uint16_t *buffer = nullptr;
+	uint32_t count = 0;
+	void (*callback)(const uint16_t *samples, uint32_t count) = nullptr;
+	volatile uint32_t overrun_count = 0;
+	uint8_t next_half = 0;
+	int8_t adc = -1;    // 0 or 1 while running
+};
+
+// Waveform playback on a DAC pin, with no CPU time used per sample.  The
+// PDB timer requests DMA at the sample rate, which copies 12 bit samples
+// from a ring buffer to the DAC.  Each time half of the buffer has been
+// played, the callback may refill that half from the DMA interrupt.  With
+// no callback, the buffer repeats, for a fixed waveform.
+//
+// Only one DACStream may run at a time, because the PDB has one DMA
+// request.  It uses DAC0 (A14 on Teensy 3.1/3.2, A21 on 3.5/3.6), or
+// DAC1 (A22 on 3.5/3.6).
+class DACStream {
+public:
+	constexpr DACStream() {}
+	~DACStream() { end(); }
+	bool begin(uint8_t dac, float rate, uint16_t *buffer, uint32_t count,
+		void (*callback)(uint16_t *samples, uint32_t count) = nullptr);
+	void end();
+	// blocks the callback did not refill in time
+	uint32_t overruns() const { return overrun_count; }
+	operator bool() const { return active == this; }
+private:
+	static void isr();
+	static DACStream *active;
+	uint16_t *buffer = nullptr;
+	uint32_t count = 0;
+	void (*callback)(uint16_t *samples, uint32_t count) = nullptr;
+	volatile uint32_t overrun_count = 0;
+	uint8_t next_half = 0;
+};
+
+#endif
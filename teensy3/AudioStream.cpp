@@ -229,6 +229,7 @@ void AudioConnection::connect(void)
 	dst.active = true;
 
 	isConnected = true;
+	AudioStream::schedule_valid = false;
 
 	__enable_irq();
 }
@@ -287,6 +288,7 @@ void AudioConnection::disconnect(void)
 	}
 
 	isConnected = false;
+	AudioStream::schedule_valid = false;
 
 	__enable_irq();
 }
@@ -315,6 +317,37 @@ void AudioStream::update_stop(void)
 }
 
 AudioStream * AudioStream::first_update = NULL;
+AudioStream::update_function_t AudioStream::schedule_function[AUDIO_SCHEDULE_MAX];
+AudioStream * AudioStream::schedule_object[AUDIO_SCHEDULE_MAX];
+uint16_t AudioStream::schedule_count = 0;
+volatile bool AudioStream::schedule_valid = false;
+
+// Flatten the update list into an array, with each object's update()
+// resolved from its vtable once, rather than for every block.  This
+// runs from software_isr() after objects or connections change, so every
+// object connected since then is fully constructed.  If there are more
+// objects than AUDIO_SCHEDULE_MAX, schedule_count is left at 0 and
+// software_isr() walks the list instead.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpmf-conversions"
+void AudioStream::update_schedule(void)
+{
+	AudioStream *p;
+	unsigned int n = 0;
+
+	schedule_valid = true;
+	for (p = first_update; p; p = p->next_update) {
+		if (n >= AUDIO_SCHEDULE_MAX) {
+			schedule_count = 0;
+			return;
+		}
+		schedule_object[n] = p;
+		schedule_function[n] = (update_function_t)(p->*(&AudioStream::update));
+		n++;
+	}
+	schedule_count = n;
+}
+#pragma GCC diagnostic pop
 
 void software_isr(void) // AudioStream::update_all()
 {
@@ -328,17 +361,31 @@ void software_isr(void) // AudioStream::update_all()
 	uint32_t totalcycles = micros();
 #endif
 	//digitalWriteFast(2, HIGH);
-	for (p = AudioStream::first_update; p; p = p->next_update) {
+	if (!AudioStream::schedule_valid) AudioStream::update_schedule();
+	const unsigned int count = AudioStream::schedule_count;
+	for (unsigned int i=0; i < count; i++) {
+		p = AudioStream::schedule_object[i];
 		if (p->active) {
 			uint32_t cycles = ARM_DWT_CYCCNT;
-			p->update();
-			// TODO: traverse inputQueueArray and release
-			// any input blocks that weren't consumed?
+			(*AudioStream::schedule_function[i])(p);
 			cycles = (ARM_DWT_CYCCNT - cycles) >> 4;
 			p->cpu_cycles = cycles;
 			if (cycles > p->cpu_cycles_max) p->cpu_cycles_max = cycles;
 		}
 	}
+	if (count == 0) {
+		for (p = AudioStream::first_update; p; p = p->next_update) {
+			if (p->active) {
+				uint32_t cycles = ARM_DWT_CYCCNT;
+				p->update();
+				// TODO: traverse inputQueueArray and release
+				// any input blocks that weren't consumed?
+				cycles = (ARM_DWT_CYCCNT - cycles) >> 4;
+				p->cpu_cycles = cycles;
+				if (cycles > p->cpu_cycles_max) p->cpu_cycles_max = cycles;
+			}
+		}
+	}
 	//digitalWriteFast(2, LOW);
 #if defined(KINETISK)
 	totalcycles = (ARM_DWT_CYCCNT - totalcycles) >> 4;
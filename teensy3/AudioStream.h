@@ -66,6 +66,18 @@
 
 #define AUDIO_SAMPLE_RATE AUDIO_SAMPLE_RATE_EXACT
 
+// AUDIO_SCHEDULE_MAX is how many objects the update schedule can hold.
+// software_isr() calls each object's update() from a flat array built when
+// connections change.  Larger designs still work, by walking the object
+// list as before, only with a little more overhead per object.
+#ifndef AUDIO_SCHEDULE_MAX
+#if defined(__MKL26Z64__)
+#define AUDIO_SCHEDULE_MAX  32
+#else
+#define AUDIO_SCHEDULE_MAX  96
+#endif
+#endif
+
 #ifndef __ASSEMBLER__
 class AudioStream;
 class AudioConnection;
@@ -147,6 +159,7 @@ public:
 				p->next_update = this;
 			}
 			next_update = NULL;
+			schedule_valid = false;
 			cpu_cycles = 0;
 			cpu_cycles_max = 0;
 			numConnections = 0;
@@ -183,6 +196,12 @@ private:
 	virtual void update(void) = 0;
 	static AudioStream *first_update; // for update_all
 	AudioStream *next_update; // for update_all
+	typedef void (*update_function_t)(AudioStream *);
+	static update_function_t schedule_function[AUDIO_SCHEDULE_MAX];
+	static AudioStream *schedule_object[AUDIO_SCHEDULE_MAX];
+	static uint16_t schedule_count;
+	static volatile bool schedule_valid;
+	static void update_schedule(void);
 	static audio_block_t *memory_pool;
 	static uint32_t memory_pool_available_mask[];
 	static uint16_t memory_pool_first_mask;
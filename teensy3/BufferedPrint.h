@@ -0,0 +1,110 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2024 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef BufferedPrint_h_
+#define BufferedPrint_h_
+#ifdef __cplusplus
+
+#include "Print.h"
+
+// The buffering shared by BufferedPrint and PrintTee.  A derived class
+// receives the buffer in output(), and must call send() in its own
+// destructor, because output() can't be called from this one.
+template <size_t N>
+class BufferedPrintBase : public Print
+{
+public:
+	virtual size_t write(uint8_t b) {
+		if (len >= N) send();
+		buf[len++] = b;
+		return 1;
+	}
+	virtual size_t write(const uint8_t *buffer, size_t size) {
+		if (buffer == nullptr) return 0;
+		if (size > N - len) {
+			send();
+			// too big to ever fit, skip the copy
+			if (size >= N) return output(buffer, size);
+		}
+		memcpy(buf + len, buffer, size);
+		len += size;
+		return size;
+	}
+	virtual int availableForWrite(void) { return N - len; }
+	// give buffered data to the destination, without waiting for it
+	size_t send() {
+		if (len == 0) return 0;
+		size_t n = output(buf, len);
+		len = 0;
+		return n;
+	}
+	size_t length() const { return len; }
+	void clear() { len = 0; }
+	using Print::write;
+protected:
+	BufferedPrintBase() : len(0) {}
+	virtual size_t output(const uint8_t *data, size_t size) = 0;
+private:
+	size_t len;
+	uint8_t buf[N];
+};
+
+// Collect many small print() calls into one buffer, then give the whole
+// buffer to another Print with a single write().  Every print() of a
+// number, character or string is otherwise a separate write, which for
+// USB serial means a separate trip through its locking and packet code:
+//
+//   BufferedPrint<64> out(Serial);
+//   out.print(x);
+//   out.print(',');
+//   out.println(y);
+//   out.send(); // or let out go out of scope
+//
+// The buffer is sent automatically when full, by send() or flush(), and
+// by the destructor.  flush() also calls the destination's flush().
+template <size_t N>
+class BufferedPrint : public BufferedPrintBase<N>
+{
+public:
+	BufferedPrint(Print &destination) : dest(destination) {}
+	~BufferedPrint() { this->send(); }
+	virtual void flush() { this->send(); dest.flush(); }
+protected:
+	virtual size_t output(const uint8_t *data, size_t size) {
+		size_t n = dest.write(data, size);
+		if (n < size) this->setWriteError();
+		return n;
+	}
+private:
+	Print &dest;
+};
+
+#endif // __cplusplus
+#endif
@@ -102,6 +102,11 @@ void DMAChannel::release(void)
 {
 	if (channel >= DMA_MAX_CHANNELS) return;
 	DMA_CERQ = channel;
+	// DMAPriorityPlan() may have allowed preemption, which the next
+	// begin() of this channel would not expect
+	volatile uint8_t *pri = (volatile uint8_t *)((uint32_t)&DMA_DCHPRI3
+		+ (channel & 0xFC) + 3 - (channel & 3));
+	*pri &= ~(DMA_DCHPRI_ECP | DMA_DCHPRI_DPA);
 	__disable_irq();
 	dma_channel_allocated_mask &= ~(1 << channel);
 	__enable_irq();
@@ -130,6 +135,89 @@ static void swap(DMAChannel &c1, DMAChannel &c2)
 	c2.TCD = t;
 }
 
+static void preemption(const DMAChannel &c, uint8_t dma_class)
+{
+	volatile uint8_t *pri;
+	uint8_t n;
+
+	// DCHPRI registers are big endian within each group of 4
+	pri = (volatile uint8_t *)((uint32_t)&DMA_DCHPRI3 + (c.channel & 0xFC) + 3 - (c.channel & 3));
+	n = *pri & 0x0F;
+	if (dma_class == DMA_CLASS_STREAM) {
+		n |= DMA_DCHPRI_ECP;
+	} else if (dma_class >= DMA_CLASS_BULK) {
+		n |= DMA_DCHPRI_ECP | DMA_DCHPRI_DPA;
+	}
+	*pri = n;
+}
+
+int DMAChain::addBuffer(volatile void *p, unsigned int len, bool interrupt)
+{
+	int first = num;
+	uint32_t addr = (uint32_t)p;
+
+	// check for room first, so a failed add leaves the chain unchanged
+	if (len == 0 || num + (len - 1) / 32767 + 1 > max) return -1;
+	while (len > 0) {
+		unsigned int n = (len > 32767) ? 32767 : len;
+		DMABaseClass::TCD_t *t = list[num].TCD;
+		t->ATTR = DMA_TCD_ATTR_SSIZE(reg_size) | DMA_TCD_ATTR_DSIZE(reg_size);
+		t->NBYTES = 1 << reg_size;
+		if (to_buffer) {
+			t->SADDR = reg;
+			t->SOFF = 0;
+			t->DADDR = (volatile void *)addr;
+			t->DOFF = 1 << reg_size;
+		} else {
+			t->SADDR = (volatile const void *)addr;
+			t->SOFF = 1 << reg_size;
+			t->DADDR = (volatile void *)reg;
+			t->DOFF = 0;
+		}
+		t->SLAST = 0;
+		t->DLASTSGA = 0;
+		t->BITER = n;
+		t->CITER = n;
+		t->CSR = 0;
+		addr += n << reg_size;
+		len -= n;
+		if (len == 0 && interrupt) t->CSR = DMA_TCD_CSR_INTMAJOR;
+		num++;
+	}
+	return first;
+}
+
+void DMAChain::begin(DMAChannel &ch)
+{
+	if (num == 0) return;
+	for (unsigned int i=0; i < num; i++) {
+		DMABaseClass::TCD_t *t = list[i].TCD;
+		t->CSR &= ~(DMA_TCD_CSR_ESG | DMA_TCD_CSR_DREQ | DMA_TCD_CSR_DONE);
+		if (i + 1 < num) {
+			t->DLASTSGA = (int32_t)list[i + 1].TCD;
+			t->CSR |= DMA_TCD_CSR_ESG;
+		} else if (looping) {
+			t->DLASTSGA = (int32_t)list[0].TCD;
+			t->CSR |= DMA_TCD_CSR_ESG;
+		} else {
+			t->DLASTSGA = 0;
+			t->CSR |= DMA_TCD_CSR_DREQ;
+		}
+	}
+	ch.disable();
+	ch = list[0];
+}
+
+int DMAChain::current(DMAChannel &ch)
+{
+	int32_t next = ch.TCD->DLASTSGA;
+	if (!(ch.TCD->CSR & DMA_TCD_CSR_ESG)) return num - 1;
+	for (unsigned int i=0; i < num; i++) {
+		if (next == (int32_t)list[i].TCD) return (i > 0) ? i - 1 : num - 1;
+	}
+	return -1;
+}
+
 /****************************************************************/
 /**                          Teensy-LC                         **/
 /****************************************************************/
@@ -201,6 +289,11 @@ static void swap(DMAChannel &c1, DMAChannel &c2)
 	c2.CFG = t;
 }
 
+static void preemption(const DMAChannel &c, uint8_t dma_class)
+{
+	// Teensy-LC's DMA has no channel preemption
+}
+
 
 
 
@@ -231,3 +324,29 @@ void DMAPriorityOrder(DMAChannel &ch1, DMAChannel &ch2, DMAChannel &ch3, DMAChan
 	if (priority(ch3) < priority(ch4)) swap(ch2, ch3);
 }
 
+void DMAPriorityPlan(DMAChannel **list, const uint8_t *classes, unsigned int count)
+{
+	DMAChannel *order[DMA_MAX_CHANNELS];
+	uint8_t order_class[DMA_MAX_CHANNELS];
+	unsigned int i, j, best;
+
+	if (count > DMA_MAX_CHANNELS) count = DMA_MAX_CHANNELS;
+	// most urgent class first, keeping the list's order within a class
+	for (i=0; i < count; i++) {
+		for (j=i; j > 0 && order_class[j-1] > classes[i]; j--) {
+			order[j] = order[j-1];
+			order_class[j] = order_class[j-1];
+		}
+		order[j] = list[i];
+		order_class[j] = classes[i];
+	}
+	// then hand out the hardware channels, highest priority first
+	for (i=0; i < count; i++) {
+		best = i;
+		for (j=i+1; j < count; j++) {
+			if (priority(*order[j]) > priority(*order[best])) best = j;
+		}
+		if (best != i) swap(*order[i], *order[best]);
+		preemption(*order[i], order_class[i]);
+	}
+}
@@ -603,6 +603,72 @@ void DMAPriorityOrder(DMAChannel &ch1, DMAChannel &ch2);
 void DMAPriorityOrder(DMAChannel &ch1, DMAChannel &ch2, DMAChannel &ch3);
 void DMAPriorityOrder(DMAChannel &ch1, DMAChannel &ch2, DMAChannel &ch3, DMAChannel &ch4);
 
+// Assign priorities to any number of DMA channels by how urgently each
+// must be serviced.  Channels with a lower class number get the higher
+// priority hardware channels, and within a class, earlier channels in
+// the list rank higher.  The class also sets preemption, so latency
+// channels may suspend stream and bulk channels between reads and writes,
+// and bulk channels never suspend others.  Like DMAPriorityOrder, this
+// exchanges which hardware channel each DMAChannel uses, so call it after
+// begin() and before configuring the channels.
+#define DMA_CLASS_LATENCY  0  // short transfers that must not wait, eg UART, SPI
+#define DMA_CLASS_STREAM   1  // regular paced transfers, eg audio, ADC
+#define DMA_CLASS_BULK     2  // large transfers which may be delayed, eg memcpy
+void DMAPriorityPlan(DMAChannel **list, const uint8_t *classes, unsigned int count);
+
+// DMAChain builds a list of DMASetting, one per buffer, which a DMA
+// channel uses in order by scatter-gather, so long streams across any
+// number of buffers run without CPU intervention.  One end of every
+// transfer is a single register, set by source() or destination().
+
+class DMAChain {
+public:
+	// settings is the storage for the list, size is how many it holds
+	DMAChain(DMASetting *settings, unsigned int size) : list(settings), max(size) {}
+
+	// Transmit buffers to a register, usually a peripheral's data register
+	void destination(volatile uint8_t &p) { fixed(&p, 0, false); }
+	void destination(volatile uint16_t &p) { fixed(&p, 1, false); }
+	void destination(volatile uint32_t &p) { fixed(&p, 2, false); }
+	// Receive from a register into the buffers
+	void source(volatile const uint8_t &p) { fixed(&p, 0, true); }
+	void source(volatile const uint16_t &p) { fixed(&p, 1, true); }
+	void source(volatile const uint32_t &p) { fixed(&p, 2, true); }
+
+	// Add a buffer of len elements, which are the size of the register.
+	// Buffers over 32767 elements use more than 1 setting.  Optionally
+	// interrupt when this buffer is finished.  Returns the index of the
+	// buffer's first setting, or -1 if the list is full.
+	int addBuffer(volatile void *p, unsigned int len, bool interrupt=false);
+
+	// Repeat from the first buffer after the last, rather than disabling
+	// the channel when the last buffer completes.
+	void loop(bool repeat=true) { looping = repeat; }
+
+	// Link all the settings and load the first setting into the channel.
+	// Then configure the trigger and call enable() to start.
+	void begin(DMAChannel &ch);
+
+	// The index of the setting the channel is using now
+	int current(DMAChannel &ch);
+
+	unsigned int count(void) { return num; }
+	DMASetting & operator [] (unsigned int index) { return list[index]; }
+private:
+	void fixed(volatile const void *p, uint8_t size, bool receive) {
+		reg = p;
+		reg_size = size;
+		to_buffer = receive;
+	}
+	DMASetting *list;
+	uint16_t max;
+	uint16_t num = 0;
+	volatile const void *reg = nullptr;
+	uint8_t reg_size = 0;
+	bool to_buffer = false;
+	bool looping = false;
+};
+
 
 
 
@@ -1107,6 +1173,17 @@ void DMAPriorityOrder(DMAChannel &ch1, DMAChannel &ch2);
 void DMAPriorityOrder(DMAChannel &ch1, DMAChannel &ch2, DMAChannel &ch3);
 void DMAPriorityOrder(DMAChannel &ch1, DMAChannel &ch2, DMAChannel &ch3, DMAChannel &ch4);
 
+// Assign priorities to any number of DMA channels by how urgently each
+// must be serviced.  Channels with a lower class number get the higher
+// priority hardware channels, and within a class, earlier channels in
+// the list rank higher.  Like DMAPriorityOrder, this exchanges which
+// hardware channel each DMAChannel uses, so call it after begin() and
+// before configuring the channels.
+#define DMA_CLASS_LATENCY  0  // short transfers that must not wait, eg UART, SPI
+#define DMA_CLASS_STREAM   1  // regular paced transfers, eg audio, ADC
+#define DMA_CLASS_BULK     2  // large transfers which may be delayed, eg memcpy
+void DMAPriorityPlan(DMAChannel **list, const uint8_t *classes, unsigned int count);
+
 
 
 #endif // KINETISL
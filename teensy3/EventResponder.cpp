@@ -39,6 +39,7 @@ EventResponder * EventResponder::lastYield = nullptr;
 EventResponder * EventResponder::firstInterrupt = nullptr;
 EventResponder * EventResponder::lastInterrupt = nullptr;
 bool EventResponder::runningFromYield = false;
+uint32_t EventResponder::yieldTimeBudget = 0;
 
 // TODO: interrupt disable/enable needed in many places!!!
 // BUGBUG: See if file name order makes difference?
@@ -53,30 +54,10 @@ void EventResponder::triggerEventNotImmediate()
 		// not already triggered
 		if (_type == EventTypeYield) {
 			// normal type, called from yield()
-			if (firstYield == nullptr) {
-				_next = nullptr;
-				_prev = nullptr;
-				firstYield = this;
-				lastYield = this;
-			} else {
-				_next = nullptr;
-				_prev = lastYield;
-				_prev->_next = this;
-				lastYield = this;
-			}
+			insertNoInterrupts(&firstYield, &lastYield);
 		} else if (_type == EventTypeInterrupt) {
 			// interrupt, called from software interrupt
-			if (firstInterrupt == nullptr) {
-				_next = nullptr;
-				_prev = nullptr;
-				firstInterrupt = this;
-				lastInterrupt = this;
-			} else {
-				_next = nullptr;
-				_prev = lastInterrupt;
-				_prev->_next = this;
-				lastInterrupt = this;
-			}
+			insertNoInterrupts(&firstInterrupt, &lastInterrupt);
 			SCB_ICSR = SCB_ICSR_PENDSVSET; // set PendSV interrupt
 		} else {
 			// detached, easy :-)
@@ -86,6 +67,31 @@ void EventResponder::triggerEventNotImmediate()
 	enableInterrupts(irq);
 }
 
+// this insert must be called with interrupts disabled.  The list is kept
+// sorted by priority.  Searching from the end places this event after all
+// others of equal priority, and finds the spot quickly in the common case
+// where most events use the default priority.
+void EventResponder::insertNoInterrupts(EventResponder **first, EventResponder **last)
+{
+	EventResponder *p = *last;
+	while (p && p->_priority > _priority) {
+		p = p->_prev;
+	}
+	_prev = p;
+	if (p) {
+		_next = p->_next;
+		p->_next = this;
+	} else {
+		_next = *first;
+		*first = this;
+	}
+	if (_next) {
+		_next->_prev = this;
+	} else {
+		*last = this;
+	}
+}
+
 void pendablesrvreq_isr(void)
 {
 	EventResponder::runFromInterrupt();
@@ -187,7 +193,11 @@ void EventResponder::detachNoInterrupts()
 
 
 MillisTimer * MillisTimer::listWaiting = nullptr;
-MillisTimer * MillisTimer::listActive = nullptr;
+MillisTimer * MillisTimer::wheel[MILLISTIMER_WHEEL_LEVELS][MILLISTIMER_WHEEL_SIZE];
+unsigned long MillisTimer::wheelTick = 0;
+
+#define WHEEL_MASK  (MILLISTIMER_WHEEL_SIZE - 1)
+#define WHEEL_RANGE (1ul << (MILLISTIMER_WHEEL_BITS * MILLISTIMER_WHEEL_LEVELS))
 
 void MillisTimer::begin(unsigned long milliseconds, EventResponderRef event)
 {
@@ -211,7 +221,7 @@ void MillisTimer::beginRepeating(unsigned long milliseconds, EventResponderRef e
 
 void MillisTimer::addToWaitingList()
 {
-	_prev = nullptr;
+	_pprev = nullptr;
 	bool irq = disableTimerInterrupt();
 	_next = listWaiting;
 	listWaiting = this; // TODO: use STREX to avoid interrupt disable
@@ -219,61 +229,49 @@ void MillisTimer::addToWaitingList()
 	enableTimerInterrupt(irq);
 }
 
-void MillisTimer::addToActiveList() // only called by runFromTimer()
+// file this timer into the wheel slot for its expire tick (_ms).  Only
+// called by runFromTimer(), or with the timer interrupt disabled.
+void MillisTimer::addToWheel()
 {
-	if (listActive == nullptr) {
-		// list is empty, easy case
-		_next = nullptr;
-		_prev = nullptr;
-		listActive = this;
-	} else if (_ms < listActive->_ms) {
-		// this timer triggers before any on the list
-		_next = listActive;
-		_prev = nullptr;
-		listActive->_prev = this;
-		// Decrement the next items wait time be our wait time as to properly handle waits for all other items...
-		listActive->_ms -= _ms;	
-		listActive = this;
+	unsigned long expire = _ms;
+	unsigned long delta = expire - wheelTick;
+	unsigned int level = 0;
+	if ((long)delta < 0) {
+		// already late, run on the next tick
+		expire = wheelTick;
 	} else {
-		// add this timer somewhere after the first already on the list
-		MillisTimer *timer = listActive;
-		while (timer->_next) {
-			_ms -= timer->_ms;
-			timer = timer->_next;
-			if (_ms < timer->_ms) {
-				// found the right place in the middle of list
-				_next = timer;
-				_prev = timer->_prev;
-				timer->_prev = this;
-				_prev->_next = this;
-				timer->_ms -= _ms;
-				_state = TimerActive;
-				return;
-			}
+		if (delta >= WHEEL_RANGE) {
+			// too far for the wheel, park at the farthest top level slot
+			expire = wheelTick + WHEEL_RANGE - 1;
+			delta = WHEEL_RANGE - 1;
+		}
+		while (delta >= (1ul << (MILLISTIMER_WHEEL_BITS * (level + 1)))) {
+			level++;
 		}
-		// add this time at the end of the list
-		_ms -= timer->_ms;
-		_next = nullptr;
-		_prev = timer;
-		timer->_next = this;
 	}
+	MillisTimer **slot = &wheel[level][(expire >> (MILLISTIMER_WHEEL_BITS * level)) & WHEEL_MASK];
+	_next = *slot;
+	if (_next) _next->_pprev = &_next;
+	_pprev = slot;
+	*slot = this;
 	_state = TimerActive;
 }
 
+// must be called with the timer interrupt disabled
+void MillisTimer::removeFromWheel()
+{
+	*_pprev = _next;
+	if (_next) _next->_pprev = _pprev;
+	_next = nullptr;
+	_pprev = nullptr;
+}
+
 void MillisTimer::end()
 {
 	bool irq = disableTimerInterrupt();
 	TimerStateType s = _state;
 	if (s == TimerActive) {
-		if (_next) {
-			_next->_prev = _prev;
-			_next->_ms += _ms;   // add in the rest of our timing to next entry...
-		}
-		if (_prev) {
-			_prev->_next = _next;
-		} else {
-			listActive = _next;
-		}
+		removeFromWheel();
 		_state = TimerOff;
 	} else if (s == TimerWaiting) {
 		if (listWaiting == this) {
@@ -293,34 +291,60 @@ void MillisTimer::end()
 	enableTimerInterrupt(irq);
 }
 
+// move every timer in one higher level slot down to the levels below
+void MillisTimer::cascade(unsigned int level, unsigned int index)
+{
+	MillisTimer **slot = &wheel[level][index];
+	while (1) {
+		bool irq = disableTimerInterrupt();
+		MillisTimer *timer = *slot;
+		if (timer) {
+			timer->removeFromWheel();
+			timer->addToWheel();
+		}
+		enableTimerInterrupt(irq);
+		if (!timer) break;
+	}
+}
+
 void MillisTimer::runFromTimer()
 {
-	MillisTimer *timer = listActive;
-	while (timer) {
-		if (timer->_ms > 0) {
-			timer->_ms--;
-			break;
-		} else {
-			MillisTimer *next = timer->_next;
-			if (next) next->_prev = nullptr;
-			listActive = next;
+	unsigned long tick = wheelTick;
+	unsigned int index = tick & WHEEL_MASK;
+	for (unsigned int level=1; index == 0 && level < MILLISTIMER_WHEEL_LEVELS; level++) {
+		index = (tick >> (MILLISTIMER_WHEEL_BITS * level)) & WHEEL_MASK;
+		cascade(level, index);
+	}
+	MillisTimer **slot = &wheel[0][tick & WHEEL_MASK];
+	while (1) {
+		bool irq = disableTimerInterrupt();
+		MillisTimer *timer = *slot;
+		if (timer) {
+			timer->removeFromWheel();
 			timer->_state = TimerOff;
-			EventResponderRef event = *(timer->_event);
-			event.triggerEvent(0, timer);
-			if (timer->_reload) {
-				timer->_ms = timer->_reload;
-				timer->addToActiveList();
-			}
-			timer = listActive;
+		}
+		enableTimerInterrupt(irq);
+		if (!timer) break;
+		EventResponderRef event = *(timer->_event);
+		event.triggerEvent(0, timer);
+		if (timer->_reload && timer->_state == TimerOff) {
+			timer->_ms = tick + timer->_reload;
+			irq = disableTimerInterrupt();
+			timer->addToWheel();
+			enableTimerInterrupt(irq);
 		}
 	}
+	wheelTick = tick + 1;
 	bool irq = disableTimerInterrupt();
 	MillisTimer *waiting = listWaiting;
 	listWaiting = nullptr; // TODO: use STREX to avoid interrupt disable
 	enableTimerInterrupt(irq);
 	while (waiting) {
 		MillisTimer *next = waiting->_next;
-		waiting->addToActiveList();
+		waiting->_ms += wheelTick;
+		irq = disableTimerInterrupt();
+		waiting->addToWheel();
+		enableTimerInterrupt(irq);
 		waiting = next;
 	}
 }
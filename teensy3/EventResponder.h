@@ -53,6 +53,12 @@
  * substantial time.  While your function runs, no other event functions
  * (attached the same way) are able to run.
  *
+ * Events waiting to be called from yield() or from the software
+ * interrupt are queued by the priority given to attach() or
+ * attachInterrupt().  As with hardware interrupts, lower numbers are
+ * more urgent.  Events with equal priority are called in the order
+ * they were triggered.
+ *
  * If your EventResponder is triggered more than once before your
  * function can run, only the last trigger is used.  Prior triggering,
  * including the status integer and data pointer, are overwritten and
@@ -82,11 +88,13 @@ public:
 
 	// Attach a function to be called from yield().  This should be the
 	// default way to use EventResponder.  Calls from yield() allow use
-	// of Arduino libraries, String, Serial, etc.
+	// of Arduino libraries, String, Serial, etc.  Lower priority numbers
+	// are called first.
 	void attach(EventResponderFunction function, uint8_t priority=128) {
 		bool irq = disableInterrupts();
 		detachNoInterrupts();
 		_function = function;
+		_priority = priority;
 		_type = EventTypeYield;
 		yield_active_check_flags |= YIELD_CHECK_EVENT_RESPONDER; // user setup a yield type...
 		enableInterrupts(irq);
@@ -112,6 +120,7 @@ public:
 		bool irq = disableInterrupts();
 		detachNoInterrupts();
 		_function = function;
+		_priority = priority;
 		_type = EventTypeInterrupt;
 		SCB_SHPR3 |= 0x00FF0000; // configure PendSV, lowest priority
 		// Make sure we are using the systic ISR that process this
@@ -173,6 +182,14 @@ public:
 	bool waitForEvent(EventResponderRef event, int timeout);
 	EventResponder * waitForEvent(EventResponder *list, int listsize, int timeout);
 
+	// Limit how long a single yield() may spend calling event functions.
+	// By default (zero) only one function is called per yield().  With a
+	// budget, functions are called in priority order until no events
+	// remain or the time has been used.  The budget is checked after each
+	// function returns, so one slow function can still exceed it.
+	static void setYieldTimeBudget(uint32_t microseconds) {
+		yieldTimeBudget = microseconds;
+	}
 	static void runFromYield() {
 		if (!firstYield) return;  
 		// First, check if yield was called from an interrupt
@@ -180,31 +197,34 @@ public:
 		uint32_t ipsr;
 		__asm__ volatile("mrs %0, ipsr\n" : "=r" (ipsr)::);
 		if (ipsr != 0) return;
-		// Next, check if any events have been triggered
-		bool irq = disableInterrupts();
-		EventResponder *first = firstYield;
-		if (first == nullptr) {
-			enableInterrupts(irq);
-			return;
-		}
-		// Finally, make sure we're not being recursively called,
+		// Next, make sure we're not being recursively called,
 		// which can happen if the user's function does anything
 		// that calls yield.
-		if (runningFromYield) {
-			enableInterrupts(irq);
-			return;
-		}
-		// Ok, update the runningFromYield flag and process event
+		if (runningFromYield) return;
 		runningFromYield = true;
-		firstYield = first->_next;
-		if (firstYield) {
-			firstYield->_prev = nullptr;
-		} else {
-			lastYield = nullptr;
+		const uint32_t budget = yieldTimeBudget;
+		const uint32_t begin = budget ? micros() : 0;
+		while (1) {
+			// Always take the head of the queue, so an urgent event
+			// triggered by a prior function runs before older, less
+			// urgent events.
+			bool irq = disableInterrupts();
+			EventResponder *first = firstYield;
+			if (first == nullptr) {
+				enableInterrupts(irq);
+				break;
+			}
+			firstYield = first->_next;
+			if (firstYield) {
+				firstYield->_prev = nullptr;
+			} else {
+				lastYield = nullptr;
+			}
+			enableInterrupts(irq);
+			first->_triggered = false;
+			(*(first->_function))(*first);
+			if (budget == 0 || (micros() - begin) >= budget) break;
 		}
-		enableInterrupts(irq);
-		first->_triggered = false;
-		(*(first->_function))(*first);
 		runningFromYield = false;
 	}
 	static void runFromInterrupt();
@@ -212,6 +232,7 @@ public:
 protected:
 	void triggerEventNotImmediate();
 	void detachNoInterrupts();
+	void insertNoInterrupts(EventResponder **first, EventResponder **last);
 	int _status = 0;
 	EventResponderFunction _function = nullptr;
 	void *_data = nullptr;
@@ -220,11 +241,13 @@ protected:
 	EventResponder *_prev = nullptr;
 	EventType _type = EventTypeDetached;
 	bool _triggered = false;
+	uint8_t _priority = 128;
 	static EventResponder *firstYield;
 	static EventResponder *lastYield;
 	static EventResponder *firstInterrupt;
 	static EventResponder *lastInterrupt;
 	static bool runningFromYield;
+	static uint32_t yieldTimeBudget;
 private:
 	static bool disableInterrupts() {
 		uint32_t primask;
@@ -237,6 +260,17 @@ private:
 	}
 };
 
+// MillisTimer keeps active timers in a hierarchical timing wheel.  Each
+// level has MILLISTIMER_WHEEL_SIZE slots, and each slot of a level spans
+// all the slots of the level below.  Starting or ending a timer is a
+// constant time operation, and each systick only looks at one slot,
+// plus occasionally moves one slot of a higher level down to the level
+// below.  Timers longer than the wheel's range are parked in the top
+// level and re-filed each time they come around.
+#define MILLISTIMER_WHEEL_BITS   5
+#define MILLISTIMER_WHEEL_SIZE   (1 << MILLISTIMER_WHEEL_BITS)
+#define MILLISTIMER_WHEEL_LEVELS 4
+
 class MillisTimer
 {
 public:
@@ -251,11 +285,13 @@ public:
 	static void runFromTimer();
 private:
 	void addToWaitingList();
-	void addToActiveList();
-	unsigned long _ms = 0;
+	void addToWheel();
+	void removeFromWheel();
+	static void cascade(unsigned int level, unsigned int index);
+	unsigned long _ms = 0;      // delay while waiting, expire tick while active
 	unsigned long _reload = 0;
 	MillisTimer *_next = nullptr;
-	MillisTimer *_prev = nullptr;
+	MillisTimer **_pprev = nullptr; // pointer which points to this timer
 	EventResponder *_event = nullptr;
 	enum TimerStateType {
 		TimerOff = 0,
@@ -264,7 +300,8 @@ private:
 	};
 	volatile TimerStateType _state = TimerOff;
 	static MillisTimer *listWaiting; // single linked list of waiting to start timers
-	static MillisTimer *listActive;  // double linked list of running timers
+	static MillisTimer *wheel[MILLISTIMER_WHEEL_LEVELS][MILLISTIMER_WHEEL_SIZE];
+	static unsigned long wheelTick;  // the tick runFromTimer() will process next
 	static bool disableTimerInterrupt() {
 		uint32_t primask;
 		__asm__ volatile("mrs %0, primask\n" : "=r" (primask)::);
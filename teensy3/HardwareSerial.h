@@ -159,6 +159,10 @@ void serial_flush(void);
 int serial_write_buffer_free(void);
 void serial_add_memory_for_read(void *buffer, size_t length);
 void serial_add_memory_for_write(void *buffer, size_t length);
+int serial_set_rx_dma(uint8_t enable);
+int serial_rx_dma_overrun(void);
+int serial_set_tx_dma(uint8_t enable);
+int serial_set_frame_callback(void (*callback)(uint32_t len));
 int serial_available(void);
 int serial_getchar(void);
 int serial_peek(void);
@@ -182,6 +186,10 @@ void serial2_flush(void);
 int serial2_write_buffer_free(void);
 void serial2_add_memory_for_read(void *buffer, size_t length);
 void serial2_add_memory_for_write(void *buffer, size_t length);
+int serial2_set_rx_dma(uint8_t enable);
+int serial2_rx_dma_overrun(void);
+int serial2_set_tx_dma(uint8_t enable);
+int serial2_set_frame_callback(void (*callback)(uint32_t len));
 int serial2_available(void);
 int serial2_getchar(void);
 int serial2_peek(void);
@@ -201,6 +209,9 @@ void serial3_flush(void);
 int serial3_write_buffer_free(void);
 void serial3_add_memory_for_read(void *buffer, size_t length);
 void serial3_add_memory_for_write(void *buffer, size_t length);
+int serial3_set_rx_dma(uint8_t enable);
+int serial3_rx_dma_overrun(void);
+int serial3_set_tx_dma(uint8_t enable);
 int serial3_available(void);
 int serial3_getchar(void);
 int serial3_peek(void);
@@ -220,6 +231,9 @@ void serial4_flush(void);
 int serial4_write_buffer_free(void);
 void serial4_add_memory_for_read(void *buffer, size_t length);
 void serial4_add_memory_for_write(void *buffer, size_t length);
+int serial4_set_rx_dma(uint8_t enable);
+int serial4_rx_dma_overrun(void);
+int serial4_set_tx_dma(uint8_t enable);
 int serial4_available(void);
 int serial4_getchar(void);
 int serial4_peek(void);
@@ -239,6 +253,9 @@ void serial5_flush(void);
 int serial5_write_buffer_free(void);
 void serial5_add_memory_for_read(void *buffer, size_t length);
 void serial5_add_memory_for_write(void *buffer, size_t length);
+int serial5_set_rx_dma(uint8_t enable);
+int serial5_rx_dma_overrun(void);
+int serial5_set_tx_dma(uint8_t enable);
 int serial5_available(void);
 int serial5_getchar(void);
 int serial5_peek(void);
@@ -258,6 +275,9 @@ void serial6_flush(void);
 int serial6_write_buffer_free(void);
 void serial6_add_memory_for_read(void *buffer, size_t length);
 void serial6_add_memory_for_write(void *buffer, size_t length);
+int serial6_set_rx_dma(uint8_t enable);
+int serial6_rx_dma_overrun(void);
+int serial6_set_tx_dma(uint8_t enable);
 int serial6_available(void);
 int serial6_getchar(void);
 int serial6_peek(void);
@@ -272,6 +292,7 @@ void serial6_clear(void);
 //
 #ifdef __cplusplus
 #include "Stream.h"
+class EventResponder;
 class HardwareSerial : public Stream
 {
 public:
@@ -299,6 +320,22 @@ public:
 	virtual int availableForWrite(void) { return serial_write_buffer_free(); }
  	virtual void addMemoryForRead(void *buffer, size_t length) {serial_add_memory_for_read(buffer, length);}
 	virtual void addMemoryForWrite(void *buffer, size_t length){serial_add_memory_for_write(buffer, length);}
+	// Receive by DMA, so interrupt latency can't lose data.  Returns
+	// false if DMA isn't available, as on Teensy LC.
+	virtual bool useRxDMA(bool enable=true) { return serial_set_rx_dma(enable); }
+	// True if receive DMA overwrote unread data since the prior check,
+	// because the buffer filled before it was read.
+	virtual bool rxOverrun() { return serial_rx_dma_overrun(); }
+	// Transmit by DMA, rather than an interrupt per byte.  Returns false
+	// if DMA isn't available, as on Teensy LC, or where receive and transmit
+	// share one DMA request (Serial5, and Serial6 on Teensy 3.5).
+	virtual bool useTxDMA(bool enable=true) { return serial_set_tx_dma(enable); }
+	// Trigger an event when the receive line goes idle after data, with
+	// the frame length as status.  Idle detection is always 1 character
+	// on these UARTs, so idle_characters is only for Teensy 4 compatibility.
+	// Returns false on ports without an idle interrupt.
+	virtual bool attachFrameEvent(EventResponder &event, uint8_t idle_characters=1);
+	virtual void detachFrameEvent() { serial_set_frame_callback(NULL); }
 	using Print::write;
 	virtual size_t write(uint8_t c) { serial_putchar(c); return 1; }
 	virtual size_t write(unsigned long n)   { return write((uint8_t)n); }
@@ -353,6 +390,11 @@ public:
 	virtual int availableForWrite(void) { return serial2_write_buffer_free(); }
  	virtual void addMemoryForRead(void *buffer, size_t length) {serial2_add_memory_for_read(buffer, length);}
 	virtual void addMemoryForWrite(void *buffer, size_t length){serial2_add_memory_for_write(buffer, length);}
+	virtual bool useRxDMA(bool enable=true) { return serial2_set_rx_dma(enable); }
+	virtual bool rxOverrun() { return serial2_rx_dma_overrun(); }
+	virtual bool useTxDMA(bool enable=true) { return serial2_set_tx_dma(enable); }
+	virtual bool attachFrameEvent(EventResponder &event, uint8_t idle_characters=1);
+	virtual void detachFrameEvent() { serial2_set_frame_callback(NULL); }
 	using Print::write;
 	virtual size_t write(uint8_t c) { serial2_putchar(c); return 1; }
 	virtual size_t write(unsigned long n)   { return write((uint8_t)n); }
@@ -392,6 +434,11 @@ public:
 	virtual int availableForWrite(void) { return serial3_write_buffer_free(); }
  	virtual void addMemoryForRead(void *buffer, size_t length) {serial3_add_memory_for_read(buffer, length);}
 	virtual void addMemoryForWrite(void *buffer, size_t length){serial3_add_memory_for_write(buffer, length);}
+	virtual bool useRxDMA(bool enable=true) { return serial3_set_rx_dma(enable); }
+	virtual bool rxOverrun() { return serial3_rx_dma_overrun(); }
+	virtual bool useTxDMA(bool enable=true) { return serial3_set_tx_dma(enable); }
+	virtual bool attachFrameEvent(EventResponder &event, uint8_t idle_characters=1) { return false; }
+	virtual void detachFrameEvent() { }
 	using Print::write;
 	virtual size_t write(uint8_t c) { serial3_putchar(c); return 1; }
 	virtual size_t write(unsigned long n)   { return write((uint8_t)n); }
@@ -431,6 +478,11 @@ public:
 	virtual int availableForWrite(void) { return serial4_write_buffer_free(); }
  	virtual void addMemoryForRead(void *buffer, size_t length) {serial4_add_memory_for_read(buffer, length);}
 	virtual void addMemoryForWrite(void *buffer, size_t length){serial4_add_memory_for_write(buffer, length);}
+	virtual bool useRxDMA(bool enable=true) { return serial4_set_rx_dma(enable); }
+	virtual bool rxOverrun() { return serial4_rx_dma_overrun(); }
+	virtual bool useTxDMA(bool enable=true) { return serial4_set_tx_dma(enable); }
+	virtual bool attachFrameEvent(EventResponder &event, uint8_t idle_characters=1) { return false; }
+	virtual void detachFrameEvent() { }
 	using Print::write;
 	virtual size_t write(uint8_t c) { serial4_putchar(c); return 1; }
 	virtual size_t write(unsigned long n)   { return write((uint8_t)n); }
@@ -470,6 +522,11 @@ public:
 	virtual int availableForWrite(void) { return serial5_write_buffer_free(); }
  	virtual void addMemoryForRead(void *buffer, size_t length) {serial5_add_memory_for_read(buffer, length);}
 	virtual void addMemoryForWrite(void *buffer, size_t length){serial5_add_memory_for_write(buffer, length);}
+	virtual bool useRxDMA(bool enable=true) { return serial5_set_rx_dma(enable); }
+	virtual bool rxOverrun() { return serial5_rx_dma_overrun(); }
+	virtual bool useTxDMA(bool enable=true) { return serial5_set_tx_dma(enable); }
+	virtual bool attachFrameEvent(EventResponder &event, uint8_t idle_characters=1) { return false; }
+	virtual void detachFrameEvent() { }
 	using Print::write;
 	virtual size_t write(uint8_t c) { serial5_putchar(c); return 1; }
 	virtual size_t write(unsigned long n)   { return write((uint8_t)n); }
@@ -516,6 +573,11 @@ public:
 	virtual int availableForWrite(void) { return serial6_write_buffer_free(); }
  	virtual void addMemoryForRead(void *buffer, size_t length) {serial6_add_memory_for_read(buffer, length);}
 	virtual void addMemoryForWrite(void *buffer, size_t length){serial6_add_memory_for_write(buffer, length);}
+	virtual bool useRxDMA(bool enable=true) { return serial6_set_rx_dma(enable); }
+	virtual bool rxOverrun() { return serial6_rx_dma_overrun(); }
+	virtual bool useTxDMA(bool enable=true) { return serial6_set_tx_dma(enable); }
+	virtual bool attachFrameEvent(EventResponder &event, uint8_t idle_characters=1) { return false; }
+	virtual void detachFrameEvent() { }
 	using Print::write;
 	virtual size_t write(uint8_t c) { serial6_putchar(c); return 1; }
 	virtual size_t write(unsigned long n)   { return write((uint8_t)n); }
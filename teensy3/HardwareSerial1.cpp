@@ -30,6 +30,7 @@
 
 #include <Arduino.h>
 #include "HardwareSerial.h"
+#include "EventResponder.h"
 
 
 uint8_t _serialEvent1_default __attribute__((weak)) PROGMEM = 0 ;
@@ -41,3 +42,15 @@ void HardwareSerial::begin(uint32_t baud) {
 	if (!_serialEvent1_default) addToSerialEventsList();
 }
 
+static EventResponder *frame_event = NULL;
+
+static void frame_callback(uint32_t len)
+{
+	frame_event->triggerEvent(len, &Serial1);
+}
+
+bool HardwareSerial::attachFrameEvent(EventResponder &event, uint8_t idle_characters)
+{
+	frame_event = &event;
+	return serial_set_frame_callback(frame_callback);
+}
@@ -29,6 +29,7 @@
  */
 #include <Arduino.h>
 #include "HardwareSerial.h"
+#include "EventResponder.h"
 
 HardwareSerial2 Serial2(&serialEvent2);
 
@@ -38,3 +39,16 @@ void HardwareSerial2::begin(uint32_t baud) {
 	serial2_begin(BAUD2DIV2(baud));
 	if (!_serialEvent2_default) addToSerialEventsList();
 }
+
+static EventResponder *frame_event = NULL;
+
+static void frame_callback(uint32_t len)
+{
+	frame_event->triggerEvent(len, &Serial2);
+}
+
+bool HardwareSerial2::attachFrameEvent(EventResponder &event, uint8_t idle_characters)
+{
+	frame_event = &event;
+	return serial2_set_frame_callback(frame_callback);
+}
@@ -0,0 +1,119 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#ifndef PrintTee_h_
+#define PrintTee_h_
+#ifdef __cplusplus
+
+#include "BufferedPrint.h"
+
+// Send the same output to several Print destinations, formatting it only
+// once.  Numbers and strings are formatted into one buffer, which is
+// then given to every sink with a single write():
+//
+//   PrintTee<128> tee;
+//   tee.add(Serial, true);      // non-blocking
+//   tee.add(Serial1, true);     // non-blocking
+//   tee.add(file);              // SD File, always written in full
+//   tee.print(millis());
+//   tee.print(',');
+//   tee.println(temperature);
+//   tee.send(); // or let println() fill the buffer, or flush()
+//
+// A non-blocking sink is given only what its availableForWrite() says
+// fits now.  The rest is discarded and counted by dropped().  A slow or
+// disconnected port therefore never stalls the others.  Non-blocking
+// sinks are written first.  Only use non-blocking for sinks which
+// implement availableForWrite(); File does not, so it must be blocking.
+template <size_t N, unsigned int SINKS = 4>
+class PrintTee : public BufferedPrintBase<N>
+{
+public:
+	PrintTee() : count(0) {}
+	~PrintTee() { this->send(); }
+	// add a destination, false if all SINKS are in use
+	bool add(Print &sink, bool nonblocking = false) {
+		if (count >= SINKS) return false;
+		sinks[count].print = &sink;
+		sinks[count].nonblocking = nonblocking;
+		sinks[count].dropped = 0;
+		count++;
+		return true;
+	}
+	void remove(Print &sink) {
+		for (unsigned int i=0; i < count; i++) {
+			if (sinks[i].print == &sink) {
+				for (; i + 1 < count; i++) sinks[i] = sinks[i + 1];
+				count--;
+				return;
+			}
+		}
+	}
+	// send, then flush the blocking sinks
+	virtual void flush() {
+		this->send();
+		for (unsigned int i=0; i < count; i++) {
+			if (!sinks[i].nonblocking) sinks[i].print->flush();
+		}
+	}
+	// bytes a non-blocking sink has discarded, by the order it was added
+	uint32_t dropped(unsigned int index) const {
+		return (index < count) ? sinks[index].dropped : 0;
+	}
+protected:
+	// give data to every sink
+	virtual size_t output(const uint8_t *data, size_t size) {
+		for (unsigned int i=0; i < count; i++) {
+			if (!sinks[i].nonblocking) continue;
+			int avail = sinks[i].print->availableForWrite();
+			size_t n = (avail > 0) ? (size_t)avail : 0;
+			if (n > size) n = size;
+			if (n > 0) n = sinks[i].print->write(data, n);
+			sinks[i].dropped += size - n;
+		}
+		for (unsigned int i=0; i < count; i++) {
+			if (sinks[i].nonblocking) continue;
+			if (sinks[i].print->write(data, size) < size) this->setWriteError();
+		}
+		return size;
+	}
+private:
+	struct {
+		Print *print;
+		bool nonblocking;
+		uint32_t dropped;
+	} sinks[SINKS];
+	unsigned int count;
+};
+
+#endif // __cplusplus
+#endif
@@ -0,0 +1,140 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2017 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "SPIFIFO.h"
+
+#ifdef HAS_SPIFIFO
+#include "DMAChannel.h"
+
+// PUSHR command words are built in chunks, the next while DMA sends the
+// current one, so long transfers need only a small fixed buffer.  The DMA
+// is re-armed only after each chunk is fully received, so the bus idles
+// for a moment between chunks.
+#define SPIFIFO_DMA_CHUNK 64
+
+static DMAChannel txdma(false);
+static DMAChannel rxdma(false);
+static bool dma_allocated = false;
+static uint32_t command[2][SPIFIFO_DMA_CHUNK];
+static volatile uint16_t discard;
+
+static void make_commands(uint32_t *cmd, const void *tx, uint32_t offset, uint32_t count,
+	uint32_t wide, uint32_t flags, uint32_t last_flags, bool last_chunk)
+{
+	if (!tx) {
+		uint32_t fill = (wide ? 0xFFFF : 0xFF) | flags;
+		for (uint32_t i=0; i < count; i++) {
+			cmd[i] = fill;
+		}
+	} else if (wide) {
+		const uint16_t *p = (const uint16_t *)tx + offset;
+		for (uint32_t i=0; i < count; i++) {
+			cmd[i] = p[i] | flags;
+		}
+	} else {
+		const uint8_t *p = (const uint8_t *)tx + offset;
+		for (uint32_t i=0; i < count; i++) {
+			cmd[i] = p[i] | flags;
+		}
+	}
+	if (last_chunk) cmd[count - 1] = (cmd[count - 1] & ~flags) | last_flags;
+}
+
+void SPIFIFOclass::transferDMA(const void *tx, void *rx, uint32_t len, uint32_t cont, uint32_t wide)
+{
+	if (len == 0) return;
+	if (!dma_allocated) {
+		txdma.begin();
+		rxdma.begin();
+		dma_allocated = true;
+	}
+	// the hardware chip select stays asserted between words, and after
+	// the last word too if cont is set
+	uint32_t pcsbits = pcs << 16;
+	uint32_t last_flags = pcsbits | (wide ? SPI_PUSHR_CTAS(1) : 0);
+	uint32_t flags = last_flags | (pcsbits ? SPI_PUSHR_CONT : 0);
+	if (cont && pcsbits) last_flags |= SPI_PUSHR_CONT;
+	if (!pcsbits) *reg = 0;
+
+	uint32_t size = wide ? 2 : 1;
+	uint32_t offset = 0;
+	uint32_t count = (len < SPIFIFO_DMA_CHUNK) ? len : SPIFIFO_DMA_CHUNK;
+	uint32_t buf = 0;
+	make_commands(command[0], tx, 0, count, wide, flags, last_flags, count == len);
+	KINETISK_SPI0.SR = SPI_SR_TCF | SPI_SR_EOQF | SPI_SR_TFUF | SPI_SR_RFOF | SPI_SR_RFDF | SPI_SR_TFFF;
+	KINETISK_SPI0.RSER = SPI_RSER_TFFF_RE | SPI_RSER_TFFF_DIRS | SPI_RSER_RFDF_RE | SPI_RSER_RFDF_DIRS;
+	while (1) {
+		if (wide) {
+			rxdma.source((volatile uint16_t &)KINETISK_SPI0.POPR);
+		} else {
+			rxdma.source((volatile uint8_t &)KINETISK_SPI0.POPR);
+		}
+		if (rx) {
+			if (wide) {
+				rxdma.destinationBuffer((uint16_t *)rx + offset, count * 2);
+			} else {
+				rxdma.destinationBuffer((uint8_t *)rx + offset, count);
+			}
+		} else {
+			rxdma.destination(discard);
+		}
+		rxdma.transferSize(size);
+		rxdma.transferCount(count);
+		rxdma.triggerAtHardwareEvent(DMAMUX_SOURCE_SPI0_RX);
+		rxdma.disableOnCompletion();
+		txdma.sourceBuffer(command[buf], count * 4);
+		txdma.destination(KINETISK_SPI0.PUSHR);
+		txdma.transferSize(4);
+		txdma.transferCount(count);
+		txdma.triggerAtHardwareEvent(DMAMUX_SOURCE_SPI0_TX);
+		txdma.disableOnCompletion();
+		rxdma.enable();
+		txdma.enable();
+
+		uint32_t next_offset = offset + count;
+		uint32_t next_count = len - next_offset;
+		if (next_count > SPIFIFO_DMA_CHUNK) next_count = SPIFIFO_DMA_CHUNK;
+		if (next_count) {
+			make_commands(command[buf ^ 1], tx, next_offset, next_count, wide,
+				flags, last_flags, next_offset + next_count == len);
+		}
+		while (!rxdma.complete()) ; // wait
+		rxdma.clearComplete();
+		txdma.clearComplete();
+		if (next_count == 0) break;
+		offset = next_offset;
+		count = next_count;
+		buf ^= 1;
+	}
+	KINETISK_SPI0.RSER = 0;
+	if (!pcsbits && !cont) *reg = 1;
+}
+
+#endif // HAS_SPIFIFO
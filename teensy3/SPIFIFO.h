@@ -335,7 +335,21 @@ public:
 	inline void clear(void) __attribute__((always_inline)) {
 		KINETISK_SPI0.MCR = SPI_MCR_MSTR | SPI_MCR_PCSIS(0x1F) | SPI_MCR_CLR_TXF | SPI_MCR_CLR_RXF;
 	}
+	// Send and receive a whole buffer using 2 DMA channels.  The SPI
+	// clock runs without gaps within each chunk of 64 words, but idles
+	// briefly between chunks while the next one is armed after the
+	// previous chunk is received.  Either tx or rx may be
+	// NULL, to send all ones or discard what is received.  Every word
+	// from earlier write() calls must have been read() first.  Returns
+	// when the last word is received.
+	void transfer(const void *tx, void *rx, uint32_t len, uint32_t cont=0) {
+		transferDMA(tx, rx, len, cont, 0);
+	}
+	void transfer16(const uint16_t *tx, uint16_t *rx, uint32_t len, uint32_t cont=0) {
+		transferDMA(tx, rx, len, cont, 1);
+	}
 private:
+	void transferDMA(const void *tx, void *rx, uint32_t len, uint32_t cont, uint32_t wide);
 	static uint8_t pcs;
 	static volatile uint8_t *reg;
 };
@@ -70,6 +70,7 @@
 #include "WString.h"
 #include "elapsedMillis.h"
 #include "IntervalTimer.h"
+#include "BufferedPrint.h"
 #include "CrashReport.h"
 
 uint16_t makeWord(uint16_t w);
@@ -429,6 +429,15 @@ static const uint8_t pin2sc1a[] = {
 
 
 
+// ADC channel for a pin, with 0x80 set if ADC1 measures it (0x40 then
+// selects its "a" input), or 255 if the pin has no analog input
+uint8_t analog_pin_channel(uint8_t pin)
+{
+	if (pin >= sizeof(pin2sc1a)) return 255;
+	if (calibrating) wait_for_cal();
+	return pin2sc1a[pin];
+}
+
 // TODO: perhaps this should store the NVIC priority, so it works recursively?
 static volatile uint8_t analogReadBusyADC0 = 0;
 #ifdef HAS_KINETIS_ADC1
@@ -450,8 +459,12 @@ int analogRead(uint8_t pin)
 	if (calibrating) wait_for_cal();
 
 #ifdef HAS_KINETIS_ADC1
-	if (channel & 0x80) goto beginADC1;
+	if (channel & 0x80) {
+		if (ADC1_SC2 & ADC_SC2_ADTRG) return 0; // busy with AnalogStream
+		goto beginADC1;
+	}
 #endif
+	if (ADC0_SC2 & ADC_SC2_ADTRG) return 0; // busy with AnalogStream
 
 	// This interrupt disable stuff is meant to allow use of
 	// analogRead() in both main program and interrupts.
@@ -47,6 +47,9 @@ void eeprom_write_word(uint16_t *addr, uint16_t value);
 void eeprom_write_dword(uint32_t *addr, uint32_t value);
 void eeprom_write_block(const void *buf, void *addr, uint32_t len);
 int eeprom_is_ready(void);
+// Group several writes, so Teensy 3.6 leaves HSRUN only once for all of them
+void eeprom_write_begin(void);
+void eeprom_write_end(void);
 #define eeprom_busy_wait() do {} while (!eeprom_is_ready())
 
 static inline float eeprom_read_float(const float *addr) __attribute__((pure, always_inline, unused));
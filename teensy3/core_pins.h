@@ -2290,6 +2290,10 @@ void analog_init(void);
 
 
 int touchRead(uint8_t pin);
+int touchScanBegin(const uint8_t *pins, uint8_t count);
+void touchScanEnd(void);
+int touchScanRead(uint8_t pin);
+void touchScanCallback(void (*function)(void));
 
 
 static inline void shiftOut(uint8_t, uint8_t, uint8_t, uint8_t) __attribute__((always_inline, unused));
@@ -2531,6 +2535,20 @@ extern "C" {
 unsigned long rtc_get(void);
 void rtc_set(unsigned long t);
 void rtc_compensate(int adjust);
+
+// Startup time profile: microseconds from the start of SysTick (after the
+// clocks are configured) to the end of each phase, so
+// startup_time_usec[STARTUP_TIME_ANALOG] - startup_time_usec[STARTUP_TIME_TIMERS]
+// is the time analog_init() took.
+#define STARTUP_TIME_TIMERS		0	// FTM and TPM timers for PWM
+#define STARTUP_TIME_ANALOG		1	// analog_init(), calibration continues after
+#define STARTUP_TIME_MIDDLE_HOOK	2	// startup_middle_hook()
+#define STARTUP_TIME_USB		3	// delay before usb_init(), usb_init()
+#define STARTUP_TIME_USB_DELAY		4	// delay after usb_init()
+#define STARTUP_TIME_CONSTRUCTORS	5	// RTC, startup_late_hook(), C++ constructors
+#define STARTUP_TIME_NUM		6
+extern uint32_t startup_time_usec[STARTUP_TIME_NUM];
+void startup_time(uint32_t phase);
 #ifdef __cplusplus
 }
 
@@ -2547,6 +2565,26 @@ typedef struct  {
 void breakTime(uint32_t time, DateTimeFields &tm);  // break 32 bit time into DateTimeFields
 uint32_t makeTime(const DateTimeFields &tm); // convert DateTimeFields to 32 bit time
 
+// A pin number fixed at compile time.  Each function resolves to the port
+// register and bit directly, even when N arrives through other templates,
+// for example TeensyPin<LED_BUILTIN>::write(HIGH).  Named TeensyPin since
+// libraries like FastLED have their own Pin class.  On Teensy 3 and 4,
+// write() is digitalWriteFast(), as PWM is turned off by pinMode().  On
+// Teensy 2.0 write() is digitalWrite(), which also turns off PWM.
+template <uint8_t N>
+class TeensyPin
+{
+public:
+	enum { number = N };
+	static void mode(uint8_t mode) __attribute__((always_inline)) { pinMode(N, mode); }
+	static void write(uint8_t val) __attribute__((always_inline)) { digitalWriteFast(N, val); }
+	static void writeFast(uint8_t val) __attribute__((always_inline)) { digitalWriteFast(N, val); }
+	static void high(void) __attribute__((always_inline)) { digitalWriteFast(N, HIGH); }
+	static void low(void) __attribute__((always_inline)) { digitalWriteFast(N, LOW); }
+	static void toggle(void) __attribute__((always_inline)) { digitalToggleFast(N); }
+	static uint8_t read(void) __attribute__((always_inline)) { return digitalReadFast(N); }
+};
+
 class teensy3_clock_class
 {
 public:
@@ -2555,6 +2593,9 @@ public:
 	static void compensate(int adj) __attribute__((always_inline)) { rtc_compensate(adj); }
 };
 extern teensy3_clock_class Teensy3Clock;
+
+class EventResponder;
+bool touchScanAttachEvent(EventResponder &event);
 #endif
 
 
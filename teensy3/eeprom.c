@@ -196,6 +196,45 @@ static void flexram_wait(void)
 	}
 }
 
+// Each write to FlexRAM is saved to flash by the hardware, with HSRUN
+// turned off.  Normally every write leaves and reenters HSRUN and waits
+// for its save.  Between eeprom_write_begin() and eeprom_write_end(),
+// HSRUN stays off and each write only waits for the prior save, so
+// saving many values changes clock modes only once.
+static uint8_t write_batch = 0;
+static uint8_t write_pending = 0;
+
+static void flexram_write_prepare(void)
+{
+	if (write_pending) {
+		flexram_wait(); // previous write still being saved
+	} else {
+		kinetis_hsrun_disable();
+		write_pending = 1;
+	}
+	uint8_t stat = FTFL_FSTAT & 0x70;
+	if (stat) FTFL_FSTAT = stat;
+}
+
+static void flexram_write_done(void)
+{
+	if (write_batch) return;
+	flexram_wait();
+	kinetis_hsrun_enable();
+	write_pending = 0;
+}
+
+void eeprom_write_begin(void)
+{
+	write_batch++;
+}
+
+void eeprom_write_end(void)
+{
+	if (write_batch == 0 || --write_batch > 0) return;
+	if (write_pending) flexram_write_done();
+}
+
 void eeprom_write_byte(uint8_t *addr, uint8_t value)
 {
 	uint32_t offset = (uint32_t)addr;
@@ -203,12 +242,9 @@ void eeprom_write_byte(uint8_t *addr, uint8_t value)
 	if (offset >= EEPROM_SIZE) return;
 	if (!(FTFL_FCNFG & FTFL_FCNFG_EEERDY)) eeprom_initialize();
 	if (FlexRAM[offset] != value) {
-		kinetis_hsrun_disable();
-		uint8_t stat = FTFL_FSTAT & 0x70;
-		if (stat) FTFL_FSTAT = stat;
+		flexram_write_prepare();
 		FlexRAM[offset] = value;
-		flexram_wait();
-		kinetis_hsrun_enable();
+		flexram_write_done();
 	}
 }
 
@@ -222,30 +258,21 @@ void eeprom_write_word(uint16_t *addr, uint16_t value)
 	if ((offset & 1) == 0) {
 #endif
 		if (*(uint16_t *)(&FlexRAM[offset]) != value) {
-			kinetis_hsrun_disable();
-			uint8_t stat = FTFL_FSTAT & 0x70;
-			if (stat) FTFL_FSTAT = stat;
+			flexram_write_prepare();
 			*(uint16_t *)(&FlexRAM[offset]) = value;
-			flexram_wait();
-			kinetis_hsrun_enable();
+			flexram_write_done();
 		}
 #ifdef HANDLE_UNALIGNED_WRITES
 	} else {
 		if (FlexRAM[offset] != value) {
-			kinetis_hsrun_disable();
-			uint8_t stat = FTFL_FSTAT & 0x70;
-			if (stat) FTFL_FSTAT = stat;
+			flexram_write_prepare();
 			FlexRAM[offset] = value;
-			flexram_wait();
-			kinetis_hsrun_enable();
+			flexram_write_done();
 		}
 		if (FlexRAM[offset + 1] != (value >> 8)) {
-			kinetis_hsrun_disable();
-			uint8_t stat = FTFL_FSTAT & 0x70;
-			if (stat) FTFL_FSTAT = stat;
+			flexram_write_prepare();
 			FlexRAM[offset + 1] = value >> 8;
-			flexram_wait();
-			kinetis_hsrun_enable();
+			flexram_write_done();
 		}
 	}
 #endif
@@ -262,57 +289,39 @@ void eeprom_write_dword(uint32_t *addr, uint32_t value)
 	case 0:
 #endif
 		if (*(uint32_t *)(&FlexRAM[offset]) != value) {
-			kinetis_hsrun_disable();
-			uint8_t stat = FTFL_FSTAT & 0x70;
-			if (stat) FTFL_FSTAT = stat;
+			flexram_write_prepare();
 			*(uint32_t *)(&FlexRAM[offset]) = value;
-			flexram_wait();
-			kinetis_hsrun_enable();
+			flexram_write_done();
 		}
 		return;
 #ifdef HANDLE_UNALIGNED_WRITES
 	case 2:
 		if (*(uint16_t *)(&FlexRAM[offset]) != value) {
-			kinetis_hsrun_disable();
-			uint8_t stat = FTFL_FSTAT & 0x70;
-			if (stat) FTFL_FSTAT = stat;
+			flexram_write_prepare();
 			*(uint16_t *)(&FlexRAM[offset]) = value;
-			flexram_wait();
-			kinetis_hsrun_enable();
+			flexram_write_done();
 		}
 		if (*(uint16_t *)(&FlexRAM[offset + 2]) != (value >> 16)) {
-			kinetis_hsrun_disable();
-			uint8_t stat = FTFL_FSTAT & 0x70;
-			if (stat) FTFL_FSTAT = stat;
+			flexram_write_prepare();
 			*(uint16_t *)(&FlexRAM[offset + 2]) = value >> 16;
-			flexram_wait();
-			kinetis_hsrun_enable();
+			flexram_write_done();
 		}
 		return;
 	default:
 		if (FlexRAM[offset] != value) {
-			kinetis_hsrun_disable();
-			uint8_t stat = FTFL_FSTAT & 0x70;
-			if (stat) FTFL_FSTAT = stat;
+			flexram_write_prepare();
 			FlexRAM[offset] = value;
-			flexram_wait();
-			kinetis_hsrun_enable();
+			flexram_write_done();
 		}
 		if (*(uint16_t *)(&FlexRAM[offset + 1]) != (value >> 8)) {
-			kinetis_hsrun_disable();
-			uint8_t stat = FTFL_FSTAT & 0x70;
-			if (stat) FTFL_FSTAT = stat;
+			flexram_write_prepare();
 			*(uint16_t *)(&FlexRAM[offset + 1]) = value >> 8;
-			flexram_wait();
-			kinetis_hsrun_enable();
+			flexram_write_done();
 		}
 		if (FlexRAM[offset + 3] != (value >> 24)) {
-			kinetis_hsrun_disable();
-			uint8_t stat = FTFL_FSTAT & 0x70;
-			if (stat) FTFL_FSTAT = stat;
+			flexram_write_prepare();
 			FlexRAM[offset + 3] = value >> 24;
-			flexram_wait();
-			kinetis_hsrun_enable();
+			flexram_write_done();
 		}
 	}
 #endif
@@ -327,8 +336,10 @@ void eeprom_write_block(const void *buf, void *addr, uint32_t len)
 	if (!(FTFL_FCNFG & FTFL_FCNFG_EEERDY)) eeprom_initialize();
 	if (len >= EEPROM_SIZE) len = EEPROM_SIZE;
 	if (offset + len >= EEPROM_SIZE) len = EEPROM_SIZE - offset;
+	eeprom_write_begin();
 	while (len > 0) {
 		uint32_t lsb = offset & 3;
+		if (write_pending) flexram_wait(); // FlexRAM is compared below
 		if (lsb == 0 && len >= 4) {
 			// write aligned 32 bits
 			uint32_t val32;
@@ -337,12 +348,9 @@ void eeprom_write_block(const void *buf, void *addr, uint32_t len)
 			val32 |= (*src++ << 16);
 			val32 |= (*src++ << 24);
 			if (*(uint32_t *)(&FlexRAM[offset]) != val32) {
-				kinetis_hsrun_disable();
-				uint8_t stat = FTFL_FSTAT & 0x70;
-				if (stat) FTFL_FSTAT = stat;
+				flexram_write_prepare();
 				*(uint32_t *)(&FlexRAM[offset]) = val32;
-				flexram_wait();
-				kinetis_hsrun_enable();
+				flexram_write_done();
 			}
 			offset += 4;
 			len -= 4;
@@ -352,12 +360,9 @@ void eeprom_write_block(const void *buf, void *addr, uint32_t len)
 			val16 = *src++;
 			val16 |= (*src++ << 8);
 			if (*(uint16_t *)(&FlexRAM[offset]) != val16) {
-				kinetis_hsrun_disable();
-				uint8_t stat = FTFL_FSTAT & 0x70;
-				if (stat) FTFL_FSTAT = stat;
+				flexram_write_prepare();
 				*(uint16_t *)(&FlexRAM[offset]) = val16;
-				flexram_wait();
-				kinetis_hsrun_enable();
+				flexram_write_done();
 			}
 			offset += 2;
 			len -= 2;
@@ -365,17 +370,15 @@ void eeprom_write_block(const void *buf, void *addr, uint32_t len)
 			// write 8 bits
 			uint8_t val8 = *src++;
 			if (FlexRAM[offset] != val8) {
-				kinetis_hsrun_disable();
-				uint8_t stat = FTFL_FSTAT & 0x70;
-				if (stat) FTFL_FSTAT = stat;
+				flexram_write_prepare();
 				FlexRAM[offset] = val8;
-				flexram_wait();
-				kinetis_hsrun_enable();
+				flexram_write_done();
 			}
 			offset++;
 			len--;
 		}
 	}
+	eeprom_write_end();
 }
 
 /*
@@ -584,5 +587,13 @@ void eeprom_write_block(const void *buf, void *addr, uint32_t len)
 	}
 }
 
+void eeprom_write_begin(void)
+{
+}
+
+void eeprom_write_end(void)
+{
+}
+
 
 #endif // KINETISL
@@ -32,6 +32,7 @@
 
 extern "C" int main(void)
 {
+	startup_time(STARTUP_TIME_CONSTRUCTORS);
 #ifdef USING_MAKEFILE
 
 	// To use Teensy 3.0 without Arduino, simply put your code here.
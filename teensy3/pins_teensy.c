@@ -444,6 +444,14 @@ extern void usb_init(void);
 static void startup_default_middle_hook(void) {}
 void startup_middle_hook(void)	__attribute__ ((weak, alias("startup_default_middle_hook")));
 
+// Microseconds from SysTick start to the end of each startup phase, STARTUP_TIME_*
+uint32_t startup_time_usec[STARTUP_TIME_NUM];
+
+void startup_time(uint32_t phase)
+{
+	if (phase < STARTUP_TIME_NUM) startup_time_usec[phase] = micros();
+}
+
 // create a default PWM at the same 488.28 Hz as Arduino Uno
 
 #if defined(KINETISK)
@@ -584,7 +592,9 @@ void _init_Teensyduino_internal_(void)
 	TPM1_C1SC = 0x28;
 	TPM1_SC = FTM_SC_CLKS(1) | FTM_SC_PS(0);
 #endif
+	startup_time(STARTUP_TIME_TIMERS);
 	analog_init();
+	startup_time(STARTUP_TIME_ANALOG);
 
 #if !defined(TEENSY_INIT_USB_DELAY_BEFORE)
 	#define TEENSY_INIT_USB_DELAY_BEFORE 20
@@ -598,10 +608,15 @@ void _init_Teensyduino_internal_(void)
 	// https://forum.pjrc.com/threads/36606-startup-time-(400ms)?p=113980&viewfull=1#post113980
 	// https://forum.pjrc.com/threads/31290-Teensey-3-2-Teensey-Loader-1-24-Issues?p=87273&viewfull=1#post87273
 
+	// The delays are measured from SysTick start rather than added after
+	// each step, so time spent initializing is not waited again.
 	startup_middle_hook();
-	delay(TEENSY_INIT_USB_DELAY_BEFORE);
+	startup_time(STARTUP_TIME_MIDDLE_HOOK);
+	while (millis() < TEENSY_INIT_USB_DELAY_BEFORE) yield();
 	usb_init();
-	delay(TEENSY_INIT_USB_DELAY_AFTER);
+	startup_time(STARTUP_TIME_USB);
+	while (millis() < TEENSY_INIT_USB_DELAY_BEFORE + TEENSY_INIT_USB_DELAY_AFTER) yield();
+	startup_time(STARTUP_TIME_USB_DELAY);
 }
 
 
@@ -31,6 +31,7 @@
 #include "kinetis.h"
 #include "core_pins.h"
 #include "HardwareSerial.h"
+#include "serial_core.h"
 #include <stddef.h>
 
 ////////////////////////////////////////////////////////////////
@@ -41,8 +42,12 @@
 #define SERIAL3_TX_BUFFER_SIZE     40 // number of outgoing bytes to buffer
 #endif
 #ifndef SERIAL3_RX_BUFFER_SIZE
+#if defined(__MK64FX512__) || defined(__MK66FX1M0__)
+#define SERIAL3_RX_BUFFER_SIZE    256 // number of incoming bytes to buffer
+#else
 #define SERIAL3_RX_BUFFER_SIZE     64 // number of incoming bytes to buffer
 #endif
+#endif
 #define RTS_HIGH_WATERMARK (SERIAL3_RX_BUFFER_SIZE-24) // RTS requests sender to pause
 #define RTS_LOW_WATERMARK  (SERIAL3_RX_BUFFER_SIZE-38) // RTS allows sender to resume
 #define IRQ_PRIORITY  64  // 0 = highest priority, 255 = lowest
@@ -52,79 +57,43 @@
 // changes not recommended below this point....
 ////////////////////////////////////////////////////////////////
 
-#ifdef SERIAL_9BIT_SUPPORT
-static uint8_t use9Bits = 0;
-#define BUFTYPE uint16_t
-#else
-#define BUFTYPE uint8_t
-#define use9Bits 0
+static volatile SERIAL_BUFTYPE tx_buffer[SERIAL3_TX_BUFFER_SIZE];
+static volatile SERIAL_BUFTYPE rx_buffer[SERIAL3_RX_BUFFER_SIZE];
+#ifdef HAS_SERIAL_DMA_RX
+static struct serial_dma_rx_struct rx_dma;
+static struct serial_dma_tx_struct tx_dma;
+static void tx_dma_isr(void);
 #endif
 
-static volatile BUFTYPE tx_buffer[SERIAL3_TX_BUFFER_SIZE];
-static volatile BUFTYPE rx_buffer[SERIAL3_RX_BUFFER_SIZE];
-static volatile BUFTYPE	*rx_buffer_storage_ = NULL;
-static volatile BUFTYPE	*tx_buffer_storage_ = NULL;
+static const serial_hardware_t hardware = {
+	.uart = &KINETISK_UART2,
+	.clock_gate = &SIM_SCGC4,
+	.clock_gate_mask = SIM_SCGC4_UART2,
+	.tx_buffer = tx_buffer,
+	.rx_buffer = rx_buffer,
+	.tx_buffer_size = SERIAL3_TX_BUFFER_SIZE,
+	.rx_buffer_size = SERIAL3_RX_BUFFER_SIZE,
+	.rts_low_watermark = RTS_LOW_WATERMARK,
+	.rts_high_watermark = RTS_HIGH_WATERMARK,
+	.irq = IRQ_UART2_STATUS,
+	.irq_priority = IRQ_PRIORITY,
+#ifdef HAS_SERIAL_DMA_RX
+	.dma_rx_source = DMAMUX_SOURCE_UART2_RX,
+	.dma_tx_source = DMAMUX_SOURCE_UART2_TX,
+	.rx_dma = &rx_dma,
+	.tx_dma = &tx_dma,
+	.tx_dma_isr = tx_dma_isr,
+#endif
+};
 
-static size_t tx_buffer_total_size_ = SERIAL3_TX_BUFFER_SIZE;
-static size_t rx_buffer_total_size_ = SERIAL3_RX_BUFFER_SIZE;
-static size_t rts_low_watermark_ = RTS_LOW_WATERMARK;
-static size_t rts_high_watermark_ = RTS_HIGH_WATERMARK;
+static serial_port_t port = SERIAL_PORT_INIT(hardware, SERIAL3_TX_BUFFER_SIZE,
+	SERIAL3_RX_BUFFER_SIZE, RTS_LOW_WATERMARK, RTS_HIGH_WATERMARK);
 
-static volatile uint8_t transmitting = 0;
-#if defined(KINETISK)
-  static volatile uint8_t *transmit_pin=NULL;
-  #define transmit_assert()   *transmit_pin = 1
-  #define transmit_deassert() *transmit_pin = 0
-  static volatile uint8_t *rts_pin=NULL;
-  #define rts_assert()        *rts_pin = 0
-  #define rts_deassert()      *rts_pin = 1
-#elif defined(KINETISL)
-  static volatile uint8_t *transmit_pin=NULL;
-  static uint8_t transmit_mask=0;
-  #define transmit_assert()   *(transmit_pin+4) = transmit_mask;
-  #define transmit_deassert() *(transmit_pin+8) = transmit_mask;
-  static volatile uint8_t *rts_pin=NULL;
-  static uint8_t rts_mask=0;
-  #define rts_assert()        *(rts_pin+8) = rts_mask;
-  #define rts_deassert()      *(rts_pin+4) = rts_mask;
-#endif
-#if SERIAL3_TX_BUFFER_SIZE > 65535
-static volatile uint32_t tx_buffer_head = 0;
-static volatile uint32_t tx_buffer_tail = 0;
-#elif SERIAL3_TX_BUFFER_SIZE > 255
-static volatile uint16_t tx_buffer_head = 0;
-static volatile uint16_t tx_buffer_tail = 0;
-#else
-static volatile uint8_t tx_buffer_head = 0;
-static volatile uint8_t tx_buffer_tail = 0;
-#endif
-#if SERIAL3_RX_BUFFER_SIZE > 65535
-static volatile uint32_t rx_buffer_head = 0;
-static volatile uint32_t rx_buffer_tail = 0;
-#elif SERIAL3_RX_BUFFER_SIZE > 255
-static volatile uint16_t rx_buffer_head = 0;
-static volatile uint16_t rx_buffer_tail = 0;
-#else
-static volatile uint8_t rx_buffer_head = 0;
-static volatile uint8_t rx_buffer_tail = 0;
-#endif
 #if defined(KINETISL)
 static uint8_t rx_pin_num = 7;
 #endif
 static uint8_t tx_pin_num = 8;
 
-#if defined(KINETISL)
-static uint8_t half_duplex_mode = 0;
-#endif
-
-// UART0 and UART1 are clocked by F_CPU, UART2 is clocked by F_BUS
-// UART0 has 8 byte fifo, UART1 and UART2 have 1 byte buffer
-
-#define C2_ENABLE		UART_C2_TE | UART_C2_RE | UART_C2_RIE
-#define C2_TX_ACTIVE		C2_ENABLE | UART_C2_TIE
-#define C2_TX_COMPLETING	C2_ENABLE | UART_C2_TCIE
-#define C2_TX_INACTIVE		C2_ENABLE
-
 // BITBAND Support
 #define GPIO_BITBAND_ADDR(reg, bit) (((uint32_t)&(reg) - 0x40000000) * 32 + (bit) * 4 + 0x42000000)
 #define GPIO_BITBAND_PTR(reg, bit) ((uint32_t *)GPIO_BITBAND_ADDR((reg), (bit)))
@@ -133,11 +102,6 @@ static uint8_t half_duplex_mode = 0;
 void serial3_begin(uint32_t divisor)
 {
 	SIM_SCGC4 |= SIM_SCGC4_UART2;	// turn on clock, TODO: use bitband
-	rx_buffer_head = 0;
-	rx_buffer_tail = 0;
-	tx_buffer_head = 0;
-	tx_buffer_tail = 0;
-	transmitting = 0;
 #if defined(KINETISK)
 	CORE_PIN7_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_PFE | PORT_PCR_MUX(3);
 	CORE_PIN8_CONFIG = PORT_PCR_DSE | PORT_PCR_SRE | PORT_PCR_MUX(3);
@@ -164,9 +128,7 @@ void serial3_begin(uint32_t divisor)
 	UART2_BDL = divisor & 0xFF;
 	UART2_C1 = 0;
 #endif
-	UART2_C2 = C2_TX_INACTIVE;
-	NVIC_SET_PRIORITY(IRQ_UART2_STATUS, IRQ_PRIORITY);
-	NVIC_ENABLE_IRQ(IRQ_UART2_STATUS);
+	serial_core_begin(&port);
 }
 
 void serial3_format(uint32_t format)
@@ -188,7 +150,7 @@ void serial3_format(uint32_t format)
 	c = UART2_C4 & 0x1F;
 	if (format & 0x08) c |= 0x20;		// 9 bit mode with parity (requires 10 bits)
 	UART2_C4 = c;
-	use9Bits = format & 0x80;
+	port.use9Bits = format & 0x80;
 #endif
 #if defined(__MK64FX512__) || defined(__MK66FX1M0__) || defined(KINETISL)
 	// For T3.5/T3.6/TLC See about turning on 2 stop bit mode
@@ -211,18 +173,18 @@ void serial3_format(uint32_t format)
 			case 8:  CORE_PIN8_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_PFE | PORT_PCR_MUX(3); break;
 			case 20: CORE_PIN20_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_PFE | PORT_PCR_MUX(3); break;
 		}
-		half_duplex_mode = 1; 
+		port.half_duplex_mode = 1; 
 		#else
 		volatile uint32_t *reg = portConfigRegister(tx_pin_num);
 		*reg = PORT_PCR_DSE | PORT_PCR_SRE | PORT_PCR_MUX(3) | PORT_PCR_PE | PORT_PCR_PS; // pullup on output pin;
-		transmit_pin = (uint8_t*)GPIO_BITBAND_PTR(UART2_C3, C3_TXDIR_BIT);
+		port.transmit_pin = (uint8_t*)GPIO_BITBAND_PTR(UART2_C3, C3_TXDIR_BIT);
 		#endif
 
 	} else {
 		#if defined(KINETISL)
-		half_duplex_mode = 0; 
+		port.half_duplex_mode = 0; 
 		#else
-		if (transmit_pin == (uint8_t*)GPIO_BITBAND_PTR(UART2_C3, C3_TXDIR_BIT)) transmit_pin = NULL;
+		if (port.transmit_pin == (uint8_t*)GPIO_BITBAND_PTR(UART2_C3, C3_TXDIR_BIT)) port.transmit_pin = NULL;
 		#endif
 	}
 
@@ -231,9 +193,7 @@ void serial3_format(uint32_t format)
 void serial3_end(void)
 {
 	if (!(SIM_SCGC4 & SIM_SCGC4_UART2)) return;
-	while (transmitting) yield();  // wait for buffered data to send
-	NVIC_DISABLE_IRQ(IRQ_UART2_STATUS);
-	UART2_C2 = 0;
+	serial_core_end(&port);
 	#if defined(KINETISK)
 	CORE_PIN7_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_MUX(1);
 	CORE_PIN8_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_MUX(1);
@@ -247,22 +207,11 @@ void serial3_end(void)
 		case 20: CORE_PIN20_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_MUX(1); break;
 	}
 	#endif	
-	UART2_S1;
-	UART2_D; // clear leftover error status
-	rx_buffer_head = 0;
-	rx_buffer_tail = 0;
-	if (rts_pin) rts_deassert();
 }
 
 void serial3_set_transmit_pin(uint8_t pin)
 {
-	while (transmitting) ;
-	pinMode(pin, OUTPUT);
-	digitalWrite(pin, LOW);
-	transmit_pin = portOutputRegister(pin);
-	#if defined(KINETISL)
-	transmit_mask = digitalPinToBitMask(pin);
-	#endif
+	serial_core_set_transmit_pin(&port, pin);
 }
 
 void serial3_set_tx(uint8_t pin, uint8_t opendrain)
@@ -313,28 +262,7 @@ void serial3_set_rx(uint8_t pin)
 
 int serial3_set_rts(uint8_t pin)
 {
-	if (!(SIM_SCGC4 & SIM_SCGC4_UART2)) return 0;
-	if (pin < CORE_NUM_DIGITAL) {
-		rts_pin = portOutputRegister(pin);
-		#if defined(KINETISL)
-		rts_mask = digitalPinToBitMask(pin);
-		#endif
-		pinMode(pin, OUTPUT);
-		rts_assert();
-	} else {
-		rts_pin = NULL;
-		return 0;
-	}
-/*
-	if (pin == 2) {
-		CORE_PIN2_CONFIG = PORT_PCR_MUX(3);
-	} else {
-		UART2_MODEM &= ~UART_MODEM_RXRTSE;
-		return 0;
-	}
-	UART2_MODEM |= UART_MODEM_RXRTSE;
-*/
-	return 1;
+	return serial_core_set_rts(&port, pin);
 }
 
 int serial3_set_cts(uint8_t pin)
@@ -356,218 +284,78 @@ int serial3_set_cts(uint8_t pin)
 
 void serial3_putchar(uint32_t c)
 {
-	uint32_t head, n;
-
-	if (!(SIM_SCGC4 & SIM_SCGC4_UART2)) return;
-	if (transmit_pin) transmit_assert();
-	#if defined(KINETISL)
-	if (half_duplex_mode) {
-		__disable_irq();
-		volatile uint32_t reg = UART2_C3;
-		reg |= UART_C3_TXDIR;
-		UART2_C3 = reg;
-		__enable_irq();
-	}
-	#endif 
-	head = tx_buffer_head;
-	if (++head >= tx_buffer_total_size_) head = 0;
-	while (tx_buffer_tail == head) {
-		int priority = nvic_execution_priority();
-		if (priority <= IRQ_PRIORITY) {
-			if ((UART2_S1 & UART_S1_TDRE)) {
-				uint32_t tail = tx_buffer_tail;
-				if (++tail >= tx_buffer_total_size_) tail = 0;
-				if (tail < SERIAL3_TX_BUFFER_SIZE) {
-					n = tx_buffer[tail];
-				} else {
-					n = tx_buffer_storage_[tail-SERIAL3_TX_BUFFER_SIZE];
-				}
-				if (use9Bits) UART2_C3 = (UART2_C3 & ~0x40) | ((n & 0x100) >> 2);
-				UART2_D = n;
-				tx_buffer_tail = tail;
-			}
-		} else if (priority >= 256) {
-			yield(); // wait
-		}
-	}
-	if (head < SERIAL3_TX_BUFFER_SIZE) {
-		tx_buffer[head] = c;
-	} else {
-		tx_buffer_storage_[head - SERIAL3_TX_BUFFER_SIZE] = c;
-	}
-	transmitting = 1;
-	tx_buffer_head = head;
-	UART2_C2 = C2_TX_ACTIVE;
+	serial_core_putchar(&port, c);
 }
 
 void serial3_write(const void *buf, unsigned int count)
 {
-	const uint8_t *p = (const uint8_t *)buf;
-	while (count-- > 0) serial3_putchar(*p++);
+	serial_core_write(&port, buf, count);
 }
 
 void serial3_flush(void)
 {
-	while (transmitting) yield(); // wait
+	serial_core_flush(&port);
 }
 
 int serial3_write_buffer_free(void)
 {
-	uint32_t head, tail;
-
-	head = tx_buffer_head;
-	tail = tx_buffer_tail;
-	if (head >= tail) return tx_buffer_total_size_ - 1 - head + tail;
-	return tail - head - 1;
+	return serial_core_write_buffer_free(&port);
 }
 
 int serial3_available(void)
 {
-	uint32_t head, tail;
-
-	head = rx_buffer_head;
-	tail = rx_buffer_tail;
-	if (head >= tail) return head - tail;
-	return rx_buffer_total_size_ + head - tail;
+	return serial_core_available(&port);
 }
 
 int serial3_getchar(void)
 {
-	uint32_t head, tail;
-	int c;
-
-	head = rx_buffer_head;
-	tail = rx_buffer_tail;
-	if (head == tail) return -1;
-	if (++tail >= rx_buffer_total_size_) tail = 0;
-	if (tail < SERIAL3_RX_BUFFER_SIZE) {
-		c = rx_buffer[tail];
-	} else {
-		c = rx_buffer_storage_[tail-SERIAL3_RX_BUFFER_SIZE];
-	}
-	rx_buffer_tail = tail;
-	if (rts_pin) {
-		int avail;
-		if (head >= tail) avail = head - tail;
-		else avail = rx_buffer_total_size_ + head - tail;
-		if (avail <= rts_low_watermark_) rts_assert();
-	}
-	return c;
+	return serial_core_getchar(&port);
 }
 
 int serial3_peek(void)
 {
-	uint32_t head, tail;
-
-	head = rx_buffer_head;
-	tail = rx_buffer_tail;
-	if (head == tail) return -1;
-	if (++tail >= rx_buffer_total_size_) tail = 0;
-	if (tail < SERIAL3_RX_BUFFER_SIZE) {
-		return rx_buffer[tail];
-	}
-	return rx_buffer_storage_[tail-SERIAL3_RX_BUFFER_SIZE];
+	return serial_core_peek(&port);
 }
 
 void serial3_clear(void)
 {
-	rx_buffer_head = rx_buffer_tail;
-	if (rts_pin) rts_assert();
+	serial_core_clear(&port);
 }
 
-// status interrupt combines
-//   Transmit data below watermark  UART_S1_TDRE
-//   Transmit complete		    UART_S1_TC
-//   Idle line			    UART_S1_IDLE
-//   Receive data above watermark   UART_S1_RDRF
-//   LIN break detect		    UART_S2_LBKDIF
-//   RxD pin active edge	    UART_S2_RXEDGIF
+int serial3_set_rx_dma(uint8_t enable)
+{
+	return serial_core_set_rx_dma(&port, enable);
+}
 
-void uart2_status_isr(void)
+int serial3_rx_dma_overrun(void)
 {
-	uint32_t head, tail, n;
-	uint8_t c;
+	return serial_core_rx_dma_overrun(&port);
+}
 
-	if (UART2_S1 & UART_S1_RDRF) {
-		if (use9Bits && (UART2_C3 & 0x80)) {
-			n = UART2_D | 0x100;
-		} else {
-			n = UART2_D;
-		}
-		head = rx_buffer_head + 1;
-		if (head >= rx_buffer_total_size_) head = 0;
-		if (head != rx_buffer_tail) {
-			if (head < SERIAL3_RX_BUFFER_SIZE) {
-				rx_buffer[head] = n;
-			} else {
-				rx_buffer_storage_[head-SERIAL3_RX_BUFFER_SIZE] = n;
-			}
-
-			rx_buffer_head = head;
-		}
-		if (rts_pin) {
-			int avail;
-			tail = tx_buffer_tail;
-			if (head >= tail) avail = head - tail;
-			else avail = rx_buffer_total_size_ + head - tail;
-			if (avail >= rts_high_watermark_) rts_deassert();
-		}
-	}
-	c = UART2_C2;
-	if ((c & UART_C2_TIE) && (UART2_S1 & UART_S1_TDRE)) {
-		head = tx_buffer_head;
-		tail = tx_buffer_tail;
-		if (head == tail) {
-			UART2_C2 = C2_TX_COMPLETING;
-		} else {
-			if (++tail >= tx_buffer_total_size_) tail = 0;
-			if (tail < SERIAL3_TX_BUFFER_SIZE) {
-				n = tx_buffer[tail];
-			} else {
-				n = tx_buffer_storage_[tail-SERIAL3_TX_BUFFER_SIZE];
-			}
-			if (use9Bits) UART2_C3 = (UART2_C3 & ~0x40) | ((n & 0x100) >> 2);
-			UART2_D = n;
-			tx_buffer_tail = tail;
-		}
-	}
-	if ((c & UART_C2_TCIE) && (UART2_S1 & UART_S1_TC)) {
-		transmitting = 0;
-		if (transmit_pin) transmit_deassert();
-		#if defined(KINETISL)
-		if (transmit_pin) transmit_deassert();
-		if (half_duplex_mode) {
-			__disable_irq();
-			volatile uint32_t reg = UART2_C3;
-			reg &= ~UART_C3_TXDIR;
-			UART2_C3 = reg;
-			__enable_irq();
-		}
-		#endif
-		UART2_C2 = C2_TX_INACTIVE;
-	}
+int serial3_set_tx_dma(uint8_t enable)
+{
+	return serial_core_set_tx_dma(&port, enable);
 }
 
-void serial3_add_memory_for_read(void *buffer, size_t length)
+#ifdef HAS_SERIAL_DMA_RX
+static void tx_dma_isr(void)
 {
-	rx_buffer_storage_ = (BUFTYPE*)buffer;
-	if (buffer) {
-		rx_buffer_total_size_ = SERIAL3_RX_BUFFER_SIZE + length;
-	} else {
-		rx_buffer_total_size_ = SERIAL3_RX_BUFFER_SIZE;
-	} 
+	serial_core_tx_dma_isr(&port);
+}
+#endif
+
+void uart2_status_isr(void)
+{
+	serial_core_isr(&port);
+}
 
-	rts_low_watermark_ = RTS_LOW_WATERMARK + length;
-	rts_high_watermark_ = RTS_HIGH_WATERMARK + length;
+void serial3_add_memory_for_read(void *buffer, size_t length)
+{
+	serial_core_add_memory_for_read(&port, buffer, length);
 }
 
 void serial3_add_memory_for_write(void *buffer, size_t length)
 {
-	tx_buffer_storage_ = (BUFTYPE*)buffer;
-	if (buffer) {
-		tx_buffer_total_size_ = SERIAL3_TX_BUFFER_SIZE + length;
-	} else {
-		tx_buffer_total_size_ = SERIAL3_TX_BUFFER_SIZE;
-	} 
+	serial_core_add_memory_for_write(&port, buffer, length);
 }
 
@@ -31,6 +31,7 @@
 #include "kinetis.h"
 #include "core_pins.h"
 #include "HardwareSerial.h"
+#include "serial_dma.h"
 
 #ifdef HAS_KINETISK_LPUART0
 
@@ -42,6 +43,7 @@
 #define CTRL_TXDIR_BIT 	29
 #define CTRL_TIE_BIT  	23
 #define CTRL_TCIE_BIT 	22
+#define CTRL_RIE_BIT  	21
 #define CTRL_TE_BIT		19
 #define CTRL_RE_BIT		18
 #define CTRL_LOOPS_BIT	7
@@ -57,7 +59,7 @@
 #define SERIAL6_TX_BUFFER_SIZE     40 // number of outgoing bytes to buffer
 #endif
 #ifndef SERIAL6_RX_BUFFER_SIZE
-#define SERIAL6_RX_BUFFER_SIZE     64 // number of incoming bytes to buffer
+#define SERIAL6_RX_BUFFER_SIZE    256 // number of incoming bytes to buffer
 #endif
 #define RTS_HIGH_WATERMARK (SERIAL6_RX_BUFFER_SIZE-24) // RTS requests sender to pause
 #define RTS_LOW_WATERMARK  (SERIAL6_RX_BUFFER_SIZE-38) // RTS allows sender to resume
@@ -110,6 +112,159 @@ static volatile uint8_t rx_buffer_tail = 0;
 
 static uint8_t tx_pin_num = 48;
 
+#ifdef HAS_SERIAL_DMA_RX
+static struct serial_dma_rx_struct rx_dma;
+#define rx_dma_active() (rx_dma.active)
+
+// With receive DMA, the DMA channel writes the buffer instead of the
+// interrupt, so rx_buffer_head must be updated before it is used.
+static void rx_dma_update(void)
+{
+	uint32_t head, tail, avail, n;
+
+	if (!rx_dma.active) return;
+	n = serial_dma_rx_received(&rx_dma);
+	if (n == 0) return;
+	head = rx_buffer_head;
+	tail = rx_buffer_tail;
+	if (head >= tail) avail = head - tail;
+	else avail = rx_buffer_total_size_ + head - tail;
+	head = (head + n) % rx_buffer_total_size_;
+	if (avail + n >= rx_buffer_total_size_) {
+		// the DMA lapped the reader, only the newest data remains
+		rx_dma.overrun = 1;
+		tail = (head + 1 < rx_buffer_total_size_) ? head + 1 : 0;
+		rx_buffer_tail = tail;
+	}
+	rx_buffer_head = head;
+	if (rts_pin) {
+		if (head >= tail) avail = head - tail;
+		else avail = rx_buffer_total_size_ + head - tail;
+		if (avail >= rts_high_watermark_) rts_deassert();
+	}
+}
+
+static int rx_dma_start(void)
+{
+	int r;
+
+	__disable_irq();
+	BITBAND_CLR_BIT(LPUART0_CTRL, CTRL_RE_BIT);
+	LPUART0_BAUD &= ~LPUART_BAUD_RDMAE;
+	r = serial_dma_rx_begin(&rx_dma, &LPUART0_DATA, DMAMUX_SOURCE_LPUART0_RX, rx_buffer, SERIAL6_RX_BUFFER_SIZE,
+		rx_buffer_storage_, rx_buffer_total_size_ - SERIAL6_RX_BUFFER_SIZE);
+	// DMA writes index 0 first, so the empty buffer starts at the end
+	rx_buffer_head = rx_buffer_total_size_ - 1;
+	rx_buffer_tail = rx_buffer_total_size_ - 1;
+	if (r) {
+		// LPUART has separate DMA and interrupt enables for RDRF
+		BITBAND_CLR_BIT(LPUART0_CTRL, CTRL_RIE_BIT);
+		LPUART0_BAUD |= LPUART_BAUD_RDMAE;
+	}
+	BITBAND_SET_BIT(LPUART0_CTRL, CTRL_RE_BIT);
+	__enable_irq();
+	if (rts_pin) rts_assert();
+	return r;
+}
+
+static void rx_dma_stop(void)
+{
+	if (!rx_dma.active) return;
+	__disable_irq();
+	BITBAND_CLR_BIT(LPUART0_CTRL, CTRL_RE_BIT);
+	rx_dma_update(); // keep whatever already arrived
+	serial_dma_rx_end(&rx_dma);
+	LPUART0_BAUD &= ~LPUART_BAUD_RDMAE;
+	BITBAND_SET_BIT(LPUART0_CTRL, CTRL_RIE_BIT);
+	BITBAND_SET_BIT(LPUART0_CTRL, CTRL_RE_BIT);
+	__enable_irq();
+}
+
+// LPUART0 has no transmit fifo, so without DMA every byte costs a status
+// interrupt.  Transmit DMA instead sends each contiguous piece of the
+// buffer (up to the ring's end or the end of the built-in array) with only
+// 1 interrupt per piece.
+static struct serial_dma_tx_struct tx_dma;
+#define tx_dma_active() (tx_dma.active)
+
+// Start the next piece, if the channel is idle.  Called with interrupts
+// disabled or from the DMA interrupt.
+static void tx_dma_next(void)
+{
+	uint32_t head, tail, end, len;
+	volatile BUFTYPE *p;
+
+	if (tx_dma.busy) return;
+	head = tx_buffer_head;
+	tail = tx_buffer_tail;
+	if (head == tail) {
+		// everything sent, the transmit complete interrupt finishes up
+		BITBAND_SET_BIT(LPUART0_CTRL, CTRL_TCIE_BIT);
+		return;
+	}
+	BITBAND_CLR_BIT(LPUART0_CTRL, CTRL_TCIE_BIT);
+	if (++tail >= tx_buffer_total_size_) tail = 0;
+	if (tail < SERIAL6_TX_BUFFER_SIZE) {
+		p = tx_buffer + tail;
+		end = SERIAL6_TX_BUFFER_SIZE;
+	} else {
+		p = tx_buffer_storage_ + (tail - SERIAL6_TX_BUFFER_SIZE);
+		end = tx_buffer_total_size_;
+	}
+	if (head >= tail && head < end) end = head + 1;
+	len = end - tail;
+	if (len > 32767) len = 32767;
+	serial_dma_tx_send(&tx_dma, p, len);
+}
+
+static void tx_dma_isr(void)
+{
+	uint32_t tail;
+
+	if (!serial_dma_tx_complete(&tx_dma)) return;
+	tail = tx_buffer_tail + tx_dma.len;
+	if (tail >= tx_buffer_total_size_) tail -= tx_buffer_total_size_;
+	tx_buffer_tail = tail;
+	tx_dma_next();
+}
+
+static void tx_dma_stop(void)
+{
+	uint32_t tail;
+
+	if (!tx_dma.active) return;
+	__disable_irq();
+	// the bytes of a partly sent piece must not be sent again
+	tail = tx_buffer_tail + serial_dma_tx_end(&tx_dma);
+	if (tail >= tx_buffer_total_size_) tail -= tx_buffer_total_size_;
+	tx_buffer_tail = tail;
+	LPUART0_BAUD &= ~LPUART_BAUD_TDMAE;
+	if (tx_buffer_head != tx_buffer_tail) BITBAND_SET_BIT(LPUART0_CTRL, CTRL_TIE_BIT);
+	__enable_irq();
+}
+
+static int tx_dma_start(void)
+{
+	if (!serial_dma_tx_begin(&tx_dma, &LPUART0_DATA, DMAMUX_SOURCE_LPUART0_TX,
+	  tx_dma_isr, IRQ_PRIORITY)) return 0;
+	__disable_irq();
+	// LPUART has separate DMA and interrupt enables for TDRE
+	BITBAND_CLR_BIT(LPUART0_CTRL, CTRL_TIE_BIT);
+	LPUART0_BAUD |= LPUART_BAUD_TDMAE;
+	if (transmitting) tx_dma_next();
+	__enable_irq();
+	return 1;
+}
+#else
+#define rx_dma_active() 0
+static inline void rx_dma_update(void) {}
+static inline void rx_dma_stop(void) {}
+#define tx_dma_active() 0
+static inline void tx_dma_isr(void) {}
+static inline void tx_dma_next(void) {}
+static inline void tx_dma_stop(void) {}
+#endif
+
 
 void serial6_begin(uint32_t desiredBaudRate)
 {
@@ -204,6 +359,13 @@ void serial6_begin(uint32_t desiredBaudRate)
 
 	// Enable the transmitter, receiver and enable receiver interrupt
 	LPUART0_CTRL |= LPUART_CTRL_RIE | LPUART_CTRL_TE | LPUART_CTRL_RE;
+#ifdef HAS_SERIAL_DMA_RX
+	if (rx_dma.active) rx_dma_start();
+	if (tx_dma.active) {
+		tx_dma_stop();
+		tx_dma_start();
+	}
+#endif
 	NVIC_SET_PRIORITY(IRQ_LPUART0, IRQ_PRIORITY);
 	NVIC_ENABLE_IRQ(IRQ_LPUART0);
 }
@@ -259,6 +421,8 @@ void serial6_end(void)
 	if (!(SIM_SCGC2 & SIM_SCGC2_LPUART0)) return;
 	while (transmitting) yield();  // wait for buffered data to send
 	NVIC_DISABLE_IRQ(IRQ_LPUART0);
+	rx_dma_stop();
+	tx_dma_stop();
 	LPUART0_CTRL = 0;
 	CORE_PIN47_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_MUX(1);
 	CORE_PIN48_CONFIG = PORT_PCR_PE | PORT_PCR_PS | PORT_PCR_MUX(1);
@@ -340,7 +504,9 @@ void serial6_putchar(uint32_t c)
 	while (tx_buffer_tail == head) {
 		int priority = nvic_execution_priority();
 		if (priority <= IRQ_PRIORITY) {
-			if ((LPUART0_STAT & LPUART_STAT_TDRE)) {
+			if (tx_dma_active()) {
+				tx_dma_isr(); // DMA interrupt can't run, check it here
+			} else if ((LPUART0_STAT & LPUART_STAT_TDRE)) {
 				uint32_t tail = tx_buffer_tail;
 				if (++tail >= tx_buffer_total_size_) tail = 0;
 				if (tail < SERIAL6_TX_BUFFER_SIZE) {
@@ -356,10 +522,20 @@ void serial6_putchar(uint32_t c)
 			yield(); // wait
 		}
 	}
-	tx_buffer[head] = c;
+	if (head < SERIAL6_TX_BUFFER_SIZE) {
+		tx_buffer[head] = c;
+	} else {
+		tx_buffer_storage_[head - SERIAL6_TX_BUFFER_SIZE] = c;
+	}
 	transmitting = 1;
 	tx_buffer_head = head;
 
+	if (tx_dma_active()) {
+		__disable_irq();
+		tx_dma_next();
+		__enable_irq();
+		return;
+	}
 	//LPUART0_CTRL |= LPUART_CTRL_TIE;	// enable the transmit interrupt
 	BITBAND_SET_BIT(LPUART0_CTRL, CTRL_TIE_BIT);
 
@@ -390,6 +566,7 @@ int serial6_available(void)
 {
 	uint32_t head, tail;
 
+	rx_dma_update();
 	head = rx_buffer_head;
 	tail = rx_buffer_tail;
 	if (head >= tail) return head - tail;
@@ -401,6 +578,7 @@ int serial6_getchar(void)
 	uint32_t head, tail;
 	int c;
 
+	rx_dma_update();
 	head = rx_buffer_head;
 	tail = rx_buffer_tail;
 	if (head == tail) return -1;
@@ -424,6 +602,7 @@ int serial6_peek(void)
 {
 	uint32_t head, tail;
 
+	rx_dma_update();
 	head = rx_buffer_head;
 	tail = rx_buffer_tail;
 	if (head == tail) return -1;
@@ -436,10 +615,65 @@ int serial6_peek(void)
 
 void serial6_clear(void)
 {
+	if (rx_dma_active()) {
+		rx_dma_update();
+		rx_buffer_tail = rx_buffer_head;
+	}
 	rx_buffer_head = rx_buffer_tail;
 	if (rts_pin) rts_assert();
 }
 
+// Receive using DMA rather than the status interrupt, so incoming data isn't
+// lost while other interrupts keep this one waiting.  Call after begin and
+// after adding memory for read.  Any unread data is discarded.  With DMA,
+// RTS only updates when data is checked.  Returns 0 if DMA is not available.
+int serial6_set_rx_dma(uint8_t enable)
+{
+#ifdef HAS_SERIAL_DMA_RX
+	if (!(SIM_SCGC2 & SIM_SCGC2_LPUART0)) return 0;
+	if (sizeof(BUFTYPE) != 1) return 0; // 9 bit data can't use DMA
+	if (!enable) {
+		rx_dma_stop();
+		return 1;
+	}
+	return rx_dma_start();
+#else
+	return 0;
+#endif
+}
+
+// Returns 1 if receive DMA overwrote unread data since the prior call.
+int serial6_rx_dma_overrun(void)
+{
+#ifdef HAS_SERIAL_DMA_RX
+	rx_dma_update();
+	if (!rx_dma.overrun) return 0;
+	rx_dma.overrun = 0;
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+// Transmit using DMA rather than an interrupt for every byte.  Waits for
+// any buffered data to finish first.  Returns 0 if DMA is not available.
+int serial6_set_tx_dma(uint8_t enable)
+{
+#ifdef HAS_SERIAL_DMA_RX
+	if (!(SIM_SCGC2 & SIM_SCGC2_LPUART0)) return 0;
+	if (sizeof(BUFTYPE) != 1) return 0; // 9 bit data can't use DMA
+	serial6_flush();
+	if (!enable) {
+		tx_dma_stop();
+		return 1;
+	}
+	if (tx_dma.active) return 1;
+	return tx_dma_start();
+#else
+	return 0;
+#endif
+}
+
 // status interrupt combines
 //   Transmit data below watermark  LPUART_STAT_TDRE
 //   Transmit complete		    LPUART_STAT_TC
@@ -452,7 +686,7 @@ void lpuart0_status_isr(void)
 {
 	uint32_t head, tail, n;
 	uint32_t c;
-	if (LPUART0_STAT & LPUART_STAT_RDRF) {
+	if (!rx_dma_active() && (LPUART0_STAT & LPUART_STAT_RDRF)) {
 //		if (use9Bits && (UART5_C3 & 0x80)) {
 //			n = UART5_D | 0x100;
 //		} else {
@@ -472,7 +706,7 @@ void lpuart0_status_isr(void)
 		}
 		if (rts_pin) {
 			int avail;
-			tail = tx_buffer_tail;
+			tail = rx_buffer_tail;
 			if (head >= tail) avail = head - tail;
 			else avail = rx_buffer_total_size_ + head - tail;
 			if (avail >= rts_high_watermark_) rts_deassert();
@@ -518,6 +752,9 @@ void serial6_add_memory_for_read(void *buffer, size_t length)
 
 	rts_low_watermark_ = RTS_LOW_WATERMARK + length;
 	rts_high_watermark_ = RTS_HIGH_WATERMARK + length;
+#ifdef HAS_SERIAL_DMA_RX
+	if (rx_dma.active) rx_dma_start();
+#endif
 }
 
 void serial6_add_memory_for_write(void *buffer, size_t length)
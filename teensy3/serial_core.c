@@ -0,0 +1,768 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* The main idea of this is to have two buffers: receive (rx_buffer) and transmit (tx_buffer).
+* In order to transmit, the user must write data to tx_buffer, via serialN_write() and serialN_putchar().
+New data is written to the head of the buffer (usually to the end of the array),
+while data to be sent is read from the tail into the TDR, and the tail keeps moving towards the head.
+* In order to receive, the user must read from the rx_buffer.
+New data received is read from the RDR and written to the head of the buffer.
+The user reads this data from the tail of the buffer, and moves towards the head.
+Memory added with addMemoryForRead/Write extends the arrays, so indexes past
+the built-in array are in the added storage.
+*/
+#include "kinetis.h"
+#include "core_pins.h"
+#include "serial_core.h"
+
+#if defined(KINETISK)
+#define transmit_assert(p)   *(p)->transmit_pin = 1
+#define transmit_deassert(p) *(p)->transmit_pin = 0
+#define rts_assert(p)        *(p)->rts_pin = 0
+#define rts_deassert(p)      *(p)->rts_pin = 1
+#elif defined(KINETISL)
+#define transmit_assert(p)   *((p)->transmit_pin+4) = (p)->transmit_mask
+#define transmit_deassert(p) *((p)->transmit_pin+8) = (p)->transmit_mask
+#define rts_assert(p)        *((p)->rts_pin+8) = (p)->rts_mask
+#define rts_deassert(p)      *((p)->rts_pin+4) = (p)->rts_mask
+#endif
+
+#ifdef SERIAL_9BIT_SUPPORT
+#define use9Bits(p) ((p)->use9Bits)
+#else
+#define use9Bits(p) 0
+#endif
+
+#define C2_ENABLE		(UART_C2_TE | UART_C2_RE | UART_C2_RIE)
+#define C2_TX_ACTIVE(p)		((p)->c2_enable | UART_C2_TIE)
+#define C2_TX_COMPLETING(p)	((p)->c2_enable | UART_C2_TCIE)
+#define C2_TX_INACTIVE(p)	((p)->c2_enable)  // Active but doing nothing
+
+static inline int clock_enabled(const serial_hardware_t *hw)
+{
+	return *hw->clock_gate & hw->clock_gate_mask;
+}
+
+static inline uint32_t tx_buffer_read(serial_port_t *p, uint32_t index)
+{
+	const serial_hardware_t *hw = p->hardware;
+
+	if (index < hw->tx_buffer_size) return hw->tx_buffer[index];
+	return p->tx_buffer_storage[index - hw->tx_buffer_size];
+}
+
+static inline void tx_buffer_write(serial_port_t *p, uint32_t index, uint32_t n)
+{
+	const serial_hardware_t *hw = p->hardware;
+
+	if (index < hw->tx_buffer_size) {
+		hw->tx_buffer[index] = n;
+	} else {
+		p->tx_buffer_storage[index - hw->tx_buffer_size] = n;
+	}
+}
+
+static inline uint32_t rx_buffer_read(serial_port_t *p, uint32_t index)
+{
+	const serial_hardware_t *hw = p->hardware;
+
+	if (index < hw->rx_buffer_size) return hw->rx_buffer[index];
+	return p->rx_buffer_storage[index - hw->rx_buffer_size];
+}
+
+static inline void rx_buffer_write(serial_port_t *p, uint32_t index, uint32_t n)
+{
+	const serial_hardware_t *hw = p->hardware;
+
+	if (index < hw->rx_buffer_size) {
+		hw->rx_buffer[index] = n;
+	} else {
+		p->rx_buffer_storage[index - hw->rx_buffer_size] = n;
+	}
+}
+
+static inline uint32_t rx_buffer_count(serial_port_t *p, uint32_t head, uint32_t tail)
+{
+	if (head >= tail) return head - tail;
+	return p->rx_buffer_total_size + head - tail;
+}
+
+static inline void send(KINETISK_UART_t *uart, serial_port_t *p, uint32_t n)
+{
+	if (use9Bits(p)) uart->C3 = (uart->C3 & ~0x40) | ((n & 0x100) >> 2);
+	uart->D = n;
+}
+
+static inline uint32_t receive(KINETISK_UART_t *uart, serial_port_t *p)
+{
+	if (use9Bits(p) && (uart->C3 & 0x80)) return uart->D | 0x100;
+	return uart->D;
+}
+
+
+#ifdef HAS_SERIAL_DMA_RX
+#define rx_dma_active(p) ((p)->hardware->rx_dma->active)
+
+// With receive DMA, the DMA channel writes the buffer instead of the
+// interrupt, so rx_buffer_head must be updated before it is used.
+static void rx_dma_update(serial_port_t *p)
+{
+	struct serial_dma_rx_struct *rx = p->hardware->rx_dma;
+	uint32_t head, avail, n, total;
+
+	if (!rx_dma_active(p)) return;
+	n = serial_dma_rx_received(rx);
+	if (n == 0) return;
+	total = p->rx_buffer_total_size;
+	head = p->rx_buffer_head;
+	avail = rx_buffer_count(p, head, p->rx_buffer_tail);
+	head = (head + n) % total;
+	if (avail + n >= total) {
+		// the DMA lapped the reader, only the newest data remains
+		rx->overrun = 1;
+		p->rx_buffer_tail = (head + 1 < total) ? head + 1 : 0;
+	}
+	p->rx_buffer_head = head;
+	if (p->rts_pin) {
+		if (rx_buffer_count(p, head, p->rx_buffer_tail) >= p->rts_high_watermark) {
+			rts_deassert(p);
+		}
+	}
+}
+
+static int rx_dma_start(serial_port_t *p)
+{
+	const serial_hardware_t *hw = p->hardware;
+	KINETISK_UART_t *uart = hw->uart;
+	int r;
+
+	__disable_irq();
+	uart->C2 &= ~(UART_C2_RE | UART_C2_RIE | UART_C2_ILIE);
+	uart->C5 &= ~UART_C5_RDMAS;
+	if (hw->fifo) {
+		uart->RWFIFO = 1; // each byte requests DMA, none wait in the fifo
+		uart->CFIFO = UART_CFIFO_RXFLUSH;
+	}
+	r = serial_dma_rx_begin(hw->rx_dma, &uart->D, hw->dma_rx_source,
+		hw->rx_buffer, hw->rx_buffer_size, p->rx_buffer_storage,
+		p->rx_buffer_total_size - hw->rx_buffer_size);
+	// DMA writes index 0 first, so the empty buffer starts at the end
+	p->rx_buffer_head = p->rx_buffer_total_size - 1;
+	p->rx_buffer_tail = p->rx_buffer_total_size - 1;
+	if (r) {
+		uart->C5 |= UART_C5_RDMAS;
+		// clearing IDLE requires reading data, which belongs to the DMA
+		p->c2_enable = C2_ENABLE;
+	} else if (hw->fifo) {
+		uart->RWFIFO = 4;
+	}
+	uart->C2 |= p->c2_enable & (UART_C2_RE | UART_C2_RIE | UART_C2_ILIE);
+	__enable_irq();
+	if (p->rts_pin) rts_assert(p);
+	return r;
+}
+
+static void rx_dma_stop(serial_port_t *p)
+{
+	const serial_hardware_t *hw = p->hardware;
+	KINETISK_UART_t *uart = hw->uart;
+
+	if (!rx_dma_active(p)) return;
+	__disable_irq();
+	uart->C2 &= ~(UART_C2_RE | UART_C2_RIE | UART_C2_ILIE);
+	rx_dma_update(p); // keep whatever already arrived
+	serial_dma_rx_end(hw->rx_dma);
+	uart->C5 &= ~UART_C5_RDMAS;
+	if (hw->fifo) {
+		uart->RWFIFO = 4;
+		p->c2_enable = C2_ENABLE | UART_C2_ILIE;
+	}
+	uart->C2 |= p->c2_enable & (UART_C2_RE | UART_C2_RIE | UART_C2_ILIE);
+	__enable_irq();
+}
+
+// Transmit DMA sends each contiguous piece of the buffer (up to the ring's
+// end or the end of the built-in array) with 1 interrupt per piece.  With
+// C5_TDMAS set, C2_TIE requests DMA instead of the status interrupt.
+#define tx_dma_active(p) ((p)->hardware->tx_dma && (p)->hardware->tx_dma->active)
+
+// Start the next piece, if the channel is idle.  Called with interrupts
+// disabled or from the DMA interrupt.
+static void tx_dma_next(serial_port_t *p)
+{
+	const serial_hardware_t *hw = p->hardware;
+	volatile SERIAL_BUFTYPE *buf;
+	uint32_t head, tail, end, len;
+
+	if (hw->tx_dma->busy) return;
+	head = p->tx_buffer_head;
+	tail = p->tx_buffer_tail;
+	if (head == tail) {
+		// everything sent, the transmit complete interrupt finishes up
+		hw->uart->C2 = C2_TX_COMPLETING(p);
+		return;
+	}
+	if (++tail >= p->tx_buffer_total_size) tail = 0;
+	if (tail < hw->tx_buffer_size) {
+		buf = hw->tx_buffer + tail;
+		end = hw->tx_buffer_size;
+	} else {
+		buf = p->tx_buffer_storage + (tail - hw->tx_buffer_size);
+		end = p->tx_buffer_total_size;
+	}
+	if (head >= tail && head < end) end = head + 1;
+	len = end - tail;
+	if (len > 32767) len = 32767;
+	serial_dma_tx_send(hw->tx_dma, buf, len);
+	hw->uart->C2 = C2_TX_ACTIVE(p);
+}
+
+void serial_core_tx_dma_isr(serial_port_t *p)
+{
+	struct serial_dma_tx_struct *tx = p->hardware->tx_dma;
+	uint32_t tail;
+
+	if (!serial_dma_tx_complete(tx)) return;
+	tail = p->tx_buffer_tail + tx->len;
+	if (tail >= p->tx_buffer_total_size) tail -= p->tx_buffer_total_size;
+	p->tx_buffer_tail = tail;
+	tx_dma_next(p);
+}
+
+static int tx_dma_start(serial_port_t *p)
+{
+	const serial_hardware_t *hw = p->hardware;
+	KINETISK_UART_t *uart = hw->uart;
+
+	if (!serial_dma_tx_begin(hw->tx_dma, &uart->D, hw->dma_tx_source,
+	  hw->tx_dma_isr, hw->irq_priority)) return 0;
+	__disable_irq();
+	uart->C5 |= UART_C5_TDMAS;
+	if (p->transmitting) tx_dma_next(p);
+	__enable_irq();
+	return 1;
+}
+
+static void tx_dma_stop(serial_port_t *p)
+{
+	const serial_hardware_t *hw = p->hardware;
+	KINETISK_UART_t *uart = hw->uart;
+	uint32_t tail;
+
+	if (!tx_dma_active(p)) return;
+	__disable_irq();
+	// the bytes of a partly sent piece must not be sent again
+	tail = p->tx_buffer_tail + serial_dma_tx_end(hw->tx_dma);
+	if (tail >= p->tx_buffer_total_size) tail -= p->tx_buffer_total_size;
+	p->tx_buffer_tail = tail;
+	uart->C5 &= ~UART_C5_TDMAS;
+	if (p->tx_buffer_head != tail) uart->C2 = C2_TX_ACTIVE(p);
+	__enable_irq();
+}
+#else
+#define rx_dma_active(p) 0
+static inline void rx_dma_update(serial_port_t *p) {}
+static inline void rx_dma_stop(serial_port_t *p) {}
+#define tx_dma_active(p) 0
+static inline void tx_dma_next(serial_port_t *p) {}
+static inline void tx_dma_stop(serial_port_t *p) {}
+void serial_core_tx_dma_isr(serial_port_t *p) {}
+#endif
+
+
+void serial_core_begin(serial_port_t *p)
+{
+	const serial_hardware_t *hw = p->hardware;
+#ifdef HAS_SERIAL_DMA_RX
+	int tx_dma = tx_dma_active(p);
+
+	tx_dma_stop(p); // restarted below, after the buffer is emptied
+#endif
+	p->rx_buffer_head = 0;
+	p->rx_buffer_tail = 0;
+	p->tx_buffer_head = 0;
+	p->tx_buffer_tail = 0;
+	p->transmitting = 0;
+	// only UARTs with a fifo have the idle interrupt enabled
+	p->c2_enable = hw->fifo ? C2_ENABLE | UART_C2_ILIE : C2_ENABLE;
+	hw->uart->C2 = C2_TX_INACTIVE(p);
+#ifdef HAS_SERIAL_DMA_RX
+	if (rx_dma_active(p)) rx_dma_start(p);
+	if (tx_dma) tx_dma_start(p);
+#endif
+	NVIC_SET_PRIORITY(hw->irq, hw->irq_priority);
+	NVIC_ENABLE_IRQ(hw->irq);
+}
+
+void serial_core_end(serial_port_t *p)
+{
+	const serial_hardware_t *hw = p->hardware;
+	KINETISK_UART_t *uart = hw->uart;
+
+	while (p->transmitting) yield();  // wait for buffered data to send
+	NVIC_DISABLE_IRQ(hw->irq);
+	rx_dma_stop(p);
+	tx_dma_stop(p);
+	uart->C2 = 0;
+	uart->S1;
+	uart->D; // clear leftover error status
+	p->rx_buffer_head = 0;
+	p->rx_buffer_tail = 0;
+	if (p->rts_pin) rts_deassert(p);
+}
+
+void serial_core_set_transmit_pin(serial_port_t *p, uint8_t pin)
+{
+	while (p->transmitting) ;
+	pinMode(pin, OUTPUT);
+	digitalWrite(pin, LOW);
+	p->transmit_pin = portOutputRegister(pin);
+#if defined(KINETISL)
+	p->transmit_mask = digitalPinToBitMask(pin);
+#endif
+}
+
+int serial_core_set_rts(serial_port_t *p, uint8_t pin)
+{
+	if (!clock_enabled(p->hardware)) return 0;
+	if (pin < CORE_NUM_DIGITAL) {
+		p->rts_pin = portOutputRegister(pin);
+#if defined(KINETISL)
+		p->rts_mask = digitalPinToBitMask(pin);
+#endif
+		pinMode(pin, OUTPUT);
+		rts_assert(p);
+	} else {
+		p->rts_pin = NULL;
+		return 0;
+	}
+	return 1;
+}
+
+// Called while the transmit buffer is full.  When running at or above the
+// UART's priority, its interrupt can't send, so move a byte here instead.
+static void tx_buffer_wait(serial_port_t *p)
+{
+	KINETISK_UART_t *uart = p->hardware->uart;
+	int priority = nvic_execution_priority();
+
+	if (priority <= p->hardware->irq_priority) {
+		if (tx_dma_active(p)) {
+			serial_core_tx_dma_isr(p); // DMA interrupt can't run, check it here
+		} else if ((uart->S1 & UART_S1_TDRE)) {
+			uint32_t tail = p->tx_buffer_tail;
+			if (++tail >= p->tx_buffer_total_size) tail = 0;
+			send(uart, p, tx_buffer_read(p, tail));
+			p->tx_buffer_tail = tail;
+		}
+	} else if (priority >= 256) {
+		yield();
+	}
+}
+
+static inline void tx_start(serial_port_t *p)
+{
+	if (p->transmit_pin) transmit_assert(p);
+#if defined(KINETISL)
+	if (p->half_duplex_mode) {
+		KINETISK_UART_t *uart = p->hardware->uart;
+		__disable_irq();
+		uart->C3 |= UART_C3_TXDIR;
+		__enable_irq();
+	}
+#endif
+}
+
+// Have the interrupt or DMA send what's in the buffer
+static inline void tx_begin_sending(serial_port_t *p)
+{
+	if (tx_dma_active(p)) {
+		__disable_irq();
+		tx_dma_next(p);
+		__enable_irq();
+	} else {
+		p->hardware->uart->C2 = C2_TX_ACTIVE(p);
+	}
+}
+
+void serial_core_putchar(serial_port_t *p, uint32_t c)
+{
+	uint32_t head;
+
+	if (!clock_enabled(p->hardware)) return;
+	tx_start(p);
+	head = p->tx_buffer_head;
+	if (++head >= p->tx_buffer_total_size) head = 0;
+	while (p->tx_buffer_tail == head) tx_buffer_wait(p);
+	tx_buffer_write(p, head, c);
+	p->transmitting = 1;
+	p->tx_buffer_head = head;
+	tx_begin_sending(p);
+}
+
+void serial_core_write(serial_port_t *p, const void *buf, unsigned int count)
+{
+	const uint8_t *src = (const uint8_t *)buf;
+	const uint8_t *end = src + count;
+	uint32_t head;
+
+	if (!clock_enabled(p->hardware)) return;
+	tx_start(p);
+	while (src < end) {
+		head = p->tx_buffer_head;
+		if (++head >= p->tx_buffer_total_size) head = 0;
+		if (p->tx_buffer_tail == head) {
+			tx_begin_sending(p);
+			do {
+				tx_buffer_wait(p);
+			} while (p->tx_buffer_tail == head);
+		}
+		tx_buffer_write(p, head, *src++);
+		p->transmitting = 1;
+		p->tx_buffer_head = head;
+	}
+	tx_begin_sending(p);
+}
+
+void serial_core_flush(serial_port_t *p)
+{
+	while (p->transmitting) yield(); // wait
+}
+
+int serial_core_write_buffer_free(serial_port_t *p)
+{
+	uint32_t head, tail;
+
+	head = p->tx_buffer_head;
+	tail = p->tx_buffer_tail;
+	if (head >= tail) return p->tx_buffer_total_size - 1 - head + tail;
+	return tail - head - 1;
+}
+
+int serial_core_available(serial_port_t *p)
+{
+	rx_dma_update(p);
+	return rx_buffer_count(p, p->rx_buffer_head, p->rx_buffer_tail);
+}
+
+int serial_core_getchar(serial_port_t *p)
+{
+	uint32_t head, tail;
+	int c;
+
+	rx_dma_update(p);
+	head = p->rx_buffer_head;
+	tail = p->rx_buffer_tail;
+	if (head == tail) return -1;
+	if (++tail >= p->rx_buffer_total_size) tail = 0;
+	c = rx_buffer_read(p, tail);
+	p->rx_buffer_tail = tail;
+	if (p->rts_pin) {
+		if (rx_buffer_count(p, head, tail) <= p->rts_low_watermark) rts_assert(p);
+	}
+	return c;
+}
+
+int serial_core_peek(serial_port_t *p)
+{
+	uint32_t head, tail;
+
+	rx_dma_update(p);
+	head = p->rx_buffer_head;
+	tail = p->rx_buffer_tail;
+	if (head == tail) return -1;
+	if (++tail >= p->rx_buffer_total_size) tail = 0;
+	return rx_buffer_read(p, tail);
+}
+
+void serial_core_clear(serial_port_t *p)
+{
+#if defined(KINETISK)
+	const serial_hardware_t *hw = p->hardware;
+
+	if (hw->fifo) {
+		KINETISK_UART_t *uart = hw->uart;
+		if (!clock_enabled(hw)) return;
+		uart->C2 &= ~(UART_C2_RE | UART_C2_RIE | UART_C2_ILIE);
+		uart->CFIFO = UART_CFIFO_RXFLUSH;
+		uart->C2 |= p->c2_enable & (UART_C2_RE | UART_C2_RIE | UART_C2_ILIE);
+	}
+#endif
+	if (rx_dma_active(p)) {
+		rx_dma_update(p);
+		p->rx_buffer_tail = p->rx_buffer_head;
+	}
+	p->rx_buffer_head = p->rx_buffer_tail;
+	p->rx_frame_head = p->rx_buffer_tail;
+	if (p->rts_pin) rts_assert(p);
+}
+
+void serial_core_add_memory_for_read(serial_port_t *p, void *buffer, size_t length)
+{
+	const serial_hardware_t *hw = p->hardware;
+
+	p->rx_buffer_storage = (SERIAL_BUFTYPE *)buffer;
+	if (buffer) {
+		p->rx_buffer_total_size = hw->rx_buffer_size + length;
+	} else {
+		p->rx_buffer_total_size = hw->rx_buffer_size;
+	}
+	p->rts_low_watermark = hw->rts_low_watermark + length;
+	p->rts_high_watermark = hw->rts_high_watermark + length;
+#ifdef HAS_SERIAL_DMA_RX
+	if (rx_dma_active(p)) rx_dma_start(p);
+#endif
+}
+
+void serial_core_add_memory_for_write(serial_port_t *p, void *buffer, size_t length)
+{
+	const serial_hardware_t *hw = p->hardware;
+
+	p->tx_buffer_storage = (SERIAL_BUFTYPE *)buffer;
+	if (buffer) {
+		p->tx_buffer_total_size = hw->tx_buffer_size + length;
+	} else {
+		p->tx_buffer_total_size = hw->tx_buffer_size;
+	}
+}
+
+// Call a function each time the receive line becomes idle after one or
+// more bytes arrive, with the number of bytes since the prior idle.  Only
+// UARTs with a FIFO have the idle interrupt enabled, so returns 0 when
+// frame detection is unavailable.  The function runs from the interrupt.
+int serial_core_set_frame_callback(serial_port_t *p, void (*callback)(uint32_t len))
+{
+	if (!p->hardware->fifo) return 0;
+	__disable_irq();
+	p->rx_frame_head = p->rx_buffer_head;
+	p->frame_callback = callback;
+	__enable_irq();
+	return 1;
+}
+
+// Receive using DMA rather than the status interrupt, so incoming data isn't
+// lost while other interrupts keep this one waiting.  Call after begin and
+// after adding memory for read.  Any unread data is discarded.  With DMA the
+// frame callback does not run and RTS only updates when data is checked.
+// Returns 0 if DMA is not available.
+int serial_core_set_rx_dma(serial_port_t *p, uint8_t enable)
+{
+#ifdef HAS_SERIAL_DMA_RX
+	if (!clock_enabled(p->hardware)) return 0;
+	if (sizeof(SERIAL_BUFTYPE) != 1) return 0; // 9 bit data can't use DMA
+	if (!enable) {
+		rx_dma_stop(p);
+		return 1;
+	}
+	return rx_dma_start(p);
+#else
+	return 0;
+#endif
+}
+
+// Transmit using DMA rather than the status interrupt, so sending doesn't
+// cost an interrupt per byte (or per fifo refill).  Waits for any buffered
+// data to finish first.  Returns 0 if DMA is not available, as on UART4 &
+// UART5 where receive and transmit share one DMA request.
+int serial_core_set_tx_dma(serial_port_t *p, uint8_t enable)
+{
+#ifdef HAS_SERIAL_DMA_RX
+	if (!clock_enabled(p->hardware) || !p->hardware->tx_dma) return 0;
+	if (sizeof(SERIAL_BUFTYPE) != 1) return 0; // 9 bit data can't use DMA
+	serial_core_flush(p);
+	if (!enable) {
+		tx_dma_stop(p);
+		return 1;
+	}
+	if (tx_dma_active(p)) return 1;
+	return tx_dma_start(p);
+#else
+	return 0;
+#endif
+}
+
+// Returns 1 if receive DMA overwrote unread data since the prior call.
+int serial_core_rx_dma_overrun(serial_port_t *p)
+{
+#ifdef HAS_SERIAL_DMA_RX
+	struct serial_dma_rx_struct *rx = p->hardware->rx_dma;
+
+	rx_dma_update(p);
+	if (!rx->overrun) return 0;
+	rx->overrun = 0;
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+// status interrupt combines
+//   Transmit data below watermark  UART_S1_TDRE
+//   Transmit complete		    UART_S1_TC
+//   Idle line			    UART_S1_IDLE
+//   Receive data above watermark   UART_S1_RDRF
+//   LIN break detect		    UART_S2_LBKDIF
+//   RxD pin active edge	    UART_S2_RXEDGIF
+
+#if defined(KINETISK)
+static void fifo_isr(serial_port_t *p, KINETISK_UART_t *uart)
+{
+	uint32_t head, tail, newhead, n;
+	uint8_t avail, idle, c;
+
+	if (!rx_dma_active(p) && (uart->S1 & (UART_S1_RDRF | UART_S1_IDLE))) {
+		idle = uart->S1 & UART_S1_IDLE;
+		__disable_irq();
+		avail = uart->RCFIFO;
+		if (avail == 0) {
+			// The only way to clear the IDLE interrupt flag is
+			// to read the data register.  But reading with no
+			// data causes a FIFO underrun, which causes the
+			// FIFO to return corrupted data.  If anyone from
+			// Freescale reads this, what a poor design!  There
+			// write should be a write-1-to-clear for IDLE.
+			c = uart->D;
+			// flushing the fifo recovers from the underrun,
+			// but there's a possible race condition where a
+			// new character could be received between reading
+			// RCFIFO == 0 and flushing the FIFO.  To minimize
+			// the chance, interrupts are disabled so a higher
+			// priority interrupt (hopefully) doesn't delay.
+			// TODO: change this to disabling the IDLE interrupt
+			// which won't be simple, since we already manage
+			// which transmit interrupts are enabled.
+			uart->CFIFO = UART_CFIFO_RXFLUSH;
+			__enable_irq();
+		} else {
+			__enable_irq();
+			head = p->rx_buffer_head;
+			tail = p->rx_buffer_tail;
+			do {
+				n = receive(uart, p);
+				newhead = head + 1;
+				if (newhead >= p->rx_buffer_total_size) newhead = 0;
+				if (newhead != tail) {
+					head = newhead;
+					rx_buffer_write(p, head, n);
+				}
+			} while (--avail > 0);
+			p->rx_buffer_head = head;
+			if (p->rts_pin) {
+				if (rx_buffer_count(p, head, tail) >= p->rts_high_watermark) {
+					rts_deassert(p);
+				}
+			}
+		}
+		if (idle && p->frame_callback) {
+			// line went idle, so everything since the last idle is one frame
+			head = p->rx_buffer_head;
+			tail = p->rx_frame_head;
+			if (head != tail) {
+				p->rx_frame_head = head;
+				(*p->frame_callback)(rx_buffer_count(p, head, tail));
+			}
+		}
+	}
+	c = uart->C2;
+	if (!tx_dma_active(p) && (c & UART_C2_TIE) && (uart->S1 & UART_S1_TDRE)) {
+		head = p->tx_buffer_head;
+		tail = p->tx_buffer_tail;
+		do {
+			if (tail == head) break;
+			if (++tail >= p->tx_buffer_total_size) tail = 0;
+			avail = uart->S1;
+			send(uart, p, tx_buffer_read(p, tail));
+		} while (uart->TCFIFO < 8);
+		p->tx_buffer_tail = tail;
+		if (uart->S1 & UART_S1_TDRE) uart->C2 = C2_TX_COMPLETING(p);
+	}
+}
+#endif
+
+static void nofifo_isr(serial_port_t *p, KINETISK_UART_t *uart)
+{
+	uint32_t head, tail, n;
+
+	if (!rx_dma_active(p) && (uart->S1 & UART_S1_RDRF)) {
+		n = receive(uart, p);
+		head = p->rx_buffer_head + 1;
+		if (head >= p->rx_buffer_total_size) head = 0;
+		tail = p->rx_buffer_tail;
+		if (head != tail) {
+			rx_buffer_write(p, head, n);
+			p->rx_buffer_head = head;
+			if (p->rts_pin) {
+				if (rx_buffer_count(p, head, tail) >= p->rts_high_watermark) {
+					rts_deassert(p);
+				}
+			}
+		}
+	}
+	if (!tx_dma_active(p) && (uart->C2 & UART_C2_TIE) && (uart->S1 & UART_S1_TDRE)) {
+		head = p->tx_buffer_head;
+		tail = p->tx_buffer_tail;
+		if (head == tail) {
+			uart->C2 = C2_TX_COMPLETING(p);
+		} else {
+			if (++tail >= p->tx_buffer_total_size) tail = 0;
+			send(uart, p, tx_buffer_read(p, tail));
+			p->tx_buffer_tail = tail;
+		}
+	}
+}
+
+void serial_core_isr(serial_port_t *p)
+{
+	KINETISK_UART_t *uart = p->hardware->uart;
+	uint8_t c;
+
+#if defined(KINETISK)
+	if (p->hardware->fifo) {
+		fifo_isr(p, uart);
+	} else {
+		nofifo_isr(p, uart);
+	}
+#else
+	nofifo_isr(p, uart);
+#endif
+	c = uart->C2;
+	if ((c & UART_C2_TCIE) && (uart->S1 & UART_S1_TC)) {
+		p->transmitting = 0;
+		if (p->transmit_pin) transmit_deassert(p);
+#if defined(KINETISL)
+		if (p->half_duplex_mode) {
+			__disable_irq();
+			uart->C3 &= ~UART_C3_TXDIR;
+			__enable_irq();
+		}
+#endif
+		uart->C2 = C2_TX_INACTIVE(p);
+	}
+}
@@ -0,0 +1,136 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef serial_core_h_
+#define serial_core_h_
+
+#include "kinetis.h"
+#include "serial_dma.h"
+#include <stddef.h>
+
+// Buffering and interrupt code shared by serial1.c - serial6.c.  Each port
+// describes its UART with a serial_hardware_t in flash and keeps its state
+// in a serial_port_t.  Only pin muxing, baud rate and format differ enough
+// between ports to remain in the per-port files.  Serial6 on Teensy 3.6 is
+// a LPUART, which has different registers, so it isn't handled here.
+
+#ifdef SERIAL_9BIT_SUPPORT
+#define SERIAL_BUFTYPE uint16_t
+#else
+#define SERIAL_BUFTYPE uint8_t
+#endif
+
+typedef struct {
+	KINETISK_UART_t *uart;		// also used for Teensy LC, same register offsets
+	volatile uint32_t *clock_gate;	// SIM_SCGCn register with this UART's clock
+	uint32_t clock_gate_mask;
+	volatile SERIAL_BUFTYPE *tx_buffer;
+	volatile SERIAL_BUFTYPE *rx_buffer;
+	uint32_t tx_buffer_size;
+	uint32_t rx_buffer_size;
+	uint32_t rts_low_watermark;	// before memory is added for read
+	uint32_t rts_high_watermark;
+	uint8_t irq;
+	uint8_t irq_priority;
+	uint8_t fifo;			// nonzero when the UART has 8 byte fifos
+#ifdef HAS_SERIAL_DMA_RX
+	uint8_t dma_rx_source;		// DMAMUX_SOURCE_UARTn_RX
+	uint8_t dma_tx_source;		// DMAMUX_SOURCE_UARTn_TX
+	struct serial_dma_rx_struct *rx_dma;
+	struct serial_dma_tx_struct *tx_dma;	// NULL when rx & tx share a request
+	void (*tx_dma_isr)(void);	// calls serial_core_tx_dma_isr() for this port
+#endif
+} serial_hardware_t;
+
+typedef struct {
+	const serial_hardware_t *hardware;
+	volatile SERIAL_BUFTYPE *tx_buffer_storage;
+	volatile SERIAL_BUFTYPE *rx_buffer_storage;
+	uint32_t tx_buffer_total_size;
+	uint32_t rx_buffer_total_size;
+	uint32_t rts_low_watermark;
+	uint32_t rts_high_watermark;
+	volatile uint32_t tx_buffer_head;
+	volatile uint32_t tx_buffer_tail;
+	volatile uint32_t rx_buffer_head;
+	volatile uint32_t rx_buffer_tail;
+	uint32_t rx_frame_head;
+	void (*frame_callback)(uint32_t len);
+	volatile uint8_t *transmit_pin;
+	volatile uint8_t *rts_pin;
+	volatile uint8_t transmitting;
+	uint8_t c2_enable;
+#if defined(KINETISL)
+	uint8_t transmit_mask;
+	uint8_t rts_mask;
+	uint8_t half_duplex_mode;
+#endif
+#ifdef SERIAL_9BIT_SUPPORT
+	uint8_t use9Bits;
+#endif
+} serial_port_t;
+
+#define SERIAL_PORT_INIT(hw, tx_size, rx_size, rts_low, rts_high) { \
+	.hardware = &(hw), \
+	.tx_buffer_total_size = (tx_size), \
+	.rx_buffer_total_size = (rx_size), \
+	.rts_low_watermark = (rts_low), \
+	.rts_high_watermark = (rts_high) }
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+// Call at the end of serialN_begin(), after pins, baud rate and fifos are set
+void serial_core_begin(serial_port_t *p);
+// Call at the start of serialN_end(), before the pins are released
+void serial_core_end(serial_port_t *p);
+void serial_core_set_transmit_pin(serial_port_t *p, uint8_t pin);
+int serial_core_set_rts(serial_port_t *p, uint8_t pin);
+void serial_core_putchar(serial_port_t *p, uint32_t c);
+void serial_core_write(serial_port_t *p, const void *buf, unsigned int count);
+void serial_core_flush(serial_port_t *p);
+int serial_core_write_buffer_free(serial_port_t *p);
+int serial_core_available(serial_port_t *p);
+int serial_core_getchar(serial_port_t *p);
+int serial_core_peek(serial_port_t *p);
+void serial_core_clear(serial_port_t *p);
+void serial_core_add_memory_for_read(serial_port_t *p, void *buffer, size_t length);
+void serial_core_add_memory_for_write(serial_port_t *p, void *buffer, size_t length);
+int serial_core_set_frame_callback(serial_port_t *p, void (*callback)(uint32_t len));
+int serial_core_set_rx_dma(serial_port_t *p, uint8_t enable);
+int serial_core_rx_dma_overrun(serial_port_t *p);
+int serial_core_set_tx_dma(serial_port_t *p, uint8_t enable);
+void serial_core_tx_dma_isr(serial_port_t *p);
+void serial_core_isr(serial_port_t *p);
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif
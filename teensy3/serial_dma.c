@@ -0,0 +1,294 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "serial_dma.h"
+
+#ifdef HAS_SERIAL_DMA_RX
+
+#include "core_pins.h"
+#include "DMAChannel.h"
+
+#define DMA_TCD(ch) ((serial_dma_tcd_t *)(0x40009000 + (ch) * 32))
+#define DMA_TCD_BITER_MAX 32767 // without channel linking
+
+static uint8_t channel_alloc(void)
+{
+	uint32_t ch;
+
+	__disable_irq();
+	for (ch=0; ch < DMA_NUM_CHANNELS; ch++) {
+		if (!(dma_channel_allocated_mask & (1 << ch))) {
+			dma_channel_allocated_mask |= (1 << ch);
+			__enable_irq();
+			SIM_SCGC7 |= SIM_SCGC7_DMA;
+			SIM_SCGC6 |= SIM_SCGC6_DMAMUX;
+#if DMA_NUM_CHANNELS <= 16
+			DMA_CR = DMA_CR_EMLM | DMA_CR_EDBG;
+#else
+			DMA_CR = DMA_CR_GRP1PRI | DMA_CR_EMLM | DMA_CR_EDBG;
+#endif
+			return ch;
+		}
+	}
+	__enable_irq();
+	return DMA_NUM_CHANNELS;
+}
+
+static void tcd_init(serial_dma_tcd_t *t, volatile const void *data,
+	volatile void *buf, uint32_t len)
+{
+	t->saddr = data;
+	t->soff = 0;
+	t->attr = DMA_TCD_ATTR_SSIZE(DMA_TCD_ATTR_SIZE_8BIT) | DMA_TCD_ATTR_DSIZE(DMA_TCD_ATTR_SIZE_8BIT);
+	t->nbytes = 1;
+	t->slast = 0;
+	t->daddr = buf;
+	t->doff = 1;
+	t->citer = len;
+	t->biter = len;
+}
+
+static struct serial_dma_rx_struct *rx_channel[DMA_NUM_CHANNELS];
+
+// Runs each time the DMA reaches the end of the ring.  Laps let
+// serial_dma_rx_received() tell a full buffer from an empty one.
+static void rx_lap_isr(void)
+{
+	struct serial_dma_rx_struct *rx;
+	uint32_t ipsr, ch;
+
+	__asm__ volatile("mrs %0, ipsr\n" : "=r" (ipsr)::);
+	ch = ipsr - 16 - IRQ_DMA_CH0;
+	DMA_CINT = ch;
+	rx = rx_channel[ch];
+	if (rx) rx->laps++;
+}
+
+void serial_dma_rx_end(struct serial_dma_rx_struct *rx)
+{
+	uint32_t ch;
+
+	if (!rx->active) return;
+	ch = rx->channel;
+	DMA_CERQ = ch;
+	NVIC_DISABLE_IRQ(IRQ_DMA_CH0 + ch);
+	*(&DMAMUX0_CHCFG0 + ch) = 0;
+	DMA_CINT = ch;
+	rx_channel[ch] = NULL;
+	__disable_irq();
+	dma_channel_allocated_mask &= ~(1 << ch);
+	__enable_irq();
+	rx->active = 0;
+}
+
+int serial_dma_rx_begin(struct serial_dma_rx_struct *rx, volatile const void *data,
+	uint8_t source, volatile void *buf1, uint32_t len1, volatile void *buf2, uint32_t len2)
+{
+	volatile uint8_t *mux;
+	uint32_t *src, *dst;
+	uint32_t i, ch;
+
+	if (len1 == 0 || len1 > DMA_TCD_BITER_MAX
+	  || (buf2 && (len2 == 0 || len2 > DMA_TCD_BITER_MAX))) {
+		serial_dma_rx_end(rx);
+		return 0;
+	}
+	if (rx->active) {
+		ch = rx->channel;
+		DMA_CERQ = ch;
+	} else {
+		ch = channel_alloc();
+		if (ch >= DMA_NUM_CHANNELS) return 0;
+		rx->channel = ch;
+	}
+	rx->buf1 = (volatile uint8_t *)buf1;
+	rx->len1 = len1;
+	tcd_init(&rx->tcd[0], data, buf1, len1);
+	if (buf2) {
+		// 2 pieces: each TCD loads the other when its major loop completes
+		rx->buf2 = (volatile uint8_t *)buf2;
+		rx->len2 = len2;
+		tcd_init(&rx->tcd[1], data, buf2, len2);
+		rx->tcd[0].dlastsga = (int32_t)&rx->tcd[1];
+		rx->tcd[0].csr = DMA_TCD_CSR_ESG;
+		rx->tcd[1].dlastsga = (int32_t)&rx->tcd[0];
+		rx->tcd[1].csr = DMA_TCD_CSR_ESG | DMA_TCD_CSR_INTMAJOR;
+	} else {
+		// 1 piece: wrap the destination back to the start
+		rx->buf2 = NULL;
+		rx->len2 = 0;
+		rx->tcd[0].dlastsga = -(int32_t)len1;
+		rx->tcd[0].csr = DMA_TCD_CSR_INTMAJOR;
+	}
+	mux = &DMAMUX0_CHCFG0 + ch;
+	*mux = 0;
+	DMA_CERR = ch;
+	DMA_CEEI = ch;
+	DMA_CINT = ch;
+	DMA_CDNE = ch;
+	src = (uint32_t *)&rx->tcd[0];
+	dst = (uint32_t *)DMA_TCD(ch);
+	for (i=0; i < 8; i++) *dst++ = *src++;
+	rx->laps = 0;
+	rx->received = 0;
+	rx_channel[ch] = rx;
+	_VectorsRam[ch + IRQ_DMA_CH0 + 16] = rx_lap_isr;
+	NVIC_SET_PRIORITY(IRQ_DMA_CH0 + ch, 0); // very short, and must not miss a lap
+	NVIC_ENABLE_IRQ(IRQ_DMA_CH0 + ch);
+	*mux = source | DMAMUX_ENABLE;
+	rx->active = 1;
+	DMA_SERQ = ch;
+	return 1;
+}
+
+// Offset from buf1 where the DMA will write the next byte, 0 to len1 + len2.
+// Just before the next TCD loads, daddr is the end of the piece, which is
+// full rather than empty, so the end maps to its length.
+static uint32_t rx_offset(const struct serial_dma_rx_struct *rx)
+{
+	uint32_t addr, offset;
+
+	addr = (uint32_t)DMA_TCD(rx->channel)->daddr;
+	offset = addr - (uint32_t)rx->buf1;
+	if (offset <= rx->len1) return offset;
+	offset = addr - (uint32_t)rx->buf2;
+	if (rx->buf2 && offset <= rx->len2) return rx->len1 + offset;
+	return 0; // TCD reload in progress, next write is the beginning
+}
+
+uint32_t serial_dma_rx_received(struct serial_dma_rx_struct *rx)
+{
+	uint32_t laps, offset, total, pos;
+
+	total = rx->len1 + rx->len2;
+	do {
+		laps = rx->laps;
+		offset = rx_offset(rx);
+		if (DMA_INT & (1 << rx->channel)) {
+			// wrapped, but rx_lap_isr hasn't counted it yet
+			offset = rx_offset(rx);
+			if (offset < total) offset += total;
+		}
+	} while (laps != rx->laps);
+	pos = laps * total + offset;
+	offset = pos - rx->received;
+	rx->received = pos;
+	return offset;
+}
+
+int serial_dma_tx_begin(struct serial_dma_tx_struct *tx, volatile void *data,
+	uint8_t source, void (*isr)(void), uint8_t priority)
+{
+	serial_dma_tcd_t *t;
+	uint32_t ch;
+
+	if (tx->active) return 1;
+	ch = channel_alloc();
+	if (ch >= DMA_NUM_CHANNELS) return 0;
+	tx->channel = ch;
+	tx->busy = 0;
+	tx->len = 0;
+	*(&DMAMUX0_CHCFG0 + ch) = 0;
+	DMA_CERQ = ch;
+	DMA_CERR = ch;
+	DMA_CEEI = ch;
+	DMA_CINT = ch;
+	DMA_CDNE = ch;
+	t = DMA_TCD(ch);
+	t->saddr = NULL;
+	t->soff = 1;
+	t->attr = DMA_TCD_ATTR_SSIZE(DMA_TCD_ATTR_SIZE_8BIT) | DMA_TCD_ATTR_DSIZE(DMA_TCD_ATTR_SIZE_8BIT);
+	t->nbytes = 1;
+	t->slast = 0;
+	t->daddr = data;
+	t->doff = 0;
+	t->citer = 1;
+	t->dlastsga = 0;
+	t->csr = 0;
+	t->biter = 1;
+	_VectorsRam[ch + IRQ_DMA_CH0 + 16] = isr;
+	NVIC_SET_PRIORITY(IRQ_DMA_CH0 + ch, priority);
+	NVIC_ENABLE_IRQ(IRQ_DMA_CH0 + ch);
+	*(&DMAMUX0_CHCFG0 + ch) = source | DMAMUX_ENABLE;
+	tx->active = 1;
+	return 1;
+}
+
+void serial_dma_tx_send(struct serial_dma_tx_struct *tx, volatile const void *buf, uint32_t len)
+{
+	serial_dma_tcd_t *t = DMA_TCD(tx->channel);
+
+	tx->len = len;
+	tx->busy = 1;
+	t->saddr = buf;
+	t->citer = len;
+	t->biter = len;
+	// stop requests after the last byte, so the UART waits for the next piece
+	t->csr = DMA_TCD_CSR_INTMAJOR | DMA_TCD_CSR_DREQ;
+	DMA_SERQ = tx->channel;
+}
+
+int serial_dma_tx_complete(struct serial_dma_tx_struct *tx)
+{
+	if (!tx->busy) return 0;
+	if (!(DMA_TCD(tx->channel)->csr & DMA_TCD_CSR_DONE)) return 0;
+	DMA_CINT = tx->channel;
+	DMA_CDNE = tx->channel;
+	tx->busy = 0;
+	return 1;
+}
+
+uint32_t serial_dma_tx_end(struct serial_dma_tx_struct *tx)
+{
+	serial_dma_tcd_t *t;
+	uint32_t ch, sent = 0;
+
+	if (!tx->active) return 0;
+	ch = tx->channel;
+	t = DMA_TCD(ch);
+	DMA_CERQ = ch;
+	// a byte already requested is still written after ERQ is cleared
+	while (t->csr & DMA_TCD_CSR_ACTIVE) ;
+	if (tx->busy) {
+		sent = (t->csr & DMA_TCD_CSR_DONE) ? tx->len : tx->len - (t->citer & 0x7FFF);
+	}
+	NVIC_DISABLE_IRQ(IRQ_DMA_CH0 + ch);
+	*(&DMAMUX0_CHCFG0 + ch) = 0;
+	DMA_CINT = ch;
+	DMA_CDNE = ch;
+	__disable_irq();
+	dma_channel_allocated_mask &= ~(1 << ch);
+	__enable_irq();
+	tx->busy = 0;
+	tx->active = 0;
+	return sent;
+}
+
+#endif // HAS_SERIAL_DMA_RX
@@ -0,0 +1,118 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef serial_dma_h_
+#define serial_dma_h_
+
+#include "kinetis.h"
+
+// Receive DMA shared by serial1.c - serial6.c.  The DMA channel copies each
+// incoming byte into the existing receive buffer, so nothing is lost when
+// higher priority interrupts keep the UART status interrupt waiting.  The
+// buffer may be 2 pieces (the built-in array plus memory added with
+// addMemoryForRead), which scatter/gather joins into a single ring.
+// Transmit DMA is used by serial_core.c for UART0-3 and by serial6_lpuart.c.
+// UART4 and UART5 have one request for both directions, so can't use both.
+
+#if defined(KINETISK)
+#define HAS_SERIAL_DMA_RX
+
+// Scatter/gather requires TCDs aligned to 32 bytes
+typedef struct __attribute__((aligned(32))) {
+	volatile const void * volatile saddr;
+	int16_t soff;
+	uint16_t attr;
+	uint32_t nbytes;
+	int32_t slast;
+	volatile void * volatile daddr;
+	int16_t doff;
+	volatile uint16_t citer;
+	int32_t dlastsga;
+	volatile uint16_t csr;
+	volatile uint16_t biter;
+} serial_dma_tcd_t;
+
+struct serial_dma_rx_struct {
+	serial_dma_tcd_t tcd[2];
+	volatile uint8_t *buf1;
+	volatile uint8_t *buf2;
+	uint32_t len1;
+	uint32_t len2;
+	volatile uint32_t laps;		// times the DMA wrapped back to buf1
+	uint32_t received;		// position at the prior serial_dma_rx_received()
+	uint8_t channel;
+	uint8_t active;
+	volatile uint8_t overrun;	// set by the driver when unread data was overwritten
+};
+
+// Transmit DMA sends one contiguous piece of the transmit buffer at a
+// time.  The channel's interrupt runs when a piece is finished, so the
+// driver can advance its tail and send the next piece.
+struct serial_dma_tx_struct {
+	uint32_t len;
+	uint8_t channel;
+	uint8_t active;
+	volatile uint8_t busy;
+};
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+// Start (or restart) receiving from a data register into buf1 & buf2, with
+// the next byte written to index 0.  buf2 may be NULL.  Returns 0 if no DMA
+// channel is free or a piece is larger than one major loop allows.
+int serial_dma_rx_begin(struct serial_dma_rx_struct *rx, volatile const void *data,
+	uint8_t source, volatile void *buf1, uint32_t len1, volatile void *buf2, uint32_t len2);
+// Number of bytes the DMA wrote since the prior call (or since begin).  A
+// lap interrupt counts each wrap, so a result of len1 + len2 or more means
+// unread data was overwritten.  Laps are lost only if the interrupt waits
+// longer than the whole buffer takes to fill.
+uint32_t serial_dma_rx_received(struct serial_dma_rx_struct *rx);
+// Stop the DMA and release the channel
+void serial_dma_rx_end(struct serial_dma_rx_struct *rx);
+// Allocate a channel which writes to a data register, with isr called at
+// the given priority when each piece completes.  Returns 0 if no channel
+// is free.
+int serial_dma_tx_begin(struct serial_dma_tx_struct *tx, volatile void *data,
+	uint8_t source, void (*isr)(void), uint8_t priority);
+// Send len bytes (up to 32767) from buf.  The channel must not be busy.
+void serial_dma_tx_send(struct serial_dma_tx_struct *tx, volatile const void *buf, uint32_t len);
+// Returns 1 (and clears busy) if the piece being sent is finished.  Call
+// from the interrupt, or to poll when the interrupt can't run.
+int serial_dma_tx_complete(struct serial_dma_tx_struct *tx);
+// Stop the DMA and release the channel, after any byte in progress is
+// written.  Returns how many bytes of the current piece were sent.
+uint32_t serial_dma_tx_end(struct serial_dma_tx_struct *tx);
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // KINETISK
+#endif
@@ -77,6 +77,30 @@ static const uint8_t pin2tsi[] = {
 // time to measure 33 pF is approx 0.25 ms
 // time to measure 1000 pF is approx 4.5 ms
 
+// Background scanning measures a list of pins continuously, using the
+// TSI end of scan interrupt, so loop() never waits for a measurement.
+// The original TSI (Teensy 3.0-3.2) measures all the pins in one hardware
+// scan.  TSI lite (Teensy LC & 3.6) measures one channel per scan, so the
+// interrupt starts each pin in turn.
+static volatile uint16_t scan_value[16];
+static uint16_t scan_mask = 0;
+static void (*scan_callback)(void) = NULL;
+#if defined(HAS_KINETIS_TSI_LITE)
+static uint8_t scan_list[16];
+static uint8_t scan_count;
+static uint8_t scan_index;
+#endif
+
+#if defined(HAS_KINETIS_TSI)
+#define SCAN_GENCS (TSI_GENCS_NSCN(NSCAN) | TSI_GENCS_PS(PRESCALE) | TSI_GENCS_TSIEN \
+	| TSI_GENCS_TSIIE | TSI_GENCS_ESOR)
+#define SCAN_FLAGS (TSI_GENCS_EOSF | TSI_GENCS_OUTRGF | TSI_GENCS_EXTERF | TSI_GENCS_OVRF)
+#elif defined(HAS_KINETIS_TSI_LITE)
+#define SCAN_GENCS (TSI_GENCS_REFCHRG(4) | TSI_GENCS_EXTCHRG(3) | TSI_GENCS_PS(PRESCALE) \
+	| TSI_GENCS_NSCN(NSCAN) | TSI_GENCS_TSIEN | TSI_GENCS_TSIIEN | TSI_GENCS_ESOR)
+#define SCAN_FLAGS (TSI_GENCS_EOSF | TSI_GENCS_OUTRGF)
+#endif
+
 int touchRead(uint8_t pin)
 {
 	uint32_t ch;
@@ -84,6 +108,8 @@ int touchRead(uint8_t pin)
 	if (pin >= NUM_DIGITAL_PINS) return 0;
 	ch = pin2tsi[pin];
 	if (ch == 255) return 0;
+	// while scanning in the background, the TSI belongs to the scan
+	if (scan_mask) return (scan_mask & (1 << ch)) ? scan_value[ch] : 0;
 
 	*portConfigRegister(pin) = PORT_PCR_MUX(0);
 	SIM_SCGC5 |= SIM_SCGC5_TSI;
@@ -107,6 +133,107 @@ int touchRead(uint8_t pin)
 #endif
 }
 
+// Start measuring the pins continuously in the background.  Returns 0 if
+// none of the pins support touch sensing.  Pins without touch sensing are
+// ignored.  touchRead() and touchScanRead() then return the most recent
+// measurement, without waiting.
+int touchScanBegin(const uint8_t *pins, uint8_t count)
+{
+	uint32_t i, ch, mask=0;
+
+	touchScanEnd();
+	for (i=0; i < count; i++) {
+		if (pins[i] >= NUM_DIGITAL_PINS) continue;
+		ch = pin2tsi[pins[i]];
+		if (ch == 255 || (mask & (1 << ch))) continue;
+		*portConfigRegister(pins[i]) = PORT_PCR_MUX(0);
+		scan_value[ch] = 0;
+#if defined(HAS_KINETIS_TSI_LITE)
+		scan_list[scan_count++] = ch;
+#endif
+		mask |= (1 << ch);
+	}
+	if (!mask) return 0;
+	SIM_SCGC5 |= SIM_SCGC5_TSI;
+	scan_mask = mask;
+#if defined(HAS_KINETIS_TSI)
+	TSI0_GENCS = 0;
+	TSI0_PEN = mask;
+	TSI0_SCANC = TSI_SCANC_REFCHRG(3) | TSI_SCANC_EXTCHRG(CURRENT);
+	TSI0_GENCS = SCAN_GENCS | SCAN_FLAGS;
+	NVIC_ENABLE_IRQ(IRQ_TSI);
+	TSI0_GENCS = SCAN_GENCS | TSI_GENCS_SWTS;
+#elif defined(HAS_KINETIS_TSI_LITE)
+	scan_index = 0;
+	TSI0_GENCS = SCAN_GENCS | SCAN_FLAGS;
+	NVIC_ENABLE_IRQ(IRQ_TSI);
+	TSI0_DATA = TSI_DATA_TSICH(scan_list[0]) | TSI_DATA_SWTS;
+#endif
+	return 1;
+}
+
+// Stop background scanning.  touchRead() measures each pin again.
+void touchScanEnd(void)
+{
+	if (scan_mask) {
+		NVIC_DISABLE_IRQ(IRQ_TSI);
+		while (TSI0_GENCS & TSI_GENCS_SCNIP) ; // wait
+		TSI0_GENCS = SCAN_FLAGS;
+		NVIC_CLEAR_PENDING(IRQ_TSI);
+		scan_mask = 0;
+	}
+#if defined(HAS_KINETIS_TSI_LITE)
+	scan_count = 0;
+#endif
+}
+
+// Most recent background measurement of a pin, or 0 if not scanned
+int touchScanRead(uint8_t pin)
+{
+	uint32_t ch;
+
+	if (pin >= NUM_DIGITAL_PINS) return 0;
+	ch = pin2tsi[pin];
+	if (ch == 255 || !(scan_mask & (1 << ch))) return 0;
+	return scan_value[ch];
+}
+
+// Call a function each time all the pins have been measured.  The
+// function runs from the TSI interrupt.
+void touchScanCallback(void (*function)(void))
+{
+	__disable_irq();
+	scan_callback = function;
+	__enable_irq();
+}
+
+void tsi0_isr(void)
+{
+#if defined(HAS_KINETIS_TSI)
+	uint32_t ch, mask;
+
+	TSI0_GENCS = SCAN_GENCS | SCAN_FLAGS;
+	mask = scan_mask;
+	for (ch=0; ch < 16; ch++) {
+		if (mask & (1 << ch)) scan_value[ch] = *((volatile uint16_t *)(&TSI0_CNTR1) + ch);
+	}
+	if (scan_callback) (*scan_callback)();
+	if (scan_mask) TSI0_GENCS = SCAN_GENCS | TSI_GENCS_SWTS;
+#elif defined(HAS_KINETIS_TSI_LITE)
+	uint32_t i;
+
+	scan_value[scan_list[scan_index]] = TSI0_DATA & 0xFFFF;
+	TSI0_GENCS = SCAN_GENCS | SCAN_FLAGS;
+	i = scan_index + 1;
+	if (i >= scan_count) {
+		i = 0;
+		if (scan_callback) (*scan_callback)();
+	}
+	scan_index = i;
+	if (scan_mask) TSI0_DATA = TSI_DATA_TSICH(scan_list[i]) | TSI_DATA_SWTS;
+#endif
+}
+
 #else
 
 int touchRead(uint8_t pin)
@@ -114,6 +241,24 @@ int touchRead(uint8_t pin)
         return 0; // no Touch sensing :(
 }
 
+int touchScanBegin(const uint8_t *pins, uint8_t count)
+{
+	return 0;
+}
+
+void touchScanEnd(void)
+{
+}
+
+int touchScanRead(uint8_t pin)
+{
+	return 0;
+}
+
+void touchScanCallback(void (*function)(void))
+{
+}
+
 #endif
 
 
@@ -54,7 +54,10 @@ uint16_t usb_audio_receive_buffer[AUDIO_RX_SIZE/2] DMABUFATTR;
 uint32_t usb_audio_sync_feedback DMABUFATTR;
 uint8_t usb_audio_receive_setting=0;
 
+// Feedback in 10.14 samples per frame, scaled by 256
 static uint32_t feedback_accumulator = 185042824;
+static int32_t feedback_remainder;	// integral term not yet added
+static int32_t feedback_fill;		// average received samples, 24.8
 
 void AudioInputUSB::begin(void)
 {
@@ -70,24 +73,55 @@ void AudioInputUSB::begin(void)
 	// but also because the PC may stop transmitting data, which
 	// means we no longer get receive callbacks from usb_dev.
 	update_responsibility = false;
+	feedback_remainder = 0;
+	feedback_fill = AUDIO_INPUT_USB_TARGET << 8;
 	usb_audio_sync_feedback = feedback_accumulator >> 8;
 }
 
+// Cortex-M4 halfword pack instructions, which move 2 samples at once
+#if defined(KINETISK)
+static inline uint32_t pack_16b_16b(uint32_t a, uint32_t b) __attribute__((always_inline, unused));
+static inline uint32_t pack_16b_16b(uint32_t a, uint32_t b)
+{
+	// bottom half of a, bottom half of b in the top
+	uint32_t out;
+	asm volatile("pkhbt %0, %1, %2, lsl #16" : "=r" (out) : "r" (a), "r" (b));
+	return out;
+}
+static inline uint32_t pack_16t_16t(uint32_t a, uint32_t b) __attribute__((always_inline, unused));
+static inline uint32_t pack_16t_16t(uint32_t a, uint32_t b)
+{
+	// top half of a, top half of b in the bottom
+	uint32_t out;
+	asm volatile("pkhtb %0, %1, %2, asr #16" : "=r" (out) : "r" (a), "r" (b));
+	return out;
+}
+#else
+static inline uint32_t pack_16b_16b(uint32_t a, uint32_t b)
+{
+	return (a & 0xFFFF) | (b << 16);
+}
+static inline uint32_t pack_16t_16t(uint32_t a, uint32_t b)
+{
+	return (a & 0xFFFF0000) | (b >> 16);
+}
+#endif
+
 static void copy_to_buffers(const uint32_t *src, int16_t *left, int16_t *right, unsigned int len)
 {
-	uint32_t *target = (uint32_t*) src + len; 
+	const uint32_t *target = src + len;
 	while ((src < target) && (((uintptr_t) left & 0x02) != 0)) {
 		uint32_t n = *src++;
 		*left++ = n & 0xFFFF;
 		*right++ = n >> 16;
 	}
 
-	while ((src < target - 2)) {
+	while (src + 1 < target) {
 		uint32_t n1 = *src++;
-		uint32_t n = *src++;
-		*(uint32_t *)left = (n1 & 0xFFFF) | ((n & 0xFFFF) << 16);
+		uint32_t n2 = *src++;
+		*(uint32_t *)left = pack_16b_16b(n1, n2);
 		left+=2;
-		*(uint32_t *)right = (n1 >> 16) | ((n & 0xFFFF0000)) ;
+		*(uint32_t *)right = pack_16t_16t(n2, n1);
 		right+=2;
 	}
 
@@ -187,9 +221,17 @@ void AudioInputUSB::update(void)
 	receive_flag = 0;
 	__enable_irq();
 	if (f) {
-		int diff = AUDIO_BLOCK_SAMPLES/2 - (int)c;
-		feedback_accumulator += diff / 3;
-		uint32_t feedback = (feedback_accumulator >> 8) + diff * 100;
+		int diff = AUDIO_INPUT_USB_TARGET - (int)c;
+		// integral term, keeping the remainder so errors of 1 or 2
+		// samples still move the rate, rather than being lost
+		feedback_remainder += diff;
+		feedback_accumulator += feedback_remainder / 3;
+		feedback_remainder %= 3;
+		// proportional term, from the average fill rather than a
+		// single reading, which jitters with USB packet timing
+		feedback_fill += (((int32_t)c << 8) - feedback_fill) >> 2;
+		int32_t error = (AUDIO_INPUT_USB_TARGET << 8) - feedback_fill;
+		uint32_t feedback = (feedback_accumulator >> 8) + ((error * 100) >> 8);
 #ifdef MACOSX_ADAPTIVE_LIMIT
 		if (feedback > 722698) feedback = 722698;
 #endif
@@ -223,10 +265,9 @@ void AudioInputUSB::update(void)
 
 
 bool AudioOutputUSB::update_responsibility;
-audio_block_t * AudioOutputUSB::left_1st;
-audio_block_t * AudioOutputUSB::left_2nd;
-audio_block_t * AudioOutputUSB::right_1st;
-audio_block_t * AudioOutputUSB::right_2nd;
+audio_block_t * AudioOutputUSB::left_queue[AUDIO_OUTPUT_USB_QUEUE];
+audio_block_t * AudioOutputUSB::right_queue[AUDIO_OUTPUT_USB_QUEUE];
+uint8_t AudioOutputUSB::queue_count;
 uint16_t AudioOutputUSB::offset_1st;
 
 
@@ -236,16 +277,37 @@ uint8_t usb_audio_transmit_setting=0;
 void AudioOutputUSB::begin(void)
 {
 	update_responsibility = false;
-	left_1st = NULL;
-	right_1st = NULL;
+	queue_count = 0;
+	offset_1st = 0;
 }
 
 static void copy_from_buffers(uint32_t *dst, int16_t *left, int16_t *right, unsigned int len)
 {
-	// TODO: optimize...
-	while (len > 0) {
+	uint32_t *target = dst + len;
+	while ((dst < target) && (((uintptr_t) left & 0x02) != 0)) {
 		*dst++ = (*right++ << 16) | (*left++ & 0xFFFF);
-		len--;
+	}
+
+	while (dst + 1 < target) {
+		uint32_t l = *(uint32_t *)left;
+		uint32_t r = *(uint32_t *)right;
+		left+=2;
+		right+=2;
+		*dst++ = pack_16b_16b(l, r);
+		*dst++ = pack_16t_16t(r, l);
+	}
+
+	while (dst < target) {
+		*dst++ = (*right++ << 16) | (*left++ & 0xFFFF);
+	}
+}
+
+// remove the oldest blocks from the queue, with interrupts disabled
+static void output_queue_shift(audio_block_t **left, audio_block_t **right, uint8_t count)
+{
+	for (int i=1; i < count; i++) {
+		left[i-1] = left[i];
+		right[i-1] = right[i];
 	}
 }
 
@@ -261,11 +323,15 @@ void AudioOutputUSB::update(void)
 	if (usb_audio_transmit_setting == 0) {
 		if (left) release(left);
 		if (right) release(right);
-		if (left_1st) { release(left_1st); left_1st = NULL; }
-		if (left_2nd) { release(left_2nd); left_2nd = NULL; }
-		if (right_1st) { release(right_1st); right_1st = NULL; }
-		if (right_2nd) { release(right_2nd); right_2nd = NULL; }
+		__disable_irq();
+		uint8_t count = queue_count;
+		queue_count = 0;
 		offset_1st = 0;
+		__enable_irq();
+		for (int i=0; i < count; i++) {
+			release(left_queue[i]);
+			release(right_queue[i]);
+		}
 		return;
 	}
 	if (left == NULL) {
@@ -285,21 +351,18 @@ void AudioOutputUSB::update(void)
 		memset(right->data, 0, sizeof(right->data));
 	}
 	__disable_irq();
-	if (left_1st == NULL) {
-		left_1st = left;
-		right_1st = right;
-		offset_1st = 0;
-	} else if (left_2nd == NULL) {
-		left_2nd = left;
-		right_2nd = right;
+	if (queue_count < AUDIO_OUTPUT_USB_QUEUE) {
+		if (queue_count == 0) offset_1st = 0;
+		left_queue[queue_count] = left;
+		right_queue[queue_count] = right;
+		queue_count++;
 	} else {
 		// buffer overrun - PC is consuming too slowly
-		audio_block_t *discard1 = left_1st;
-		left_1st = left_2nd;
-		left_2nd = left;
-		audio_block_t *discard2 = right_1st;
-		right_1st = right_2nd;
-		right_2nd = right;
+		audio_block_t *discard1 = left_queue[0];
+		audio_block_t *discard2 = right_queue[0];
+		output_queue_shift(left_queue, right_queue, queue_count);
+		left_queue[queue_count - 1] = left;
+		right_queue[queue_count - 1] = right;
 		offset_1st = 0; // TODO: discard part of this data?
 		//serial_print("*");
 		release(discard1);
@@ -313,28 +376,30 @@ void AudioOutputUSB::update(void)
 // isochronous packet.  If we place data into the transmit buffer,
 // the return is the number of bytes.  Otherwise, return 0 means
 // no data to transmit
+// AUDIO_SAMPLE_RATE_EXACT samples per 1000 USB frames, 16.16 fixed point,
+// so the long term rate sent matches the audio library's clock exactly
+#define TX_SAMPLES_PER_FRAME	((uint32_t)(AUDIO_SAMPLE_RATE_EXACT / 1000.0 * 65536.0 + 0.5))
+
 unsigned int usb_audio_transmit_callback(void)
 {
-	static uint32_t count=5;
+	static uint32_t phase=0;
 	uint32_t avail, num, target, offset, len=0;
 	audio_block_t *left, *right;
 
-	if (++count < 9) {   // TODO: dynamic adjust to match USB rate
-		target = 44;
-	} else {
-		count = 0;
-		target = 45;
-	}
+	phase += TX_SAMPLES_PER_FRAME;
+	target = phase >> 16;
+	phase &= 0xFFFF;
+	if (target > AUDIO_TX_SIZE / 4) target = AUDIO_TX_SIZE / 4;
 	while (len < target) {
 		num = target - len;
-		left = AudioOutputUSB::left_1st;
-		if (left == NULL) {
+		if (AudioOutputUSB::queue_count == 0) {
 			// buffer underrun - PC is consuming too quickly
-			memset(usb_audio_transmit_buffer + len, 0, num * 4);
+			memset((uint32_t *)usb_audio_transmit_buffer + len, 0, num * 4);
 			//serial_print("%");
 			break;
 		}
-		right = AudioOutputUSB::right_1st;
+		left = AudioOutputUSB::left_queue[0];
+		right = AudioOutputUSB::right_queue[0];
 		offset = AudioOutputUSB::offset_1st;
 
 		avail = AUDIO_BLOCK_SAMPLES - offset;
@@ -347,10 +412,9 @@ unsigned int usb_audio_transmit_callback(void)
 		if (offset >= AUDIO_BLOCK_SAMPLES) {
 			AudioStream::release(left);
 			AudioStream::release(right);
-			AudioOutputUSB::left_1st = AudioOutputUSB::left_2nd;
-			AudioOutputUSB::left_2nd = NULL;
-			AudioOutputUSB::right_1st = AudioOutputUSB::right_2nd;
-			AudioOutputUSB::right_2nd = NULL;
+			output_queue_shift(AudioOutputUSB::left_queue, AudioOutputUSB::right_queue,
+				AudioOutputUSB::queue_count);
+			AudioOutputUSB::queue_count--;
 			AudioOutputUSB::offset_1st = 0;
 		} else {
 			AudioOutputUSB::offset_1st = offset;
@@ -61,6 +61,18 @@ struct usb_audio_features_struct {
 
 #include "AudioStream.h"
 
+// Samples AudioInputUSB's feedback aims to have received when update()
+// runs.  Lower gives less latency, higher tolerates more USB jitter.
+#ifndef AUDIO_INPUT_USB_TARGET
+#define AUDIO_INPUT_USB_TARGET	(AUDIO_BLOCK_SAMPLES / 2)
+#endif
+
+// Blocks AudioOutputUSB queues for the PC.  More tolerates longer gaps
+// between update() calls, at the cost of latency.
+#ifndef AUDIO_OUTPUT_USB_QUEUE
+#define AUDIO_OUTPUT_USB_QUEUE	2
+#endif
+
 class AudioInputUSB : public AudioStream
 {
 public:
@@ -94,10 +106,9 @@ public:
 	friend unsigned int usb_audio_transmit_callback(void);
 private:
 	static bool update_responsibility;
-	static audio_block_t *left_1st;
-	static audio_block_t *left_2nd;
-	static audio_block_t *right_1st;
-	static audio_block_t *right_2nd;
+	static audio_block_t *left_queue[AUDIO_OUTPUT_USB_QUEUE];
+	static audio_block_t *right_queue[AUDIO_OUTPUT_USB_QUEUE];
+	static uint8_t queue_count;
 	static uint16_t offset_1st;
 	audio_block_t *inputQueueArray[2];
 };
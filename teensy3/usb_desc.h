@@ -78,7 +78,8 @@ interfaces, usually these other settings should not be changed.
 Edit NUM_ENDPOINTS to be at least the largest endpoint number used.
 
 Edit NUM_USB_BUFFERS to control how much memory the USB stack will
-allocate.  At least 2 should be used for each endpoint.  More
+allocate (doubled on Teensy 3.5 & 3.6, see USB_PACKET_BUFFERS below).
+At least 2 should be used for each endpoint.  More
 memory will allow higher throughput for user programs that have
 high latency (eg, spending time doing things other than interacting
 with the USB).
@@ -948,6 +949,32 @@ let me know?  http://forum.pjrc.com/forums/4-Suggestions-amp-Bug-Reports
 
 #endif
 
+// Teensy 3.5 and 3.6 have plenty of RAM, so they get twice NUM_USB_BUFFERS,
+// which keeps bulk transfers on several interfaces at once from running out
+// of packets.  Define USB_BUFFERS_OVERRIDE to choose the number for any
+// board and USB type.  The packet pool has no limit other than RAM.
+#if defined(NUM_USB_BUFFERS)
+#if defined(USB_BUFFERS_OVERRIDE)
+  #define USB_PACKET_BUFFERS	USB_BUFFERS_OVERRIDE
+#elif defined(__MK64FX512__) || defined(__MK66FX1M0__)
+  #define USB_PACKET_BUFFERS	(NUM_USB_BUFFERS * 2)
+#else
+  #define USB_PACKET_BUFFERS	NUM_USB_BUFFERS
+#endif
+
+// Each receive endpoint may queue at most USB_RX_QUEUE_MAX packets which
+// the program has not yet read, so data flooding one endpoint can not use
+// all the packets other interfaces need.  Transmit endpoints are already
+// limited by each interface's TX_PACKET_LIMIT.  USB_RX_RESERVE packets are
+// kept for receive endpoints, so transmitting can not take the last ones.
+#ifndef USB_RX_QUEUE_MAX
+  #define USB_RX_QUEUE_MAX	(USB_PACKET_BUFFERS / 2)
+#endif
+#ifndef USB_RX_RESERVE
+  #define USB_RX_RESERVE	2
+#endif
+#endif
+
 #ifdef USB_DESC_LIST_DEFINE
 #if defined(NUM_ENDPOINTS) && NUM_ENDPOINTS > 0
 // NUM_ENDPOINTS = number of non-zero endpoints (0 to 15)
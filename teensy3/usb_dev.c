@@ -72,6 +72,8 @@ static usb_packet_t *rx_last[NUM_ENDPOINTS];
 static usb_packet_t *tx_first[NUM_ENDPOINTS];
 static usb_packet_t *tx_last[NUM_ENDPOINTS];
 uint16_t usb_rx_byte_count_data[NUM_ENDPOINTS];
+static uint16_t rx_count[NUM_ENDPOINTS];	// packets queued in rx_first
+static uint8_t rx_paused[NUM_ENDPOINTS];	// bit 0 = even, 1 = odd BDT idle at USB_RX_QUEUE_MAX
 
 static uint8_t tx_state[NUM_ENDPOINTS];
 #define TX_STATE_BOTH_FREE_EVEN_FIRST	0
@@ -219,6 +221,8 @@ static void usb_setup(void)
 			tx_first[i] = NULL;
 			tx_last[i] = NULL;
 			usb_rx_byte_count_data[i] = 0;
+			rx_count[i] = 0;
+			rx_paused[i] = 0;
 			switch (tx_state[i]) {
 			  case TX_STATE_EVEN_FREE:
 			  case TX_STATE_NONE_FREE_EVEN_FIRST:
@@ -247,7 +251,7 @@ static void usb_setup(void)
 #endif
 			if (epconf & USB_ENDPT_EPRXEN) {
 				usb_packet_t *p;
-				p = usb_malloc();
+				p = usb_malloc_rx();
 				if (p) {
 					table[index(i, RX, EVEN)].addr = p->buf;
 					table[index(i, RX, EVEN)].desc = BDT_DESC(64, 0);
@@ -255,7 +259,7 @@ static void usb_setup(void)
 					table[index(i, RX, EVEN)].desc = 0;
 					usb_rx_memory_needed++;
 				}
-				p = usb_malloc();
+				p = usb_malloc_rx();
 				if (p) {
 					table[index(i, RX, ODD)].addr = p->buf;
 					table[index(i, RX, ODD)].desc = BDT_DESC(64, 1);
@@ -722,6 +726,23 @@ usb_packet_t *usb_rx(uint32_t endpoint)
 	if (ret) {
 		rx_first[endpoint] = ret->next;
 		usb_rx_byte_count_data[endpoint] -= ret->len;
+		rx_count[endpoint]--;
+		// below USB_RX_QUEUE_MAX again, so resume receiving
+		uint32_t paused = rx_paused[endpoint];
+		if (paused) {
+			rx_paused[endpoint] = 0;
+			for (uint32_t odd=0; odd < 2; odd++) {
+				if (!(paused & (1 << odd))) continue;
+				bdt_t *b = &table[index(endpoint + 1, RX, odd)];
+				usb_packet_t *p = usb_malloc_rx();
+				if (p) {
+					b->addr = p->buf;
+					b->desc = BDT_DESC(64, odd);
+				} else {
+					usb_rx_memory_needed++;
+				}
+			}
+		}
 	}
 	__enable_irq();
 	//serial_print("rx, epidx=");
@@ -800,7 +821,7 @@ void usb_rx_memory(usb_packet_t *packet)
 		if (i == AUDIO_RX_ENDPOINT) continue;
 #endif
 		if (*cfg++ & USB_ENDPT_EPRXEN) {
-			if (table[index(i, RX, EVEN)].desc == 0) {
+			if (table[index(i, RX, EVEN)].desc == 0 && !(rx_paused[i-1] & 1)) {
 				table[index(i, RX, EVEN)].addr = packet->buf;
 				table[index(i, RX, EVEN)].desc = BDT_DESC(64, 0);
 				usb_rx_memory_needed--;
@@ -809,7 +830,7 @@ void usb_rx_memory(usb_packet_t *packet)
 				//serial_print(",even\n");
 				return;
 			}
-			if (table[index(i, RX, ODD)].desc == 0) {
+			if (table[index(i, RX, ODD)].desc == 0 && !(rx_paused[i-1] & 2)) {
 				table[index(i, RX, ODD)].addr = packet->buf;
 				table[index(i, RX, ODD)].desc = BDT_DESC(64, 1);
 				usb_rx_memory_needed--;
@@ -832,14 +853,13 @@ void usb_rx_memory(usb_packet_t *packet)
 //#define index(endpoint, tx, odd) (((endpoint) << 2) | ((tx) << 1) | (odd))
 //#define stat2bufferdescriptor(stat) (table + ((stat) >> 2))
 
-void usb_tx(uint32_t endpoint, usb_packet_t *packet)
+// Give a packet to a free transmit BDT.  Returns 0 if both are busy.
+// Must be called with interrupts disabled.  endpoint is 0 based.
+static int usb_tx_start(uint32_t endpoint, usb_packet_t *packet)
 {
-	bdt_t *b = &table[index(endpoint, TX, EVEN)];
+	bdt_t *b = &table[index(endpoint + 1, TX, EVEN)];
 	uint8_t next;
 
-	endpoint--;
-	if (endpoint >= NUM_ENDPOINTS) return;
-	__disable_irq();
 	//serial_print("txstate=");
 	//serial_phex(tx_state[endpoint]);
 	//serial_print("\n");
@@ -859,18 +879,49 @@ void usb_tx(uint32_t endpoint, usb_packet_t *packet)
 		next = TX_STATE_NONE_FREE_EVEN_FIRST;
 		break;
 	  default:
+		return 0;
+	}
+	tx_state[endpoint] = next;
+	b->addr = packet->buf;
+	b->desc = BDT_DESC(packet->len, ((uint32_t)b & 8) ? DATA1 : DATA0);
+	return 1;
+}
+
+void usb_tx(uint32_t endpoint, usb_packet_t *packet)
+{
+	endpoint--;
+	if (endpoint >= NUM_ENDPOINTS) return;
+	__disable_irq();
+	if (!usb_tx_start(endpoint, packet)) {
 		if (tx_first[endpoint] == NULL) {
 			tx_first[endpoint] = packet;
 		} else {
 			tx_last[endpoint]->next = packet;
 		}
 		tx_last[endpoint] = packet;
-		__enable_irq();
-		return;
 	}
-	tx_state[endpoint] = next;
-	b->addr = packet->buf;
-	b->desc = BDT_DESC(packet->len, ((uint32_t)b & 8) ? DATA1 : DATA0);
+	__enable_irq();
+}
+
+// Transmit a list of packets linked by next, with interrupts disabled only
+// once.  The last packet's next must be NULL.
+void usb_tx_chain(uint32_t endpoint, usb_packet_t *packet)
+{
+	endpoint--;
+	if (endpoint >= NUM_ENDPOINTS) return;
+	__disable_irq();
+	while (packet && usb_tx_start(endpoint, packet)) {
+		packet = packet->next;
+	}
+	if (packet) {
+		if (tx_first[endpoint] == NULL) {
+			tx_first[endpoint] = packet;
+		} else {
+			tx_last[endpoint]->next = packet;
+		}
+		while (packet->next) packet = packet->next;
+		tx_last[endpoint] = packet;
+	}
 	__enable_irq();
 }
 
@@ -1077,12 +1128,14 @@ void usb_isr(void)
 					}
 					rx_last[endpoint] = packet;
 					usb_rx_byte_count_data[endpoint] += packet->len;
-					// TODO: implement a per-endpoint maximum # of allocated
-					// packets, so a flood of incoming data on 1 endpoint
-					// doesn't starve the others if the user isn't reading
-					// it regularly
-					packet = usb_malloc();
-					if (packet) {
+					// a flood of incoming data on 1 endpoint must not
+					// starve the others if the user isn't reading it
+					// regularly, so stop receiving at USB_RX_QUEUE_MAX
+					// until usb_rx() takes a packet
+					if (++rx_count[endpoint] >= USB_RX_QUEUE_MAX) {
+						b->desc = 0;
+						rx_paused[endpoint] |= ((uint32_t)b & 8) ? 2 : 1;
+					} else if ((packet = usb_malloc_rx()) != NULL) {
 						b->addr = packet->buf;
 						b->desc = BDT_DESC(64,
 							((uint32_t)b & 8) ? DATA1 : DATA0);
@@ -1175,6 +1228,7 @@ void usb_init(void)
 	//serial_print("usb_init\n");
 
 	usb_init_serialnumber();
+	usb_mem_init();
 
 	for (i=0; i < (NUM_ENDPOINTS+1)*4; i++) {
 		table[i].desc = 0;
@@ -34,57 +34,105 @@
 #include "kinetis.h"
 //#include "HardwareSerial.h"
 #include "usb_mem.h"
+#include "ObjectPool.h"
 
+// .usbbuffers is not initialized at startup, so usb_init() must call
+// usb_mem_init() before any packets are allocated.
 __attribute__ ((section(".usbbuffers"), used))
-unsigned char usb_buffer_memory[NUM_USB_BUFFERS * sizeof(usb_packet_t)];
+static ObjectPool<usb_packet_t, USB_PACKET_BUFFERS> usb_buffer_pool;
 
-static uint32_t usb_buffer_available = 0xFFFFFFFF;
+void usb_mem_init(void)
+{
+	usb_buffer_pool.begin();
+}
+
+#if defined(KINETISL)
+void usb_copy(void *dst, const void *src, uint32_t len)
+{
+	uint8_t *d = (uint8_t *)dst;
+	const uint8_t *s = (const uint8_t *)src;
 
-// use bitmask and CLZ instruction to implement fast free list
-// http://www.archivum.info/gnu.gcc.help/2006-08/00148/Re-GCC-Inline-Assembly.html
-// http://gcc.gnu.org/ml/gcc/2012-06/msg00015.html
-// __builtin_clz()
+	if (len >= 8) {
+		// bytes until the destination is aligned
+		while ((uint32_t)d & 3) {
+			*d++ = *s++;
+			len--;
+		}
+		uint32_t *dw = (uint32_t *)d;
+		uint32_t words = len >> 2;
+		uint32_t offset = (uint32_t)s & 3;
+		if (offset == 0) {
+			const uint32_t *sw = (const uint32_t *)s;
+			while (words >= 4) {
+				uint32_t a = sw[0], b = sw[1], c = sw[2], e = sw[3];
+				dw[0] = a;
+				dw[1] = b;
+				dw[2] = c;
+				dw[3] = e;
+				sw += 4;
+				dw += 4;
+				words -= 4;
+			}
+			while (words > 0) {
+				*dw++ = *sw++;
+				words--;
+			}
+		} else {
+			// read whole aligned words, which never reach beyond
+			// the aligned word holding the last byte needed
+			const uint32_t *sw = (const uint32_t *)(s - offset);
+			const uint32_t rshift = offset * 8, lshift = 32 - rshift;
+			uint32_t prev = *sw++;
+			while (words > 0) {
+				uint32_t next = *sw++;
+				*dw++ = (prev >> rshift) | (next << lshift);
+				prev = next;
+				words--;
+			}
+		}
+		d = (uint8_t *)dw;
+		s += len & ~3;
+		len &= 3;
+	}
+	while (len > 0) {
+		*d++ = *s++;
+		len--;
+	}
+}
+#endif
 
+// usb_malloc() leaves the last USB_RX_RESERVE packets for usb_dev.c to
+// give to receive endpoints, with usb_malloc_rx().
 usb_packet_t * usb_malloc(void)
 {
-	unsigned int n, avail;
-	uint8_t *p;
-
-	__disable_irq();
-	avail = usb_buffer_available;
-	n = __builtin_clz(avail); // clz = count leading zeros
-	if (n >= NUM_USB_BUFFERS) {
-		__enable_irq();
-		return NULL;
-	}
-	//serial_print("malloc:");
-	//serial_phex(n);
-	//serial_print("\n");
+	if (usb_buffer_pool.available() <= USB_RX_RESERVE) return NULL;
+	return usb_malloc_rx();
+}
+
+usb_packet_t * usb_malloc_rx(void)
+{
+	usb_packet_t *p;
 
-	usb_buffer_available = avail & ~(0x80000000 >> n);
-	__enable_irq();
-	p = usb_buffer_memory + (n * sizeof(usb_packet_t));
+	p = usb_buffer_pool.allocate();
+	if (!p) return NULL;
 	//serial_print("malloc:");
 	//serial_phex32((int)p);
 	//serial_print("\n");
-	*(uint32_t *)p = 0;
-	*(uint32_t *)(p + 4) = 0;
-	return (usb_packet_t *)p;
+	p->len = 0;
+	p->index = 0;
+	p->next = NULL;
+	return p;
 }
 
 // for the receive endpoints to request memory
+extern "C" {
 extern uint8_t usb_rx_memory_needed;
 extern void usb_rx_memory(usb_packet_t *packet);
+}
 
 void usb_free(usb_packet_t *p)
 {
-	unsigned int n, mask;
-
-	//serial_print("free:");
-	n = ((uint8_t *)p - usb_buffer_memory) / sizeof(usb_packet_t);
-	if (n >= NUM_USB_BUFFERS) return;
-	//serial_phex(n);
-	//serial_print("\n");
+	if (!usb_buffer_pool.contains(p)) return;
 
 	// if any endpoints are starving for memory to receive
 	// packets, give this memory to them immediately!
@@ -96,14 +144,20 @@ void usb_free(usb_packet_t *p)
 		return;
 	}
 
-	mask = (0x80000000 >> n);
-	__disable_irq();
-	usb_buffer_available |= mask;
-	__enable_irq();
-
+	usb_buffer_pool.release(p);
 	//serial_print("free:");
 	//serial_phex32((int)p);
 	//serial_print("\n");
 }
 
+uint32_t usb_malloc_available(void)
+{
+	return usb_buffer_pool.available();
+}
+
+uint32_t usb_malloc_highwater(void)
+{
+	return usb_buffer_pool.highWater();
+}
+
 #endif // F_CPU >= 20 MHz && defined(NUM_ENDPOINTS)
@@ -32,6 +32,7 @@
 #define _usb_mem_h_
 
 #include <stdint.h>
+#include "kinetis.h"
 
 typedef struct usb_packet_struct {
 	uint16_t len;
@@ -44,8 +45,23 @@ typedef struct usb_packet_struct {
 extern "C" {
 #endif
 
+void usb_mem_init(void);
 usb_packet_t * usb_malloc(void);
+usb_packet_t * usb_malloc_rx(void);
 void usb_free(usb_packet_t *p);
+// number of packets free now, and the most ever in use at once
+uint32_t usb_malloc_available(void);
+uint32_t usb_malloc_highwater(void);
+
+// Copy data to or from a packet buffer.  On Teensy LC, memcpy() from
+// newlib-nano copies one byte at a time, and Cortex-M0+ can't access
+// unaligned words, so usb_copy() moves aligned words and shifts them
+// into place when the source and destination alignment differ.
+#if defined(KINETISL)
+void usb_copy(void *dst, const void *src, uint32_t len);
+#else
+#define usb_copy(dst, src, len) memcpy((dst), (src), (len))
+#endif
 
 #ifdef __cplusplus
 }
@@ -112,7 +112,7 @@ int usb_serial_read(void *buffer, uint32_t size)
 		}
 		qty = rx_packet->len - rx_packet->index;
 		if (qty > size) qty = size;
-		memcpy(p, rx_packet->buf + rx_packet->index, qty);
+		usb_copy(p, rx_packet->buf + rx_packet->index, qty);
 		p += qty;
 		count += qty;
 		size -= qty;
@@ -199,6 +199,36 @@ int usb_serial_write(const void *buffer, uint32_t size)
 
 	tx_noautoflush = 1;
 	while (size > 0) {
+		if (!tx_packet && size >= CDC_TX_SIZE && usb_configuration) {
+			// fill as many whole packets as may be queued, then
+			// transmit them together with usb_tx_chain()
+			uint32_t count = usb_tx_packet_count(CDC_TX_ENDPOINT);
+			usb_packet_t *first = NULL, *last = NULL;
+			if (count < TX_PACKET_LIMIT) {
+				uint32_t n = size / CDC_TX_SIZE;
+				if (n > TX_PACKET_LIMIT - count) n = TX_PACKET_LIMIT - count;
+				while (n-- > 0) {
+					usb_packet_t *p = usb_malloc();
+					if (!p) break;
+					usb_copy(p->buf, src, CDC_TX_SIZE);
+					p->len = CDC_TX_SIZE;
+					src += CDC_TX_SIZE;
+					size -= CDC_TX_SIZE;
+					if (last) {
+						last->next = p;
+					} else {
+						first = p;
+					}
+					last = p;
+				}
+			}
+			if (first) {
+				usb_tx_chain(CDC_TX_ENDPOINT, first);
+				transmit_previous_timeout = 0;
+				usb_cdc_transmit_flush_timer = TRANSMIT_FLUSH_TIMEOUT;
+				continue;
+			}
+		}
 		if (!tx_packet) {
 			wait_count = 0;
 			while (1) {
@@ -225,7 +255,8 @@ int usb_serial_write(const void *buffer, uint32_t size)
 		dest = tx_packet->buf + tx_packet->index;
 		tx_packet->index += len;
 		size -= len;
-		while (len-- > 0) *dest++ = *src++;
+		usb_copy(dest, src, len);
+		src += len;
 		if (tx_packet->index >= CDC_TX_SIZE) {
 			tx_packet->len = CDC_TX_SIZE;
 			usb_tx(CDC_TX_ENDPOINT, tx_packet);
@@ -83,6 +83,15 @@
 #ifdef NUM_USB_BUFFERS
 #undef NUM_USB_BUFFERS
 #endif
+#ifdef USB_PACKET_BUFFERS
+#undef USB_PACKET_BUFFERS
+#endif
+#ifdef USB_RX_QUEUE_MAX
+#undef USB_RX_QUEUE_MAX
+#endif
+#ifdef USB_RX_RESERVE
+#undef USB_RX_RESERVE
+#endif
 #ifdef NUM_INTERFACE
 #undef NUM_INTERFACE
 #endif
@@ -0,0 +1,111 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "AnalogOversample.h"
+#include "core_pins.h"
+#include "avr/pgmspace.h"
+
+// 64 samples per pin in each half of the ring buffer
+#define BLOCK_SAMPLES 64
+static DMAMEM uint16_t buffer[8 * BLOCK_SAMPLES * 2] __attribute__((aligned(32)));
+
+AnalogOversample * AnalogOversample::active = nullptr;
+
+bool AnalogOversample::begin(const uint8_t *pins, uint8_t n, uint8_t bits, float rate)
+{
+	if (active || !pins || n < 1 || n > 8) return false;
+	if (bits < 12 || bits > 16) return false;
+	shift = bits - 12;
+	decimate = 1 << (shift * 2);
+	npins = n;
+	summed = 0;
+	fresh = 0;
+	for (int i=0; i < 8; i++) {
+		sum[i] = 0;
+		latest[i] = 0;
+	}
+	analogReadResolution(12);
+	active = this;
+	if (!stream.begin(pins, n, rate * decimate, buffer, n * BLOCK_SAMPLES * 2, block)) {
+		active = nullptr;
+		return false;
+	}
+	return true;
+}
+
+void AnalogOversample::end()
+{
+	if (active != this) return;
+	stream.end();
+	active = nullptr;
+}
+
+int AnalogOversample::read(uint8_t index)
+{
+	if (index >= npins) return 0;
+	fresh = 0;
+	return latest[index];
+}
+
+// runs from the DMA interrupt, with count/npins samples of every pin
+FASTRUN void AnalogOversample::block(const uint16_t *samples, uint32_t count)
+{
+	AnalogOversample *s = active;
+	if (!s) return;
+	const uint32_t n = s->npins;
+	const uint32_t decimate = s->decimate;
+	const uint16_t *end = samples + count;
+	while (samples < end) {
+		// sum as many sample sets as this result still needs, or
+		// as remain in the block
+		uint32_t sets = (end - samples) / n;
+		uint32_t need = decimate - s->summed;
+		if (sets > need) sets = need;
+		for (uint32_t p=0; p < n; p++) {
+			const uint16_t *in = samples + p;
+			uint32_t total = s->sum[p];
+			for (uint32_t i=0; i < sets; i++) {
+				total += *in;
+				in += n;
+			}
+			s->sum[p] = total;
+		}
+		samples += sets * n;
+		s->summed += sets;
+		if (s->summed >= decimate) {
+			for (uint32_t p=0; p < n; p++) {
+				s->latest[p] = s->sum[p] >> s->shift;
+				s->sum[p] = 0;
+			}
+			s->summed = 0;
+			s->fresh = 1;
+		}
+	}
+}
@@ -0,0 +1,83 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#ifndef AnalogOversample_h_
+#define AnalogOversample_h_
+
+#include <stdint.h>
+#include "AnalogStream.h"
+
+// Oversampling with decimation, for 13 to 16 bit results from the 12 bit
+// ADC.  AnalogStream samples continuously by DMA, and each block is
+// summed in the DMA interrupt (a boxcar, or first order CIC, filter).
+// Every extra bit needs 4 times as many samples, so for 16 bits each
+// result is the sum of 256 conversions, scaled by 1/16.  The rate given
+// to begin() is the result rate, so the ADC runs 4^(bits-12) times
+// faster, up to 1 MHz total for all pins.
+//
+//   AnalogOversample adc;
+//   const uint8_t pins[] = {A0, A1};
+//   adc.begin(pins, 2, 16, 1000);       // 16 bits, 1000 results/sec
+//   if (adc.available()) int n = adc.read(0);
+//
+// read() never waits; it returns the most recent result for that pin.
+// Extra bits are only gained when the signal has at least 1 LSB of
+// noise.  begin() sets analogReadResolution(12), and only one
+// AnalogOversample or AnalogStream may run at a time.
+class AnalogOversample {
+public:
+	constexpr AnalogOversample() {}
+	~AnalogOversample() { end(); }
+	bool begin(const uint8_t *pins, uint8_t npins, uint8_t bits, float rate);
+	bool begin(uint8_t pin, uint8_t bits, float rate) {
+		return begin(&pin, 1, bits, rate);
+	}
+	void end();
+	// true when a new result is ready since the last read()
+	bool available() const { return fresh != 0; }
+	int read(uint8_t index = 0);
+	uint32_t overruns() const { return stream.overruns(); }
+	operator bool() const { return (bool)stream; }
+private:
+	static void block(const uint16_t *samples, uint32_t count);
+	static AnalogOversample *active;
+	AnalogStream stream;
+	uint32_t sum[8] = {};
+	volatile uint16_t latest[8] = {};
+	volatile uint8_t fresh = 0;
+	uint8_t npins = 0;
+	uint8_t shift = 0;          // extra bits
+	uint16_t decimate = 0;      // samples per result, 4^shift
+	uint16_t summed = 0;        // samples in sum[] so far
+};
+
+#endif
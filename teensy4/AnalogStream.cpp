@@ -0,0 +1,200 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2024 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "AnalogStream.h"
+#include "TriggerRoute.h"
+#include "DMAChannel.h"
+#include "core_pins.h"
+#include "debug/printf.h"
+
+extern "C" uint8_t analog_pin_channel(uint8_t pin);
+extern "C" int analog_channel_on_adc2(uint8_t ch);
+
+// ADC_ETC trigger 0 drives ADC1 and trigger 4 drives ADC2.  Both share
+// one DMA request source, which is why only one stream may run.
+#define ETC_TRIG(adc)  (((adc) == 1) ? 0 : 4)
+#define ADC_ETC_INPUT  16  // ADC channel number meaning "use ADC_ETC chain"
+
+AnalogStream * AnalogStream::active = nullptr;
+static DMAChannel dma(false);
+
+bool AnalogStream::begin(const uint8_t *pins, uint8_t npins, float rate,
+	uint16_t *buf, uint32_t len,
+	void (*funct)(const uint16_t *samples, uint32_t count))
+{
+	if (active) return false;
+	if (!(rate > 0.0f) || rate > 1000000.0f) return false;
+	uint32_t cycles = 24000000.0f / rate - 0.5f;
+	if (cycles < 24) return false;
+
+	// claim a PIT channel, left in TCTRL=1 (no interrupt) while in use
+	CCM_CCGR1 |= CCM_CCGR1_PIT(CCM_CCGR_ON);
+	PIT_MCR = 1;
+	int n = -1;
+	for (int i=0; i < 4; i++) {
+		if (IMXRT_PIT_CHANNELS[i].TCTRL == 0) {
+			n = i;
+			break;
+		}
+	}
+	if (n < 0) return false;
+	IMXRT_PIT_CHANNEL_t *channel = IMXRT_PIT_CHANNELS + n;
+	channel->LDVAL = cycles - 1;
+	if (!start(pins, npins, TriggerRoute::pit(n), buf, len, funct)) return false;
+	pit = n;
+	printf("AnalogStream: PIT%d, %u cycles\n", pit, cycles);
+	channel->TCTRL = 1;
+	return true;
+}
+
+bool AnalogStream::beginTriggered(const uint8_t *pins, uint8_t npins, int source,
+	uint16_t *buf, uint32_t len,
+	void (*funct)(const uint16_t *samples, uint32_t count))
+{
+	if (active) return false;
+	pit = -1;
+	return start(pins, npins, source, buf, len, funct);
+}
+
+bool AnalogStream::start(const uint8_t *pins, uint8_t npins, int source,
+	uint16_t *buf, uint32_t len,
+	void (*funct)(const uint16_t *samples, uint32_t count))
+{
+	uint8_t ch[8];
+
+	if (!pins || npins < 1 || npins > 8 || !buf || !funct) return false;
+	if (len == 0 || len % (npins * 2) != 0 || len / npins > 32767) return false;
+
+	// one ADC converts every pin, so a set mixing ADC2 only pins with
+	// ADC1 only pins (A10, A11) can't be measured
+	adc = 1;
+	for (int i=0; i < npins; i++) {
+		ch[i] = analog_pin_channel(pins[i]);
+		if (ch[i] == 255) return false;
+		if (ch[i] & 0x80) adc = 2;
+	}
+	if (adc == 2) {
+		for (int i=0; i < npins; i++) {
+			if (!analog_channel_on_adc2(ch[i])) return false;
+		}
+	}
+	// the trigger source must be valid and the ADC_ETC trigger unused
+	if (!TriggerRoute::connect(source, TriggerRoute::adc(adc))) return false;
+
+	buffer = buf;
+	count = len;
+	callback = funct;
+	overrun_count = 0;
+	next_half = 0;
+	active = this;
+	printf("AnalogStream: %d pins, ADC%d, XBAR input %d\n", npins, adc, source & 0xFF);
+
+	// DMA moves all the chain's results (consecutive 16 bit halves of
+	// the RESULT registers) on each request, then the minor loop offset
+	// rewinds the source for the next trigger
+	const int trig = ETC_TRIG(adc);
+	dma.begin();
+	dma.TCD->SADDR = &IMXRT_ADC_ETC.TRIG[trig].RESULT_1_0;
+	dma.TCD->SOFF = 2;
+	dma.TCD->ATTR = DMA_TCD_ATTR_SSIZE(1) | DMA_TCD_ATTR_DSIZE(1);
+	dma.TCD->NBYTES_MLOFFYES = DMA_TCD_NBYTES_SMLOE |
+		DMA_TCD_NBYTES_MLOFFYES_MLOFF(-(npins * 2)) |
+		DMA_TCD_NBYTES_MLOFFYES_NBYTES(npins * 2);
+	dma.TCD->SLAST = 0;
+	dma.TCD->DADDR = buf;
+	dma.TCD->DOFF = 2;
+	dma.TCD->CITER_ELINKNO = len / npins;
+	dma.TCD->BITER_ELINKNO = len / npins;
+	dma.TCD->DLASTSGA = -(len * 2);
+	dma.TCD->CSR = DMA_TCD_CSR_INTHALF | DMA_TCD_CSR_INTMAJOR;
+	dma.triggerAtHardwareEvent(DMAMUX_SOURCE_ADC_ETC);
+	dma.attachInterrupt(isr);
+	dma.enable();
+
+	// ADC converts whatever ADC_ETC requests on HC0 to HC(npins-1)
+	IMXRT_ADCS_t *regs = (adc == 1) ? &IMXRT_ADC1 : &IMXRT_ADC2;
+	volatile uint32_t *hc = &regs->HC0;
+	for (int i=0; i < npins; i++) hc[i] = ADC_ETC_INPUT;
+	regs->CFG |= ADC_CFG_ADTRG;
+
+	// ADC_ETC chain: each pin back to back, DONE0 (and DMA) after the last
+	ADC_ETC_CTRL &= ~ADC_ETC_CTRL_SOFTRST;
+	ADC_ETC_CTRL |= ADC_ETC_CTRL_TSC_BYPASS;
+	IMXRT_ADC_ETC.TRIG[trig].CTRL = ADC_ETC_TRIG_CTRL_TRIG_CHAIN(npins - 1);
+	volatile uint32_t *chain = &IMXRT_ADC_ETC.TRIG[trig].CHAIN_1_0;
+	for (int i=0; i < 4; i++) chain[i] = 0;
+	for (int i=0; i < npins; i++) {
+		uint32_t ie = (i == npins - 1) ? 1 : 0;
+		uint32_t c = ch[i] & 0x7F;
+		if (i & 1) {
+			chain[i >> 1] |= ADC_ETC_TRIG_CHAIN_CSEL1(c) | ADC_ETC_TRIG_CHAIN_HWTS1(1 << i)
+				| ADC_ETC_TRIG_CHAIN_B2B1 | ADC_ETC_TRIG_CHAIN_IE1(ie);
+		} else {
+			chain[i >> 1] |= ADC_ETC_TRIG_CHAIN_CSEL0(c) | ADC_ETC_TRIG_CHAIN_HWTS0(1 << i)
+				| ADC_ETC_TRIG_CHAIN_B2B0 | ADC_ETC_TRIG_CHAIN_IE0(ie);
+		}
+	}
+	ADC_ETC_DMA_CTRL |= ADC_ETC_DMA_CTRL_TRIQ_ENABLE(trig);
+	ADC_ETC_CTRL |= ADC_ETC_CTRL_TRIG_ENABLE(1 << trig);
+	return true;
+}
+
+void AnalogStream::end()
+{
+	if (active != this) return;
+	const int trig = ETC_TRIG(adc);
+	if (pit >= 0) IMXRT_PIT_CHANNELS[pit].TCTRL = 0;
+	TriggerRoute::disconnect(TriggerRoute::adc(adc));
+	ADC_ETC_CTRL &= ~ADC_ETC_CTRL_TRIG_ENABLE(1 << trig);
+	ADC_ETC_DMA_CTRL &= ~ADC_ETC_DMA_CTRL_TRIQ_ENABLE(trig);
+	IMXRT_ADCS_t *regs = (adc == 1) ? &IMXRT_ADC1 : &IMXRT_ADC2;
+	regs->CFG &= ~ADC_CFG_ADTRG;
+	dma.disable();
+	dma.detachInterrupt();
+	dma.clearInterrupt();
+	pit = -1;
+	active = nullptr;
+}
+
+void AnalogStream::isr()
+{
+	AnalogStream *s = active;
+	dma.clearInterrupt();
+	if (!s) return;
+	uint32_t half = s->count / 2;
+	// while DMA fills the second half, the first is complete
+	uint8_t done = ((uint16_t *)dma.TCD->DADDR < s->buffer + half) ? 1 : 0;
+	if (done != s->next_half) s->overrun_count++;
+	s->next_half = done ^ 1;
+	uint16_t *block = s->buffer + done * half;
+	arm_dcache_delete(block, half * 2);
+	(*s->callback)(block, half);
+	asm("DSB");
+}
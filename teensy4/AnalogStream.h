@@ -0,0 +1,94 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2024 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef AnalogStream_h_
+#define AnalogStream_h_
+
+#include <stdint.h>
+
+// Continuous sampling of up to 8 analog pins, with no CPU time used per
+// sample.  A PIT timer triggers ADC_ETC (through XBAR) at the sample
+// rate, which converts every pin back to back, and DMA copies the
+// results into a ring buffer.  Each time half of the buffer fills, the
+// callback receives that half from the DMA interrupt:
+//
+//   DMAMEM uint16_t buffer[2048] __attribute__((aligned(32)));
+//   void block(const uint16_t *samples, uint32_t count) { ... }
+//   const uint8_t pins[] = {A0, A1};
+//   stream.begin(pins, 2, 40000, buffer, 2048, block);
+//
+// Samples are interleaved in the order of pins[], so count must be a
+// multiple of twice the number of pins.  For cache maintenance, the
+// buffer must be 32 byte aligned with each half a multiple of 32 bytes.  The callback must finish with
+// the samples before the other half of the buffer is full.
+//
+// Pins are measured by ADC1, or ADC2 if any pin is only connected to
+// ADC2.  A set mixing ADC2 only pins (A12-A15) with ADC1 only pins
+// (A10, A11) is rejected by begin().  While streaming, analogRead() returns 0 for pins on that ADC.
+// Only one AnalogStream may run at a time.  begin() uses one of the 4
+// PIT channels shared with IntervalTimer.
+class AnalogStream {
+public:
+	constexpr AnalogStream() {}
+	~AnalogStream() { end(); }
+	bool begin(const uint8_t *pins, uint8_t npins, float rate,
+		uint16_t *buffer, uint32_t count,
+		void (*callback)(const uint16_t *samples, uint32_t count));
+	bool begin(uint8_t pin, float rate, uint16_t *buffer, uint32_t count,
+		void (*callback)(const uint16_t *samples, uint32_t count)) {
+		return begin(&pin, 1, rate, buffer, count, callback);
+	}
+	// Sample each time a hardware trigger source fires, instead of at a
+	// fixed rate, for example once per PWM period with
+	// TriggerRoute::pwmReload(pin).  All the pins must be converted before
+	// the next trigger.
+	bool beginTriggered(const uint8_t *pins, uint8_t npins, int source,
+		uint16_t *buffer, uint32_t count,
+		void (*callback)(const uint16_t *samples, uint32_t count));
+	void end();
+	// blocks lost because the callback did not run in time
+	uint32_t overruns() const { return overrun_count; }
+	operator bool() const { return active == this; }
+private:
+	static void isr();
+	bool start(const uint8_t *pins, uint8_t npins, int source,
+		uint16_t *buffer, uint32_t count,
+		void (*callback)(const uint16_t *samples, uint32_t count));
+	static AnalogStream *active;
+	uint16_t *buffer = nullptr;
+	uint32_t count = 0;
+	void (*callback)(const uint16_t *samples, uint32_t count) = nullptr;
+	volatile uint32_t overrun_count = 0;
+	uint8_t next_half = 0;
+	uint8_t adc = 0;    // 1 or 2
+	int8_t pit = -1;    // PIT channel index
+};
+
+#endif
@@ -31,114 +31,303 @@
 
 #include <Arduino.h>
 #include "AudioStream.h"
+#include "arm_math.h"	// LDREX & STREX for reference counts
 
 #if defined(__IMXRT1062__)
   #define MAX_AUDIO_MEMORY 229376
 #endif
 
+// Critical sections mask only the interrupts which run audio objects,
+// DMA and USB at their default priority and the update interrupt, so
+// serial and real time interrupts are never delayed.  Interrupts which
+// use audio objects must not be given a more urgent priority.
+#define AUDIO_MASK_PRIORITY (IRQ_PRIORITY_USB < IRQ_PRIORITY_DEFAULT ? IRQ_PRIORITY_USB : IRQ_PRIORITY_DEFAULT)
+
 #define NUM_MASKS  (((MAX_AUDIO_MEMORY / AUDIO_BLOCK_SAMPLES / 2) + 31) / 32)
+#define NUM_DOUBLE_MASKS  (((MAX_AUDIO_MEMORY / AUDIO_BLOCK_SAMPLES / 4) + 31) / 32)
+#define NUM_F32_MASKS  (((MAX_AUDIO_MEMORY / AUDIO_BLOCK_SAMPLES / 4) + 31) / 32)
 
 audio_block_t * AudioStream::memory_pool;
 uint32_t AudioStream::memory_pool_available_mask[NUM_MASKS];
 uint16_t AudioStream::memory_pool_first_mask;
+audio_block_double_t * AudioStream::memory_pool_double;
+uint32_t AudioStream::memory_pool_double_available_mask[NUM_DOUBLE_MASKS];
+uint16_t AudioStream::memory_pool_double_first_mask;
+audio_block_t * AudioStream::memory_pool_dtcm;
+uint32_t AudioStream::memory_pool_dtcm_available_mask[NUM_MASKS];
+uint16_t AudioStream::memory_pool_dtcm_first_mask;
+AudioStream * AudioStream::update_current = NULL;
+uint32_t AudioStream::update_current_ipsr = 0;
+audio_block_f32_t * AudioStream::memory_pool_f32;
+uint32_t AudioStream::memory_pool_f32_available_mask[NUM_F32_MASKS];
+uint16_t AudioStream::memory_pool_f32_first_mask;
+unsigned int AudioStream::block_samples_value = AUDIO_BLOCK_SAMPLES;
+const unsigned int &AudioStream::block_samples = AudioStream::block_samples_value;
+bool AudioStream::block_samples_fixed = false;
 
 uint16_t AudioStream::cpu_cycles_total = 0;
 uint16_t AudioStream::cpu_cycles_total_max = 0;
 uint16_t AudioStream::memory_used = 0;
 uint16_t AudioStream::memory_used_max = 0;
+uint16_t AudioStream::memory_double_used = 0;
+uint16_t AudioStream::memory_double_used_max = 0;
+uint16_t AudioStream::memory_f32_used = 0;
+uint16_t AudioStream::memory_f32_used_max = 0;
 AudioConnection* AudioStream::unused = NULL; // linked list of unused but not destructed connections
+#ifdef AUDIO_PROFILE
+uint32_t AudioStream::profile_blocks = 0;
+uint32_t AudioStream::profile_blocks_late = 0;
+#endif
 
 void software_isr(void);
+void software_isr_domain(unsigned int domain);
+static void software_isr_domain1(void);
+static void software_isr_domain2(void);
+
+// Software interrupts of the update domains.  The NVIC implements these
+// reserved interrupts, so they may be triggered by setting them pending.
+static const IRQ_NUMBER_t domain_irq[AUDIO_UPDATE_DOMAINS] = {
+	IRQ_SOFTWARE, IRQ_Reserved2, IRQ_Reserved3
+};
+static void (* const domain_isr[AUDIO_UPDATE_DOMAINS])(void) = {
+	software_isr, software_isr_domain1, software_isr_domain2
+};
+uint8_t AudioStream::update_domains_used = 1;
+uint8_t AudioStream::update_domain_priority[AUDIO_UPDATE_DOMAINS] = {
+	IRQ_PRIORITY_AUDIO_UPDATE, IRQ_PRIORITY_AUDIO_UPDATE + 16, IRQ_PRIORITY_AUDIO_UPDATE + 32
+};
+uint16_t AudioStream::domain_cycles[AUDIO_UPDATE_DOMAINS];
+
+
+// Reference counts use LDREX & STREX rather than disabling interrupts.
+// Any interrupt between them causes STREX to fail, so the loop simply
+// retries if an interrupt also changed the count.
+
+static inline uint32_t atomic_add8(uint8_t *p, int n)
+{
+	uint32_t val;
+	do {
+		val = __LDREXB((volatile uint8_t *)p) + n;
+	} while (__STREXB(val, (volatile uint8_t *)p));
+	return val;
+}
+
+// Set up one pool of blocks, all marked available
+FLASHMEM static void pool_initialize(void *data, unsigned int num, unsigned int size,
+	uint8_t pool_num, uint32_t *mask, unsigned int num_masks)
+{
+	unsigned int i;
+
+	for (i=0; i < num_masks; i++) {
+		mask[i] = 0;
+	}
+	for (i=0; i < num; i++) {
+		audio_block_t *block = (audio_block_t *)((uint8_t *)data + i * size);
+		block->memory_pool_num = pool_num;
+		block->memory_pool_index = i;
+		mask[i >> 5] |= (0x80000000 >> (31 - (i & 0x1F)));
+	}
+}
 
+// Claim the first available block from a pool, or return -1 if none
+static int pool_allocate(uint32_t *mask, unsigned int num_masks, uint16_t *first_mask,
+	uint16_t *used, uint16_t *used_max)
+{
+	uint32_t index, avail, n, count;
+	uint32_t *p;
+
+	uint32_t irq = irq_mask_priority(AUDIO_MASK_PRIORITY);
+	index = *first_mask;
+	p = mask + index;
+	while (1) {
+		if (index >= num_masks) {
+			irq_restore_priority(irq);
+			return -1;
+		}
+		avail = *p;
+		if (avail) break;
+		index++;
+		p++;
+	}
+	n = __builtin_clz(avail);
+	avail &= ~(0x80000000 >> n);
+	*p = avail;
+	*first_mask = avail ? index : index + 1;
+	count = *used + 1;
+	*used = count;
+	if (count > *used_max) *used_max = count;
+	irq_restore_priority(irq);
+	return (index << 5) + (31 - n);
+}
+
+// Return a block to its pool
+static void pool_release(uint32_t *mask, uint16_t *first_mask, uint32_t num,
+	uint16_t *used)
+{
+	uint32_t index = num >> 5;
+
+	uint32_t irq = irq_mask_priority(AUDIO_MASK_PRIORITY);
+	mask[index] |= (0x80000000 >> (31 - (num & 0x1F)));
+	if (index < *first_mask) *first_mask = index;
+	*used = *used - 1;
+	irq_restore_priority(irq);
+}
 
 // Set up the pool of audio data blocks
 // placing them all onto the free list
 FLASHMEM void AudioStream::initialize_memory(audio_block_t *data, unsigned int num)
 {
-	unsigned int i;
 	unsigned int maxnum = MAX_AUDIO_MEMORY / AUDIO_BLOCK_SAMPLES / 2;
 
 	//Serial.println("AudioStream initialize_memory");
 	//delay(10);
 	if (num > maxnum) num = maxnum;
-	__disable_irq();
+	uint32_t mask = irq_mask_priority(AUDIO_MASK_PRIORITY);
 	memory_pool = data;
 	memory_pool_first_mask = 0;
-	for (i=0; i < NUM_MASKS; i++) {
-		memory_pool_available_mask[i] = 0;
-	}
-	for (i=0; i < num; i++) {
-		memory_pool_available_mask[i >> 5] |= (1 << (i & 0x1F));
-	}
-	for (i=0; i < num; i++) {
-		data[i].memory_pool_index = i;
-	}
-	__enable_irq();
+	pool_initialize(data, num, sizeof(audio_block_t), 0,
+		memory_pool_available_mask, NUM_MASKS);
+	irq_restore_priority(mask);
+
+}
+
+// Set up the optional pool of double size blocks
+FLASHMEM void AudioStream::initialize_memory_double(audio_block_double_t *data, unsigned int num)
+{
+	unsigned int maxnum = MAX_AUDIO_MEMORY / AUDIO_BLOCK_SAMPLES / 4;
 
+	if (num > maxnum) num = maxnum;
+	uint32_t mask = irq_mask_priority(AUDIO_MASK_PRIORITY);
+	memory_pool_double = data;
+	memory_pool_double_first_mask = 0;
+	pool_initialize(data, num, sizeof(audio_block_double_t), 1,
+		memory_pool_double_available_mask, NUM_DOUBLE_MASKS);
+	irq_restore_priority(mask);
+}
+
+// Set up the optional pool of blocks in DTCM, used first by update()
+FLASHMEM void AudioStream::initialize_memory_dtcm(audio_block_t *data, unsigned int num)
+{
+	unsigned int maxnum = MAX_AUDIO_MEMORY / AUDIO_BLOCK_SAMPLES / 2;
+
+	if (num > maxnum) num = maxnum;
+	uint32_t mask = irq_mask_priority(AUDIO_MASK_PRIORITY);
+	memory_pool_dtcm = data;
+	memory_pool_dtcm_first_mask = 0;
+	pool_initialize(data, num, sizeof(audio_block_t), 3,
+		memory_pool_dtcm_available_mask, NUM_MASKS);
+	irq_restore_priority(mask);
+}
+
+// Set up the optional pool of float blocks
+FLASHMEM void AudioStream::initialize_memory_f32(audio_block_f32_t *data, unsigned int num)
+{
+	unsigned int maxnum = MAX_AUDIO_MEMORY / AUDIO_BLOCK_SAMPLES / 4;
+
+	if (num > maxnum) num = maxnum;
+	uint32_t mask = irq_mask_priority(AUDIO_MASK_PRIORITY);
+	memory_pool_f32 = data;
+	memory_pool_f32_first_mask = 0;
+	pool_initialize(data, num, sizeof(audio_block_f32_t), 2,
+		memory_pool_f32_available_mask, NUM_F32_MASKS);
+	irq_restore_priority(mask);
+}
+
+// Choose a smaller block size for lower latency, at the cost of more
+// updates and more interrupt overhead
+bool AudioStream::setBlockSamples(unsigned int samples)
+{
+	if (samples < AUDIO_BLOCK_SAMPLES_MIN || samples > AUDIO_BLOCK_SAMPLES) return false;
+	if (samples & (AUDIO_BLOCK_SAMPLES_MIN - 1)) return false;
+	if (block_samples_fixed) return false; // objects already sized for it
+	block_samples_value = samples;
+	return true;
 }
 
 // Allocate 1 audio data block.  If successful
 // the caller is the only owner of this new block
 audio_block_t * AudioStream::allocate(void)
 {
-	uint32_t n, index, avail;
-	uint32_t *p, *end;
 	audio_block_t *block;
-	uint32_t used;
-
-	p = memory_pool_available_mask;
-	end = p + NUM_MASKS;
-	__disable_irq();
-	index = memory_pool_first_mask;
-	p += index;
-	while (1) {
-		if (p >= end) {
-			__enable_irq();
+	int num;
+
+	// an I/O interrupt may preempt update(), but only update() itself
+	// gets DTCM blocks
+	uint32_t ipsr;
+	__asm__ volatile("mrs %0, ipsr\n" : "=r" (ipsr)::);
+	AudioStream *s = update_current;
+	num = -1;
+	if (memory_pool_dtcm && s && !s->block_memory_dma && ipsr == update_current_ipsr) {
+		num = pool_allocate(memory_pool_dtcm_available_mask, NUM_MASKS,
+			&memory_pool_dtcm_first_mask, &memory_used, &memory_used_max);
+	}
+	if (num >= 0) {
+		block = memory_pool_dtcm + num;
+	} else {
+		num = pool_allocate(memory_pool_available_mask, NUM_MASKS, &memory_pool_first_mask,
+			&memory_used, &memory_used_max);
+		if (num < 0) {
 			//Serial.println("alloc:null");
 			return NULL;
 		}
-		avail = *p;
-		if (avail) break;
-		index++;
-		p++;
+		block = memory_pool + num;
 	}
-	n = __builtin_clz(avail);
-	avail &= ~(0x80000000 >> n);
-	*p = avail;
-	if (!avail) index++;
-	memory_pool_first_mask = index;
-	used = memory_used + 1;
-	memory_used = used;
-	__enable_irq();
-	index = p - memory_pool_available_mask;
-	block = memory_pool + ((index << 5) + (31 - n));
 	block->ref_count = 1;
-	if (used > memory_used_max) memory_used_max = used;
 	//Serial.print("alloc:");
 	//Serial.println((uint32_t)block, HEX);
 	return block;
 }
 
+// Allocate 1 double size block, from memory given by AudioMemoryDouble()
+audio_block_double_t * AudioStream::allocateDouble(void)
+{
+	audio_block_double_t *block;
+	int num;
+
+	num = pool_allocate(memory_pool_double_available_mask, NUM_DOUBLE_MASKS,
+		&memory_pool_double_first_mask, &memory_double_used, &memory_double_used_max);
+	if (num < 0) return NULL;
+	block = memory_pool_double + num;
+	block->ref_count = 1;
+	return block;
+}
+
+// Allocate 1 float block, from memory given by AudioMemoryF32()
+audio_block_f32_t * AudioStream::allocateF32(void)
+{
+	audio_block_f32_t *block;
+	int num;
+
+	num = pool_allocate(memory_pool_f32_available_mask, NUM_F32_MASKS,
+		&memory_pool_f32_first_mask, &memory_f32_used, &memory_f32_used_max);
+	if (num < 0) return NULL;
+	block = memory_pool_f32 + num;
+	block->ref_count = 1;
+	return block;
+}
+
 // Release ownership of a data block.  If no
 // other streams have ownership, the block is
 // returned to the free pool
 void AudioStream::release(audio_block_t *block)
 {
 	//if (block == NULL) return;
-	uint32_t mask = (0x80000000 >> (31 - (block->memory_pool_index & 0x1F)));
-	uint32_t index = block->memory_pool_index >> 5;
-
-	__disable_irq();
-	if (block->ref_count > 1) {
-		block->ref_count--;
+	if (atomic_add8(&block->ref_count, -1) > 0) return;
+	//Serial.print("reles:");
+	//Serial.println((uint32_t)block, HEX);
+	if (block->memory_pool_num == 0) {
+		pool_release(memory_pool_available_mask, &memory_pool_first_mask,
+			block->memory_pool_index, &memory_used);
+	} else if (block->memory_pool_num == 3) {
+		pool_release(memory_pool_dtcm_available_mask, &memory_pool_dtcm_first_mask,
+			block->memory_pool_index, &memory_used);
+	} else if (block->memory_pool_num == 1) {
+		pool_release(memory_pool_double_available_mask, &memory_pool_double_first_mask,
+			block->memory_pool_index, &memory_double_used);
 	} else {
-		//Serial.print("reles:");
-		//Serial.println((uint32_t)block, HEX);
-		memory_pool_available_mask[index] |= mask;
-		if (index < memory_pool_first_mask) memory_pool_first_mask = index;
-		memory_used--;
+		pool_release(memory_pool_f32_available_mask, &memory_pool_f32_first_mask,
+			block->memory_pool_index, &memory_f32_used);
 	}
-	__enable_irq();
 }
 
 // Transmit an audio data block
@@ -154,7 +343,12 @@ void AudioStream::transmit(audio_block_t *block, unsigned char index)
 		if (c->src_index == index) {
 			if (c->dst->inputQueue[c->dest_index] == NULL) {
 				c->dst->inputQueue[c->dest_index] = block;
-				block->ref_count++;
+				atomic_add8(&block->ref_count, 1);
+#ifdef AUDIO_PROFILE
+				c->profile_sent++;
+			} else {
+				c->profile_dropped++;
+#endif
 			}
 		}
 	}
@@ -185,7 +379,24 @@ audio_block_t * AudioStream::receiveWritable(unsigned int index)
 	if (in && in->ref_count > 1) {
 		p = allocate();
 		if (p) memcpy(p->data, in->data, sizeof(p->data));
-		in->ref_count--;
+		release(in);	// another owner may release at the same time
+		in = p;
+	}
+	return in;
+}
+
+// Receive a float block from an input, as receiveWritable()
+audio_block_f32_t * AudioStream::receiveWritableF32(unsigned int index)
+{
+	audio_block_f32_t *in, *p;
+
+	if (index >= num_inputs) return NULL;
+	in = (audio_block_f32_t *)inputQueue[index];
+	inputQueue[index] = NULL;
+	if (in && in->ref_count > 1) {
+		p = allocateF32();
+		if (p) memcpy(p->data, in->data, block_samples * sizeof(float));
+		release(in);	// another owner may release at the same time
 		in = p;
 	}
 	return in;
@@ -202,6 +413,10 @@ AudioConnection::AudioConnection(AudioStream &source, unsigned char sourceOutput
 	AudioStream::unused = this;
 	
 	isConnected = false;	  
+#ifdef AUDIO_PROFILE
+	profile_sent = 0;
+	profile_dropped = 0;
+#endif
 	connect(source,sourceOutput,destination,destinationInput); 
 }
 
@@ -212,6 +427,10 @@ AudioConnection::AudioConnection(AudioStream &source, AudioStream &destination)
 	AudioStream::unused = this;
 	
 	isConnected = false;	  
+#ifdef AUDIO_PROFILE
+	profile_sent = 0;
+	profile_dropped = 0;
+#endif
 	connect(source, 0, destination,0);
 }
 
@@ -236,6 +455,7 @@ int AudioConnection::connect(void)
 	AudioConnection *p;
 	AudioConnection **pp;
 	AudioStream* s;
+	uint32_t mask = irq_mask_priority(AUDIO_MASK_PRIORITY);
 
 	do 
 	{
@@ -254,8 +474,6 @@ int AudioConnection::connect(void)
 			break;
 		}
 			
-		__disable_irq();
-		
 		// First check the destination's input isn't already in use
 		s = AudioStream::first_update; // first AudioStream in the stream list
 		while (s) // go through all AudioStream objects
@@ -265,7 +483,7 @@ int AudioConnection::connect(void)
 			{
 				if (p->dst == dst && p->dest_index == dest_index) // same destination - it's in use!
 				{
-					__enable_irq();
+					irq_restore_priority(mask);
 					return 4;
 				}
 				p = p->next_dest;
@@ -300,7 +518,7 @@ int AudioConnection::connect(void)
 					&& p->src_index == this->src_index && p->dest_index == this->dest_index) 
 				{
 					//Source and destination already connected through another connection, abort
-					__enable_irq();
+					irq_restore_priority(mask);
 					return 6;
 				}
 				p = p->next_dest;
@@ -319,11 +537,12 @@ int AudioConnection::connect(void)
 		dst->active = true;
 
 		isConnected = true;
+		AudioStream::update_sort();
 		
 		result = 0;
 	} while (0);
 	
-	__enable_irq();
+	irq_restore_priority(mask);
 	
 	return result;
 }
@@ -354,13 +573,13 @@ int AudioConnection::disconnect(void)
 
 	if (!isConnected) return 1;
 	if (dest_index >= dst->num_inputs) return 2; // should never happen!
-	__disable_irq();
+	uint32_t mask = irq_mask_priority(AUDIO_MASK_PRIORITY);
 	
 	// Remove destination from source list
 	p = src->destination_list;
 	if (p == NULL) {
 //>>> PAH re-enable the IRQ
-		__enable_irq();
+		irq_restore_priority(mask);
 		return 3;
 	} else if (p == this) {
 		if (p->next_dest) {
@@ -398,8 +617,6 @@ int AudioConnection::disconnect(void)
 	//Remove possible pending src block from destination
 	if(dst->inputQueue[dest_index] != NULL) {
 		AudioStream::release(dst->inputQueue[dest_index]);
-		// release() re-enables the IRQ. Need it to be disabled a little longer
-		__disable_irq();
 		dst->inputQueue[dest_index] = NULL;
 	}
 
@@ -417,8 +634,9 @@ int AudioConnection::disconnect(void)
 	isConnected = false;
 	next_dest = dst->unused;
 	dst->unused = this;
+	AudioStream::update_sort();
 
-	__enable_irq();
+	irq_restore_priority(mask);
 	
 	return 0;
 }
@@ -434,40 +652,176 @@ bool AudioStream::update_scheduled = false;
 bool AudioStream::update_setup(void)
 {
 	if (update_scheduled) return false;
+	block_samples_fixed = true;
 	attachInterruptVector(IRQ_SOFTWARE, software_isr);
-	NVIC_SET_PRIORITY(IRQ_SOFTWARE, 208); // 255 = lowest priority
+	NVIC_SET_PRIORITY(IRQ_SOFTWARE, update_domain_priority[0]);
 	NVIC_ENABLE_IRQ(IRQ_SOFTWARE);
+	// update_stop() also disabled the other domains' interrupts
+	for (int i=1; i < update_domains_used; i++) {
+		attachInterruptVector(domain_irq[i], domain_isr[i]);
+		NVIC_SET_PRIORITY(domain_irq[i], update_domain_priority[i]);
+		NVIC_ENABLE_IRQ(domain_irq[i]);
+	}
 	update_scheduled = true;
 	return true;
 }
 
 void AudioStream::update_stop(void)
 {
-	NVIC_DISABLE_IRQ(IRQ_SOFTWARE);
+	for (int i=0; i < update_domains_used; i++) {
+		NVIC_DISABLE_IRQ(domain_irq[i]);
+	}
 	update_scheduled = false;
 }
 
+bool AudioStream::setUpdateDomain(unsigned int domain)
+{
+	if (domain >= AUDIO_UPDATE_DOMAINS) return false;
+	if (domain > 0) {
+		attachInterruptVector(domain_irq[domain], domain_isr[domain]);
+		NVIC_SET_PRIORITY(domain_irq[domain], update_domain_priority[domain]);
+		NVIC_ENABLE_IRQ(domain_irq[domain]);
+	}
+	update_domain = domain;
+	if (domain >= update_domains_used) update_domains_used = domain + 1;
+	return true;
+}
+
+// Lower domains should have lower priority (higher numbers) than domain 0,
+// and every domain must be below the interrupts which call update_all().
+bool AudioStream::setUpdateDomainPriority(unsigned int domain, uint8_t priority)
+{
+	if (domain >= AUDIO_UPDATE_DOMAINS) return false;
+	update_domain_priority[domain] = priority;
+	NVIC_SET_PRIORITY(domain_irq[domain], priority);
+	return true;
+}
+
+void AudioStream::update_all_domains(void)
+{
+	for (int i=1; i < update_domains_used; i++) {
+		NVIC_SET_PENDING(domain_irq[i]);
+	}
+}
+
 AudioStream * AudioStream::first_update = NULL;
 
+// Reorder the update list so every object updates after all objects
+// which transmit to it, so the whole graph adds only 1 block of latency
+// regardless of the order objects were created.  Otherwise creation
+// order is kept.  Feedback loops can't be ordered, so when only loops
+// remain the first waiting object is taken.  Interrupts must be disabled.
+void AudioStream::update_sort(void)
+{
+	AudioStream *s, *sorted, **tail, **pp;
+	AudioConnection *c;
+
+	for (s = first_update; s; s = s->next_update) {
+		s->sort_inputs = 0;
+	}
+	for (s = first_update; s; s = s->next_update) {
+		for (c = s->destination_list; c; c = c->next_dest) {
+			if (c->dst != s) c->dst->sort_inputs++;
+		}
+	}
+	sorted = NULL;
+	tail = &sorted;
+	while (first_update) {
+		for (pp = &first_update; *pp; pp = &((*pp)->next_update)) {
+			if ((*pp)->sort_inputs == 0) break;
+		}
+		if (*pp == NULL) pp = &first_update;
+		s = *pp;
+		*pp = s->next_update;
+		s->next_update = NULL;
+		*tail = s;
+		tail = &(s->next_update);
+		for (c = s->destination_list; c; c = c->next_dest) {
+			if (c->dst->sort_inputs > 0) c->dst->sort_inputs--;
+		}
+	}
+	first_update = sorted;
+}
+
 void software_isr(void) // AudioStream::update_all()
+{
+	software_isr_domain(0);
+}
+
+static void software_isr_domain1(void)
+{
+	software_isr_domain(1);
+}
+
+static void software_isr_domain2(void)
+{
+	software_isr_domain(2);
+}
+
+// Cycles spent in every domain update which has finished.  A domain
+// subtracts the growth during its own update, which is the time it was
+// preempted by higher priority domains.
+static volatile uint32_t domain_elapsed_cycles = 0;
+
+void software_isr_domain(unsigned int domain)
 {
 	AudioStream *p;
+	// a higher priority domain may interrupt a lower one's update()
+	AudioStream *prev_current = AudioStream::update_current;
+	uint32_t prev_ipsr = AudioStream::update_current_ipsr;
+	uint32_t ipsr;
+	__asm__ volatile("mrs %0, ipsr\n" : "=r" (ipsr)::);
+	uint32_t elapsed = domain_elapsed_cycles;
 
 	uint32_t totalcycles = ARM_DWT_CYCCNT;
 	//digitalWriteFast(2, HIGH);
 	for (p = AudioStream::first_update; p; p = p->next_update) {
-		if (p->active) {
+		if (p->active && p->update_domain == domain) {
+			uint32_t preempted = domain_elapsed_cycles;
 			uint32_t cycles = ARM_DWT_CYCCNT;
+			AudioStream::update_current_ipsr = ipsr;
+			AudioStream::update_current = p;
 			p->update();
+			AudioStream::update_current = prev_current;
+			AudioStream::update_current_ipsr = prev_ipsr;
 			// TODO: traverse inputQueueArray and release
 			// any input blocks that weren't consumed?
-			cycles = (ARM_DWT_CYCCNT - cycles) >> 6;
+			cycles = ARM_DWT_CYCCNT - cycles;
+			cycles -= domain_elapsed_cycles - preempted;
+#ifdef AUDIO_PROFILE
+			uint32_t bucket = 32 - __builtin_clz((cycles >> 8) | 1);
+			if (!(cycles >> 8)) bucket = 0;
+			if (bucket >= AUDIO_PROFILE_HISTOGRAM_SIZE) bucket = AUDIO_PROFILE_HISTOGRAM_SIZE - 1;
+			p->profile_histogram[bucket]++;
+			p->profile_updates++;
+			if (cycles > p->profile_cycles_max) p->profile_cycles_max = cycles;
+			uint32_t mem = AudioStream::memory_used + AudioStream::memory_double_used
+				+ AudioStream::memory_f32_used;
+			if (mem > p->profile_memory_max) p->profile_memory_max = mem;
+#endif
+			cycles >>= 6;
 			p->cpu_cycles = cycles;
 			if (cycles > p->cpu_cycles_max) p->cpu_cycles_max = cycles;
 		}
 	}
 	//digitalWriteFast(2, LOW);
-	totalcycles = (ARM_DWT_CYCCNT - totalcycles) >> 6;
+#ifdef AUDIO_PROFILE
+	if (domain == 0) {
+		AudioStream::profile_blocks++;
+		if (ARM_DWT_CYCCNT - totalcycles > (uint32_t)((float)F_CPU_ACTUAL
+		  * ((float)AudioStream::block_samples / AUDIO_SAMPLE_RATE_EXACT))) {
+			AudioStream::profile_blocks_late++;
+		}
+	}
+#endif
+	// the total of all domains, each without time preempted by the others
+	totalcycles = ARM_DWT_CYCCNT - totalcycles;
+	AudioStream::domain_cycles[domain] = (totalcycles - (domain_elapsed_cycles - elapsed)) >> 6;
+	domain_elapsed_cycles = elapsed + totalcycles;
+	totalcycles = 0;
+	for (int i=0; i < AudioStream::update_domains_used; i++) {
+		totalcycles += AudioStream::domain_cycles[i];
+	}
 	AudioStream::cpu_cycles_total = totalcycles;
 	if (totalcycles > AudioStream::cpu_cycles_total_max)
 		AudioStream::cpu_cycles_total_max = totalcycles;
@@ -475,3 +829,75 @@ void software_isr(void) // AudioStream::update_all()
 	asm("DSB");
 }
 
+
+#ifdef AUDIO_PROFILE
+void AudioStream::profileClear(void)
+{
+	profile_updates = 0;
+	profile_cycles_max = 0;
+	for (int i=0; i < AUDIO_PROFILE_HISTOGRAM_SIZE; i++) {
+		profile_histogram[i] = 0;
+	}
+	profile_memory_max = 0;
+}
+
+void AudioStream::profileReset(void)
+{
+	uint32_t mask = irq_mask_priority(AUDIO_MASK_PRIORITY);
+	for (AudioStream *s = first_update; s; s = s->next_update) {
+		s->profileClear();
+		for (AudioConnection *c = s->destination_list; c; c = c->next_dest) {
+			c->profile_sent = 0;
+			c->profile_dropped = 0;
+		}
+	}
+	profile_blocks = 0;
+	profile_blocks_late = 0;
+	irq_restore_priority(mask);
+}
+#endif
+
+// Print usage of every object in update order, which is the number
+// used to identify them.  Call from loop(), not from an interrupt.
+void AudioStream::printProfile(Print &p)
+{
+	AudioStream *s, *d;
+	AudioConnection *c;
+	unsigned int num, dnum;
+
+	p.printf("Audio: %.2f%% CPU (max %.2f%%), memory %u (max %u)",
+		AudioProcessorUsage(), AudioProcessorUsageMax(),
+		memory_used, memory_used_max);
+	if (memory_pool_double) {
+		p.printf(", double %u (max %u)", memory_double_used, memory_double_used_max);
+	}
+	if (memory_pool_f32) {
+		p.printf(", float %u (max %u)", memory_f32_used, memory_f32_used_max);
+	}
+	p.println();
+#ifdef AUDIO_PROFILE
+	p.printf("  %lu blocks, %lu late\n", profile_blocks, profile_blocks_late);
+#endif
+	for (s = first_update, num = 0; s; s = s->next_update, num++) {
+		p.printf("#%u: %.2f%% (max %.2f%%)%s", num, s->processorUsage(),
+			s->processorUsageMax(), s->active ? "" : ", inactive");
+#ifdef AUDIO_PROFILE
+		p.printf(", %lu updates, max %lu cycles, memory max %u\n",
+			s->profile_updates, s->profile_cycles_max, s->profile_memory_max);
+		p.print("  cycles:");
+		for (int i=0; i < AUDIO_PROFILE_HISTOGRAM_SIZE; i++) {
+			if (!s->profile_histogram[i]) continue;
+			p.printf(" <%lu:%lu", 256ul << i, s->profile_histogram[i]);
+		}
+#endif
+		p.println();
+		for (c = s->destination_list; c; c = c->next_dest) {
+			for (d = first_update, dnum = 0; d && d != c->dst; d = d->next_update) dnum++;
+			p.printf("  out %u -> #%u in %u", c->src_index, dnum, c->dest_index);
+#ifdef AUDIO_PROFILE
+			p.printf(": %lu sent, %lu dropped", c->profile_sent, c->profile_dropped);
+#endif
+			p.println();
+		}
+	}
+}
@@ -47,31 +47,73 @@
 // Some parts of the audio library may have hard-coded dependency on 128 samples.
 // Please report these on the forum with reproducible test cases.  The following
 // audio classes are known to have problems with smaller block sizes:
-//   AudioInputUSB, AudioOutputUSB, AudioPlaySdWav, AudioAnalyzeFFT256,
+//   AudioInputUSB, AudioPlaySdWav, AudioAnalyzeFFT256,
 //   AudioAnalyzeFFT1024
 
 #ifndef AUDIO_BLOCK_SAMPLES
 #define AUDIO_BLOCK_SAMPLES  128
 #endif
 
+// AUDIO_BLOCK_SAMPLES is also the largest block size which may be chosen at
+// startup with AudioStream::setBlockSamples(), since every block has room
+// for this many samples.  Objects which support it process only
+// AudioStream::block_samples of them per update.
+#define AUDIO_BLOCK_SAMPLES_MIN  16
+
 #ifndef AUDIO_SAMPLE_RATE_EXACT
 #define AUDIO_SAMPLE_RATE_EXACT 44100.0f
 #endif
 
 #define AUDIO_SAMPLE_RATE AUDIO_SAMPLE_RATE_EXACT
 
+// Define AUDIO_PROFILE to record a histogram of update() time for every
+// object, counts of blocks sent and dropped by every connection, and
+// blocks which missed their deadline.  AudioStream::printProfile() shows
+// these, along with the normal processor and memory usage.
+#define AUDIO_PROFILE_HISTOGRAM_SIZE  16
+
+// Objects may be split into update domains, each run by its own software
+// interrupt.  Domain 0 is the normal update.  Higher domains run at lower
+// priority, so heavy analysis in them is preempted by the next update of
+// the time critical objects in domain 0, rather than delaying it.  Every
+// domain updates once per block.  When a lower domain is still busy, the
+// blocks sent to it are dropped, as for any object which did not receive.
+#define AUDIO_UPDATE_DOMAINS  3
+
 #ifndef __ASSEMBLER__
 class AudioStream;
 class AudioConnection;
+class Print;
 //class AudioDebug;  // for testing only, never for public release
 
 typedef struct audio_block_struct {
 	uint8_t  ref_count;
-	uint8_t  reserved1;
+	uint8_t  memory_pool_num;
 	uint16_t memory_pool_index;
 	int16_t  data[AUDIO_BLOCK_SAMPLES];
 } audio_block_t;
 
+// Double size blocks, for objects needing 2 blocks of samples together
+// (stereo interleaved, 32 bit samples, etc).  The header is the same as
+// audio_block_t, so release() and ref_count work with either type.
+typedef struct audio_block_double_struct {
+	uint8_t  ref_count;
+	uint8_t  memory_pool_num;
+	uint16_t memory_pool_index;
+	int16_t  data[AUDIO_BLOCK_SAMPLES*2];
+} audio_block_double_t;
+
+// 32 bit float blocks, for chains of DSP objects using the FPU without
+// converting to and from int16 in every object.  Objects connected
+// together must agree to send either int16 or float blocks.  The header
+// is again the same, so one connection and input queue handles both.
+typedef struct audio_block_f32_struct {
+	uint8_t  ref_count;
+	uint8_t  memory_pool_num;
+	uint16_t memory_pool_index;
+	float    data[AUDIO_BLOCK_SAMPLES];
+} audio_block_f32_t;
+
 
 
 class AudioConnection
@@ -94,6 +136,10 @@ protected:
 	unsigned char dest_index;
 	AudioConnection *next_dest; // linked list of connections from one source
 	bool isConnected;
+#ifdef AUDIO_PROFILE
+	uint32_t profile_sent;
+	uint32_t profile_dropped; // destination still had the prior block
+#endif
 	//friend class AudioDebug;
 };
 
@@ -103,7 +149,27 @@ protected:
 	AudioStream::initialize_memory(data, num); \
 })
 
-#define CYCLE_COUNTER_APPROX_PERCENT(n) (((float)((uint32_t)(n) * 6400u) * (float)(AUDIO_SAMPLE_RATE_EXACT / AUDIO_BLOCK_SAMPLES)) / (float)(F_CPU_ACTUAL))
+#define AudioMemoryDouble(num) ({ \
+	static DMAMEM audio_block_double_t data[num]; \
+	AudioStream::initialize_memory_double(data, num); \
+})
+
+// A second pool of blocks in DTCM, which is zero wait state, unlike the
+// cached OCRAM used by AudioMemory().  Objects doing DSP in update() get
+// blocks from this pool first, and fall back to AudioMemory() blocks when
+// it is empty.  Objects which call setBlockMemoryDMA(), and allocations
+// from interrupts other than the audio update, always use AudioMemory().
+#define AudioMemoryDTCM(num) ({ \
+	static audio_block_t data[num]; \
+	AudioStream::initialize_memory_dtcm(data, num); \
+})
+
+#define AudioMemoryF32(num) ({ \
+	static DMAMEM audio_block_f32_t data[num]; \
+	AudioStream::initialize_memory_f32(data, num); \
+})
+
+#define CYCLE_COUNTER_APPROX_PERCENT(n) (((float)((uint32_t)(n) * 6400u) * (float)AUDIO_SAMPLE_RATE_EXACT / (float)AudioStream::block_samples) / (float)(F_CPU_ACTUAL))
 
 #define AudioProcessorUsage() (CYCLE_COUNTER_APPROX_PERCENT(AudioStream::cpu_cycles_total))
 #define AudioProcessorUsageMax() (CYCLE_COUNTER_APPROX_PERCENT(AudioStream::cpu_cycles_total_max))
@@ -111,6 +177,12 @@ protected:
 #define AudioMemoryUsage() (AudioStream::memory_used)
 #define AudioMemoryUsageMax() (AudioStream::memory_used_max)
 #define AudioMemoryUsageMaxReset() (AudioStream::memory_used_max = AudioStream::memory_used)
+#define AudioMemoryDoubleUsage() (AudioStream::memory_double_used)
+#define AudioMemoryDoubleUsageMax() (AudioStream::memory_double_used_max)
+#define AudioMemoryDoubleUsageMaxReset() (AudioStream::memory_double_used_max = AudioStream::memory_double_used)
+#define AudioMemoryF32Usage() (AudioStream::memory_f32_used)
+#define AudioMemoryF32UsageMax() (AudioStream::memory_f32_used_max)
+#define AudioMemoryF32UsageMaxReset() (AudioStream::memory_f32_used_max = AudioStream::memory_f32_used)
 
 class AudioStream
 {
@@ -122,8 +194,8 @@ public:
 			for (int i=0; i < num_inputs; i++) {
 				inputQueue[i] = NULL;
 			}
-			// add to a simple list, for update_all
-			// TODO: replace with a proper data flow analysis in update_all
+			// add to a simple list, for update_all.  connect() and
+			// disconnect() sort it into data flow order.
 			if (first_update == NULL) {
 				first_update = this;
 			} else {
@@ -135,44 +207,120 @@ public:
 			cpu_cycles = 0;
 			cpu_cycles_max = 0;
 			numConnections = 0;
+			block_memory_dma = false;
+			update_domain = 0;
+#ifdef AUDIO_PROFILE
+			profileClear();
+#endif
 		}
 	static void initialize_memory(audio_block_t *data, unsigned int num);
+	static void initialize_memory_double(audio_block_double_t *data, unsigned int num);
+	static void initialize_memory_dtcm(audio_block_t *data, unsigned int num);
+	static void initialize_memory_f32(audio_block_f32_t *data, unsigned int num);
+	// Samples per block, a multiple of 16 up to AUDIO_BLOCK_SAMPLES.  Set
+	// it before audio input and output objects begin, since they size
+	// their DMA buffers when they start.  Returns false if not allowed,
+	// including once updates have been scheduled, after which the size
+	// is fixed.  block_samples is read only; use setBlockSamples().
+	static bool setBlockSamples(unsigned int samples);
+	static const unsigned int &block_samples;
 	float processorUsage(void) { return CYCLE_COUNTER_APPROX_PERCENT(cpu_cycles); }
 	float processorUsageMax(void) { return CYCLE_COUNTER_APPROX_PERCENT(cpu_cycles_max); }
 	void processorUsageMaxReset(void) { cpu_cycles_max = cpu_cycles; }
 	bool isActive(void) { return active; }
+	// Move this object to another update domain, see AUDIO_UPDATE_DOMAINS
+	bool setUpdateDomain(unsigned int domain);
+	static bool setUpdateDomainPriority(unsigned int domain, uint8_t priority);
+	static uint16_t domain_cycles[AUDIO_UPDATE_DOMAINS];
+	static void printProfile(Print &p);
+#ifdef AUDIO_PROFILE
+	// histogram bucket 0 is less than 256 cycles, bucket n is 256 << (n-1)
+	// to 256 << n cycles, and the last also counts anything longer
+	uint32_t profile_updates;
+	uint32_t profile_cycles_max;
+	uint32_t profile_histogram[AUDIO_PROFILE_HISTOGRAM_SIZE];
+	uint16_t profile_memory_max; // most blocks in use just after update()
+	static uint32_t profile_blocks;
+	static uint32_t profile_blocks_late; // all updates took over 1 block time
+	static void profileReset(void);
+#endif
 	uint16_t cpu_cycles;
 	uint16_t cpu_cycles_max;
 	static uint16_t cpu_cycles_total;
 	static uint16_t cpu_cycles_total_max;
 	static uint16_t memory_used;
 	static uint16_t memory_used_max;
+	static uint16_t memory_double_used;
+	static uint16_t memory_double_used_max;
+	static uint16_t memory_f32_used;
+	static uint16_t memory_f32_used_max;
 protected:
 	bool active;
 	unsigned char num_inputs;
 	static audio_block_t * allocate(void);
+	// Hint for objects whose blocks go to DMA hardware, or stay in memory
+	// longer than an update like queues and delays, so allocate() uses
+	// the DMAMEM pool and leaves DTCM for short lived processing blocks.
+	void setBlockMemoryDMA(bool dma = true) { block_memory_dma = dma; }
 	static void release(audio_block_t * block);
+	static audio_block_double_t * allocateDouble(void);
+	static void release(audio_block_double_t * block) { release((audio_block_t *)block); }
+	static audio_block_f32_t * allocateF32(void);
+	static void release(audio_block_f32_t * block) { release((audio_block_t *)block); }
 	void transmit(audio_block_t *block, unsigned char index = 0);
+	void transmit(audio_block_f32_t *block, unsigned char index = 0) {
+		transmit((audio_block_t *)block, index);
+	}
 	audio_block_t * receiveReadOnly(unsigned int index = 0);
 	audio_block_t * receiveWritable(unsigned int index = 0);
+	audio_block_f32_t * receiveReadOnlyF32(unsigned int index = 0) {
+		return (audio_block_f32_t *)receiveReadOnly(index);
+	}
+	audio_block_f32_t * receiveWritableF32(unsigned int index = 0);
 	static bool update_setup(void);
 	static void update_stop(void);
-	static void update_all(void) { NVIC_SET_PENDING(IRQ_SOFTWARE); }
-	friend void software_isr(void);
+	static void update_all(void) {
+		NVIC_SET_PENDING(IRQ_SOFTWARE);
+		if (update_domains_used > 1) update_all_domains();
+	}
+	static void update_all_domains(void);
+	friend void software_isr_domain(unsigned int domain);
 	friend class AudioConnection;
 	//friend class AudioDebug;
 	uint8_t numConnections;
+	bool block_memory_dma;
 private:
 	static AudioConnection* unused; // linked list of unused but not destructed connections
 	AudioConnection *destination_list;
 	audio_block_t **inputQueue;
 	static bool update_scheduled;
+	static bool block_samples_fixed;
+	static unsigned int block_samples_value;
 	virtual void update(void) = 0;
 	static AudioStream *first_update; // for update_all
 	AudioStream *next_update; // for update_all
+	uint8_t sort_inputs; // for update_sort
+	uint8_t update_domain;
+	static uint8_t update_domains_used;    // highest domain in use + 1
+	static uint8_t update_domain_priority[AUDIO_UPDATE_DOMAINS];
+	static void update_sort(void);
+#ifdef AUDIO_PROFILE
+	void profileClear(void);
+#endif
 	static audio_block_t *memory_pool;
 	static uint32_t memory_pool_available_mask[];
 	static uint16_t memory_pool_first_mask;
+	static audio_block_t *memory_pool_dtcm;
+	static uint32_t memory_pool_dtcm_available_mask[];
+	static uint16_t memory_pool_dtcm_first_mask;
+	static AudioStream *update_current; // object in update(), for allocate()
+	static uint32_t update_current_ipsr; // exception running update_current
+	static audio_block_double_t *memory_pool_double;
+	static uint32_t memory_pool_double_available_mask[];
+	static uint16_t memory_pool_double_first_mask;
+	static audio_block_f32_t *memory_pool_f32;
+	static uint32_t memory_pool_f32_available_mask[];
+	static uint16_t memory_pool_f32_first_mask;
 };
 
 #if 0
@@ -22,6 +22,102 @@ extern "C" uint32_t set_arm_clock(uint32_t frequency); // clockspeed.c
 static int isvalid(const struct arm_fault_info_struct *info);
 static void cleardata(struct arm_fault_info_struct *info);
 
+#define COUNTERS ((struct crashreport_counters_struct *)0x2027FFE0)
+#define COUNTERS_MAGIC 0x48454C54
+
+static uint32_t counters_sum(const struct crashreport_counters_struct *c)
+{
+  uint32_t sum = COUNTERS_MAGIC;
+  for (int i=0; i < CRASHREPORT_COUNTER_NUM; i++) sum += c->value[i];
+  return sum;
+}
+
+// After power up, the counters hold random data, which is detected by the
+// checksum and cleared.  Must be called with interrupts disabled.
+static struct crashreport_counters_struct * counters_get(void)
+{
+  struct crashreport_counters_struct *c = COUNTERS;
+  if (c->checksum != counters_sum(c)) {
+    for (int i=0; i < CRASHREPORT_COUNTER_NUM; i++) c->value[i] = 0;
+    c->checksum = COUNTERS_MAGIC;
+  }
+  return c;
+}
+
+extern "C" void crashreport_counter_max(unsigned int counter, uint32_t value)
+{
+  if (counter >= CRASHREPORT_COUNTER_NUM) return;
+  uint32_t primask;
+  __asm__ volatile("mrs %0, primask\n" : "=r" (primask)::);
+  __disable_irq();
+  struct crashreport_counters_struct *c = counters_get();
+  if (value > c->value[counter]) {
+    c->checksum += value - c->value[counter];
+    c->value[counter] = value;
+    arm_dcache_flush(c, sizeof(*c));
+  }
+  if (!primask) __enable_irq();
+}
+
+extern "C" void crashreport_counter_add(unsigned int counter, uint32_t n)
+{
+  if (counter >= CRASHREPORT_COUNTER_NUM) return;
+  uint32_t primask;
+  __asm__ volatile("mrs %0, primask\n" : "=r" (primask)::);
+  __disable_irq();
+  struct crashreport_counters_struct *c = counters_get();
+  c->value[counter] += n;
+  c->checksum += n;
+  arm_dcache_flush(c, sizeof(*c));
+  if (!primask) __enable_irq();
+}
+
+extern "C" uint32_t crashreport_counter_read(unsigned int counter)
+{
+  if (counter >= CRASHREPORT_COUNTER_NUM) return 0;
+  uint32_t primask;
+  __asm__ volatile("mrs %0, primask\n" : "=r" (primask)::);
+  __disable_irq();
+  uint32_t val = counters_get()->value[counter];
+  if (!primask) __enable_irq();
+  return val;
+}
+
+FLASHMEM
+void CrashReportClass::clearCounters()
+{
+  __disable_irq();
+  struct crashreport_counters_struct *c = COUNTERS;
+  for (int i=0; i < CRASHREPORT_COUNTER_NUM; i++) c->value[i] = 0;
+  c->checksum = COUNTERS_MAGIC;
+  arm_dcache_flush(c, sizeof(*c));
+  __enable_irq();
+}
+
+FLASHMEM
+static void print_counters(Print& p)
+{
+  static const char * const names[CRASHREPORT_COUNTER_NUM] = {
+    "Max interrupt latency (cycles)", "Max loop time (us)", "Heap peak (bytes)",
+    "USB errors", "Thermal throttle events", "Brownouts", "Startups"
+  };
+  uint32_t value[CRASHREPORT_COUNTER_NUM];
+  uint32_t any = 0;
+  for (int i=0; i < CRASHREPORT_COUNTER_NUM; i++) {
+    value[i] = crashreport_counter_read(i);
+    any |= value[i];
+  }
+  if (!any) return;
+  p.println("  Health counters (kept across warm reset):");
+  for (int i=0; i < CRASHREPORT_COUNTER_NUM; i++) {
+    if (!value[i]) continue;
+    p.print("\t");
+    p.print(names[i]);
+    p.print(": ");
+    p.println(value[i]);
+  }
+}
+
 FLASHMEM
 size_t CrashReportClass::printTo(Print& p) const
 {
@@ -199,6 +295,23 @@ size_t CrashReportClass::printTo(Print& p) const
 	  asm volatile ("dsb":::"memory");
 	  while (1) asm ("wfi");
   }
+  if (tempmon_throttle_stats.steps_down) {
+    p.print("  Thermal throttling reduced the CPU clock ");
+    p.print(tempmon_throttle_stats.steps_down);
+    p.print(" times, at most ");
+    p.print(tempmon_throttle_stats.max_level);
+    p.println(" steps");
+    p.print("\tHottest temperature was ");
+    p.print(tempmon_throttle_stats.max_temp);
+    p.print(" °C, reduced speed for ");
+    p.print(tempmon_throttle_stats.throttled_msec);
+    p.println(" ms");
+    if (tempmon_throttle_level) {
+      p.print("\tStill throttled, now ");
+      p.print(F_CPU_ACTUAL / 1000000);
+      p.println(" MHz");
+    }
+  }
   if (bc->bitmask) {
     for (int i=0; i < 6; i++) {
       if (bc->bitmask & (1 << i)) {
@@ -214,6 +327,7 @@ size_t CrashReportClass::printTo(Print& p) const
     *(volatile uint32_t *)(&bc->bitmask) = 0;
     arm_dcache_flush((void *)bc, sizeof(struct crashreport_breadcrumbs_struct));
   }
+  print_counters(p);
   cleardata(info);
   return 1;
 }
@@ -19,6 +19,11 @@ public:
 			arm_dcache_flush((void *)bc, sizeof(struct crashreport_breadcrumbs_struct));
 		}
 	}
+	// health counters, CRASHREPORT_COUNTER_*, safe to use from interrupts
+	void counterMax(unsigned int counter, uint32_t value) { crashreport_counter_max(counter, value); }
+	void counterAdd(unsigned int counter, uint32_t n = 1) { crashreport_counter_add(counter, n); }
+	uint32_t counter(unsigned int counter) { return crashreport_counter_read(counter); }
+	void clearCounters();
 };
 
 extern CrashReportClass CrashReport;
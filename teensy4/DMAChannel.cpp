@@ -29,6 +29,7 @@
  */
 
 #include "DMAChannel.h"
+#include "EventResponder.h"
 
 // only 16 channels supported, because we don't handle sharing interrupts
 #define DMA_MAX_CHANNELS 16
@@ -37,6 +38,10 @@
 // so C-only code can reserve DMA channels
 uint16_t dma_channel_allocated_mask = 0;
 
+// Channels using attachEvent(), all served by dma_event_isr()
+static EventResponder *dma_event[DMA_MAX_CHANNELS];
+static volatile uint32_t dma_event_mask = 0;
+
 #ifdef CR
 #warning "CR is defined as something?"
 #endif
@@ -92,6 +97,7 @@ void DMAChannel::release(void)
 {
 	if (channel >= DMA_MAX_CHANNELS) return;
 	DMA_CERQ = channel;
+	if (dma_event_mask & (1 << channel)) detachEvent();
 	__disable_irq();
 	dma_channel_allocated_mask &= ~(1 << channel);
 	__enable_irq();
@@ -99,6 +105,45 @@ void DMAChannel::release(void)
 	TCD = (TCD_t *)0;
 }
 
+static void dma_event_isr(void)
+{
+	uint32_t pending = DMA_INT & dma_event_mask;
+	while (pending) {
+		uint32_t ch = 31 - __builtin_clz(pending);
+		pending &= ~(1 << ch);
+		DMA_CINT = ch;
+		EventResponder *event = dma_event[ch];
+		if (event) event->triggerEvent(ch);
+	}
+	asm("dsb");
+}
+
+void DMAChannel::attachEvent(EventResponder &event)
+{
+	if (channel >= DMA_MAX_CHANNELS) return;
+	__disable_irq();
+	dma_event[channel] = &event;
+	dma_event_mask |= (1 << channel);
+	__enable_irq();
+	attachInterrupt(dma_event_isr);
+}
+
+void DMAChannel::attachEvent(EventResponder &event, uint8_t prio)
+{
+	attachEvent(event);
+	if (channel < DMA_MAX_CHANNELS) NVIC_SET_PRIORITY(IRQ_DMA_CH0 + channel, prio);
+}
+
+void DMAChannel::detachEvent(void)
+{
+	if (channel >= DMA_MAX_CHANNELS) return;
+	detachInterrupt();
+	__disable_irq();
+	dma_event_mask &= ~(1 << channel);
+	dma_event[channel] = NULL;
+	__enable_irq();
+}
+
 static uint32_t priority(const DMAChannel &c)
 {
 	uint32_t n;
@@ -143,3 +188,89 @@ void DMAPriorityOrder(DMAChannel &ch1, DMAChannel &ch2, DMAChannel &ch3, DMAChan
 	if (priority(ch3) < priority(ch4)) swap(ch2, ch3);
 }
 
+
+int DMAChain::addBuffer(volatile void *p, unsigned int len, bool interrupt)
+{
+	int first = num;
+	uint32_t addr = (uint32_t)p;
+
+	// check for room first, so a failed add leaves the chain unchanged
+	if (len == 0 || num + (len - 1) / 32767 + 1 > max) return -1;
+	while (len > 0) {
+		unsigned int n = (len > 32767) ? 32767 : len;
+		DMABaseClass::TCD_t *t = list[num].TCD;
+		t->ATTR = DMA_TCD_ATTR_SSIZE(reg_size) | DMA_TCD_ATTR_DSIZE(reg_size);
+		t->NBYTES = 1 << reg_size;
+		if (to_buffer) {
+			t->SADDR = reg;
+			t->SOFF = 0;
+			t->DADDR = (volatile void *)addr;
+			t->DOFF = 1 << reg_size;
+		} else {
+			t->SADDR = (volatile const void *)addr;
+			t->SOFF = 1 << reg_size;
+			t->DADDR = (volatile void *)reg;
+			t->DOFF = 0;
+		}
+		t->SLAST = 0;
+		t->DLASTSGA = 0;
+		t->BITER = n;
+		t->CITER = n;
+		t->CSR = 0;
+		addr += n << reg_size;
+		len -= n;
+		if (len == 0 && interrupt) t->CSR = DMA_TCD_CSR_INTMAJOR;
+		num++;
+	}
+	return first;
+}
+
+void DMAChain::begin(DMAChannel &ch)
+{
+	if (num == 0) return;
+	for (unsigned int i=0; i < num; i++) {
+		DMABaseClass::TCD_t *t = list[i].TCD;
+		t->CSR &= ~(DMA_TCD_CSR_ESG | DMA_TCD_CSR_DREQ | DMA_TCD_CSR_DONE);
+		if (i + 1 < num) {
+			t->DLASTSGA = (int32_t)list[i + 1].TCD;
+			t->CSR |= DMA_TCD_CSR_ESG;
+		} else if (looping) {
+			t->DLASTSGA = (int32_t)list[0].TCD;
+			t->CSR |= DMA_TCD_CSR_ESG;
+		} else {
+			t->DLASTSGA = 0;
+			t->CSR |= DMA_TCD_CSR_DREQ;
+		}
+		prepare(i);
+	}
+	// the DMA reads settings from memory at each scatter-gather
+	if ((uint32_t)list >= 0x20200000u) {
+		arm_dcache_flush_delete(list, num * sizeof(DMASetting));
+	}
+	ch.disable();
+	ch = list[0];
+}
+
+void DMAChain::prepare(unsigned int index)
+{
+	if (index >= num) return;
+	DMABaseClass::TCD_t *t = list[index].TCD;
+	uint32_t len = t->BITER << reg_size;
+	if (to_buffer) {
+		void *p = (void *)t->DADDR;
+		if ((uint32_t)p >= 0x20200000u) arm_dcache_delete(p, len);
+	} else {
+		void *p = (void *)t->SADDR;
+		if ((uint32_t)p >= 0x20200000u) arm_dcache_flush(p, len);
+	}
+}
+
+int DMAChain::current(DMAChannel &ch)
+{
+	int32_t next = ch.TCD->DLASTSGA;
+	if (!(ch.TCD->CSR & DMA_TCD_CSR_ESG)) return num - 1;
+	for (unsigned int i=0; i < num; i++) {
+		if (next == (int32_t)list[i].TCD) return (i > 0) ? i - 1 : num - 1;
+	}
+	return -1;
+}
@@ -53,6 +53,8 @@ extern uint16_t dma_channel_allocated_mask;
 
 #ifdef __cplusplus
 
+class EventResponder;
+
 // known libraries with DMA usage (in need of porting to this new scheme):
 //
 // https://github.com/PaulStoffregen/Audio
@@ -524,6 +526,16 @@ public:
 		NVIC_DISABLE_IRQ(IRQ_DMA_CH0 + channel);
 	}
 
+	// Instead of an interrupt routine, an EventResponder may be
+	// triggered.  A shared interrupt routine clears the interrupt and
+	// calls triggerEvent() with status set to the channel number, so
+	// the responder runs immediately, from yield(), or from a software
+	// interrupt, however it was attached.  Use after DMAPriorityOrder(),
+	// as the event follows the channel number.
+	void attachEvent(EventResponder &event);
+	void attachEvent(EventResponder &event, uint8_t prio);
+	void detachEvent(void);
+
 	void clearInterrupt(void) {
 		DMA_CINT = channel;
 	}
@@ -577,6 +589,67 @@ public:
 	// TCD is accessible due to inheritance from DMABaseClass
 };
 
+// DMAChain builds a list of DMASetting, one per buffer, which a DMA
+// channel uses in order by scatter-gather, so long streams across any
+// number of buffers run without CPU intervention.  One end of every
+// transfer is a single register, set by source() or destination().
+// Buffers in cached memory (DMAMEM, EXTMEM) are flushed (for transmit)
+// or deleted (for receive) by begin(), and by prepare() when reused.
+
+class DMAChain {
+public:
+	// settings is the storage for the list, size is how many it holds
+	DMAChain(DMASetting *settings, unsigned int size) : list(settings), max(size) {}
+
+	// Transmit buffers to a register, usually a peripheral's data register
+	void destination(volatile uint8_t &p) { fixed(&p, 0, false); }
+	void destination(volatile uint16_t &p) { fixed(&p, 1, false); }
+	void destination(volatile uint32_t &p) { fixed(&p, 2, false); }
+	// Receive from a register into the buffers
+	void source(volatile const uint8_t &p) { fixed(&p, 0, true); }
+	void source(volatile const uint16_t &p) { fixed(&p, 1, true); }
+	void source(volatile const uint32_t &p) { fixed(&p, 2, true); }
+
+	// Add a buffer of len elements, which are the size of the register.
+	// Buffers over 32767 elements use more than 1 setting.  Optionally
+	// interrupt when this buffer is finished.  Returns the index of the
+	// buffer's first setting, or -1 if the list is full.
+	int addBuffer(volatile void *p, unsigned int len, bool interrupt=false);
+
+	// Repeat from the first buffer after the last, rather than disabling
+	// the channel when the last buffer completes.
+	void loop(bool repeat=true) { looping = repeat; }
+
+	// Link all the settings, do cache maintenance on all buffers, and
+	// load the first setting into the channel.  Then configure the
+	// trigger and call enable() to start.
+	void begin(DMAChannel &ch);
+
+	// Cache maintenance for 1 setting's buffer, before the DMA uses it
+	// again (after filling a transmit buffer), or before reading
+	// received data.
+	void prepare(unsigned int index);
+
+	// The index of the setting the channel is using now
+	int current(DMAChannel &ch);
+
+	unsigned int count(void) { return num; }
+	DMASetting & operator [] (unsigned int index) { return list[index]; }
+private:
+	void fixed(volatile const void *p, uint8_t size, bool receive) {
+		reg = p;
+		reg_size = size;
+		to_buffer = receive;
+	}
+	DMASetting *list;
+	uint16_t max;
+	uint16_t num = 0;
+	volatile const void *reg = nullptr;
+	uint8_t reg_size = 0;
+	bool to_buffer = false;
+	bool looping = false;
+};
+
 // arrange the relative priority of 2 or more DMA channels
 void DMAPriorityOrder(DMAChannel &ch1, DMAChannel &ch2);
 void DMAPriorityOrder(DMAChannel &ch1, DMAChannel &ch2, DMAChannel &ch3);
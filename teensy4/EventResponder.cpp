@@ -34,11 +34,28 @@
 #include <Arduino.h>
 #include "EventResponder.h"
 
+EventResponder * EventResponder::firstDeferred = nullptr;
 EventResponder * EventResponder::firstYield = nullptr;
 EventResponder * EventResponder::lastYield = nullptr;
 EventResponder * EventResponder::firstInterrupt = nullptr;
 EventResponder * EventResponder::lastInterrupt = nullptr;
 bool EventResponder::runningFromYield = false;
+uint32_t EventResponder::yieldTimeBudget = 0;
+bool EventResponder::threadsActive = false;
+
+// Each thread's stack is allocated together with this small struct.
+// All threads, including the main program, are on a circular list.
+// Only callee saved registers need to be kept, as threads only switch
+// by calling switchThread().
+struct EventResponderThread {
+	uint32_t *sp;                // saved stack pointer, while not running
+	EventResponderThread *next;
+	EventResponder *event;       // nullptr after detach
+	volatile bool busy;          // inside the event function
+};
+
+static EventResponderThread main_thread = {nullptr, &main_thread, nullptr, true};
+static EventResponderThread *current_thread = &main_thread;
 
 // TODO: interrupt disable/enable needed in many places!!!
 // BUGBUG: See if file name order makes difference?
@@ -48,36 +65,36 @@ uint8_t _serialEventUSB2_default __attribute__((weak)) PROGMEM = 0 ;
 
 void EventResponder::triggerEventNotImmediate()
 {
-	bool irq = disableInterrupts();
+	if (!canMaskCaller()) {
+		// A real time interrupt may have preempted code which holds the
+		// lists with only BASEPRI, so briefly use PRIMASK to put this
+		// event on the deferred list, and let PendSV trigger it.
+		uint32_t primask;
+		__asm__ volatile("mrs %0, primask\n" : "=r" (primask)::);
+		__disable_irq();
+		if (!_deferred) {
+			_deferred = true;
+			_nextDeferred = firstDeferred;
+			firstDeferred = this;
+		}
+		if (!primask) __enable_irq();
+		SCB_ICSR = SCB_ICSR_PENDSVSET;
+		return;
+	}
+	uint32_t irq = disableInterrupts();
 	if (_triggered == false) {
 		// not already triggered
 		if (_type == EventTypeYield) {
 			// normal type, called from yield()
-			if (firstYield == nullptr) {
-				_next = nullptr;
-				_prev = nullptr;
-				firstYield = this;
-				lastYield = this;
-			} else {
-				_next = nullptr;
-				_prev = lastYield;
-				_prev->_next = this;
-				lastYield = this;
-			}
+			insertNoInterrupts(&firstYield, &lastYield);
+			yield_ready(YIELD_CHECK_EVENT_RESPONDER);
 		} else if (_type == EventTypeInterrupt) {
 			// interrupt, called from software interrupt
-			if (firstInterrupt == nullptr) {
-				_next = nullptr;
-				_prev = nullptr;
-				firstInterrupt = this;
-				lastInterrupt = this;
-			} else {
-				_next = nullptr;
-				_prev = lastInterrupt;
-				_prev->_next = this;
-				lastInterrupt = this;
-			}
+			insertNoInterrupts(&firstInterrupt, &lastInterrupt);
 			SCB_ICSR = SCB_ICSR_PENDSVSET; // set PendSV interrupt
+		} else if (_type == EventTypeThread) {
+			// thread, runs at its next turn from yield()
+			yield_ready(YIELD_CHECK_EVENT_RESPONDER);
 		} else {
 			// detached, easy :-)
 		}
@@ -86,15 +103,57 @@ void EventResponder::triggerEventNotImmediate()
 	enableInterrupts(irq);
 }
 
+// this insert must be called with interrupts disabled.  The list is kept
+// sorted by priority.  Searching from the end places this event after all
+// others of equal priority, and finds the spot quickly in the common case
+// where most events use the default priority.
+void EventResponder::insertNoInterrupts(EventResponder **first, EventResponder **last)
+{
+	EventResponder *p = *last;
+	while (p && p->_priority > _priority) {
+		p = p->_prev;
+	}
+	_prev = p;
+	if (p) {
+		_next = p->_next;
+		p->_next = this;
+	} else {
+		_next = *first;
+		*first = this;
+	}
+	if (_next) {
+		_next->_prev = this;
+	} else {
+		*last = this;
+	}
+}
+
 extern "C" void pendablesrvreq_isr(void)
 {
+	EventResponder::runDeferred();
 	EventResponder::runFromInterrupt();
 }
 
+// Trigger the events which real time interrupts passed to PendSV.
+void EventResponder::runDeferred()
+{
+	if (!firstDeferred) return;
+	__disable_irq();
+	EventResponder *p = firstDeferred;
+	firstDeferred = nullptr;
+	__enable_irq();
+	while (p) {
+		EventResponder *next = p->_nextDeferred;
+		p->_deferred = false;
+		p->triggerEventNotImmediate();
+		p = next;
+	}
+}
+
 void EventResponder::runFromInterrupt()
 {
 	while (1) {
-		bool irq = disableInterrupts();
+		uint32_t irq = disableInterrupts();
 		EventResponder *first = firstInterrupt;
 		if (first) {
 			firstInterrupt = first->_next;
@@ -116,7 +175,7 @@ void EventResponder::runFromInterrupt()
 bool EventResponder::clearEvent()
 {
 	bool ret = false;
-	bool irq = disableInterrupts();
+	uint32_t irq = disableInterrupts();
 	if (_triggered) {
 		if (_type == EventTypeYield) {
 			if (_prev) {
@@ -179,6 +238,182 @@ void EventResponder::detachNoInterrupts()
 			}
 		}
 		_type = EventTypeDetached;
+	} else if (_type == EventTypeThread) {
+		// the thread may be running (this could be its own function),
+		// so its stack is freed later by switchThread()
+		_thread->event = nullptr;
+		_thread = nullptr;
+		_type = EventTypeDetached;
+	}
+}
+
+// save r4-r11, lr and s16-s31 on the current stack, then restore them
+// from the other stack.  Returns into the other thread.
+static void thread_switch(uint32_t **save_sp, uint32_t *next_sp) __attribute__((naked, noinline));
+static void thread_switch(uint32_t **save_sp, uint32_t *next_sp)
+{
+	asm volatile(
+		"push	{r4-r11, lr}\n"
+		"vpush	{s16-s31}\n"
+		"mov	r2, sp\n"
+		"str	r2, [r0]\n"
+		"mov	sp, r1\n"
+		"vpop	{s16-s31}\n"
+		"pop	{r4-r11, pc}\n");
+}
+
+#define THREAD_FRAME_WORDS 25  // s16-s31, r4-r11, lr
+
+void EventResponder::attachThread(EventResponderFunction function, void *param, size_t stack_size)
+{
+	uint32_t irq = disableInterrupts();
+	detachNoInterrupts();
+	enableInterrupts(irq);
+	if (stack_size < 256) stack_size = 256;
+	uint8_t *mem = (uint8_t *)malloc(sizeof(EventResponderThread) + stack_size + 8);
+	if (!mem) {
+		attach(function);
+		return;
+	}
+	EventResponderThread *t = (EventResponderThread *)mem;
+	uint32_t *top = (uint32_t *)(((uint32_t)mem + sizeof(EventResponderThread) + stack_size) & ~7);
+	uint32_t *sp = top - THREAD_FRAME_WORDS;
+	memset(sp, 0, THREAD_FRAME_WORDS * 4);
+	sp[THREAD_FRAME_WORDS - 1] = (uint32_t)&threadStart; // first pop into pc
+	t->sp = sp;
+	t->event = this;
+	t->busy = false;
+	if (param) _context = param;
+	irq = disableInterrupts();
+	_function = function;
+	_type = EventTypeThread;
+	_thread = t;
+	t->next = main_thread.next;
+	main_thread.next = t;
+	threadsActive = true;
+	yield_active_check_flags |= YIELD_CHECK_EVENT_RESPONDER;
+	yield_ready(YIELD_CHECK_EVENT_RESPONDER);
+	enableInterrupts(irq);
+}
+
+// Every thread begins here, and runs its function each time its
+// EventResponder is triggered.  Never returns.
+void EventResponder::threadStart()
+{
+	EventResponderThread *t = current_thread;
+	while (1) {
+		uint32_t irq = disableInterrupts();
+		EventResponder *event = t->event;
+		bool run = (event && event->_triggered);
+		if (run) {
+			event->_triggered = false;
+			t->busy = true;
+		}
+		enableInterrupts(irq);
+		if (run) {
+			(*(event->_function))(*event);
+			t->busy = false;
+		}
+		switchThread();
+	}
+}
+
+void EventResponder::switchThread()
+{
+	// never switch stacks from an interrupt
+	uint32_t ipsr;
+	__asm__ volatile("mrs %0, ipsr\n" : "=r" (ipsr)::);
+	if (ipsr != 0) return;
+	EventResponderThread *cur = current_thread;
+	// free the stacks of detached threads, except our own
+	EventResponderThread *prev = &main_thread;
+	bool any = false;
+	while (prev->next != &main_thread) {
+		EventResponderThread *t = prev->next;
+		if (t->event == nullptr && !t->busy && t != cur) {
+			uint32_t irq = disableInterrupts();
+			prev->next = t->next;
+			enableInterrupts(irq);
+			free(t);
+		} else {
+			prev = t;
+			any = true;
+		}
+	}
+	if (!any && cur == &main_thread) {
+		threadsActive = false;
+		return;
+	}
+	// round robin, to the next thread which is busy or triggered
+	EventResponderThread *next = cur->next;
+	while (next != cur) {
+		if (next == &main_thread || next->busy) break;
+		if (next->event && next->event->_triggered) break;
+		next = next->next;
+	}
+	if (next == cur) return;
+	current_thread = next;
+	thread_switch(&cur->sp, next->sp);
+}
+
+// true if yield() has an event function or another thread ready to run,
+// so waitForEvent should not sleep.  Call with interrupts disabled.
+bool EventResponder::waitWorkPending()
+{
+	if (firstYield) return true;
+	if (!threadsActive) return false;
+	// waiting inside a thread, the main program is always ready
+	if (current_thread != &main_thread) return true;
+	for (EventResponderThread *t = main_thread.next; t != &main_thread; t = t->next) {
+		if (t->busy || (t->event && t->event->_triggered)) return true;
+	}
+	return false;
+}
+
+bool EventResponder::waitForEvent(EventResponderRef event, int timeout)
+{
+	return waitForEvent(&event, 1, timeout) != nullptr;
+}
+
+EventResponder * EventResponder::waitForEvent(EventResponder *list, int listsize, int timeout)
+{
+	if (!list || listsize <= 0) return nullptr;
+	// attached events may be handled and cleared by yield() while we wait,
+	// so watch each one's trigger count
+	uint16_t count[listsize];
+	for (int i=0; i < listsize; i++) {
+		count[i] = list[i]._triggerCount;
+	}
+	const uint32_t begin = millis();
+	while (1) {
+		EventResponder *found = nullptr;
+		bool timeup = false;
+		// interrupts stay disabled from checking until WFI, so an event
+		// triggered in between leaves its interrupt pending, which wakes
+		// the CPU at once
+		uint32_t primask;
+		__asm__ volatile("mrs %0, primask\n" : "=r" (primask)::);
+		__disable_irq(); // BASEPRI would keep masked interrupts from waking WFI
+		for (int i=0; i < listsize; i++) {
+			EventResponder *e = list + i;
+			if (e->_type == EventTypeDetached ? e->clearEvent()
+			  : (e->_triggered || e->_triggerCount != count[i])) {
+				found = e;
+				break;
+			}
+		}
+		if (!found) {
+			timeup = (timeout >= 0 && millis() - begin >= (uint32_t)timeout);
+			if (!timeup && primask == 0 && !waitWorkPending()) {
+				// sleep until any interrupt, at least the 1 ms systick
+				asm volatile("dsb");
+				asm volatile("wfi");
+			}
+		}
+		if (primask == 0) __enable_irq();
+		if (found) return found;
+		if (timeup) return nullptr;
+		yield();
 	}
 }
 
@@ -187,7 +422,11 @@ void EventResponder::detachNoInterrupts()
 
 
 MillisTimer * MillisTimer::listWaiting = nullptr;
-MillisTimer * MillisTimer::listActive = nullptr;
+MillisTimer * MillisTimer::wheel[MILLISTIMER_WHEEL_LEVELS][MILLISTIMER_WHEEL_SIZE];
+unsigned long MillisTimer::wheelTick = 0;
+
+#define WHEEL_MASK  (MILLISTIMER_WHEEL_SIZE - 1)
+#define WHEEL_RANGE (1ul << (MILLISTIMER_WHEEL_BITS * MILLISTIMER_WHEEL_LEVELS))
 
 void MillisTimer::begin(unsigned long milliseconds, EventResponderRef event)
 {
@@ -211,69 +450,57 @@ void MillisTimer::beginRepeating(unsigned long milliseconds, EventResponderRef e
 
 void MillisTimer::addToWaitingList()
 {
-	_prev = nullptr;
-	bool irq = disableTimerInterrupt();
+	_pprev = nullptr;
+	uint32_t irq = disableTimerInterrupt();
 	_next = listWaiting;
 	listWaiting = this; // TODO: use STREX to avoid interrupt disable
 	_state = TimerWaiting;
 	enableTimerInterrupt(irq);
 }
 
-void MillisTimer::addToActiveList() // only called by runFromTimer()
+// file this timer into the wheel slot for its expire tick (_ms).  Only
+// called by runFromTimer(), or with the timer interrupt disabled.
+void MillisTimer::addToWheel()
 {
-	if (listActive == nullptr) {
-		// list is empty, easy case
-		_next = nullptr;
-		_prev = nullptr;
-		listActive = this;
-	} else if (_ms < listActive->_ms) {
-		// this timer triggers before any on the list
-		_next = listActive;
-		_prev = nullptr;
-		listActive->_prev = this;
-		// Decrement the next items wait time be our wait time as to properly handle waits for all other items...
-		listActive->_ms -= _ms;	
-		listActive = this;
+	unsigned long expire = _ms;
+	unsigned long delta = expire - wheelTick;
+	unsigned int level = 0;
+	if ((long)delta < 0) {
+		// already late, run on the next tick
+		expire = wheelTick;
 	} else {
-		// add this timer somewhere after the first already on the list
-		MillisTimer *timer = listActive;
-		while (timer->_next) {
-			_ms -= timer->_ms;
-			timer = timer->_next;
-			if (_ms < timer->_ms) {
-				// found the right place in the middle of list
-				_next = timer;
-				_prev = timer->_prev;
-				timer->_prev = this;
-				_prev->_next = this;
-				timer->_ms -= _ms;
-				_state = TimerActive;
-				return;
-			}
+		if (delta >= WHEEL_RANGE) {
+			// too far for the wheel, park at the farthest top level slot
+			expire = wheelTick + WHEEL_RANGE - 1;
+			delta = WHEEL_RANGE - 1;
+		}
+		while (delta >= (1ul << (MILLISTIMER_WHEEL_BITS * (level + 1)))) {
+			level++;
 		}
-		// add this time at the end of the list
-		_ms -= timer->_ms;
-		_next = nullptr;
-		_prev = timer;
-		timer->_next = this;
 	}
+	MillisTimer **slot = &wheel[level][(expire >> (MILLISTIMER_WHEEL_BITS * level)) & WHEEL_MASK];
+	_next = *slot;
+	if (_next) _next->_pprev = &_next;
+	_pprev = slot;
+	*slot = this;
 	_state = TimerActive;
 }
 
+// must be called with the timer interrupt disabled
+void MillisTimer::removeFromWheel()
+{
+	*_pprev = _next;
+	if (_next) _next->_pprev = _pprev;
+	_next = nullptr;
+	_pprev = nullptr;
+}
+
 void MillisTimer::end()
 {
-	bool irq = disableTimerInterrupt();
+	uint32_t irq = disableTimerInterrupt();
 	TimerStateType s = _state;
 	if (s == TimerActive) {
-		if (_next) {
-			_next->_prev = _prev;
-			_next->_ms += _ms;   // add in the rest of our timing to next entry...
-		}
-		if (_prev) {
-			_prev->_next = _next;
-		} else {
-			listActive = _next;
-		}
+		removeFromWheel();
 		_state = TimerOff;
 	} else if (s == TimerWaiting) {
 		if (listWaiting == this) {
@@ -293,34 +520,60 @@ void MillisTimer::end()
 	enableTimerInterrupt(irq);
 }
 
+// move every timer in one higher level slot down to the levels below
+void MillisTimer::cascade(unsigned int level, unsigned int index)
+{
+	MillisTimer **slot = &wheel[level][index];
+	while (1) {
+		uint32_t irq = disableTimerInterrupt();
+		MillisTimer *timer = *slot;
+		if (timer) {
+			timer->removeFromWheel();
+			timer->addToWheel();
+		}
+		enableTimerInterrupt(irq);
+		if (!timer) break;
+	}
+}
+
 void MillisTimer::runFromTimer()
 {
-	MillisTimer *timer = listActive;
-	while (timer) {
-		if (timer->_ms > 0) {
-			timer->_ms--;
-			break;
-		} else {
-			MillisTimer *next = timer->_next;
-			if (next) next->_prev = nullptr;
-			listActive = next;
+	unsigned long tick = wheelTick;
+	unsigned int index = tick & WHEEL_MASK;
+	for (unsigned int level=1; index == 0 && level < MILLISTIMER_WHEEL_LEVELS; level++) {
+		index = (tick >> (MILLISTIMER_WHEEL_BITS * level)) & WHEEL_MASK;
+		cascade(level, index);
+	}
+	MillisTimer **slot = &wheel[0][tick & WHEEL_MASK];
+	while (1) {
+		uint32_t irq = disableTimerInterrupt();
+		MillisTimer *timer = *slot;
+		if (timer) {
+			timer->removeFromWheel();
 			timer->_state = TimerOff;
-			EventResponderRef event = *(timer->_event);
-			event.triggerEvent(0, timer);
-			if (timer->_reload) {
-				timer->_ms = timer->_reload;
-				timer->addToActiveList();
-			}
-			timer = listActive;
+		}
+		enableTimerInterrupt(irq);
+		if (!timer) break;
+		EventResponderRef event = *(timer->_event);
+		event.triggerEvent(0, timer);
+		if (timer->_reload && timer->_state == TimerOff) {
+			timer->_ms = tick + timer->_reload;
+			irq = disableTimerInterrupt();
+			timer->addToWheel();
+			enableTimerInterrupt(irq);
 		}
 	}
-	bool irq = disableTimerInterrupt();
+	wheelTick = tick + 1;
+	uint32_t irq = disableTimerInterrupt();
 	MillisTimer *waiting = listWaiting;
 	listWaiting = nullptr; // TODO: use STREX to avoid interrupt disable
 	enableTimerInterrupt(irq);
 	while (waiting) {
 		MillisTimer *next = waiting->_next;
-		waiting->addToActiveList();
+		waiting->_ms += wheelTick;
+		irq = disableTimerInterrupt();
+		waiting->addToWheel();
+		enableTimerInterrupt(irq);
 		waiting = next;
 	}
 }
@@ -341,11 +594,22 @@ void MillisTimer::runFromTimer()
 // TODO: this doesn't work for IMXRT - no longer using predefined names
 extern "C" volatile uint32_t systick_millis_count;
 extern "C" volatile uint32_t systick_cycle_count;
+extern "C" volatile uint32_t systick_cycle_high;
+extern "C" volatile uint32_t systick_millis_high;
+
+// extend the cycle counter and millis to 64 bits, for cycles64() and nanos()
+static inline void systick_update(void) __attribute__((always_inline));
+static inline void systick_update(void)
+{
+	uint32_t cyccnt = ARM_DWT_CYCCNT;
+	if (cyccnt < systick_cycle_count) systick_cycle_high++;
+	systick_cycle_count = cyccnt;
+	if (++systick_millis_count == 0) systick_millis_high++;
+}
 extern "C" uint32_t systick_safe_read; // micros() synchronization
 extern "C" void systick_isr(void)
 {
-	systick_cycle_count = ARM_DWT_CYCCNT;
-	systick_millis_count++;
+	systick_update();
 }
 
 // Entry to any ARM exception clears the LDREX exclusive access flag.
@@ -357,8 +621,46 @@ extern "C" void systick_isr(void)
 
 extern "C" void systick_isr_with_timer_events(void)
 {
-	systick_cycle_count = ARM_DWT_CYCCNT;
-	systick_millis_count++;
+	systick_update();
 	MillisTimer::runFromTimer();
 }
 
+
+extern "C" unsigned long _estack;
+
+static MillisTimer stack_monitor_timer;
+static EventResponder stack_monitor_check;
+static EventResponder *stack_monitor_event = nullptr;
+static const uint32_t *stack_monitor_limit;
+static volatile bool stack_monitor_fired;
+
+static void stack_monitor_run(EventResponderRef)
+{
+	if (stack_monitor_fired || !stack_monitor_event) return;
+	const uint32_t *p = stack_monitor_limit;
+	for (int i=0; i < 16; i++) {
+		if (*--p != STACK_PAINT) {
+			stack_monitor_fired = true;
+			stack_monitor_event->triggerEvent(stackHighWater());
+			return;
+		}
+	}
+}
+
+bool stackMonitor(EventResponderRef event, uint32_t threshold, uint32_t interval)
+{
+	if (threshold + 64 > stackSize() || interval == 0) return false;
+	stackMonitorEnd();
+	stack_monitor_limit = (const uint32_t *)(((uint32_t)&_estack - threshold) & ~3);
+	stack_monitor_event = &event;
+	stack_monitor_fired = false;
+	stack_monitor_check.attachImmediate(stack_monitor_run);
+	stack_monitor_timer.beginRepeating(interval, stack_monitor_check);
+	return true;
+}
+
+void stackMonitorEnd()
+{
+	stack_monitor_timer.end();
+	stack_monitor_event = nullptr;
+}
@@ -53,6 +53,12 @@
  * substantial time.  While your function runs, no other event functions
  * (attached the same way) are able to run.
  *
+ * Events waiting to be called from yield() or from the software
+ * interrupt are queued by the priority given to attach() or
+ * attachInterrupt().  As with hardware interrupts, lower numbers are
+ * more urgent.  Events with equal priority are called in the order
+ * they were triggered.
+ *
  * If your EventResponder is triggered more than once before your
  * function can run, only the last trigger is used.  Prior triggering,
  * including the status integer and data pointer, are overwritten and
@@ -61,7 +67,10 @@
  */
 extern "C" void systick_isr_with_timer_events(void);
 
+#define EVENTRESPONDER_THREAD_STACK_SIZE 2048
+
 class EventResponder;
+struct EventResponderThread;
 typedef EventResponder& EventResponderRef;
 typedef void (*EventResponderFunction)(EventResponderRef);
 class EventResponder
@@ -82,11 +91,13 @@ public:
 
 	// Attach a function to be called from yield().  This should be the
 	// default way to use EventResponder.  Calls from yield() allow use
-	// of Arduino libraries, String, Serial, etc.
+	// of Arduino libraries, String, Serial, etc.  Lower priority numbers
+	// are called first.
 	void attach(EventResponderFunction function, uint8_t priority=128) {
-		bool irq = disableInterrupts();
+		uint32_t irq = disableInterrupts();
 		detachNoInterrupts();
 		_function = function;
+		_priority = priority;
 		_type = EventTypeYield;
 		yield_active_check_flags |= YIELD_CHECK_EVENT_RESPONDER; // user setup a yield type...
 		enableInterrupts(irq);
@@ -96,7 +107,7 @@ public:
 	// fastest possible response, but your function must be carefully
 	// designed.
 	void attachImmediate(EventResponderFunction function) {
-		bool irq = disableInterrupts();
+		uint32_t irq = disableInterrupts();
 		detachNoInterrupts();
 		_function = function;
 		_type = EventTypeImmediate;
@@ -109,9 +120,10 @@ public:
 	// interrupts, this allow fast interrupt-based response, but with less
 	// disruption to other libraries requiring their own interrupts.
 	void attachInterrupt(EventResponderFunction function, uint8_t priority=128) {
-		bool irq = disableInterrupts();
+		uint32_t irq = disableInterrupts();
 		detachNoInterrupts();
 		_function = function;
+		_priority = priority;
 		_type = EventTypeInterrupt;
 		SCB_SHPR3 |= 0x00FF0000; // configure PendSV, lowest priority
 		// Make sure we are using the systic ISR that process this
@@ -119,16 +131,19 @@ public:
 		enableInterrupts(irq);
 	}
 
-	// Attach a function to be called as its own thread.  Boards not running
-	// a RTOS or pre-emptive scheduler shall implement this as attach().
-	void attachThread(EventResponderFunction function, void *param=nullptr) {
-		attach(function); // for non-RTOS usage, compile as default attach
-	}
+	// Attach a function to be called as its own thread.  Threads are
+	// cooperative: each time your function calls yield(), delay(), or
+	// waits for Stream input, other threads and the main program get a
+	// turn to run.  The thread has its own stack, allocated with malloc.
+	// If memory can not be allocated, this works the same as attach().
+	// The optional param is stored as the context, see setContext().
+	void attachThread(EventResponderFunction function, void *param=nullptr,
+	  size_t stack_size=EVENTRESPONDER_THREAD_STACK_SIZE);
 
 	// Do not call any function.  The user's program must occasionally check
 	// whether the event has occurred, or use one of the wait functions.
 	void detach() {
-		bool irq = disableInterrupts();
+		uint32_t irq = disableInterrupts();
 		detachNoInterrupts();
 		enableInterrupts(irq);
 	}
@@ -137,6 +152,7 @@ public:
 	// The code triggering the event does NOT control which of the above
 	// response methods will be used.
 	virtual void triggerEvent(int status=0, void *data=nullptr) {
+		_triggerCount++;
 		_status = status;
 		_data = data;
 		if (_type == EventTypeImmediate) {
@@ -168,10 +184,24 @@ public:
 	void setContext(void *context) { _context = context; }
 	void * getContext() { return _context; }
 
-	// Wait for event(s) to occur.  These are most likely to be useful when
-	// used with a scheduler or RTOS.
+	// Wait for event(s) to occur, up to timeout milliseconds, or forever
+	// if timeout is negative.  While waiting, yield() is called so other
+	// events, threads and serialEvent still run, and the CPU sleeps until
+	// the next interrupt when nothing else needs to run.  An event which
+	// was triggered before waiting, and not yet handled, counts.  Detached
+	// events are cleared when waitForEvent returns them.  The list
+	// version waits for any event in an array, and returns the first
+	// which occurred, or nullptr after the timeout.
 	bool waitForEvent(EventResponderRef event, int timeout);
 	EventResponder * waitForEvent(EventResponder *list, int listsize, int timeout);
+	// Limit how long a single yield() may spend calling event functions.
+	// By default (zero) only one function is called per yield().  With a
+	// budget, functions are called in priority order until no events
+	// remain or the time has been used.  The budget is checked after each
+	// function returns, so one slow function can still exceed it.
+	static void setYieldTimeBudget(uint32_t microseconds) {
+		yieldTimeBudget = microseconds;
+	}
 	static void runFromYield() {
 		if (!firstYield) return;  
 		// First, check if yield was called from an interrupt
@@ -179,38 +209,54 @@ public:
 		uint32_t ipsr;
 		__asm__ volatile("mrs %0, ipsr\n" : "=r" (ipsr)::);
 		if (ipsr != 0) return;
-		// Next, check if any events have been triggered
-		bool irq = disableInterrupts();
-		EventResponder *first = firstYield;
-		if (first == nullptr) {
-			enableInterrupts(irq);
-			return;
-		}
-		// Finally, make sure we're not being recursively called,
+		// Next, make sure we're not being recursively called,
 		// which can happen if the user's function does anything
 		// that calls yield.
-		if (runningFromYield) {
-			enableInterrupts(irq);
-			return;
-		}
-		// Ok, update the runningFromYield flag and process event
+		if (runningFromYield) return;
 		runningFromYield = true;
-		firstYield = first->_next;
-		if (firstYield) {
-			firstYield->_prev = nullptr;
-		} else {
-			lastYield = nullptr;
+		const uint32_t budget = yieldTimeBudget;
+		const uint32_t begin = budget ? micros() : 0;
+		while (1) {
+			// Always take the head of the queue, so an urgent event
+			// triggered by a prior function runs before older, less
+			// urgent events.
+			uint32_t irq = disableInterrupts();
+			EventResponder *first = firstYield;
+			if (first == nullptr) {
+				enableInterrupts(irq);
+				break;
+			}
+			firstYield = first->_next;
+			if (firstYield) {
+				firstYield->_prev = nullptr;
+			} else {
+				lastYield = nullptr;
+			}
+			enableInterrupts(irq);
+			first->_triggered = false;
+			(*(first->_function))(*first);
+			if (budget == 0 || (micros() - begin) >= budget) break;
 		}
-		enableInterrupts(irq);
-		first->_triggered = false;
-		(*(first->_function))(*first);
 		runningFromYield = false;
 	}
 	static void runFromInterrupt();
+	static void runDeferred();
+	// Give the next thread willing to run a turn.  Called by yield().
+	static void runThreads() {
+		if (threadsActive) switchThread();
+	}
+	// True if yield() needs to call runFromYield() or runThreads() again
+	static bool yieldPending() {
+		return firstYield != nullptr || threadsActive;
+	}
 	operator bool() { return _triggered; }
 protected:
 	void triggerEventNotImmediate();
 	void detachNoInterrupts();
+	void insertNoInterrupts(EventResponder **first, EventResponder **last);
+	static void switchThread();
+	static void threadStart();
+	static bool waitWorkPending();
 	int _status = 0;
 	EventResponderFunction _function = nullptr;
 	void *_data = nullptr;
@@ -219,23 +265,53 @@ protected:
 	EventResponder *_prev = nullptr;
 	EventType _type = EventTypeDetached;
 	bool _triggered = false;
+	bool _deferred = false;		// on the deferred list, see triggerEventNotImmediate()
+	uint8_t _priority = 128;
+	volatile uint16_t _triggerCount = 0;	// lets waitForEvent see events already handled
+	EventResponderThread *_thread = nullptr;
+	EventResponder *_nextDeferred = nullptr;
+	static EventResponder *firstDeferred;
 	static EventResponder *firstYield;
 	static EventResponder *lastYield;
 	static EventResponder *firstInterrupt;
 	static EventResponder *lastInterrupt;
 	static bool runningFromYield;
+	static uint32_t yieldTimeBudget;
+	static bool threadsActive;
 private:
-	static bool disableInterrupts() {
-		uint32_t primask;
-		__asm__ volatile("mrs %0, primask\n" : "=r" (primask)::);
-		__disable_irq();
-		return (primask == 0) ? true : false;
+	// Events may be triggered by any interrupt down to systick and PendSV,
+	// which run MillisTimer and runFromInterrupt().  Only those levels are
+	// masked, so real time interrupts more urgent than IRQ_PRIORITY_SYSTICK
+	// are never delayed.  When they trigger events, the event is passed to
+	// PendSV, which adds it to the lists.
+	static bool canMaskCaller() {
+		uint32_t ipsr;
+		__asm__ volatile("mrs %0, ipsr\n" : "=r" (ipsr)::);
+		ipsr &= 0x1FF;
+		if (ipsr == 0) return true;			// main program or thread
+		if (ipsr == 14 || ipsr == 15) return true;	// PendSV or systick
+		if (ipsr < 16) return false;			// faults, NMI, SVCall
+		return NVIC_GET_PRIORITY(ipsr - 16) >= IRQ_PRIORITY_SYSTICK;
 	}
-	static void enableInterrupts(bool doit) {
-		if (doit) __enable_irq();
+	static uint32_t disableInterrupts() {
+		return irq_mask_priority(IRQ_PRIORITY_SYSTICK);
+	}
+	static void enableInterrupts(uint32_t prev) {
+		irq_restore_priority(prev);
 	}
 };
 
+// MillisTimer keeps active timers in a hierarchical timing wheel.  Each
+// level has MILLISTIMER_WHEEL_SIZE slots, and each slot of a level spans
+// all the slots of the level below.  Starting or ending a timer is a
+// constant time operation, and each systick only looks at one slot,
+// plus occasionally moves one slot of a higher level down to the level
+// below.  Timers longer than the wheel's range are parked in the top
+// level and re-filed each time they come around.
+#define MILLISTIMER_WHEEL_BITS   5
+#define MILLISTIMER_WHEEL_SIZE   (1 << MILLISTIMER_WHEEL_BITS)
+#define MILLISTIMER_WHEEL_LEVELS 4
+
 class MillisTimer
 {
 public:
@@ -250,11 +326,13 @@ public:
 	static void runFromTimer();
 private:
 	void addToWaitingList();
-	void addToActiveList();
-	unsigned long _ms = 0;
+	void addToWheel();
+	void removeFromWheel();
+	static void cascade(unsigned int level, unsigned int index);
+	unsigned long _ms = 0;      // delay while waiting, expire tick while active
 	unsigned long _reload = 0;
 	MillisTimer *_next = nullptr;
-	MillisTimer *_prev = nullptr;
+	MillisTimer **_pprev = nullptr; // pointer which points to this timer
 	EventResponder *_event = nullptr;
 	enum TimerStateType {
 		TimerOff = 0,
@@ -263,7 +341,49 @@ private:
 	};
 	volatile TimerStateType _state = TimerOff;
 	static MillisTimer *listWaiting; // single linked list of waiting to start timers
-	static MillisTimer *listActive;  // double linked list of running timers
+	static MillisTimer *wheel[MILLISTIMER_WHEEL_LEVELS][MILLISTIMER_WHEEL_SIZE];
+	static unsigned long wheelTick;  // the tick runFromTimer() will process next
+	static uint32_t disableTimerInterrupt() {
+		return irq_mask_priority(IRQ_PRIORITY_SYSTICK);
+	}
+	static void enableTimerInterrupt(uint32_t prev) {
+		irq_restore_priority(prev);
+	}
+};
+
+// MicrosTimer provides microsecond resolution timers, any number of
+// which share compare channel 1 of GPT2.  Active timers are kept in a
+// list sorted by deadline, and the compare register is always set for
+// the earliest one.  GPT2 counts the 24 MHz clock, so timers may be as
+// long as MICROSTIMER_MAX_MICROSECONDS.  As with MillisTimer, your
+// EventResponder is triggered from the timer interrupt.
+#define MICROSTIMER_MAX_MICROSECONDS  (0x7FFFFFFFul / 24)
+
+class MicrosTimer
+{
+public:
+	constexpr MicrosTimer() {
+	}
+	~MicrosTimer() {
+		end();
+	}
+	bool begin(unsigned long microseconds, EventResponderRef event);
+	bool beginRepeating(unsigned long microseconds, EventResponderRef event);
+	void end();
+	operator bool() { return _active; }
+private:
+	bool begin(unsigned long microseconds, uint32_t period, EventResponderRef event);
+	void addToActiveList();
+	void removeFromActiveList();
+	static void isr();
+	uint32_t _deadline = 0;  // GPT2 count when this timer expires
+	uint32_t _period = 0;    // in 24 MHz ticks, zero for one-shot
+	MicrosTimer *_next = nullptr;
+	MicrosTimer *_prev = nullptr;
+	EventResponder *_event = nullptr;
+	volatile bool _active = false;
+	static MicrosTimer *listActive;  // double linked list sorted by _deadline
+	static bool hardwareReady;
 	static bool disableTimerInterrupt() {
 		uint32_t primask;
 		__asm__ volatile("mrs %0, primask\n" : "=r" (primask)::);
@@ -275,4 +395,12 @@ private:
 	}
 };
 
+// Early warning of stack overflow.  Every interval milliseconds, from the
+// systick interrupt, checks the 64 bytes of stack just below threshold
+// bytes of use, and triggers event once, with the status stackHighWater(),
+// if any were written.  Only this small window is checked, so a large
+// local array which is never written may skip over it unnoticed.
+bool stackMonitor(EventResponderRef event, uint32_t threshold, uint32_t interval = 100);
+void stackMonitorEnd();
+
 #endif
@@ -33,6 +33,7 @@
 #ifdef __cplusplus
 
 #include <Arduino.h>
+#include "EventResponder.h"
 
 #define FILE_READ  0
 #define FILE_WRITE 1
@@ -78,6 +79,46 @@ protected:
 	virtual bool getModifyTime(DateTimeFields &tm) { return false; }
 	virtual bool setCreateTime(const DateTimeFields &tm) { return false; }
 	virtual bool setModifyTime(const DateTimeFields &tm) { return false; }
+	// Asynchronous IO.  These begin a transfer and return true if it was
+	// accepted.  When complete, event.triggerEvent() is called with the
+	// number of bytes transferred as its status (negative for errors) and
+	// buf as its data.  The buffer must not be touched until then.  Media
+	// without overlapped IO use these defaults, which do the transfer before
+	// returning, so existing FileImpl libraries need no changes.
+	virtual bool readAsync(void *buf, size_t nbyte, EventResponderRef event) {
+		event.triggerEvent(read(buf, nbyte), buf);
+		return true;
+	}
+	virtual bool writeAsync(const void *buf, size_t size, EventResponderRef event) {
+		event.triggerEvent(write(buf, size), (void *)buf);
+		return true;
+	}
+	virtual bool flushAsync(EventResponderRef event) {
+		flush();
+		event.triggerEvent(0, nullptr);
+		return true;
+	}
+	// true while an asynchronous transfer started by this file is pending
+	virtual bool asyncBusy() { return false; }
+	// hint that nbyte starting at pos will be read soon, so media with a
+	// cache may begin fetching it.  Returns false if ignored.
+	virtual bool prefetch(uint64_t pos, size_t nbyte) { return false; }
+	// Zero-copy reading.  lendReadBuffer() points *ptr at the next bytes of
+	// the file inside the implementation's own buffer or sector cache, sets
+	// *len to how many are there (no more than *len on entry, zero for any
+	// amount), and moves the position past them.  The bytes stay valid until
+	// releaseReadBuffer(), which must be called before any other access to
+	// the file.  The default returns false, so callers use read() instead.
+	virtual bool lendReadBuffer(const void **ptr, size_t *len) { return false; }
+	virtual void releaseReadBuffer() { }
+	// Memory-mapped reading.  Media which the CPU can read directly, like
+	// LittleFS_Program in the unused program flash, may return a pointer to
+	// the file's first byte when all of it is stored contiguously.  Lookup
+	// tables and other assets can then be used in place, with no copy.  The
+	// pointer is valid until the file is closed or written, and must not be
+	// used by interrupts which run while the flash is being written.  The
+	// default returns nullptr, so callers use read() instead.
+	virtual const void * mappedData() { return nullptr; }
 private:
 	friend class File;
 	unsigned int refcount = 0; // number of File instances referencing this FileImpl
@@ -162,6 +203,40 @@ public:
 	size_t read(void *buf, size_t nbyte) {
 		return (f) ? f->read(buf, nbyte) : 0;
 	}
+	// Begin a read or write and return without waiting for the media.
+	// The event is triggered when done, with the byte count as status.
+	// Do not access buf or start other IO on this file until then.
+	bool readAsync(void *buf, size_t nbyte, EventResponderRef event) {
+		return (f) ? f->readAsync(buf, nbyte, event) : false;
+	}
+	bool writeAsync(const void *buf, size_t size, EventResponderRef event) {
+		return (f) ? f->writeAsync(buf, size, event) : false;
+	}
+	bool flushAsync(EventResponderRef event) {
+		return (f) ? f->flushAsync(event) : false;
+	}
+	bool asyncBusy() {
+		return (f) ? f->asyncBusy() : false;
+	}
+	bool prefetch(uint64_t pos, size_t nbyte) {
+		return (f) ? f->prefetch(pos, nbyte) : false;
+	}
+	// Borrow the file's internal buffer instead of copying with read():
+	//   const void *p; size_t n = 0;
+	//   if (file.lendReadBuffer(&p, &n)) { use(p, n); file.releaseReadBuffer(); }
+	//   else { n = file.read(buf, sizeof(buf)); }
+	bool lendReadBuffer(const void **ptr, size_t *len) {
+		return (f && ptr && len) ? f->lendReadBuffer(ptr, len) : false;
+	}
+	void releaseReadBuffer() {
+		if (f) f->releaseReadBuffer();
+	}
+	// Read-only pointer to the whole file in memory, or nullptr if the
+	// media can't provide one:
+	//   const int16_t *table = (const int16_t *)file.mappedData();
+	const void * mappedData() {
+		return (f) ? f->mappedData() : nullptr;
+	}
 
 	// override print version
 	virtual size_t write(const uint8_t *buf, size_t size) {
@@ -243,6 +318,9 @@ public:
 	size_t readBytes(char *buffer, size_t length) {
 		return read(buffer, length);
 	}
+	virtual size_t readBulk(uint8_t *buffer, size_t length) {
+		return read(buffer, length);
+	}
 	size_t write(unsigned long n) { return write((uint8_t)n); }
 	size_t write(long n) { return write((uint8_t)n); }
 	size_t write(unsigned int n) { return write((uint8_t)n); }
@@ -264,6 +342,21 @@ private:
 };
 
 
+// One directory entry, as given to the FS::readDirectory() callback.  The
+// name is only valid until the callback returns.
+struct DirectoryEntry {
+	const char *name;
+	uint64_t size;
+	bool isDirectory;
+	bool hasCreateTime;  // false if the media does not store it
+	bool hasModifyTime;
+	DateTimeFields createTime;
+	DateTimeFields modifyTime;
+};
+// return false to stop listing
+typedef bool (*DirectoryCallback)(const DirectoryEntry &entry, void *context);
+
+
 class FS
 {
 public:
@@ -282,6 +375,42 @@ public:
 	virtual bool mediaPresent() {
 		return true;
 	}
+	// List a directory by calling fn for each entry, with its name, size
+	// and timestamps.  Returns the number of entries given to fn, or -1 if
+	// dirpath is not a directory.
+	int readDirectory(const char *dirpath, DirectoryCallback fn, void *context) {
+		return readDirectoryEntries(dirpath, fn, context);
+	}
+	// the same, with a lambda or other function object:
+	//   SD.readDirectory("/logs", [](const DirectoryEntry &e) {
+	//     Serial.println(e.name); return true; });
+	template <typename F>
+	int readDirectory(const char *dirpath, F fn) {
+		return readDirectoryEntries(dirpath, [](const DirectoryEntry &entry, void *context) {
+			return (bool)(*(F *)context)(entry); }, &fn);
+	}
+	// This default opens every entry with openNextFile().  Filesystems
+	// which can decode entries straight from the directory structure
+	// should override it, so large directories list without creating a
+	// FileImpl per entry.
+	virtual int readDirectoryEntries(const char *dirpath, DirectoryCallback fn, void *context) {
+		File dir = open(dirpath);
+		if (!dir || !dir.isDirectory()) return -1;
+		DirectoryEntry entry;
+		int count = 0;
+		while (1) {
+			File file = dir.openNextFile();
+			if (!file) break;
+			entry.name = file.name();
+			entry.isDirectory = file.isDirectory();
+			entry.size = entry.isDirectory ? 0 : file.size();
+			entry.hasCreateTime = file.getCreateTime(entry.createTime);
+			entry.hasModifyTime = file.getModifyTime(entry.modifyTime);
+			count++;
+			if (!fn(entry, context)) break;
+		}
+		return count;
+	}
 	// for compatibility with String input
 	File open(const String &filepath, uint8_t mode = FILE_READ) {
 		return open(filepath.c_str(), mode);
@@ -307,6 +436,9 @@ public:
 	bool rmdir(const String &filepath) {
 		return rmdir(filepath.c_str());
 	}
+	int readDirectory(const String &dirpath, DirectoryCallback fn, void *context) {
+		return readDirectory(dirpath.c_str(), fn, context);
+	}
 };
 
 
@@ -0,0 +1,221 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "FlexIO.h"
+#include "DMAChannel.h"
+#include "core_pins.h"
+
+FlexIOModule FlexIO1(1);
+FlexIOModule FlexIO2(2);
+FlexIOModule FlexIO3(3);
+
+#define FLEXIO_PIN_MUX  (IOMUXC_PAD_SRE | IOMUXC_PAD_DSE(3) | IOMUXC_PAD_SPEED(3))
+
+IMXRT_FLEXIO_t & FlexIOModule::regs() const
+{
+	if (num == 1) return IMXRT_FLEXIO1_S;
+	if (num == 2) return IMXRT_FLEXIO2_S;
+	return IMXRT_FLEXIO3_S;
+}
+
+bool FlexIOModule::begin()
+{
+	if (num == 1) CCM_CCGR5 |= CCM_CCGR5_FLEXIO1(CCM_CCGR_ON);
+	else if (num == 2) CCM_CCGR3 |= CCM_CCGR3_FLEXIO2(CCM_CCGR_ON);
+	else CCM_CCGR7 |= CCM_CCGR7_FLEXIO3(CCM_CCGR_ON);
+	IMXRT_FLEXIO_t &r = regs();
+	if (!(r.CTRL & FLEXIO_CTRL_FLEXEN)) r.CTRL |= FLEXIO_CTRL_FLEXEN;
+	return true;
+}
+
+uint32_t FlexIOModule::clock() const
+{
+	uint32_t sel, pred, podf;
+	if (num == 1) {
+		uint32_t cdcdr = CCM_CDCDR;
+		sel = (cdcdr >> 7) & 3;
+		pred = (cdcdr >> 12) & 7;
+		podf = (cdcdr >> 9) & 7;
+	} else {
+		// FlexIO2 and FlexIO3 share one clock root
+		uint32_t cs1cdr = CCM_CS1CDR;
+		sel = (CCM_CSCMR2 >> 19) & 3;
+		pred = (cs1cdr >> 9) & 7;
+		podf = (cs1cdr >> 25) & 7;
+	}
+	uint32_t freq;
+	if (sel == 1) {
+		uint32_t frac = (CCM_ANALOG_PFD_480 >> 16) & 0x3F; // PLL3 PFD2
+		if (frac < 12) return 0;
+		freq = (uint64_t)480000000 * 18 / frac;
+	} else if (sel == 3) {
+		freq = 480000000; // PLL3
+	} else {
+		return 0;
+	}
+	return freq / (pred + 1) / (podf + 1);
+}
+
+int FlexIOModule::pinIndex(uint8_t pin) const
+{
+	if (pin >= CORE_NUM_DIGITAL) return -1;
+	const struct digital_pin_bitband_and_config_table_struct *p = digital_pin_to_info_PGM + pin;
+	int bit = __builtin_ctz(p->mask);
+	// either the fast GPIO port or its normal twin, see pinFastGPIO()
+	if (num == 1 && (p->reg == &GPIO9_DR || p->reg == &GPIO4_DR)
+	  && bit >= 4 && bit <= 8) return bit;                                 // EMC_04-08
+	if (num == 2 && (p->reg == &GPIO7_DR || p->reg == &GPIO2_DR)) return bit; // B0, B1
+	if (num == 3 && (p->reg == &GPIO6_DR || p->reg == &GPIO1_DR)
+	  && bit >= 16) return bit - 16;                                       // AD_B1
+	return -1;
+}
+
+FlexIOModule * FlexIOModule::forPin(uint8_t pin)
+{
+	if (FlexIO2.pinIndex(pin) >= 0) return &FlexIO2;
+	if (FlexIO1.pinIndex(pin) >= 0) return &FlexIO1;
+	if (FlexIO3.pinIndex(pin) >= 0) return &FlexIO3;
+	return nullptr;
+}
+
+int FlexIOModule::claimPin(uint8_t pin)
+{
+	int n = pinIndex(pin);
+	if (n < 0) return -1;
+	__disable_irq();
+	if (pins_used & (1u << n)) {
+		__enable_irq();
+		return -1;
+	}
+	pins_used |= 1u << n;
+	__enable_irq();
+	*(portControlRegister(pin)) = FLEXIO_PIN_MUX;
+	*(portConfigRegister(pin)) = (num == 3) ? 9 : 4;
+	return n;
+}
+
+void FlexIOModule::releasePin(uint8_t pin)
+{
+	int n = pinIndex(pin);
+	if (n < 0 || !(pins_used & (1u << n))) return;
+	__disable_irq();
+	pins_used &= ~(1u << n);
+	__enable_irq();
+	pinMode(pin, INPUT_DISABLE);
+}
+
+uint8_t FlexIOModule::shifterCount() const
+{
+	return (num == 1) ? 4 : 8;
+}
+
+uint8_t FlexIOModule::timerCount() const
+{
+	return (num == 1) ? 4 : 8;
+}
+
+int FlexIOModule::claimShifter(bool dma)
+{
+	__disable_irq();
+	if (dma) {
+		// only shifters 0 to 3 of FlexIO1 and FlexIO2 have DMA requests,
+		// one per pair of shifters
+		for (int n=0; n < ((num == 3) ? 0 : 4); n++) {
+			if (shifters_used & (1 << n)) continue;
+			if (dma_shifters & (3 << (n & 2))) continue;
+			shifters_used |= 1 << n;
+			dma_shifters |= 1 << n;
+			__enable_irq();
+			return n;
+		}
+	} else {
+		// take from the top, leaving the DMA capable shifters for last
+		for (int n=shifterCount() - 1; n >= 0; n--) {
+			if (shifters_used & (1 << n)) continue;
+			shifters_used |= 1 << n;
+			__enable_irq();
+			return n;
+		}
+	}
+	__enable_irq();
+	return -1;
+}
+
+void FlexIOModule::releaseShifter(int n)
+{
+	if (n < 0 || n >= shifterCount()) return;
+	detachDMA(n);
+	regs().SHIFTCTL[n] = 0;
+	__disable_irq();
+	shifters_used &= ~(1 << n);
+	dma_shifters &= ~(1 << n);
+	__enable_irq();
+}
+
+int FlexIOModule::claimTimer()
+{
+	__disable_irq();
+	for (int n=0; n < timerCount(); n++) {
+		if (timers_used & (1 << n)) continue;
+		timers_used |= 1 << n;
+		__enable_irq();
+		return n;
+	}
+	__enable_irq();
+	return -1;
+}
+
+void FlexIOModule::releaseTimer(int n)
+{
+	if (n < 0 || n >= timerCount()) return;
+	regs().TIMCTL[n] = 0;
+	__disable_irq();
+	timers_used &= ~(1 << n);
+	__enable_irq();
+}
+
+bool FlexIOModule::attachDMA(DMAChannel &dma, int n)
+{
+	static const uint8_t source[2][2] = {
+		{DMAMUX_SOURCE_FLEXIO1_REQUEST0, DMAMUX_SOURCE_FLEXIO1_REQUEST2},
+		{DMAMUX_SOURCE_FLEXIO2_REQUEST0, DMAMUX_SOURCE_FLEXIO2_REQUEST2}
+	};
+	// the shifter must have been claimed for DMA
+	if (num == 3 || n < 0 || n >= 4 || !(dma_shifters & (1 << n))) return false;
+	dma.triggerAtHardwareEvent(source[num - 1][n >> 1]);
+	regs().SHIFTSDEN |= 1 << n;
+	return true;
+}
+
+void FlexIOModule::detachDMA(int n)
+{
+	if (num == 3 || n < 0 || n >= 4) return;
+	regs().SHIFTSDEN &= ~(1 << n);
+}
@@ -0,0 +1,103 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#ifndef FlexIO_h_
+#define FlexIO_h_
+
+#include <stdint.h>
+#include "imxrt.h"
+
+class DMAChannel;
+
+// Resource manager for the 3 FlexIO modules, so libraries implementing
+// custom protocols (parallel displays, extra UARTs, LED strips, sensor
+// buses) can share them.  Each library claims the pins, shifters and
+// timers it uses, then programs them through regs():
+//
+//   FlexIOModule *flexio = FlexIOModule::forPin(10);
+//   flexio->begin();
+//   int data = flexio->claimPin(10);        // FlexIO pin number
+//   int shifter = flexio->claimShifter(true);  // with a DMA request
+//   int timer = flexio->claimTimer();
+//   if (data < 0 || shifter < 0 || timer < 0) ...  // in use by others
+//   flexio->regs().SHIFTCTL[shifter] = ...
+//   flexio->attachDMA(dma, shifter);
+//   dma.destination(flexio->shiftBuffer(shifter));
+//
+// FlexIO1 reaches pins 2 to 5 and 33.  FlexIO2 reaches the B0 and B1 pads:
+// 6 to 13 and 32, plus 34 to 37 on Teensy 4.1.  FlexIO3 reaches the AD_B1
+// pads, 14 to 23, 26, 27 and 38 to 41, but has no DMA.  On FlexIO1 and
+// FlexIO2, shifters 0-1 and 2-3 each share one DMA request, so only one
+// shifter of each pair may use DMA.
+class FlexIOModule {
+public:
+	constexpr FlexIOModule(uint8_t n) : num(n) {}
+	// turn on the clock and enable the module, leaving its configuration
+	bool begin();
+	IMXRT_FLEXIO_t & regs() const;
+	// FlexIO clock in Hz, for computing timer dividers.  0 if it comes
+	// from the audio or video PLL, whose frequency is set by their users.
+	uint32_t clock() const;
+	// FlexIO pin number of a Teensy pin, or -1 if not on this module.
+	// claimPin() also sets the pin's mux to FlexIO.
+	int pinIndex(uint8_t pin) const;
+	int claimPin(uint8_t pin);
+	void releasePin(uint8_t pin);
+	// shifters and timers not claimed by anyone else, or -1 if none left
+	int claimShifter(bool dma=false);
+	void releaseShifter(int shifter);
+	int claimTimer();
+	void releaseTimer(int timer);
+	// DMA request each time the shifter's status flag sets (transmit
+	// buffer empty or receive buffer full)
+	bool attachDMA(DMAChannel &dma, int shifter);
+	void detachDMA(int shifter);
+	volatile uint32_t & shiftBuffer(int shifter) const { return regs().SHIFTBUF[shifter & 7]; }
+	// bit reversed view of the shift buffer, for MSB first protocols
+	volatile uint32_t & shiftBufferBitSwapped(int shifter) const { return regs().SHIFTBUFBIS[shifter & 7]; }
+	// the module a pin is connected to, or nullptr
+	static FlexIOModule * forPin(uint8_t pin);
+private:
+	uint8_t shifterCount() const;
+	uint8_t timerCount() const;
+	const uint8_t num;          // 1 to 3
+	uint8_t shifters_used = 0;
+	uint8_t timers_used = 0;
+	uint8_t dma_shifters = 0;   // claimed with DMA, at most 1 per pair
+	uint32_t pins_used = 0;
+};
+
+extern FlexIOModule FlexIO1;
+extern FlexIOModule FlexIO2;
+extern FlexIOModule FlexIO3;
+
+#endif
@@ -0,0 +1,196 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2024 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "GpioBus.h"
+#include "core_pins.h"
+
+static IMXRT_GPIO_t * const fast_port[4] = {
+	&IMXRT_GPIO6, &IMXRT_GPIO7, &IMXRT_GPIO8, &IMXRT_GPIO9
+};
+
+static IMXRT_GPIO_t * const dma_port[4] = {
+	&IMXRT_GPIO1, &IMXRT_GPIO2, &IMXRT_GPIO3, &IMXRT_GPIO4
+};
+
+static inline uint32_t shift_bits(uint32_t n, int shift)
+{
+	return (shift >= 0) ? (n << shift) : (n >> -shift);
+}
+
+bool GpioBus::begin(const uint8_t *pins, uint8_t npins, uint8_t mode)
+{
+	endDMA();
+	nruns = 0;
+	for (int i=0; i < 4; i++) portmask[i] = 0;
+	if (!pins || npins < 1 || npins > 32) return false;
+	for (int i=0; i < npins; i++) {
+		if (pins[i] >= CORE_NUM_DIGITAL) return false;
+		volatile uint32_t *reg = portOutputRegister(pins[i]);
+		uint32_t mask = digitalPinToBitMask(pins[i]);
+		int port = -1;
+		for (int p=0; p < 4; p++) {
+			if (reg == &fast_port[p]->DR || reg == &dma_port[p]->DR) port = p;
+		}
+		if (port < 0) return false;
+		int shift = __builtin_ctz(mask) - i;
+		// extend the previous run if this pin is its next port bit
+		if (nruns > 0 && run[nruns-1].port == port && run[nruns-1].shift == shift) {
+			run[nruns-1].mask |= mask;
+		} else {
+			run[nruns].mask = mask;
+			run[nruns].shift = shift;
+			run[nruns].port = port;
+			nruns++;
+		}
+		portmask[port] |= mask;
+	}
+	for (int i=0; i < npins; i++) {
+		pinFastGPIO(pins[i], 1);
+		pinMode(pins[i], mode);
+	}
+	return true;
+}
+
+uint32_t GpioBus::portBits(uint8_t port, uint32_t word) const
+{
+	uint32_t bits = 0;
+	for (int i=0; i < nruns; i++) {
+		if (run[i].port == port) {
+			bits |= shift_bits(word, run[i].shift) & run[i].mask;
+		}
+	}
+	return bits;
+}
+
+void GpioBus::write(uint32_t word)
+{
+	for (int p=0; p < 4; p++) {
+		uint32_t mask = portmask[p];
+		if (!mask) continue;
+		IMXRT_GPIO_t *gpio = fast_port[p];
+		// toggle only the bus bits which differ, so pins not in the
+		// bus keep whatever state they have, all in one write
+		gpio->DR_TOGGLE = (gpio->DR ^ portBits(p, word)) & mask;
+	}
+}
+
+uint32_t GpioBus::read()
+{
+	uint32_t psr[4], word = 0;
+	for (int p=0; p < 4; p++) {
+		if (portmask[p]) psr[p] = fast_port[p]->PSR;
+	}
+	for (int i=0; i < nruns; i++) {
+		word |= shift_bits(psr[run[i].port] & run[i].mask, -run[i].shift);
+	}
+	return word;
+}
+
+void GpioBus::set(uint32_t bits)
+{
+	for (int p=0; p < 4; p++) {
+		if (portmask[p]) fast_port[p]->DR_SET = portBits(p, bits);
+	}
+}
+
+void GpioBus::clear(uint32_t bits)
+{
+	for (int p=0; p < 4; p++) {
+		if (portmask[p]) fast_port[p]->DR_CLEAR = portBits(p, bits);
+	}
+}
+
+void GpioBus::toggle(uint32_t bits)
+{
+	for (int p=0; p < 4; p++) {
+		if (portmask[p]) fast_port[p]->DR_TOGGLE = portBits(p, bits);
+	}
+}
+
+// DMA writes DR_TOGGLE, so each word becomes the bits which change from
+// the word before it.  previous is the bus state when writeDMA() starts.
+bool GpioBus::prepare(const uint16_t *words, uint32_t *out, uint32_t count,
+	uint16_t previous)
+{
+	int port = -1;
+	for (int p=0; p < 4; p++) {
+		if (portmask[p]) {
+			if (port >= 0) return false; // more than one port
+			port = p;
+		}
+	}
+	if (port < 0 || !words || !out) return false;
+	uint32_t prior = portBits(port, previous);
+	for (uint32_t i=0; i < count; i++) {
+		uint32_t bits = portBits(port, words[i]);
+		out[i] = bits ^ prior;
+		prior = bits;
+	}
+	return true;
+}
+
+bool GpioBus::writeDMA(const uint32_t *prepared, uint32_t count, uint8_t dmamux_source)
+{
+	int port = -1;
+	for (int p=0; p < 4; p++) {
+		if (portmask[p]) {
+			if (port >= 0) return false;
+			port = p;
+		}
+	}
+	if (port < 0 || !prepared || count == 0 || count > 32767) return false;
+	if (dmaport == 255) {
+		// the normal port takes over the pins with their current state
+		portFastGPIO(port + 1, portmask[port], 0);
+		dmaport = port;
+	}
+	arm_dcache_flush((void *)prepared, count * 4);
+	dma.begin();
+	dma.sourceBuffer(prepared, count * 4);
+	dma.destination(dma_port[port]->DR_TOGGLE);
+	dma.disableOnCompletion();
+	dma.triggerAtHardwareEvent(dmamux_source);
+	dma.enable();
+	return true;
+}
+
+bool GpioBus::busyDMA()
+{
+	if (dmaport == 255) return false;
+	return (DMA_ERQ & (1 << dma.channel)) ? true : false;
+}
+
+void GpioBus::endDMA()
+{
+	if (dmaport == 255) return;
+	dma.disable();
+	portFastGPIO(dmaport + 1, portmask[dmaport], 1);
+	dmaport = 255;
+}
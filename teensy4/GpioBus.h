@@ -0,0 +1,85 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2024 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GpioBus_h_
+#define GpioBus_h_
+
+#include <stdint.h>
+#include "core_pins.h"
+#include "DMAChannel.h"
+
+// Read and write a group of pins as one binary word, for parallel buses
+// like 8 or 16 bit LCDs.  begin() works out which GPIO port and bit each
+// pin uses, and combines runs of pins with consecutive port bits, so
+// each word takes a few shifts and a single DR_TOGGLE write per port:
+//
+//   const uint8_t pins[] = {19, 18, 14, 15, 40, 41, 17, 16}; // bit 0 first
+//   bus.begin(pins, 8);
+//   bus.write(0xA5);
+//
+// Only the bus pins change.  Other pins on the same ports, including
+// ones changed by interrupts, are not disturbed.
+//
+// For streaming, prepare() converts words to a buffer which writeDMA()
+// sends on each request from a DMAMUX source (for example a QuadTimer
+// or FlexPWM).  All the bus pins must be on a single port, because DMA
+// can only reach the normal GPIO1-4 ports.  While DMA is used, the
+// pins are switched from the fast GPIO6-9 port to its normal twin, so
+// write() has no effect until endDMA() switches them back.
+class GpioBus {
+public:
+	GpioBus() {}
+	~GpioBus() { endDMA(); }
+	bool begin(const uint8_t *pins, uint8_t npins, uint8_t mode=OUTPUT);
+	void write(uint32_t word);
+	uint32_t read();
+	void set(uint32_t bits);    // set 1 bits, leave others unchanged
+	void clear(uint32_t bits);  // set 0 bits, leave others unchanged
+	void toggle(uint32_t bits);
+	bool prepare(const uint16_t *words, uint32_t *out, uint32_t count,
+		uint16_t previous=0);
+	bool writeDMA(const uint32_t *prepared, uint32_t count, uint8_t dmamux_source);
+	bool busyDMA();
+	void endDMA();
+private:
+	uint32_t portBits(uint8_t port, uint32_t word) const;
+	struct run_t {
+		uint32_t mask;    // port bits of this run
+		int8_t shift;     // port bit minus word bit
+		uint8_t port;     // 0-3 = GPIO6-9
+	};
+	run_t run[32];
+	uint32_t portmask[4] = {0, 0, 0, 0};
+	uint8_t nruns = 0;
+	uint8_t dmaport = 255;
+	DMAChannel dma{false};
+};
+
+#endif
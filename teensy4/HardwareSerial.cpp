@@ -31,6 +31,8 @@
 #include "HardwareSerial.h"
 #include "core_pins.h"
 #include "Arduino.h"
+#include "DMAChannel.h"
+#include "EventResponder.h"
 //#include "debug/printf.h"
 
 /*typedef struct {
@@ -165,6 +167,7 @@ void HardwareSerial::begin(uint32_t baud, uint16_t format)
 	port->BAUD = LPUART_BAUD_OSR(bestosr - 1) | LPUART_BAUD_SBR(bestdiv)
 		| (bestosr <= 8 ? LPUART_BAUD_BOTHEDGE : 0);
 	port->PINCFG = 0;
+	if (transmit_pin_rts_) port->MODIR |= LPUART_MODIR_TXRTSE | LPUART_MODIR_TXRTSPOL;
 
 	// Enable the transmitter, receiver and enable receiver interrupt
 	attachInterruptVector(hardware->irq, hardware->irq_handler);
@@ -195,6 +198,9 @@ void HardwareSerial::begin(uint32_t baud, uint16_t format)
 	// Bit 5 TXINVERT
 	if (format & 0x20) ctrl |= LPUART_CTRL_TXINV;		// tx invert
 
+	// frame events use a longer idle time.
+	ctrl |= frame_idle_cfg_;
+
 	// Now see if the user asked for Half duplex:
 	if (half_duplex_mode_) ctrl |= (LPUART_CTRL_LOOPS | LPUART_CTRL_RSRC);
 
@@ -214,6 +220,8 @@ void HardwareSerial::begin(uint32_t baud, uint16_t format)
 	if ( format & 0x100) port->BAUD |= LPUART_BAUD_SBNS;	
 
 	//Serial.printf("    stat:%x ctrl:%x fifo:%x water:%x\n", port->STAT, port->CTRL, port->FIFO, port->WATER );
+	if (rx_dma_ || tx_dma_) configureDMA();
+	rx_frame_head_ = rx_buffer_head_;
 	// Only if the user implemented their own...
 	if (!(*hardware->serial_event_handler_default)) addToSerialEventsList(); 		// Enable the processing of serialEvent for this object
 };
@@ -234,6 +242,8 @@ void HardwareSerial::end(void)
 	if (!(hardware->ccm_register & hardware->ccm_value)) return;
 	while (transmitting_) yield();  // wait for buffered data to send
 	port->CTRL = 0;	// disable the TX and RX ...
+	if (rx_dma_) rx_dma_->disable();
+	if (tx_dma_) tx_dma_->disable();
 
 	// Not sure if this is best, but I think most IO pins default to Mode 5? which appears to be digital IO? 
 	*(portConfigRegister(hardware->rx_pins[rx_pin_index_].pin)) = 5;
@@ -250,6 +260,25 @@ void HardwareSerial::end(void)
 void HardwareSerial::transmitterEnable(uint8_t pin)
 {
 	while (transmitting_) ;
+	if (transmit_pin_rts_) {
+		if (hardware->ccm_register & hardware->ccm_value) {
+			port->MODIR &= ~(LPUART_MODIR_TXRTSE | LPUART_MODIR_TXRTSPOL);
+		}
+		*(portConfigRegister(hardware->rts_pin)) = 5;
+		transmit_pin_rts_ = false;
+	}
+	if (pin != 0xff && pin == hardware->rts_pin) {
+		// LPUART asserts RTS from the start bit of the first character
+		// until the stop bit of the last, so no pin toggling is needed
+		transmit_pin_baseReg_ = 0;
+		transmit_pin_rts_ = true;
+		*(portControlRegister(pin)) = IOMUXC_PAD_SRE | IOMUXC_PAD_DSE(3) | IOMUXC_PAD_SPEED(3);
+		*(portConfigRegister(pin)) = hardware->rts_mux_val;
+		if (hardware->ccm_register & hardware->ccm_value) {
+			port->MODIR |= LPUART_MODIR_TXRTSE | LPUART_MODIR_TXRTSPOL;
+		}
+		return;
+	}
 	pinMode(pin, OUTPUT);
 	transmit_pin_baseReg_ = PIN_TO_BASEREG(pin);
 	transmit_pin_bitmask_ = PIN_TO_BITMASK(pin);
@@ -391,6 +420,7 @@ void HardwareSerial::clear(void)
 {
 	// BUGBUG:: deal with FIFO
 	rx_buffer_head_ = rx_buffer_tail_;
+	rx_frame_head_ = rx_buffer_tail_;
 	if (rts_pin_baseReg_) rts_assert();
 }
 
@@ -413,6 +443,7 @@ int HardwareSerial::available(void)
 
 	// WATER> 0 so IDLE involved may want to check if port has already has RX data to retrieve
 	__disable_irq();
+	if (rx_dma_) rx_dma_update_head();
 	head = rx_buffer_head_;
 	tail = rx_buffer_tail_;
 	int avail;
@@ -456,6 +487,11 @@ int HardwareSerial::peek(void)
 {
 	uint32_t head, tail;
 
+	if (rx_dma_) {
+		__disable_irq();
+		rx_dma_update_head();
+		__enable_irq();
+	}
 	head = rx_buffer_head_;
 	tail = rx_buffer_tail_;
 	if (head == tail) {
@@ -464,7 +500,7 @@ int HardwareSerial::peek(void)
 		if (head == tail) {
 			// Still empty Now check for stuff in FIFO Queue.
 			int c = -1;	// assume nothing to return
-			if (port->WATER & 0x7000000) {
+			if (!rx_dma_ && (port->WATER & 0x7000000)) {
 				c = port->DATA & 0x3ff;		// Use only up to 10 bits of data
 				// But we don't want to throw it away...
 				// since queue is empty, just going to reset to front of queue...
@@ -491,6 +527,11 @@ int HardwareSerial::read(void)
 	uint32_t head, tail;
 	int c;
 
+	if (rx_dma_) {
+		__disable_irq();
+		rx_dma_update_head();
+		__enable_irq();
+	}
 	head = rx_buffer_head_;
 	tail = rx_buffer_tail_;
 	if (head == tail) {
@@ -499,7 +540,7 @@ int HardwareSerial::read(void)
 		if (head == tail) {
 			// Still empty Now check for stuff in FIFO Queue.
 			c = -1;	// assume nothing to return
-			if (port->WATER & 0x7000000) {
+			if (!rx_dma_ && (port->WATER & 0x7000000)) {
 				c = port->DATA & 0x3ff;		// Use only up to 10 bits of data
 			}
 			__enable_irq();
@@ -525,6 +566,44 @@ int HardwareSerial::read(void)
 	return c;
 }	
 
+// copy everything already in the receive buffer with one pass, then let
+// read() pick up anything still waiting in the FIFO
+size_t HardwareSerial::readBulk(uint8_t *buffer, size_t length)
+{
+	uint32_t head, tail;
+	size_t count = 0;
+
+	if (rx_dma_) {
+		__disable_irq();
+		rx_dma_update_head();
+		__enable_irq();
+	}
+	head = rx_buffer_head_;
+	tail = rx_buffer_tail_;
+	while (count < length && tail != head) {
+		if (++tail >= rx_buffer_total_size_) tail = 0;
+		if (tail < rx_buffer_size_) {
+			buffer[count++] = rx_buffer_[tail];
+		} else {
+			buffer[count++] = rx_buffer_storage_[tail-rx_buffer_size_];
+		}
+	}
+	rx_buffer_tail_ = tail;
+	if (count > 0 && rts_pin_baseReg_) {
+		uint32_t avail;
+		if (head >= tail) avail = head - tail;
+		else avail = rx_buffer_total_size_ + head - tail;
+
+		if (avail <= rts_low_watermark_) rts_assert();
+	}
+	while (count < length) {
+		int c = read();
+		if (c < 0) break;
+		buffer[count++] = c;
+	}
+	return count;
+}
+
 void HardwareSerial::flush(void)
 {
 	while (transmitting_) yield(); // wait
@@ -538,7 +617,7 @@ size_t HardwareSerial::write(uint8_t c)
 
 size_t HardwareSerial::write9bit(uint32_t c)
 {
-	uint32_t head, n;
+	uint32_t head;
 	//digitalWrite(3, HIGH);
 	//digitalWrite(5, HIGH);
 	if (transmit_pin_baseReg_) DIRECT_WRITE_HIGH(transmit_pin_baseReg_, transmit_pin_bitmask_);
@@ -551,9 +630,38 @@ size_t HardwareSerial::write9bit(uint32_t c)
 
 	head = tx_buffer_head_;
 	if (++head >= tx_buffer_total_size_) head = 0;
+	tx_wait_for_room(head);
+	//digitalWrite(5, LOW);
+	//Serial.printf("WR %x %d %d %d %x %x\n", c, head, tx_buffer_size_,  tx_buffer_total_size_, (uint32_t)tx_buffer_, (uint32_t)tx_buffer_storage_);
+	if (head < tx_buffer_size_) {
+		tx_buffer_[head] = c;
+	} else {
+		tx_buffer_storage_[head - tx_buffer_size_] = c;
+	}
+	__disable_irq();
+	transmitting_ = 1;
+	tx_buffer_head_ = head;
+	if (tx_dma_) {
+		if (!tx_dma_count_) tx_dma_start();
+	} else {
+		port->CTRL |= LPUART_CTRL_TIE; // (may need to handle this issue)BITBAND_SET_BIT(LPUART0_CTRL, TIE_BIT);
+	}
+	__enable_irq();
+	//digitalWrite(3, LOW);
+	return 1;
+}
+
+// wait until the buffer position head is free, sending data ourselves if
+// called from an interrupt that blocks our own interrupt
+void HardwareSerial::tx_wait_for_room(uint32_t head)
+{
+	uint32_t n;
 	while (tx_buffer_tail_ == head) {
 		int priority = nvic_execution_priority();
-		if (priority <= hardware->irq_priority) {
+		if (priority <= hardware->irq_priority && tx_dma_) {
+			// DMA interrupt can't run, so check for completion here
+			if (tx_dma_->complete()) IRQHandler();
+		} else if (priority <= hardware->irq_priority) {
 			if ((port->STAT & LPUART_STAT_TDRE)) {
 				uint32_t tail = tx_buffer_tail_;
 				if (++tail >= tx_buffer_total_size_) tail = 0;
@@ -570,20 +678,54 @@ size_t HardwareSerial::write9bit(uint32_t c)
 			yield(); // wait
 		} 
 	}
-	//digitalWrite(5, LOW);
-	//Serial.printf("WR %x %d %d %d %x %x\n", c, head, tx_buffer_size_,  tx_buffer_total_size_, (uint32_t)tx_buffer_, (uint32_t)tx_buffer_storage_);
-	if (head < tx_buffer_size_) {
-		tx_buffer_[head] = c;
-	} else {
-		tx_buffer_storage_[head - tx_buffer_size_] = c;
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size)
+{
+	uint32_t head, tail, next, end, count;
+	size_t remaining = size;
+
+	if (size == 0) return 0;
+	if (transmit_pin_baseReg_) DIRECT_WRITE_HIGH(transmit_pin_baseReg_, transmit_pin_bitmask_);
+	if(half_duplex_mode_) {		
+		__disable_irq();
+	    port->CTRL |= LPUART_CTRL_TXDIR;
+		__enable_irq();
 	}
-	__disable_irq();
-	transmitting_ = 1;
-	tx_buffer_head_ = head;
-	port->CTRL |= LPUART_CTRL_TIE; // (may need to handle this issue)BITBAND_SET_BIT(LPUART0_CTRL, TIE_BIT);
-	__enable_irq();
-	//digitalWrite(3, LOW);
-	return 1;
+
+	while (remaining > 0) {
+		head = tx_buffer_head_;
+		next = head + 1;
+		if (next >= tx_buffer_total_size_) next = 0;
+		tx_wait_for_room(next);
+		// copy as much as fits, in up to 3 contiguous runs (to the end of
+		// tx_buffer_, through the added memory, then wrapping around)
+		do {
+			tail = tx_buffer_tail_;
+			end = (next < tx_buffer_size_) ? tx_buffer_size_ : tx_buffer_total_size_;
+			if (tail >= next && tail < end) end = tail;
+			count = end - next;
+			if (count > remaining) count = remaining;
+			if (count == 0) break;
+			volatile BUFTYPE *p = (next < tx_buffer_size_) ? tx_buffer_ + next
+				: tx_buffer_storage_ + (next - tx_buffer_size_);
+			remaining -= count;
+			head = next + count - 1;
+			while (count-- > 0) *p++ = *buffer++;
+			next = head + 1;
+			if (next >= tx_buffer_total_size_) next = 0;
+		} while (remaining > 0 && next != tail);
+		__disable_irq();
+		transmitting_ = 1;
+		tx_buffer_head_ = head;
+		if (tx_dma_) {
+			if (!tx_dma_count_) tx_dma_start();
+		} else {
+			port->CTRL |= LPUART_CTRL_TIE;
+		}
+		__enable_irq();
+	}
+	return size;
 }
 
 void HardwareSerial::IRQHandler() 
@@ -592,9 +734,29 @@ void HardwareSerial::IRQHandler()
 	uint32_t head, tail, n;
 	uint32_t ctrl;
 
+	// DMA transmit completed a contiguous part of the buffer
+	if (tx_dma_ && tx_dma_count_ && tx_dma_->complete()) {
+		tx_dma_->clearComplete();
+		tx_dma_->clearInterrupt();
+		tail = tx_buffer_tail_ + tx_dma_count_;
+		if (tail >= tx_buffer_total_size_) tail -= tx_buffer_total_size_;
+		tx_buffer_tail_ = tail;
+		tx_dma_count_ = 0;
+		tx_dma_start();
+		asm("dsb");
+	}
+
 	// See if we have stuff to read in.
 	// Todo - Check idle. 
-	if (port->STAT & (LPUART_STAT_RDRF | LPUART_STAT_IDLE)) {
+	if (rx_dma_) {
+		// DMA receive only interrupts at idle line
+		if (port->STAT & LPUART_STAT_IDLE) {
+			port->STAT |= LPUART_STAT_IDLE;
+			rx_dma_update_head();
+			yield_ready(YIELD_CHECK_HARDWARE_SERIAL);
+			if (frame_event_) frame_event_check();
+		}
+	} else if (port->STAT & (LPUART_STAT_RDRF | LPUART_STAT_IDLE)) {
 		// See how many bytes or pending. 
 		//digitalWrite(5, HIGH);
 		uint8_t avail = (port->WATER >> 24) & 0x7;
@@ -617,6 +779,7 @@ void HardwareSerial::IRQHandler()
 				}
 			} while (--avail > 0) ;
 			rx_buffer_head_ = head;
+			yield_ready(YIELD_CHECK_HARDWARE_SERIAL);
 			if (rts_pin_baseReg_) {
 				uint32_t avail;
 				if (head >= tail) avail = head - tail;
@@ -628,6 +791,7 @@ void HardwareSerial::IRQHandler()
 		// If it was an idle status clear the idle
 		if (port->STAT & LPUART_STAT_IDLE) {
 			port->STAT |= LPUART_STAT_IDLE;	// writing a 1 to idle should clear it. 
+			if (frame_event_) frame_event_check();
 		}
 		//digitalWrite(5, LOW);
 
@@ -676,6 +840,229 @@ void HardwareSerial::IRQHandler()
 }
 
 
+// DMAMUX request sources, indexed by LPUART number - 1
+static const uint8_t lpuart_dma_rx_source[8] = {
+	DMAMUX_SOURCE_LPUART1_RX, DMAMUX_SOURCE_LPUART2_RX, DMAMUX_SOURCE_LPUART3_RX,
+	DMAMUX_SOURCE_LPUART4_RX, DMAMUX_SOURCE_LPUART5_RX, DMAMUX_SOURCE_LPUART6_RX,
+	DMAMUX_SOURCE_LPUART7_RX, DMAMUX_SOURCE_LPUART8_RX
+};
+static const uint8_t lpuart_dma_tx_source[8] = {
+	DMAMUX_SOURCE_LPUART1_TX, DMAMUX_SOURCE_LPUART2_TX, DMAMUX_SOURCE_LPUART3_TX,
+	DMAMUX_SOURCE_LPUART4_TX, DMAMUX_SOURCE_LPUART5_TX, DMAMUX_SOURCE_LPUART6_TX,
+	DMAMUX_SOURCE_LPUART7_TX, DMAMUX_SOURCE_LPUART8_TX
+};
+
+bool HardwareSerial::enableDMA(bool rx, bool tx)
+{
+#ifdef SERIAL_9BIT_SUPPORT
+	return false;
+#else
+	if (!(hardware->ccm_register & hardware->ccm_value)) return false;
+	if (rx && !rx_dma_) {
+		rx_dma_ = new DMAChannel();
+		if (!rx_dma_) return false;
+		if (rx_buffer_storage_) {
+			// DMA needs contiguous memory, so use only the added memory
+			rx_buffer_ = rx_buffer_storage_;
+			rx_buffer_size_ = rx_buffer_total_size_ - rx_buffer_size_;
+			rx_buffer_total_size_ = rx_buffer_size_;
+			rx_buffer_storage_ = nullptr;
+		}
+		if (rx_buffer_total_size_ > 32767) {
+			// maximum DMA major loop count
+			rx_buffer_size_ = 32767;
+			rx_buffer_total_size_ = 32767;
+		}
+		rts_low_watermark_ = rx_buffer_total_size_ - hardware->rts_low_watermark;
+		rts_high_watermark_ = rx_buffer_total_size_ - hardware->rts_high_watermark;
+	}
+	if (tx && !tx_dma_) {
+		tx_dma_ = new DMAChannel();
+		if (!tx_dma_) return false;
+	}
+	configureDMA();
+	return true;
+#endif
+}
+
+void HardwareSerial::configureDMA()
+{
+	uint32_t index = ((uint32_t)port - IMXRT_LPUART1_ADDRESS) >> 14;
+	if (rx_dma_) {
+		__disable_irq();
+		port->CTRL &= ~LPUART_CTRL_RIE;
+		rx_dma_->disable();
+		rx_dma_->source(*(volatile uint8_t *)&port->DATA);
+		rx_dma_->destinationBuffer(rx_buffer_, rx_buffer_total_size_);
+		rx_dma_->triggerAtHardwareEvent(lpuart_dma_rx_source[index]);
+		// first byte goes to index 0, so empty is head = tail = last index
+		rx_buffer_head_ = rx_buffer_total_size_ - 1;
+		rx_buffer_tail_ = rx_buffer_total_size_ - 1;
+		rx_frame_head_ = rx_buffer_total_size_ - 1;
+		if ((uint32_t)rx_buffer_ >= 0x20200000u) {
+			arm_dcache_flush_delete((void *)rx_buffer_, rx_buffer_total_size_);
+		}
+		// RX water 0 gives a DMA request for every byte
+		port->WATER &= ~LPUART_WATER_RXWATER(7);
+		port->BAUD |= LPUART_BAUD_RDMAE;
+		rx_dma_->enable();
+		__enable_irq();
+	}
+	if (tx_dma_) {
+		tx_dma_->disable();
+		tx_dma_->destination(*(volatile uint8_t *)&port->DATA);
+		tx_dma_->triggerAtHardwareEvent(lpuart_dma_tx_source[index]);
+		tx_dma_->attachInterrupt(hardware->irq_handler, hardware->irq_priority);
+		tx_dma_count_ = 0;
+		port->BAUD |= LPUART_BAUD_TDMAE;
+	}
+}
+
+// find the latest received byte from the DMA destination address
+void HardwareSerial::rx_dma_update_head()
+{
+	uint32_t next = (volatile BUFTYPE *)rx_dma_->TCD->DADDR - rx_buffer_;
+	if (next >= rx_buffer_total_size_) next = 0;  // may read just before it wraps
+	uint32_t head = (next > 0) ? next - 1 : rx_buffer_total_size_ - 1;
+	uint32_t prior = rx_buffer_head_;
+	if ((uint32_t)rx_buffer_ >= 0x20200000u && head != prior) {
+		// discard cached copies of only the newly arrived bytes
+		uint32_t first = prior + 1;
+		if (first >= rx_buffer_total_size_) first = 0;
+		if (head >= first) {
+			arm_dcache_delete((void *)(rx_buffer_ + first), head - first + 1);
+		} else {
+			arm_dcache_delete((void *)(rx_buffer_ + first), rx_buffer_total_size_ - first);
+			arm_dcache_delete((void *)rx_buffer_, head + 1);
+		}
+	}
+	rx_buffer_head_ = head;
+	if (rts_pin_baseReg_) {
+		uint32_t tail = rx_buffer_tail_;
+		uint32_t avail = (head >= tail) ? head - tail : rx_buffer_total_size_ + head - tail;
+		if (avail >= rts_high_watermark_) rts_deassert();
+	}
+}
+
+// begin DMA for the next contiguous part of the transmit buffer, or wait
+// for the transmission to finish if the buffer is now empty.  Must be
+// called with interrupts disabled or from the interrupt handler.
+void HardwareSerial::tx_dma_start()
+{
+	uint32_t head = tx_buffer_head_;
+	uint32_t tail = tx_buffer_tail_;
+	if (head == tail) {
+		port->CTRL |= LPUART_CTRL_TCIE;
+		return;
+	}
+	uint32_t first = tail + 1;
+	if (first >= tx_buffer_total_size_) first = 0;
+	uint32_t last;
+	volatile BUFTYPE *p;
+	if (first < tx_buffer_size_) {
+		last = (head >= first && head < tx_buffer_size_) ? head : tx_buffer_size_ - 1;
+		p = tx_buffer_ + first;
+	} else {
+		last = (head >= first) ? head : tx_buffer_total_size_ - 1;
+		p = tx_buffer_storage_ + (first - tx_buffer_size_);
+	}
+	uint32_t count = last - first + 1;
+	if ((uint32_t)p >= 0x20200000u) arm_dcache_flush((void *)p, count);
+	tx_dma_->sourceBuffer(p, count);
+	tx_dma_->disableOnCompletion();
+	tx_dma_->interruptAtCompletion();
+	tx_dma_count_ = count;
+	tx_dma_->enable();
+}
+
+bool HardwareSerial::attachFrameEvent(EventResponder &event, uint8_t idle_characters)
+{
+	uint32_t idlecfg = 0;
+	while (idlecfg < 7 && (1u << idlecfg) < idle_characters) idlecfg++;
+	// ILT starts the idle count after the stop bit, so trailing
+	// 1 bits in the last character do not shorten the gap
+	frame_idle_cfg_ = LPUART_CTRL_IDLECFG(idlecfg) | LPUART_CTRL_ILT;
+	__disable_irq();
+	rx_frame_head_ = rx_buffer_head_;
+	frame_event_ = &event;
+	if (hardware->ccm_register & hardware->ccm_value) {
+		// idle config may only change while the receiver is disabled
+		uint32_t ctrl = port->CTRL;
+		if (ctrl & LPUART_CTRL_RE) {
+			port->CTRL = ctrl & ~LPUART_CTRL_RE;
+			while (port->CTRL & LPUART_CTRL_RE) ; // wait for receiver to stop
+		}
+		ctrl &= ~(LPUART_CTRL_IDLECFG(7) | LPUART_CTRL_ILT);
+		port->CTRL = ctrl | frame_idle_cfg_;
+	}
+	__enable_irq();
+	return true;
+}
+
+void HardwareSerial::detachFrameEvent()
+{
+	__disable_irq();
+	frame_event_ = nullptr;
+	__enable_irq();
+}
+
+// stop the receiver, so its mode can be changed, returning the prior CTRL
+static uint32_t lpuart_receiver_stop(IMXRT_LPUART_t *port)
+{
+	uint32_t ctrl = port->CTRL;
+	if (ctrl & LPUART_CTRL_RE) {
+		port->CTRL = ctrl & ~LPUART_CTRL_RE;
+		while (port->CTRL & LPUART_CTRL_RE) ; // wait for receiver to stop
+	}
+	return ctrl;
+}
+
+bool HardwareSerial::setAddressMatch(uint8_t address1, int address2)
+{
+	if (!(hardware->ccm_register & hardware->ccm_value)) return false;
+	uint32_t mark;
+	if (port->BAUD & LPUART_BAUD_M10) mark = 0x200;
+	else if ((port->CTRL & (LPUART_CTRL_M | LPUART_CTRL_PE)) == LPUART_CTRL_M) mark = 0x100;
+	else return false; // address marks need the extra bit, not parity
+	__disable_irq();
+	uint32_t ctrl = lpuart_receiver_stop(port);
+	uint32_t baud = port->BAUD & ~(LPUART_BAUD_MAEN1 | LPUART_BAUD_MAEN2 | LPUART_BAUD_MATCFG(3));
+	port->BAUD = baud; // MATCH may only be written with MAEN clear
+	port->MATCH = LPUART_MATCH_MA1(mark | address1)
+		| LPUART_MATCH_MA2(mark | (address2 & 0xFF));
+	baud |= LPUART_BAUD_MAEN1 | LPUART_BAUD_MATCFG(0); // address match wakeup
+	if (address2 >= 0 && address2 <= 255) baud |= LPUART_BAUD_MAEN2;
+	port->BAUD = baud;
+	// address mark wakeup, starting in standby until a matching address
+	ctrl |= LPUART_CTRL_WAKE;
+	port->CTRL = ctrl;
+	if (ctrl & LPUART_CTRL_RE) port->CTRL = ctrl | LPUART_CTRL_RWU;
+	__enable_irq();
+	return true;
+}
+
+void HardwareSerial::clearAddressMatch()
+{
+	if (!(hardware->ccm_register & hardware->ccm_value)) return;
+	__disable_irq();
+	uint32_t ctrl = lpuart_receiver_stop(port);
+	port->BAUD &= ~(LPUART_BAUD_MAEN1 | LPUART_BAUD_MAEN2);
+	port->CTRL = ctrl & ~(LPUART_CTRL_WAKE | LPUART_CTRL_RWU);
+	__enable_irq();
+}
+
+// called from the interrupt at idle line, after all received bytes
+// are in the buffer
+void HardwareSerial::frame_event_check()
+{
+	uint32_t head = rx_buffer_head_;
+	uint32_t prior = rx_frame_head_;
+	if (head == prior) return;
+	uint32_t len = (head > prior) ? head - prior : rx_buffer_total_size_ + head - prior;
+	rx_frame_head_ = head;
+	frame_event_->triggerEvent(len, this);
+}
+
 void HardwareSerial::addToSerialEventsList() {
 	for (uint8_t i = 0; i < s_count_serials_with_serial_events; i++) {
 		if (s_serials_with_serial_events[i] == this) return; // already in the list.
@@ -150,6 +150,9 @@ typedef struct _pin_to_xbar_info{
 extern const pin_to_xbar_info_t pin_to_xbar_info[];
 extern const uint8_t count_pin_to_xbar_info;
 
+class DMAChannel;
+class EventResponder;
+
 
 class HardwareSerial : public Stream
 {
@@ -175,6 +178,8 @@ public:
 		pin_info_t tx_pins[cnt_tx_pins];
 		const uint8_t cts_pin;
 		const uint8_t cts_mux_val;
+		const uint8_t rts_pin;		// LPUART RTS output, for RS-485 direction
+		const uint8_t rts_mux_val;
 		const uint16_t irq_priority;
 		const uint16_t rts_low_watermark;
 		const uint16_t rts_high_watermark;
@@ -195,8 +200,15 @@ public:
 	virtual int peek(void);
 	virtual void flush(void);
 	virtual size_t write(uint8_t c);
+	virtual size_t write(const uint8_t *buffer, size_t size);
 	virtual int read(void);
+	virtual size_t readBulk(uint8_t *buffer, size_t length);
 
+	// Drive an RS-485 transceiver's driver enable pin high while sending.
+	// On the LPUART's own RTS pin (Serial3 pin 18, Serial5 pin 42 on
+	// Teensy 4.1 or 34 on Teensy 4.0), the LPUART does this in hardware,
+	// with no delay turning the bus around.  Any other pin is switched by
+	// software when transmit completes.
 	void transmitterEnable(uint8_t pin);
 	void setRX(uint8_t pin);
 	void setTX(uint8_t pin, bool opendrain=false);
@@ -213,6 +225,35 @@ public:
 		addMemoryForWrite(buffer, length);
 	}
 	size_t write9bit(uint32_t c);
+
+	// Use DMA to move data between the buffers and the LPUART, so there
+	// is no interrupt per byte.  Receive DMA fills the buffer circularly,
+	// with interrupts only for idle line.  Because DMA can not stop when
+	// the buffer is full, use addMemoryForRead() (which DMA mode uses
+	// instead of the small default buffer) to hold enough data for the
+	// longest time your program may not read.  Call after begin().
+	// Not available with SERIAL_9BIT_SUPPORT.
+	bool enableDMA(bool rx=true, bool tx=true);
+
+	// Trigger an event each time the receive line goes idle after data,
+	// for packet based protocols like Modbus RTU or DMX.  The event's
+	// status is the number of bytes received since the prior idle (the
+	// frame length), and its data is a pointer to this HardwareSerial.
+	// idle_characters is the gap which ends a frame, rounded up to a
+	// power of 2 from 1 to 128 character times.
+	bool attachFrameEvent(EventResponder &event, uint8_t idle_characters=1);
+	void detachFrameEvent();
+
+	// Multidrop 9 bit buses: receive only frames addressed to this device.
+	// Characters with the 9th bit set, sent by write9bit(0x100 | address),
+	// are addresses.  The LPUART compares them with address1 (and address2
+	// if 0 to 255) and discards all data sent to other devices, so they
+	// cause no interrupts.  The receiver stays in standby until the first
+	// matching address.  That address is received, with its 0x100 bit
+	// (SERIAL_9BIT_SUPPORT is needed to keep it), to mark each frame's
+	// start.  Call after begin() with a 9 or 10 bit format without parity.
+	bool setAddressMatch(uint8_t address1, int address2=-1);
+	void clearAddressMatch();
 	
 	// Event Handler functions and data
 	static uint8_t serial_event_handlers_active;
@@ -234,10 +275,13 @@ public:
 
 	operator bool()			{ return true; }
 
-	static inline void processSerialEventsList() {
+	// returns true if any port may still need its serialEvent called
+	static inline bool processSerialEventsList() {
+		bool pending = false;
 		for (uint8_t i = 0; i < s_count_serials_with_serial_events; i++) {
-			s_serials_with_serial_events[i]->doYieldCode();
+			if (s_serials_with_serial_events[i]->doYieldCode()) pending = true;
 		}
+		return pending;
 	}
 private:
 	IMXRT_LPUART_t * const port;
@@ -264,12 +308,26 @@ private:
 
 	volatile uint32_t 	*transmit_pin_baseReg_ = 0;
 	uint32_t 			transmit_pin_bitmask_ = 0;
+	bool				transmit_pin_rts_ = false;	// transmitterEnable() pin is the LPUART's RTS
 
 	volatile uint32_t 	*rts_pin_baseReg_ = 0;
 	uint32_t 			rts_pin_bitmask_ = 0;
 
+	DMAChannel			*rx_dma_ = nullptr;
+	DMAChannel			*tx_dma_ = nullptr;
+	volatile uint16_t	tx_dma_count_ = 0;
+
+	EventResponder		*frame_event_ = nullptr;
+	uint32_t			frame_idle_cfg_ = 0;	// IDLECFG and ILT bits for CTRL
+	uint16_t			rx_frame_head_ = 0;
+
   	inline void rts_assert();
   	inline void rts_deassert();
+	void configureDMA();
+	void rx_dma_update_head();
+	void tx_dma_start();
+	void frame_event_check();
+	void tx_wait_for_room(uint32_t head);
 
 	void IRQHandler();
 	friend void IRQHandler_Serial1();
@@ -287,8 +345,11 @@ private:
 	#endif
 	static uint8_t 			s_count_serials_with_serial_events;
 	void addToSerialEventsList(); 
-	inline void doYieldCode()  {
+	// DMA receive only interrupts at idle line, so keep those ports
+	// checked while data may be arriving
+	inline bool doYieldCode()  {
 		if (available()) (*hardware->_serialEvent)();
+		return (rx_dma_ != nullptr) || available();
 	}
 
 
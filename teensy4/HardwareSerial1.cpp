@@ -38,7 +38,7 @@
 #ifndef SERIAL1_RX_BUFFER_SIZE
 #define SERIAL1_RX_BUFFER_SIZE     64 // number of incoming bytes to buffer
 #endif
-#define IRQ_PRIORITY  64  // 0 = highest priority, 255 = lowest
+#define IRQ_PRIORITY  IRQ_PRIORITY_SERIAL  // see irq_priority.h
 
 void IRQHandler_Serial1()
 {
@@ -64,6 +64,8 @@ const HardwareSerial::hardware_t UART6_Hardware = {
 	#endif
 	0xff, // No CTS pin
 	0, // No CTS
+	0xff, // No RTS pin
+	0, // No RTS
 	IRQ_PRIORITY, 38, 24, // IRQ, rts_low_watermark, rts_high_watermark
 	XBARA1_OUT_LPUART6_TRG_INPUT	// XBar Tigger 
 };
@@ -37,7 +37,7 @@
 #ifndef SERIAL3_RX_BUFFER_SIZE
 #define SERIAL3_RX_BUFFER_SIZE     64 // number of incoming bytes to buffer
 #endif
-#define IRQ_PRIORITY  64  // 0 = highest priority, 255 = lowest
+#define IRQ_PRIORITY  IRQ_PRIORITY_SERIAL  // see irq_priority.h
 
 void IRQHandler_Serial3()
 {
@@ -57,6 +57,8 @@ static HardwareSerial::hardware_t UART2_Hardware = {
 	{{14,2, &IOMUXC_LPUART2_TX_SELECT_INPUT, 1}, {0xff, 0xff, nullptr, 0}},
 	19, //IOMUXC_SW_MUX_CTL_PAD_GPIO_AD_B1_00, // 19
 	2, // page 473 
+	18, //IOMUXC_SW_MUX_CTL_PAD_GPIO_AD_B1_01, // 18
+	2, // RTS
 	IRQ_PRIORITY, 38, 24, // IRQ, rts_low_watermark, rts_high_watermark
 	XBARA1_OUT_LPUART2_TRG_INPUT
 };
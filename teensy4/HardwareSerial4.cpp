@@ -37,7 +37,7 @@
 #ifndef SERIAL4_RX_BUFFER_SIZE
 #define SERIAL4_RX_BUFFER_SIZE     64 // number of incoming bytes to buffer
 #endif
-#define IRQ_PRIORITY  64  // 0 = highest priority, 255 = lowest
+#define IRQ_PRIORITY  IRQ_PRIORITY_SERIAL  // see irq_priority.h
 
 
 void IRQHandler_Serial4()
@@ -59,6 +59,8 @@ static HardwareSerial::hardware_t UART3_Hardware = {
 	{{17,2, &IOMUXC_LPUART3_TX_SELECT_INPUT, 0}, {0xff, 0xff, nullptr, 0}},
 	0xff, // No CTS pin
 	0, // No CTS
+	0xff, // No RTS pin
+	0, // No RTS
 	IRQ_PRIORITY, 38, 24, // IRQ, rts_low_watermark, rts_high_watermark
 	XBARA1_OUT_LPUART3_TRG_INPUT
 };
@@ -73,6 +75,8 @@ static HardwareSerial::hardware_t UART4_Hardware = {
     {{8,2, &IOMUXC_LPUART4_TX_SELECT_INPUT, 2}, {0xff, 0xff, nullptr, 0}},
     0xff, // No CTS pin
     0, // No CTS
+    0xff, // No RTS pin
+    0, // No RTS
     IRQ_PRIORITY, 38, 24, // IRQ, rts_low_watermark, rts_high_watermark
     XBARA1_OUT_LPUART4_TRG_INPUT
 };
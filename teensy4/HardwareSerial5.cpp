@@ -37,7 +37,7 @@
 #ifndef SERIAL5_RX_BUFFER_SIZE
 #define SERIAL5_RX_BUFFER_SIZE     64 // number of incoming bytes to buffer
 #endif
-#define IRQ_PRIORITY  64  // 0 = highest priority, 255 = lowest
+#define IRQ_PRIORITY  IRQ_PRIORITY_SERIAL  // see irq_priority.h
 
 
 void IRQHandler_Serial5()
@@ -58,16 +58,22 @@ static HardwareSerial::hardware_t UART8_Hardware = {
 	{{20,2, &IOMUXC_LPUART8_TX_SELECT_INPUT, 1}, {47, 2, &IOMUXC_LPUART8_TX_SELECT_INPUT, 0}},
 	43, //  CTS pin
 	2, //  CTS
+	42, //  RTS pin
+	2, //  RTS
 	#elif defined(ARDUINO_TEENSY40)
 	{{21,2, &IOMUXC_LPUART8_RX_SELECT_INPUT, 1}, {38, 2, &IOMUXC_LPUART8_RX_SELECT_INPUT, 0}},
 	{{20,2, &IOMUXC_LPUART8_TX_SELECT_INPUT, 1}, {39, 2, &IOMUXC_LPUART8_TX_SELECT_INPUT, 0}},
 	35, //  CTS pin
 	2, //  CTS
+	34, //  RTS pin
+	2, //  RTS
 	#else // ARDUINO_TEENSY_MICROMOD
 	{{21,2, &IOMUXC_LPUART8_RX_SELECT_INPUT, 1}, {39, 2, &IOMUXC_LPUART8_RX_SELECT_INPUT, 0}},
 	{{20,2, &IOMUXC_LPUART8_TX_SELECT_INPUT, 1}, {38, 2, &IOMUXC_LPUART8_TX_SELECT_INPUT, 0}},
 	35, //  CTS pin
 	2, //  CTS
+	0xff, // No RTS pin
+	0, // No RTS
 	#endif
 	IRQ_PRIORITY, 38, 24, // IRQ, rts_low_watermark, rts_high_watermark
 	XBARA1_OUT_LPUART8_TRG_INPUT
@@ -37,7 +37,7 @@
 #ifndef SERIAL6_RX_BUFFER_SIZE
 #define SERIAL6_RX_BUFFER_SIZE     64 // number of incoming bytes to buffer
 #endif
-#define IRQ_PRIORITY  64  // 0 = highest priority, 255 = lowest
+#define IRQ_PRIORITY  IRQ_PRIORITY_SERIAL  // see irq_priority.h
 
 void IRQHandler_Serial6()
 {
@@ -58,6 +58,8 @@ static HardwareSerial::hardware_t UART1_Hardware = {
 	{{24,2, nullptr, 0}, {0xff, 0xff, nullptr, 0}},
 	0xff, // No CTS pin
 	0, // No CTS
+	0xff, // No RTS pin
+	0, // No RTS
 	IRQ_PRIORITY, 38, 24, // IRQ, rts_low_watermark, rts_high_watermark
 	XBARA1_OUT_LPUART1_TRG_INPUT
 };
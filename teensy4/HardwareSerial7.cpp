@@ -37,7 +37,7 @@
 #ifndef SERIAL7_RX_BUFFER_SIZE
 #define SERIAL7_RX_BUFFER_SIZE     64 // number of incoming bytes to buffer
 #endif
-#define IRQ_PRIORITY  64  // 0 = highest priority, 255 = lowest
+#define IRQ_PRIORITY  IRQ_PRIORITY_SERIAL  // see irq_priority.h
 
 void IRQHandler_Serial7()
 {
@@ -57,6 +57,8 @@ static HardwareSerial::hardware_t UART7_Hardware = {
 	{{29,2, &IOMUXC_LPUART7_TX_SELECT_INPUT, 1}, {0xff, 0xff, nullptr, 0}},
 	0xff, // No CTS pin
 	0, // No CTS
+	0xff, // No RTS pin
+	0, // No RTS
 	IRQ_PRIORITY, 38, 24, // IRQ, rts_low_watermark, rts_high_watermark
 	XBARA1_OUT_LPUART7_TRG_INPUT
 };
@@ -38,7 +38,7 @@
 #ifndef SERIAL8_RX_BUFFER_SIZE
 #define SERIAL8_RX_BUFFER_SIZE     64 // number of incoming bytes to buffer
 #endif
-#define IRQ_PRIORITY  64  // 0 = highest priority, 255 = lowest
+#define IRQ_PRIORITY  IRQ_PRIORITY_SERIAL  // see irq_priority.h
 
 void IRQHandler_Serial8()
 {
@@ -60,6 +60,8 @@ static HardwareSerial::hardware_t UART5_Hardware = {
 
 	50, // CTS pin
 	2, //  CTS
+	0xff, // No RTS pin
+	0, // No RTS
 	IRQ_PRIORITY, 38, 24, // IRQ, rts_low_watermark, rts_high_watermark
 	XBARA1_OUT_LPUART5_TRG_INPUT
 };
@@ -0,0 +1,332 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <Arduino.h>
+#include <HeapProfile.h>
+#include <malloc.h>
+#include <reent.h>
+#include "smalloc.h"
+
+// Size histogram buckets: 1-16, 17-32, 33-64 ... and the last for anything
+// larger than 256K.  Call sites beyond the table are lumped together.
+#define HEAP_PROFILE_BUCKETS   16
+#define HEAP_PROFILE_SITES     32
+
+struct heap_tier_profile {
+	size_t current;
+	size_t peak;
+	uint32_t allocs;
+	uint32_t frees;
+};
+
+struct heap_site_profile {
+	void *addr;
+	uint32_t count;
+	size_t bytes;
+	size_t largest;
+};
+
+volatile uint8_t heap_profile_enabled = 0;
+void *heap_profile_site = NULL;
+
+static struct heap_tier_profile tiers[MALLOC_TIER_COUNT];
+static uint32_t histogram[HEAP_PROFILE_BUCKETS];
+static struct heap_site_profile sites[HEAP_PROFILE_SITES];
+static struct heap_site_profile other_sites;
+
+extern unsigned long _heap_start;
+extern unsigned long _heap_end;
+extern char *__brkval;
+extern uint8_t external_psram_size;
+
+static int tier_of(const void *ptr)
+{
+	uint32_t addr = (uint32_t)ptr;
+	if (addr >= 0x20000000 && addr < 0x20080000) return MALLOC_TIER_DTCM;
+	if ((addr >> 28) == 7) return MALLOC_TIER_EXTMEM;
+	return MALLOC_TIER_OCRAM;
+}
+
+static struct heap_site_profile * find_site(void *addr)
+{
+	uint32_t i = ((uint32_t)addr >> 1) % HEAP_PROFILE_SITES;
+	for (uint32_t n=0; n < HEAP_PROFILE_SITES; n++) {
+		struct heap_site_profile *s = &sites[i];
+		if (s->addr == addr) return s;
+		if (s->addr == NULL) {
+			s->addr = addr;
+			return s;
+		}
+		if (++i >= HEAP_PROFILE_SITES) i = 0;
+	}
+	return &other_sites;
+}
+
+// Interrupts may allocate or free, so the counts are updated with
+// interrupts disabled.
+static uint32_t profile_lock(void)
+{
+	uint32_t primask;
+	__asm__ volatile("mrs %0, primask\n" : "=r" (primask)::);
+	__disable_irq();
+	return primask;
+}
+
+static void profile_unlock(uint32_t primask)
+{
+	if (!primask) __enable_irq();
+}
+
+void heap_profile_record_alloc(const void *ptr, size_t size, void *caller)
+{
+	if (heap_profile_site && !heap_profile_in_isr()) caller = heap_profile_site;
+	uint32_t primask = profile_lock();
+	struct heap_tier_profile *t = &tiers[tier_of(ptr)];
+	t->current += size;
+	if (t->current > t->peak) t->peak = t->current;
+	t->allocs++;
+
+	unsigned int bucket = (size <= 16) ? 0 : 28 - __builtin_clz(size - 1);
+	if (bucket >= HEAP_PROFILE_BUCKETS) bucket = HEAP_PROFILE_BUCKETS - 1;
+	histogram[bucket]++;
+
+	struct heap_site_profile *s = find_site(caller);
+	s->count++;
+	s->bytes += size;
+	if (size > s->largest) s->largest = size;
+	profile_unlock(primask);
+}
+
+void heap_profile_record_free(const void *ptr, size_t size)
+{
+	uint32_t primask = profile_lock();
+	struct heap_tier_profile *t = &tiers[tier_of(ptr)];
+	// memory allocated before begin() was never counted
+	t->current = (t->current > size) ? t->current - size : 0;
+	t->frees++;
+	profile_unlock(primask);
+}
+
+void heap_profile_record_resize(const void *ptr, size_t oldsize, size_t newsize)
+{
+	uint32_t primask = profile_lock();
+	struct heap_tier_profile *t = &tiers[tier_of(ptr)];
+	t->current = (t->current > oldsize) ? t->current - oldsize : 0;
+	t->current += newsize;
+	if (t->current > t->peak) t->peak = t->current;
+	profile_unlock(primask);
+}
+
+#ifdef HEAP_PROFILE
+// With -DHEAP_PROFILE, the C library's malloc, free, realloc, calloc and
+// memalign are replaced by these, which call the same newlib heap code
+// while feeding the hooks.  Otherwise newlib's own functions are used
+// untouched, and only the core's allocators are counted.  Sizes are
+// counted as malloc_usable_size() reports, so the totals match however
+// the heap rounds each request.
+extern "C" {
+
+void * malloc(size_t size)
+{
+	void *ptr = _malloc_r(_REENT, size);
+	if (heap_profile_enabled && ptr) {
+		heap_profile_record_alloc(ptr, malloc_usable_size(ptr), __builtin_return_address(0));
+	}
+	return ptr;
+}
+
+void free(void *ptr)
+{
+	if (heap_profile_enabled && ptr) {
+		heap_profile_record_free(ptr, malloc_usable_size(ptr));
+	}
+	_free_r(_REENT, ptr);
+}
+
+void * realloc(void *ptr, size_t size)
+{
+	if (!heap_profile_enabled) return _realloc_r(_REENT, ptr, size);
+	size_t oldsize = ptr ? malloc_usable_size(ptr) : 0;
+	void *newptr = _realloc_r(_REENT, ptr, size);
+	if (newptr == ptr) {
+		if (ptr) heap_profile_record_resize(ptr, oldsize, malloc_usable_size(ptr));
+	} else if (newptr || size == 0) {
+		if (ptr) heap_profile_record_free(ptr, oldsize);
+		if (newptr) {
+			heap_profile_record_alloc(newptr, malloc_usable_size(newptr),
+				__builtin_return_address(0));
+		}
+	}
+	return newptr;
+}
+
+void * calloc(size_t nmemb, size_t size)
+{
+	void *ptr = _calloc_r(_REENT, nmemb, size);
+	if (heap_profile_enabled && ptr) {
+		heap_profile_record_alloc(ptr, malloc_usable_size(ptr), __builtin_return_address(0));
+	}
+	return ptr;
+}
+
+void * memalign(size_t align, size_t size)
+{
+	void *ptr = _memalign_r(_REENT, align, size);
+	if (heap_profile_enabled && ptr) {
+		heap_profile_record_alloc(ptr, malloc_usable_size(ptr), __builtin_return_address(0));
+	}
+	return ptr;
+}
+
+} // extern "C"
+#endif // HEAP_PROFILE
+
+void HeapProfileClass::clear()
+{
+	__disable_irq();
+	memset(tiers, 0, sizeof(tiers));
+	memset(histogram, 0, sizeof(histogram));
+	memset(sites, 0, sizeof(sites));
+	memset(&other_sites, 0, sizeof(other_sites));
+	__enable_irq();
+}
+
+static size_t print_free(Print &p, size_t total, size_t largest, int runs)
+{
+	size_t n = 0;
+	n += p.print("    free ");
+	n += p.print(total);
+	n += p.print(" bytes in ");
+	n += p.print(runs);
+	n += p.print(" blocks, largest ");
+	n += p.print(largest);
+	if (total > 0) {
+		n += p.print(", fragmentation ");
+		n += p.print(100 - (uint32_t)((uint64_t)largest * 100 / total));
+		n += p.print("%");
+	}
+	n += p.println();
+	return n;
+}
+
+static size_t print_pool_free(Print &p, struct smalloc_pool *pool)
+{
+	size_t total, largest;
+	int runs;
+	if (sm_malloc_frag_pool(pool, &total, &largest, &runs) > 0) {
+		return print_free(p, total, largest, runs);
+	}
+	return 0;
+}
+
+FLASHMEM
+size_t HeapProfileClass::printTo(Print& p) const
+{
+	static const char * const names[MALLOC_TIER_COUNT] = {"DTCM", "OCRAM", "EXTMEM"};
+	size_t n = 0;
+
+	n += p.print("HeapProfile: ");
+	n += p.println(heap_profile_enabled ? "tracking" : "stopped");
+	for (int i=0; i < MALLOC_TIER_COUNT; i++) {
+		const struct heap_tier_profile *t = &tiers[i];
+		n += p.print("  ");
+		n += p.print(names[i]);
+		n += p.print(": ");
+		n += p.print(t->current);
+		n += p.print(" bytes in use, peak ");
+		n += p.print(t->peak);
+		n += p.print(", ");
+		n += p.print(t->allocs);
+		n += p.print(" allocs, ");
+		n += p.print(t->frees);
+		n += p.println(" frees");
+		if (i == MALLOC_TIER_DTCM) {
+			n += print_pool_free(p, &dtcm_smalloc_pool);
+		} else if (i == MALLOC_TIER_OCRAM) {
+			// newlib does not report its largest free chunk, but the
+			// top chunk plus memory never claimed by sbrk is contiguous
+			struct mallinfo mi = mallinfo();
+			size_t top = (char *)&_heap_end - __brkval;
+			size_t total = mi.fordblks + top;
+			n += print_free(p, total, mi.keepcost + top, mi.ordblks + (top ? 1 : 0));
+#ifdef ARDUINO_TEENSY41
+		} else if (i == MALLOC_TIER_EXTMEM && external_psram_size > 0) {
+			n += print_pool_free(p, &extmem_smalloc_pool);
+#endif
+		}
+	}
+
+	n += p.println("  Sizes:");
+	for (int i=0; i < HEAP_PROFILE_BUCKETS; i++) {
+		if (histogram[i] == 0) continue;
+		n += p.print("    ");
+		if (i < HEAP_PROFILE_BUCKETS - 1) {
+			n += p.print("<= ");
+			n += p.print(16ul << i);
+		} else {
+			n += p.print("> ");
+			n += p.print(16ul << (i - 1));
+		}
+		n += p.print(": ");
+		n += p.println(histogram[i]);
+	}
+
+	// call sites, most bytes first
+	n += p.println("  Callers:");
+	uint32_t printed = 0;
+	while (1) {
+		int best = -1;
+		for (int i=0; i < HEAP_PROFILE_SITES; i++) {
+			if (!sites[i].addr || (printed & (1 << i))) continue;
+			if (best < 0 || sites[i].bytes > sites[best].bytes) best = i;
+		}
+		if (best < 0) break;
+		printed |= (1 << best);
+		const struct heap_site_profile *s = &sites[best];
+		n += p.print("    0x");
+		n += p.print((uint32_t)s->addr, HEX);
+		n += p.print(": ");
+		n += p.print(s->count);
+		n += p.print(" allocs, ");
+		n += p.print(s->bytes);
+		n += p.print(" bytes, largest ");
+		n += p.println(s->largest);
+	}
+	if (other_sites.count) {
+		n += p.print("    others: ");
+		n += p.print(other_sites.count);
+		n += p.print(" allocs, ");
+		n += p.print(other_sites.bytes);
+		n += p.println(" bytes");
+	}
+	return n;
+}
+
+HeapProfileClass HeapProfile;
@@ -0,0 +1,52 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <Printable.h>
+#include "heap_profile.h"
+
+// Allocation tracker for tuning memory use.  Once begin() is called,
+// every extmem_malloc, malloc_fast and smalloc allocation is counted by
+// memory tier, by size and by calling address.  The C library's malloc,
+// which new, malloc_dma and malloc_large use, is only counted when built
+// with -DHEAP_PROFILE, which replaces it.  Print it at any time,
+// Serial.print(HeapProfile), to see usage, peaks and how fragmented the
+// free memory has become.
+class HeapProfileClass: public Printable {
+public:
+	void begin() { clear(); heap_profile_enabled = 1; }
+	void end() { heap_profile_enabled = 0; }
+	void clear();
+	operator bool() { return heap_profile_enabled; }
+	virtual size_t printTo(Print& p) const;
+};
+
+extern HeapProfileClass HeapProfile;
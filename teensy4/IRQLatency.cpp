@@ -0,0 +1,327 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <Arduino.h>
+#include <IRQLatency.h>
+#include <string.h>
+
+#define GPT_TICKS_PER_USEC 24	// GPT1 runs from the 24 MHz peripheral clock
+#define HISTOGRAM_SIZE 64	// latency in GPT ticks, last counts all longer
+#define DISABLED_SITES 8
+
+typedef struct {
+	uint32_t site;		// address of the __disable_irq() call
+	uint32_t count;
+	uint32_t max_cycles;
+} disabled_site_t;
+
+// used by name from irq_latency_wrapper
+extern "C" void (*irq_latency_handlers[NVIC_NUM_INTERRUPTS])(void);
+void (*irq_latency_handlers[NVIC_NUM_INTERRUPTS])(void);
+static uint32_t irq_count[NVIC_NUM_INTERRUPTS];
+static uint32_t irq_max_cycles[NVIC_NUM_INTERRUPTS];
+
+static uint32_t histogram[HISTOGRAM_SIZE];
+static uint32_t latency_samples, latency_sum, latency_min, latency_max;
+static uint32_t latency_max_pc;
+static uint32_t interval_ticks = 0;
+static uint8_t gpt_priority;
+
+static disabled_site_t disabled_sites[DISABLED_SITES];
+static uint32_t disabled_begin, disabled_site;
+
+extern "C" void irq_latency_wrapper(void);
+extern "C" void irq_latency_gpt_isr(void);
+
+IRQLatencyClass IRQLatency;
+
+
+// __disable_irq() and __enable_irq() call these when IRQ_LATENCY_PROFILE
+// is defined.  Only the outermost disable starts timing, since nested code
+// which disables again doesn't add any latency.
+extern "C" void irq_latency_disable(void)
+{
+	uint32_t primask;
+
+	__asm__ volatile("mrs %0, primask\n" : "=r" (primask)::);
+	__asm__ volatile("CPSID i":::"memory");
+	if (!primask) {
+		disabled_site = ((uint32_t)__builtin_return_address(0) & ~1) - 4;
+		disabled_begin = ARM_DWT_CYCCNT;
+	}
+}
+
+extern "C" void irq_latency_enable(void)
+{
+	uint32_t primask;
+
+	__asm__ volatile("mrs %0, primask\n" : "=r" (primask)::);
+	if (primask && disabled_site) {
+		uint32_t cycles = ARM_DWT_CYCCNT - disabled_begin;
+		disabled_site_t *s, *least = disabled_sites;
+		for (s = disabled_sites; s < disabled_sites + DISABLED_SITES; s++) {
+			if (s->site == disabled_site) break;
+			if (s->max_cycles < least->max_cycles) least = s;
+		}
+		if (s == disabled_sites + DISABLED_SITES) {
+			// table full or new site, replace the least bad one
+			s = least;
+			if (s->site && cycles <= s->max_cycles) s = NULL;
+			if (s) {
+				s->site = disabled_site;
+				s->count = 0;
+				s->max_cycles = 0;
+			}
+		}
+		if (s) {
+			s->count++;
+			if (cycles > s->max_cycles) s->max_cycles = cycles;
+		}
+		disabled_site = 0;
+	}
+	__asm__ volatile("CPSIE i":::"memory");
+}
+
+// Runs after each wrapped handler, with its starting cycle count.
+extern "C" void irq_latency_serviced(uint32_t begin)
+{
+	uint32_t cycles = ARM_DWT_CYCCNT - begin;
+	uint32_t ipsr;
+
+	__asm__ volatile("mrs %0, ipsr\n" : "=r" (ipsr)::);
+	uint32_t n = ipsr - 16;
+	if (n < NVIC_NUM_INTERRUPTS) {
+		irq_count[n]++;
+		if (cycles > irq_max_cycles[n]) irq_max_cycles[n] = cycles;
+	}
+}
+
+// Installed in place of every NVIC handler.  The original is called as an
+// ordinary function, then the branch to irq_latency_serviced leaves LR
+// holding EXC_RETURN, so its return ends the exception.
+extern "C" __attribute__((naked)) void irq_latency_wrapper(void)
+{
+	asm volatile(
+		"push	{r4, lr}\n"
+		"ldr	r0, =0xE0001004\n"	// ARM_DWT_CYCCNT
+		"ldr	r4, [r0]\n"
+		"mrs	r0, ipsr\n"
+		"sub	r0, r0, #16\n"
+		"ldr	r1, =irq_latency_handlers\n"
+		"ldr	r1, [r1, r0, lsl #2]\n"
+		"blx	r1\n"
+		"mov	r0, r4\n"
+		"pop	{r4, lr}\n"
+		"b	irq_latency_serviced\n"
+		".ltorg\n");
+}
+
+extern "C" void irq_latency_gpt_sample(uint32_t pc)
+{
+	uint32_t now = GPT1_CNT;
+	uint32_t compare = GPT1_OCR1;
+	uint32_t ticks = now - compare;
+
+	GPT1_SR = GPT_SR_OF1;
+	compare += interval_ticks;
+	if ((int32_t)(compare - now) <= 0) compare = now + interval_ticks;
+	GPT1_OCR1 = compare;
+	histogram[(ticks < HISTOGRAM_SIZE) ? ticks : HISTOGRAM_SIZE - 1]++;
+	latency_samples++;
+	latency_sum += ticks;
+	if (ticks < latency_min) latency_min = ticks;
+	if (ticks > latency_max) {
+		latency_max = ticks;
+		latency_max_pc = pc;
+	}
+	asm("dsb");
+}
+
+// Pass the stacked program counter (ARM DDI0403E, pg 537), which shows
+// what delayed the worst sample.
+extern "C" __attribute__((naked)) void irq_latency_gpt_isr(void)
+{
+	asm volatile(
+		"tst	lr, #4\n"
+		"ite	eq\n"
+		"mrseq	r0, msp\n"
+		"mrsne	r0, psp\n"
+		"ldr	r0, [r0, #24]\n"
+		"b	irq_latency_gpt_sample\n");
+}
+
+bool IRQLatencyClass::begin(uint8_t priority, uint32_t interval)
+{
+	if (interval == 0 || interval > 100000000) return false;
+	end();
+	if (latency_samples == 0) latency_min = 0xFFFFFFFF;
+	interval_ticks = interval * GPT_TICKS_PER_USEC;
+	gpt_priority = priority;
+
+	CCM_CCGR1 |= CCM_CCGR1_GPT1_BUS(CCM_CCGR_ON) | CCM_CCGR1_GPT1_SERIAL(CCM_CCGR_ON);
+	GPT1_CR = 0;
+	GPT1_PR = 0;
+	GPT1_IR = 0;
+	GPT1_SR = 0x3F;
+	GPT1_CR = GPT_CR_CLKSRC(1) | GPT_CR_FRR | GPT_CR_ENMOD;
+	GPT1_CR |= GPT_CR_EN;
+	GPT1_OCR1 = GPT1_CNT + interval_ticks;
+
+	__disable_irq();
+	for (int i=0; i < NVIC_NUM_INTERRUPTS; i++) {
+		if (i == IRQ_GPT1 || _VectorsRam[i + 16] == irq_latency_wrapper) continue;
+		irq_latency_handlers[i] = _VectorsRam[i + 16];
+		_VectorsRam[i + 16] = irq_latency_wrapper;
+	}
+	attachInterruptVector(IRQ_GPT1, irq_latency_gpt_isr);
+	__enable_irq();
+	GPT1_IR = GPT_IR_OF1IE;
+	NVIC_SET_PRIORITY(IRQ_GPT1, priority);
+	NVIC_ENABLE_IRQ(IRQ_GPT1);
+	return true;
+}
+
+void IRQLatencyClass::end()
+{
+	if (interval_ticks == 0) return;
+	NVIC_DISABLE_IRQ(IRQ_GPT1);
+	GPT1_IR = 0;
+	GPT1_CR = 0;
+	GPT1_SR = 0x3F;
+	__disable_irq();
+	for (int i=0; i < NVIC_NUM_INTERRUPTS; i++) {
+		if (_VectorsRam[i + 16] == irq_latency_wrapper) {
+			_VectorsRam[i + 16] = irq_latency_handlers[i];
+		}
+	}
+	__enable_irq();
+	interval_ticks = 0;
+}
+
+void IRQLatencyClass::clear()
+{
+	end();
+	__disable_irq();
+	memset(histogram, 0, sizeof(histogram));
+	memset(irq_count, 0, sizeof(irq_count));
+	memset(irq_max_cycles, 0, sizeof(irq_max_cycles));
+	memset(disabled_sites, 0, sizeof(disabled_sites));
+	latency_samples = latency_sum = latency_max = 0;
+	latency_min = 0xFFFFFFFF;
+	latency_max_pc = 0;
+	__enable_irq();
+}
+
+uint32_t IRQLatencyClass::samples() const
+{
+	return latency_samples;
+}
+
+uint32_t IRQLatencyClass::worstLatency() const
+{
+	return latency_max * 1000 / GPT_TICKS_PER_USEC;
+}
+
+static uint32_t ticks_to_ns(uint32_t ticks)
+{
+	return ticks * 1000 / GPT_TICKS_PER_USEC;
+}
+
+static uint32_t cycles_to_ns(uint32_t cycles)
+{
+	return (uint64_t)cycles * 1000000000 / F_CPU_ACTUAL;
+}
+
+size_t IRQLatencyClass::printTo(Print& p) const
+{
+	size_t n = 0;
+	uint32_t total = latency_samples;
+
+	n += p.printf("# IRQ latency, %u samples of GPT1 at priority %u\n",
+		(unsigned int)total, gpt_priority);
+	if (total > 0) {
+		uint32_t sum = 0, p99 = 0;
+		for (uint32_t i=0; i < HISTOGRAM_SIZE; i++) {
+			sum += histogram[i];
+			if ((uint64_t)sum * 100 >= (uint64_t)total * 99) {
+				p99 = i;
+				break;
+			}
+		}
+		n += p.printf("# entry latency: min %u ns, average %u ns, 99%% %s%u ns, max %u ns at PC 0x%08X\n",
+			(unsigned int)ticks_to_ns(latency_min),
+			(unsigned int)ticks_to_ns(latency_sum / total),
+			(p99 == HISTOGRAM_SIZE - 1) ? ">" : "",
+			(unsigned int)ticks_to_ns(p99),
+			(unsigned int)ticks_to_ns(latency_max), (unsigned int)latency_max_pc);
+	}
+
+	// longest running handlers first
+	n += p.println("# longest interrupt handlers:");
+	uint32_t previous = 0xFFFFFFFF;
+	for (int shown=0; shown < 10; shown++) {
+		int worst = -1;
+		for (int i=0; i < NVIC_NUM_INTERRUPTS; i++) {
+			if (irq_count[i] == 0 || irq_max_cycles[i] >= previous) continue;
+			if (worst < 0 || irq_max_cycles[i] > irq_max_cycles[worst]) worst = i;
+		}
+		if (worst < 0) break;
+		previous = irq_max_cycles[worst];
+		n += p.printf("IRQ %3d  priority %3u  count %10u  max %8u cycles  %8u ns\n",
+			worst, NVIC_GET_PRIORITY(worst), (unsigned int)irq_count[worst],
+			(unsigned int)irq_max_cycles[worst],
+			(unsigned int)cycles_to_ns(irq_max_cycles[worst]));
+	}
+
+#ifdef IRQ_LATENCY_PROFILE
+	n += p.println("# longest with interrupts disabled, by __disable_irq() address:");
+	disabled_site_t sites[DISABLED_SITES];
+	__disable_irq();
+	memcpy(sites, disabled_sites, sizeof(sites));
+	__enable_irq();
+	for (int i=0; i < DISABLED_SITES; i++) {
+		for (int j=i+1; j < DISABLED_SITES; j++) {
+			if (sites[j].max_cycles > sites[i].max_cycles) {
+				disabled_site_t tmp = sites[i];
+				sites[i] = sites[j];
+				sites[j] = tmp;
+			}
+		}
+		if (sites[i].site == 0) break;
+		n += p.printf("0x%08X  count %10u  max %8u cycles  %8u ns\n",
+			(unsigned int)sites[i].site, (unsigned int)sites[i].count,
+			(unsigned int)sites[i].max_cycles,
+			(unsigned int)cycles_to_ns(sites[i].max_cycles));
+	}
+#else
+	n += p.println("# build with -DIRQ_LATENCY_PROFILE to find code which disables interrupts");
+#endif
+	return n;
+}
@@ -0,0 +1,59 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <Printable.h>
+
+// Interrupt latency and jitter measurement, for checking real-time budgets.
+// While running, GPT1 requests an interrupt at a regular interval and its
+// handler measures how late it began, using the 24 MHz GPT counter as the
+// reference.  Every other NVIC interrupt handler is timed with the DWT
+// cycle counter, to find which ones delay others at the same or lower
+// priority.  Print it at any time, Serial.print(IRQLatency).
+//
+// Code which disables interrupts is the other cause of latency.  Building
+// with -DIRQ_LATENCY_PROFILE makes __disable_irq() and __enable_irq() keep
+// the longest times interrupts stayed disabled, by calling address.
+//
+// GPT1 is used while running.  Handlers attached with attachInterruptVector
+// after begin() are not timed, so call begin() after starting drivers.
+class IRQLatencyClass: public Printable {
+public:
+	// priority of the GPT1 reference interrupt, microseconds between samples
+	bool begin(uint8_t priority = 128, uint32_t interval = 1000);
+	void end();	// stop measuring, but keep the results
+	void clear();	// stop measuring and erase the results
+	uint32_t samples() const;
+	uint32_t worstLatency() const;	// nanoseconds
+	virtual size_t printTo(Print& p) const;
+};
+
+extern IRQLatencyClass IRQLatency;
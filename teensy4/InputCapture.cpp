@@ -0,0 +1,246 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2024 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "InputCapture.h"
+#include "TriggerRoute.h"
+#include "core_pins.h"
+
+extern "C" uint8_t pwm_pin_quadtimer(uint8_t pin);
+extern "C" void usb_cdc_qtimer1_isr(void) __attribute__((weak));
+
+InputCapture * InputCapture::list[4][4];
+
+static IMXRT_TMR_t * const qtimer[4] = {
+	&IMXRT_TMR1, &IMXRT_TMR2, &IMXRT_TMR3, &IMXRT_TMR4
+};
+
+static inline uint32_t ticks_to_ns(uint32_t ticks)
+{
+	return ((uint64_t)ticks * 1000000000u) / F_BUS_ACTUAL;
+}
+
+bool InputCapture::begin(uint8_t p)
+{
+	end();
+	uint8_t info = pwm_pin_quadtimer(p);
+	int mod = (info == 255) ? -1 : info >> 4;
+	int ch = info & 3;
+	bool xbar = false;
+	if (mod != 0 && mod != 2) {
+		// other pins with an XBAR input use a free channel of TMR4,
+		// which has no pins and no other users
+		int source = TriggerRoute::pin(p);
+		if (source < 0) return false;
+		mod = 3;
+		for (ch=0; ch < 4; ch++) {
+			if (list[mod][ch]) continue;
+			if (TriggerRoute::connect(source, TriggerRoute::quadTimer(4, ch))) break;
+		}
+		if (ch >= 4) return false;
+		xbar = true;
+	} else if (mod == 2) {
+		// TMR1 pads have no input select, TMR3's is pads AD_B1_00 to AD_B1_03
+		volatile uint32_t *daisy = &IOMUXC_QTIMER3_TIMER0_SELECT_INPUT;
+		daisy[ch] = 1;
+	}
+	if (list[mod][ch]) return false;
+
+	overflow = 0;
+	edges = 0;
+	newdata = false;
+	async_state = 0;
+	module = mod;
+	channel = ch;
+	pin = p;
+	routed = xbar;
+
+	quadtimer_module_enable(qtimer[mod]);
+	IMXRT_TMR_CH_t *c = &qtimer[mod]->CH[ch];
+	c->CTRL = 0;
+	c->SCTRL = 0;
+	c->CSCTRL = 0;
+	c->LOAD = 0;
+	c->COMP1 = 0xFFFF;
+	c->CMPLD1 = 0xFFFF;
+	c->CNTR = 0;
+	c->FILT = 0;
+	__disable_irq();
+	list[mod][ch] = this;
+	__enable_irq();
+	c->SCTRL = TMR_SCTRL_CAPTURE_MODE(3) | TMR_SCTRL_IEFIE | TMR_SCTRL_TOFIE;
+	// free running from the peripheral bus clock, capturing on edges
+	// of this channel's own input pin
+	c->CTRL = TMR_CTRL_CM(1) | TMR_CTRL_PCS(8) | TMR_CTRL_SCS(ch);
+	if (!xbar) *(portConfigRegister(p)) = 1;
+	if (mod == 0) {
+		attachInterruptVector(IRQ_QTIMER1, isr1);
+		NVIC_ENABLE_IRQ(IRQ_QTIMER1);
+	} else if (mod == 2) {
+		attachInterruptVector(IRQ_QTIMER3, isr3);
+		NVIC_ENABLE_IRQ(IRQ_QTIMER3);
+	} else {
+		attachInterruptVector(IRQ_QTIMER4, isr4);
+		NVIC_ENABLE_IRQ(IRQ_QTIMER4);
+	}
+	return true;
+}
+
+void InputCapture::end()
+{
+	if (module < 0) return;
+	IMXRT_TMR_CH_t *c = &qtimer[module]->CH[channel];
+	c->CTRL = 0;
+	c->SCTRL = 0;
+	__disable_irq();
+	list[module][channel] = nullptr;
+	__enable_irq();
+	if (routed) TriggerRoute::disconnect(TriggerRoute::quadTimer(module + 1, channel));
+	pinMode(pin, INPUT);
+	module = -1;
+}
+
+// USB serial's flush timer (usb_cdc.c) is TMR1 channel 3, so the TMR1
+// interrupt services both, whichever of them attached it
+void InputCapture::isr1()
+{
+	service(0);
+	if (usb_cdc_qtimer1_isr) usb_cdc_qtimer1_isr();
+}
+
+void input_capture_qtimer1_isr(void)
+{
+	InputCapture::service(0);
+}
+
+void InputCapture::isr3()
+{
+	service(2);
+}
+
+void InputCapture::isr4()
+{
+	service(3);
+}
+
+void InputCapture::service(int mod)
+{
+	for (int ch=0; ch < 4; ch++) {
+		InputCapture *ic = list[mod][ch];
+		if (!ic) continue;
+		IMXRT_TMR_CH_t *c = &qtimer[mod]->CH[ch];
+		uint16_t sc = c->SCTRL;
+		uint16_t clear = 0;
+		if (sc & TMR_SCTRL_IEF) {
+			uint16_t capt = c->CAPT;
+			uint32_t ovf = ic->overflow;
+			// a pending overflow with a small capture value happened
+			// before the edge
+			if ((sc & TMR_SCTRL_TOF) && capt < 0x8000) ovf += 0x10000;
+			clear |= TMR_SCTRL_IEF;
+			ic->edge(ovf | capt, (sc & TMR_SCTRL_INPUT) ? true : false);
+		}
+		if (sc & TMR_SCTRL_TOF) {
+			ic->overflow += 0x10000;
+			clear |= TMR_SCTRL_TOF;
+		}
+		// flags clear by writing 0, writing 1 leaves them unchanged
+		if (clear) {
+			c->SCTRL = (sc | TMR_SCTRL_TCF | TMR_SCTRL_TOF | TMR_SCTRL_IEF) & ~clear;
+		}
+	}
+	asm("dsb");
+}
+
+void InputCapture::edge(uint32_t t, bool rising)
+{
+	if (edges < 3) edges++;
+	if (rising) {
+		if (edges >= 3 && last_fall - last_rise < t - last_rise) {
+			period_ticks = t - last_rise;
+			high_ticks = last_fall - last_rise;
+			low_ticks = t - last_fall;
+			newdata = true;
+		}
+		if (async_state == 2 && async_started) {
+			async_state = 0;
+			(*async_callback)(ticks_to_ns(t - last_fall));
+		}
+		if (async_state == 1) async_started = true;
+		last_rise = t;
+	} else {
+		if (async_state == 1 && async_started) {
+			async_state = 0;
+			(*async_callback)(ticks_to_ns(t - last_rise));
+		}
+		if (async_state == 2) async_started = true;
+		last_fall = t;
+	}
+}
+
+uint32_t InputCapture::period()
+{
+	newdata = false;
+	return ticks_to_ns(period_ticks);
+}
+
+uint32_t InputCapture::highTime()
+{
+	newdata = false;
+	return ticks_to_ns(high_ticks);
+}
+
+uint32_t InputCapture::lowTime()
+{
+	newdata = false;
+	return ticks_to_ns(low_ticks);
+}
+
+float InputCapture::frequency()
+{
+	newdata = false;
+	uint32_t ticks = period_ticks;
+	if (ticks == 0) return 0.0f;
+	return (float)F_BUS_ACTUAL / (float)ticks;
+}
+
+// state is HIGH or LOW, like pulseIn().  Measurement starts at the next
+// edge which begins a pulse of that state, so a pulse already in
+// progress is not reported short.
+bool InputCapture::pulseInAsync(uint8_t state, void (*callback)(uint32_t nanoseconds))
+{
+	if (module < 0 || !callback) return false;
+	if (async_state) return false;
+	__disable_irq();
+	async_callback = callback;
+	async_started = false;
+	async_state = state ? 1 : 2;
+	__enable_irq();
+	return true;
+}
@@ -0,0 +1,99 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2024 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef InputCapture_h_
+#define InputCapture_h_
+
+#include <stdint.h>
+
+// Measure pulses and frequency with QuadTimer input capture.  The timer
+// runs from the 150 MHz peripheral clock, so edges are timestamped with
+// 6.7 ns resolution by hardware, and the CPU only spends a short
+// interrupt per edge.  Every pin can be measured at the same time:
+//
+//   InputCapture sensor;
+//   sensor.begin(14);
+//   if (sensor.available()) {
+//     Serial.println(sensor.frequency());
+//     Serial.println(sensor.highTime()); // nanoseconds
+//   }
+//
+// pulseInAsync() is a non-blocking pulseIn(), which calls a function
+// from the interrupt when the next complete HIGH or LOW pulse ends.
+//
+// Pins 10, 11, 12, 14, 15, 18 and 19 are supported.  The pin's timer
+// channel is used for capture, so analogWrite() can not be used on the
+// pin, or on others sharing its channel, until end().  Up to 4 other pins
+// with an XBAR input (0-5, 7, 8, 30-33 and more on the bottom pads) may
+// be measured at a time, routed by TriggerRoute to QuadTimer 4, which
+// has no pins.
+extern "C" void input_capture_qtimer1_isr(void);
+
+class InputCapture {
+public:
+	constexpr InputCapture() {}
+	~InputCapture() { end(); }
+	bool begin(uint8_t pin);
+	void end();
+	// true when a new full period has been measured since the last
+	// call to period(), highTime(), lowTime() or frequency()
+	bool available() const { return newdata; }
+	uint32_t period();   // nanoseconds, rising edge to rising edge
+	uint32_t highTime(); // nanoseconds
+	uint32_t lowTime();  // nanoseconds
+	float frequency();   // Hz
+	bool pulseInAsync(uint8_t state, void (*callback)(uint32_t nanoseconds));
+	operator bool() const { return module >= 0; }
+private:
+	static void isr1();
+	static void isr3();
+	static void isr4();
+	static void service(int module);
+	friend void input_capture_qtimer1_isr(void);
+	void edge(uint32_t t, bool rising);
+	static InputCapture *list[4][4];
+	volatile uint32_t overflow = 0;   // upper bits of the 32 bit timestamp
+	uint32_t last_rise = 0;
+	uint32_t last_fall = 0;
+	volatile uint32_t period_ticks = 0;
+	volatile uint32_t high_ticks = 0;
+	volatile uint32_t low_ticks = 0;
+	void (*async_callback)(uint32_t nanoseconds) = nullptr;
+	volatile bool newdata = false;
+	uint8_t edges = 0;         // count up to 3 edges seen since begin
+	uint8_t async_state = 0;   // 0=idle, 1=HIGH pulse, 2=LOW pulse
+	bool async_started = false;
+	int8_t module = -1;
+	uint8_t channel = 0;
+	uint8_t pin = 0;
+	bool routed = false;       // pin reaches the timer through XBAR
+};
+
+#endif
@@ -34,13 +34,24 @@
 static void pit_isr(void);
 
 #define NUM_CHANNELS 4
-static void (*funct_table[4])(void) __attribute((aligned(32))) = {nullptr, nullptr, nullptr, nullptr};
+static void (*funct_table[4])(void *) __attribute((aligned(32))) = {nullptr, nullptr, nullptr, nullptr};
+static void *context_table[4] = {nullptr, nullptr, nullptr, nullptr};
 uint8_t IntervalTimer::nvic_priorites[4] = {255, 255, 255, 255};
 
 
-bool IntervalTimer::beginCycles(void (*funct)(), uint32_t cycles)
+// timers sharing a channel must have periods which are a multiple of
+// a shared period at least this long (10 us)
+#define SHARED_MIN_CYCLES (24000000 / 100000)
+
+IntervalTimer * IntervalTimer::shared_list = nullptr;
+uint32_t IntervalTimer::shared_base = 0;
+uint32_t IntervalTimer::shared_pending = 0;
+int IntervalTimer::shared_index = -1;
+
+bool IntervalTimer::beginCycles(void (*funct)(void *), void *context, uint32_t cycles)
 {
 	printf("beginCycles %u\n", cycles);
+	if (shared_funct) endShared();
 	if (channel) {
 		channel->TCTRL = 0;
 		channel->TFLG = 1;
@@ -48,16 +59,27 @@ bool IntervalTimer::beginCycles(void (*funct)(), uint32_t cycles)
 		CCM_CCGR1 |= CCM_CCGR1_PIT(CCM_CCGR_ON);
 		//__asm__ volatile("nop"); // solves timing problem on Teensy 3.5
 		PIT_MCR = 1;
-		channel = IMXRT_PIT_CHANNELS;
-		while (1) {
-			if (channel->TCTRL == 0) break;
-			if (++channel >= IMXRT_PIT_CHANNELS + NUM_CHANNELS) {
-				channel = NULL;
-				return false;
+		int nfree = 0;
+		for (int i=0; i < NUM_CHANNELS; i++) {
+			if (IMXRT_PIT_CHANNELS[i].TCTRL == 0) {
+				if (nfree++ == 0) channel = IMXRT_PIT_CHANNELS + i;
 			}
 		}
+		if (nfree < 2 && !require_dedicated) {
+			// keep the last channel for sharing among many timers
+			channel = NULL;
+			if (beginShared(funct, context, cycles)) return true;
+			if (nfree == 0) return false;
+			channel = IMXRT_PIT_CHANNELS;
+			while (channel->TCTRL != 0) channel++;
+		}
+		if (nfree == 0) {
+			channel = NULL;
+			return false;
+		}
 	}
 	int index = channel - IMXRT_PIT_CHANNELS;
+	context_table[index] = context;
 	funct_table[index] = funct;
 	channel->LDVAL = cycles;
 	channel->TCTRL = 3;
@@ -89,6 +111,163 @@ void IntervalTimer::end() {
 		channel = 0;
 	}
 #endif
+	if (shared_funct) endShared();
+}
+
+static uint32_t gcd(uint32_t a, uint32_t b)
+{
+	while (b) {
+		uint32_t t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+bool IntervalTimer::beginShared(void (*funct)(void *), void *context, uint32_t cycles)
+{
+	uint32_t period = cycles + 1;
+	if (shared_index < 0) {
+		// first shared timer, start the shared channel at its period
+		int index = 0;
+		while (IMXRT_PIT_CHANNELS[index].TCTRL != 0) {
+			if (++index >= NUM_CHANNELS) return false;
+		}
+		shared_funct = funct;
+		shared_context = context;
+		shared_period = period;
+		shared_count = 1;
+		shared_fresh = false;
+		shared_due = false;
+		shared_next = nullptr;
+		shared_list = this;
+		shared_base = period;
+		shared_pending = 0;
+		shared_index = index;
+		funct_table[index] = (void (*)(void *))&shared_isr;
+		IMXRT_PIT_CHANNEL_t *ch = IMXRT_PIT_CHANNELS + index;
+		ch->TFLG = 1;
+		ch->LDVAL = cycles;
+		ch->TCTRL = 3;
+		attachInterruptVector(IRQ_PIT, &pit_isr);
+		sharedPriority();
+		NVIC_ENABLE_IRQ(IRQ_PIT);
+		return true;
+	}
+	uint32_t base = shared_pending ? shared_pending : shared_base;
+	uint32_t newbase = gcd(base, period);
+	if (newbase < SHARED_MIN_CYCLES) return false;
+	__disable_irq();
+	if (newbase != base) {
+		// the hardware switches to the new shared period after the
+		// current one ends.  Fresh timers already count in the
+		// pending units, so they must be converted now.
+		uint32_t ratio = base / newbase;
+		for (IntervalTimer *t = shared_list; t; t = t->shared_next) {
+			if (t->shared_fresh) t->shared_count *= ratio;
+		}
+		shared_pending = newbase;
+		IMXRT_PIT_CHANNELS[shared_index].LDVAL = newbase - 1;
+	}
+	shared_funct = funct;
+	shared_context = context;
+	shared_period = period;
+	shared_count = period / newbase;
+	shared_fresh = true;
+	shared_due = false;
+	shared_next = nullptr;
+	IntervalTimer **p = &shared_list;
+	while (*p) p = &((*p)->shared_next);
+	*p = this;
+	__enable_irq();
+	sharedPriority();
+	return true;
+}
+
+void IntervalTimer::updateShared(uint32_t cycles)
+{
+	uint32_t period = cycles + 1;
+	uint32_t base = shared_pending ? shared_pending : shared_base;
+	if ((period % base) == 0) {
+		// takes effect after the next call, like LDVAL on a channel
+		shared_period = period;
+	} else {
+		beginCycles(shared_funct, shared_context, cycles);
+	}
+}
+
+void IntervalTimer::endShared()
+{
+	__disable_irq();
+	IntervalTimer **p = &shared_list;
+	while (*p) {
+		if (*p == this) {
+			*p = shared_next;
+			break;
+		}
+		p = &((*p)->shared_next);
+	}
+	shared_funct = nullptr;
+	shared_next = nullptr;
+	shared_due = false;
+	if (shared_list == nullptr && shared_index >= 0) {
+		// last shared timer, give the channel back
+		IMXRT_PIT_CHANNELS[shared_index].TCTRL = 0;
+		funct_table[shared_index] = nullptr;
+		nvic_priorites[shared_index] = 255;
+		shared_index = -1;
+		shared_base = 0;
+		shared_pending = 0;
+	}
+	__enable_irq();
+	sharedPriority();
+}
+
+void IntervalTimer::sharedPriority()
+{
+	if (shared_index >= 0) {
+		uint8_t priority = 255;
+		for (IntervalTimer *t = shared_list; t; t = t->shared_next) {
+			if (priority > t->nvic_priority) priority = t->nvic_priority;
+		}
+		nvic_priorites[shared_index] = priority;
+	}
+	uint8_t top_priority = 255;
+	for (int i=0; i < NUM_CHANNELS; i++) {
+		if (top_priority > nvic_priorites[i]) top_priority = nvic_priorites[i];
+	}
+	NVIC_SET_PRIORITY(IRQ_PIT, top_priority);
+}
+
+// called by pit_isr() at the end of every shared period
+void IntervalTimer::shared_isr()
+{
+	uint32_t ratio = 1;
+	if (shared_pending) {
+		// the hardware has just started the new, shorter period
+		ratio = shared_base / shared_pending;
+		shared_base = shared_pending;
+		shared_pending = 0;
+	}
+	IntervalTimer *t;
+	for (t = shared_list; t; t = t->shared_next) {
+		if (t->shared_fresh) {
+			t->shared_fresh = false;
+		} else if (--(t->shared_count) == 0) {
+			t->shared_count = t->shared_period / shared_base;
+			t->shared_due = true;
+		} else {
+			t->shared_count *= ratio;
+		}
+	}
+	// Functions may end or begin any shared timer, so search again
+	// from the start after each call.
+	while (1) {
+		for (t = shared_list; t && !t->shared_due; t = t->shared_next) ;
+		if (!t) break;
+		t->shared_due = false;
+		(*(t->shared_funct))(t->shared_context);
+	}
 }
 
 //FASTRUN
@@ -99,18 +278,18 @@ static void pit_isr()
 		IMXRT_PIT_CHANNEL_t *channel = IMXRT_PIT_CHANNELS + i;
 		if (funct_table[0] && channel->TFLG) {
 			channel->TFLG = 1;
-			funct_table[i]();
+			funct_table[i](context_table[i]);
 
 		}
 	}
 #else
 	IMXRT_PIT_CHANNEL_t *channel= IMXRT_PIT_CHANNELS;
-	if (funct_table[0] != nullptr && channel->TFLG) {channel->TFLG = 1;funct_table[0]();}
+	if (funct_table[0] != nullptr && channel->TFLG) {channel->TFLG = 1;funct_table[0](context_table[0]);}
 	channel++;
-	if (funct_table[1] != nullptr && channel->TFLG) {channel->TFLG = 1;funct_table[1]();}
+	if (funct_table[1] != nullptr && channel->TFLG) {channel->TFLG = 1;funct_table[1](context_table[1]);}
 	channel++;
-	if (funct_table[2] != nullptr && channel->TFLG) {channel->TFLG = 1;funct_table[2]();}
+	if (funct_table[2] != nullptr && channel->TFLG) {channel->TFLG = 1;funct_table[2](context_table[2]);}
 	channel++;
-	if (funct_table[3] != nullptr && channel->TFLG) {channel->TFLG = 1;funct_table[3]();}
+	if (funct_table[3] != nullptr && channel->TFLG) {channel->TFLG = 1;funct_table[3](context_table[3]);}
 #endif
 }
@@ -33,6 +33,7 @@
 
 #include <stddef.h>
 #include "imxrt.h"
+#include "irq_priority.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -51,7 +52,7 @@ public:
 		if (microseconds == 0 || microseconds > MAX_PERIOD) return false;
 		uint32_t cycles = (24000000 / 1000000) * microseconds - 1;
 		if (cycles < 17) return false;
-		return beginCycles(funct, cycles);
+		return beginCycles((void (*)(void *))funct, nullptr, cycles);
 	}
 	bool begin(void (*funct)(), int microseconds) {
 		if (microseconds < 0) return false;
@@ -67,16 +68,44 @@ public:
 		if (microseconds <= 0 || microseconds > MAX_PERIOD) return false;
 		uint32_t cycles = (float)(24000000 / 1000000) * microseconds - 0.5f;
 		if (cycles < 17) return false;
-		return beginCycles(funct, cycles);
+		return beginCycles((void (*)(void *))funct, nullptr, cycles);
 	}
 	bool begin(void (*funct)(), double microseconds) {
 		return begin(funct, (float)microseconds);
 	}
+	// As above, but funct is called with context, so a class can use a
+	// member of its own instance without a static shim function.
+	bool begin(void (*funct)(void *), void *context, unsigned int microseconds) {
+		if (microseconds == 0 || microseconds > MAX_PERIOD) return false;
+		uint32_t cycles = (24000000 / 1000000) * microseconds - 1;
+		if (cycles < 17) return false;
+		return beginCycles(funct, context, cycles);
+	}
+	bool begin(void (*funct)(void *), void *context, int microseconds) {
+		if (microseconds < 0) return false;
+		return begin(funct, context, (unsigned int)microseconds);
+	}
+	bool begin(void (*funct)(void *), void *context, unsigned long microseconds) {
+		return begin(funct, context, (unsigned int)microseconds);
+	}
+	bool begin(void (*funct)(void *), void *context, long microseconds) {
+		return begin(funct, context, (int)microseconds);
+	}
+	bool begin(void (*funct)(void *), void *context, float microseconds) {
+		if (microseconds <= 0 || microseconds > MAX_PERIOD) return false;
+		uint32_t cycles = (float)(24000000 / 1000000) * microseconds - 0.5f;
+		if (cycles < 17) return false;
+		return beginCycles(funct, context, cycles);
+	}
+	bool begin(void (*funct)(void *), void *context, double microseconds) {
+		return begin(funct, context, (float)microseconds);
+	}
 	void update(unsigned int microseconds) {
 		if (microseconds == 0 || microseconds > MAX_PERIOD) return;
 		uint32_t cycles = (24000000 / 1000000) * microseconds - 1;
 		if (cycles < 17) return;
 		if (channel) channel->LDVAL = cycles;
+		else if (shared_funct) updateShared(cycles);
 	}
 	void update(int microseconds) {
 		if (microseconds < 0) return;
@@ -93,6 +122,7 @@ public:
 		uint32_t cycles = (float)(24000000 / 1000000) * microseconds - 0.5f;
 		if (cycles < 17) return;
 		if (channel) channel->LDVAL = cycles;
+		else if (shared_funct) updateShared(cycles);
 	}
 	void update(double microseconds) {
 		return update((float)microseconds);
@@ -108,10 +138,21 @@ public:
 				if (top_priority > nvic_priorites[i]) top_priority = nvic_priorites[i];
 			}
 			NVIC_SET_PRIORITY(IRQ_PIT, top_priority);
+		} else if (shared_funct) {
+			sharedPriority();
 		}
 	}
+	// Only 4 PIT channels exist.  When only one remains free, further
+	// timers share it, provided their periods have a common divisor of
+	// at least 10 us.  Shared timers can have up to one shared period of
+	// extra delay on their first call and slightly more latency.  Call
+	// dedicated() before begin() for timers which must have a channel to
+	// themselves, so begin() fails rather than sharing.
+	void dedicated(bool require=true) {
+		require_dedicated = require;
+	}
 	operator IRQ_NUMBER_t() {
-		if (channel) {
+		if (channel || shared_funct) {
 			return IRQ_PIT;
 		}
 		return (IRQ_NUMBER_t)NVIC_NUM_INTERRUPTS;
@@ -119,9 +160,29 @@ public:
 private:
 //#define IMXRT_PIT_CHANNELS              ((IMXRT_PIT_CHANNEL_t *)(&(IMXRT_PIT.offset100)))
 	IMXRT_PIT_CHANNEL_t *channel = nullptr;
-	uint8_t nvic_priority = 128;
+	uint8_t nvic_priority = IRQ_PRIORITY_TIMER;
+	bool require_dedicated = false;
 	static uint8_t nvic_priorites[4];
-	bool beginCycles(void (*funct)(), uint32_t cycles);
+	// functions without context are stored with a cast, they ignore the
+	// argument passed in r0, so both kinds are called the same way
+	bool beginCycles(void (*funct)(void *), void *context, uint32_t cycles);
+	// sharing a single PIT channel
+	bool beginShared(void (*funct)(void *), void *context, uint32_t cycles);
+	void updateShared(uint32_t cycles);
+	void endShared();
+	static void sharedPriority();
+	static void shared_isr();
+	void (*shared_funct)(void *) = nullptr;
+	void *shared_context = nullptr;
+	IntervalTimer *shared_next = nullptr;
+	uint32_t shared_period = 0;  // in 24 MHz cycles
+	uint32_t shared_count = 0;   // shared periods until next call
+	bool shared_fresh = false;   // count starts after the current period
+	bool shared_due = false;
+	static IntervalTimer *shared_list;
+	static uint32_t shared_base;    // cycles per shared period
+	static uint32_t shared_pending; // new shared_base, starting next period
+	static int shared_index;        // PIT channel used, or -1
 
 };
 
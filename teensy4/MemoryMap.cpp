@@ -0,0 +1,147 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <Arduino.h>
+#include <MemoryMap.h>
+#include <malloc.h>
+#include "smalloc.h"
+
+extern "C" unsigned long _stext;
+extern "C" unsigned long _etext;
+extern "C" unsigned long _sdata;
+extern "C" unsigned long _ebss;
+extern "C" unsigned long _estack;
+extern "C" unsigned long _heap_start;
+extern "C" unsigned long _heap_end;
+extern "C" unsigned long _itcm_block_count;
+extern "C" unsigned long _flashimagelen;
+extern "C" char *__brkval;
+#ifdef ARDUINO_TEENSY41
+extern "C" unsigned long _extram_start;
+extern "C" unsigned long _extram_end;
+extern "C" uint8_t external_psram_size;
+#endif
+
+#if defined(ARDUINO_TEENSY40)
+#define FLASH_SIZE (1984 * 1024)	// 2 MB, less the EEPROM emulation
+#elif defined(ARDUINO_TEENSY41)
+#define FLASH_SIZE (7936 * 1024)	// 8 MB
+#else
+#define FLASH_SIZE (16128 * 1024)	// 16 MB, MicroMod
+#endif
+
+MemoryMapClass MemoryMap;
+
+// smalloc pools, which are unused until their first allocation
+static void pool_usage(struct smalloc_pool *pool, uint32_t *heap, uint32_t *heap_free)
+{
+	size_t total, user, free;
+	int blocks;
+
+	*heap = 0;
+	*heap_free = 0;
+	if (pool->pool_size == 0) return;
+	if (sm_malloc_stats_pool(pool, &total, &user, &free, &blocks) < 0) return;
+	*heap = total;
+	*heap_free = free;
+}
+
+bool MemoryMapClass::region(int n, MemoryRegion &r) const
+{
+	memset(&r, 0, sizeof(r));
+	switch (n) {
+	case MEMORY_REGION_ITCM:
+		r.name = "ITCM";
+		r.start = 0;
+		r.size = (uint32_t)&_itcm_block_count << 15;
+		r.code = (uint32_t)&_etext - (uint32_t)&_stext;
+		break;
+	case MEMORY_REGION_DTCM:
+		r.name = "DTCM";
+		r.start = 0x20000000;
+		r.size = (uint32_t)&_estack - r.start;
+		r.data = (uint32_t)&_ebss + 32 - (uint32_t)&_sdata;
+		pool_usage(&dtcm_smalloc_pool, &r.heap, &r.heapFree);
+		r.data -= dtcm_smalloc_pool.pool_size;	// malloc_fast memory is in bss
+		r.stack = stackHighWater();
+		break;
+	case MEMORY_REGION_OCRAM: {
+		r.name = "OCRAM";
+		r.start = 0x20200000;
+		r.size = (uint32_t)&_heap_end - r.start;
+		r.data = (uint32_t)&_heap_start - r.start;
+		// newlib's free chunks, plus memory sbrk hasn't yet given it
+		struct mallinfo mi = mallinfo();
+		r.heap = mi.uordblks;
+		r.heapFree = mi.fordblks + ((uint32_t)&_heap_end - (uint32_t)__brkval);
+		break;
+	}
+	case MEMORY_REGION_FLASH:
+		r.name = "FLASH";
+		r.start = 0x60000000;
+		r.size = FLASH_SIZE;
+		r.code = (uint32_t)&_flashimagelen;
+		break;
+	case MEMORY_REGION_EXTMEM:
+#ifdef ARDUINO_TEENSY41
+		if (external_psram_size == 0) return false;
+		r.name = "EXTMEM";
+		r.start = 0x70000000;
+		r.size = (uint32_t)external_psram_size << 20;
+		r.data = (uint32_t)&_extram_end - (uint32_t)&_extram_start;
+		pool_usage(&extmem_smalloc_pool, &r.heap, &r.heapFree);
+		break;
+#else
+		return false;
+#endif
+	default:
+		return false;
+	}
+	uint32_t used = r.code + r.data + r.heap + r.heapFree + r.stack;
+	r.free = (r.size > used) ? r.size - used : 0;
+	return true;
+}
+
+FLASHMEM
+size_t MemoryMapClass::printTo(Print& p) const
+{
+	size_t n = 0;
+	MemoryRegion r;
+
+	n += p.println("MemoryMap:  start       size     code     data     heap heapfree    stack     free");
+	for (int i=0; i < MEMORY_REGION_COUNT; i++) {
+		if (!region(i, r)) continue;
+		n += p.printf("  %-6s 0x%08X %8u %8u %8u %8u %8u %8u %8u\n", r.name,
+			(unsigned int)r.start, (unsigned int)r.size, (unsigned int)r.code,
+			(unsigned int)r.data, (unsigned int)r.heap, (unsigned int)r.heapFree,
+			(unsigned int)r.stack, (unsigned int)r.free);
+	}
+	return n;
+}
@@ -0,0 +1,75 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <Printable.h>
+#include <stdint.h>
+
+// Where the memory went, at runtime, for each region of the memory map.
+// Sizes come from the linker's symbols, the heaps and the painted stack
+// (see stackHighWater), so they reflect this program as it runs, rather
+// than the estimate printed by the build.  Serial.print(MemoryMap) shows
+// a table, or region() gives the numbers to check in code.
+//
+//   code       instructions, and for flash, the whole program image
+//   data       variables, initialized and zero (DTCM: also the MPU stack
+//              guard, OCRAM: DMAMEM, EXTMEM: EXTMEM variables)
+//   heap       bytes allocated by malloc, malloc_fast or extmem_malloc
+//   heapFree   available within the heap, which may be fragmented
+//   stack      most stack ever used
+//   free       everything else, for DTCM the stack which has never been used
+#define MEMORY_REGION_ITCM	0
+#define MEMORY_REGION_DTCM	1
+#define MEMORY_REGION_OCRAM	2
+#define MEMORY_REGION_FLASH	3
+#define MEMORY_REGION_EXTMEM	4
+#define MEMORY_REGION_COUNT	5
+
+struct MemoryRegion {
+	const char *name;
+	uint32_t start;
+	uint32_t size;
+	uint32_t code;
+	uint32_t data;
+	uint32_t heap;
+	uint32_t heapFree;
+	uint32_t stack;
+	uint32_t free;
+};
+
+class MemoryMapClass: public Printable {
+public:
+	// false for regions this Teensy doesn't have, like EXTMEM without PSRAM
+	bool region(int n, MemoryRegion &r) const;
+	virtual size_t printTo(Print& p) const;
+};
+
+extern MemoryMapClass MemoryMap;
@@ -0,0 +1,155 @@
+/* EventResponder - Simple event-based programming for Arduino
+ * Copyright 2017 Paul Stoffregen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <Arduino.h>
+#include "EventResponder.h"
+
+// A timer due within this many 24 MHz ticks is run now, rather than
+// risk the counter passing the compare value before it is written.
+#define MICROSTIMER_MARGIN  3
+
+MicrosTimer * MicrosTimer::listActive = nullptr;
+bool MicrosTimer::hardwareReady = false;
+
+bool MicrosTimer::begin(unsigned long microseconds, EventResponderRef event)
+{
+	return begin(microseconds, 0, event);
+}
+
+bool MicrosTimer::beginRepeating(unsigned long microseconds, EventResponderRef event)
+{
+	// repeating faster than the interrupt can run would never return
+	if (microseconds < 2) return false;
+	return begin(microseconds, microseconds * 24, event);
+}
+
+bool MicrosTimer::begin(unsigned long microseconds, uint32_t period, EventResponderRef event)
+{
+	if (microseconds == 0 || microseconds > MICROSTIMER_MAX_MICROSECONDS) return false;
+	end();
+	if (!hardwareReady) {
+		// GPT2 runs free from the 24 MHz peripheral clock
+		CCM_CCGR0 |= CCM_CCGR0_GPT2_BUS(CCM_CCGR_ON) | CCM_CCGR0_GPT2_SERIAL(CCM_CCGR_ON);
+		GPT2_CR = 0;
+		GPT2_PR = 0;
+		GPT2_IR = 0;
+		GPT2_SR = 0x3F;
+		GPT2_CR = GPT_CR_CLKSRC(1) | GPT_CR_FRR | GPT_CR_ENMOD;
+		GPT2_CR |= GPT_CR_EN;
+		attachInterruptVector(IRQ_GPT2, isr);
+		NVIC_ENABLE_IRQ(IRQ_GPT2);
+		hardwareReady = true;
+	}
+	_event = &event;
+	_period = period;
+	bool irq = disableTimerInterrupt();
+	_deadline = GPT2_CNT + microseconds * 24;
+	addToActiveList();
+	if (listActive == this) {
+		GPT2_OCR1 = _deadline;
+		GPT2_IR = GPT_IR_OF1IE;
+		if ((int32_t)(_deadline - GPT2_CNT) <= MICROSTIMER_MARGIN) {
+			NVIC_SET_PENDING(IRQ_GPT2);
+		}
+	}
+	enableTimerInterrupt(irq);
+	return true;
+}
+
+void MicrosTimer::end()
+{
+	bool irq = disableTimerInterrupt();
+	if (_active) {
+		removeFromActiveList();
+		// the compare register is left alone, if this timer was first
+		// the interrupt will find nothing due and set the next deadline
+	}
+	enableTimerInterrupt(irq);
+}
+
+// must be called with interrupts disabled
+void MicrosTimer::addToActiveList()
+{
+	MicrosTimer *timer = listActive;
+	MicrosTimer *prev = nullptr;
+	while (timer && (int32_t)(timer->_deadline - _deadline) <= 0) {
+		prev = timer;
+		timer = timer->_next;
+	}
+	_prev = prev;
+	_next = timer;
+	if (prev) {
+		prev->_next = this;
+	} else {
+		listActive = this;
+	}
+	if (timer) timer->_prev = this;
+	_active = true;
+}
+
+// must be called with interrupts disabled
+void MicrosTimer::removeFromActiveList()
+{
+	if (_prev) {
+		_prev->_next = _next;
+	} else {
+		listActive = _next;
+	}
+	if (_next) _next->_prev = _prev;
+	_next = nullptr;
+	_prev = nullptr;
+	_active = false;
+}
+
+void MicrosTimer::isr()
+{
+	GPT2_SR = GPT_SR_OF1;
+	while (1) {
+		bool irq = disableTimerInterrupt();
+		MicrosTimer *timer = listActive;
+		if (!timer) {
+			GPT2_IR = 0;
+			enableTimerInterrupt(irq);
+			break;
+		}
+		if ((int32_t)(timer->_deadline - GPT2_CNT) > MICROSTIMER_MARGIN) {
+			GPT2_OCR1 = timer->_deadline;
+			// check again, in case the counter passed while writing
+			if ((int32_t)(timer->_deadline - GPT2_CNT) > MICROSTIMER_MARGIN) {
+				enableTimerInterrupt(irq);
+				break;
+			}
+		}
+		timer->removeFromActiveList();
+		if (timer->_period) {
+			// next deadline is based on the last, so repeating
+			// timers do not drift
+			timer->_deadline += timer->_period;
+			timer->addToActiveList();
+		}
+		enableTimerInterrupt(irq);
+		timer->_event->triggerEvent(0, timer);
+	}
+	asm("dsb");
+}
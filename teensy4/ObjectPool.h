@@ -0,0 +1,162 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2024 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef ObjectPool_h_
+#define ObjectPool_h_
+
+#ifdef __cplusplus
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ObjectPool<T, N> is a fixed set of N objects of type T, allocated and
+// freed in constant time without disabling interrupts, so it may be used
+// from any interrupt.  Each slot is one bit in a bitmap, claimed with
+// LDREX/STREX, and the lowest free slot is found with CLZ.
+//
+// The pool may be placed in any memory:
+//
+//   ObjectPool<mydata_t, 16> pool;             // DTCM, ready at startup
+//   DMAMEM ObjectPool<mydata_t, 16> dmapool;   // OCRAM, call begin()
+//   EXTMEM ObjectPool<mydata_t, 16> bigpool;   // PSRAM, call begin()
+//
+// DMAMEM and EXTMEM are not initialized at startup, so pools placed there
+// must call begin() before any other use.  allocate() returns raw
+// storage; no constructor or destructor is run.
+
+template <typename T, unsigned int N>
+class ObjectPool {
+	static_assert(N > 0, "ObjectPool must have at least 1 object");
+public:
+	constexpr ObjectPool() {}
+	// Mark all objects free and clear the statistics.
+	void begin() {
+		for (unsigned int i=0; i < WORDS; i++) bitmap[i] = 0;
+		inuse = 0;
+		highwater = 0;
+	}
+	// Claim an object, or NULL if all are in use.  The memory is not
+	// initialized.
+	T * allocate() {
+		for (unsigned int i=0; i < WORDS; i++) {
+			uint32_t word, fail;
+			do {
+				word = load_exclusive(&bitmap[i]);
+				unsigned int n = (~word) ? __builtin_clz(~word) : 32;
+				if (n >= 32 || i * 32 + n >= N) {
+					clear_exclusive();
+					break;
+				}
+				fail = store_exclusive(&bitmap[i], word | (0x80000000 >> n));
+				if (!fail) {
+					count_allocate();
+					return (T *)storage + (i * 32 + n);
+				}
+			} while (1);
+		}
+		return NULL;
+	}
+	// Return an object claimed by allocate().  Pointers not belonging
+	// to this pool (or NULL) are ignored.
+	void release(T *p) {
+		if (!contains(p)) return;
+		unsigned int n = p - (T *)storage;
+		volatile uint32_t *word = &bitmap[n >> 5];
+		uint32_t mask = 0x80000000 >> (n & 31);
+		uint32_t val, fail;
+		do {
+			val = load_exclusive(word);
+			if (!(val & mask)) {
+				clear_exclusive(); // already free
+				return;
+			}
+			fail = store_exclusive(word, val & ~mask);
+		} while (fail);
+		count_release();
+	}
+	bool contains(const T *p) const {
+		const T *first = (const T *)storage;
+		return p >= first && p < first + N;
+	}
+	// Convert between objects and their index, 0 to N-1
+	unsigned int indexOf(const T *p) const { return p - (const T *)storage; }
+	T * operator[](unsigned int index) { return (T *)storage + index; }
+	static constexpr unsigned int capacity() { return N; }
+	unsigned int used() const { return inuse; }
+	unsigned int available() const { return N - inuse; }
+	// The largest number of objects ever in use at once.
+	unsigned int highWater() const { return highwater; }
+	void resetHighWater() { highwater = inuse; }
+private:
+	static const unsigned int WORDS = (N + 31) / 32;
+	static uint32_t load_exclusive(volatile uint32_t *addr) {
+		uint32_t val;
+		__asm__ volatile("ldrex %0, [%1]" : "=r" (val) : "r" (addr));
+		return val;
+	}
+	static uint32_t store_exclusive(volatile uint32_t *addr, uint32_t val) {
+		uint32_t fail;
+		__asm__ volatile("strex %0, %1, [%2]" : "=&r" (fail) : "r" (val), "r" (addr) : "memory");
+		return fail;
+	}
+	static void clear_exclusive() {
+		__asm__ volatile("clrex" ::: "memory");
+	}
+	void count_allocate() {
+		uint32_t n, fail;
+		do {
+			n = load_exclusive(&inuse) + 1;
+			fail = store_exclusive(&inuse, n);
+		} while (fail);
+		uint32_t max;
+		do {
+			max = load_exclusive(&highwater);
+			if (n <= max) {
+				clear_exclusive();
+				break;
+			}
+			fail = store_exclusive(&highwater, n);
+		} while (fail);
+	}
+	void count_release() {
+		uint32_t n, fail;
+		do {
+			n = load_exclusive(&inuse);
+			fail = store_exclusive(&inuse, n - 1);
+		} while (fail);
+	}
+	alignas(T) uint8_t storage[N * sizeof(T)] = {};
+	volatile uint32_t bitmap[WORDS] = {};
+	volatile uint32_t inuse = 0;
+	volatile uint32_t highwater = 0;
+};
+
+#endif // __cplusplus
+#endif
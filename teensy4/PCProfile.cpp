@@ -0,0 +1,324 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <Arduino.h>
+#include <PCProfile.h>
+#include <EventResponder.h>
+#include <stdlib.h>
+
+extern "C" unsigned long _stext;
+extern "C" unsigned long _etext;
+extern "C" unsigned long _sflashcode;
+extern "C" unsigned long _eflashcode;
+extern "C" unsigned long _stextload;
+
+#define BUCKET_SHIFT 5	// 32 byte blocks
+
+static uint16_t *histogram = NULL;
+static uint32_t histogram_size = 0;	// ITCM blocks, then flash code blocks
+static uint32_t histogram_itcm_size = 0;
+static volatile uint32_t samples_itcm, samples_flash, samples_other;
+static volatile uint32_t samples_flexspi_busy;
+static void (*chained_systick)(void) = NULL;
+
+PCProfileClass PCProfile;
+
+extern "C" void pc_profile_sample(uint32_t pc)
+{
+	uint32_t offset = pc - (uint32_t)&_stext;
+	uint16_t *h = NULL;
+	if (offset < (histogram_itcm_size << BUCKET_SHIFT)) {
+		h = histogram + (offset >> BUCKET_SHIFT);
+		samples_itcm++;
+	} else if (pc >= 0x60000000 && pc < 0x70000000) {
+		offset = pc - (uint32_t)&_sflashcode;
+		if (offset < ((histogram_size - histogram_itcm_size) << BUCKET_SHIFT)) {
+			h = histogram + histogram_itcm_size + (offset >> BUCKET_SHIFT);
+		}
+		samples_flash++;
+	} else {
+		samples_other++;
+	}
+	if (h && *h < 0xFFFF) *h = *h + 1;
+	if (!(FLEXSPI_STS0 & FLEXSPI_STS0_ARBIDLE)) samples_flexspi_busy++;
+	(*chained_systick)();
+}
+
+// Find the stacked program counter (ARM DDI0403E, pg 537) and pass it to
+// pc_profile_sample, which then runs the normal systick interrupt.  The
+// branch leaves LR holding EXC_RETURN, so its return ends the exception.
+extern "C" __attribute__((naked)) void pc_profile_systick_isr(void)
+{
+	asm volatile(
+		"tst	lr, #4\n"
+		"ite	eq\n"
+		"mrseq	r0, msp\n"
+		"mrsne	r0, psp\n"
+		"ldr	r0, [r0, #24]\n"
+		"b	pc_profile_sample\n");
+}
+
+bool PCProfileClass::begin()
+{
+	if (!histogram) {
+		uint32_t itcm = (((uint32_t)&_etext - (uint32_t)&_stext) >> BUCKET_SHIFT) + 1;
+		uint32_t flash = (((uint32_t)&_eflashcode - (uint32_t)&_sflashcode) >> BUCKET_SHIFT) + 1;
+		histogram = (uint16_t *)calloc(itcm + flash, sizeof(uint16_t));
+		if (!histogram) return false;
+		histogram_itcm_size = itcm;
+		histogram_size = itcm + flash;
+		samples_itcm = samples_flash = samples_other = 0;
+		samples_flexspi_busy = 0;
+	}
+	__disable_irq();
+	if (_VectorsRam[15] != pc_profile_systick_isr) {
+		chained_systick = _VectorsRam[15];
+		_VectorsRam[15] = pc_profile_systick_isr;
+	}
+	__enable_irq();
+	return true;
+}
+
+void PCProfileClass::end()
+{
+	__disable_irq();
+	if (_VectorsRam[15] == pc_profile_systick_isr) {
+		_VectorsRam[15] = chained_systick;
+	}
+	__enable_irq();
+}
+
+void PCProfileClass::clear()
+{
+	end();
+	free(histogram);
+	histogram = NULL;
+	histogram_size = 0;
+	histogram_itcm_size = 0;
+	samples_itcm = samples_flash = samples_other = 0;
+	samples_flexspi_busy = 0;
+}
+
+uint32_t PCProfileClass::samples() const
+{
+	return samples_itcm + samples_flash + samples_other;
+}
+
+uint32_t PCProfileClass::flashFetchCycles(void (*function)(void))
+{
+	uint32_t primask, begin, cold, warm;
+
+	__asm__ volatile("mrs %0, primask\n" : "=r" (primask)::);
+	__disable_irq();
+	asm("dsb");
+	asm("isb");
+	SCB_CACHE_ICIALLU = 0;
+	asm("dsb");
+	asm("isb");
+	begin = ARM_DWT_CYCCNT;
+	(*function)();
+	cold = ARM_DWT_CYCCNT - begin;
+	begin = ARM_DWT_CYCCNT;
+	(*function)();
+	warm = ARM_DWT_CYCCNT - begin;
+	if (!primask) __enable_irq();
+	return (cold > warm) ? cold - warm : 0;
+}
+
+#define GPT_TICKS_PER_USEC 24	// GPT1 runs from the 24 MHz peripheral clock
+#define STREAM_LINE 18		// "PPPPPPPP LLLLLLLL\n"
+
+static uint32_t *stream_ring = NULL;	// PC, LR pairs
+static uint32_t stream_mask;
+static volatile uint32_t stream_head;
+static volatile uint32_t stream_tail;
+static volatile uint32_t stream_dropped;
+static uint32_t stream_rate;
+static uint32_t stream_until_header;
+static Print *stream_out;
+static EventResponder stream_event;
+static MillisTimer stream_timer;
+
+extern "C" void pc_profile_stream_sample(const uint32_t *frame)
+{
+	GPT1_SR = GPT_SR_OF1;
+	uint32_t head = stream_head;
+	if (head - stream_tail > stream_mask) {
+		stream_dropped++;
+	} else {
+		uint32_t *p = stream_ring + (head & stream_mask) * 2;
+		p[0] = frame[6];	// stacked PC
+		p[1] = frame[5];	// stacked LR
+		stream_head = head + 1;
+	}
+	asm("dsb");
+}
+
+// Pass the stacked exception frame (ARM DDI0403E, pg 537)
+extern "C" __attribute__((naked)) void pc_profile_stream_isr(void)
+{
+	asm volatile(
+		"tst	lr, #4\n"
+		"ite	eq\n"
+		"mrseq	r0, msp\n"
+		"mrsne	r0, psp\n"
+		"b	pc_profile_stream_sample\n");
+}
+
+static char * hex32(char *p, uint32_t n)
+{
+	for (int i=28; i >= 0; i -= 4) {
+		*p++ = "0123456789ABCDEF"[(n >> i) & 15];
+	}
+	return p;
+}
+
+// Runs from yield(), writing only what fits in the output's buffer.  It
+// triggers itself again only while samples remain and the output has room,
+// otherwise it checks back 1 ms later, so yield() can still sleep.
+static void stream_drain(EventResponderRef event)
+{
+	char buf[STREAM_LINE * 16];
+
+	if (!stream_ring) return;
+	Print &out = *stream_out;
+	if (stream_until_header == 0) {
+		if (out.availableForWrite() < 64) goto done;
+		out.printf("@ %u Hz itcm %08X load %08X flash %08X\n",
+			(unsigned int)stream_rate, (unsigned int)&_stext,
+			(unsigned int)&_stextload, (unsigned int)&_sflashcode);
+		stream_until_header = stream_rate;	// repeat every second
+	}
+	if (stream_dropped) {
+		if (out.availableForWrite() < 16) goto done;
+		__disable_irq();
+		uint32_t dropped = stream_dropped;
+		stream_dropped = 0;
+		__enable_irq();
+		out.printf("! %u\n", (unsigned int)dropped);
+	}
+	while (1) {
+		uint32_t count = stream_head - stream_tail;
+		int space = out.availableForWrite() / STREAM_LINE;
+		if (count > (uint32_t)space) count = space;
+		if (count > sizeof(buf) / STREAM_LINE) count = sizeof(buf) / STREAM_LINE;
+		if (count > stream_until_header) count = stream_until_header;
+		if (count == 0) break;
+		char *p = buf;
+		uint32_t tail = stream_tail;
+		for (uint32_t i=0; i < count; i++) {
+			const uint32_t *s = stream_ring + ((tail + i) & stream_mask) * 2;
+			p = hex32(p, s[0]);
+			*p++ = ' ';
+			p = hex32(p, s[1]);
+			*p++ = '\n';
+		}
+		stream_tail = tail + count;
+		stream_until_header -= count;
+		out.write((const uint8_t *)buf, p - buf);
+	}
+done:
+	if (stream_head != stream_tail && out.availableForWrite() >= STREAM_LINE) {
+		event.triggerEvent();
+	} else {
+		stream_timer.begin(1, event);
+	}
+}
+
+bool PCProfileClass::beginStream(Print &out, uint32_t rate, uint32_t buffer, uint8_t priority)
+{
+	if (rate == 0 || rate > 1000000) return false;
+	if (buffer < 16 || (buffer & (buffer - 1))) return false;
+	endStream();
+	stream_ring = (uint32_t *)malloc(buffer * 8);
+	if (!stream_ring) return false;
+	stream_mask = buffer - 1;
+	stream_head = 0;
+	stream_tail = 0;
+	stream_dropped = 0;
+	stream_rate = rate;
+	stream_until_header = 0;
+	stream_out = &out;
+	stream_event.attach(stream_drain);
+	stream_event.triggerEvent();
+
+	CCM_CCGR1 |= CCM_CCGR1_GPT1_BUS(CCM_CCGR_ON) | CCM_CCGR1_GPT1_SERIAL(CCM_CCGR_ON);
+	GPT1_CR = 0;
+	GPT1_PR = 0;
+	GPT1_IR = 0;
+	GPT1_SR = 0x3F;
+	GPT1_OCR1 = (GPT_TICKS_PER_USEC * 1000000 + rate / 2) / rate - 1;
+	GPT1_CR = GPT_CR_CLKSRC(1) | GPT_CR_ENMOD;	// restart at each compare
+	GPT1_CR |= GPT_CR_EN;
+	attachInterruptVector(IRQ_GPT1, pc_profile_stream_isr);
+	GPT1_IR = GPT_IR_OF1IE;
+	NVIC_SET_PRIORITY(IRQ_GPT1, priority);
+	NVIC_ENABLE_IRQ(IRQ_GPT1);
+	return true;
+}
+
+void PCProfileClass::endStream()
+{
+	if (!stream_ring) return;
+	NVIC_DISABLE_IRQ(IRQ_GPT1);
+	GPT1_IR = 0;
+	GPT1_CR = 0;
+	GPT1_SR = 0x3F;
+	stream_timer.end();
+	stream_event.detach();
+	stream_event.clearEvent();
+	free(stream_ring);
+	stream_ring = NULL;
+}
+
+size_t PCProfileClass::printTo(Print& p) const
+{
+	size_t n = 0;
+	uint32_t total = samples();
+	n += p.printf("# PC profile, %u byte blocks, ITCM %u, flash %u, other %u samples\n",
+		1 << BUCKET_SHIFT, (unsigned int)samples_itcm,
+		(unsigned int)samples_flash, (unsigned int)samples_other);
+	if (total > 0) {
+		n += p.printf("# %u%% of time in flash code, FlexSPI busy in %u%% of samples\n",
+			(unsigned int)((uint64_t)samples_flash * 100 / total),
+			(unsigned int)((uint64_t)samples_flexspi_busy * 100 / total));
+	}
+	for (uint32_t i=0; i < histogram_size; i++) {
+		if (histogram[i] == 0) continue;
+		uint32_t addr;
+		if (i < histogram_itcm_size) {
+			addr = (uint32_t)&_stext + (i << BUCKET_SHIFT);
+		} else {
+			addr = (uint32_t)&_sflashcode + ((i - histogram_itcm_size) << BUCKET_SHIFT);
+		}
+		n += p.printf("%u %u\n", (unsigned int)addr, histogram[i]);
+	}
+	return n;
+}
@@ -0,0 +1,76 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <Printable.h>
+#include <irq_priority.h>
+
+// Statistical profile of where the CPU spends its time.  While running,
+// the systick interrupt records the interrupted program counter once per
+// millisecond, in a histogram of 32 byte blocks of code in ITCM and of
+// code in flash (FLASHMEM and startup code).  Each sample also notes if
+// the FlexSPI flash controller was busy, which is mostly cache misses
+// fetching code or PROGMEM data.
+//
+// Printing the result gives one line per block which ran, as the decimal
+// address and number of samples.  Saved to a file, the Makefile's
+// "make coldlist" turns it into a list of functions which never ran, and
+// later builds place those in flash, leaving ITCM for the busy code.
+// Flash blocks with many samples are candidates for FASTRUN.
+//
+// For longer runs on real workloads, beginStream() instead records every
+// sample's PC and LR, at any rate, into a ring buffer which is written as
+// text to a Print, ideally a second USB serial port (SerialUSB1) so normal
+// output isn't disturbed.  Lines begin with '@' for the code addresses the
+// program was linked at, '!' for samples dropped because the output fell
+// behind, or are the hex PC and LR of one sample.  The output is written
+// from yield(), only as much as fits without waiting.  On the PC,
+//   python3 debug/pcstream.py program.elf /dev/ttyACM1
+// symbolizes and aggregates the samples into time per function and per
+// caller.  GPT1 is used while streaming, so it can't run with IRQLatency.
+class PCProfileClass: public Printable {
+public:
+	bool begin();	// allocates the histogram from the heap
+	void end();	// stop sampling, but keep the results
+	void clear();	// stop sampling and free the histogram
+	uint32_t samples() const;
+	// Cycles function() spends waiting for code from flash: it is run
+	// once after emptying the instruction cache and once more, and the
+	// difference returned.  Interrupts are disabled while it runs.
+	uint32_t flashFetchCycles(void (*function)(void));
+	// samples per second, ring buffer samples (a power of 2) from the heap
+	bool beginStream(Print &out, uint32_t rate = 10000, uint32_t buffer = 2048,
+		uint8_t priority = IRQ_PRIORITY_REALTIME);
+	void endStream();
+	virtual size_t printTo(Print& p) const;
+};
+
+extern PCProfileClass PCProfile;
@@ -0,0 +1,145 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2024 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "PWMWaveform.h"
+#include "core_pins.h"
+#include "debug/printf.h"
+
+extern "C" uint8_t pwm_pin_flexpwm(uint8_t pin);
+extern "C" uint8_t analog_write_res;
+
+static IMXRT_FLEXPWM_t * const flexpwm_modules[4] = {
+	&IMXRT_FLEXPWM1, &IMXRT_FLEXPWM2, &IMXRT_FLEXPWM3, &IMXRT_FLEXPWM4
+};
+
+static const uint8_t flexpwm_dma_source[4] = {
+	DMAMUX_SOURCE_FLEXPWM1_WRITE0, DMAMUX_SOURCE_FLEXPWM2_WRITE0,
+	DMAMUX_SOURCE_FLEXPWM3_WRITE0, DMAMUX_SOURCE_FLEXPWM4_WRITE0
+};
+
+bool PWMWaveform::begin(uint8_t p)
+{
+	end();
+	uint8_t info = pwm_pin_flexpwm(p);
+	if (info == 255) return false;
+	// analogWrite() configures the pin mux and enables the output
+	analogWrite(p, 0);
+	pin = p;
+	module = info >> 4;
+	flexpwm = flexpwm_modules[module];
+	submodule = (info >> 2) & 3;
+	channel = info & 3;
+	switch (channel) {
+	  case 0:  valreg = &flexpwm->SM[submodule].VAL0; break;
+	  case 1:  valreg = &flexpwm->SM[submodule].VAL3; break;
+	  default: valreg = &flexpwm->SM[submodule].VAL5;
+	}
+	data.begin();
+	load.begin();
+	return true;
+}
+
+// same math as flexpwmWrite() in pwm.c
+uint16_t PWMWaveform::compare(int val) const
+{
+	if (!flexpwm) return 0;
+	uint32_t modulo = flexpwm->SM[submodule].VAL1;
+	uint32_t cval = ((uint32_t)val * (modulo + 1)) >> analog_write_res;
+	if (cval > modulo) cval = modulo;
+	return (channel == 0) ? modulo - cval : cval;
+}
+
+bool PWMWaveform::play(const uint16_t *values, uint32_t count, bool repeat)
+{
+	// channel linking leaves only 9 bits of the DMA major loop count
+	if (!flexpwm || !values || count == 0 || count > 511) return false;
+	stop();
+
+	// RUN and IPOL bits are written back unchanged, along with LDOK for
+	// only this submodule, so other submodules' staged values stay put
+	ldok = (flexpwm->MCTRL & 0xFF00) | FLEXPWM_MCTRL_LDOK(1 << submodule);
+	arm_dcache_flush(&ldok, sizeof(ldok));
+	arm_dcache_flush((void *)values, count * 2);
+
+	data.TCD->SADDR = values;
+	data.TCD->SOFF = 2;
+	data.TCD->ATTR = DMA_TCD_ATTR_SSIZE(1) | DMA_TCD_ATTR_DSIZE(1);
+	data.TCD->NBYTES = 2;
+	data.TCD->SLAST = -(count * 2);
+	data.TCD->DADDR = valreg;
+	data.TCD->DOFF = 0;
+	data.TCD->CITER = count;
+	data.TCD->BITER = count;
+	data.TCD->DLASTSGA = 0;
+	data.TCD->CSR = 0;
+	if (!repeat) data.disableOnCompletion();
+
+	load.TCD->SADDR = &ldok;
+	load.TCD->SOFF = 0;
+	load.TCD->ATTR = DMA_TCD_ATTR_SSIZE(1) | DMA_TCD_ATTR_DSIZE(1);
+	load.TCD->NBYTES = 2;
+	load.TCD->SLAST = 0;
+	load.TCD->DADDR = &flexpwm->MCTRL;
+	load.TCD->DOFF = 0;
+	load.TCD->CITER = 1;
+	load.TCD->BITER = 1;
+	load.TCD->DLASTSGA = 0;
+	load.TCD->CSR = 0;
+
+	// every value written, including the last, is followed by LDOK
+	load.triggerAtTransfersOf(data);
+	load.triggerAtCompletionOf(data);
+
+	data.triggerAtHardwareEvent(flexpwm_dma_source[module] + submodule);
+	flexpwm->SM[submodule].DMAEN = FLEXPWM_SMDMAEN_VALDE;
+	data.enable();
+	return true;
+}
+
+bool PWMWaveform::isPlaying()
+{
+	if (!flexpwm) return false;
+	return (DMA_ERQ & (1 << data.channel)) ? true : false;
+}
+
+void PWMWaveform::stop()
+{
+	if (!flexpwm) return;
+	flexpwm->SM[submodule].DMAEN = 0;
+	data.disable();
+	data.clearComplete();
+}
+
+void PWMWaveform::end()
+{
+	if (!flexpwm) return;
+	stop();
+	flexpwm = nullptr;
+}
@@ -0,0 +1,79 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2024 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef PWMWaveform_h_
+#define PWMWaveform_h_
+
+#include <stdint.h>
+#include "DMAChannel.h"
+
+// Play a sequence of PWM duty cycles on a FlexPWM pin, one value per
+// PWM period, with no CPU time used per period.  Each PWM reload makes
+// a DMA request which writes the next compare value, and a linked DMA
+// channel then sets the submodule's LDOK bit so it takes effect at the
+// following reload:
+//
+//   uint16_t wave[256];
+//   analogWriteFrequency(2, 20000);
+//   waveform.begin(2);
+//   for (int i=0; i < 256; i++) wave[i] = waveform.compare(sine[i]);
+//   waveform.play(wave, 256);
+//
+// The step rate is the PWM frequency set by analogWriteFrequency().
+// Values are raw compare register settings, so compare() converts
+// analogWrite() values at the current resolution and frequency.  The
+// buffer must not change while playing, unless the changes are flushed
+// from the cache with arm_dcache_flush().  Up to 511 values may be
+// played, either once or repeating until stop().  QuadTimer pins are not
+// supported, since they need 2 registers written each period.
+class PWMWaveform {
+public:
+	PWMWaveform() {}
+	~PWMWaveform() { end(); }
+	bool begin(uint8_t pin);
+	uint16_t compare(int val) const;
+	bool play(const uint16_t *values, uint32_t count, bool repeat=true);
+	void stop();
+	void end();
+	bool isPlaying();
+	operator bool() const { return flexpwm != nullptr; }
+private:
+	DMAChannel data{false};
+	DMAChannel load{false};
+	IMXRT_FLEXPWM_t *flexpwm = nullptr;
+	volatile uint16_t *valreg = nullptr;
+	uint16_t ldok = 0;    // MCTRL value written after each new value
+	uint8_t module = 0;
+	uint8_t submodule = 0;
+	uint8_t channel = 0;  // 0=X, 1=A, 2=B
+	uint8_t pin = 0;
+};
+
+#endif
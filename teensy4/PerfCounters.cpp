@@ -0,0 +1,144 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <Arduino.h>
+#include <PerfCounters.h>
+
+#define PERF_COUNTERS_ENABLE (ARM_DWT_CTRL_CPIEVTENA | ARM_DWT_CTRL_EXCEVTENA \
+	| ARM_DWT_CTRL_SLEEPEVTENA | ARM_DWT_CTRL_LSUEVTENA | ARM_DWT_CTRL_FOLDEVTENA)
+
+// cost of an empty start() and stop(), subtracted from every sample
+static struct {
+	uint32_t cycles;
+	uint8_t cpi;
+	uint8_t exceptions;
+	uint8_t sleep;
+	uint8_t lsu;
+	uint8_t fold;
+} overhead;
+
+static inline uint32_t less_overhead(uint32_t n, uint32_t sub)
+{
+	return (n > sub) ? n - sub : 0;
+}
+
+bool PerfCounters::begin()
+{
+	if (ARM_DWT_CTRL & ARM_DWT_CTRL_NOPRFCNT) return false;
+	ARM_DEMCR |= ARM_DEMCR_TRCENA;
+	ARM_DWT_LAR = 0xC5ACCE55;
+	ARM_DWT_CTRL |= PERF_COUNTERS_ENABLE | ARM_DWT_CTRL_CYCCNTENA;
+	// the fastest of several empty measurements, so an interrupt
+	// during calibration doesn't count
+	memset(&overhead, 0, sizeof(overhead));
+	PerfCounters empty;
+	uint32_t best = 0xFFFFFFFF;
+	for (int i=0; i < 8; i++) {
+		empty.clear();
+		empty.start();
+		empty.stop();
+		if (empty.cycles < best) {
+			best = empty.cycles;
+			overhead.cycles = empty.cycles;
+			overhead.cpi = empty.cpi;
+			overhead.exceptions = empty.exceptions;
+			overhead.sleep = empty.sleep;
+			overhead.lsu = empty.lsu;
+			overhead.fold = empty.fold;
+		}
+	}
+	return true;
+}
+
+void PerfCounters::end()
+{
+	ARM_DWT_CTRL &= ~PERF_COUNTERS_ENABLE;
+}
+
+void PerfCounters::clear()
+{
+	cycles = 0;
+	cpi = 0;
+	exceptions = 0;
+	sleep = 0;
+	lsu = 0;
+	fold = 0;
+	samples = 0;
+	wrapped = 0;
+}
+
+void PerfCounters::add(uint32_t c, uint32_t cpi_now, uint32_t exc_now, uint32_t sleep_now,
+	uint32_t lsu_now, uint32_t fold_now)
+{
+	c -= begin_cycles;
+	if (c >= 256) wrapped++;
+	cycles += less_overhead(c, overhead.cycles);
+	cpi += less_overhead((uint8_t)(cpi_now - begin_cpi), overhead.cpi);
+	exceptions += less_overhead((uint8_t)(exc_now - begin_exceptions), overhead.exceptions);
+	sleep += less_overhead((uint8_t)(sleep_now - begin_sleep), overhead.sleep);
+	lsu += less_overhead((uint8_t)(lsu_now - begin_lsu), overhead.lsu);
+	fold += less_overhead((uint8_t)(fold_now - begin_fold), overhead.fold);
+	samples++;
+}
+
+uint64_t PerfCounters::instructions() const
+{
+	uint64_t stalls = (uint64_t)cpi + exceptions + sleep + lsu;
+	if (cycles + fold < stalls) return 0;
+	return cycles + fold - stalls;
+}
+
+float PerfCounters::cyclesPerInstruction() const
+{
+	uint64_t n = instructions();
+	if (n == 0) return 0.0f;
+	return (float)cycles / (float)n;
+}
+
+size_t PerfCounters::printTo(Print& p) const
+{
+	size_t n = 0;
+	uint64_t instr = instructions();
+
+	n += p.printf("# perf counters, %u samples", (unsigned int)samples);
+	if (wrapped) n += p.printf(", %u over 255 cycles not exact", (unsigned int)wrapped);
+	n += p.println();
+	n += p.print("cycles        ");
+	n += p.println(cycles);
+	n += p.print("instructions  ");
+	n += p.print(instr);
+	n += p.printf("  (%.3f cycles per instruction)\n", cyclesPerInstruction());
+	n += p.printf("cpi stalls    %10u\n", (unsigned int)cpi);
+	n += p.printf("lsu stalls    %10u\n", (unsigned int)lsu);
+	n += p.printf("exceptions    %10u\n", (unsigned int)exceptions);
+	n += p.printf("sleep         %10u\n", (unsigned int)sleep);
+	n += p.printf("folded        %10u\n", (unsigned int)fold);
+	return n;
+}
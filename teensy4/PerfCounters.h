@@ -0,0 +1,112 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <Printable.h>
+#include <imxrt.h>
+
+// Cortex-M7 DWT profiling counters, to see why a section of code takes the
+// cycles it does.  Along with the cycle counter, the DWT counts:
+//   cpi         extra cycles spent by multi-cycle instructions, and stalls
+//               other than load/store (mostly instruction fetch)
+//   exceptions  cycles of interrupt entry and exit overhead
+//   sleep       cycles asleep in WFI or WFE
+//   lsu         extra cycles spent by loads and stores, including stalls
+//               on data memory and cache misses
+//   fold        instructions which completed in 0 cycles (dual issue)
+// Instructions executed are derived from these (ARM DDI0403E, pg 718).
+//
+// The hardware counters are only 8 bits, so a single measurement is exact
+// only when the section is under 256 cycles.  Measure the body of a hot
+// loop, rather than the whole loop, and every pass is added to the totals.
+// Longer sections are still added, but counted as possibly wrapped.
+//
+//   PerfCounters loopstats;
+//   PerfCounters::begin();
+//   for (...) {
+//     PerfScope scope(loopstats);
+//     ...
+//   }
+//   Serial.print(loopstats);
+//
+// Time spent by start() and stop() themselves, measured by begin(), is
+// subtracted from each measurement.
+class PerfCounters : public Printable {
+public:
+	PerfCounters() { clear(); }
+	// turn on the counters, false if this chip doesn't have them
+	static bool begin();
+	static void end();
+	void clear();
+	void start() __attribute__((always_inline)) {
+		begin_fold = ARM_DWT_FOLDCNT;
+		begin_lsu = ARM_DWT_LSUCNT;
+		begin_sleep = ARM_DWT_SLEEPCNT;
+		begin_exceptions = ARM_DWT_EXCCNT;
+		begin_cpi = ARM_DWT_CPICNT;
+		begin_cycles = ARM_DWT_CYCCNT;
+	}
+	void stop() __attribute__((always_inline)) {
+		uint32_t c = ARM_DWT_CYCCNT;
+		add(c, ARM_DWT_CPICNT, ARM_DWT_EXCCNT, ARM_DWT_SLEEPCNT,
+			ARM_DWT_LSUCNT, ARM_DWT_FOLDCNT);
+	}
+	uint64_t instructions() const;
+	float cyclesPerInstruction() const;
+	virtual size_t printTo(Print& p) const;
+
+	uint64_t cycles;
+	uint32_t cpi;
+	uint32_t exceptions;
+	uint32_t sleep;
+	uint32_t lsu;
+	uint32_t fold;
+	uint32_t samples;	// number of start() and stop() pairs
+	uint32_t wrapped;	// samples of 256 cycles or more, not exact
+private:
+	void add(uint32_t c, uint32_t cpi_now, uint32_t exc_now, uint32_t sleep_now,
+		uint32_t lsu_now, uint32_t fold_now);
+	uint32_t begin_cycles;
+	uint8_t begin_cpi;
+	uint8_t begin_exceptions;
+	uint8_t begin_sleep;
+	uint8_t begin_lsu;
+	uint8_t begin_fold;
+};
+
+// Measures from construction until leaving the enclosing scope.
+class PerfScope {
+public:
+	PerfScope(PerfCounters &counters) : c(counters) { c.start(); }
+	~PerfScope() { c.stop(); }
+private:
+	PerfCounters &c;
+};
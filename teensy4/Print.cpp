@@ -48,23 +48,6 @@ size_t Print::write(const uint8_t *buffer, size_t size)
 }
 
 
-size_t Print::print(const String &s)
-{
-	uint8_t buffer[33];
-	size_t count = 0;
-	unsigned int index = 0;
-	unsigned int len = s.length();
-	while (len > 0) {
-		s.getBytes(buffer, sizeof(buffer), index);
-		unsigned int nbytes = len;
-		if (nbytes > sizeof(buffer)-1) nbytes = sizeof(buffer)-1;
-		index += nbytes;
-		len -= nbytes;
-		count += write(buffer, nbytes);
-	}
-	return count;
-}
-
 size_t Print::print(long n)
 {
 	uint8_t sign=0;
@@ -101,34 +84,112 @@ int Print::printf(const char *format, ...)
 {
 	va_list ap;
 	va_start(ap, format);
-#ifdef __STRICT_ANSI__
-	va_end(ap);
-	return 0;  // TODO: make this work with -std=c++0x
-#else
-	int retval = vdprintf((int)this, format, ap);
+	int retval = vprintf(format, ap);
 	va_end(ap);
 	return retval;
-#endif
 }
 
 int Print::printf(const __FlashStringHelper *format, ...)
 {
 	va_list ap;
 	va_start(ap, format);
-#ifdef __STRICT_ANSI__
-	va_end(ap);
-	return 0;
-#else
-	int retval = vdprintf((int)this, (const char *)format, ap);
+	int retval = vprintf((const char *)format, ap);
 	va_end(ap);
 	return retval;
+}
+
+// Define PRINT_PRINTF_LITE to format printf() with printf_lite() below
+// instead of newlib's vfprintf, which is much larger, slower for floats
+// and may allocate memory.
+int Print::vprintf(const char *format, va_list ap)
+{
+#if defined(PRINT_PRINTF_LITE)
+	return vprintfLite(format, ap);
+#elif defined(__STRICT_ANSI__)
+	return 0;  // TODO: make this work with -std=c++0x
+#else
+	return vdprintf((int)this, format, ap);
 #endif
 }
 
+// Decimal digits are made 2 at a time from this table, with division by
+// the constant 100, which the compiler turns into a multiply.  Bases
+// which are a power of 2 use shifts.  Only other bases need the slow
+// division by a variable.
+static const char digit_pairs[201] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+// write n in decimal, ending just before end, return the first digit
+static uint8_t * format_decimal(uint32_t n, uint8_t *end)
+{
+	while (n >= 100) {
+		uint32_t q = n / 100;
+		uint32_t r = (n - q * 100) * 2;
+		end -= 2;
+		end[0] = digit_pairs[r];
+		end[1] = digit_pairs[r + 1];
+		n = q;
+	}
+	if (n >= 10) {
+		end -= 2;
+		end[0] = digit_pairs[n * 2];
+		end[1] = digit_pairs[n * 2 + 1];
+	} else {
+		*--end = '0' + n;
+	}
+	return end;
+}
+
+// write exactly 9 decimal digits, with leading zeros
+static void format_decimal9(uint32_t n, uint8_t *end)
+{
+	for (int i=0; i < 4; i++) {
+		uint32_t q = n / 100;
+		uint32_t r = (n - q * 100) * 2;
+		end -= 2;
+		end[0] = digit_pairs[r];
+		end[1] = digit_pairs[r + 1];
+		n = q;
+	}
+	*--end = '0' + n;
+}
+
+static uint8_t * format_number(uint32_t n, uint8_t base, uint8_t *end)
+{
+	uint8_t digit;
+
+	if (base == 10) return format_decimal(n, end);
+	if ((base & (base - 1)) == 0) {
+		uint32_t shift = __builtin_ctz(base);
+		uint32_t mask = base - 1;
+		do {
+			digit = n & mask;
+			*--end = ((digit < 10) ? '0' + digit : 'A' + digit - 10);
+			n >>= shift;
+		} while (n);
+		return end;
+	}
+	do {
+		digit = n % base;
+		*--end = ((digit < 10) ? '0' + digit : 'A' + digit - 10);
+		n /= base;
+	} while (n);
+	return end;
+}
+
 size_t Print::printNumber(unsigned long n, uint8_t base, uint8_t sign)
 {
 	uint8_t buf[34];
-	uint8_t digit, i;
+	uint8_t *p;
 
 	// TODO: make these checks as inline, since base is
 	// almost always a constant.  base = 0 (BYTE) should
@@ -139,98 +200,496 @@ size_t Print::printNumber(unsigned long n, uint8_t base, uint8_t sign)
 		base = 10;
 	}
 
+	p = format_number(n, base, buf + sizeof(buf));
+	if (sign) *--p = '-';
+	return write(p, buf + sizeof(buf) - p);
+}
+
+static uint8_t * format_number64(uint64_t n, uint8_t base, uint8_t *p)
+{
+	uint8_t digit;
 
-	if (n == 0) {
-		buf[sizeof(buf) - 1] = '0';
-		i = sizeof(buf) - 1;
-	} else {
-		i = sizeof(buf) - 1;
-		while (1) {
-			digit = n % base;
-			buf[i] = ((digit < 10) ? '0' + digit : 'A' + digit - 10);
-			n /= base;
-			if (n == 0) break;
-			i--;
+	if (n <= 0xFFFFFFFFull) return format_number((uint32_t)n, base, p);
+	if (base == 10) {
+		// 64 bit division is a slow library call, so use it only
+		// to split off groups of 9 digits for the 32 bit code
+		while (n > 0xFFFFFFFFull) {
+			uint64_t q = n / 1000000000u;
+			format_decimal9((uint32_t)(n - q * 1000000000u), p);
+			p -= 9;
+			n = q;
 		}
+		return format_decimal((uint32_t)n, p);
 	}
-	if (sign) {
-		i--;
-		buf[i] = '-';
+	if ((base & (base - 1)) == 0) {
+		uint32_t shift = __builtin_ctz(base);
+		uint32_t mask = base - 1;
+		do {
+			digit = n & mask;
+			*--p = ((digit < 10) ? '0' + digit : 'A' + digit - 10);
+			n >>= shift;
+		} while (n);
+		return p;
 	}
-	return write(buf + i, sizeof(buf) - i);
+	do {
+		digit = n % base;
+		*--p = ((digit < 10) ? '0' + digit : 'A' + digit - 10);
+		n /= base;
+	} while (n);
+	return p;
 }
 
 size_t Print::printNumber64(uint64_t n, uint8_t base, uint8_t sign)
 {
 	uint8_t buf[66];
-	uint8_t digit, i;
+	uint8_t *p;
 
 	if (base < 2) return 0;
-	if (n == 0) {
-		buf[sizeof(buf) - 1] = '0';
-		i = sizeof(buf) - 1;
-	} else {
-		i = sizeof(buf) - 1;
-		while (1) {
-			digit = n % base;
-			buf[i] = ((digit < 10) ? '0' + digit : 'A' + digit - 10);
-			n /= base;
-			if (n == 0) break;
-			i--;
+	p = format_number64(n, base, buf + sizeof(buf));
+	if (sign) *--p = '-';
+	return write(p, buf + sizeof(buf) - p);
+}
+
+// Exact powers of 10 which fit in a double, and in 64 bit integers
+static const double pow10_double[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static const uint64_t pow10_u64[] = {
+	1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull,
+	10000000ull, 100000000ull, 1000000000ull, 10000000000ull,
+	100000000000ull, 1000000000000ull, 10000000000000ull,
+	100000000000000ull, 1000000000000000ull, 10000000000000000ull,
+	100000000000000000ull, 1000000000000000000ull, 10000000000000000000ull
+};
+
+// multiply by 10^e, using as few inexact steps as possible
+static double scale_pow10(double v, int e)
+{
+	if (e > 0) {
+		while (e > 22) { v *= 1e22; e -= 22; }
+		return v * pow10_double[e];
+	}
+	while (e < -22) { v /= 1e22; e += 22; }
+	return v / pow10_double[-e];
+}
+
+// round to the nearest integer, exact halves to even like printf()
+static uint64_t round_even(double v)
+{
+	uint64_t n = (uint64_t)v;
+	double rem = v - (double)n;
+	if (rem > 0.5 || (rem == 0.5 && (n & 1))) n++;
+	return n;
+}
+
+// round to the nearest integer, exact halves away from zero like print()
+// has always done, so print(2.5, 0) is "3"
+static uint64_t round_half_up(double v)
+{
+	uint64_t n = (uint64_t)v;
+	if (v - (double)n >= 0.5) n++;
+	return n;
+}
+
+// Write number (positive, finite, below 1e19) with "digits" decimals,
+// rounded, ending just before end.  Returns the first char.  Exact halves
+// round to even for printf(), or up for print().  The integer and fraction
+// parts are each converted to a 64 bit integer with one multiply and
+// printed with the integer code, rather than generating every digit with
+// floating point math.
+static uint8_t * format_fixed(double number, uint8_t digits, uint8_t *end, bool half_even)
+{
+	uint8_t frac_digits = (digits > 17) ? 17 : digits;
+	uint64_t int_part = (uint64_t)number;
+	double remainder = number - (double)int_part;
+	uint64_t frac = 0;
+
+	if (frac_digits > 0) {
+		double scaled = remainder * pow10_double[frac_digits];
+		frac = half_even ? round_even(scaled) : round_half_up(scaled);
+		if (frac >= pow10_u64[frac_digits]) {
+			frac -= pow10_u64[frac_digits];
+			int_part++;
 		}
+	} else if (remainder > 0.5 || (remainder == 0.5 && (!half_even || (int_part & 1)))) {
+		int_part++;
+	}
+	// digits beyond double's precision are zeros
+	for (int i=frac_digits; i < digits; i++) *--end = '0';
+	if (frac_digits > 0) {
+		uint8_t *p = format_number64(frac, 10, end);
+		while (p > end - frac_digits) *--p = '0';
+		end = p;
+		*--end = '.';
+	}
+	return format_number64(int_part, 10, end);
+}
+
+// Make ndigits (1 to 17) significant decimal digits of number (positive,
+// finite, nonzero), rounded.  Returns the power of 10 of the first digit.
+static int float_digits(double number, int ndigits, uint8_t *out)
+{
+	int exp10 = (int)floor(log10(number));
+	uint64_t m = round_even(scale_pow10(number, ndigits - 1 - exp10));
+	// log10() or the scaling can be off by one near powers of 10
+	if (m >= pow10_u64[ndigits]) {
+		exp10++;
+		m = round_even(scale_pow10(number, ndigits - 1 - exp10));
+	} else if (m < pow10_u64[ndigits - 1]) {
+		exp10--;
+		m = round_even(scale_pow10(number, ndigits - 1 - exp10));
+	}
+	if (m >= pow10_u64[ndigits]) { // rounded up to the next power of 10
+		m /= 10;
+		exp10++;
 	}
-	if (sign) {
-		i--;
-		buf[i] = '-';
+	for (int i=ndigits - 1; i >= 0; i--) {
+		out[i] = '0' + m % 10;
+		m /= 10;
 	}
-	return write(buf + i, sizeof(buf) - i);
+	return exp10;
 }
 
 size_t Print::printFloat(double number, uint8_t digits) 
 {
-	uint8_t sign=0;
-	size_t count=0;
+	uint8_t buf[48], *p;
 
 	if (isnan(number)) return print("nan");
     	if (isinf(number)) return print("inf");
     	if (number > 4294967040.0f) return print("ovf");  // constant determined empirically
     	if (number <-4294967040.0f) return print("ovf");  // constant determined empirically
-	
-	// Handle negative numbers
-	if (number < 0.0) {
-		sign = 1;
-		number = -number;
+
+	if (digits > 15) digits = 15;
+	p = format_fixed((number < 0.0) ? -number : number, digits, buf + sizeof(buf), false);
+	if (number < 0.0) *--p = '-';
+	return write(p, buf + sizeof(buf) - p);
+}
+
+// Small printf, used by Print::printf() when PRINT_PRINTF_LITE is
+// defined.  It supports the flags "-+ #0", width and precision (also
+// as *), the length modifiers hh h l ll z j t, and the conversions
+// d i u o x X b c s p f F e E g G and %.  Output is collected in a
+// small stack buffer and given to write() in blocks.  It never calls
+// malloc.  %f matches newlib below 1e19.  Above that, and for %e and %g,
+// at most 17 significant digits come from scaling by powers of 10, so
+// the last digit may differ for very large or small exponents.
+
+#define FMT_LEFT   0x01
+#define FMT_PLUS   0x02
+#define FMT_SPACE  0x04
+#define FMT_ALT    0x08
+#define FMT_ZERO   0x10
+#define FMT_UPPER  0x20
+
+struct printf_lite_state {
+	Print *print;
+	int count;
+	uint8_t len;
+	uint8_t buf[64];
+};
+
+static void lite_flush(struct printf_lite_state *st)
+{
+	if (st->len) {
+		st->print->write(st->buf, st->len);
+		st->count += st->len;
+		st->len = 0;
 	}
+}
 
-	// Round correctly so that print(1.999, 2) prints as "2.00"
-	double rounding = 0.5;
-	for (uint8_t i=0; i<digits; ++i) {
-		rounding *= 0.1;
+static void lite_write(struct printf_lite_state *st, const uint8_t *data, int len)
+{
+	while (len > 0) {
+		if (st->len >= sizeof(st->buf)) lite_flush(st);
+		int n = sizeof(st->buf) - st->len;
+		if (n > len) n = len;
+		memcpy(st->buf + st->len, data, n);
+		st->len += n;
+		data += n;
+		len -= n;
 	}
-	number += rounding;
+}
 
-	// Extract the integer part of the number and print it
-	unsigned long int_part = (unsigned long)number;
-	double remainder = number - (double)int_part;
-	count += printNumber(int_part, 10, sign);
+static void lite_repeat(struct printf_lite_state *st, uint8_t c, int n)
+{
+	while (n-- > 0) {
+		if (st->len >= sizeof(st->buf)) lite_flush(st);
+		st->buf[st->len++] = c;
+	}
+}
+
+// output prefix (sign or 0x), zeros, body, padded to width
+static void lite_field(struct printf_lite_state *st, const char *prefix,
+	int zeros, const uint8_t *body, int len, int width, int flags)
+{
+	int plen = strlen(prefix);
+	int pad = width - plen - zeros - len;
+	if (pad < 0) pad = 0;
+	if (!(flags & FMT_LEFT) && !(flags & FMT_ZERO)) lite_repeat(st, ' ', pad);
+	lite_write(st, (const uint8_t *)prefix, plen);
+	if (!(flags & FMT_LEFT) && (flags & FMT_ZERO)) lite_repeat(st, '0', pad);
+	lite_repeat(st, '0', zeros);
+	lite_write(st, body, len);
+	if (flags & FMT_LEFT) lite_repeat(st, ' ', pad);
+}
 
-	// Print the decimal point, but only if there are digits beyond
-	if (digits > 0) {
-		uint8_t n, buf[16], count=1;
-		buf[0] = '.';
+static void lite_float(struct printf_lite_state *st, double v, char conv,
+	int prec, int width, int flags)
+{
+	uint8_t buf[420], *end = buf + sizeof(buf), *p;
+	uint8_t digits[17];
+	const char *sign = "";
 
-		// Extract digits from the remainder one at a time
-		if (digits > sizeof(buf) - 1) digits = sizeof(buf) - 1;
+	if (signbit(v)) {
+		sign = "-";
+		v = -v;
+	} else if (flags & FMT_PLUS) {
+		sign = "+";
+	} else if (flags & FMT_SPACE) {
+		sign = " ";
+	}
+	if (conv >= 'A' && conv <= 'Z') {
+		flags |= FMT_UPPER;
+		conv += 'a' - 'A';
+	}
+	if (isnan(v) || isinf(v)) {
+		const char *s = isnan(v) ?
+			((flags & FMT_UPPER) ? "NAN" : "nan") : ((flags & FMT_UPPER) ? "INF" : "inf");
+		lite_field(st, sign, 0, (const uint8_t *)s, 3, width, flags & ~FMT_ZERO);
+		return;
+	}
+	if (prec < 0) prec = 6;
+	if (prec > 100) prec = 100;
+
+	int strip = 0;
+	int nd = 0, x = 0;
+	if (conv == 'g') {
+		// %g is %e or %f, depending on the exponent after rounding
+		int sig = (prec == 0) ? 1 : prec;
+		nd = (sig > 17) ? 17 : sig;
+		if (v == 0.0) {
+			memset(digits, '0', nd);
+		} else {
+			x = float_digits(v, nd, digits);
+		}
+		if (sig > x && x >= -4) {
+			conv = 'f';
+			prec = sig - 1 - x;
+		} else {
+			conv = 'e';
+			prec = sig - 1;
+		}
+		strip = !(flags & FMT_ALT);
+	} else if (conv == 'e' || v >= 1e19) {
+		nd = (conv == 'f') ? 17 : ((prec + 1 > 17) ? 17 : prec + 1);
+		if (v == 0.0) {
+			memset(digits, '0', nd);
+		} else {
+			x = float_digits(v, nd, digits);
+		}
+	}
 
-		while (digits-- > 0) {
-			remainder *= 10.0;
-			n = (uint8_t)(remainder);
-			buf[count++] = '0' + n;
-			remainder -= n; 
+	if (nd == 0) {
+		// plain %f, from the integer part and the scaled fraction
+		if (prec == 0 && (flags & FMT_ALT)) *--end = '.';
+		p = format_fixed(v, prec, end, true);
+		end = buf + sizeof(buf);
+	} else if (conv == 'f') {
+		// from the significant digits, then zeros
+		p = buf;
+		int pos = (x > 0) ? x : 0;
+		for ( ; pos >= -prec; pos--) {
+			int i = x - pos;
+			*p++ = (i >= 0 && i < nd) ? digits[i] : '0';
+			if (pos == 0 && (prec > 0 || (flags & FMT_ALT))) *p++ = '.';
 		}
-		count += write(buf, count);
+		end = p;
+		p = buf;
+	} else {
+		p = buf;
+		*p++ = digits[0];
+		if (prec > 0 || (flags & FMT_ALT)) *p++ = '.';
+		memcpy(p, digits + 1, nd - 1);
+		p += nd - 1;
+		memset(p, '0', prec + 1 - nd);
+		p += prec + 1 - nd;
+		if (strip) {
+			while (p > buf + 1 && p[-1] == '0') p--;
+			if (p[-1] == '.') p--;
+			strip = 0;
+		}
+		*p++ = (flags & FMT_UPPER) ? 'E' : 'e';
+		*p++ = (x < 0) ? '-' : '+';
+		if (x < 0) x = -x;
+		if (x >= 100) *p++ = '0' + x / 100;
+		*p++ = '0' + (x / 10) % 10;
+		*p++ = '0' + x % 10;
+		end = p;
+		p = buf;
 	}
-	return count;
+	if (strip) {
+		uint8_t *dot = (uint8_t *)memchr(p, '.', end - p);
+		if (dot) {
+			while (end > dot && end[-1] == '0') end--;
+			if (end[-1] == '.') end--;
+		}
+	}
+	lite_field(st, sign, 0, p, end - p, width, flags);
 }
 
+int Print::vprintfLite(const char *format, va_list ap)
+{
+	struct printf_lite_state st;
+	uint8_t buf[66], *end = buf + sizeof(buf), *p;
+
+	st.print = this;
+	st.count = 0;
+	st.len = 0;
+	while (*format) {
+		const char *s = format;
+		while (*s && *s != '%') s++;
+		lite_write(&st, (const uint8_t *)format, s - format);
+		if (*s == 0) break;
+		format = s + 1;
 
+		int flags = 0;
+		while (1) {
+			char c = *format;
+			if (c == '-') flags |= FMT_LEFT;
+			else if (c == '+') flags |= FMT_PLUS;
+			else if (c == ' ') flags |= FMT_SPACE;
+			else if (c == '#') flags |= FMT_ALT;
+			else if (c == '0') flags |= FMT_ZERO;
+			else break;
+			format++;
+		}
+		int width = 0;
+		if (*format == '*') {
+			width = va_arg(ap, int);
+			if (width < 0) {
+				flags |= FMT_LEFT;
+				width = -width;
+			}
+			format++;
+		} else {
+			while (*format >= '0' && *format <= '9') {
+				width = width * 10 + *format++ - '0';
+			}
+		}
+		int prec = -1;
+		if (*format == '.') {
+			format++;
+			prec = 0;
+			if (*format == '*') {
+				prec = va_arg(ap, int);
+				format++;
+			} else {
+				while (*format >= '0' && *format <= '9') {
+					prec = prec * 10 + *format++ - '0';
+				}
+			}
+		}
+		int size = 0; // -2=hh, -1=h, 1=l, 2=ll
+		while (1) {
+			char c = *format;
+			if (c == 'h') size--;
+			else if (c == 'l') size++;
+			else if (c == 'z' || c == 't') size = (sizeof(size_t) > 4) ? 2 : 1;
+			else if (c == 'j') size = 2;
+			else break;
+			format++;
+		}
+
+		char conv = *format;
+		if (conv == 0) break;
+		format++;
+		switch (conv) {
+		  case 'd':
+		  case 'i': {
+			int64_t n;
+			if (size >= 2) n = va_arg(ap, long long);
+			else if (size == 1) n = va_arg(ap, long);
+			else n = va_arg(ap, int);
+			if (size == -1) n = (short)n;
+			else if (size <= -2) n = (signed char)n;
+			const char *sign = (n < 0) ? "-" : ((flags & FMT_PLUS) ? "+" :
+				((flags & FMT_SPACE) ? " " : ""));
+			uint64_t u = (n < 0) ? -(uint64_t)n : (uint64_t)n;
+			p = (u == 0 && prec == 0) ? end : format_number64(u, 10, end);
+			int zeros = (prec > end - p) ? prec - (end - p) : 0;
+			if (prec >= 0) flags &= ~FMT_ZERO;
+			lite_field(&st, sign, zeros, p, end - p, width, flags);
+			break;
+		  }
+		  case 'u':
+		  case 'o':
+		  case 'x':
+		  case 'X':
+		  case 'b': {
+			uint64_t u;
+			if (size >= 2) u = va_arg(ap, unsigned long long);
+			else if (size == 1) u = va_arg(ap, unsigned long);
+			else u = va_arg(ap, unsigned int);
+			if (size == -1) u = (unsigned short)u;
+			else if (size <= -2) u = (unsigned char)u;
+			uint8_t base = (conv == 'u') ? 10 : ((conv == 'o') ? 8 :
+				((conv == 'b') ? 2 : 16));
+			p = (u == 0 && prec == 0) ? end : format_number64(u, base, end);
+			if (conv == 'x') {
+				for (uint8_t *q = p; q < end; q++) {
+					if (*q >= 'A') *q += 'a' - 'A';
+				}
+			}
+			const char *prefix = "";
+			if ((flags & FMT_ALT) && u != 0) {
+				if (conv == 'x') prefix = "0x";
+				else if (conv == 'X') prefix = "0X";
+				else if (conv == 'o' && (prec <= end - p)) prefix = "0";
+			}
+			int zeros = (prec > end - p) ? prec - (end - p) : 0;
+			if (prec >= 0) flags &= ~FMT_ZERO;
+			lite_field(&st, prefix, zeros, p, end - p, width, flags);
+			break;
+		  }
+		  case 'p': {
+			uintptr_t u = (uintptr_t)va_arg(ap, void *);
+			p = format_number64(u, 16, end);
+			for (uint8_t *q = p; q < end; q++) {
+				if (*q >= 'A') *q += 'a' - 'A';
+			}
+			lite_field(&st, "0x", 0, p, end - p, width, flags & ~FMT_ZERO);
+			break;
+		  }
+		  case 'c': {
+			uint8_t c = va_arg(ap, int);
+			lite_field(&st, "", 0, &c, 1, width, flags & ~FMT_ZERO);
+			break;
+		  }
+		  case 's': {
+			const char *str = va_arg(ap, const char *);
+			if (!str) str = "(null)";
+			int len = 0;
+			while (str[len] && (prec < 0 || len < prec)) len++;
+			lite_field(&st, "", 0, (const uint8_t *)str, len, width, flags & ~FMT_ZERO);
+			break;
+		  }
+		  case 'f':
+		  case 'F':
+		  case 'e':
+		  case 'E':
+		  case 'g':
+		  case 'G':
+			lite_float(&st, va_arg(ap, double), conv, prec, width, flags);
+			break;
+		  case '%':
+			lite_write(&st, (const uint8_t *)"%", 1);
+			break;
+		  default: // unknown, print it as-is
+			lite_write(&st, (const uint8_t *)s, format - s);
+		}
+	}
+	lite_flush(&st);
+	return st.count;
+}
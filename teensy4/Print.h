@@ -36,6 +36,7 @@
 #include <stdarg.h>
 #include "core_id.h"
 #include "WString.h"
+#include "StringView.h"
 #include "Printable.h"
 
 #define DEC 10
@@ -61,7 +62,8 @@ class Print
 	virtual int availableForWrite(void)		{ return 0; }
 	virtual void flush()				{ }
 	size_t write(const char *buffer, size_t size)	{ return write((const uint8_t *)buffer, size); }
-	size_t print(const String &s);
+	size_t print(const String &s)			{ return write(s.c_str(), s.length()); }
+	size_t print(const StringView &s)		{ return write(s.data(), s.length()); }
 	size_t print(char c)				{ return write((uint8_t)c); }
 	size_t print(const char s[])			{ return write(s); }
 	size_t print(const __FlashStringHelper *f)	{ return write((const char *)f); }
@@ -86,6 +88,7 @@ class Print
 	size_t print(const Printable &obj)		{ return obj.printTo(*this); }
 	size_t println(void);
 	size_t println(const String &s)			{ return print(s) + println(); }
+	size_t println(const StringView &s)		{ return print(s) + println(); }
 	size_t println(char c)				{ return print(c) + println(); }
 	size_t println(const char s[])			{ return print(s) + println(); }
 	size_t println(const __FlashStringHelper *f)	{ return print(f) + println(); }
@@ -114,6 +117,9 @@ class Print
 	// https://forum.pjrc.com/threads/62473?p=256873&viewfull=1#post256873
 	int printf(const char *format, ...) /*__attribute__ ((format (printf, 2, 3)))*/;
 	int printf(const __FlashStringHelper *format, ...);
+	int vprintf(const char *format, va_list ap);
+	// printf without newlib, see PRINT_PRINTF_LITE in Print.cpp
+	int vprintfLite(const char *format, va_list ap);
   protected:
 	void setWriteError(int err = 1) { write_error = err; }
   private:
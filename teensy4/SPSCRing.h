@@ -0,0 +1,162 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#ifndef SPSCRing_h_
+#define SPSCRing_h_
+
+#ifdef __cplusplus
+
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+// SPSCRing<T, N> is a ring buffer for exactly one producer and one
+// consumer, for example an interrupt filling it and loop() emptying it.
+// Neither side ever disables interrupts.  The producer only writes
+// "head" and the consumer only writes "tail", with a DMB between the
+// data and the index, so each side always sees complete items.
+//
+// N must be a power of 2, and all N slots may be used.  The indices run
+// freely and wrap naturally, so size() is simply head - tail.
+//
+// Bulk push() and pop() copy with memcpy, in at most 2 pieces.  For zero
+// copy access, writeSpan() and readSpan() give the largest contiguous
+// region, to be followed by commitWrite() or commitRead():
+//
+//   SPSCRing<uint8_t, 256> ring;
+//   unsigned int n;
+//   uint8_t *p = ring.writeSpan(&n);   // producer, room for n bytes at p
+//   n = fill(p, n);
+//   ring.commitWrite(n);
+//
+// clear() is safe only while neither side is active.
+
+template <typename T, unsigned int N>
+class SPSCRing {
+	static_assert(N >= 2 && (N & (N - 1)) == 0, "SPSCRing size must be a power of 2");
+	static_assert(std::is_trivially_copyable<T>::value, "SPSCRing items must be trivially copyable");
+public:
+	constexpr SPSCRing() {}
+	void clear() { head = 0; tail = 0; }
+	static constexpr unsigned int capacity() { return N; }
+	unsigned int size() const { return head - tail; }
+	unsigned int space() const { return N - (head - tail); }
+	bool empty() const { return head == tail; }
+	bool full() const { return head - tail >= N; }
+
+	// Producer side
+	bool push(const T &item) {
+		uint32_t h = head;
+		if (h - tail >= N) return false;
+		buffer[h & MASK] = item;
+		barrier();
+		head = h + 1;
+		return true;
+	}
+	// Add up to count items, returns the number added
+	unsigned int push(const T *items, unsigned int count) {
+		uint32_t h = head;
+		unsigned int room = N - (h - tail);
+		if (count > room) count = room;
+		unsigned int first = N - (h & MASK);
+		if (first > count) first = count;
+		memcpy(buffer + (h & MASK), items, first * sizeof(T));
+		memcpy(buffer, items + first, (count - first) * sizeof(T));
+		barrier();
+		head = h + count;
+		return count;
+	}
+	T * writeSpan(unsigned int *count) {
+		uint32_t h = head;
+		unsigned int room = N - (h - tail);
+		unsigned int first = N - (h & MASK);
+		*count = (room < first) ? room : first;
+		return buffer + (h & MASK);
+	}
+	void commitWrite(unsigned int count) {
+		barrier();
+		head = head + count;
+	}
+
+	// Consumer side
+	bool pop(T &item) {
+		uint32_t t = tail;
+		if (head == t) return false;
+		barrier();
+		item = buffer[t & MASK];
+		barrier();
+		tail = t + 1;
+		return true;
+	}
+	// Remove up to count items, returns the number removed
+	unsigned int pop(T *items, unsigned int count) {
+		uint32_t t = tail;
+		unsigned int avail = head - t;
+		if (count > avail) count = avail;
+		barrier();
+		unsigned int first = N - (t & MASK);
+		if (first > count) first = count;
+		memcpy(items, buffer + (t & MASK), first * sizeof(T));
+		memcpy(items + first, buffer, (count - first) * sizeof(T));
+		barrier();
+		tail = t + count;
+		return count;
+	}
+	// The oldest item, without removing it, or NULL if empty
+	T * peek() {
+		uint32_t t = tail;
+		if (head == t) return NULL;
+		barrier();
+		return buffer + (t & MASK);
+	}
+	T * readSpan(unsigned int *count) {
+		uint32_t t = tail;
+		unsigned int avail = head - t;
+		unsigned int first = N - (t & MASK);
+		*count = (avail < first) ? avail : first;
+		barrier();
+		return buffer + (t & MASK);
+	}
+	void commitRead(unsigned int count) {
+		barrier();
+		tail = tail + count;
+	}
+private:
+	static const uint32_t MASK = N - 1;
+	static void barrier() { __asm__ volatile("dmb" ::: "memory"); }
+	T buffer[N] = {};
+	volatile uint32_t head = 0;
+	volatile uint32_t tail = 0;
+};
+
+#endif // __cplusplus
+#endif
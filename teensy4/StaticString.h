@@ -0,0 +1,130 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2024 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef StaticString_h_
+#define StaticString_h_
+#ifdef __cplusplus
+
+#include "Print.h"
+#include "StringView.h"
+
+// A String-like buffer of fixed capacity which never uses the heap.  It
+// is a Print, so text is built with print(), println() and printf():
+//
+//   StaticString<40> msg;
+//   msg.print("temp=");
+//   msg.println(celsius, 1);
+//   Serial.print(msg);
+//
+// Text beyond N characters is dropped and sets getWriteError().  The
+// search and conversion functions work like String's, through view().
+template <size_t N>
+class StaticString : public Print
+{
+public:
+	StaticString() : len(0) { buf[0] = 0; }
+	StaticString(StringView s) : len(0) { buf[0] = 0; append(s); }
+	virtual size_t write(uint8_t b) {
+		if (len >= N) {
+			setWriteError();
+			return 0;
+		}
+		buf[len++] = b;
+		buf[len] = 0;
+		return 1;
+	}
+	virtual size_t write(const uint8_t *buffer, size_t size) {
+		if (buffer == nullptr) return 0;
+		if (size > N - len) {
+			size = N - len;
+			setWriteError();
+		}
+		memmove(buf + len, buffer, size);
+		len += size;
+		buf[len] = 0;
+		return size;
+	}
+	virtual int availableForWrite(void) { return N - len; }
+	using Print::write;
+
+	StaticString & append(StringView s) { write(s.data(), s.length()); return *this; }
+	StaticString & append(char c) { write((uint8_t)c); return *this; }
+	StaticString & operator += (StringView s) { return append(s); }
+	StaticString & operator += (char c) { return append(c); }
+	StaticString & operator = (StringView s) {
+		if (s.data() != buf) {
+			clear();
+			append(s);
+		}
+		return *this;
+	}
+
+	const char * c_str() const { return buf; }
+	char * data() { return buf; }
+	size_t length() const { return len; }
+	static constexpr size_t capacity() { return N; }
+	// after writing into data() directly
+	void setLength(size_t length) {
+		len = (length < N) ? length : N;
+		buf[len] = 0;
+	}
+	void clear() {
+		len = 0;
+		buf[0] = 0;
+		clearWriteError();
+	}
+	StringView view() const { return StringView(buf, len); }
+	operator StringView() const { return view(); }
+
+	int compareTo(StringView s) const { return view().compareTo(s); }
+	bool equals(StringView s) const { return view().equals(s); }
+	bool equalsIgnoreCase(StringView s) const { return view().equalsIgnoreCase(s); }
+	bool startsWith(StringView s) const { return view().startsWith(s); }
+	bool endsWith(StringView s) const { return view().endsWith(s); }
+	bool operator == (StringView s) const { return view().equals(s); }
+	bool operator != (StringView s) const { return !view().equals(s); }
+	char charAt(size_t index) const { return view().charAt(index); }
+	char operator [] (size_t index) const { return view().charAt(index); }
+	void setCharAt(size_t index, char c) { if (index < len) buf[index] = c; }
+	int indexOf(char ch, size_t fromIndex = 0) const { return view().indexOf(ch, fromIndex); }
+	int indexOf(StringView s, size_t fromIndex = 0) const { return view().indexOf(s, fromIndex); }
+	int lastIndexOf(char ch) const { return view().lastIndexOf(ch); }
+	int lastIndexOf(StringView s) const { return view().lastIndexOf(s); }
+	StringView substring(size_t beginIndex) const { return view().substring(beginIndex); }
+	StringView substring(size_t beginIndex, size_t endIndex) const { return view().substring(beginIndex, endIndex); }
+	long toInt(void) const { return atol(buf); }
+	float toFloat(void) const { return strtof(buf, (char **)NULL); }
+private:
+	size_t len;
+	char buf[N + 1];
+};
+
+#endif // __cplusplus
+#endif
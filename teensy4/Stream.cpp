@@ -24,11 +24,13 @@
 
 #define PARSE_TIMEOUT 1000  // default number of milli-seconds to wait
 #define NO_SKIP_CHAR  1  // a magic char not found in a valid ASCII numeric field
+#define PARSE_FLOAT_MAX 40  // digits kept by parseFloat, more than float precision
 
 // private method to read stream with timeout
 int Stream::timedRead()
 {
-  int c;
+  int c = read();
+  if (c >= 0) return c;  // skip millis() when data is already waiting
   unsigned long startMillis = millis();
   do {
     c = read();
@@ -41,7 +43,8 @@ int Stream::timedRead()
 // private method to peek stream with timeout
 int Stream::timedPeek()
 {
-  int c;
+  int c = peek();
+  if (c >= 0) return c;
   unsigned long startMillis = millis();
   do {
     c = peek();
@@ -99,32 +102,87 @@ bool  Stream::findUntil(const char *target, const char *terminator)
 // returns true if target string is found, false if terminated or timed out
 bool Stream::findUntil(const char *target, size_t targetLen, const char *terminator, size_t termLen)
 {
-  size_t index = 0;  // maximum target string length is 64k bytes!
-  size_t termIndex = 0;
-  int c;
+  if (target == nullptr) return true;
+  if (targetLen == 0 || *target == 0) return true;   // return true if target is a null string
+  MultiTarget t[2] = {{target, targetLen, 0}, {terminator, termLen, 0}};
+  int count = (terminator == nullptr || termLen == 0) ? 1 : 2;
+  return findMulti(t, count) == 0;
+}
 
-  if( target == nullptr) return true;
-  if( *target == 0) return true;   // return true if target is a null string
-  if (terminator == nullptr) termLen = 0;
-	
-  while( (c = timedRead()) > 0){
-    if( c == target[index]){
-    //////Serial.print("found "); Serial.write(c); Serial.print("index now"); Serial.println(index+1);
-      if(++index >= targetLen){ // return true if all chars in the target match
-        return true;
-      }
-    }
-    else{
-      index = 0;  // reset index if any char does not match
+// failure tables for all targets live on the stack when they fit here
+#define FIND_STACK_TABLE 64
+
+// length of the longest proper prefix of str[0..len) which is also a suffix,
+// used only when no failure table could be allocated
+static size_t find_border(const char *str, size_t len)
+{
+  for (size_t n = len - 1; n > 0; n--) {
+    if (memcmp(str, str + len - n, n) == 0) return n;
+  }
+  return 0;
+}
+
+// Knuth-Morris-Pratt failure table: fail[i] = find_border(str, i + 1)
+static void find_table(const char *str, size_t len, uint16_t *fail)
+{
+  size_t k = 0;
+  fail[0] = 0;
+  for (size_t i = 1; i < len; i++) {
+    while (k > 0 && str[i] != str[k]) k = fail[k - 1];
+    if (str[i] == str[k]) k++;
+    fail[i] = k;
+  }
+}
+
+// reads data from the stream until any of the targets is found.  Each
+// byte is read only once and never pushed back, so the time spent is
+// linear in the amount of data read, no matter how the targets overlap.
+// returns the index of the first target found, or -1 on timeout
+int Stream::findMulti(struct MultiTarget *targets, int tCount)
+{
+  uint16_t stack_table[FIND_STACK_TABLE];
+  uint16_t *table = stack_table;
+  size_t total = 0;
+
+  for (int i = 0; i < tCount; i++) {
+    if (targets[i].str == nullptr || targets[i].len == 0) return i;
+    if (targets[i].len > 0xFFFF) table = nullptr;
+    targets[i].index = 0;
+    total += targets[i].len;
+  }
+  if (table && total > FIND_STACK_TABLE) {
+    table = (uint16_t *)malloc(total * sizeof(uint16_t));
+  }
+  if (table) {
+    uint16_t *fail = table;
+    for (int i = 0; i < tCount; i++) {
+      find_table(targets[i].str, targets[i].len, fail);
+      fail += targets[i].len;
     }
-    if(termLen > 0 && c == terminator[termIndex]){
-       if(++termIndex >= termLen)
-         return false;       // return false if terminate string found before target string
+  }
+
+  int found = -1;
+  while (found < 0) {
+    int c = timedRead();
+    if (c < 0) break;
+    const uint16_t *fail = table;
+    for (int i = 0; i < tCount; i++) {
+      struct MultiTarget *t = targets + i;
+      size_t index = t->index;
+      while (index > 0 && (uint8_t)t->str[index] != c) {
+        index = fail ? fail[index - 1] : find_border(t->str, index);
+      }
+      if ((uint8_t)t->str[index] == c) index++;
+      t->index = index;
+      if (index >= t->len) {
+        found = i;
+        break;
+      }
+      if (fail) fail += t->len;
     }
-    else
-        termIndex = 0;
   }
-  return false;
+  if (table != stack_table) free(table);
+  return found;
 }
 
 
@@ -157,7 +215,8 @@ long Stream::parseInt(char skipChar)
     else if(c >= '0' && c <= '9')        // is c a digit?
       value = value * 10 + c - '0';
     read();  // consume the character we got with peek
-    c = timedPeek();
+    c = peek();  // usually waiting, only call timedPeek() if not
+    if (c < 0) c = timedPeek();
   }
   while( (c >= '0' && c <= '9') || c == skipChar );
 
@@ -175,41 +234,72 @@ float Stream::parseFloat()
 
 // as above but the given skipChar is ignored
 // this allows format characters (typically commas) in values to be ignored
-float Stream::parseFloat(char skipChar){
-  boolean isNegative = false;
+float Stream::parseFloat(char skipChar)
+{
+  char buf[PARSE_FLOAT_MAX + 8];
+
+  if (readFloatChars(buf, skipChar) < 0)
+    return 0; // zero returned if timeout
+  return strtof_fast(buf, NULL);
+}
+
+// parse up to count numbers, separated by any non-numeric characters,
+// typically one line of comma separated values
+// returns the number of values parsed before timeout
+size_t Stream::parseFloats(float *values, size_t count)
+{
+  char buf[PARSE_FLOAT_MAX + 8];
+  size_t n;
+
+  for (n=0; n < count; n++) {
+    if (readFloatChars(buf, NO_SKIP_CHAR) < 0) break;
+    values[n] = strtof_fast(buf, NULL);
+  }
+  return n;
+}
+
+// read the characters of a number into buf, which must have room for
+// PARSE_FLOAT_MAX + 8 characters.  The digits are converted all at once
+// by strtof_fast(), which is faster and more accurate than accumulating
+// them in a float.  Returns the string length or -1 on timeout.
+int Stream::readFloatChars(char *buf, char skipChar)
+{
   boolean isFraction = false;
-  long value = 0;
+  int len = 1, shift = 0;
   int c;
-  float fraction = 1.0;
 
   c = peekNextDigit();
     // ignore non numeric leading characters
   if(c < 0)
-    return 0; // zero returned if timeout
+    return -1;
 
+  buf[0] = '+';
   do{
     if(c == skipChar)
       ; // ignore
     else if(c == '-')
-      isNegative = true;
-    else if (c == '.')
+      buf[0] = '-';
+    else if (c == '.') {
+      if (!isFraction && len < PARSE_FLOAT_MAX)
+        buf[len++] = '.';
       isFraction = true;
+    }
     else if(c >= '0' && c <= '9')  {      // is c a digit?
-      value = value * 10 + c - '0';
-      if(isFraction)
-         fraction *= 0.1f;
+      if (len < PARSE_FLOAT_MAX)
+        buf[len++] = c;
+      else if (!isFraction)
+        shift++; // too many digits, keep the magnitude
     }
     read();  // consume the character we got with peek
-    c = timedPeek();
+    c = peek();
+    if (c < 0) c = timedPeek();
   }
   while( (c >= '0' && c <= '9')  || c == '.' || c == skipChar );
 
-  if(isNegative)
-    value = -value;
-  if(isFraction)
-    return value * fraction;
-  else
-    return value;
+  if (shift)
+    len += sprintf(buf + len, "e%d", shift);
+  buf[len] = 0;
+  return len;
 }
 
 // read characters from stream into buffer
@@ -220,15 +310,33 @@ float Stream::parseFloat(char skipChar){
 size_t Stream::readBytes(char *buffer, size_t length)
 {
 	if (buffer == nullptr) return 0;
+	size_t count = readBulk((uint8_t *)buffer, length);
+	if (count >= length) return count;
+	unsigned long startMillis = millis();
+	do {
+		size_t n = readBulk((uint8_t *)buffer + count, length - count);
+		if (n > 0) {
+			count += n;
+			if (count >= length) return count;
+			startMillis = millis(); // timeout is between bytes, as timedRead
+		} else {
+			yield();
+		}
+	} while (millis() - startMillis < _timeout);
+	setReadError();
+	return count;
+}
+
+// read whatever is available right now, up to length bytes, without
+// waiting.  Classes with a block read (USB serial, files, serial ports)
+// override this so readBytes() copies whole blocks.
+size_t Stream::readBulk(uint8_t *buffer, size_t length)
+{
 	size_t count = 0;
 	while (count < length) {
-		int c = timedRead();
-		if (c < 0) {
-			setReadError();
-			break;
-		}
-		*buffer++ = (char)c;
-		count++;
+		int c = read();
+		if (c < 0) break;
+		buffer[count++] = c;
 	}
 	return count;
 }
@@ -291,3 +399,21 @@ String Stream::readStringUntil(char terminator, size_t max)
 	}
 	return str;
 }
+
+// read into a caller supplied buffer, which must have room for max + 1
+// characters.  terminator is -1 when only a null ends the string.
+size_t Stream::readStringInto(char *buffer, size_t max, int terminator)
+{
+	size_t length = 0;
+	while (length < max) {
+		int c = timedRead();
+		if (c < 0) {
+			setReadError();
+			break;	// timeout
+		}
+		if (c == 0 || c == terminator) break;
+		buffer[length++] = c;
+	}
+	buffer[length] = 0;
+	return length;
+}
@@ -23,6 +23,8 @@
 #include <inttypes.h>
 #include "Print.h"
 
+template <size_t N> class StaticString;
+
 class Stream : public Print
 {
   public:
@@ -48,16 +50,33 @@ class Stream : public Print
 	bool findUntil(const String &target, size_t targetLen, const char *terminate, size_t termLen);
 	bool findUntil(const char *target, size_t targetLen, const String &terminate, size_t termLen);
 	bool findUntil(const String &target, size_t targetLen, const String &terminate, size_t termLen);
+	struct MultiTarget {
+		const char *str;  // string you're searching for
+		size_t len;       // length of string you're searching for
+		size_t index;     // index used by the search routine
+	};
+	int findMulti(struct MultiTarget *targets, int tCount);
 	long parseInt();
 	long parseInt(char skipChar);
 	float parseFloat();
 	float parseFloat(char skipChar);
+	size_t parseFloats(float *values, size_t count);
 	size_t readBytes(char *buffer, size_t length);
 	size_t readBytes(uint8_t *buffer, size_t length) { return readBytes((char *)buffer, length); }
 	size_t readBytesUntil(char terminator, char *buffer, size_t length);
 	size_t readBytesUntil(char terminator, uint8_t *buffer, size_t length) { return readBytesUntil(terminator, (char *)buffer, length); }
+	virtual size_t readBulk(uint8_t *buffer, size_t length);
 	String readString(size_t max = 120);
 	String readStringUntil(char terminator, size_t max = 120);
+	// as readString and readStringUntil, without allocating a String
+	template <size_t N> size_t readString(StaticString<N> &str) {
+		str.setLength(readStringInto(str.data(), N, -1));
+		return str.length();
+	}
+	template <size_t N> size_t readStringUntil(char terminator, StaticString<N> &str) {
+		str.setLength(readStringInto(str.data(), N, (uint8_t)terminator));
+		return str.length();
+	}
 	int getReadError() { return read_error; }
 	void clearReadError() { setReadError(0); }
   protected:
@@ -65,6 +84,8 @@ class Stream : public Print
 	int timedRead();
 	int timedPeek();
 	int peekNextDigit();
+	int readFloatChars(char *buffer, char skipChar);
+	size_t readStringInto(char *buffer, size_t max, int terminator);
 
 	unsigned long _timeout;
   private:
@@ -0,0 +1,148 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2024 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <Arduino.h>
+#include "StringView.h"
+
+int StringView::compareTo(StringView s) const
+{
+	int r = memcmp(ptr, s.ptr, (len < s.len) ? len : s.len);
+	if (r != 0) return r;
+	if (len < s.len) return 0 - (unsigned char)s.ptr[len];
+	if (len > s.len) return (unsigned char)ptr[s.len];
+	return 0;
+}
+
+bool StringView::equalsIgnoreCase(StringView s) const
+{
+	if (len != s.len) return false;
+	for (size_t i=0; i < len; i++) {
+		if (tolower(ptr[i]) != tolower(s.ptr[i])) return false;
+	}
+	return true;
+}
+
+void StringView::getBytes(unsigned char *buf, size_t bufsize, size_t index) const
+{
+	if (!bufsize || !buf) return;
+	size_t n = 0;
+	if (index < len) {
+		n = len - index;
+		if (n > bufsize - 1) n = bufsize - 1;
+		memcpy(buf, ptr + index, n);
+	}
+	buf[n] = 0;
+}
+
+int StringView::indexOf(char ch, size_t fromIndex) const
+{
+	if (fromIndex >= len) return -1;
+	const char *p = (const char *)memchr(ptr + fromIndex, ch, len - fromIndex);
+	if (p == NULL) return -1;
+	return p - ptr;
+}
+
+int StringView::indexOf(StringView s, size_t fromIndex) const
+{
+	if (fromIndex > len || s.len > len - fromIndex) return -1;
+	if (s.len == 0) return fromIndex;
+	const char *p = ptr + fromIndex;
+	const char *last = ptr + len - s.len;
+	while (p <= last) {
+		p = (const char *)memchr(p, s.ptr[0], last - p + 1);
+		if (p == NULL) break;
+		if (memcmp(p, s.ptr, s.len) == 0) return p - ptr;
+		p++;
+	}
+	return -1;
+}
+
+int StringView::lastIndexOf(char ch, size_t fromIndex) const
+{
+	if (fromIndex >= len) return -1;
+	for (size_t i = fromIndex + 1; i > 0; i--) {
+		if (ptr[i - 1] == ch) return i - 1;
+	}
+	return -1;
+}
+
+int StringView::lastIndexOf(StringView s, size_t fromIndex) const
+{
+	if (s.len == 0 || len == 0 || s.len > len) return -1;
+	if (fromIndex > len - s.len) fromIndex = len - s.len;
+	for (size_t i = fromIndex + 1; i > 0; i--) {
+		const char *p = ptr + i - 1;
+		if (*p == s.ptr[0] && memcmp(p, s.ptr, s.len) == 0) return i - 1;
+	}
+	return -1;
+}
+
+StringView StringView::substring(size_t left, size_t right) const
+{
+	if (left > right) {
+		size_t temp = right;
+		right = left;
+		left = temp;
+	}
+	if (left > len) return StringView();
+	if (right > len) right = len;
+	return StringView(ptr + left, right - left);
+}
+
+StringView StringView::trim(void) const
+{
+	const char *begin = ptr;
+	const char *end = ptr + len;
+	while (begin < end && isspace(*begin)) begin++;
+	while (end > begin && isspace(*(end - 1))) end--;
+	return StringView(begin, end - begin);
+}
+
+// numbers may not be followed by a null, so convert a terminated copy
+long StringView::toInt(void) const
+{
+	char buf[24];
+	getBytes((unsigned char *)buf, sizeof(buf));
+	return atol(buf);
+}
+
+float StringView::toFloat(void) const
+{
+	char buf[48];
+	getBytes((unsigned char *)buf, sizeof(buf));
+	return strtof_fast(buf, (char **)NULL);
+}
+
+String StringView::toString(void) const
+{
+	String str;
+	str.concat(ptr, len);
+	return str;
+}
@@ -0,0 +1,111 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2024 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef StringView_h_
+#define StringView_h_
+#ifdef __cplusplus
+
+#include <stddef.h>
+#include <string.h>
+#include "WString.h"
+
+// A read-only window onto characters owned by someone else: a string
+// literal, a String, a StaticString or part of a receive buffer.  It
+// never allocates and the text need not be null terminated, so
+// substring() and trim() only adjust the pointer and length.
+//
+//   StringView line(buffer, count);
+//   int comma = line.indexOf(',');
+//   long id = line.substring(0, comma).toInt();
+//
+// The characters must stay valid for as long as the StringView is used.
+class StringView
+{
+public:
+	constexpr StringView() : ptr(""), len(0) {}
+	StringView(const char *str) : ptr(str ? str : ""), len(str ? strlen(str) : 0) {}
+	constexpr StringView(const char *str, size_t length) : ptr(str), len(length) {}
+	StringView(const String &str) : ptr(str.c_str()), len(str.length()) {}
+
+	const char * data() const { return ptr; }
+	size_t length() const { return len; }
+	bool isEmpty() const { return len == 0; }
+	const char * begin() const { return ptr; }
+	const char * end() const { return ptr + len; }
+
+	// comparison
+	int compareTo(StringView s) const;
+	bool equals(StringView s) const { return len == s.len && memcmp(ptr, s.ptr, len) == 0; }
+	bool equalsIgnoreCase(StringView s) const;
+	bool startsWith(StringView prefix) const { return startsWith(prefix, 0); }
+	bool startsWith(StringView prefix, size_t offset) const {
+		return offset <= len && prefix.len <= len - offset
+			&& memcmp(ptr + offset, prefix.ptr, prefix.len) == 0;
+	}
+	bool endsWith(StringView suffix) const {
+		return suffix.len <= len && memcmp(ptr + len - suffix.len, suffix.ptr, suffix.len) == 0;
+	}
+	bool operator == (StringView s) const { return equals(s); }
+	bool operator != (StringView s) const { return !equals(s); }
+	bool operator <  (StringView s) const { return compareTo(s) < 0; }
+	bool operator >  (StringView s) const { return compareTo(s) > 0; }
+	bool operator <= (StringView s) const { return compareTo(s) <= 0; }
+	bool operator >= (StringView s) const { return compareTo(s) >= 0; }
+
+	// character access
+	char charAt(size_t index) const { return (index < len) ? ptr[index] : 0; }
+	char operator [] (size_t index) const { return charAt(index); }
+	void getBytes(unsigned char *buf, size_t bufsize, size_t index=0) const;
+	void toCharArray(char *buf, size_t bufsize, size_t index=0) const
+		{ getBytes((unsigned char *)buf, bufsize, index); }
+
+	// search
+	int indexOf(char ch, size_t fromIndex = 0) const;
+	int indexOf(StringView s, size_t fromIndex = 0) const;
+	int lastIndexOf(char ch) const { return lastIndexOf(ch, len - 1); }
+	int lastIndexOf(char ch, size_t fromIndex) const;
+	int lastIndexOf(StringView s) const { return lastIndexOf(s, len - s.len); }
+	int lastIndexOf(StringView s, size_t fromIndex) const;
+	StringView substring(size_t beginIndex) const { return substring(beginIndex, len); }
+	StringView substring(size_t beginIndex, size_t endIndex) const;
+	StringView trim(void) const;
+
+	// parsing/conversion
+	long toInt(void) const;
+	float toFloat(void) const;
+	String toString(void) const;
+
+private:
+	const char *ptr;
+	size_t len;
+};
+
+#endif // __cplusplus
+#endif
@@ -30,97 +30,68 @@
 #include <Arduino.h>
 
 
-// TODO: replace this slow Time library code with faster 32 bit approach
-
-
-// leap year calculator expects year argument as years offset from 1970
-#define LEAP_YEAR(Y)     ( ((1970+(Y))>0) && !((1970+(Y))%4) && ( ((1970+(Y))%100) || !((1970+(Y))%400) ) )
-static const uint8_t monthDays[]={31,28,31,30,31,30,31,31,30,31,30,31};
 #define SECS_PER_MIN  60
 #define SECS_PER_HOUR 3600
 #define SECS_PER_DAY  86400
 
+// Dates use the days-from-civil and civil-from-days algorithms, which work
+// on 400 year eras with March as the first month, so leap days fall at the
+// end of each year.  Every step is fixed arithmetic, without loops, and the
+// divisions are by constants, which the compiler turns into multiplies.
+// http://howardhinnant.github.io/date_algorithms.html
+
+// The month of the most recent day converted by breakTime().  Logging often
+// converts many times from the same day, which then skips the date math.
+// The first day of the month (16 bits, days since 1970), month and year are
+// packed in one word, so a call from an interrupt, or a main program call
+// interrupted by one, always sees a whole entry.  Every month has at least
+// 28 days, so the first 28 days of the cached month are known.
+static volatile uint32_t breakTime_cache = 0xFFFFFFFF;
 
 void breakTime(uint32_t time, DateTimeFields &tm)
 {
-// break the given time_t into time components
-// this is a more compact version of the C library localtime function
-// note that year is offset from 1970 !!!
-
-  uint8_t year;
-  uint8_t month, monthLength;
-  unsigned long days;
-
-  tm.sec = time % 60;
-  time /= 60; // now it is minutes
-  tm.min = time % 60;
-  time /= 60; // now it is hours
-  tm.hour = time % 24;
-  time /= 24; // now it is days
-  tm.wday = ((time + 4) % 7);  // Sunday is day 0
-
-  year = 0;
-  days = 0;
-  while((unsigned)(days += (LEAP_YEAR(year) ? 366 : 365)) <= time) {
-    year++;
+  uint32_t days = time / SECS_PER_DAY;
+  uint32_t secs = time - days * SECS_PER_DAY;
+  uint32_t hour = secs / SECS_PER_HOUR;
+  secs -= hour * SECS_PER_HOUR;
+  uint32_t min = secs / SECS_PER_MIN;
+  tm.sec = secs - min * SECS_PER_MIN;
+  tm.min = min;
+  tm.hour = hour;
+  tm.wday = (days + 4) % 7;  // Sunday is day 0, 1 Jan 1970 was Thursday
+
+  uint32_t cache = breakTime_cache;
+  uint32_t mday = days - (cache & 0xFFFF) + 1;
+  if (mday - 1 < 28) {
+    tm.mday = mday;
+    tm.mon = (cache >> 16) & 0x0F;
+    tm.year = cache >> 20;
+    return;
   }
-  tm.year = year + 70; // year is offset from 1970
-
-  days -= LEAP_YEAR(year) ? 366 : 365;
-  time  -= days; // now it is days in this year, starting at 0
-
-  days=0;
-  month=0;
-  monthLength=0;
-  for (month=0; month<12; month++) {
-    if (month==1) { // february
-      if (LEAP_YEAR(year)) {
-        monthLength=29;
-      } else {
-        monthLength=28;
-      }
-    } else {
-      monthLength = monthDays[month];
-    }
-
-    if (time >= monthLength) {
-      time -= monthLength;
-    } else {
-        break;
-    }
-  }
-  tm.mon = month;  // jan is month 0
-  tm.mday = time + 1;     // day of month
+  uint32_t z = days + 719468;          // days since 1 March 0000
+  uint32_t era = z / 146097;
+  uint32_t doe = z - era * 146097;     // day of era, 0 to 146096
+  uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100); // from March 1
+  uint32_t mp = (5 * doy + 2) / 153;   // month from March, 0 to 11
+  mday = doy - (153 * mp + 2) / 5 + 1;
+  uint32_t mon = (mp < 10) ? mp + 2 : mp - 10; // January = 0
+  uint32_t year = yoe + era * 400 + (mon < 2) - 1900;
+  breakTime_cache = (days - mday + 1) | (mon << 16) | (year << 20);
+  tm.mday = mday;
+  tm.mon = mon;
+  tm.year = year;
 }
 
 uint32_t makeTime(const DateTimeFields &tm)
 {
-// assemble time elements into time_t
-// note year argument is offset from 1970 (see macros in time.h to convert to other formats)
-// previous version used full four digit year (or digits since 2000),i.e. 2009 was 2009 or 9
-
-  int i;
-  uint32_t seconds;
-
-  // seconds from 1970 till 1 jan 00:00:00 of the given year
-  seconds = (tm.year - 70) * (SECS_PER_DAY * 365);
-  for (i = 70; i < tm.year; i++) {
-    if (LEAP_YEAR(i - 70)) {
-      seconds += SECS_PER_DAY;   // add extra days for leap years
-    }
-  }
-
-  // add days for this year, months start from 1
-  for (i = 0; i < tm.mon; i++) {
-    if ( (i == 1) && LEAP_YEAR(tm.year)) {
-      seconds += SECS_PER_DAY * 29;
-    } else {
-      seconds += SECS_PER_DAY * monthDays[i];
-    }
-  }
-  seconds += (tm.mday-1) * SECS_PER_DAY;
-  seconds += tm.hour * SECS_PER_HOUR;
-  seconds += tm.min * SECS_PER_MIN;
-  seconds += tm.sec;
-  return (time_t)seconds;
+  uint32_t mon = tm.mon;
+  uint32_t year = tm.year + 1900 - (mon < 2);   // years begin in March
+  uint32_t era = year / 400;
+  uint32_t yoe = year - era * 400;
+  uint32_t mp = (mon < 2) ? mon + 10 : mon - 2; // month from March
+  uint32_t doy = (153 * mp + 2) / 5 + tm.mday - 1;
+  uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  uint32_t days = era * 146097 + doe - 719468;  // days since 1970
+  return days * SECS_PER_DAY + tm.hour * SECS_PER_HOUR + tm.min * SECS_PER_MIN + tm.sec;
 }
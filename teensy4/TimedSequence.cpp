@@ -0,0 +1,82 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "TimedSequence.h"
+#include "avr/pgmspace.h"
+
+bool TimedSequence::add(uint8_t pin, uint32_t nsec, uint8_t op)
+{
+	if (pin >= CORE_NUM_DIGITAL || count >= maxSteps) return false;
+	// keep the steps in time order, after any others at the same time
+	uint32_t i = count;
+	while (i > 0 && step[i-1].nsec > nsec) {
+		step[i] = step[i-1];
+		i--;
+	}
+	step[i].nsec = nsec;
+	step[i].pin = pin;
+	step[i].op = op;
+	count++;
+	return true;
+}
+
+FASTRUN void TimedSequence::play()
+{
+	uint32_t cycles[maxSteps];
+	volatile uint32_t *reg[maxSteps];
+	uint32_t mask[maxSteps];
+	uint32_t n = 0;
+
+	// everything is worked out before the timing starts
+	for (uint32_t i=0; i < count; i++) {
+		uint32_t c = ((uint64_t)step[i].nsec * F_CPU_ACTUAL + 500000000) / 1000000000;
+		volatile uint32_t *r = portSetRegister(step[i].pin) + step[i].op;
+		uint32_t m = digitalPinToBitMask(step[i].pin);
+		if (n > 0 && cycles[n-1] == c && reg[n-1] == r) {
+			mask[n-1] |= m;
+		} else {
+			cycles[n] = c;
+			reg[n] = r;
+			mask[n] = m;
+			n++;
+		}
+	}
+	if (n == 0) return;
+
+	uint32_t primask;
+	__asm__ volatile("mrs %0, primask\n" : "=r" (primask)::);
+	__disable_irq();
+	uint32_t begin = ARM_DWT_CYCCNT;
+	for (uint32_t i=0; i < n; i++) {
+		while (ARM_DWT_CYCCNT - begin < cycles[i]) ; // wait
+		*reg[i] = mask[i];
+	}
+	if (primask == 0) __enable_irq();
+}
@@ -0,0 +1,80 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#ifndef TimedSequence_h_
+#define TimedSequence_h_
+
+#include <stdint.h>
+#include "core_pins.h"
+
+// Play a short sequence of pin changes at exact times, for protocols
+// like one-wire LED strips or custom sensor pulses, where delay calls
+// between digitalWriteFast() would add their own overhead to each step.
+// Times are in nanoseconds from the start of play():
+//
+//   TimedSequence seq;
+//   seq.high(2, 0);
+//   seq.low(2, 350);
+//   seq.high(3, 350);   // same time on the same port: one write
+//   seq.low(3, 1250);
+//   seq.play();
+//
+// play() converts the times to CPU cycles for the current F_CPU, then
+// runs from ITCM with interrupts disabled, waiting on the cycle counter
+// before each write, so every change lands within a few cycles of its
+// time.  Changes at the same time on the same port are combined into a
+// single register write.  Pins must already be outputs.
+class TimedSequence {
+public:
+	TimedSequence() {}
+	// false if the sequence is full
+	bool high(uint8_t pin, uint32_t nsec) { return add(pin, nsec, 0); }
+	bool low(uint8_t pin, uint32_t nsec) { return add(pin, nsec, 1); }
+	bool toggle(uint8_t pin, uint32_t nsec) { return add(pin, nsec, 2); }
+	void clear() { count = 0; }
+	uint32_t length() const { return count; }
+	// nanoseconds from the start to the last change
+	uint32_t duration() const { return count ? step[count-1].nsec : 0; }
+	void play();
+	static const uint32_t maxSteps = 32;
+private:
+	bool add(uint8_t pin, uint32_t nsec, uint8_t op);
+	struct step_t {
+		uint32_t nsec;
+		uint8_t pin;
+		uint8_t op;       // 0 = set, 1 = clear, 2 = toggle
+	};
+	step_t step[maxSteps];
+	uint8_t count = 0;
+};
+
+#endif
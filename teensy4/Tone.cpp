@@ -29,11 +29,31 @@
  */
 
 #include <Arduino.h>
+#include "EventResponder.h"
+
+// Tones on PWM pins are made by the pin's FlexPWM or QuadTimer at 50% duty,
+// so they use no CPU time and several can play at once.  A MillisTimer ends
+// each one.  Pins sharing a FlexPWM submodule share one frequency, as with
+// analogWriteFrequency().  Other pins, and frequencies too low for the PWM
+// dividers, use the IntervalTimer method, which plays one tone at a time.
+
+extern "C" uint8_t analog_write_res;
+extern "C" uint8_t pwm_pin_flexpwm(uint8_t pin);
+extern "C" uint8_t pwm_pin_quadtimer(uint8_t pin);
+
+#define TONE_PWM_MAX       8	// simultaneous hardware tones
+#define TONE_PWM_MIN_FREQ  20	// 150 MHz / 128 / 65536 is about 18 Hz
+
+struct tone_pwm_struct {
+	uint8_t pin = 255;	// 255 = unused
+	MillisTimer timer;
+	EventResponder done;
+};
+static tone_pwm_struct tone_pwm[TONE_PWM_MAX];
 
 // IntervalTimer based tone.  This allows tone() to share the timers with other
 // libraries, rather than permanently hogging one PIT timer even for projects
-// which never use tone().  Someday this single-tone implementation might be
-// changed to allow multiple simultaneous tones.
+// which never use tone().
 
 static uint32_t tone_toggle_count;
 static volatile uint32_t *tone_reg;
@@ -49,6 +69,67 @@ void tone_interrupt(void);
 #define TONE_TOGGLE_PIN  (tone_reg[35] = tone_mask)
 #define TONE_OUTPUT_PIN  (tone_reg[1] |= tone_mask)
 
+// return a pin from PWM back to GPIO, driving low.  Interrupts disabled.
+static void tone_pwm_stop(tone_pwm_struct *t)
+{
+	uint8_t pin = t->pin;
+	volatile uint32_t *reg = portOutputRegister(pin);
+	uint32_t mask = digitalPinToBitMask(pin);
+
+	t->pin = 255;
+	t->timer.end();
+	reg[34] = mask; // clear pin
+	reg[1] |= mask; // output mode
+	*portConfigRegister(pin) = 5;
+}
+
+// called from the MillisTimer interrupt when a tone's duration ends
+static void tone_pwm_done(EventResponderRef event)
+{
+	tone_pwm_struct *t = (tone_pwm_struct *)event.getContext();
+	__disable_irq();
+	if (t->pin < CORE_NUM_DIGITAL) tone_pwm_stop(t);
+	__enable_irq();
+}
+
+static void tone_pwm_start(uint8_t pin, uint16_t frequency, uint32_t duration)
+{
+	tone_pwm_struct *t = nullptr;
+
+	__disable_irq();
+	for (int i=0; i < TONE_PWM_MAX; i++) {
+		if (tone_pwm[i].pin == pin) {
+			t = tone_pwm + i;
+			break;
+		}
+		if (!t && tone_pwm[i].pin == 255) t = tone_pwm + i;
+	}
+	if (!t) {
+		// all hardware tones busy
+		__enable_irq();
+		return;
+	}
+	t->pin = pin;
+	t->timer.end();
+	__enable_irq();
+	analogWriteFrequency(pin, frequency);
+	analogWrite(pin, 1 << (analog_write_res - 1));
+	if (duration) {
+		t->done.setContext(t);
+		t->done.attachImmediate(tone_pwm_done);
+		t->timer.begin(duration, t->done);
+	}
+}
+
+static void noTone_pwm(uint8_t pin)
+{
+	__disable_irq();
+	for (int i=0; i < TONE_PWM_MAX; i++) {
+		if (tone_pwm[i].pin == pin) tone_pwm_stop(tone_pwm + i);
+	}
+	__enable_irq();
+}
+
 void tone(uint8_t pin, uint16_t frequency, uint32_t duration)
 {
 	uint32_t count;
@@ -56,6 +137,13 @@ void tone(uint8_t pin, uint16_t frequency, uint32_t duration)
 	float usec;
 
 	if (pin >= CORE_NUM_DIGITAL) return;
+	if (frequency >= TONE_PWM_MIN_FREQ
+	  && (pwm_pin_flexpwm(pin) != 255 || pwm_pin_quadtimer(pin) != 255)) {
+		if (pin == tone_pin) noTone(pin);
+		tone_pwm_start(pin, frequency, duration);
+		return;
+	}
+	noTone_pwm(pin);
 	if (duration) {
 		count = (frequency * duration / 1000) * 2;
 		if (!(count & 1)) count++; // always full waveform cycles
@@ -130,6 +218,7 @@ void tone_interrupt(void)
 void noTone(uint8_t pin)
 {
 	if (pin >= CORE_NUM_DIGITAL) return;
+	noTone_pwm(pin);
 	__disable_irq();
 	if (pin == tone_pin) {
 		tone_timer.end();
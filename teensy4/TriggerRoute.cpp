@@ -0,0 +1,185 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "TriggerRoute.h"
+#include "HardwareSerial.h"
+#include "core_pins.h"
+
+extern "C" uint8_t pwm_pin_flexpwm(uint8_t pin);
+extern "C" void xbar_connect(unsigned int input, unsigned int output);
+
+#define XBAR_INPUTS   88
+#define XBAR_OUTPUTS  132
+
+static IMXRT_FLEXPWM_t * const flexpwm[4] = {
+	&IMXRT_FLEXPWM1, &IMXRT_FLEXPWM2, &IMXRT_FLEXPWM3, &IMXRT_FLEXPWM4
+};
+
+int TriggerRoute::pwmReload(uint8_t pin)
+{
+	uint8_t info = pwm_pin_flexpwm(pin);
+	if (info == 255) return -1;
+	int module = info >> 4;
+	int submodule = (info >> 2) & 3;
+	// analogWrite() counts from INIT to VAL1, then reloads.  VAL1 is the
+	// same for both channels, unlike VAL0 which sets the X duty cycle.
+	flexpwm_module_enable(flexpwm[module]);
+	flexpwm[module]->SM[submodule].TCTRL |= FLEXPWM_SMTCTRL_OUT_TRIG_EN(1 << 1);
+	// OUT_TRIG0 and OUT_TRIG1 of each submodule share one XBAR input
+	return XBARA1_IN_FLEXPWM1_PWM1_OUT_TRIG0 + module * 4 + submodule;
+}
+
+// Pin sources carry the pin number above the XBAR input, so connect()
+// changes the pad mux only after it knows the route is possible
+int TriggerRoute::pin(uint8_t pin)
+{
+	for (uint8_t i = 0; i < count_pin_to_xbar_info; i++) {
+		const pin_to_xbar_info_t *info = pin_to_xbar_info + i;
+		if (info->pin != pin) continue;
+		return ((pin + 1) << 8) | info->xbar_in_index;
+	}
+	return -1;
+}
+
+static void pin_mux(int source)
+{
+	if (source < 0x100) return;
+	uint8_t pin = (source >> 8) - 1;
+	for (uint8_t i = 0; i < count_pin_to_xbar_info; i++) {
+		const pin_to_xbar_info_t *info = pin_to_xbar_info + i;
+		if (info->pin != pin || info->xbar_in_index != (source & 0xFF)) continue;
+		*(portControlRegister(pin)) = IOMUXC_PAD_DSE(7) | IOMUXC_PAD_PKE | IOMUXC_PAD_HYS;
+		*(portConfigRegister(pin)) = info->mux_val;
+		if (info->select_input_register) *(info->select_input_register) = info->select_val;
+		return;
+	}
+}
+
+int TriggerRoute::pit(uint8_t channel)
+{
+	if (channel >= 4) return -1;
+	return XBARA1_IN_PIT_TRIGGER0 + channel;
+}
+
+int TriggerRoute::adc(uint8_t adc)
+{
+	if (adc == 1) return XBARA1_OUT_ADC_ETC_TRIG00;
+	if (adc == 2) return XBARA1_OUT_ADC_ETC_TRIG10;
+	return -1;
+}
+
+int TriggerRoute::quadTimer(uint8_t module, uint8_t channel)
+{
+	if (module < 1 || module > 4 || channel >= 4) return -1;
+	return XBARA1_OUT_QTIMER1_TIMER0 + (module - 1) * 4 + channel;
+}
+
+int TriggerRoute::dmaRequest(uint8_t n)
+{
+	if (n >= 4) return -1;
+	return XBARA1_OUT_DMA_CH_MUX_REQ30 + n;
+}
+
+uint8_t TriggerRoute::dmaSource(uint8_t n)
+{
+	static const uint8_t source[4] = {
+		DMAMUX_SOURCE_XBAR1_0, DMAMUX_SOURCE_XBAR1_1,
+		DMAMUX_SOURCE_XBAR1_2, DMAMUX_SOURCE_XBAR1_3
+	};
+	return source[n & 3];
+}
+
+int TriggerRoute::source(int destination)
+{
+	if (destination < 0 || destination >= XBAR_OUTPUTS) return -1;
+	if (!(CCM_CCGR2 & CCM_CCGR2_XBAR1(CCM_CCGR_ON))) return -1;
+	uint16_t sel = (&XBARA1_SEL0)[destination / 2];
+	int input = (destination & 1) ? (sel >> 8) : (sel & 0xFF);
+	// unused outputs select input 0, which is constant logic low
+	return (input == XBARA1_IN_LOGIC_LOW) ? -1 : input;
+}
+
+// QuadTimer counter inputs come from pins unless their GPR6 bit selects XBAR
+static void quadtimer_input_select(int destination, bool xbar)
+{
+	int n = destination - XBARA1_OUT_QTIMER1_TIMER0;
+	if (n < 0 || n >= 16) return;
+	if (xbar) {
+		IOMUXC_GPR_GPR6 |= IOMUXC_GPR_GPR6_QTIMER1_TRM0_INPUT_SEL << n;
+	} else {
+		IOMUXC_GPR_GPR6 &= ~(IOMUXC_GPR_GPR6_QTIMER1_TRM0_INPUT_SEL << n);
+	}
+}
+
+// XBAR outputs 0 to 3 only make DMA requests when enabled, on rising edges
+static void dma_request_enable(int destination, bool enable)
+{
+	if (destination < 0 || destination >= 4) return;
+	volatile uint16_t *ctrl = &XBARA1_CTRL0 + (destination >> 1);
+	uint16_t mask = (destination & 1) ? (XBARA_CTRL_DEN1 | XBARA_CTRL_EDGE1(3))
+		: (XBARA_CTRL_DEN0 | XBARA_CTRL_EDGE0(3));
+	uint16_t bits = (destination & 1) ? (XBARA_CTRL_DEN1 | XBARA_CTRL_EDGE1(1))
+		: (XBARA_CTRL_DEN0 | XBARA_CTRL_EDGE0(1));
+	// status bits are cleared by writing 1, so write them as 0
+	uint16_t val = *ctrl & ~(mask | XBARA_CTRL_STS0 | XBARA_CTRL_STS1);
+	*ctrl = enable ? (val | bits) : val;
+}
+
+bool TriggerRoute::connect(int source, int destination)
+{
+	if (source < 0) return false;
+	int input = source & 0xFF;
+	if (input >= XBAR_INPUTS) return false;
+	if (destination < 0 || destination >= XBAR_OUTPUTS) return false;
+	CCM_CCGR2 |= CCM_CCGR2_XBAR1(CCM_CCGR_ON);
+	__disable_irq();
+	int prior = TriggerRoute::source(destination);
+	if (prior >= 0 && prior != input) {
+		__enable_irq();
+		return false;
+	}
+	xbar_connect(input, destination);
+	__enable_irq();
+	pin_mux(source);
+	quadtimer_input_select(destination, true);
+	dma_request_enable(destination, true);
+	return true;
+}
+
+void TriggerRoute::disconnect(int destination)
+{
+	if (destination < 0 || destination >= XBAR_OUTPUTS) return;
+	if (!(CCM_CCGR2 & CCM_CCGR2_XBAR1(CCM_CCGR_ON))) return;
+	dma_request_enable(destination, false);
+	quadtimer_input_select(destination, false);
+	__disable_irq();
+	xbar_connect(XBARA1_IN_LOGIC_LOW, destination);
+	__enable_irq();
+}
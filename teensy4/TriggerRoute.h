@@ -0,0 +1,77 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#ifndef TriggerRoute_h_
+#define TriggerRoute_h_
+
+#include <stdint.h>
+
+// Hardware trigger routing through the XBAR crossbar, so one peripheral
+// can start another with no CPU time.  Sources and destinations are
+// looked up by pin, timer or ADC, and connect() refuses to take over a
+// destination which is already driven by a different source:
+//
+//   // sample A0 and A1 once per PWM period of analogWrite() pin 2
+//   stream.beginTriggered(pins, 2, TriggerRoute::pwmReload(2), buffer, 2048, block);
+//
+//   // trigger DMA on each rising edge of pin 4
+//   TriggerRoute::connect(TriggerRoute::pin(4), TriggerRoute::dmaRequest(0));
+//   dma.triggerAtHardwareEvent(TriggerRoute::dmaSource(0));
+//
+// Lookups return -1 for anything which does not exist, and connect()
+// fails when given -1, so only its result needs checking.
+class TriggerRoute {
+public:
+	// Sources (XBAR inputs).  pwmReload() enables a trigger at the end of
+	// every period of the FlexPWM submodule driving the pin.  pin() is
+	// for pins which have an XBAR input.  It doesn't change the pin;
+	// connect() sets its mux to XBAR only when the connection succeeds.
+	static int pwmReload(uint8_t pin);
+	static int pin(uint8_t pin);
+	static int pit(uint8_t channel);
+	// Destinations (XBAR outputs).  adc() is the ADC_ETC trigger used by
+	// AnalogStream for ADC 1 or 2.  quadTimer() replaces the counter input
+	// pin of QuadTimer module 1-4, channel 0-3.  dmaRequest() is one of the
+	// 4 XBAR DMA requests, with dmaSource() its DMAMUX source.
+	static int adc(uint8_t adc);
+	static int quadTimer(uint8_t module, uint8_t channel);
+	static int dmaRequest(uint8_t n);
+	static uint8_t dmaSource(uint8_t n);
+	// Connect a source to a destination, false if either is invalid or
+	// the destination is already in use by a different source
+	static bool connect(int source, int destination);
+	static void disconnect(int destination);
+	// source driving a destination, or -1 if not connected
+	static int source(int destination);
+};
+
+#endif
@@ -39,6 +39,7 @@
 
 #include <Stream.h>
 #include <IPAddress.h>
+#include <stdlib.h>
 
 class UDP : public Stream {
 
@@ -84,8 +85,53 @@ public:
   virtual IPAddress remoteIP() =0;
   // Return the port of the host who sent the current incoming packet
   virtual uint16_t remotePort() =0;
+
+  // Packet buffer access, for libraries able to avoid copying.  The default
+  // versions copy through a shared buffer, so these always work, but only
+  // save time when a library overrides them.
+
+  // After beginPacket(), get a buffer to fill with the outgoing packet's
+  // payload.  *capacity is set to the most bytes it can hold.  Call
+  // endPacketBuffer() with the number of bytes used to send the packet.
+  // Returns 1 if successful, 0 if no buffer is available
+  virtual int beginPacketBuffer(uint8_t **buffer, size_t *capacity) {
+    uint8_t *p = copyBuffer(1);
+    if (!p) return 0;
+    *buffer = p;
+    *capacity = copy_buffer_size;
+    return 1;
+  }
+  // Send the packet filled in after beginPacketBuffer()
+  // Returns 1 if the packet was sent successfully, 0 if there was an error
+  virtual int endPacketBuffer(size_t len) {
+    uint8_t *p = copyBuffer(1);
+    if (!p || len > copy_buffer_size) return 0;
+    if (write(p, len) != len) return 0;
+    return endPacket();
+  }
+  // After parsePacket(), get a pointer to the unread bytes of the current
+  // packet, which are then counted as read.  The data remains valid until
+  // the next parsePacket() or flush().
+  // Returns the number of bytes at *buffer, or 0 if none are available
+  virtual int readBuffer(const uint8_t **buffer) {
+    uint8_t *p = copyBuffer(0);
+    if (!p) return 0;
+    int len = read(p, copy_buffer_size);
+    if (len <= 0) return 0;
+    *buffer = p;
+    return len;
+  }
 protected:
   uint8_t* rawIPAddress(IPAddress& addr) { return addr.raw_address(); };
+private:
+  // Shared by all UDP objects which use the default buffer functions, and
+  // only allocated the first time one is called.
+  static const size_t copy_buffer_size = 1472; // largest payload in 1500 MTU
+  static uint8_t * copyBuffer(int transmit) {
+    static uint8_t *buf[2] = {nullptr, nullptr};
+    if (!buf[transmit]) buf[transmit] = (uint8_t *)malloc(copy_buffer_size);
+    return buf[transmit];
+  }
 };
 
 #endif
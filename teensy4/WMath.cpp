@@ -20,47 +20,134 @@
 */
 
 #include <stdint.h>
+#include <string.h>
+#include "imxrt.h"
 
-static uint32_t seed;
+// xoshiro128** by David Blackman and Sebastiano Vigna, seeded through
+// splitmix32.  Much faster than the division based Park-Miller generator
+// used by avr-libc, and a far longer period.  The initial state is what
+// seed_state(123459876) gives, the avr-libc default seed.
+static uint32_t state[4] = {0xE64AC7B3, 0xD576B2A6, 0x18F434F8, 0x25C177C1};
+
+static inline uint32_t rotl(uint32_t x, int k)
+{
+	return (x << k) | (x >> (32 - k));
+}
+
+static inline uint32_t next(void)
+{
+	uint32_t result = rotl(state[1] * 5, 7) * 9;
+	uint32_t t = state[1] << 9;
+
+	state[2] ^= state[0];
+	state[3] ^= state[1];
+	state[1] ^= state[2];
+	state[0] ^= state[3];
+	state[2] ^= t;
+	state[3] = rotl(state[3], 11);
+	return result;
+}
+
+static void seed_state(uint32_t x)
+{
+	for (int i=0; i < 4; i++) {
+		uint32_t z = (x += 0x9E3779B9);
+		z = (z ^ (z >> 16)) * 0x85EBCA6B;
+		z = (z ^ (z >> 13)) * 0xC2B2AE35;
+		state[i] = z ^ (z >> 16);
+	}
+}
 
 void randomSeed(uint32_t newseed)
 {
-	if (newseed > 0) seed = newseed;
+	if (newseed > 0) seed_state(newseed);
 }
 
 void srandom(unsigned int newseed)
 {
-	seed = newseed;
+	seed_state(newseed);
+}
+
+// Seed from the TRNG hardware.  Takes a few milliseconds while the TRNG
+// gathers entropy.  Returns 0 if the TRNG reports an error.
+int randomSeedTRNG(void)
+{
+	uint32_t clock = CCM_CCGR6 & CCM_CCGR6_TRNG(CCM_CCGR_ON);
+	uint32_t elapsed = 0;
+
+	if (!clock) {
+		CCM_CCGR6 |= CCM_CCGR6_TRNG(CCM_CCGR_ON);
+		TRNG_MCTL = TRNG_MCTL_RST_DEF | TRNG_MCTL_PRGM;
+		TRNG_MCTL = TRNG_MCTL_SAMP_MODE(2);
+	}
+	while (!(TRNG_MCTL & (TRNG_MCTL_ENT_VAL | TRNG_MCTL_ERR))) {
+		if (++elapsed > 100000000) break;
+	}
+	if (!(TRNG_MCTL & TRNG_MCTL_ENT_VAL)) {
+		if (!clock) CCM_CCGR6 &= ~CCM_CCGR6_TRNG(CCM_CCGR_ON);
+		return 0;
+	}
+	state[0] = TRNG_ENT0;
+	state[1] = TRNG_ENT1;
+	state[2] = TRNG_ENT2;
+	state[3] = TRNG_ENT3;
+	// reading ENT15 begins the next entropy generation
+	(void)TRNG_ENT15;
+	if (!clock) CCM_CCGR6 &= ~CCM_CCGR6_TRNG(CCM_CCGR_ON);
+	if ((state[0] | state[1] | state[2] | state[3]) == 0) seed_state(0);
+	return 1;
 }
 
 int32_t random(void)
 {
-	int32_t hi, lo, x;
-
-	// the algorithm used in avr-libc 1.6.4
-	x = seed;
-	if (x == 0) x = 123459876;
-	hi = x / 127773;
-	lo = x % 127773;
-	x = 16807 * lo - 2836 * hi;
-	if (x < 0) x += 0x7FFFFFFF;
-	seed = x;
-	return x;
+	return next() >> 1;
 }
 
+// Lemire's multiply-shift reduction, with rejection of the few values
+// which would make some results more likely than others.  No division in
+// the common case.
 uint32_t random(uint32_t howbig)
 {
 	if (howbig == 0) return 0;
-	return random() % howbig;
+	uint64_t m = (uint64_t)next() * howbig;
+	uint32_t low = (uint32_t)m;
+	if (low < howbig) {
+		uint32_t threshold = -howbig % howbig;
+		while (low < threshold) {
+			m = (uint64_t)next() * howbig;
+			low = (uint32_t)m;
+		}
+	}
+	return m >> 32;
 }
 
 int32_t random(int32_t howsmall, int32_t howbig)
 {
 	if (howsmall >= howbig) return howsmall;
-	int32_t diff = howbig - howsmall;
+	uint32_t diff = (uint32_t)howbig - (uint32_t)howsmall;
 	return random(diff) + howsmall;
 }
 
+void randomFill(void *buf, size_t len)
+{
+	uint8_t *p = (uint8_t *)buf;
+	uint32_t r;
+
+	while (len > 0 && ((uintptr_t)p & 3)) {
+		*p++ = next();
+		len--;
+	}
+	while (len >= 4) {
+		*(uint32_t *)p = next();
+		p += 4;
+		len -= 4;
+	}
+	if (len > 0) {
+		r = next();
+		memcpy(p, &r, len);
+	}
+}
+
 unsigned int makeWord(unsigned int w) { return w; }
 unsigned int makeWord(unsigned char h, unsigned char l) { return (h << 8) | l; }
 
@@ -55,6 +55,9 @@
 #include "usb_joystick.h"
 #include "usb_midi.h"
 #include "usb_rawhid.h"
+#include "usb_vendor.h"
+#include "usb_ncm.h"
+#include "usb_video.h"
 #include "usb_flightsim.h"
 //#include "usb_mtp.h"
 #include "usb_audio.h"
@@ -65,7 +68,14 @@
 #include "WString.h"
 #include "elapsedMillis.h"
 #include "IntervalTimer.h"
+#include "BufferedPrint.h"
+#include "StaticString.h"
 #include "CrashReport.h"
+#include "PCProfile.h"
+#include "HeapProfile.h"
+#include "MemoryMap.h"
+#include "IRQLatency.h"
+#include "PerfCounters.h"
 
 uint16_t makeWord(uint16_t w);
 uint16_t makeWord(byte h, byte l);
@@ -83,6 +93,8 @@ uint32_t random(uint32_t howbig);
 int32_t random(int32_t howsmall, int32_t howbig);
 void randomSeed(uint32_t newseed);
 void srandom(unsigned int newseed);
+int randomSeedTRNG(void);
+void randomFill(void *buf, size_t len);
 
 #include "pins_arduino.h"
 
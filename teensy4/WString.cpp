@@ -112,7 +112,7 @@ String::String(float num, unsigned char digits)
 
 String::~String()
 {
-	free(buffer);
+	freeBuffer();
 }
 
 /*********************************************/
@@ -139,7 +139,18 @@ unsigned char String::reserve(unsigned int size)
 
 unsigned char String::changeBuffer(unsigned int maxStrLen)
 {
-	char *newbuffer = (char *)realloc(buffer, maxStrLen + 1);
+	if (buffer == NULL && maxStrLen <= SSO_CAPACITY) {
+		buffer = sso;
+		capacity = SSO_CAPACITY;
+		return 1;
+	}
+	char *newbuffer;
+	if (buffer == sso) {
+		newbuffer = (char *)malloc(maxStrLen + 1);
+		if (newbuffer) memcpy(newbuffer, sso, len + 1);
+	} else {
+		newbuffer = (char *)realloc(buffer, maxStrLen + 1);
+	}
 	if (newbuffer) {
 		buffer = newbuffer;
 		capacity = maxStrLen;
@@ -148,6 +159,16 @@ unsigned char String::changeBuffer(unsigned int maxStrLen)
 	return 0;
 }
 
+// a StringSumHelper is appended to again and again by operator+, so grow
+// its buffer by half each time rather than realloc on every term
+unsigned char String::reserveSum(unsigned int size)
+{
+	if (capacity >= size) return 1;
+	unsigned int grow = capacity + (capacity >> 1);
+	if (grow > size && reserve(grow)) return 1;
+	return reserve(size);
+}
+
 /*********************************************/
 /*  Copy and Move                            */
 /*********************************************/
@@ -161,7 +182,7 @@ String & String::copy(const char *cstr, unsigned int length)
 	}
 	if (!reserve(length)) {
 		if (buffer) {
-			free(buffer);
+			freeBuffer();
 			buffer = NULL;
 		}
 		len = capacity = 0;
@@ -175,7 +196,15 @@ String & String::copy(const char *cstr, unsigned int length)
 void String::move(String &rhs)
 {
 	if (&rhs == this) return;
-	if (buffer) free(buffer);
+	if (rhs.buffer == rhs.sso) {
+		// short strings can't change owner, copy them
+		copy(rhs.sso, rhs.len);
+		rhs.buffer = NULL;
+		rhs.capacity = 0;
+		rhs.len = 0;
+		return;
+	}
+	if (buffer) freeBuffer();
 	buffer = rhs.buffer;
 	capacity = rhs.capacity;
 	len = rhs.len;
@@ -247,12 +276,9 @@ String & String::append(const char *cstr, unsigned int length)
 		buffer_offset = (unsigned int)(cstr-buffer);
 	}
 	if (length == 0 || !reserve(newlen)) return *this;
-	if ( self ) {
-		memcpy(buffer + len, buffer+buffer_offset, length);
-		buffer[newlen] = 0;
-		}
-	else
-		strcpy(buffer + len, cstr);
+	if ( self ) cstr = buffer + buffer_offset;
+	memcpy(buffer + len, cstr, length);
+	buffer[newlen] = 0;
 	len = newlen;
 	return *this;
 }
@@ -321,34 +347,39 @@ String & String::append(float num)
 StringSumHelper & operator + (const StringSumHelper &lhs, const String &rhs)
 {
 	StringSumHelper &a = const_cast<StringSumHelper&>(lhs);
-	a.append(rhs.buffer, rhs.len);
+	if (a.reserveSum(a.len + rhs.len)) a.append(rhs.buffer, rhs.len);
 	return a;
 }
 
 StringSumHelper & operator + (const StringSumHelper &lhs, const char *cstr)
 {
 	StringSumHelper &a = const_cast<StringSumHelper&>(lhs);
-	if (cstr) a.append(cstr, strlen(cstr));
+	if (cstr) {
+		unsigned int length = strlen(cstr);
+		if (a.reserveSum(a.len + length)) a.append(cstr, length);
+	}
 	return a;
 }
 
 StringSumHelper & operator + (const StringSumHelper &lhs, const __FlashStringHelper *pgmstr)
 {
 	StringSumHelper &a = const_cast<StringSumHelper&>(lhs);
-	a.append(pgmstr);
+	unsigned int length = strlen((const char *)pgmstr);
+	if (a.reserveSum(a.len + length)) a.append((const char *)pgmstr, length);
 	return a;
 }
 
 StringSumHelper & operator + (const StringSumHelper &lhs, char c)
 {
 	StringSumHelper &a = const_cast<StringSumHelper&>(lhs);
-	a.append(c);
+	if (a.reserveSum(a.len + 1)) a.append(c);
 	return a;
 }
 
 StringSumHelper & operator + (const StringSumHelper &lhs, unsigned char c)
 {
 	StringSumHelper &a = const_cast<StringSumHelper&>(lhs);
+	a.reserveSum(a.len + 3);
 	a.append(c);
 	return a;
 }
@@ -356,6 +387,7 @@ StringSumHelper & operator + (const StringSumHelper &lhs, unsigned char c)
 StringSumHelper & operator + (const StringSumHelper &lhs, int num)
 {
 	StringSumHelper &a = const_cast<StringSumHelper&>(lhs);
+	a.reserveSum(a.len + 11);
 	a.append((long)num);
 	return a;
 }
@@ -363,6 +395,7 @@ StringSumHelper & operator + (const StringSumHelper &lhs, int num)
 StringSumHelper & operator + (const StringSumHelper &lhs, unsigned int num)
 {
 	StringSumHelper &a = const_cast<StringSumHelper&>(lhs);
+	a.reserveSum(a.len + 11);
 	a.append((unsigned long)num);
 	return a;
 }
@@ -370,6 +403,7 @@ StringSumHelper & operator + (const StringSumHelper &lhs, unsigned int num)
 StringSumHelper & operator + (const StringSumHelper &lhs, long num)
 {
 	StringSumHelper &a = const_cast<StringSumHelper&>(lhs);
+	a.reserveSum(a.len + 11);
 	a.append(num);
 	return a;
 }
@@ -377,6 +411,7 @@ StringSumHelper & operator + (const StringSumHelper &lhs, long num)
 StringSumHelper & operator + (const StringSumHelper &lhs, unsigned long num)
 {
 	StringSumHelper &a = const_cast<StringSumHelper&>(lhs);
+	a.reserveSum(a.len + 11);
 	a.append(num);
 	return a;
 }
@@ -706,7 +741,7 @@ String & String::trim(void)
 	char *end = buffer + len - 1;
 	while (isspace(*end) && end >= begin) end--;
 	len = end + 1 - begin;
-	if (begin > buffer) memcpy(buffer, begin, len);
+	if (begin > buffer) memmove(buffer, begin, len);
 	buffer[len] = 0;
 	return *this;
 }
@@ -723,8 +758,29 @@ long String::toInt(void) const
 
 float String::toFloat(void) const
 {
-	if (buffer) return strtof(buffer, (char **)NULL);
+	if (buffer) return strtof_fast(buffer, (char **)NULL);
 	return 0.0;
 }
 
+unsigned int String::toFloats(float *values, unsigned int count) const
+{
+	unsigned int n = 0;
+	if (!buffer) return 0;
+	const char *p = buffer;
+	while (*p && n < count) {
+		// only start at digits, so text like "inf" or "nan" isn't parsed
+		const char *d = p;
+		if (*d == '-' || *d == '+') d++;
+		if (*d == '.') d++;
+		if (*d >= '0' && *d <= '9') {
+			char *end;
+			values[n++] = strtof_fast(p, &end);
+			p = end;
+		} else {
+			p++;
+		}
+	}
+	return n;
+}
+
 
@@ -125,6 +125,7 @@ public:
 	friend StringSumHelper & operator + (const StringSumHelper &lhs, float num);
 	friend StringSumHelper & operator + (const StringSumHelper &lhs, double num);
 	String & concat(const String &str)		{return append(str);}
+	String & concat(const char *cstr, unsigned int length) {return append(cstr, length);}
 	String & concat(const char *cstr)		{return append(cstr);}
 	String & concat(const __FlashStringHelper *pgmstr) {return append(pgmstr);}
 	String & concat(char c)				{return append(c);}
@@ -198,15 +199,23 @@ public:
 	// parsing/conversion
 	long toInt(void) const;
 	float toFloat(void) const;
+	// parse up to count numbers separated by any other characters,
+	// like "12.5,-3,4e2", returns the number of values found
+	unsigned int toFloats(float *values, unsigned int count) const;
 
 protected:
 	char *buffer;	        // the actual char array
 	unsigned int capacity;  // the array length minus one (for the '\0')
 	unsigned int len;       // the String length (not counting the '\0')
 	unsigned char flags;    // unused, for future features
+	// short strings live here, inside the String, without using malloc
+	enum { SSO_CAPACITY = 15 };
+	char sso[SSO_CAPACITY + 1];
 protected:
 	void init(void);
 	unsigned char changeBuffer(unsigned int maxStrLen);
+	unsigned char reserveSum(unsigned int size);
+	void freeBuffer(void) { if (buffer != sso) free(buffer); }
 	String & append(const char *cstr, unsigned int length);
 private:
 	// allow for "if (s)" without the complications of an operator bool().
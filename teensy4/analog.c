@@ -3,7 +3,12 @@
 #include "debug/printf.h"
 #include "avr/pgmspace.h"
 
+#ifdef STARTUP_DEFER_INIT
+// analog_init() runs when the ADC is first used, rather than at startup
+static uint8_t calibrating = 2;
+#else
 static uint8_t calibrating;
+#endif
 static uint8_t analog_config_bits = 10;
 static uint8_t analog_num_average = 4;
 
@@ -59,6 +64,12 @@ const uint8_t pin_to_channel[] = { // pg 482
 static void wait_for_cal(void)
 {
 	//printf("wait_for_cal\n");
+#ifdef STARTUP_DEFER_INIT
+	if (calibrating == 2) {
+		analog_init();
+		return;
+	}
+#endif
 	while ((ADC1_GC & ADC_GC_CAL) || (ADC2_GC & ADC_GC_CAL)) {
 		yield();
 	}
@@ -68,31 +79,284 @@ static void wait_for_cal(void)
 }
 
 
+// ADC channel for a pin, with 0x80 set if only ADC2 can measure it,
+// or 255 if the pin has no analog input
+uint8_t analog_pin_channel(uint8_t pin)
+{
+#ifdef STARTUP_DEFER_INIT
+	if (calibrating == 2) analog_init(); // also for AnalogStream
+#endif
+	if (pin >= sizeof(pin_to_channel)) return 255;
+	return pin_to_channel[pin];
+}
+
+// Whether ADC2 can measure a channel from analog_pin_channel().  Both ADCs
+// share most pads at the same channel numbers, but ADC1 channels 1 to 4
+// are AD_B0 pads (A10, A11) which ADC2 can't reach; on ADC2 those numbers
+// are the AD_B1 pads marked with 0x80.
+int analog_channel_on_adc2(uint8_t ch)
+{
+	if (ch == 255) return 0;
+	if (ch & 0x80) return 1;
+	return ch == 0 || ch >= 5;
+}
+
+// Each ADC has a small queue of conversion requests, from analogRead()
+// and analogReadStart(), which may come from the main program, yield()
+// and interrupts.  The request at the head is converting; the ADC's
+// COCO interrupt delivers its result and starts the next.
+#define ANALOG_QUEUE_SIZE 8
+
+struct analog_request {
+	void (*callback)(uint8_t pin, int value);
+	volatile int *result; // analogRead() waits on this, callback is NULL
+	uint8_t pin;
+	uint8_t channel;
+};
+
+struct analog_queue {
+	struct analog_request req[ANALOG_QUEUE_SIZE];
+	volatile uint8_t head;
+	volatile uint8_t tail;
+	volatile uint8_t locked; // analogReadPair() is using the ADC
+};
+
+static struct analog_queue analog_queue[2];
+#define ADC_REGS(n) ((n) ? &IMXRT_ADC2 : &IMXRT_ADC1)
+
+static inline uint32_t analog_irq_save(void)
+{
+	uint32_t primask;
+	__asm__ volatile("mrs %0, primask\n" : "=r" (primask)::);
+	__disable_irq();
+	return primask;
+}
+
+static inline void analog_irq_restore(uint32_t primask)
+{
+	if (primask == 0) __enable_irq();
+}
+
+// start converting the head request, interrupts must be disabled
+static void analog_start(int n)
+{
+	struct analog_queue *q = &analog_queue[n];
+	if (q->locked || q->head == q->tail) return;
+	ADC_REGS(n)->HC0 = q->req[q->head].channel | ADC_HC_AIEN;
+}
+
+// complete a finished conversion, from the ADC interrupt or polling
+static void analog_service(int n)
+{
+	struct analog_queue *q = &analog_queue[n];
+	IMXRT_ADCS_t *adc = ADC_REGS(n);
+	struct analog_request r;
+	int value;
+
+	uint32_t irq = analog_irq_save();
+	if (q->locked || q->head == q->tail || !(adc->HS & ADC_HS_COCO0)) {
+		analog_irq_restore(irq);
+		return;
+	}
+	value = adc->R0; // clears COCO0
+	r = q->req[q->head];
+	q->head = (q->head + 1) % ANALOG_QUEUE_SIZE;
+	analog_start(n);
+	analog_irq_restore(irq);
+	if (r.callback) {
+		(*r.callback)(r.pin, value);
+	} else {
+		*r.result = value;
+	}
+}
+
+static void adc1_isr(void)
+{
+	analog_service(0);
+}
+
+static void adc2_isr(void)
+{
+	analog_service(1);
+}
+
+// add a request to an ADC's queue, returns 0 if the queue is full or
+// the ADC is in use by AnalogStream
+static int analog_enqueue(int n, const struct analog_request *r)
+{
+	struct analog_queue *q = &analog_queue[n];
+	static uint8_t irq_attached = 0;
+
+	if (!irq_attached) {
+		attachInterruptVector(IRQ_ADC1, adc1_isr);
+		attachInterruptVector(IRQ_ADC2, adc2_isr);
+		NVIC_ENABLE_IRQ(IRQ_ADC1);
+		NVIC_ENABLE_IRQ(IRQ_ADC2);
+		irq_attached = 1;
+	}
+	uint32_t irq = analog_irq_save();
+	uint8_t next = (q->tail + 1) % ANALOG_QUEUE_SIZE;
+	if (next == q->head || (ADC_REGS(n)->CFG & ADC_CFG_ADTRG)) {
+		analog_irq_restore(irq);
+		return 0;
+	}
+	int idle = (q->head == q->tail);
+	q->req[q->tail] = *r;
+	q->tail = next;
+	if (idle) analog_start(n);
+	analog_irq_restore(irq);
+	return 1;
+}
+
+static inline int in_interrupt(void)
+{
+	uint32_t ipsr;
+	__asm__ volatile("mrs %0, ipsr\n" : "=r" (ipsr)::);
+	return ipsr != 0;
+}
+
 int analogRead(uint8_t pin)
 {
-	// TODO: what happens if a program calls analogRead() from both main
-	// program and interrupts?  On Teensy 3.x this came up and code was
-	// added to allow analogRead() to work (or at least not hang) in
-	// when used from interrupts & main program.
-	if (pin > sizeof(pin_to_channel)) return 0;
+	// Conversions requested by the main program, yield() and interrupts
+	// are queued, so they never disturb each other.  Waiting also polls
+	// for completion, in case this is called from an interrupt which
+	// blocks the ADC interrupt.
+	struct analog_request r;
+	volatile int value = -1;
+
+	if (pin >= sizeof(pin_to_channel)) return 0;
 	if (calibrating) wait_for_cal();
 	uint8_t ch = pin_to_channel[pin];
 	if (ch == 255) return 0;
-//	printf("%d\n", ch);
-//	if (ch > 15) return 0;
-	if(!(ch & 0x80)) {
-		ADC1_HC0 = ch;
-		while (!(ADC1_HS & ADC_HS_COCO0)) {
-			yield(); // TODO: what happens if yield-called code uses analogRead()
-		}
-		return ADC1_R0;
-	} else {
-		ADC2_HC0 = ch & 0x7f;
-		while (!(ADC2_HS & ADC_HS_COCO0)) {
-			yield(); // TODO: what happens if yield-called code uses analogRead()
+	int n = (ch & 0x80) ? 1 : 0;
+	if (ADC_REGS(n)->CFG & ADC_CFG_ADTRG) return 0; // busy with AnalogStream
+	r.callback = 0;
+	r.result = &value;
+	r.pin = pin;
+	r.channel = ch & 0x7F;
+	while (!analog_enqueue(n, &r)) {
+		if (ADC_REGS(n)->CFG & ADC_CFG_ADTRG) return 0;
+		analog_service(n); // queue full, wait for room
+	}
+	while (value < 0) {
+		analog_service(n);
+		if (value >= 0) break;
+		if (!in_interrupt()) yield();
+	}
+	return value;
+}
+
+// Begin a conversion without waiting.  The callback runs from the ADC
+// interrupt when the result is ready.  Safe to use from interrupts and
+// the main program at the same time, and with analogRead().  Returns 0
+// if the pin has no analog input or the ADC's queue is full.
+int analogReadStart(uint8_t pin, void (*callback)(uint8_t pin, int value))
+{
+	struct analog_request r;
+
+	if (!callback) return 0;
+	uint8_t ch = analog_pin_channel(pin);
+	if (ch == 255) return 0;
+	if (calibrating) wait_for_cal();
+	r.callback = callback;
+	r.result = 0;
+	r.pin = pin;
+	r.channel = ch & 0x7F;
+	return analog_enqueue((ch & 0x80) ? 1 : 0, &r);
+}
+
+// let queued conversions run again after analogReadPair()
+static void analog_unlock(void)
+{
+	uint32_t irq = analog_irq_save();
+	analog_queue[0].locked = 0;
+	analog_queue[1].locked = 0;
+	analog_start(0);
+	analog_start(1);
+	analog_irq_restore(irq);
+}
+
+// Measure 2 pins at the same moment, pinA by ADC1 and pinB by ADC2 (or
+// the other way if only ADC2 can measure pinA).  ADC_ETC's sync mode
+// starts both conversions from a single trigger, so the pair takes one
+// conversion time.  Returns 0 if the pins can't be read simultaneously.
+int analogReadPair(uint8_t pinA, uint8_t pinB, int *valA, int *valB)
+{
+	uint32_t cfg1, cfg2, done;
+	uint8_t ch1, ch2;
+
+	if (calibrating) wait_for_cal();
+	ch1 = analog_pin_channel(pinA);
+	ch2 = analog_pin_channel(pinB);
+	if (ch1 == 255 || ch2 == 255) return 0;
+	int swap = (ch1 & 0x80) ? 1 : 0;
+	if (swap) {
+		uint8_t tmp = ch1;
+		ch1 = ch2;
+		ch2 = tmp;
+	}
+	if (ch1 & 0x80) return 0; // neither pin can use ADC1
+	if (!analog_channel_on_adc2(ch2)) {
+		// pinB is ADC1 only, so it must take ADC1 if pinA can use ADC2
+		if (!analog_channel_on_adc2(ch1)) return 0;
+		uint8_t tmp = ch1;
+		ch1 = ch2;
+		ch2 = tmp;
+		swap ^= 1;
+	}
+	// wait for queued conversions to finish, then hold off new ones
+	while (1) {
+		uint32_t irq = analog_irq_save();
+		if (analog_queue[0].head == analog_queue[0].tail
+		  && analog_queue[1].head == analog_queue[1].tail) {
+			analog_queue[0].locked = 1;
+			analog_queue[1].locked = 1;
+			analog_irq_restore(irq);
+			break;
 		}
-		return ADC2_R0;
+		analog_irq_restore(irq);
+		analog_service(0);
+		analog_service(1);
+	}
+	cfg1 = ADC1_CFG;
+	cfg2 = ADC2_CFG;
+	if ((cfg1 | cfg2) & ADC_CFG_ADTRG) {
+		analog_unlock();
+		return 0; // busy with AnalogStream
 	}
+
+	// trigger 0 (ADC1) in sync mode also starts trigger 4 (ADC2)
+	ADC_ETC_CTRL &= ~ADC_ETC_CTRL_SOFTRST;
+	ADC_ETC_CTRL |= ADC_ETC_CTRL_TSC_BYPASS;
+	ADC_ETC_TRIG0_CHAIN_1_0 = ADC_ETC_TRIG_CHAIN_CSEL0(ch1) |
+		ADC_ETC_TRIG_CHAIN_HWTS0(1) | ADC_ETC_TRIG_CHAIN_IE0(1);
+	ADC_ETC_TRIG4_CHAIN_1_0 = ADC_ETC_TRIG_CHAIN_CSEL0(ch2 & 0x7F) |
+		ADC_ETC_TRIG_CHAIN_HWTS0(1) | ADC_ETC_TRIG_CHAIN_IE0(1);
+	ADC_ETC_TRIG0_CTRL = ADC_ETC_TRIG_CTRL_SYNC_MODE | ADC_ETC_TRIG_CTRL_TRIG_MODE;
+	ADC_ETC_TRIG4_CTRL = ADC_ETC_TRIG_CTRL_SYNC_MODE | ADC_ETC_TRIG_CTRL_TRIG_MODE;
+	done = ADC_ETC_DONE0_1_IRQ_TRIG_DONE0(0) | ADC_ETC_DONE0_1_IRQ_TRIG_DONE0(4);
+	ADC_ETC_DONE0_1_IRQ = done;
+	ADC1_CFG = cfg1 | ADC_CFG_ADTRG;
+	ADC2_CFG = cfg2 | ADC_CFG_ADTRG;
+	ADC1_HC0 = 16; // 16 = channel selected by ADC_ETC
+	ADC2_HC0 = 16;
+	ADC_ETC_TRIG0_CTRL |= ADC_ETC_TRIG_CTRL_SW_TRIG;
+	while ((ADC_ETC_DONE0_1_IRQ & done) != done) {
+		if (!in_interrupt()) yield(); // other requests wait in the queues
+	}
+	int v1 = ADC_ETC_TRIG0_RESULT_1_0 & 0xFFF;
+	int v2 = ADC_ETC_TRIG4_RESULT_1_0 & 0xFFF;
+	ADC_ETC_DONE0_1_IRQ = done;
+	ADC_ETC_TRIG0_CTRL = 0;
+	ADC_ETC_TRIG4_CTRL = 0;
+	ADC1_CFG = cfg1;
+	ADC2_CFG = cfg2;
+	(void)ADC1_R0; // clear COCO0 before queued requests resume
+	(void)ADC2_R0;
+	analog_unlock();
+	if (valA) *valA = swap ? v2 : v1;
+	if (valB) *valB = swap ? v1 : v2;
+	return 1;
 }
 
 void analogReference(uint8_t type)
@@ -103,6 +367,7 @@ void analogReadRes(unsigned int bits)
 {
   uint32_t tmp32, mode;
 
+  if (calibrating) wait_for_cal();
    if (bits == 8) {
     // 8 bit conversion (17 clocks) plus 8 clocks for input settling
     mode = ADC_CFG_MODE(0) | ADC_CFG_ADSTS(3);
@@ -132,7 +397,8 @@ void analogReadRes(unsigned int bits)
 void analogReadAveraging(unsigned int num)
 {
   uint32_t mode, mode1;
-  
+
+  if (calibrating) wait_for_cal();
   //disable averaging, ADC1 and ADC2
   ADC1_GC &= ~0x20;
   mode = ADC1_CFG & ~0xC000;
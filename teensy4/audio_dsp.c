@@ -0,0 +1,443 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2017 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "audio_dsp.h"
+#include <string.h>
+#include <math.h>
+
+// computes ((a[15:0] + b[15:0]) saturated, (a[31:16] + b[31:16]) saturated)
+static inline uint32_t qadd16(uint32_t a, uint32_t b) __attribute__((always_inline, unused));
+static inline uint32_t qadd16(uint32_t a, uint32_t b)
+{
+	uint32_t out;
+	asm volatile("qadd16 %0, %1, %2" : "=r" (out) : "r" (a), "r" (b));
+	return out;
+}
+
+// computes sum + a[15:0] * b[15:0] + a[31:16] * b[31:16]
+static inline int32_t smlad(uint32_t a, uint32_t b, int32_t sum) __attribute__((always_inline, unused));
+static inline int32_t smlad(uint32_t a, uint32_t b, int32_t sum)
+{
+	int32_t out;
+	asm volatile("smlad %0, %1, %2, %3" : "=r" (out) : "r" (a), "r" (b), "r" (sum));
+	return out;
+}
+
+// computes (a * b[15:0]) >> 16
+static inline int32_t smulwb(int32_t a, uint32_t b) __attribute__((always_inline, unused));
+static inline int32_t smulwb(int32_t a, uint32_t b)
+{
+	int32_t out;
+	asm volatile("smulwb %0, %1, %2" : "=r" (out) : "r" (a), "r" (b));
+	return out;
+}
+
+// computes (a * b[31:16]) >> 16
+static inline int32_t smulwt(int32_t a, uint32_t b) __attribute__((always_inline, unused));
+static inline int32_t smulwt(int32_t a, uint32_t b)
+{
+	int32_t out;
+	asm volatile("smulwt %0, %1, %2" : "=r" (out) : "r" (a), "r" (b));
+	return out;
+}
+
+// computes limit(val, 16 bits)
+static inline int32_t ssat16(int32_t val) __attribute__((always_inline, unused));
+static inline int32_t ssat16(int32_t val)
+{
+	int32_t out;
+	asm volatile("ssat %0, #16, %1" : "=r" (out) : "r" (val));
+	return out;
+}
+
+// packs the low 16 bits of a and b into one word
+static inline uint32_t pack16lo(uint32_t a, uint32_t b) __attribute__((always_inline, unused));
+static inline uint32_t pack16lo(uint32_t a, uint32_t b)
+{
+	uint32_t out;
+	asm volatile("pkhbt %0, %1, %2, lsl #16" : "=r" (out) : "r" (a), "r" (b));
+	return out;
+}
+
+// packs the high 16 bits of a and b into one word
+static inline uint32_t pack16hi(uint32_t a, uint32_t b) __attribute__((always_inline, unused));
+static inline uint32_t pack16hi(uint32_t a, uint32_t b)
+{
+	uint32_t out;
+	asm volatile("pkhtb %0, %1, %2, asr #16" : "=r" (out) : "r" (b), "r" (a));
+	return out;
+}
+
+#define IS_ALIGNED(p)  ((((uintptr_t)(p)) & 3) == 0)
+
+void audio_block_add(int16_t *dst, const int16_t *src, unsigned int len)
+{
+	if (IS_ALIGNED(dst) && IS_ALIGNED(src)) {
+		uint32_t *d = (uint32_t *)dst;
+		const uint32_t *s = (const uint32_t *)src;
+		for (; len >= 2; len -= 2) {
+			*d = qadd16(*d, *s++);
+			d++;
+		}
+		dst = (int16_t *)d;
+		src = (const int16_t *)s;
+	}
+	while (len-- > 0) {
+		*dst = ssat16(*dst + *src++);
+		dst++;
+	}
+}
+
+void audio_block_mix(int16_t *dst, const int16_t * const *src, unsigned int num, unsigned int len)
+{
+	unsigned int i;
+
+	if (num == 0) {
+		for (i=0; i < len; i++) dst[i] = 0;
+		return;
+	}
+	if (dst != src[0]) {
+		for (i=0; i < len; i++) dst[i] = src[0][i];
+	}
+	for (i=1; i < num; i++) {
+		audio_block_add(dst, src[i], len);
+	}
+}
+
+void audio_block_mix_gain(int16_t *dst, const int16_t * const *src, const int16_t *gain,
+	unsigned int num, unsigned int len)
+{
+	unsigned int i, n;
+	int32_t sum;
+
+	for (i=0; i < len; i++) {
+		sum = 0;
+		// 2 inputs per multiply-accumulate
+		for (n=0; n + 1 < num; n += 2) {
+			sum = smlad(pack16lo(src[n][i], src[n+1][i]),
+				pack16lo(gain[n], gain[n+1]), sum);
+		}
+		if (n < num) sum += src[n][i] * gain[n];
+		dst[i] = ssat16(sum >> 14);
+	}
+}
+
+void audio_block_gain(int16_t *data, int32_t gain, unsigned int len)
+{
+	if (gain == 65536) return;
+	if (IS_ALIGNED(data)) {
+		uint32_t *p = (uint32_t *)data;
+		for (; len >= 2; len -= 2) {
+			uint32_t in = *p;
+			int32_t lo = ssat16(smulwb(gain, in));
+			int32_t hi = ssat16(smulwt(gain, in));
+			*p++ = pack16lo(lo, hi);
+		}
+		data = (int16_t *)p;
+	}
+	while (len-- > 0) {
+		*data = ssat16(smulwb(gain, *data));
+		data++;
+	}
+}
+
+void audio_block_int16_to_float(float *dst, const int16_t *src, unsigned int len)
+{
+	while (len-- > 0) {
+		*dst++ = (float)*src++ * (1.0f / 32768.0f);
+	}
+}
+
+void audio_block_float_to_int16(int16_t *dst, const float *src, unsigned int len)
+{
+	while (len-- > 0) {
+		// float to int conversion saturates at 32 bits
+		*dst++ = ssat16((int32_t)(*src++ * 32768.0f));
+	}
+}
+
+void audio_block_interleave(uint32_t *dst, const int16_t *left, const int16_t *right, unsigned int len)
+{
+	if (IS_ALIGNED(left) && IS_ALIGNED(right)) {
+		const uint32_t *l = (const uint32_t *)left;
+		const uint32_t *r = (const uint32_t *)right;
+		for (; len >= 2; len -= 2) {
+			uint32_t a = *l++;
+			uint32_t b = *r++;
+			*dst++ = pack16lo(a, b);
+			*dst++ = pack16hi(a, b);
+		}
+		left = (const int16_t *)l;
+		right = (const int16_t *)r;
+	}
+	while (len-- > 0) {
+		*dst++ = pack16lo(*left++, *right++);
+	}
+}
+
+void audio_block_deinterleave(const uint32_t *src, int16_t *left, int16_t *right, unsigned int len)
+{
+	if (len > 0 && (((uintptr_t)left ^ (uintptr_t)right) & 3) == 0 && !IS_ALIGNED(left)) {
+		uint32_t n = *src++;
+		*left++ = n;
+		*right++ = n >> 16;
+		len--;
+	}
+	if (IS_ALIGNED(left) && IS_ALIGNED(right)) {
+		uint32_t *l = (uint32_t *)left;
+		uint32_t *r = (uint32_t *)right;
+		for (; len >= 2; len -= 2) {
+			uint32_t a = *src++;
+			uint32_t b = *src++;
+			*l++ = pack16lo(a, b);
+			*r++ = pack16hi(a, b);
+		}
+		left = (int16_t *)l;
+		right = (int16_t *)r;
+	}
+	while (len-- > 0) {
+		uint32_t n = *src++;
+		*left++ = n;
+		*right++ = n >> 16;
+	}
+}
+
+// one pair of channels from frames of "stride" 32 bit words
+static void deinterleave_pair(const uint32_t *src, unsigned int stride,
+	int16_t *a, int16_t *b, unsigned int len)
+{
+	if (IS_ALIGNED(a) && IS_ALIGNED(b)) {
+		uint32_t *pa = (uint32_t *)a;
+		uint32_t *pb = (uint32_t *)b;
+		for (; len >= 2; len -= 2) {
+			uint32_t n1 = *src;
+			uint32_t n2 = *(src + stride);
+			src += stride * 2;
+			*pa++ = pack16lo(n1, n2);
+			*pb++ = pack16hi(n1, n2);
+		}
+		a = (int16_t *)pa;
+		b = (int16_t *)pb;
+	}
+	while (len-- > 0) {
+		uint32_t n = *src;
+		src += stride;
+		*a++ = n;
+		*b++ = n >> 16;
+	}
+}
+
+static void interleave_pair(uint32_t *dst, unsigned int stride,
+	const int16_t *a, const int16_t *b, unsigned int len)
+{
+	if (IS_ALIGNED(a) && IS_ALIGNED(b)) {
+		const uint32_t *pa = (const uint32_t *)a;
+		const uint32_t *pb = (const uint32_t *)b;
+		for (; len >= 2; len -= 2) {
+			uint32_t n1 = *pa++;
+			uint32_t n2 = *pb++;
+			*dst = pack16lo(n1, n2);
+			*(dst + stride) = pack16hi(n1, n2);
+			dst += stride * 2;
+		}
+		a = (const int16_t *)pa;
+		b = (const int16_t *)pb;
+	}
+	while (len-- > 0) {
+		*dst = pack16lo(*a++, *b++);
+		dst += stride;
+	}
+}
+
+void audio_block_interleave16(int16_t *dst, const int16_t * const *src,
+	unsigned int channels, unsigned int len)
+{
+	unsigned int c = 0;
+	if (IS_ALIGNED(dst) && (channels & 1) == 0) {
+		// with an even number of channels, each pair is one word per frame
+		for (; c < channels; c += 2) {
+			interleave_pair((uint32_t *)(dst + c), channels / 2, src[c], src[c+1], len);
+		}
+		return;
+	}
+	for (; c < channels; c++) {
+		const int16_t *s = src[c];
+		int16_t *d = dst + c;
+		for (unsigned int i=0; i < len; i++) {
+			*d = *s++;
+			d += channels;
+		}
+	}
+}
+
+void audio_block_deinterleave16(const int16_t *src, int16_t * const *dst,
+	unsigned int channels, unsigned int len)
+{
+	unsigned int c = 0;
+	if (IS_ALIGNED(src) && (channels & 1) == 0) {
+		for (; c < channels; c += 2) {
+			deinterleave_pair((const uint32_t *)(src + c), channels / 2, dst[c], dst[c+1], len);
+		}
+		return;
+	}
+	for (; c < channels; c++) {
+		const int16_t *s = src + c;
+		int16_t *d = dst[c];
+		for (unsigned int i=0; i < len; i++) {
+			*d++ = *s;
+			s += channels;
+		}
+	}
+}
+
+void audio_block_interleave24(uint8_t *dst, const int16_t * const *src,
+	unsigned int channels, unsigned int len)
+{
+	if (channels == 2 && IS_ALIGNED(dst) && IS_ALIGNED(src[0]) && IS_ALIGNED(src[1])) {
+		// 2 stereo frames are 3 words: (0,L0,0) (R0,0,L1lo) (L1hi,0,R1)
+		const uint32_t *l = (const uint32_t *)src[0];
+		const uint32_t *r = (const uint32_t *)src[1];
+		uint32_t *d = (uint32_t *)dst;
+		for (; len >= 2; len -= 2) {
+			uint32_t a = *l++;
+			uint32_t b = *r++;
+			*d++ = (a & 0xFFFF) << 8;
+			*d++ = (b & 0xFFFF) | ((a & 0x00FF0000) << 8);
+			*d++ = (a >> 24) | (b & 0xFFFF0000);
+		}
+		if (len > 0) {
+			dst = (uint8_t *)d;
+			dst[0] = 0;
+			memcpy(dst + 1, l, 2);
+			dst[3] = 0;
+			memcpy(dst + 4, r, 2);
+		}
+		return;
+	}
+	for (unsigned int c=0; c < channels; c++) {
+		const int16_t *s = src[c];
+		uint8_t *d = dst + c * 3;
+		for (unsigned int i=0; i < len; i++) {
+			d[0] = 0;
+			memcpy(d + 1, s++, 2);
+			d += channels * 3;
+		}
+	}
+}
+
+void audio_block_deinterleave24(const uint8_t *src, int16_t * const *dst,
+	unsigned int channels, unsigned int len)
+{
+	if (channels == 2 && IS_ALIGNED(src) && IS_ALIGNED(dst[0]) && IS_ALIGNED(dst[1])) {
+		const uint32_t *s = (const uint32_t *)src;
+		uint32_t *l = (uint32_t *)dst[0];
+		uint32_t *r = (uint32_t *)dst[1];
+		for (; len >= 2; len -= 2) {
+			uint32_t a = *s++;
+			uint32_t b = *s++;
+			uint32_t c = *s++;
+			*l++ = pack16lo(a >> 8, (b >> 24) | (c << 8));
+			*r++ = pack16lo(b, c >> 16);
+		}
+		if (len > 0) {
+			memcpy(l, (const uint8_t *)s + 1, 2);
+			memcpy(r, (const uint8_t *)s + 4, 2);
+		}
+		return;
+	}
+	for (unsigned int c=0; c < channels; c++) {
+		const uint8_t *s = src + c * 3 + 1;
+		int16_t *d = dst[c];
+		for (unsigned int i=0; i < len; i++) {
+			memcpy(d++, s, 2);
+			s += channels * 3;
+		}
+	}
+}
+
+// Each row is one phase, with an extra row so phase + 1 always exists.
+// Rows are 32 bit aligned so taps load in pairs for smlad.
+static int16_t asrc_coef[AUDIO_ASRC_PHASES + 1][AUDIO_ASRC_TAPS] __attribute__ ((aligned(4)));
+static uint8_t asrc_coef_ready = 0;
+
+void audio_asrc_init(void)
+{
+	const float pi = 3.14159265358979f;
+	const float cutoff = 0.9f;  // fraction of the input Nyquist frequency
+	const float half = AUDIO_ASRC_TAPS / 2;
+
+	if (asrc_coef_ready) return;
+	for (int k=0; k <= AUDIO_ASRC_PHASES; k++) {
+		float h[AUDIO_ASRC_TAPS], sum = 0.0f;
+		for (int j=0; j < AUDIO_ASRC_TAPS; j++) {
+			float t = (half - 1.0f) + (float)k / AUDIO_ASRC_PHASES - (float)j;
+			float x = pi * cutoff * t;
+			float u = pi * t / half;
+			float w = 0.42f + 0.5f * cosf(u) + 0.08f * cosf(2.0f * u); // Blackman
+			h[j] = ((t == 0.0f) ? 1.0f : sinf(x) / x) * w;
+			sum += h[j];
+		}
+		// unity gain at DC for every phase
+		for (int j=0; j < AUDIO_ASRC_TAPS; j++) {
+			int32_t n = lrintf(h[j] * (32768.0f / sum));
+			asrc_coef[k][j] = (n > 32767) ? 32767 : n;
+		}
+	}
+	asrc_coef_ready = 1;
+}
+
+unsigned int audio_asrc_resample(int16_t *dst, const int16_t *src, unsigned int len,
+	uint32_t *position, uint32_t step)
+{
+	const int16_t *s = src;
+	uint32_t pos = *position;
+
+	if (!asrc_coef_ready) audio_asrc_init();
+	while (len-- > 0) {
+		unsigned int phase = pos >> (30 - 6);            // 64 phases
+		uint32_t frac = (pos >> (30 - 6 - 16)) & 0xFFFF; // between phases
+		const uint32_t *c0 = (const uint32_t *)asrc_coef[phase];
+		const uint32_t *c1 = (const uint32_t *)asrc_coef[phase + 1];
+		int32_t acc0 = 0, acc1 = 0;
+		for (int j=0; j < AUDIO_ASRC_TAPS/2; j++) {
+			uint32_t x;
+			memcpy(&x, s + j * 2, 4); // unaligned word load on Cortex-M7
+			acc0 = smlad(x, c0[j], acc0);
+			acc1 = smlad(x, c1[j], acc1);
+		}
+		int32_t out = acc0 + (int32_t)(((int64_t)(acc1 - acc0) * frac) >> 16);
+		*dst++ = ssat16((out + 16384) >> 15);
+		pos += step;
+		s += pos >> 30;
+		pos &= 0x3FFFFFFF;
+	}
+	*position = pos;
+	return s - src;
+}
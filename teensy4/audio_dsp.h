@@ -0,0 +1,93 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2017 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+// Block math for 16 bit audio samples, using the Cortex-M7 DSP extension
+// to process 2 samples per instruction when the buffers are 32 bit
+// aligned.  Unaligned buffers work, but are processed 1 sample at a time.
+// All integer results saturate to -32768 to 32767.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// dst = src[0] + src[1] + ... + src[num-1]
+void audio_block_mix(int16_t *dst, const int16_t * const *src, unsigned int num, unsigned int len);
+
+// dst = src[0] * gain[0] + ... + src[num-1] * gain[num-1]
+// gains are signed 2.14 fixed point: 16384 = 1.0, range -2.0 to 1.99994
+void audio_block_mix_gain(int16_t *dst, const int16_t * const *src, const int16_t *gain,
+	unsigned int num, unsigned int len);
+
+// data = data * gain, with gain signed 16.16 fixed point: 65536 = 1.0
+void audio_block_gain(int16_t *data, int32_t gain, unsigned int len);
+
+// dst = dst + src
+void audio_block_add(int16_t *dst, const int16_t *src, unsigned int len);
+
+// -32768 to 32767 to and from -1.0 to +1.0 (float input is clipped)
+void audio_block_int16_to_float(float *dst, const int16_t *src, unsigned int len);
+void audio_block_float_to_int16(int16_t *dst, const float *src, unsigned int len);
+
+// stereo samples as 32 bit words, left in the low 16 bits
+void audio_block_interleave(uint32_t *dst, const int16_t *left, const int16_t *right, unsigned int len);
+void audio_block_deinterleave(const uint32_t *src, int16_t *left, int16_t *right, unsigned int len);
+// multichannel frames, each channel's samples in its own block.  16 bit
+// samples, or 24 bit packed with 3 bytes per sample.  Conversion from 24
+// bits keeps the upper 16 bits and conversion to 24 bits zero fills.
+void audio_block_interleave16(int16_t *dst, const int16_t * const *src,
+	unsigned int channels, unsigned int len);
+void audio_block_deinterleave16(const int16_t *src, int16_t * const *dst,
+	unsigned int channels, unsigned int len);
+void audio_block_interleave24(uint8_t *dst, const int16_t * const *src,
+	unsigned int channels, unsigned int len);
+void audio_block_deinterleave24(const uint8_t *src, int16_t * const *dst,
+	unsigned int channels, unsigned int len);
+
+// Asynchronous sample rate conversion, by a 16 tap windowed sinc filter
+// with 64 phases, linearly interpolated between adjacent phases.  Position
+// and step are 2.30 fixed point, in input samples.  Each call writes len
+// output samples from src[0] onward, adds len * step to *position and
+// returns the whole input samples consumed, leaving *position below 1.0.
+// src must hold at least (len * step + AUDIO_ASRC_TAPS) samples.  Output
+// is delayed by AUDIO_ASRC_TAPS/2 - 1 input samples.  The coefficient
+// table is built on first use, or in advance by audio_asrc_init().
+#define AUDIO_ASRC_TAPS		16
+#define AUDIO_ASRC_PHASES	64
+void audio_asrc_init(void);
+unsigned int audio_asrc_resample(int16_t *dst, const int16_t *src, unsigned int len,
+	uint32_t *position, uint32_t step);
+
+#ifdef __cplusplus
+}
+#endif
@@ -405,6 +405,28 @@ public:
 		val = LPSPI4_RDR & 255;
 		return val;
 	}
+	// Send and receive a block of bytes, keeping up to 16 bytes in the
+	// LPSPI FIFOs rather than waiting for SPIF after every byte.  Use in
+	// place of a loop of SPDR writes, SPIF polls and SPDR reads in code
+	// ported from AVR.  tx may be NULL to send 0xFF, rx NULL to discard.
+	static void transfer(const void *tx, void *rx, uint32_t len) {
+		const uint8_t *p = (const uint8_t *)tx;
+		uint8_t *q = (uint8_t *)rx;
+		uint32_t sent = 0, received = 0;
+		LPSPI4_CR = LPSPI_CR_RRF | LPSPI_CR_MEN;	// clear the receive
+		while (received < len) {
+			// never more in flight than the receive FIFO holds
+			if (sent < len && sent - received < 16) {
+				LPSPI4_TDR = p ? p[sent] : 0xFF;
+				sent++;
+			}
+			if (!(LPSPI4_RSR & LPSPI_RSR_RXEMPTY)) {
+				uint8_t val = LPSPI4_RDR;
+				if (q) q[received] = val;
+				received++;
+			}
+		}
+	}
 };
 extern SPDRemulation SPDR;
 
@@ -47,6 +47,15 @@ void eeprom_write_word(uint16_t *addr, uint16_t value);
 void eeprom_write_dword(uint32_t *addr, uint32_t value);
 void eeprom_write_block(const void *buf, void *addr, uint32_t len);
 int eeprom_is_ready(void);
+// A write which finds a sector's log full must wait for that sector to be
+// erased and compacted.  Calling eeprom_compact_idle() when the program
+// has time to spare compacts nearly full sectors ahead of time, one per
+// call, so writes almost never wait.  Returns 1 if it compacted a sector.
+int eeprom_compact_idle(void);
+// Wear statistics.  Erase counts are kept in RAM, so they only count
+// erases since startup, not over the life of the flash.
+uint32_t eeprom_sector_erases_since_startup(uint32_t sector);
+uint32_t eeprom_sector_used(uint32_t sector);
 #define eeprom_busy_wait() do {} while (!eeprom_is_ready())
 
 /*
@@ -105,6 +114,8 @@ static inline char * itoa(int val, char *buf, int radix) { return ltoa(val, buf,
 #endif
 
 char * dtostrf(float val, int width, unsigned int precision, char *buf);
+// same result as strtof(), with a fast path for typical decimal numbers
+float strtof_fast(const char *str, char **endptr);
 
 
 #ifdef __cplusplus
@@ -0,0 +1,55 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+#include "WProgram.h"
+
+// Core benchmarks, built with "make bench" in place of main.cpp.  Each
+// result is printed to USB Serial as CPU cycles per operation, and as
+// MByte/sec when a number of bytes is given.  These measure the core
+// library code running on real hardware, so results are only comparable
+// between builds run at the same F_CPU on the same board.
+
+// Run "statement" count times and report the average cycles
+#define BENCH(name, count, bytes, statement) do { \
+	uint32_t bench_count = (count); \
+	uint32_t bench_begin = ARM_DWT_CYCCNT; \
+	for (uint32_t bench_n=0; bench_n < bench_count; bench_n++) { statement; } \
+	bench_report((name), ARM_DWT_CYCCNT - bench_begin, bench_count, (bytes)); \
+} while (0)
+
+// bytes is the total for all count operations, or zero
+void bench_report(const char *name, uint32_t cycles, uint32_t count, uint32_t bytes);
+
+void bench_memory(void);
+void bench_usb_serial(void);
+void bench_hardware_serial(void);
+void bench_print(void);
+void bench_audio(void);
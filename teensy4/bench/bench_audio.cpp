@@ -0,0 +1,96 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifdef TEENSY_CORE_BENCH
+
+#include "bench.h"
+#include "AudioStream.h"
+
+void software_isr(void);
+
+// Smallest possible objects, so the timing is the AudioStream overhead
+// of allocating, transmitting, receiving and releasing blocks.
+class BenchAudioSource : public AudioStream
+{
+public:
+	BenchAudioSource() : AudioStream(0, NULL) { }
+	virtual void update(void) {
+		audio_block_t *block = allocate();
+		if (!block) return;
+		transmit(block);
+		release(block);
+	}
+};
+
+class BenchAudioPass : public AudioStream
+{
+public:
+	BenchAudioPass() : AudioStream(1, inputQueueArray) { }
+	virtual void update(void) {
+		audio_block_t *block = receiveWritable();
+		if (!block) return;
+		transmit(block);
+		release(block);
+	}
+private:
+	audio_block_t *inputQueueArray[1];
+};
+
+class BenchAudioSink : public AudioStream
+{
+public:
+	BenchAudioSink() : AudioStream(1, inputQueueArray) { }
+	virtual void update(void) {
+		audio_block_t *block = receiveReadOnly();
+		if (block) release(block);
+	}
+private:
+	audio_block_t *inputQueueArray[1];
+};
+
+static BenchAudioSource source;
+static BenchAudioPass pass1;
+static BenchAudioPass pass2;
+static BenchAudioSink sink;
+static AudioConnection patch1(source, pass1);
+static AudioConnection patch2(pass1, pass2);
+static AudioConnection patch3(pass2, sink);
+
+void bench_audio(void)
+{
+	AudioMemory(8);
+	Serial.println("AudioStream, 4 objects in a chain:");
+	// software_isr is the same code update_all runs each block period,
+	// called directly so no audio hardware is needed
+	BENCH("update all objects", 1000, 0, software_isr());
+	Serial.println();
+}
+
+#endif // TEENSY_CORE_BENCH
@@ -0,0 +1,70 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// The Arduino IDE compiles every file in the core, so the benchmarks are
+// only built when "make bench" defines TEENSY_CORE_BENCH.
+#ifdef TEENSY_CORE_BENCH
+
+#include "bench.h"
+
+void bench_report(const char *name, uint32_t cycles, uint32_t count, uint32_t bytes)
+{
+	Serial.printf("%-32s %10lu cycles", name, (count > 0) ? cycles / count : cycles);
+	if (bytes > 0 && cycles > 0) {
+		float mbytes = (float)bytes * (float)F_CPU_ACTUAL / (float)cycles / 1.0e6f;
+		Serial.printf("  %8.2f MByte/sec", mbytes);
+	}
+	Serial.println();
+}
+
+extern "C" int main(void)
+{
+	pinMode(13, OUTPUT);
+	while (!Serial && millis() < 5000) ;
+	Serial.println();
+	Serial.printf("Teensy core benchmarks, F_CPU = %lu\n", F_CPU_ACTUAL);
+	Serial.println("all results are CPU cycles per operation");
+	Serial.println();
+	bench_memory();
+	bench_print();
+	bench_audio();
+	bench_hardware_serial();
+	bench_usb_serial();
+	Serial.println();
+	Serial.println("done");
+	while (1) {
+		digitalWriteFast(13, HIGH);
+		delay(100);
+		digitalWriteFast(13, LOW);
+		delay(900);
+	}
+}
+
+#endif // TEENSY_CORE_BENCH
@@ -0,0 +1,125 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifdef TEENSY_CORE_BENCH
+
+#include "bench.h"
+#include <string.h>
+#include "smalloc.h"
+
+extern "C" uint8_t external_psram_size;
+
+#define BENCH_MEM_SIZE  4096
+
+static uint32_t dtcm_src[BENCH_MEM_SIZE/4];
+static uint32_t dtcm_dst[BENCH_MEM_SIZE/4];
+DMAMEM static uint32_t ocram_src[BENCH_MEM_SIZE/4] __attribute__ ((aligned(32)));
+DMAMEM static uint32_t ocram_dst[BENCH_MEM_SIZE/4] __attribute__ ((aligned(32)));
+
+static void bench_memcpy(const char *name, void *dst, const void *src, uint32_t count)
+{
+	// first copy brings the buffers into cache, so only steady state is timed
+	memcpy(dst, src, BENCH_MEM_SIZE);
+	BENCH(name, count, BENCH_MEM_SIZE * count, memcpy(dst, src, BENCH_MEM_SIZE));
+}
+
+static void bench_memset(const char *name, void *dst, uint32_t count)
+{
+	memset(dst, 0, BENCH_MEM_SIZE);
+	BENCH(name, count, BENCH_MEM_SIZE * count, memset(dst, 0x55, BENCH_MEM_SIZE));
+}
+
+// smalloc searches every block ahead of a free one, so its cost depends on
+// how many blocks are allocated.  With 32 small blocks kept allocated,
+// freeing every other one, time allocation at each validation level.
+static void bench_smalloc_validation(const char *name, struct smalloc_pool *pool)
+{
+	static const char * const levels[] = {"full", "sample", "none"};
+	void *live[32];
+	char str[64];
+
+	int saved = pool->validate;
+	for (int i=0; i < 32; i++) live[i] = sm_malloc_pool(pool, 200 + i * 8);
+	for (int i=0; i < 32; i += 2) {
+		sm_free_pool(pool, live[i]);
+		live[i] = NULL;
+	}
+	for (int level=SMALLOC_VALIDATE_FULL; level <= SMALLOC_VALIDATE_NONE; level++) {
+		sm_set_validation(pool, level);
+		snprintf(str, sizeof(str), "%s 64 bytes, %s validation", name, levels[level]);
+		BENCH(str, 1000, 0, sm_free_pool(pool, sm_malloc_pool(pool, 64)));
+		snprintf(str, sizeof(str), "%s 1024 bytes, %s validation", name, levels[level]);
+		BENCH(str, 1000, 0, sm_free_pool(pool, sm_malloc_pool(pool, 1024)));
+	}
+	sm_set_validation(pool, saved);
+	for (int i=1; i < 32; i += 2) sm_free_pool(pool, live[i]);
+}
+
+void bench_memory(void)
+{
+	Serial.println("Memory, 4096 byte blocks:");
+	bench_memcpy("memcpy DTCM to DTCM", dtcm_dst, dtcm_src, 100);
+	bench_memcpy("memcpy DMAMEM to DMAMEM", ocram_dst, ocram_src, 100);
+	bench_memcpy("memcpy DTCM to DMAMEM", ocram_dst, dtcm_src, 100);
+	bench_memcpy("memcpy DMAMEM to DTCM", dtcm_dst, ocram_src, 100);
+	bench_memset("memset DTCM", dtcm_dst, 100);
+	bench_memset("memset DMAMEM", ocram_dst, 100);
+	if (external_psram_size > 0) {
+		// larger than the 32K data cache, so every pass reaches the PSRAM
+		const uint32_t len = 65536;
+		uint8_t *ext_src = (uint8_t *)extmem_malloc(len);
+		uint8_t *ext_dst = (uint8_t *)extmem_malloc(len);
+		if (ext_src && ext_dst) {
+			BENCH("memcpy EXTMEM to EXTMEM 64K", 10, len * 10, memcpy(ext_dst, ext_src, len));
+			BENCH("memcpy DTCM to EXTMEM", 10, BENCH_MEM_SIZE * 10,
+				memcpy(ext_dst + bench_n * BENCH_MEM_SIZE, dtcm_src, BENCH_MEM_SIZE));
+			BENCH("memcpy EXTMEM to DTCM", 10, BENCH_MEM_SIZE * 10,
+				memcpy(dtcm_dst, ext_src + bench_n * BENCH_MEM_SIZE, BENCH_MEM_SIZE));
+			BENCH("memset EXTMEM 64K", 10, len * 10, memset(ext_dst, 0x55, len));
+		}
+		extmem_free(ext_dst);
+		extmem_free(ext_src);
+	} else {
+		Serial.println("  no PSRAM, EXTMEM skipped");
+	}
+	Serial.println();
+
+	Serial.println("Allocation, malloc + free:");
+	BENCH("malloc 64 bytes", 1000, 0, free(malloc(64)));
+	BENCH("malloc 4096 bytes", 1000, 0, free(malloc(4096)));
+	if (external_psram_size > 0) {
+		BENCH("extmem_malloc 64 bytes", 1000, 0, extmem_free(extmem_malloc(64)));
+		BENCH("extmem_malloc 4096 bytes", 1000, 0, extmem_free(extmem_malloc(4096)));
+		bench_smalloc_validation("EXTMEM", &extmem_smalloc_pool);
+	}
+	Serial.println();
+}
+
+#endif // TEENSY_CORE_BENCH
@@ -0,0 +1,66 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifdef TEENSY_CORE_BENCH
+
+#include "bench.h"
+
+// Print writes into this, so only formatting is measured
+class BenchNullPrint : public Print
+{
+public:
+	virtual size_t write(uint8_t b) { return 1; }
+	virtual size_t write(const uint8_t *buffer, size_t size) { return size; }
+};
+
+void bench_print(void)
+{
+	BenchNullPrint out;
+	volatile int32_t num = -1234567;
+	volatile float f = 3.14159f;
+	String str("Teensy");
+
+	Serial.println("Print formatting:");
+	BENCH("print(const char *)", 1000, 0, out.print("Hello World"));
+	BENCH("print(int)", 1000, 0, out.print(num));
+	BENCH("print(int, HEX)", 1000, 0, out.print(num, HEX));
+	BENCH("print(float)", 1000, 0, out.print(f));
+	BENCH("print(String)", 1000, 0, out.print(str));
+	BENCH("printf(\"%d %s\")", 1000, 0, out.printf("%d %s", (int)num, "abc"));
+	BENCH("printf(\"%.3f\")", 1000, 0, out.printf("%.3f", (double)f));
+	Serial.println();
+
+	Serial.println("Scheduling:");
+	BENCH("yield()", 10000, 0, yield());
+	BENCH("micros()", 10000, 0, micros());
+	Serial.println();
+}
+
+#endif // TEENSY_CORE_BENCH
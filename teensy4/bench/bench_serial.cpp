@@ -0,0 +1,74 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifdef TEENSY_CORE_BENCH
+
+#include "bench.h"
+
+#define BENCH_BAUD  6000000
+
+static uint8_t serial_buffer[1024];
+
+// Connect pin 0 to pin 1 to also measure receive.  Without the loopback
+// only the transmit results are meaningful.
+void bench_hardware_serial(void)
+{
+	Serial.printf("HardwareSerial, Serial1 at %lu baud:\n", (uint32_t)BENCH_BAUD);
+	Serial1.begin(BENCH_BAUD);
+	Serial1.addMemoryForWrite(serial_buffer, sizeof(serial_buffer));
+	Serial1.flush();
+	while (Serial1.available()) Serial1.read();
+
+	// buffer has room, so these measure only the software path
+	BENCH("Serial1.write 1 byte", 64, 0, Serial1.write('U'));
+	Serial1.flush();
+
+	// transmitting the whole buffer is limited by the baud rate
+	const uint32_t len = 1024;
+	uint32_t begin = ARM_DWT_CYCCNT;
+	for (uint32_t i=0; i < len; i++) Serial1.write('U');
+	Serial1.flush();
+	uint32_t cycles = ARM_DWT_CYCCNT - begin;
+	bench_report("Serial1 transmit 1024 bytes", cycles, 1, len);
+	Serial.printf("  %.2f MByte/sec is full speed\n", (float)BENCH_BAUD / 10.0e6f);
+
+	delay(2);
+	uint32_t received = Serial1.available();
+	if (received > 0) {
+		BENCH("Serial1.read", received, 0, Serial1.read());
+		Serial.printf("  %lu of %lu bytes received\n", received, len);
+	} else {
+		Serial.println("  pin 0 not connected to pin 1, receive skipped");
+	}
+	Serial1.end();
+	Serial.println();
+}
+
+#endif // TEENSY_CORE_BENCH
@@ -0,0 +1,77 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifdef TEENSY_CORE_BENCH
+
+#include "bench.h"
+
+static uint8_t usb_buffer[512];
+
+void bench_usb_serial(void)
+{
+	Serial.println("USB Serial:");
+	Serial.flush();
+	// transmit speed depends on the PC reading quickly, so use a program
+	// which doesn't render every byte, not the Arduino Serial Monitor
+	memset(usb_buffer, '.', sizeof(usb_buffer));
+	usb_buffer[sizeof(usb_buffer) - 1] = '\n';
+	BENCH("Serial.write 512 bytes", 512, 512 * 512,
+		Serial.write(usb_buffer, sizeof(usb_buffer)));
+	BENCH("Serial.write 1 byte", 1000, 1000, Serial.write('.'));
+	Serial.println();
+	Serial.flush();
+
+	Serial.println("Send data now to measure USB receive speed (10 sec timeout)");
+	while (Serial.available()) Serial.read();
+	elapsedMillis wait;
+	while (!Serial.available()) {
+		if (wait > 10000) {
+			Serial.println("  no data, USB receive skipped");
+			return;
+		}
+	}
+	uint32_t bytes = 0;
+	uint32_t begin = ARM_DWT_CYCCNT;
+	uint32_t end = begin;
+	elapsedMillis idle;
+	while (idle < 250 && bytes < 16777216) {
+		int n = Serial.available();
+		if (n > 0) {
+			if (n > (int)sizeof(usb_buffer)) n = sizeof(usb_buffer);
+			bytes += Serial.readBytes((char *)usb_buffer, n);
+			end = ARM_DWT_CYCCNT;
+			idle = 0;
+		}
+	}
+	bench_report("Serial.read", end - begin, 0, bytes);
+	Serial.printf("  %lu bytes received\n", bytes);
+}
+
+#endif // TEENSY_CORE_BENCH
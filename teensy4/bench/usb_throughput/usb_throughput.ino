@@ -0,0 +1,151 @@
+// USB throughput test, used with usb_throughput.py running on the PC.
+// Select Tools > USB Type as Serial, Raw HID or MIDI before uploading.
+// The PC script sends commands, and measures speed and latency from its
+// side, so the only job here is moving data as fast as possible and
+// checking the sequence of what arrives.
+//
+//   T <count>   send count units (bytes, reports or messages) to the PC
+//   R <count>   receive count units from the PC, then reply with errors
+//   P           reply immediately, for round trip latency
+//
+// This example code is in the public domain.
+
+#if defined(USB_SERIAL) || defined(USB_DUAL_SERIAL) || defined(USB_TRIPLE_SERIAL)
+
+// Serial: commands are lines of text, data is bytes 0 to 255 repeating
+static uint8_t buffer[4096];
+
+void setup() {
+  for (unsigned int i=0; i < sizeof(buffer); i++) buffer[i] = i;
+}
+
+void loop() {
+  if (!Serial.available()) return;
+  char line[32];
+  size_t n = Serial.readBytesUntil('\n', line, sizeof(line) - 1);
+  line[n] = 0;
+  uint32_t count = strtoul(line + 1, NULL, 10);
+  if (line[0] == 'T') {
+    // buffer size is a multiple of 256, so the pattern continues
+    while (count > 0) {
+      uint32_t len = min(count, sizeof(buffer));
+      Serial.write(buffer, len);
+      count -= len;
+    }
+    Serial.send_now();
+  } else if (line[0] == 'R') {
+    uint32_t received = 0, errors = 0;
+    uint8_t expect = 0;
+    elapsedMillis idle;
+    while (received < count && idle < 1000) {
+      int avail = Serial.available();
+      if (avail > 0) {
+        uint32_t len = min((uint32_t)avail, min(count - received, sizeof(buffer)));
+        len = Serial.readBytes((char *)buffer, len);
+        for (uint32_t i=0; i < len; i++) {
+          if (buffer[i] != expect) errors++;
+          expect = buffer[i] + 1;
+        }
+        received += len;
+        idle = 0;
+      }
+    }
+    errors += count - received;
+    for (unsigned int i=0; i < sizeof(buffer); i++) buffer[i] = i;
+    Serial.printf("OK %lu\n", errors);
+  } else if (line[0] == 'P') {
+    Serial.write('P');
+    Serial.send_now();
+  }
+}
+
+#elif defined(USB_RAWHID)
+
+// Raw HID: byte 0 of a command report is the command, bytes 4-7 the count.
+// Data reports begin with a 32 bit sequence number.
+static uint8_t report[RAWHID_TX_SIZE];
+
+void setup() {
+}
+
+void loop() {
+  if (RawHID.recv(report, 0) <= 0) return;
+  uint8_t cmd = report[0];
+  uint32_t count;
+  memcpy(&count, report + 4, 4);
+  if (cmd == 'T') {
+    for (uint32_t seq=0; seq < count; seq++) {
+      memcpy(report, &seq, 4);
+      if (RawHID.send(report, 100) <= 0) break;
+    }
+  } else if (cmd == 'R') {
+    uint32_t errors = 0;
+    for (uint32_t seq=0; seq < count; seq++) {
+      uint32_t n;
+      if (RawHID.recv(report, 1000) <= 0) {
+        errors += count - seq;
+        break;
+      }
+      memcpy(&n, report, 4);
+      if (n != seq) errors++;
+    }
+    memset(report, 0, sizeof(report));
+    report[0] = 'S';
+    memcpy(report + 4, &errors, 4);
+    RawHID.send(report, 100);
+  } else if (cmd == 'P') {
+    RawHID.send(report, 100);
+  }
+}
+
+#elif defined(USB_MIDI) || defined(USB_MIDI4) || defined(USB_MIDI16)
+
+// MIDI: commands are SysEx F0 7D <cmd> <count as four 7 bit bytes> F7.
+// Data is Note On messages carrying an 18 bit sequence number in the
+// note, velocity and channel.
+static void sendReply(uint8_t cmd, uint32_t n) {
+  uint8_t sysex[8] = {0xF0, 0x7D, cmd, (uint8_t)(n & 127), (uint8_t)((n >> 7) & 127),
+    (uint8_t)((n >> 14) & 127), (uint8_t)((n >> 21) & 127), 0xF7};
+  usbMIDI.sendSysEx(sizeof(sysex), sysex, true);
+  usbMIDI.send_now();
+}
+
+void setup() {
+}
+
+void loop() {
+  if (!usbMIDI.read()) return;
+  if (usbMIDI.getType() != usbMIDI.SystemExclusive) return;
+  if (usbMIDI.getSysExArrayLength() < 8) return;
+  const uint8_t *sysex = usbMIDI.getSysExArray();
+  if (sysex[1] != 0x7D) return;
+  uint8_t cmd = sysex[2];
+  uint32_t count = sysex[3] | (sysex[4] << 7) | (sysex[5] << 14) | (sysex[6] << 21);
+  if (cmd == 'T') {
+    for (uint32_t seq=0; seq < count; seq++) {
+      usbMIDI.sendNoteOn(seq & 127, (seq >> 7) & 127, ((seq >> 14) & 15) + 1);
+    }
+    usbMIDI.send_now();
+  } else if (cmd == 'R') {
+    uint32_t seq = 0, errors = 0;
+    elapsedMillis idle;
+    while (seq < count && idle < 1000) {
+      if (!usbMIDI.read()) continue;
+      // Note On with zero velocity is read as Note Off
+      uint8_t type = usbMIDI.getType();
+      if (type != usbMIDI.NoteOn && type != usbMIDI.NoteOff) continue;
+      uint32_t n = usbMIDI.getData1() | (usbMIDI.getData2() << 7)
+        | ((usbMIDI.getChannel() - 1) << 14);
+      if (n != (seq & 0x3FFFF)) errors++;
+      seq++;
+      idle = 0;
+    }
+    sendReply('S', errors + (count - seq));
+  } else if (cmd == 'P') {
+    sendReply('P', 0);
+  }
+}
+
+#else
+#error "Select Serial, Raw HID or MIDI from the Tools > USB Type menu"
+#endif
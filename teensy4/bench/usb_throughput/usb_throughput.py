@@ -0,0 +1,227 @@
+#!/usr/bin/env python3
+# USB throughput test, for use with usb_throughput.ino running on Teensy.
+#
+#   python3 usb_throughput.py serial /dev/ttyACM0
+#   python3 usb_throughput.py rawhid
+#   python3 usb_throughput.py midi "Teensy MIDI"
+#
+# Measures transmit and receive speed, round trip latency percentiles and
+# sequence errors, and compares speed against the USB bit rate: 480 Mbit/sec
+# for Teensy 4.x, or use --mbit 12 for Teensy 3.x and LC.
+#
+# Needs pyserial, hidapi or mido + python-rtmidi, depending on USB type.
+#
+# This example code is in the public domain.
+
+import argparse
+import struct
+import sys
+import time
+
+RAWHID_VID = 0x16C0
+RAWHID_PID = 0x0486
+RAWHID_USAGE_PAGE = 0xFFAB
+
+
+def percentile(sorted_values, p):
+    if not sorted_values:
+        return 0.0
+    i = min(len(sorted_values) - 1, int(round(p / 100.0 * (len(sorted_values) - 1))))
+    return sorted_values[i]
+
+
+def report(name, nbytes, seconds, errors, mbit):
+    mbytes = nbytes / seconds / 1e6 if seconds > 0 else 0.0
+    percent = mbytes * 8 / mbit * 100
+    print("%-10s %10d bytes %8.3f sec %8.3f MByte/sec  %5.1f%% of %g Mbit  %d errors"
+          % (name, nbytes, seconds, mbytes, percent, mbit, errors))
+
+
+def latency(name, ping, count):
+    times = []
+    for _ in range(count):
+        begin = time.perf_counter()
+        ping()
+        times.append((time.perf_counter() - begin) * 1e6)
+    times.sort()
+    print("%-10s round trip usec: min %.0f  50%% %.0f  90%% %.0f  99%% %.0f  max %.0f"
+          % (name, times[0], percentile(times, 50), percentile(times, 90),
+             percentile(times, 99), times[-1]))
+
+
+def test_serial(args):
+    import serial
+    port = serial.Serial(args.device, timeout=2)
+    port.reset_input_buffer()
+    count = args.bytes
+
+    port.write(b"T %d\n" % count)
+    received = 0
+    errors = 0
+    expect = 0
+    begin = None
+    while received < count:
+        data = port.read(min(65536, count - received))
+        if not data:
+            break
+        if begin is None:
+            begin = time.perf_counter()
+        for b in data:
+            if b != expect:
+                errors += 1
+            expect = (b + 1) & 255
+        received += len(data)
+    end = time.perf_counter()
+    errors += count - received
+    report("transmit", received, end - (begin or end), errors, args.mbit)
+
+    pattern = bytes(range(256)) * 256
+    port.write(b"R %d\n" % count)
+    begin = time.perf_counter()
+    sent = 0
+    while sent < count:
+        n = min(len(pattern), count - sent)
+        port.write(pattern[:n])
+        sent += n
+    line = port.readline()
+    end = time.perf_counter()
+    try:
+        errors = int(line.split()[1])
+    except (IndexError, ValueError):
+        errors = count
+    report("receive", sent, end - begin, errors, args.mbit)
+
+    def ping():
+        port.write(b"P\n")
+        port.read(1)
+    latency("latency", ping, args.pings)
+
+
+def test_rawhid(args):
+    import hid
+    path = None
+    for d in hid.enumerate(RAWHID_VID, RAWHID_PID):
+        if d["usage_page"] == RAWHID_USAGE_PAGE:
+            path = d["path"]
+    if path is None:
+        sys.exit("Teensy Raw HID not found")
+    dev = hid.device()
+    dev.open_path(path)
+    size = args.report_size
+    count = max(1, args.bytes // size)
+
+    def command(cmd, n):
+        # first byte is the report ID, which Raw HID doesn't use
+        dev.write(b"\x00" + struct.pack("<BxxxI", ord(cmd), n) + bytes(size - 8))
+
+    command("T", count)
+    errors = 0
+    received = 0
+    begin = None
+    for seq in range(count):
+        data = dev.read(size, 2000)
+        if not data:
+            break
+        if begin is None:
+            begin = time.perf_counter()
+        if struct.unpack_from("<I", bytes(data))[0] != seq:
+            errors += 1
+        received += 1
+    end = time.perf_counter()
+    errors += count - received
+    report("transmit", received * size, end - (begin or end), errors, args.mbit)
+
+    command("R", count)
+    begin = time.perf_counter()
+    filler = bytes(size - 4)
+    for seq in range(count):
+        dev.write(b"\x00" + struct.pack("<I", seq) + filler)
+    reply = dev.read(size, 2000)
+    end = time.perf_counter()
+    errors = struct.unpack_from("<I", bytes(reply), 4)[0] if reply else count
+    report("receive", count * size, end - begin, errors, args.mbit)
+
+    def ping():
+        command("P", 0)
+        dev.read(size, 1000)
+    latency("latency", ping, args.pings)
+
+
+def test_midi(args):
+    import mido
+    name = next((n for n in mido.get_input_names() if args.device in n), None)
+    if name is None:
+        sys.exit("MIDI port matching \"%s\" not found" % args.device)
+    inport = mido.open_input(name)
+    outport = mido.open_output(next(n for n in mido.get_output_names() if args.device in n))
+    # each MIDI message is one 4 byte USB-MIDI event
+    count = max(1, args.bytes // 4)
+
+    def command(cmd, n):
+        outport.send(mido.Message("sysex", data=[0x7D, ord(cmd), n & 127, (n >> 7) & 127,
+                                                 (n >> 14) & 127, (n >> 21) & 127]))
+
+    def reply(cmd, timeout):
+        limit = time.perf_counter() + timeout
+        while time.perf_counter() < limit:
+            for msg in inport.iter_pending():
+                if msg.type == "sysex" and len(msg.data) >= 6 and msg.data[1] == ord(cmd):
+                    d = msg.data
+                    return d[2] | (d[3] << 7) | (d[4] << 14) | (d[5] << 21)
+        return None
+
+    for _ in inport.iter_pending():
+        pass
+    command("T", count)
+    errors = 0
+    received = 0
+    begin = None
+    limit = time.perf_counter() + 5
+    while received < count and time.perf_counter() < limit:
+        for msg in inport.iter_pending():
+            if msg.type not in ("note_on", "note_off"):
+                continue
+            if begin is None:
+                begin = time.perf_counter()
+            n = msg.note | (msg.velocity << 7) | (msg.channel << 14)
+            if n != (received & 0x3FFFF):
+                errors += 1
+            received += 1
+            limit = time.perf_counter() + 1
+    end = time.perf_counter()
+    errors += count - received
+    report("transmit", received * 4, end - (begin or end), errors, args.mbit)
+
+    command("R", count)
+    begin = time.perf_counter()
+    for seq in range(count):
+        outport.send(mido.Message("note_on", note=seq & 127, velocity=(seq >> 7) & 127,
+                                  channel=(seq >> 14) & 15))
+    errors = reply("S", 5)
+    end = time.perf_counter()
+    report("receive", count * 4, end - begin, count if errors is None else errors, args.mbit)
+
+    latency("latency", lambda: (command("P", 0), reply("P", 1)), args.pings)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Teensy USB throughput test")
+    parser.add_argument("type", choices=["serial", "rawhid", "midi"])
+    parser.add_argument("device", nargs="?", default="Teensy",
+                        help="serial port, or part of the MIDI port name")
+    parser.add_argument("--bytes", type=int, default=16 * 1024 * 1024,
+                        help="amount of data each direction (default 16M)")
+    parser.add_argument("--pings", type=int, default=1000,
+                        help="round trips for latency (default 1000)")
+    parser.add_argument("--mbit", type=float, default=480,
+                        help="USB bit rate, 480 or 12 (default 480)")
+    parser.add_argument("--report-size", type=int, default=64,
+                        help="RAWHID_TX_SIZE in usb_desc.h (default 64)")
+    args = parser.parse_args()
+    if args.type == "midi" and args.bytes == parser.get_default("bytes"):
+        args.bytes = 256 * 1024
+    {"serial": test_serial, "rawhid": test_rawhid, "midi": test_midi}[args.type](args)
+
+
+if __name__ == "__main__":
+    main()
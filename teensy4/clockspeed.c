@@ -19,6 +19,11 @@ volatile uint32_t F_BUS_ACTUAL = 132000000;
 
 uint32_t set_arm_clock(uint32_t frequency);
 
+// Functions to call after every clock change, so code which computed
+// settings from F_CPU_ACTUAL or F_BUS_ACTUAL can recalculate them.
+#define ARM_CLOCK_HOOKS_MAX 4
+static void (*arm_clock_hooks[ARM_CLOCK_HOOKS_MAX])(void);
+
 
 // stuff needing wait handshake:
 //  CCM_CACRR  ARM_PODF
@@ -173,6 +178,140 @@ uint32_t set_arm_clock(uint32_t frequency)
 		while (!(DCDC_REG0 & DCDC_REG0_STS_DC_OK)) ; // wait voltage settling
 	}
 
+	for (int i=0; i < ARM_CLOCK_HOOKS_MAX; i++) {
+		if (arm_clock_hooks[i]) (arm_clock_hooks[i])();
+	}
 	return frequency;
 }
 
+int arm_clock_attach_hook(void (*function)(void))
+{
+	for (int i=0; i < ARM_CLOCK_HOOKS_MAX; i++) {
+		if (arm_clock_hooks[i] == function) return 1;
+		if (arm_clock_hooks[i] == NULL) {
+			arm_clock_hooks[i] = function;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+void arm_clock_detach_hook(void (*function)(void))
+{
+	for (int i=0; i < ARM_CLOCK_HOOKS_MAX; i++) {
+		if (arm_clock_hooks[i] == function) arm_clock_hooks[i] = NULL;
+	}
+}
+
+
+// Clock governor.  Every CLOCK_GOVERNOR_INTERVAL milliseconds, the fraction
+// of time spent waiting in delay() decides the next ARM clock.  When busy,
+// jump straight to the maximum, so peak throughput is not lost.  When mostly
+// idle, step down by 1/4 toward the minimum.  While the chip is above
+// CLOCK_GOVERNOR_HOT_TEMP, only the minimum is used.  The governor runs from
+// yield(), never from an interrupt, because set_arm_clock() waits for the
+// PLL and voltage regulator.
+#ifndef CLOCK_GOVERNOR_INTERVAL
+#define CLOCK_GOVERNOR_INTERVAL		100	// milliseconds
+#endif
+#ifndef CLOCK_GOVERNOR_BUSY_PERCENT
+#define CLOCK_GOVERNOR_BUSY_PERCENT	80	// increase above this load
+#endif
+#ifndef CLOCK_GOVERNOR_IDLE_PERCENT
+#define CLOCK_GOVERNOR_IDLE_PERCENT	30	// decrease below this load
+#endif
+#ifndef CLOCK_GOVERNOR_HOT_TEMP
+#define CLOCK_GOVERNOR_HOT_TEMP		75.0f	// degrees C, hysteresis 5 C
+#endif
+
+volatile uint8_t clock_governor_active = 0;
+uint32_t clock_governor_idle_cycles = 0;	// added by delay()
+static uint32_t governor_min_freq;
+static uint32_t governor_max_freq;
+static uint32_t governor_window_millis;
+static uint32_t governor_window_cycles;
+static uint8_t governor_hot = 0;
+static uint8_t governor_enabled = 0;	// between begin and end, even while paused
+
+static void clock_governor_window_reset(void)
+{
+	governor_window_millis = systick_millis_count;
+	governor_window_cycles = ARM_DWT_CYCCNT;
+	clock_governor_idle_cycles = 0;
+}
+
+static void clock_governor_set(uint32_t frequency)
+{
+	// change speed just after a systick, so micros() scales only the few
+	// microseconds before the change by the wrong frequency
+	uint32_t ms = systick_millis_count;
+	while (ms == systick_millis_count) ; // wait
+	// tempmon throttling also changes the clock only from yield()
+	set_arm_clock(frequency);
+}
+
+void clock_governor_begin(uint32_t min_freq, uint32_t max_freq)
+{
+	if (max_freq < min_freq) max_freq = min_freq;
+	governor_min_freq = min_freq;
+	governor_max_freq = max_freq;
+	governor_hot = 0;
+	clock_governor_window_reset();
+	governor_enabled = 1;
+	clock_governor_active = 1;
+}
+
+void clock_governor_end(void)
+{
+	if (!governor_enabled) return;
+	governor_enabled = 0;
+	clock_governor_active = 0;
+	if (F_CPU_ACTUAL != governor_max_freq) clock_governor_set(governor_max_freq);
+}
+
+// called by yield() while clock_governor_active
+void clock_governor_update(void)
+{
+	static uint8_t running = 0;
+
+	if (!governor_enabled) {
+		// ended while USB suspend had paused it
+		clock_governor_active = 0;
+		return;
+	}
+	if (systick_millis_count - governor_window_millis < CLOCK_GOVERNOR_INTERVAL) return;
+	if (running) return;
+	running = 1;
+	uint32_t cycles = ARM_DWT_CYCCNT - governor_window_cycles;
+	uint32_t idle = clock_governor_idle_cycles;
+	if (idle > cycles) idle = cycles;
+	uint32_t load = 100 - (uint32_t)(((uint64_t)idle * 100) / cycles);
+
+	float temp = tempmonGetTemp();
+	if (temp >= CLOCK_GOVERNOR_HOT_TEMP) {
+		governor_hot = 1;
+	} else if (temp < CLOCK_GOVERNOR_HOT_TEMP - 5.0f) {
+		governor_hot = 0;
+	}
+
+	uint32_t now = F_CPU_ACTUAL;
+	uint32_t freq = now;
+	if (tempmon_throttle_level > 0) {
+		// tempmon throttling is in control of the clock
+	} else if (governor_hot) {
+		freq = governor_min_freq;
+	} else if (load > CLOCK_GOVERNOR_BUSY_PERCENT) {
+		freq = governor_max_freq;
+	} else if (load < CLOCK_GOVERNOR_IDLE_PERCENT) {
+		freq = now - now / 4;
+		if (freq < governor_min_freq) freq = governor_min_freq;
+	}
+	// set_arm_clock() rounds to what the PLL can make, so ignore tiny changes
+	if (freq > now + 12000000 || freq + 12000000 < now) {
+		printf("governor: load=%u%%, %u -> %u\n", load, now, freq);
+		clock_governor_set(freq);
+	}
+	clock_governor_window_reset();
+	running = 0;
+}
+
@@ -30,6 +30,7 @@
 
 #pragma once
 #include "imxrt.h"
+#include "irq_priority.h"
 #include "pins_arduino.h"
 
 #define HIGH			1
@@ -2280,15 +2281,37 @@ static inline void digitalToggleFast(uint8_t pin)
 }
 
 void pinMode(uint8_t pin, uint8_t mode);
+// Move pins between the fast GPIO6-9 ports (the default, single cycle CPU
+// access) and the normal GPIO1-4 ports (reachable by DMA).  Constant pin
+// digitalWriteFast(), digitalReadFast() and digitalToggleFast() always
+// use the fast port, so they have no effect on pins moved to GPIO1-4.
+// attachInterrupt() does nothing for pins moved to GPIO1-4, rather than
+// moving them back; attachInterruptDirect() may be used instead.
+void pinFastGPIO(uint8_t pin, int fast);
+void portFastGPIO(uint8_t port, uint32_t mask, int fast); // port = 1 to 4
+int pinIsFastGPIO(uint8_t pin);
 void init_pins(void);
 void analogWrite(uint8_t pin, int val);
 uint32_t analogWriteRes(uint32_t bits);
 static inline uint32_t analogWriteResolution(uint32_t bits) { return analogWriteRes(bits); }
 void analogWriteFrequency(uint8_t pin, float frequency);
+void analogWriteBegin(void);
+void analogWriteCommit(void);
+void analogWriteMulti(const uint8_t *pins, const int *vals, unsigned int count);
+// Code which writes FlexPWM or QuadTimer registers directly calls these
+// first.  With STARTUP_DEFER_INIT they clock and initialize the module on
+// first use, as analogWrite() does.  Otherwise pwm_init() already has.
+void flexpwm_module_enable(IMXRT_FLEXPWM_t *p);
+void quadtimer_module_enable(IMXRT_TMR_t *p);
 void attachInterrupt(uint8_t pin, void (*function)(void), int mode);
+void attachInterruptArg(uint8_t pin, void (*function)(void *), void *context, int mode);
 void detachInterrupt(uint8_t pin);
+int attachInterruptDirect(uint8_t pin, void (*function)(void), int mode);
+uint32_t interruptDispatchCycles(uint32_t *max, int reset);
 void _init_Teensyduino_internal_(void);
 int analogRead(uint8_t pin);
+int analogReadPair(uint8_t pinA, uint8_t pinB, int *valA, int *valB);
+int analogReadStart(uint8_t pin, void (*callback)(uint8_t pin, int value));
 void analogReference(uint8_t type);
 void analogReadRes(unsigned int bits);
 static inline void analogReadResolution(unsigned int bits) { analogReadRes(bits); }
@@ -2317,6 +2340,15 @@ static inline void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder,
         }
 }
 
+// Send many bytes, using LPSPI when dataPin and clockPin are SPI MOSI
+// and SCK pins (11 & 13, 26 & 27, 35 & 37 on 4.0, 43 & 45 on 4.1)
+void shiftOutBuffer(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, const void *buffer, uint32_t length);
+// Same, but returns 1 while DMA sends the buffer in the background
+int shiftOutBufferAsync(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, const void *buffer, uint32_t length);
+int shiftOutBusy(void);
+// Clock speed for LPSPI transfers, default 10 MHz, returns prior setting
+uint32_t shiftOutClock(uint32_t hz);
+
 static inline uint8_t shiftIn(uint8_t, uint8_t, uint8_t) __attribute__((always_inline, unused));
 extern uint8_t _shiftIn(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder) __attribute__((noinline));
 extern uint8_t shiftIn_lsbFirst(uint8_t dataPin, uint8_t clockPin) __attribute__((noinline));
@@ -2346,11 +2378,61 @@ extern uint8_t yield_active_check_flags;
 #define YIELD_CHECK_EVENT_RESPONDER	0x4		// User has created eventResponders that use yield
 #define YIELD_CHECK_USB_SERIALUSB1  0x8		// Check for SerialUSB1
 #define YIELD_CHECK_USB_SERIALUSB2  0x10	// Check for SerialUSB2
+#define YIELD_CHECK_TRACE           0x20	// trace log records to send (debug/trace.h)
+
+// Each bit set here means that yield() check may have work to do.  These
+// are set by interrupts when data arrives, so yield() returns quickly
+// when nothing has happened.
+extern volatile uint32_t yield_ready_flags;
+
+// Mark yield() checks as ready, safe to use from any interrupt.
+static inline void yield_ready(uint32_t flags) __attribute__((always_inline, unused));
+static inline void yield_ready(uint32_t flags)
+{
+	uint32_t val, fail;
+	do {
+		__asm__ volatile("ldrex %0, [%1]" : "=r" (val) : "r" (&yield_ready_flags));
+		val |= flags;
+		__asm__ volatile("strex %0, %1, [%2]" : "=&r" (fail) : "r" (val), "r" (&yield_ready_flags) : "memory");
+	} while (fail);
+}
 
 void yield(void);
 
 void delay(uint32_t msec);
 
+// Low power idle.  IDLE_WFI_DELAY makes delay() sleep with WFI until the
+// next interrupt, instead of spinning.  IDLE_WFI_YIELD also sleeps in yield()
+// when no yield() checks are ready, so loop() runs again only after an
+// interrupt (at least every millisecond, from systick).  Code which polls
+// hardware in loop() without interrupts should not use IDLE_WFI_YIELD.
+#define IDLE_WFI_DELAY			0x01
+#define IDLE_WFI_YIELD			0x02
+extern volatile uint8_t idle_wfi_mode;
+extern uint8_t delay_active;
+void idle_wfi(void);
+
+#ifdef LOOP_STATS
+// Optional main loop statistics, enabled by compiling with -DLOOP_STATS,
+// to check whether loop() keeps up with its intended rate.  The period is
+// from the start of one loop() to the start of the next, including the
+// yield() between them.  Time in serialEvent and EventResponder counts
+// all calls of yield(), including those made by delay() inside loop().
+#define LOOP_STATS_HISTOGRAM_SIZE 16
+typedef struct {
+	uint32_t loops;
+	uint32_t period_max;       // microseconds
+	uint32_t period_histogram[LOOP_STATS_HISTOGRAM_SIZE]; // [n] = 2^(n-1) to 2^n-1 us
+	uint32_t loop_cycles_max;  // longest single loop() call, CPU cycles
+	uint64_t loop_cycles;      // total CPU cycles in loop()
+	uint64_t yield_cycles;     // in yield() called between loop()s
+	uint64_t serial_event_cycles;    // in serialEvent functions, any yield()
+	uint64_t event_responder_cycles; // in EventResponder, any yield()
+} loop_stats_t;
+extern loop_stats_t loop_stats;
+void loop_stats_clear(void);
+#endif
+
 extern volatile uint32_t F_CPU_ACTUAL;
 extern volatile uint32_t F_BUS_ACTUAL;
 extern volatile uint32_t scale_cpu_cycles_to_microseconds;
@@ -2364,6 +2446,18 @@ static inline uint32_t millis(void)
 
 uint32_t micros(void);
 
+// 64 bit timebase.  cycles64() counts CPU cycles since startup, so its rate
+// changes with set_arm_clock().  nanos() is time since startup, which stays
+// correct across clock changes.  Both rely on systick running at least once
+// per 2^32 cycles, which it does unless interrupts are disabled for seconds.
+uint64_t cycles64(void);
+uint64_t nanos(void);
+
+// Low overhead timestamps for instrumentation, a single read of the cycle
+// counter.  Subtract two for elapsed cycles, up to 2^32 cycles apart.
+#define TIMESTAMP_CYCLES()		(ARM_DWT_CYCCNT)
+#define CYCLES_TO_NANOS(cycles)		((uint32_t)(((uint64_t)(cycles) * 1000000000u) / F_CPU_ACTUAL))
+
 static inline void delayMicroseconds(uint32_t) __attribute__((always_inline, unused));
 static inline void delayMicroseconds(uint32_t usec)
 {
@@ -2373,25 +2467,103 @@ static inline void delayMicroseconds(uint32_t usec)
 	while (ARM_DWT_CYCCNT - begin < cycles) ; // wait
 }
 
+static inline void delayCycles(uint32_t) __attribute__((always_inline, unused));
+static inline void delayCycles(uint32_t cycles)
+{
+	uint32_t begin = ARM_DWT_CYCCNT;
+	while (ARM_DWT_CYCCNT - begin < cycles) ; // wait
+}
+
 static inline void delayNanoseconds(uint32_t) __attribute__((always_inline, unused));
 static inline void delayNanoseconds(uint32_t nsec)
 {
 	uint32_t begin = ARM_DWT_CYCCNT;
-	uint32_t cycles =   ((F_CPU_ACTUAL>>16) * nsec) / (1000000000UL>>16);
+	// rounded up, so the delay is never shorter than requested
+	uint32_t cycles = ((F_CPU_ACTUAL>>16) * nsec + (1000000000UL>>16) - 1) / (1000000000UL>>16);
 	while (ARM_DWT_CYCCNT - begin < cycles) ; // wait
 }
 
 
 unsigned long rtc_get(void);
+// raw 32768 Hz RTC count, seconds are ticks >> 15
+uint64_t rtc_get_ticks(void);
+// seconds, with fraction as microseconds (30.5 us resolution)
+unsigned long rtc_get_us(uint32_t *microseconds);
 void rtc_set(unsigned long t);
 void rtc_compensate(int adjust);
 
+// Startup time profile: microseconds from reset to the end of each phase,
+// so startup_time_usec[STARTUP_TIME_PWM] - startup_time_usec[STARTUP_TIME_ANALOG]
+// is the time pwm_init() took.  Phases skipped remain 0.
+#define STARTUP_TIME_MEMORY		0	// copy code & data, clear bss
+#define STARTUP_TIME_USB_PLL		1	// cache, systick, USB PLL
+#define STARTUP_TIME_ARM_CLOCK		2	// set_arm_clock(F_CPU)
+#define STARTUP_TIME_RTC		3	// PIT reset, RTC start
+#define STARTUP_TIME_EXTERNAL_RAM	4	// PSRAM detection (Teensy 4.1)
+#define STARTUP_TIME_ANALOG		5	// analog_init()
+#define STARTUP_TIME_PWM		6	// pwm_init()
+#define STARTUP_TIME_TEMPMON		7	// tempmon_init()
+#define STARTUP_TIME_MIDDLE_HOOK	8	// startup_middle_hook()
+#define STARTUP_TIME_USB		9	// delay before usb_init(), usb_init()
+#define STARTUP_TIME_USB_DELAY		10	// delay after usb_init()
+#define STARTUP_TIME_CONSTRUCTORS	11	// startup_late_hook(), C++ constructors
+#define STARTUP_TIME_NUM		12
+extern uint32_t startup_time_usec[STARTUP_TIME_NUM];
+
+// Stack usage.  At startup the unused part of the stack, from the MPU
+// guard region above the variables in DTCM up to the stack pointer, is
+// filled with STACK_PAINT.  stackHighWater() finds the most stack ever
+// used, in bytes, by scanning upward for the first word which changed, so
+// it takes time in proportion to the stack never used.  stackSize() is
+// the total available.  See also stackMonitor() in EventResponder.h.
+#define STACK_PAINT			0xA5A5A5A5
+uint32_t stackHighWater(void);
+uint32_t stackSize(void);
+
+uint32_t set_arm_clock(uint32_t frequency);
+int arm_clock_attach_hook(void (*function)(void));
+void arm_clock_detach_hook(void (*function)(void));
+void clock_governor_begin(uint32_t min_freq, uint32_t max_freq);
+void clock_governor_end(void);
+void clock_governor_update(void);
+extern volatile uint8_t clock_governor_active;
+extern uint32_t clock_governor_idle_cycles;
+
 void tempmon_init(void);
 float tempmonGetTemp(void);
 void tempmon_Start();
 void tempmon_Stop();
 void tempmon_PwrDwn();
 
+// Thermal throttling, instead of waiting for the panic shutdown
+struct tempmon_throttle_stats_struct {
+	uint32_t steps_down;
+	uint32_t steps_up;
+	uint32_t throttled_msec;	// total time at reduced clock, until the last step
+	float max_temp;			// hottest alarm seen
+	uint8_t max_level;
+};
+void tempmon_throttle_begin(uint32_t hot_temp, uint32_t cool_temp);
+void tempmon_throttle_end(void);
+void tempmon_throttle_update(void);
+extern volatile uint8_t tempmon_throttle_level;
+extern volatile uint8_t tempmon_throttle_pending;
+extern struct tempmon_throttle_stats_struct tempmon_throttle_stats;
+
+// Health counters kept by CrashReport, which survive warm resets.  "Max"
+// counters keep the largest value reported, others count events.
+#define CRASHREPORT_COUNTER_ISR_LATENCY	0	// max, CPU cycles
+#define CRASHREPORT_COUNTER_LOOP_TIME	1	// max, microseconds
+#define CRASHREPORT_COUNTER_HEAP_PEAK	2	// max, bytes
+#define CRASHREPORT_COUNTER_USB_ERRORS	3	// count, USB error interrupts
+#define CRASHREPORT_COUNTER_THERMAL	4	// count, tempmon throttling began
+#define CRASHREPORT_COUNTER_BROWNOUTS	5	// count
+#define CRASHREPORT_COUNTER_RESETS	6	// count, startups since power up or clear
+#define CRASHREPORT_COUNTER_NUM		7
+void crashreport_counter_max(unsigned int counter, uint32_t value);
+void crashreport_counter_add(unsigned int counter, uint32_t n);
+uint32_t crashreport_counter_read(unsigned int counter);
+
 #ifdef __cplusplus
 }
 
@@ -2408,6 +2580,26 @@ typedef struct  {
 void breakTime(uint32_t time, DateTimeFields &tm);  // break 32 bit time into DateTimeFields
 uint32_t makeTime(const DateTimeFields &tm); // convert DateTimeFields to 32 bit time
 
+// A pin number fixed at compile time.  Each function resolves to the port
+// register and bit directly, even when N arrives through other templates,
+// for example TeensyPin<LED_BUILTIN>::write(HIGH).  Named TeensyPin since
+// libraries like FastLED have their own Pin class.  On Teensy 3 and 4,
+// write() is digitalWriteFast(), as PWM is turned off by pinMode().  On
+// Teensy 2.0 write() is digitalWrite(), which also turns off PWM.
+template <uint8_t N>
+class TeensyPin
+{
+public:
+	enum { number = N };
+	static void mode(uint8_t mode) __attribute__((always_inline)) { pinMode(N, mode); }
+	static void write(uint8_t val) __attribute__((always_inline)) { digitalWriteFast(N, val); }
+	static void writeFast(uint8_t val) __attribute__((always_inline)) { digitalWriteFast(N, val); }
+	static void high(void) __attribute__((always_inline)) { digitalWriteFast(N, HIGH); }
+	static void low(void) __attribute__((always_inline)) { digitalWriteFast(N, LOW); }
+	static void toggle(void) __attribute__((always_inline)) { digitalToggleFast(N); }
+	static uint8_t read(void) __attribute__((always_inline)) { return digitalReadFast(N); }
+};
+
 class teensy3_clock_class
 {
 public:
@@ -0,0 +1,161 @@
+#!/usr/bin/env python3
+# Reads the sample stream from PCProfile.beginStream() and reports where
+# the time went, by function and by calling function.
+#
+#   python3 pcstream.py program.elf /dev/ttyACM1
+#   python3 pcstream.py program.elf saved.txt
+#   python3 pcstream.py --seconds 30 --top 40 program.elf /dev/ttyACM1
+#
+# A device is read until Ctrl-C or --seconds, a file until its end.  The
+# .elf must be the one running, which is checked against the addresses in
+# the stream's '@' lines.  Functions are found with arm-none-eabi-nm, so
+# it must be in the PATH or given with --nm.  The caller is taken from LR,
+# which is only the true caller while the interrupted function hasn't yet
+# called another, so treat the caller report as a strong hint.
+#
+# Uses pyserial when installed, otherwise reads the device as a file.
+#
+# This example code is in the public domain.
+
+import argparse
+import bisect
+import collections
+import os
+import subprocess
+import sys
+import time
+
+
+class Symbols:
+    def __init__(self, nm, elf):
+        out = subprocess.run([nm, '-S', '-C', '-n', '--defined-only', elf],
+                             check=True, capture_output=True, text=True).stdout
+        self.starts = []
+        self.ends = []
+        self.names = []
+        self.addresses = {}
+        for line in out.splitlines():
+            fields = line.split(None, 3)
+            if len(fields) == 4:
+                addr, size, kind, name = fields
+                size = int(size, 16)
+            elif len(fields) == 3:
+                addr, kind, name = fields
+                size = 0
+            else:
+                continue
+            addr = int(addr, 16)
+            self.addresses[name] = addr
+            if kind not in 'tTwW':
+                continue
+            addr &= ~1  # Thumb functions have bit 0 set
+            self.starts.append(addr)
+            self.ends.append(addr + size if size else None)
+            self.names.append(name)
+        for i, end in enumerate(self.ends):
+            if end is None:
+                self.ends[i] = self.starts[i + 1] if i + 1 < len(self.starts) else self.starts[i] + 2
+
+    def lookup(self, addr):
+        addr &= ~1
+        i = bisect.bisect_right(self.starts, addr) - 1
+        if i >= 0 and addr < self.ends[i]:
+            return self.names[i]
+        return '0x%08X' % addr
+
+
+def open_source(path):
+    """Returns the stream and whether it's a live device."""
+    if path == '-':
+        return sys.stdin.buffer, False
+    if os.path.isfile(path):
+        return open(path, 'rb'), False
+    try:
+        import serial
+        return serial.Serial(path, timeout=0.5), True
+    except ImportError:
+        return open(path, 'rb'), True
+
+
+def main():
+    parser = argparse.ArgumentParser(description='PCProfile stream report')
+    parser.add_argument('elf')
+    parser.add_argument('source', help='serial device, saved file or - for stdin')
+    parser.add_argument('--nm', default='arm-none-eabi-nm')
+    parser.add_argument('--seconds', type=float, default=0)
+    parser.add_argument('--top', type=int, default=25)
+    args = parser.parse_args()
+
+    syms = Symbols(args.nm, args.elf)
+    source, live = open_source(args.source)
+    self_time = collections.Counter()
+    callers = collections.Counter()
+    samples = 0
+    dropped = 0
+    rate = 0
+    checked = False
+    begin = time.monotonic()
+    if live:
+        print('reading %s, Ctrl-C to stop' % args.source, file=sys.stderr)
+    try:
+        while True:
+            if args.seconds and time.monotonic() - begin >= args.seconds:
+                break
+            line = source.readline()
+            if not line:
+                if live:
+                    continue
+                break
+            fields = line.decode('ascii', 'replace').split()
+            if not fields:
+                continue
+            if fields[0] == '@':
+                # @ <rate> Hz itcm <addr> load <addr> flash <addr>
+                rate = int(fields[1])
+                if not checked:
+                    expect = {'_stext': fields[4], '_stextload': fields[6], '_sflashcode': fields[8]}
+                    for name, value in expect.items():
+                        if name in syms.addresses and syms.addresses[name] != int(value, 16):
+                            sys.exit('%s is 0x%s on Teensy but 0x%08X in %s, wrong .elf file?'
+                                     % (name, value, syms.addresses[name], args.elf))
+                    checked = True
+            elif fields[0] == '!':
+                dropped += int(fields[1])
+            elif len(fields) == 2:
+                try:
+                    pc = int(fields[0], 16)
+                    lr = int(fields[1], 16)
+                except ValueError:
+                    continue
+                function = syms.lookup(pc)
+                self_time[function] += 1
+                if lr >= 0xFFFFFFE0:
+                    caller = '(interrupt entry)'
+                else:
+                    caller = syms.lookup(lr - 1)
+                if caller != function:
+                    callers[(caller, function)] += 1
+                samples += 1
+    except KeyboardInterrupt:
+        pass
+
+    if samples == 0:
+        sys.exit('no samples received')
+    print('%d samples' % samples, end='')
+    if rate:
+        print(' at %d Hz, %.1f seconds' % (rate, samples / rate), end='')
+    if dropped:
+        print(', %d dropped because output fell behind' % dropped, end='')
+    print()
+    print()
+    print('%8s %7s  %s' % ('samples', 'time', 'function'))
+    for function, count in self_time.most_common(args.top):
+        print('%8d %6.2f%%  %s' % (count, count * 100.0 / samples, function))
+    print()
+    print('%8s %7s  %s' % ('samples', 'time', 'caller -> function'))
+    for (caller, function), count in callers.most_common(args.top):
+        print('%8d %6.2f%%  %s -> %s' % (count, count * 100.0 / samples, caller, function))
+
+
+if __name__ == '__main__':
+    main()
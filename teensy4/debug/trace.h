@@ -0,0 +1,79 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// uncommenting the line below will enable the trace log in cores\teensy4
+// TRACE_LOG_EVENT() records are sent to USB Serial from yield()
+//#define TRACE_LOG
+
+// Trace log records are written to a ring buffer in DTCM, from any interrupt
+// or the main program, without disabling interrupts.  When the buffer is
+// full, new records are counted as dropped rather than written.
+//
+// Each record is sent as 12 bytes, little endian:
+//   uint32_t cycles   ARM_DWT_CYCCNT when written
+//   uint16_t id       event id, 0xFF00 to 0xFFFF are reserved
+//   uint16_t seq      sequence number, increments by 1 for each record
+//   uint32_t arg      event argument
+// Every group of records sent begins with a TRACE_ID_SYNC record, with seq
+// TRACE_SYNC_MAGIC and arg F_CPU_ACTUAL (to convert cycles to time), then
+// TRACE_ID_DROPPED with arg the number of records lost, if any were.
+// Search for the sync record to align to the stream.
+
+#define TRACE_ID_SYNC		0xFFFF
+#define TRACE_ID_DROPPED	0xFFFE
+#define TRACE_SYNC_MAGIC	0x5254
+
+#ifdef TRACE_LOG
+#include <stdint.h>
+#ifndef TRACE_LOG_SIZE
+#define TRACE_LOG_SIZE 1024	// records, must be a power of 2
+#endif
+#define TRACE_LOG_EVENT(id, arg) trace_write((id), (uint32_t)(arg))
+#ifdef __cplusplus
+extern "C" {
+#endif
+struct trace_record {
+	uint32_t cycles;
+	uint16_t id;
+	uint16_t seq;
+	uint32_t arg;
+};
+void trace_write(uint32_t id, uint32_t arg);
+// trace_read() and trace_drain() must not be called from interrupts
+int trace_read(struct trace_record *record);
+int trace_drain(void);
+#ifdef __cplusplus
+}
+#endif
+
+#else
+#define TRACE_LOG_EVENT(id, arg)
+
+#endif
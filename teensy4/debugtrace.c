@@ -0,0 +1,150 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "debug/trace.h"
+
+#ifdef TRACE_LOG
+
+#include "imxrt.h"
+#include "core_pins.h"
+#include "usb_desc.h"
+
+#if (TRACE_LOG_SIZE & (TRACE_LOG_SIZE - 1)) != 0
+#error "TRACE_LOG_SIZE must be a power of 2"
+#endif
+
+// Writers reserve a record by incrementing trace_head with LDREX/STREX.
+// Records are only removed from main program context, which can never run
+// while an interrupt is part way through writing one, so every record
+// before trace_head is complete when trace_read() looks at it.
+static struct trace_record trace_buffer[TRACE_LOG_SIZE];
+static volatile uint32_t trace_head = 0;
+static volatile uint32_t trace_tail = 0;
+static volatile uint32_t trace_dropped = 0;
+
+void trace_write(uint32_t id, uint32_t arg)
+{
+	uint32_t head, fail;
+	uint32_t cycles = ARM_DWT_CYCCNT;
+
+	do {
+		__asm__ volatile("ldrex %0, [%1]" : "=r" (head) : "r" (&trace_head));
+		if (head - trace_tail >= TRACE_LOG_SIZE) {
+			__asm__ volatile("clrex" ::: "memory");
+			do {
+				__asm__ volatile("ldrex %0, [%1]" : "=r" (head) : "r" (&trace_dropped));
+				__asm__ volatile("strex %0, %1, [%2]" : "=&r" (fail) : "r" (head + 1), "r" (&trace_dropped) : "memory");
+			} while (fail);
+			return;
+		}
+		__asm__ volatile("strex %0, %1, [%2]" : "=&r" (fail) : "r" (head + 1), "r" (&trace_head) : "memory");
+	} while (fail);
+	struct trace_record *r = trace_buffer + (head & (TRACE_LOG_SIZE - 1));
+	r->cycles = cycles;
+	r->id = id;
+	r->seq = head;
+	r->arg = arg;
+	yield_ready(YIELD_CHECK_TRACE);
+}
+
+int trace_read(struct trace_record *record)
+{
+	uint32_t tail = trace_tail;
+	if (tail == trace_head) return 0;
+	*record = trace_buffer[tail & (TRACE_LOG_SIZE - 1)];
+	asm("dsb" ::: "memory");
+	trace_tail = tail + 1;
+	return 1;
+}
+
+static uint32_t trace_dropped_take(void)
+{
+	uint32_t val, fail;
+	do {
+		__asm__ volatile("ldrex %0, [%1]" : "=r" (val) : "r" (&trace_dropped));
+		__asm__ volatile("strex %0, %1, [%2]" : "=&r" (fail) : "r" (0), "r" (&trace_dropped) : "memory");
+	} while (fail);
+	return val;
+}
+
+// Send as many records as fit in the free USB transmit buffers, without
+// waiting.  Returns the number of records still waiting, or 0 if USB can't
+// take any more right now, so yield() stops calling until the next record
+// is written.  Call trace_drain() directly to push out the last records.
+#if defined(CDC_STATUS_INTERFACE) && defined(CDC_DATA_INTERFACE)
+#include "usb_dev.h"
+#include "usb_serial.h"
+int trace_drain(void)
+{
+	struct trace_record buf[16];
+	uint32_t count = 0;
+
+	if (trace_tail == trace_head && trace_dropped == 0) return 0;
+	if (!usb_configuration) return 0;
+	uint32_t space = usb_serial_write_buffer_free() / sizeof(struct trace_record);
+	if (space < 3) return 0;
+	buf[0].cycles = ARM_DWT_CYCCNT;
+	buf[0].id = TRACE_ID_SYNC;
+	buf[0].seq = TRACE_SYNC_MAGIC;
+	buf[0].arg = F_CPU_ACTUAL;
+	count = 1;
+	uint32_t dropped = trace_dropped_take();
+	if (dropped) {
+		buf[1].cycles = buf[0].cycles;
+		buf[1].id = TRACE_ID_DROPPED;
+		buf[1].seq = trace_tail;
+		buf[1].arg = dropped;
+		count = 2;
+	}
+	space -= count;
+	while (1) {
+		while (count < sizeof(buf) / sizeof(buf[0]) && space > 0) {
+			if (!trace_read(buf + count)) break;
+			count++;
+			space--;
+		}
+		if (count == 0) break;
+		usb_serial_write(buf, count * sizeof(struct trace_record));
+		if (count < sizeof(buf) / sizeof(buf[0])) break;
+		count = 0;
+	}
+	if (space == 0) return 0;
+	return trace_head - trace_tail;
+}
+
+#else
+int trace_drain(void)
+{
+	// no USB Serial, records remain for trace_read()
+	return 0;
+}
+#endif
+
+#endif // TRACE_LOG
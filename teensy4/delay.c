@@ -5,8 +5,15 @@
 //volatile uint32_t F_BUS = 132000000;
 volatile uint32_t systick_millis_count = 0;
 volatile uint32_t systick_cycle_count = 0;
+volatile uint32_t systick_cycle_high = 0;	// cycles64() upper 32 bits
+volatile uint32_t systick_millis_high = 0;	// nanos() milliseconds upper 32 bits
 volatile uint32_t scale_cpu_cycles_to_microseconds = 0;
 uint32_t systick_safe_read;	 // micros() synchronization
+#ifndef IDLE_WFI_DEFAULT
+#define IDLE_WFI_DEFAULT 0
+#endif
+volatile uint8_t idle_wfi_mode = IDLE_WFI_DEFAULT;
+uint8_t delay_active = 0;
 
 //The 24 MHz XTALOSC can be the external clock source of SYSTICK. 
 //Hardware devides this down to 100KHz. (RM Rev2, 13.3.21 PG 986)
@@ -48,18 +55,44 @@ void millis_init(void)
 
 }*/
 
+// Sleep until any interrupt, unless yield() already has work ready.  The
+// check is made with interrupts disabled, because WFI still wakes for a
+// pending interrupt, so one arriving just before the WFI is not missed.
+// The cycle counter keeps running, so micros() remains accurate.
+void idle_wfi(void)
+{
+	uint32_t primask;
+	__asm__ volatile("mrs %0, primask\n" : "=r" (primask) :: "memory");
+	if (primask) return; // interrupts disabled, nothing would run
+	__disable_irq();
+	if (!(yield_ready_flags & yield_active_check_flags)) {
+		__asm__ volatile("dsb\n\twfi\n" ::: "memory");
+	}
+	__enable_irq();
+}
+
 void delay(uint32_t msec)
 {
-	uint32_t start;
+	uint32_t start, idle;
 
 	if (msec == 0) return;
 	start = micros();
+	idle = ARM_DWT_CYCCNT;
+	delay_active++;
 	while (1) {
 		while ((micros() - start) >= 1000) {
-			if (--msec == 0) return;
+			if (--msec == 0) {
+				clock_governor_idle_cycles += ARM_DWT_CYCCNT - idle;
+				delay_active--;
+				return;
+			}
 			start += 1000;
 		}
+		clock_governor_idle_cycles += ARM_DWT_CYCCNT - idle; // waiting time, for the clock governor
 		yield();
+		idle = ARM_DWT_CYCCNT; // work done by yield() isn't idle
+		// WFI may sleep until the next systick, so spin for the last millisecond
+		if ((idle_wfi_mode & IDLE_WFI_DELAY) && msec > 1) idle_wfi();
 	}
 	// TODO...
 }
@@ -81,6 +114,36 @@ uint32_t micros(void)
 	return usec;
 }
 
+uint64_t cycles64(void)
+{
+	uint32_t scc, high;
+	do {
+		__LDREXW(&systick_safe_read);
+		scc = systick_cycle_count;
+		high = systick_cycle_high;
+	} while ( __STREXW(1, &systick_safe_read));
+	uint32_t cyccnt = ARM_DWT_CYCCNT;
+	if (cyccnt < scc) high++; // wrapped since the last systick
+	return ((uint64_t)high << 32) | cyccnt;
+}
+
+uint64_t nanos(void)
+{
+	uint32_t smc, scc, high;
+	do {
+		__LDREXW(&systick_safe_read);
+		smc = systick_millis_count;
+		scc = systick_cycle_count;
+		high = systick_millis_high;
+	} while ( __STREXW(1, &systick_safe_read));
+	uint32_t cyccnt = ARM_DWT_CYCCNT;
+	asm volatile("" : : : "memory");
+	uint32_t ccdelta = cyccnt - scc;
+	uint32_t frac = ((uint64_t)ccdelta * scale_cpu_cycles_to_microseconds * 1000) >> 32;
+	if (frac > 1000000) frac = 1000000;
+	return ((((uint64_t)high << 32) | smc) * 1000000) + frac;
+}
+
 #if 0 // kept to compare test to cycle count micro()
 uint32_t micros(void)
 {
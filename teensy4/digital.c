@@ -21,7 +21,8 @@ extern const struct digital_pin_bitband_and_config_table_struct digital_pin_to_i
 #define digitalPinToPortReg(pin) (portOutputRegister(pin))
 */
 
-const struct digital_pin_bitband_and_config_table_struct digital_pin_to_info_PGM[] = {
+// Not const, because pinFastGPIO() changes which GPIO port a pin uses
+struct digital_pin_bitband_and_config_table_struct digital_pin_to_info_PGM[] = {
 	{&CORE_PIN0_PORTREG, &CORE_PIN0_CONFIG, &CORE_PIN0_PADCONFIG, CORE_PIN0_BITMASK},
 	{&CORE_PIN1_PORTREG, &CORE_PIN1_CONFIG, &CORE_PIN1_PADCONFIG, CORE_PIN1_BITMASK},
 	{&CORE_PIN2_PORTREG, &CORE_PIN2_CONFIG, &CORE_PIN2_PADCONFIG, CORE_PIN2_BITMASK},
@@ -158,6 +159,67 @@ void pinMode(uint8_t pin, uint8_t mode)
 	*(p->mux) = 5 | 0x10;
 }
 
+static IMXRT_GPIO_t * const fast_gpio[4] = {
+	&IMXRT_GPIO6, &IMXRT_GPIO7, &IMXRT_GPIO8, &IMXRT_GPIO9
+};
+static IMXRT_GPIO_t * const normal_gpio[4] = {
+	&IMXRT_GPIO1, &IMXRT_GPIO2, &IMXRT_GPIO3, &IMXRT_GPIO4
+};
+
+// At startup all pins are given to the fast GPIO6-9 ports, which the CPU
+// writes in a single cycle but DMA can not reach.  This moves pins of
+// GPIO1-4 (port = 1 to 4) and their GPIO6-9 twin back and forth.  The
+// output level and direction are copied, so the pins do not glitch, and
+// the pin table is updated, so digitalWrite(), digitalRead() and the
+// non-constant forms of digitalWriteFast() keep working.
+void portFastGPIO(uint8_t port, uint32_t mask, int fast)
+{
+	if (port < 1 || port > 4 || mask == 0) return;
+	IMXRT_GPIO_t *from, *to;
+	if (fast) {
+		from = normal_gpio[port - 1];
+		to = fast_gpio[port - 1];
+	} else {
+		from = fast_gpio[port - 1];
+		to = normal_gpio[port - 1];
+	}
+	__disable_irq();
+	to->DR = (to->DR & ~mask) | (from->DR & mask);
+	to->GDIR = (to->GDIR & ~mask) | (from->GDIR & mask);
+	if (fast) {
+		(&IOMUXC_GPR_GPR26)[port - 1] |= mask;
+	} else {
+		(&IOMUXC_GPR_GPR26)[port - 1] &= ~mask;
+	}
+	for (int i=0; i < CORE_NUM_DIGITAL; i++) {
+		struct digital_pin_bitband_and_config_table_struct *p = digital_pin_to_info_PGM + i;
+		if ((p->mask & mask) && p->reg == &from->DR) p->reg = &to->DR;
+	}
+	__enable_irq();
+}
+
+void pinFastGPIO(uint8_t pin, int fast)
+{
+	if (pin >= CORE_NUM_DIGITAL) return;
+	volatile uint32_t *reg = digital_pin_to_info_PGM[pin].reg;
+	for (int port=0; port < 4; port++) {
+		if (reg == &fast_gpio[port]->DR || reg == &normal_gpio[port]->DR) {
+			portFastGPIO(port + 1, digital_pin_to_info_PGM[pin].mask, fast);
+			return;
+		}
+	}
+}
+
+int pinIsFastGPIO(uint8_t pin)
+{
+	if (pin >= CORE_NUM_DIGITAL) return 0;
+	volatile uint32_t *reg = digital_pin_to_info_PGM[pin].reg;
+	for (int port=0; port < 4; port++) {
+		if (reg == &fast_gpio[port]->DR) return 1;
+	}
+	return 0;
+}
+
 void _shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t value)
 {
         if (bitOrder == LSBFIRST) {
@@ -0,0 +1,121 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef dma_buffer_h_
+#define dma_buffer_h_
+
+#include "imxrt.h"
+
+// Cache maintenance for memory shared with DMA or USB.  DTCM (below
+// 0x20200000) is never cached, so buffers there need nothing.  OCRAM
+// (DMAMEM), EXTMEM and flash are cached.
+
+static inline int dma_buffer_is_cached(const void *p) __attribute__((always_inline, unused));
+static inline int dma_buffer_is_cached(const void *p)
+{
+	return (uint32_t)p >= 0x20200000u;
+}
+
+// The CPU wrote len bytes, which DMA will now read.  Only the written
+// part needs to be flushed.  The data stays valid in the cache, since
+// DMA reading memory doesn't change it.
+static inline void dma_buffer_to_device(const void *p, uint32_t len) __attribute__((always_inline, unused));
+static inline void dma_buffer_to_device(const void *p, uint32_t len)
+{
+	if (dma_buffer_is_cached(p)) arm_dcache_flush((void *)p, len);
+}
+
+// DMA will write (or has written) len bytes.  Any cached copy is discarded.
+// Call this before starting DMA, so dirty rows can't be evicted on top of
+// incoming data, and again after if the CPU may have read the buffer
+// while DMA was running.  The cache works in 32 byte rows, so the buffer
+// must be 32 byte aligned and padded, or neighboring data will be lost.
+static inline void dma_buffer_from_device(void *p, uint32_t len) __attribute__((always_inline, unused));
+static inline void dma_buffer_from_device(void *p, uint32_t len)
+{
+	if (dma_buffer_is_cached(p)) arm_dcache_delete(p, len);
+}
+
+#ifdef __cplusplus
+#include <stddef.h>
+
+extern "C++" {
+
+// An array for DMA, padded to whole cache rows, which remembers whether
+// the CPU or DMA owns it, so cache maintenance is done only when it is
+// needed and only on the part actually used.  Usually placed in DMAMEM:
+//
+//   DMAMEM DmaBuffer<uint16_t, 256> samples;
+//   samples.beginDmaWrite();	// before DMA fills it
+//   samples.endDma();		// in the DMA complete interrupt
+//
+template <typename T, size_t N>
+class alignas(32) DmaBuffer {
+public:
+	T * data() { return buffer; }
+	const T * data() const { return buffer; }
+	T & operator[](size_t i) { return buffer[i]; }
+	const T & operator[](size_t i) const { return buffer[i]; }
+	static constexpr size_t size() { return N; }
+	static constexpr size_t bytes() { return N * sizeof(T); }
+	bool cpuOwned() const { return state == CPU; }
+
+	// The CPU has written the first count elements, which DMA will read
+	void beginDmaRead(size_t count = N) {
+		if (count > N) count = N;
+		dma_buffer_to_device(buffer, count * sizeof(T));
+		state = DMA_READ;
+	}
+	// DMA will write the first count elements
+	void beginDmaWrite(size_t count = N) {
+		if (count > N) count = N;
+		pending = count * sizeof(T);
+		dma_buffer_from_device(buffer, pending);
+		state = DMA_WRITE;
+	}
+	// DMA is finished, so the CPU may use the buffer again.  After a DMA
+	// write, only the written part is discarded from the cache.  Nothing
+	// is needed after a DMA read.
+	void endDma() {
+		if (state == DMA_WRITE) dma_buffer_from_device(buffer, pending);
+		state = CPU;
+	}
+private:
+	// The bookkeeping comes first, in its own cache row, so discarding the
+	// buffer's rows can never discard it.  The class alignment pads the
+	// end of the buffer to a whole row.
+	uint32_t pending = 0;
+	enum : uint8_t {CPU, DMA_READ, DMA_WRITE} state = CPU;
+	alignas(32) T buffer[N];
+};
+
+} // extern "C++"
+#endif // __cplusplus
+#endif
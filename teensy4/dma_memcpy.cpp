@@ -0,0 +1,190 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2017 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "dma_memcpy.h"
+#include "DMAChannel.h"
+
+typedef struct {
+	uint8_t *dst;
+	const uint8_t *src;
+	uint32_t len;		// remaining to copy
+	uint8_t *start;		// original dst & len, for cache & callback
+	uint32_t total;
+	int fill;		// -1 for memcpy, or memset value
+	void (*callback)(void *dst);
+} dma_memcpy_request_t;
+
+static DMAChannel dma(false);	// allocated by the first request
+static volatile uint8_t dma_state = 0;	// 0 = none, 1 = allocating, 2 = ready
+static dma_memcpy_request_t queue[DMA_MEMCPY_QUEUE_SIZE];
+static volatile uint8_t queue_head = 0;	// next free slot
+static volatile uint8_t queue_tail = 0;	// request in progress
+static volatile uint8_t queue_count = 0;	// requests queued or in progress
+static uint32_t fill_buffer[8] __attribute__((aligned(32)));
+
+static inline bool is_cached(const void *p)
+{
+	return (uint32_t)p >= 0x20200000u;
+}
+
+// DMA up to 32767 units of the largest size the addresses and length
+// allow.  A 32 byte unit uses burst transfers.
+static void start_chunk(dma_memcpy_request_t *r)
+{
+	uint32_t align, size, unit, count;
+	const uint8_t *src = (r->fill < 0) ? r->src : (const uint8_t *)fill_buffer;
+
+	align = (uint32_t)r->dst | (uint32_t)src;
+	if (!(align & 31) && r->len >= 32) size = 5;
+	else if (!(align & 7) && r->len >= 8) size = 3;
+	else if (!(align & 3) && r->len >= 4) size = 2;
+	else if (!(align & 1) && r->len >= 2) size = 1;
+	else size = 0;
+	unit = (size == 5) ? 32 : 1 << size;
+	count = r->len / unit;
+	if (count > 32767) count = 32767;
+
+	DMABaseClass::TCD_t *t = dma.TCD;
+	t->SADDR = src;
+	t->SOFF = (r->fill < 0) ? unit : 0;
+	t->ATTR = DMA_TCD_ATTR_SSIZE(size) | DMA_TCD_ATTR_DSIZE(size);
+	t->NBYTES = unit;
+	t->SLAST = 0;
+	t->DADDR = r->dst;
+	t->DOFF = unit;
+	t->CITER = count;
+	t->BITER = count;
+	t->DLASTSGA = 0;
+	t->CSR = DMA_TCD_CSR_INTMAJOR | DMA_TCD_CSR_DREQ;
+
+	r->dst += count * unit;
+	if (r->fill < 0) r->src += count * unit;
+	r->len -= count * unit;
+	dma.enable();
+}
+
+static void start_request(dma_memcpy_request_t *r)
+{
+	if (r->fill < 0) {
+		if (is_cached(r->src)) arm_dcache_flush((void *)r->src, r->len);
+	} else {
+		uint32_t c = (uint8_t)r->fill * 0x01010101u;
+		for (int i=0; i < 8; i++) fill_buffer[i] = c;
+		if (is_cached(fill_buffer)) arm_dcache_flush(fill_buffer, sizeof(fill_buffer));
+	}
+	if (is_cached(r->dst)) arm_dcache_flush_delete(r->dst, r->len);
+	start_chunk(r);
+}
+
+static void dma_memcpy_isr(void)
+{
+	dma.clearInterrupt();
+	dma.clearComplete();
+	uint32_t tail = queue_tail;
+	dma_memcpy_request_t *r = &queue[tail];
+	if (r->len > 0) {
+		start_chunk(r);
+	} else {
+		uint8_t *start = r->start;
+		void (*callback)(void *) = r->callback;
+		// the CPU may have speculatively read the destination
+		if (is_cached(start)) arm_dcache_delete(start, r->total);
+		if (++tail >= DMA_MEMCPY_QUEUE_SIZE) tail = 0;
+		queue_tail = tail;
+		if (--queue_count > 0) start_request(&queue[tail]);
+		if (callback) (*callback)(start);
+	}
+	asm("dsb");
+}
+
+static int queue_request(void *dst, const void *src, size_t len, int fill, void (*callback)(void *))
+{
+	uint32_t head, next;
+
+	if (len == 0) {
+		if (callback) (*callback)(dst);
+		return 1;
+	}
+	if (dma_state != 2) {
+		// only one caller allocates the channel.  An interrupt which
+		// arrives while the main program is doing it finds no channel.
+		__disable_irq();
+		uint8_t state = dma_state;
+		if (state == 0) dma_state = 1;
+		__enable_irq();
+		if (state == 1) return 0;
+		if (state == 0) {
+			// DMAChannel::begin() enables interrupts, so not inside __disable_irq
+			dma.begin();
+			if (!dma.TCD) {
+				dma_state = 0;
+				return 0;
+			}
+			dma.triggerContinuously();
+			dma.attachInterrupt(dma_memcpy_isr);
+			dma_state = 2;
+		}
+	}
+	__disable_irq();
+	if (queue_count >= DMA_MEMCPY_QUEUE_SIZE) {
+		__enable_irq();
+		return 0;
+	}
+	head = queue_head;
+	next = head + 1;
+	if (next >= DMA_MEMCPY_QUEUE_SIZE) next = 0;
+	dma_memcpy_request_t *r = &queue[head];
+	r->dst = (uint8_t *)dst;
+	r->src = (const uint8_t *)src;
+	r->len = len;
+	r->start = (uint8_t *)dst;
+	r->total = len;
+	r->fill = fill;
+	r->callback = callback;
+	queue_head = next;
+	if (queue_count++ == 0) start_request(r);
+	__enable_irq();
+	return 1;
+}
+
+int dma_memcpy_async(void *dst, const void *src, size_t len, void (*callback)(void *dst))
+{
+	return queue_request(dst, src, len, -1, callback);
+}
+
+int dma_memset_async(void *dst, int c, size_t len, void (*callback)(void *dst))
+{
+	return queue_request(dst, NULL, len, (uint8_t)c, callback);
+}
+
+int dma_memcpy_busy(void)
+{
+	return queue_count;
+}
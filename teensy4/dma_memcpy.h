@@ -0,0 +1,64 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2017 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Copy or fill memory using a DMA channel, so the CPU can keep working
+// while large blocks move between OCRAM, DTCM and EXTMEM.  Requests are
+// queued and always run in the order they were made.  The callback (if
+// not NULL) runs from the DMA interrupt after the data is in memory.
+//
+// Caches are handled automatically: the source is flushed when the copy
+// starts, and the destination is deleted before and after the copy.  A
+// destination in cached memory (DMAMEM, EXTMEM) should be aligned to 32
+// bytes and a multiple of 32 bytes long, or nearby data sharing its first
+// and last cache lines must not be written until the callback.  Neither
+// buffer may be written while the copy is in progress.
+//
+// Returns 1 if the request was queued, or 0 if the queue is full or no
+// DMA channel is available.
+
+#ifndef DMA_MEMCPY_QUEUE_SIZE
+#define DMA_MEMCPY_QUEUE_SIZE  8
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+int dma_memcpy_async(void *dst, const void *src, size_t len, void (*callback)(void *dst));
+int dma_memset_async(void *dst, int c, size_t len, void (*callback)(void *dst));
+// number of requests queued or in progress
+int dma_memcpy_busy(void);
+#ifdef __cplusplus
+}
+#endif
@@ -34,10 +34,17 @@
 // know what you're doing.
 
 #include "imxrt.h"
+#include "irq_priority.h"
 #include <avr/eeprom.h>
+#include <avr/pgmspace.h>
 #include <string.h>
 #include "debug/printf.h"
 
+// A copy of the entire EEPROM is kept in RAM, built once by
+// eeprom_initialize(), so reads never need to search the flash.  Comment
+// this out to save E2END+1 bytes of RAM, at the cost of slower reads.
+#define EEPROM_RAM_SHADOW
+
 #if defined(ARDUINO_TEENSY40)
 #define FLASH_BASEADDR 0x601F0000
 #define FLASH_SECTORS  15
@@ -58,24 +65,47 @@
 // https://forum.pjrc.com/threads/57377?p=214566&viewfull=1#post214566
 
 // To be called from LittleFS_Program, any other use at your own risk!
-void eepromemu_flash_write(void *addr, const void *data, uint32_t len);
-void eepromemu_flash_erase_sector(void *addr);
-void eepromemu_flash_erase_32K_block(void *addr);
-void eepromemu_flash_erase_64K_block(void *addr);
+FASTRUN void eepromemu_flash_write(void *addr, const void *data, uint32_t len);
+FASTRUN void eepromemu_flash_erase_sector(void *addr);
+FASTRUN void eepromemu_flash_erase_32K_block(void *addr);
+FASTRUN void eepromemu_flash_erase_64K_block(void *addr);
+
+// Past this many log entries (of 2048), eeprom_compact_idle() will erase
+// and compact a sector ahead of time, so a later write is unlikely to
+// find it full and need to wait for the erase.
+#ifndef EEPROM_COMPACT_THRESHOLD
+#define EEPROM_COMPACT_THRESHOLD 1536
+#endif
 
 static uint8_t initialized=0;
 static uint16_t sector_index[FLASH_SECTORS];
+static uint32_t sector_erases[FLASH_SECTORS];
+#ifdef EEPROM_RAM_SHADOW
+static DMAMEM uint8_t shadow[E2END+1];
+#endif
+
+// EEPROM address for an offset within a sector
+#define SECTOR_ADDR(sector, offset) \
+	(((((offset) >> 2) * FLASH_SECTORS + (sector)) << 2) | ((offset) & 3))
 
 void eeprom_initialize(void)
 {
 	uint32_t sector;
 	//printf("eeprom init\n");
+#ifdef EEPROM_RAM_SHADOW
+	memset(shadow, 0xFF, sizeof(shadow));
+#endif
 	for (sector=0; sector < FLASH_SECTORS; sector++) {
 		const uint16_t *p = (uint16_t *)(FLASH_BASEADDR + sector * 4096);
 		const uint16_t *end = (uint16_t *)(FLASH_BASEADDR + (sector + 1) * 4096);
 		uint16_t index = 0;
 		do {
-			if (*p++ == 0xFFFF) break;
+			uint32_t val = *p++;
+			if (val == 0xFFFF) break;
+#ifdef EEPROM_RAM_SHADOW
+			uint32_t addr = SECTOR_ADDR(sector, val & 255);
+			if (addr <= E2END) shadow[addr] = val >> 8;
+#endif
 			index++;
 		} while (p < end);
 		sector_index[sector] = index;
@@ -92,6 +122,9 @@ uint8_t eeprom_read_byte(const uint8_t *addr_ptr)
 
 	if (addr > E2END) return 0xFF;
 	if (!initialized) eeprom_initialize();
+#ifdef EEPROM_RAM_SHADOW
+	return shadow[addr];
+#endif
 	sector = (addr >> 2) % FLASH_SECTORS;
 	offset = (addr & 3) | (((addr >> 2) / FLASH_SECTORS) << 2);
 	//printf("ee_rd, addr=%u, sector=%u, offset=%u, len=%u\n",
@@ -105,13 +138,110 @@ uint8_t eeprom_read_byte(const uint8_t *addr_ptr)
 	return data;
 }
 
+// program 16 bit log entries, in as few flash operations as possible,
+// but never crossing a 256 byte flash page boundary
+static void flash_write_entries(uint16_t *dest, const uint16_t *src, uint32_t count)
+{
+	while (count > 0) {
+		uint32_t n = (256 - ((uint32_t)dest & 255)) >> 1;
+		if (n > count) n = count;
+		eepromemu_flash_write(dest, src, n * 2);
+		dest += n;
+		src += n;
+		count -= n;
+	}
+}
+
+// get the latest value of all 256 offsets stored in a sector
+static void sector_read(uint32_t sector, uint8_t *buf)
+{
+	const uint16_t *p = (uint16_t *)(FLASH_BASEADDR + sector * 4096);
+	const uint16_t *end = p + sector_index[sector];
+
+	memset(buf, 0xFF, 256);
+	while (p < end) {
+		uint32_t val = *p++;
+		buf[val & 255] = val >> 8;
+	}
+}
+
+// erase a sector and write only the latest value of each offset, with
+// any new entries applied
+static void sector_compact(uint32_t sector, const uint16_t *entries, uint32_t count)
+{
+	uint16_t *p = (uint16_t *)(FLASH_BASEADDR + sector * 4096);
+	uint32_t i, index;
+	uint8_t buf[256];
+	uint16_t compact[256];
+
+	sector_read(sector, buf);
+	for (i=0; i < count; i++) {
+		buf[entries[i] & 255] = entries[i] >> 8;
+	}
+	index = 0;
+	for (i=0; i < 256; i++) {
+		if (buf[i] != 0xFF) compact[index++] = i | (buf[i] << 8);
+	}
+	eepromemu_flash_erase_sector(p);
+	sector_erases[sector]++;
+	flash_write_entries(p, compact, index);
+	sector_index[sector] = index;
+}
+
+// append new entries to a sector, or if they don't fit, compact it
+static void sector_write(uint32_t sector, const uint16_t *entries, uint32_t count)
+{
+	uint16_t *p = (uint16_t *)(FLASH_BASEADDR + sector * 4096);
+
+	if (sector_index[sector] + count <= 2048) {
+		//printf("ee_wr, writing %u\n", count);
+		flash_write_entries(p + sector_index[sector], entries, count);
+		sector_index[sector] = sector_index[sector] + count;
+		return;
+	}
+	//printf("ee_wr, erase then write\n");
+	sector_compact(sector, entries, count);
+}
+
+// Compact the fullest sector past EEPROM_COMPACT_THRESHOLD, if any.  Only
+// one sector is done per call, so the time taken is at most one erase.
+// Returns 1 if a sector was compacted, 0 if none needed it.
+int eeprom_compact_idle(void)
+{
+	uint32_t sector, fullest=0, most=EEPROM_COMPACT_THRESHOLD;
+
+	if (!initialized) eeprom_initialize();
+	for (sector=0; sector < FLASH_SECTORS; sector++) {
+		if (sector_index[sector] > most) {
+			most = sector_index[sector];
+			fullest = sector;
+		}
+	}
+	if (most == EEPROM_COMPACT_THRESHOLD) return 0;
+	sector_compact(fullest, NULL, 0);
+	return 1;
+}
+
+// Number of times a sector was erased since startup, not persistent
+uint32_t eeprom_sector_erases_since_startup(uint32_t sector)
+{
+	if (sector >= FLASH_SECTORS) return 0;
+	return sector_erases[sector];
+}
+
+// Log entries in use by a sector, 0 to 2048
+uint32_t eeprom_sector_used(uint32_t sector)
+{
+	if (sector >= FLASH_SECTORS) return 0;
+	if (!initialized) eeprom_initialize();
+	return sector_index[sector];
+}
+
 void eeprom_write_byte(uint8_t *addr_ptr, uint8_t data)
 {
 	uint32_t addr = (uint32_t)addr_ptr;
-	uint32_t sector, offset, index, i;
-	uint16_t *p, *end;
+	uint32_t sector, offset;
 	uint8_t olddata=0xFF;
-	uint8_t buf[256];
 
 	if (addr > E2END) return;
 	if (!initialized) eeprom_initialize();
@@ -120,42 +250,22 @@ void eeprom_write_byte(uint8_t *addr_ptr, uint8_t data)
 	offset = (addr & 3) | (((addr >> 2) / FLASH_SECTORS) << 2);
 	//printf("ee_wr, addr=%u, sector=%u, offset=%u, len=%u\n",
 		//addr, sector, offset, sector_index[sector]);
-	p = (uint16_t *)(FLASH_BASEADDR + sector * 4096);
-	end = p + sector_index[sector];
+#ifdef EEPROM_RAM_SHADOW
+	olddata = shadow[addr];
+#else
+	const uint16_t *p = (uint16_t *)(FLASH_BASEADDR + sector * 4096);
+	const uint16_t *end = p + sector_index[sector];
 	while (p < end) {
 		uint16_t val = *p++;
 		if ((val & 255) == offset) olddata = val >> 8;
 	}
+#endif
 	if (data == olddata) return;
-	if (sector_index[sector] < 2048) {
-		//printf("ee_wr, writing\n");
-		uint16_t newdata = offset | (data << 8);
-		eepromemu_flash_write(end, &newdata, 2);
-		sector_index[sector] = sector_index[sector] + 1;
-	} else {
-		//printf("ee_wr, erase then write\n");
-		memset(buf, 0xFF, sizeof(buf));
-		p = (uint16_t *)(FLASH_BASEADDR + sector * 4096);
-		end = p + 2048;
-		while (p < end) {
-			uint16_t val = *p++;
-			buf[val & 255] = val >> 8;
-		}
-		buf[offset] = data;
-		p = (uint16_t *)(FLASH_BASEADDR + sector * 4096);
-		eepromemu_flash_erase_sector(p);
-		index = 0;
-		for (i=0; i < 256; i++) {
-			if (buf[i] != 0xFF) {
-				// TODO: combining these to larger write
-				// would (probably) be more efficient
-				uint16_t newval = i | (buf[i] << 8);
-				eepromemu_flash_write(p + index, &newval, 2);
-				index = index + 1;
-			}
-		}
-		sector_index[sector] = index;
-	}
+	uint16_t newdata = offset | (data << 8);
+	sector_write(sector, &newdata, 1);
+#ifdef EEPROM_RAM_SHADOW
+	shadow[addr] = data;
+#endif
 }
 
 uint16_t eeprom_read_word(const uint16_t *addr)
@@ -175,6 +285,19 @@ void eeprom_read_block(void *buf, const void *addr, uint32_t len)
 {
 	const uint8_t *p = (const uint8_t *)addr;
 	uint8_t *dest = (uint8_t *)buf;
+#ifdef EEPROM_RAM_SHADOW
+	uint32_t a = (uint32_t)addr;
+	if (a <= E2END) {
+		uint32_t n = E2END + 1 - a;
+		if (n > len) n = len;
+		if (!initialized) eeprom_initialize();
+		memcpy(dest, shadow + a, n);
+		dest += n;
+		len -= n;
+	}
+	memset(dest, 0xFF, len);
+	return;
+#endif
 	while (len--) {
 		*dest++ = eeprom_read_byte(p++);
 	}
@@ -201,12 +324,53 @@ void eeprom_write_dword(uint32_t *addr, uint32_t value)
 	eeprom_write_byte(p, value >> 24);
 }
 
+// Consecutive groups of 4 bytes are spread across all the sectors, so
+// a block is written one sector at a time: every changed byte which a
+// sector holds is appended to its log together, and a full sector is
+// erased and compacted at most once.
 void eeprom_write_block(const void *buf, void *addr, uint32_t len)
 {
-	uint8_t *p = (uint8_t *)addr;
+	uint32_t first = (uint32_t)addr;
+	uint32_t last, sector, group, count, i;
 	const uint8_t *src = (const uint8_t *)buf;
-	while (len--) {
-		eeprom_write_byte(p++, *src++);
+#ifndef EEPROM_RAM_SHADOW
+	uint8_t olddata[256];
+#endif
+	uint16_t entries[256];
+
+	if (len == 0 || first > E2END) return;
+	if (!initialized) eeprom_initialize();
+	last = first + len - 1;
+	if (last > E2END) last = E2END;
+
+	for (sector=0; sector < FLASH_SECTORS; sector++) {
+		// first group of 4 bytes within the block stored in this sector
+		group = first >> 2;
+		group += (sector + FLASH_SECTORS - group % FLASH_SECTORS) % FLASH_SECTORS;
+		if (group * 4 > last) continue;
+#ifndef EEPROM_RAM_SHADOW
+		sector_read(sector, olddata);
+#endif
+		count = 0;
+		for (; group * 4 <= last; group += FLASH_SECTORS) {
+			for (i=0; i < 4; i++) {
+				uint32_t a = group * 4 + i;
+				if (a < first || a > last) continue;
+				uint32_t offset = i | ((group / FLASH_SECTORS) << 2);
+				uint8_t data = src[a - first];
+#ifdef EEPROM_RAM_SHADOW
+				if (data != shadow[a]) {
+					entries[count++] = offset | (data << 8);
+					shadow[a] = data;
+				}
+#else
+				if (data != olddata[offset]) {
+					entries[count++] = offset | (data << 8);
+				}
+#endif
+			}
+		}
+		if (count > 0) sector_write(sector, entries, count);
 	}
 }
 
@@ -223,10 +387,54 @@ void eeprom_write_block(const void *buf, void *addr, uint32_t len)
 #define PINS1           FLEXSPI_LUT_NUM_PADS_1
 #define PINS4           FLEXSPI_LUT_NUM_PADS_4
 
-static void flash_wait()
+// Code which writes the flash must not run from the flash.  While the
+// flash is busy erasing or programming, it can't be read at all, so any
+// interrupt which uses FLASHMEM code or PROGMEM data would crash.  By
+// default all interrupts stay disabled until the flash is done, which takes
+// milliseconds for a page and up to hundreds of milliseconds for an erase.
+// If IRQ_PRIORITY_FLASH_MASK is set, the wait masks only interrupts at that
+// priority or lower, and the more urgent ones, which must be entirely RAM
+// resident, keep running.
+
+// issue the command in LUT sequence 15 and wait for FlexSPI to send it
+FASTRUN static void flash_command(uint32_t addr)
 {
+	FLEXSPI_IPCR0 = addr;
+	FLEXSPI_IPCR1 = FLEXSPI_IPCR1_ISEQID(15);
+	FLEXSPI_IPCMD = FLEXSPI_IPCMD_TRG;
+	while (!(FLEXSPI_INTR & FLEXSPI_INTR_IPCMDDONE)) ; // wait
+	FLEXSPI_INTR = FLEXSPI_INTR_IPCMDDONE;
+}
+
+// disable interrupts and send write enable, required before every erase or
+// program command
+FASTRUN static void flash_write_enable(void *cache_addr, uint32_t cache_len)
+{
+	__disable_irq();
+	FLEXSPI_LUTKEY = FLEXSPI_LUTKEY_VALUE;
+	FLEXSPI_LUTCR = FLEXSPI_LUTCR_UNLOCK;
+	FLEXSPI_LUT60 = LUT0(CMD_SDR, PINS1, 0x06); // 06 = write enable
+	FLEXSPI_LUT61 = 0;
+	FLEXSPI_LUT62 = 0;
+	FLEXSPI_LUT63 = 0;
+	FLEXSPI_IPCR0 = 0;
+	FLEXSPI_IPCR1 = FLEXSPI_IPCR1_ISEQID(15);
+	FLEXSPI_IPCMD = FLEXSPI_IPCMD_TRG;
+	arm_dcache_delete(cache_addr, cache_len); // purge old data from ARM's cache
+	while (!(FLEXSPI_INTR & FLEXSPI_INTR_IPCMDDONE)) ; // wait
+	FLEXSPI_INTR = FLEXSPI_INTR_IPCMDDONE;
+}
+
+// wait for the flash to finish, then return to normal XIP reads
+FASTRUN static void flash_wait()
+{
+	uint32_t mask = 0;
 	FLEXSPI_LUT60 = LUT0(CMD_SDR, PINS1, 0x05) | LUT1(READ_SDR, PINS1, 1); // 05 = read status
 	FLEXSPI_LUT61 = 0;
+	if (IRQ_PRIORITY_FLASH_MASK > 0) {
+		mask = irq_mask_priority(IRQ_PRIORITY_FLASH_MASK);
+		__enable_irq();
+	}
 	uint8_t status;
 	do {
 		FLEXSPI_IPRXFCR = FLEXSPI_IPRXFCR_CLRIPRXF; // clear rx fifo
@@ -240,25 +448,14 @@ static void flash_wait()
 	} while (status & 1);
 	FLEXSPI_MCR0 |= FLEXSPI_MCR0_SWRESET; // purge stale data from FlexSPI's AHB FIFO
 	while (FLEXSPI_MCR0 & FLEXSPI_MCR0_SWRESET) ; // wait
+	if (IRQ_PRIORITY_FLASH_MASK > 0) irq_restore_priority(mask);
 	__enable_irq();
 }
 
 // write bytes into flash memory (which is already erased to 0xFF)
 void eepromemu_flash_write(void *addr, const void *data, uint32_t len)
 {
-	__disable_irq();
-	FLEXSPI_LUTKEY = FLEXSPI_LUTKEY_VALUE;
-	FLEXSPI_LUTCR = FLEXSPI_LUTCR_UNLOCK;
-	FLEXSPI_IPCR0 = 0;
-	FLEXSPI_LUT60 = LUT0(CMD_SDR, PINS1, 0x06); // 06 = write enable
-	FLEXSPI_LUT61 = 0;
-	FLEXSPI_LUT62 = 0;
-	FLEXSPI_LUT63 = 0;
-	FLEXSPI_IPCR1 = FLEXSPI_IPCR1_ISEQID(15);
-	FLEXSPI_IPCMD = FLEXSPI_IPCMD_TRG;
-	arm_dcache_delete(addr, len); // purge old data from ARM's cache
-	while (!(FLEXSPI_INTR & FLEXSPI_INTR_IPCMDDONE)) ; // wait
-	FLEXSPI_INTR = FLEXSPI_INTR_IPCMDDONE;
+	flash_write_enable(addr, len);
 	FLEXSPI_LUT60 = LUT0(CMD_SDR, PINS1, 0x32) | LUT1(ADDR_SDR, PINS1, 24); // 32 = quad write
 	FLEXSPI_LUT61 = LUT0(WRITE_SDR, PINS4, 1);
 	FLEXSPI_IPTXFCR = FLEXSPI_IPTXFCR_CLRIPTXF; // clear tx fifo
@@ -286,72 +483,24 @@ void eepromemu_flash_write(void *addr, const void *data, uint32_t len)
 // erase a 4K sector
 void eepromemu_flash_erase_sector(void *addr)
 {
-	__disable_irq();
-	FLEXSPI_LUTKEY = FLEXSPI_LUTKEY_VALUE;
-	FLEXSPI_LUTCR = FLEXSPI_LUTCR_UNLOCK;
-	FLEXSPI_LUT60 = LUT0(CMD_SDR, PINS1, 0x06); // 06 = write enable
-	FLEXSPI_LUT61 = 0;
-	FLEXSPI_LUT62 = 0;
-	FLEXSPI_LUT63 = 0;
-	FLEXSPI_IPCR0 = 0;
-	FLEXSPI_IPCR1 = FLEXSPI_IPCR1_ISEQID(15);
-	FLEXSPI_IPCMD = FLEXSPI_IPCMD_TRG;
-	arm_dcache_delete((void *)((uint32_t)addr & 0xFFFFF000), 4096); // purge data from cache
-	while (!(FLEXSPI_INTR & FLEXSPI_INTR_IPCMDDONE)) ; // wait
-	FLEXSPI_INTR = FLEXSPI_INTR_IPCMDDONE;
+	flash_write_enable((void *)((uint32_t)addr & 0xFFFFF000), 4096);
 	FLEXSPI_LUT60 = LUT0(CMD_SDR, PINS1, 0x20) | LUT1(ADDR_SDR, PINS1, 24); // 20 = sector erase
-	FLEXSPI_IPCR0 = (uint32_t)addr & 0x00FFF000;
-	FLEXSPI_IPCR1 = FLEXSPI_IPCR1_ISEQID(15);
-	FLEXSPI_IPCMD = FLEXSPI_IPCMD_TRG;
-	while (!(FLEXSPI_INTR & FLEXSPI_INTR_IPCMDDONE)) ; // wait
-	FLEXSPI_INTR = FLEXSPI_INTR_IPCMDDONE;
+	flash_command((uint32_t)addr & 0x00FFF000);
 	flash_wait();
 }
 
 void eepromemu_flash_erase_32K_block(void *addr)
 {
-	__disable_irq();
-	FLEXSPI_LUTKEY = FLEXSPI_LUTKEY_VALUE;
-	FLEXSPI_LUTCR = FLEXSPI_LUTCR_UNLOCK;
-	FLEXSPI_LUT60 = LUT0(CMD_SDR, PINS1, 0x06); // 06 = write enable
-	FLEXSPI_LUT61 = 0;
-	FLEXSPI_LUT62 = 0;
-	FLEXSPI_LUT63 = 0;
-	FLEXSPI_IPCR0 = 0;
-	FLEXSPI_IPCR1 = FLEXSPI_IPCR1_ISEQID(15);
-	FLEXSPI_IPCMD = FLEXSPI_IPCMD_TRG;
-	arm_dcache_delete((void *)((uint32_t)addr & 0xFFFF8000), 32768); // purge data from cache
-	while (!(FLEXSPI_INTR & FLEXSPI_INTR_IPCMDDONE)) ; // wait
-	FLEXSPI_INTR = FLEXSPI_INTR_IPCMDDONE;
-	FLEXSPI_LUT60 = LUT0(CMD_SDR, PINS1, 0x52) | LUT1(ADDR_SDR, PINS1, 24); // 20 = sector erase
-	FLEXSPI_IPCR0 = (uint32_t)addr & 0x00FF8000;
-	FLEXSPI_IPCR1 = FLEXSPI_IPCR1_ISEQID(15);
-	FLEXSPI_IPCMD = FLEXSPI_IPCMD_TRG;
-	while (!(FLEXSPI_INTR & FLEXSPI_INTR_IPCMDDONE)) ; // wait
-	FLEXSPI_INTR = FLEXSPI_INTR_IPCMDDONE;
+	flash_write_enable((void *)((uint32_t)addr & 0xFFFF8000), 32768);
+	FLEXSPI_LUT60 = LUT0(CMD_SDR, PINS1, 0x52) | LUT1(ADDR_SDR, PINS1, 24); // 52 = 32K block erase
+	flash_command((uint32_t)addr & 0x00FF8000);
 	flash_wait();
 }
 
 void eepromemu_flash_erase_64K_block(void *addr)
 {
-	__disable_irq();
-	FLEXSPI_LUTKEY = FLEXSPI_LUTKEY_VALUE;
-	FLEXSPI_LUTCR = FLEXSPI_LUTCR_UNLOCK;
-	FLEXSPI_LUT60 = LUT0(CMD_SDR, PINS1, 0x06); // 06 = write enable
-	FLEXSPI_LUT61 = 0;
-	FLEXSPI_LUT62 = 0;
-	FLEXSPI_LUT63 = 0;
-	FLEXSPI_IPCR0 = 0;
-	FLEXSPI_IPCR1 = FLEXSPI_IPCR1_ISEQID(15);
-	FLEXSPI_IPCMD = FLEXSPI_IPCMD_TRG;
-	arm_dcache_delete((void *)((uint32_t)addr & 0xFFFF0000), 65536); // purge data from cache
-	while (!(FLEXSPI_INTR & FLEXSPI_INTR_IPCMDDONE)) ; // wait
-	FLEXSPI_INTR = FLEXSPI_INTR_IPCMDDONE;
-	FLEXSPI_LUT60 = LUT0(CMD_SDR, PINS1, 0xD8) | LUT1(ADDR_SDR, PINS1, 24); // 20 = sector erase
-	FLEXSPI_IPCR0 = (uint32_t)addr & 0x00FF0000;
-	FLEXSPI_IPCR1 = FLEXSPI_IPCR1_ISEQID(15);
-	FLEXSPI_IPCMD = FLEXSPI_IPCMD_TRG;
-	while (!(FLEXSPI_INTR & FLEXSPI_INTR_IPCMDDONE)) ; // wait
-	FLEXSPI_INTR = FLEXSPI_INTR_IPCMDDONE;
+	flash_write_enable((void *)((uint32_t)addr & 0xFFFF0000), 65536);
+	FLEXSPI_LUT60 = LUT0(CMD_SDR, PINS1, 0xD8) | LUT1(ADDR_SDR, PINS1, 24); // D8 = 64K block erase
+	flash_command((uint32_t)addr & 0x00FF0000);
 	flash_wait();
 }
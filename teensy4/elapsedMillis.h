@@ -77,5 +77,31 @@ public:
 	elapsedMicros operator + (unsigned long val) const { elapsedMicros r(*this); r.us -= val; return r; }
 };
 
+// nanos() is 64 bits, so elapsedNanos does not wrap
+class elapsedNanos
+{
+private:
+	uint64_t ns;
+public:
+	elapsedNanos(void) { ns = nanos(); }
+	elapsedNanos(uint64_t val) { ns = nanos() - val; }
+	elapsedNanos(const elapsedNanos &orig) { ns = orig.ns; }
+	operator uint64_t () const { return nanos() - ns; }
+	elapsedNanos & operator = (const elapsedNanos &rhs) { ns = rhs.ns; return *this; }
+	elapsedNanos & operator = (uint64_t val) { ns = nanos() - val; return *this; }
+	elapsedNanos & operator -= (uint64_t val)      { ns += val ; return *this; }
+	elapsedNanos & operator += (uint64_t val)      { ns -= val ; return *this; }
+	elapsedNanos operator - (int val) const           { elapsedNanos r(*this); r.ns += val; return r; }
+	elapsedNanos operator - (unsigned int val) const  { elapsedNanos r(*this); r.ns += val; return r; }
+	elapsedNanos operator - (long val) const          { elapsedNanos r(*this); r.ns += val; return r; }
+	elapsedNanos operator - (unsigned long val) const { elapsedNanos r(*this); r.ns += val; return r; }
+	elapsedNanos operator - (unsigned long long val) const { elapsedNanos r(*this); r.ns += val; return r; }
+	elapsedNanos operator + (int val) const           { elapsedNanos r(*this); r.ns -= val; return r; }
+	elapsedNanos operator + (unsigned int val) const  { elapsedNanos r(*this); r.ns -= val; return r; }
+	elapsedNanos operator + (long val) const          { elapsedNanos r(*this); r.ns -= val; return r; }
+	elapsedNanos operator + (unsigned long val) const { elapsedNanos r(*this); r.ns -= val; return r; }
+	elapsedNanos operator + (unsigned long long val) const { elapsedNanos r(*this); r.ns -= val; return r; }
+};
+
 #endif // __cplusplus
 #endif // elapsedMillis_h
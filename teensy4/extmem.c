@@ -2,8 +2,10 @@
 // but automatically fall back to internal RAM if external RAM can't be used.
 
 #include <stdlib.h>
+#include <string.h>
 #include "smalloc.h"
 #include "wiring.h"
+#include "heap_profile.h"
 
 #if defined(ARDUINO_TEENSY41)
 // Teensy 4.1 external RAM address range is 0x70000000 to 0x7FFFFFFF
@@ -14,15 +16,24 @@
 
 void *extmem_malloc(size_t size)
 {
+	void *site = heap_profile_enter(__builtin_return_address(0));
+	void *ptr = NULL;
 #ifdef HAS_EXTRAM
-	void *ptr = sm_malloc_pool(&extmem_smalloc_pool, size);
-	if (ptr) return ptr;
+	ptr = sm_malloc_pool(&extmem_smalloc_pool, size);
 #endif
-	return malloc(size);
+	if (!ptr) ptr = malloc(size);
+	heap_profile_leave(site);
+	return ptr;
 }
 
+static size_t isr_block_size(void *ptr);
+
 void extmem_free(void *ptr)
 {
+	if (isr_block_size(ptr)) {
+		extmem_free_isr(ptr);
+		return;
+	}
 #ifdef HAS_EXTRAM
 	if (IS_EXTMEM(ptr)) {
 		sm_free_pool(&extmem_smalloc_pool, ptr);
@@ -34,17 +45,131 @@ void extmem_free(void *ptr)
 
 void *extmem_calloc(size_t nmemb, size_t size)
 {
-	return extmem_malloc(nmemb * size);
+	void *site = heap_profile_enter(__builtin_return_address(0));
+	void *ptr = extmem_malloc(nmemb * size);
+	heap_profile_leave(site);
+	return ptr;
 }
 
 void *extmem_realloc(void *ptr, size_t size)
 {
+	void *site = heap_profile_enter(__builtin_return_address(0));
+	size_t oldsize = isr_block_size(ptr);
+	if (oldsize) {
+		// a reserved block can't grow, so move larger data to the heap
+		if (size == 0) {
+			extmem_free_isr(ptr);
+			ptr = NULL;
+		} else if (size > oldsize) {
+			void *newptr = extmem_malloc(size);
+			if (newptr) {
+				memcpy(newptr, ptr, oldsize);
+				extmem_free_isr(ptr);
+			}
+			ptr = newptr;
+		}
+		heap_profile_leave(site);
+		return ptr;
+	}
 #ifdef HAS_EXTRAM
 	if (IS_EXTMEM(ptr)) {
-		return sm_realloc_pool(&extmem_smalloc_pool, ptr, size);
+		ptr = sm_realloc_pool(&extmem_smalloc_pool, ptr, size);
+		heap_profile_leave(site);
+		return ptr;
 	}
 #endif
-	return realloc(ptr, size);
+	ptr = realloc(ptr, size);
+	heap_profile_leave(site);
+	return ptr;
+}
+
+
+// Blocks for use from interrupts are reserved in advance, a single
+// array for each size, each with a free list linked through the first
+// word of its free blocks.  Sizes are kept in increasing order, so the
+// smallest which fits is used first.
+#define EXTMEM_ISR_POOLS 8
+
+struct extmem_isr_pool {
+	char *base;
+	char *end;
+	size_t size;  // block size, multiple of 32
+	void *free;
+};
+static struct extmem_isr_pool isr_pool[EXTMEM_ISR_POOLS];
+
+static inline uint32_t irq_save(void)
+{
+	uint32_t primask;
+	__asm__ volatile("mrs %0, primask\n" : "=r" (primask)::);
+	__disable_irq();
+	return primask;
+}
+
+static inline void irq_restore(uint32_t primask)
+{
+	if (primask == 0) __enable_irq();
+}
+
+int extmem_isr_reserve(size_t size, unsigned int count)
+{
+	if (size == 0 || count == 0) return 0;
+	if (isr_pool[EXTMEM_ISR_POOLS-1].base) return 0; // all in use
+	size = (size + 31) & ~31;
+	char *mem = (char *)extmem_malloc(size * count + 31);
+	if (!mem) return 0;
+	char *base = (char *)(((uint32_t)mem + 31) & ~31);
+	void *list = NULL;
+	for (int i = count - 1; i >= 0; i--) {
+		void *block = base + i * size;
+		*(void **)block = list;
+		list = block;
+	}
+	uint32_t irq = irq_save();
+	int n = EXTMEM_ISR_POOLS - 1;
+	while (n > 0 && (!isr_pool[n-1].base || isr_pool[n-1].size > size)) {
+		if (isr_pool[n-1].base) isr_pool[n] = isr_pool[n-1];
+		n--;
+	}
+	isr_pool[n].base = base;
+	isr_pool[n].end = base + size * count;
+	isr_pool[n].size = size;
+	isr_pool[n].free = list;
+	irq_restore(irq);
+	return 1;
+}
+
+void *extmem_malloc_isr(size_t size)
+{
+	for (int i = 0; i < EXTMEM_ISR_POOLS && isr_pool[i].base; i++) {
+		if (isr_pool[i].size < size) continue;
+		uint32_t irq = irq_save();
+		void *block = isr_pool[i].free;
+		if (block) isr_pool[i].free = *(void **)block;
+		irq_restore(irq);
+		if (block) return block;
+	}
+	return NULL;
 }
 
+void extmem_free_isr(void *ptr)
+{
+	for (int i = 0; i < EXTMEM_ISR_POOLS && isr_pool[i].base; i++) {
+		if ((char *)ptr >= isr_pool[i].base && (char *)ptr < isr_pool[i].end) {
+			uint32_t irq = irq_save();
+			*(void **)ptr = isr_pool[i].free;
+			isr_pool[i].free = ptr;
+			irq_restore(irq);
+			return;
+		}
+	}
+}
 
+// the block size if ptr is one of the reserved blocks, otherwise 0
+static size_t isr_block_size(void *ptr)
+{
+	for (int i = 0; i < EXTMEM_ISR_POOLS && isr_pool[i].base; i++) {
+		if ((char *)ptr >= isr_pool[i].base && (char *)ptr < isr_pool[i].end) return isr_pool[i].size;
+	}
+	return 0;
+}
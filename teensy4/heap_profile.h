@@ -0,0 +1,94 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2024 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef heap_profile_h_
+#define heap_profile_h_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Hooks called by malloc, smalloc and the other allocators to feed the
+// HeapProfile allocation tracker.  While tracking is off (the default)
+// each hook costs only a test of heap_profile_enabled.
+extern volatile uint8_t heap_profile_enabled;
+extern void *heap_profile_site;
+
+void heap_profile_record_alloc(const void *ptr, size_t size, void *caller);
+void heap_profile_record_free(const void *ptr, size_t size);
+void heap_profile_record_resize(const void *ptr, size_t oldsize, size_t newsize);
+
+static inline void heap_profile_alloc(const void *ptr, size_t size, void *caller)
+{
+	if (heap_profile_enabled && ptr) heap_profile_record_alloc(ptr, size, caller);
+}
+
+static inline void heap_profile_free(const void *ptr, size_t size)
+{
+	if (heap_profile_enabled && ptr) heap_profile_record_free(ptr, size);
+}
+
+static inline void heap_profile_resize(const void *ptr, size_t oldsize, size_t newsize)
+{
+	if (heap_profile_enabled) heap_profile_record_resize(ptr, oldsize, newsize);
+}
+
+// Public allocation functions which call other allocators note their own
+// caller, so the allocation is credited to the code which asked for it
+// rather than to the wrapper.  Each enter must be paired with a leave.
+// Only the main program notes its caller.  Interrupts may allocate while
+// it's set, so they leave it alone and are credited to their own caller.
+static inline int heap_profile_in_isr(void)
+{
+	uint32_t ipsr;
+	__asm__ volatile("mrs %0, ipsr\n" : "=r" (ipsr)::);
+	return ipsr != 0;
+}
+
+static inline void * heap_profile_enter(void *caller)
+{
+	void *prev = heap_profile_site;
+	if (!prev && !heap_profile_in_isr()) heap_profile_site = caller;
+	return prev;
+}
+
+static inline void heap_profile_leave(void *prev)
+{
+	heap_profile_site = prev;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -5157,6 +5157,13 @@ typedef struct {
 #define FLEXSPI_AHBRXBUFCR0_MSTRID_MASK		((uint32_t)((0x0F) << 16))
 #define FLEXSPI_AHBRXBUFCR0_BUFSZ(n)		((uint32_t)(((n) & 0xFF) << 0))
 #define FLEXSPI_AHBRXBUFCR0_BUFSZ_MASK		((uint32_t)((0xFF) << 0))
+// FlexSPI2 AHB read buffer for one bus master, see extmem_ahb_buffers()
+typedef struct {
+	uint8_t master;		// AHB master ID
+	uint8_t priority;	// 0 to 3, higher is served first
+	uint8_t prefetch;	// 1 to read ahead, if EXTMEM_PREFETCH is enabled
+	uint16_t size;		// bytes, a multiple of 8, up to 2040
+} extmem_ahb_buffer_t;
 #define FLEXSPI_FLSHA1CR0		(IMXRT_FLEXSPI.offset060)
 #define FLEXSPI_FLSHA2CR0		(IMXRT_FLEXSPI.offset064)
 #define FLEXSPI_FLSHB1CR0		(IMXRT_FLEXSPI.offset068)
@@ -9752,8 +9759,22 @@ These register are used by the ROM code and should not be used by application so
 #define NVIC_GET_PRIORITY(irqnum) (*((uint8_t *)0xE000E400 + (irqnum)))
 
 
+#ifdef IRQ_LATENCY_PROFILE
+// time interrupts stay disabled, see IRQLatency.h
+#ifdef __cplusplus
+extern "C" {
+#endif
+void irq_latency_disable(void);
+void irq_latency_enable(void);
+#ifdef __cplusplus
+}
+#endif
+#define __disable_irq() irq_latency_disable();
+#define __enable_irq()  irq_latency_enable();
+#else
 #define __disable_irq() __asm__ volatile("CPSID i":::"memory");
 #define __enable_irq()  __asm__ volatile("CPSIE i":::"memory");
+#endif
 
 
 // System Control Space (SCS), ARMv7 ref manual, B3.2, page 708
@@ -9856,6 +9877,18 @@ These register are used by the ROM code and should not be used by application so
 #define ARM_DWT_CTRL            (*(volatile uint32_t *)0xE0001000) // DWT control register
 #define ARM_DWT_CTRL_CYCCNTENA          (1 << 0)                // Enable cycle count
 #define ARM_DWT_CYCCNT          (*(volatile uint32_t *)0xE0001004) // Cycle count register
+#define ARM_DWT_CTRL_CPIEVTENA          (1 << 17)               // Enable CPI count
+#define ARM_DWT_CTRL_EXCEVTENA          (1 << 18)               // Enable exception overhead count
+#define ARM_DWT_CTRL_SLEEPEVTENA        (1 << 19)               // Enable sleep count
+#define ARM_DWT_CTRL_LSUEVTENA          (1 << 20)               // Enable load store unit count
+#define ARM_DWT_CTRL_FOLDEVTENA         (1 << 21)               // Enable folded instruction count
+#define ARM_DWT_CTRL_NOPRFCNT           (1 << 24)               // Profiling counters not implemented
+#define ARM_DWT_CPICNT          (*(volatile uint32_t *)0xE0001008) // 8 bit, extra instruction cycles
+#define ARM_DWT_EXCCNT          (*(volatile uint32_t *)0xE000100C) // 8 bit, exception overhead cycles
+#define ARM_DWT_SLEEPCNT        (*(volatile uint32_t *)0xE0001010) // 8 bit, sleep cycles
+#define ARM_DWT_LSUCNT          (*(volatile uint32_t *)0xE0001014) // 8 bit, extra load store cycles
+#define ARM_DWT_FOLDCNT         (*(volatile uint32_t *)0xE0001018) // 8 bit, folded instructions
+#define ARM_DWT_LAR             (*(volatile uint32_t *)0xE0001FB0) // Lock access, write 0xC5ACCE55
 
 #define SCB_MPU_TYPE		(*(volatile uint32_t *)0xE000ED90) // 
 #define SCB_MPU_CTRL		(*(volatile uint32_t *)0xE000ED94) // 
@@ -9877,6 +9910,22 @@ These register are used by the ROM code and should not be used by application so
 #define SCB_MPU_RASR_SRD(n)		((uint32_t)(((n) & 255) << 8))
 #define SCB_MPU_RASR_SIZE(n)		((uint32_t)(((n) & 31) << 1))
 #define SCB_MPU_RASR_ENABLE		((uint32_t)(1<<0))
+// Memory types and access for extra MPU regions, see startup_mpu_regions()
+#define MPU_MEM_NOCACHE			(SCB_MPU_RASR_TEX(1))
+#define MPU_MEM_CACHE_WT		(SCB_MPU_RASR_TEX(0) | SCB_MPU_RASR_C)
+#define MPU_MEM_CACHE_WB		(SCB_MPU_RASR_TEX(0) | SCB_MPU_RASR_C | SCB_MPU_RASR_B)
+#define MPU_MEM_CACHE_WBWA		(SCB_MPU_RASR_TEX(1) | SCB_MPU_RASR_C | SCB_MPU_RASR_B)
+#define MPU_DEV_NOCACHE			(SCB_MPU_RASR_TEX(2))
+#define MPU_READWRITE			(SCB_MPU_RASR_AP(3))
+#define MPU_READONLY			(SCB_MPU_RASR_AP(7))
+#define MPU_NOACCESS			(SCB_MPU_RASR_AP(0))
+#define MPU_NOEXEC			(SCB_MPU_RASR_XN)
+// size must be a power of 2, at least 32 bytes, and the address a multiple of it
+#define MPU_SIZE(bytes)			(SCB_MPU_RASR_SIZE(__builtin_ctz(bytes) - 1) | SCB_MPU_RASR_ENABLE)
+typedef struct {
+	uint32_t addr;
+	uint32_t attr;	// MPU_MEM_xxx | MPU_READxxx | MPU_SIZE(n), optional MPU_NOEXEC
+} mpu_region_t;
 #define SCB_MPU_RBAR_A1		(*(volatile uint32_t *)0xE000EDA4) // 
 #define SCB_MPU_RASR_A1		(*(volatile uint32_t *)0xE000EDA8) // 
 #define SCB_MPU_RBAR_A2		(*(volatile uint32_t *)0xE000EDAC) // 
@@ -9999,3 +10048,9 @@ struct crashreport_breadcrumbs_struct {
 	uint32_t checksum; // currently unused
 };
 
+// Health counters stored in the top 128 bytes of OCRAM (at 0x2027FFE0)
+struct crashreport_counters_struct {
+	uint32_t value[7];  // CRASHREPORT_COUNTER_*
+	uint32_t checksum;  // sum of values + magic
+};
+
@@ -11,8 +11,13 @@
 #define ISR_INDEX   6
 #define EDGE_INDEX  7
 
-static void dummy_isr() {};
+static void dummy_isr(void *arg) {};
 typedef void (*voidFuncPtr)(void);
+typedef void (*voidFuncArgPtr)(void *);
+
+// Functions attached without an argument are stored with a cast.  The ARM
+// calling convention passes the argument in r0, which they simply ignore,
+// so a single indirect call serves both kinds of function.
 
 // TODO: Use of Fast GPIO6 - GPIO9 probably breaks everything about attachInterrupt()
 
@@ -22,21 +27,49 @@ typedef void (*voidFuncPtr)(void);
 #define CORE_MAX_PIN_PORT3 31
 #define CORE_MAX_PIN_PORT4 31
 
-voidFuncPtr isr_table_gpio1[CORE_MAX_PIN_PORT1+1] = { [0 ... CORE_MAX_PIN_PORT1] = dummy_isr };
-voidFuncPtr isr_table_gpio2[CORE_MAX_PIN_PORT2+1] = { [0 ... CORE_MAX_PIN_PORT2] = dummy_isr };
-voidFuncPtr isr_table_gpio3[CORE_MAX_PIN_PORT3+1] = { [0 ... CORE_MAX_PIN_PORT3] = dummy_isr };
-voidFuncPtr isr_table_gpio4[CORE_MAX_PIN_PORT4+1] = { [0 ... CORE_MAX_PIN_PORT4] = dummy_isr };
+voidFuncArgPtr isr_table_gpio1[CORE_MAX_PIN_PORT1+1] = { [0 ... CORE_MAX_PIN_PORT1] = dummy_isr };
+voidFuncArgPtr isr_table_gpio2[CORE_MAX_PIN_PORT2+1] = { [0 ... CORE_MAX_PIN_PORT2] = dummy_isr };
+voidFuncArgPtr isr_table_gpio3[CORE_MAX_PIN_PORT3+1] = { [0 ... CORE_MAX_PIN_PORT3] = dummy_isr };
+voidFuncArgPtr isr_table_gpio4[CORE_MAX_PIN_PORT4+1] = { [0 ... CORE_MAX_PIN_PORT4] = dummy_isr };
+void *isr_context_gpio1[CORE_MAX_PIN_PORT1+1];
+void *isr_context_gpio2[CORE_MAX_PIN_PORT2+1];
+void *isr_context_gpio3[CORE_MAX_PIN_PORT3+1];
+void *isr_context_gpio4[CORE_MAX_PIN_PORT4+1];
+
+// Uncomment to measure CPU cycles from the start of the GPIO interrupt
+// to the call of each pin's function, read with interruptDispatchCycles()
+//#define INTERRUPT_DISPATCH_STATS
+
+#ifdef INTERRUPT_DISPATCH_STATS
+static uint32_t dispatch_last = 0;
+static uint32_t dispatch_max = 0;
+#define DISPATCH_BEGIN()  uint32_t dispatch_begin = ARM_DWT_CYCCNT
+#define DISPATCH_MEASURE() do { \
+	uint32_t cycles = ARM_DWT_CYCCNT - dispatch_begin; \
+	dispatch_last = cycles; \
+	if (cycles > dispatch_max) dispatch_max = cycles; \
+} while (0)
+#else
+#define DISPATCH_BEGIN()
+#define DISPATCH_MEASURE()
+#endif
 
 #if defined(__IMXRT1062__)
+#ifdef INTERRUPT_DISPATCH_STATS
+FASTRUN static inline __attribute__((always_inline))
+inline void irq_anyport(volatile uint32_t *gpio, voidFuncArgPtr *table, void **context, uint32_t dispatch_begin)
+#else
 FASTRUN static inline __attribute__((always_inline))
-inline void irq_anyport(volatile uint32_t *gpio, voidFuncPtr *table)
+inline void irq_anyport(volatile uint32_t *gpio, voidFuncArgPtr *table, void **context)
+#endif
 {
 	uint32_t status = gpio[ISR_INDEX] & gpio[IMR_INDEX];
 	if (status) {
 		gpio[ISR_INDEX] = status;
 		while (status) {
 			uint32_t index = __builtin_ctz(status);
-			table[index]();
+			DISPATCH_MEASURE();
+			table[index](context[index]);
 			status = status & ~(1 << index);
 			//status = status & (status - 1);
 		}
@@ -46,15 +79,109 @@ inline void irq_anyport(volatile uint32_t *gpio, voidFuncPtr *table)
 FASTRUN
 void irq_gpio6789(void)
 {
-	irq_anyport(&GPIO6_DR, isr_table_gpio1);
-	irq_anyport(&GPIO7_DR, isr_table_gpio2);
-	irq_anyport(&GPIO8_DR, isr_table_gpio3);
-	irq_anyport(&GPIO9_DR, isr_table_gpio4);
+	DISPATCH_BEGIN();
+#ifdef INTERRUPT_DISPATCH_STATS
+	irq_anyport(&GPIO6_DR, isr_table_gpio1, isr_context_gpio1, dispatch_begin);
+	irq_anyport(&GPIO7_DR, isr_table_gpio2, isr_context_gpio2, dispatch_begin);
+	irq_anyport(&GPIO8_DR, isr_table_gpio3, isr_context_gpio3, dispatch_begin);
+	irq_anyport(&GPIO9_DR, isr_table_gpio4, isr_context_gpio4, dispatch_begin);
+#else
+	irq_anyport(&GPIO6_DR, isr_table_gpio1, isr_context_gpio1);
+	irq_anyport(&GPIO7_DR, isr_table_gpio2, isr_context_gpio2);
+	irq_anyport(&GPIO8_DR, isr_table_gpio3, isr_context_gpio3);
+	irq_anyport(&GPIO9_DR, isr_table_gpio4, isr_context_gpio4);
+#endif
+}
+
+// attachInterruptDirect() moves a pin from fast GPIO6-9 to its normal
+// GPIO1-4 twin, which has its own interrupt vector for each half of the
+// port.  Only one pin may use each half, so the vector can go straight
+// to a tiny handler which clears that pin's flag and calls the function,
+// without scanning all 4 fast ports.
+static IMXRT_GPIO_t * const direct_gpio[4] = {
+	&IMXRT_GPIO1, &IMXRT_GPIO2, &IMXRT_GPIO3, &IMXRT_GPIO4
+};
+static uint32_t direct_mask[8];
+static voidFuncPtr direct_function[8];
+
+#define DIRECT_ISR(n) \
+FASTRUN static void irq_direct##n(void) \
+{ \
+	DISPATCH_BEGIN(); \
+	direct_gpio[(n) >> 1]->ISR = direct_mask[n]; \
+	DISPATCH_MEASURE(); \
+	direct_function[n](); \
+	asm("dsb"); \
 }
+DIRECT_ISR(0)
+DIRECT_ISR(1)
+DIRECT_ISR(2)
+DIRECT_ISR(3)
+DIRECT_ISR(4)
+DIRECT_ISR(5)
+DIRECT_ISR(6)
+DIRECT_ISR(7)
+
+static const voidFuncPtr direct_isr[8] = {
+	irq_direct0, irq_direct1, irq_direct2, irq_direct3,
+	irq_direct4, irq_direct5, irq_direct6, irq_direct7
+};
 
 #endif
 
+static int gpio_port_index(volatile uint32_t *gpio)
+{
+	switch((uint32_t)gpio) {
+		case (uint32_t)&GPIO6_DR: return 0;
+		case (uint32_t)&GPIO7_DR: return 1;
+		case (uint32_t)&GPIO8_DR: return 2;
+		case (uint32_t)&GPIO9_DR: return 3;
+		case (uint32_t)&GPIO1_DR: return 0;
+		case (uint32_t)&GPIO2_DR: return 1;
+		case (uint32_t)&GPIO3_DR: return 2;
+		case (uint32_t)&GPIO4_DR: return 3;
+	}
+	return -1;
+}
+
+static int gpio_icr(int mode)
+{
+	switch (mode) {
+		case CHANGE:  return 0;
+		case RISING:  return 2;
+		case FALLING: return 3;
+		case LOW:     return 0;
+		case HIGH:    return 1;
+	}
+	return -1;
+}
+
+// set up a pin's edge or level detection on either GPIO port
+static void gpio_irq_config(volatile uint32_t *gpio, uint32_t mask, int mode, uint32_t icr)
+{
+	uint32_t index = __builtin_ctz(mask);
+	if (mode == CHANGE) {
+		gpio[EDGE_INDEX] |= mask;
+	} else {
+		gpio[EDGE_INDEX] &= ~mask;
+		if (index < 16) {
+			uint32_t shift = index * 2;
+			gpio[ICR1_INDEX] = (gpio[ICR1_INDEX] & ~(3 << shift)) | (icr << shift);
+		} else {
+			uint32_t shift = (index - 16) * 2;
+			gpio[ICR2_INDEX] = (gpio[ICR2_INDEX] & ~(3 << shift)) | (icr << shift);
+		}
+	}
+}
+
 void attachInterrupt(uint8_t pin, void (*function)(void), int mode)
+{
+	attachInterruptArg(pin, (voidFuncArgPtr)function, NULL, mode);
+}
+
+// As attachInterrupt(), but the function is called with context, so
+// drivers can attach member functions without a static trampoline.
+void attachInterruptArg(uint8_t pin, void (*function)(void *), void *context, int mode)
 {
 	if (pin >= CORE_NUM_DIGITAL) return;
 	//printf("attachInterrupt, pin=%u\n", pin);
@@ -63,41 +190,44 @@ void attachInterrupt(uint8_t pin, void (*function)(void), int mode)
 	//volatile uint32_t *pad = portControlRegister(pin);
 	uint32_t mask = digitalPinToBitMask(pin);
 
-	voidFuncPtr *table;
+	voidFuncArgPtr *table;
+	void **ctable;
 
 #if defined(__IMXRT1062__)
 
-	switch((uint32_t)gpio) {
-		case (uint32_t)&GPIO6_DR:
+	switch (gpio_port_index(gpio)) {
+		case 0:
 			table = isr_table_gpio1;
+			ctable = isr_context_gpio1;
 			break;
-		case (uint32_t)&GPIO7_DR:
+		case 1:
 			table = isr_table_gpio2;
+			ctable = isr_context_gpio2;
 			break;
-		case (uint32_t)&GPIO8_DR:
+		case 2:
 			table = isr_table_gpio3;
+			ctable = isr_context_gpio3;
 			break;
-		case (uint32_t)&GPIO9_DR:
+		case 3:
 			table = isr_table_gpio4;
+			ctable = isr_context_gpio4;
 			break;
 		default:
 			return;
 	}
+	detachInterrupt(pin); // in case attachInterruptDirect() used it
+	// Only GPIO6-9 interrupts are dispatched here.  A pin still on GPIO1-4
+	// was moved with pinFastGPIO(), usually for DMA, so it isn't taken back.
+	if (!pinIsFastGPIO(pin)) return;
+	gpio = portOutputRegister(pin);
 
 	attachInterruptVector(IRQ_GPIO6789, &irq_gpio6789);
 	NVIC_ENABLE_IRQ(IRQ_GPIO6789);
 
 #endif
 
-	uint32_t icr;
-	switch (mode) {
-		case CHANGE:  icr = 0; break;
-		case RISING:  icr = 2; break;
-		case FALLING: icr = 3; break;
-		case LOW:     icr = 0; break;
-		case HIGH:    icr = 1; break;
-		default: return;
-	}
+	int icr = gpio_icr(mode);
+	if (icr < 0) return;
 
 	// TODO: global interrupt disable to protect these read-modify-write accesses?
 	gpio[IMR_INDEX] &= ~mask;	// disable interrupt
@@ -105,26 +235,83 @@ void attachInterrupt(uint8_t pin, void (*function)(void), int mode)
 	gpio[GDIR_INDEX] &= ~mask;	// pin to input mode
 	uint32_t index = __builtin_ctz(mask);
 	table[index] = function;
-	if (mode == CHANGE) {
-		gpio[EDGE_INDEX] |= mask;
-	} else {
-		gpio[EDGE_INDEX] &= ~mask;
-		if (index < 16) {
-			uint32_t shift = index * 2;
-			gpio[ICR1_INDEX] = (gpio[ICR1_INDEX] & ~(3 << shift)) | (icr << shift);
-		} else {
-			uint32_t shift = (index - 16) * 2;
-			gpio[ICR2_INDEX] = (gpio[ICR2_INDEX] & ~(3 << shift)) | (icr << shift);
-		}
-	}
+	ctable[index] = context;
+	gpio_irq_config(gpio, mask, mode, icr);
 	gpio[ISR_INDEX] = mask;  // clear any prior pending interrupt
 	gpio[IMR_INDEX] |= mask; // enable interrupt
 }
 
+// Attach with the lowest possible latency.  Returns 1 if the pin got its
+// own interrupt vector, or 0 if another pin in the same group of 16 is
+// already direct, in which case the normal attachInterrupt() is used.
+// While attached, the pin is controlled by GPIO1-4, so constant pin
+// digitalReadFast() on it does not work until detachInterrupt().
+int attachInterruptDirect(uint8_t pin, void (*function)(void), int mode)
+{
+#if defined(__IMXRT1062__)
+	if (pin >= CORE_NUM_DIGITAL) return 0;
+	int icr = gpio_icr(mode);
+	if (icr < 0) return 0;
+	uint32_t mask = digitalPinToBitMask(pin);
+	int port = gpio_port_index(portOutputRegister(pin));
+	if (port < 0) return 0;
+	uint32_t index = __builtin_ctz(mask);
+	int slot = port * 2 + (index >> 4);
+	if (direct_mask[slot] && direct_mask[slot] != mask) {
+		attachInterrupt(pin, function, mode);
+		return 0;
+	}
+	detachInterrupt(pin);
+	pinFastGPIO(pin, 0);
+	volatile uint32_t *gpio = &direct_gpio[port]->DR;
+	gpio[IMR_INDEX] &= ~mask;
+	*portConfigRegister(pin) = 5;
+	gpio[GDIR_INDEX] &= ~mask;
+	gpio_irq_config(gpio, mask, mode, icr);
+	direct_mask[slot] = mask;
+	direct_function[slot] = function;
+	int irq = IRQ_GPIO1_0_15 + slot;
+	attachInterruptVector(irq, direct_isr[slot]);
+	NVIC_ENABLE_IRQ(irq);
+	gpio[ISR_INDEX] = mask;
+	gpio[IMR_INDEX] |= mask;
+	return 1;
+#else
+	attachInterrupt(pin, function, mode);
+	return 0;
+#endif
+}
+
 void detachInterrupt(uint8_t pin)
 {
 	if (pin >= CORE_NUM_DIGITAL) return;
 	volatile uint32_t *gpio = portOutputRegister(pin);
 	uint32_t mask = digitalPinToBitMask(pin);
 	gpio[IMR_INDEX] &= ~mask;
+#if defined(__IMXRT1062__)
+	int port = gpio_port_index(gpio);
+	if (port < 0) return;
+	int slot = port * 2 + (__builtin_ctz(mask) >> 4);
+	if (direct_mask[slot] == mask) {
+		direct_gpio[port]->IMR &= ~mask;
+		NVIC_DISABLE_IRQ(IRQ_GPIO1_0_15 + slot);
+		pinFastGPIO(pin, 1);
+		direct_mask[slot] = 0;
+	}
+#endif
+}
+
+// CPU cycles from GPIO interrupt entry to calling the pin's function,
+// for the most recent interrupt, and the maximum seen since the last
+// call with reset.  Always 0 unless INTERRUPT_DISPATCH_STATS is defined.
+uint32_t interruptDispatchCycles(uint32_t *max, int reset)
+{
+#ifdef INTERRUPT_DISPATCH_STATS
+	if (max) *max = dispatch_max;
+	if (reset) dispatch_max = 0;
+	return dispatch_last;
+#else
+	if (max) *max = 0;
+	return 0;
+#endif
 }
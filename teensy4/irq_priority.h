@@ -0,0 +1,106 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+// Interrupt priority plan.  0 is the highest priority and 255 the lowest.
+// Only the upper 4 bits are implemented, so there are 16 levels.  Drivers
+// take their priority from these, rather than each picking a number, so
+// the whole plan is visible and can be changed in one place.  Any of them
+// may be redefined on the compiler command line.
+//
+//    0 - 16    real time user code, never masked by the core library
+//   32         systick and PendSV, millis() and MillisTimer
+//   64         hardware serial, with small FIFOs which overflow quickly
+//  128         USB, DMA, timers, pins and everything else by default
+//  208         audio library update
+//  224         background, like the temperature monitor
+#ifndef IRQ_PRIORITY_REALTIME
+#define IRQ_PRIORITY_REALTIME     16
+#endif
+#ifndef IRQ_PRIORITY_SYSTICK
+#define IRQ_PRIORITY_SYSTICK      32
+#endif
+#ifndef IRQ_PRIORITY_SERIAL
+#define IRQ_PRIORITY_SERIAL       64
+#endif
+#ifndef IRQ_PRIORITY_DEFAULT
+#define IRQ_PRIORITY_DEFAULT      128
+#endif
+#ifndef IRQ_PRIORITY_USB
+#define IRQ_PRIORITY_USB          IRQ_PRIORITY_DEFAULT
+#endif
+#ifndef IRQ_PRIORITY_TIMER
+#define IRQ_PRIORITY_TIMER        IRQ_PRIORITY_DEFAULT
+#endif
+#ifndef IRQ_PRIORITY_AUDIO_UPDATE
+#define IRQ_PRIORITY_AUDIO_UPDATE 208
+#endif
+#ifndef IRQ_PRIORITY_BACKGROUND
+#define IRQ_PRIORITY_BACKGROUND   224
+#endif
+
+// While the flash is erased or programmed, by EEPROM writes or
+// LittleFS_Program, the flash can't be read until it finishes.  By default
+// (0) all interrupts are disabled for the whole operation, which may take
+// tens of milliseconds for an erase.  Setting a priority here lets more
+// urgent interrupts keep running, masking only this priority and lower.
+// Every interrupt left unmasked must be entirely RAM resident: its code,
+// everything it calls and all data it reads, with no FLASHMEM, PROGMEM or
+// F() strings.  The USB interrupt reads PROGMEM descriptors, so it must
+// stay masked, which means a setting of IRQ_PRIORITY_USB or less.
+#ifndef IRQ_PRIORITY_FLASH_MASK
+#define IRQ_PRIORITY_FLASH_MASK   0
+#endif
+
+// Critical sections for data shared only with interrupts at priority or
+// lower (numerically greater or equal).  Unlike __disable_irq(), more urgent
+// interrupts keep running.  Sections may nest, and the priority must not
+// be 0, which would mask nothing.
+//
+//   uint32_t mask = irq_mask_priority(IRQ_PRIORITY_DEFAULT);
+//   // ... access data shared with priority 128 - 255 interrupts
+//   irq_restore_priority(mask);
+static inline uint32_t irq_mask_priority(uint32_t priority) __attribute__((always_inline, unused));
+static inline uint32_t irq_mask_priority(uint32_t priority)
+{
+	uint32_t prev;
+	__asm__ volatile("mrs %0, basepri" : "=r" (prev) :: "memory");
+	__asm__ volatile("msr basepri_max, %0" :: "r" (priority) : "memory");
+	return prev;
+}
+
+static inline void irq_restore_priority(uint32_t prev) __attribute__((always_inline, unused));
+static inline void irq_restore_priority(uint32_t prev)
+{
+	__asm__ volatile("msr basepri, %0" :: "r" (prev) : "memory");
+}
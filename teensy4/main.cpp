@@ -29,6 +29,27 @@
  */
 
 #include <Arduino.h>
+#include <string.h>
+
+#ifdef LOOP_STATS
+loop_stats_t loop_stats;
+
+void loop_stats_clear(void)
+{
+	__disable_irq();
+	memset(&loop_stats, 0, sizeof(loop_stats));
+	__enable_irq();
+}
+
+static void loop_stats_period(uint32_t cycles)
+{
+	uint32_t usec = cycles / (F_CPU_ACTUAL / 1000000);
+	if (usec > loop_stats.period_max) loop_stats.period_max = usec;
+	uint32_t bucket = usec ? 32 - __builtin_clz(usec) : 0;
+	if (bucket >= LOOP_STATS_HISTOGRAM_SIZE) bucket = LOOP_STATS_HISTOGRAM_SIZE - 1;
+	loop_stats.period_histogram[bucket]++;
+}
+#endif
 
 extern "C" int main(void)
 {
@@ -49,10 +70,28 @@ extern "C" int main(void)
 #else
 	// Arduino's main() function just calls setup() and loop()....
 	setup();
+#ifdef LOOP_STATS
+	uint32_t prior = 0;
 	while (1) {
+		uint32_t begin = ARM_DWT_CYCCNT;
+		// the first loop, and the first after loop_stats_clear(), has no period
+		if (loop_stats.loops) loop_stats_period(begin - prior);
+		prior = begin;
 		loop();
+		uint32_t end = ARM_DWT_CYCCNT;
+		uint32_t cycles = end - begin;
+		loop_stats.loop_cycles += cycles;
+		if (cycles > loop_stats.loop_cycles_max) loop_stats.loop_cycles_max = cycles;
 		yield();
+		loop_stats.yield_cycles += ARM_DWT_CYCCNT - end;
+		loop_stats.loops++;
 	}
+#else
+	while (1) {
+		loop();
+		yield();
+	}
+#endif
 #endif
 }
 
@@ -0,0 +1,221 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Tiered memory allocation.  Callers say what the memory is for, and
+// the memory is placed in the best suited RAM, falling back to another
+// tier when the preferred one is full or absent.
+//
+//   malloc_fast()   DTCM, single cycle access, for small hot structures
+//   malloc_dma()    OCRAM (RAM2), 32 byte aligned, for DMA buffers
+//   malloc_large()  EXTMEM (PSRAM) when present, for bulk data
+
+#include <stdlib.h>
+#include <malloc.h>
+#include "smalloc.h"
+#include "wiring.h"
+#include "heap_profile.h"
+
+#if defined(ARDUINO_TEENSY41)
+#define HAS_EXTRAM
+#define IS_EXTMEM(addr) (((uint32_t)(addr) >> 28) == 7)
+#endif
+
+// DTCM reserved for malloc_fast().  Unused sections are discarded by the
+// linker, so this costs no RAM unless malloc_fast() is used.
+#ifndef MALLOC_FAST_SIZE
+#define MALLOC_FAST_SIZE 8192
+#endif
+
+static uint32_t fast_heap[MALLOC_FAST_SIZE / 4];
+struct smalloc_pool dtcm_smalloc_pool;
+static uint8_t fast_pool_ready = 0;
+static malloc_tier_stats_t stats[MALLOC_TIER_COUNT];
+
+#define IS_FAST_HEAP(addr) ((char *)(addr) >= (char *)fast_heap && \
+	(char *)(addr) < (char *)fast_heap + sizeof(fast_heap))
+
+extern unsigned long _heap_start;
+extern unsigned long _heap_end;
+#ifdef HAS_EXTRAM
+extern uint8_t external_psram_size;
+#endif
+
+static int tier_of(const void *ptr, size_t *size)
+{
+	if (IS_FAST_HEAP(ptr)) {
+		*size = sm_szalloc_pool(&dtcm_smalloc_pool, ptr);
+		return MALLOC_TIER_DTCM;
+	}
+#ifdef HAS_EXTRAM
+	if (IS_EXTMEM(ptr)) {
+		*size = sm_szalloc_pool(&extmem_smalloc_pool, ptr);
+		return MALLOC_TIER_EXTMEM;
+	}
+#endif
+	*size = malloc_usable_size((void *)ptr);
+	return MALLOC_TIER_OCRAM;
+}
+
+static void *tier_alloc_success(void *ptr)
+{
+	size_t size;
+	int tier = tier_of(ptr, &size);
+	malloc_tier_stats_t *s = &stats[tier];
+	s->used += size;
+	if (s->used > s->peak) s->peak = s->used;
+	s->allocs++;
+	return ptr;
+}
+
+static void *fast_alloc(size_t size)
+{
+	if (!fast_pool_ready) {
+		if (!sm_set_pool(&dtcm_smalloc_pool, fast_heap, sizeof(fast_heap), 1, NULL)) {
+			return NULL;
+		}
+		fast_pool_ready = 1;
+	}
+	return sm_malloc_pool(&dtcm_smalloc_pool, size);
+}
+
+static void *tier_fast(size_t size)
+{
+	void *ptr;
+
+	if (size == 0) return NULL;
+	ptr = fast_alloc(size);
+	if (ptr) return tier_alloc_success(ptr);
+	stats[MALLOC_TIER_DTCM].fails++;
+	ptr = malloc(size);
+	if (ptr) return tier_alloc_success(ptr);
+	stats[MALLOC_TIER_OCRAM].fails++;
+	return NULL;
+}
+
+static void *tier_dma(size_t size)
+{
+	void *ptr;
+
+	if (size == 0) return NULL;
+	// rounded to whole cache rows, so cache maintenance on this
+	// buffer can never disturb any other data
+	ptr = memalign(32, (size + 31) & ~31);
+	if (ptr) return tier_alloc_success(ptr);
+	stats[MALLOC_TIER_OCRAM].fails++;
+	return NULL;
+}
+
+static void *tier_large(size_t size)
+{
+	void *ptr;
+
+	if (size == 0) return NULL;
+#ifdef HAS_EXTRAM
+	if (external_psram_size > 0) {
+		ptr = sm_malloc_pool(&extmem_smalloc_pool, size);
+		if (ptr) return tier_alloc_success(ptr);
+		stats[MALLOC_TIER_EXTMEM].fails++;
+	}
+#endif
+	ptr = malloc(size);
+	if (ptr) return tier_alloc_success(ptr);
+	stats[MALLOC_TIER_OCRAM].fails++;
+	return NULL;
+}
+
+// heap_profile_enter() credits allocations to the caller, not this file
+void *malloc_fast(size_t size)
+{
+	void *site = heap_profile_enter(__builtin_return_address(0));
+	void *ptr = tier_fast(size);
+	heap_profile_leave(site);
+	return ptr;
+}
+
+void *malloc_dma(size_t size)
+{
+	void *site = heap_profile_enter(__builtin_return_address(0));
+	void *ptr = tier_dma(size);
+	heap_profile_leave(site);
+	return ptr;
+}
+
+void *malloc_large(size_t size)
+{
+	void *site = heap_profile_enter(__builtin_return_address(0));
+	void *ptr = tier_large(size);
+	heap_profile_leave(site);
+	return ptr;
+}
+
+void free_tiered(void *ptr)
+{
+	size_t size;
+	int tier;
+
+	if (!ptr) return;
+	tier = tier_of(ptr, &size);
+	if (stats[tier].used >= size) {
+		stats[tier].used -= size;
+	} else {
+		stats[tier].used = 0;
+	}
+	if (tier == MALLOC_TIER_DTCM) {
+		sm_free_pool(&dtcm_smalloc_pool, ptr);
+#ifdef HAS_EXTRAM
+	} else if (tier == MALLOC_TIER_EXTMEM) {
+		sm_free_pool(&extmem_smalloc_pool, ptr);
+#endif
+	} else {
+		free(ptr);
+	}
+}
+
+int malloc_tier_stats(int tier, malloc_tier_stats_t *s)
+{
+	if (tier < 0 || tier >= MALLOC_TIER_COUNT || !s) return 0;
+	*s = stats[tier];
+	switch (tier) {
+	case MALLOC_TIER_DTCM:
+		s->size = sizeof(fast_heap);
+		break;
+	case MALLOC_TIER_OCRAM:
+		s->size = (char *)&_heap_end - (char *)&_heap_start;
+		break;
+	case MALLOC_TIER_EXTMEM:
+#ifdef HAS_EXTRAM
+		s->size = extmem_smalloc_pool.pool_size;
+#else
+		s->size = 0;
+#endif
+		break;
+	}
+	return 1;
+}
@@ -24,34 +24,138 @@
  */
 
 #include <stdlib.h>
+#include <malloc.h>
+#include <new>
+#include "wiring.h"
+#include "heap_profile.h"
 
-void * operator new(size_t size)
+#if defined(ARDUINO_TEENSY41)
+#define IS_EXTMEM(addr) (((uint32_t)(addr) >> 28) == 7)
+#endif
+
+static new_alloc_hook_t new_alloc_hook = NULL;
+static new_free_hook_t new_free_hook = NULL;
+static size_t new_large_size = 0;
+
+void new_set_hooks(new_alloc_hook_t alloc, new_free_hook_t release)
+{
+	__disable_irq();
+	new_alloc_hook = alloc;
+	new_free_hook = release;
+	__enable_irq();
+}
+
+void new_set_large_size(size_t size)
 {
+	new_large_size = size;
+}
+
+static void * new_alloc(size_t size)
+{
+	if (new_alloc_hook) {
+		void *ptr = new_alloc_hook(size);
+		if (ptr) return ptr;
+	}
+	if (new_large_size && size >= new_large_size) {
+		return extmem_malloc(size);
+	}
 	return malloc(size);
 }
 
+static void new_free(void *ptr, size_t size)
+{
+	if (!ptr) return;
+	if (new_free_hook && new_free_hook(ptr, size)) return;
+#ifdef IS_EXTMEM
+	if (IS_EXTMEM(ptr)) {
+		extmem_free(ptr);
+		return;
+	}
+#endif
+	free(ptr);
+}
+
+void * operator new(size_t size)
+{
+	void *site = heap_profile_enter(__builtin_return_address(0));
+	void *ptr = new_alloc(size);
+	heap_profile_leave(site);
+	return ptr;
+}
+
 void * operator new[](size_t size)
 {
-	return malloc(size);
+	void *site = heap_profile_enter(__builtin_return_address(0));
+	void *ptr = new_alloc(size);
+	heap_profile_leave(site);
+	return ptr;
 }
 
 void operator delete(void * ptr)
 {
-	free(ptr);
+	new_free(ptr, 0);
 }
 
 void operator delete[](void * ptr)
 {
-	free(ptr);
+	new_free(ptr, 0);
 }
 
 void operator delete(void * ptr, size_t size)
 {
-	free(ptr);
+	new_free(ptr, size);
 }
 
 void operator delete[](void * ptr, size_t size)
+{
+	new_free(ptr, size);
+}
+
+#ifdef __cpp_aligned_new
+// Over-aligned types, for example alignas(32) for DMA buffers.  When the
+// alignment is a cache row or more, the size is rounded to whole rows,
+// so cache maintenance on the object never disturbs any other data.
+// These always use the normal heap; the hooks are not called.
+static void * new_aligned(size_t size, std::align_val_t align)
+{
+	size_t a = (size_t)align;
+	if (a >= 32) size = (size + a - 1) & ~(a - 1);
+	return memalign(a, size);
+}
+
+void * operator new(size_t size, std::align_val_t align)
+{
+	void *site = heap_profile_enter(__builtin_return_address(0));
+	void *ptr = new_aligned(size, align);
+	heap_profile_leave(site);
+	return ptr;
+}
+
+void * operator new[](size_t size, std::align_val_t align)
+{
+	void *site = heap_profile_enter(__builtin_return_address(0));
+	void *ptr = new_aligned(size, align);
+	heap_profile_leave(site);
+	return ptr;
+}
+
+void operator delete(void * ptr, std::align_val_t align)
 {
 	free(ptr);
 }
 
+void operator delete[](void * ptr, std::align_val_t align)
+{
+	free(ptr);
+}
+
+void operator delete(void * ptr, size_t size, std::align_val_t align)
+{
+	free(ptr);
+}
+
+void operator delete[](void * ptr, size_t size, std::align_val_t align)
+{
+	free(ptr);
+}
+#endif
@@ -217,3 +217,98 @@ char * dtostrf(float val, int width, unsigned int precision, char *buf)
 	return buf;
 }
 
+
+
+// Decimal to float conversion, correctly rounded like strtof(), but much
+// faster for the numbers usually found in CSV and ASCII telemetry.  When
+// the digits fit in 64 bits and the power of 10 is small, the value is
+// one exactly rounded multiply or divide by an exactly representable power
+// of 10 (Clinger's fast path).  Teensy 4 has a double precision FPU, so up
+// to 19 digits with exponent +/- 22 are computed in double.  Rounding that
+// double again to float is only wrong when it lands exactly halfway between
+// two floats, which is checked.  Anything else (many digits, huge exponents,
+// inf, nan, hex) falls back to strtof().
+static const float pow10_float[] = {
+	1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+};
+static const double pow10_double[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+float strtof_fast(const char *str, char **endptr)
+{
+	const char *p = str;
+	uint64_t mant = 0;
+	int exp10 = 0, any = 0, neg = 0, inexact = 0;
+	unsigned int d;
+
+	while (*p == ' ' || (*p >= '\t' && *p <= '\r')) p++;
+	if (*p == '-') {
+		neg = 1;
+		p++;
+	} else if (*p == '+') {
+		p++;
+	}
+	while ((d = (unsigned char)*p - '0') < 10) {
+		if (mant < 1000000000000000000ull) {
+			mant = mant * 10 + d;
+		} else {
+			exp10++;
+			if (d) inexact = 1;
+		}
+		any = 1;
+		p++;
+	}
+	if (*p == '.') {
+		p++;
+		while ((d = (unsigned char)*p - '0') < 10) {
+			if (mant < 1000000000000000000ull) {
+				mant = mant * 10 + d;
+				exp10--;
+			} else if (d) {
+				inexact = 1;
+			}
+			any = 1;
+			p++;
+		}
+	}
+	if (!any) return strtof(str, endptr); // inf, nan, hex or not a number
+	if (*p == 'e' || *p == 'E') {
+		const char *q = p + 1;
+		int e = 0, eneg = 0;
+		if (*q == '-') {
+			eneg = 1;
+			q++;
+		} else if (*q == '+') {
+			q++;
+		}
+		if ((unsigned int)((unsigned char)*q - '0') < 10) {
+			while ((d = (unsigned char)*q - '0') < 10) {
+				if (e < 10000) e = e * 10 + d;
+				q++;
+			}
+			exp10 += eneg ? -e : e;
+			p = q;
+		}
+	}
+	if (endptr) *endptr = (char *)p;
+	if (mant == 0) return neg ? -0.0f : 0.0f;
+	if (!inexact) {
+		if (mant <= (1 << 24) && exp10 >= -10 && exp10 <= 10) {
+			float f = (float)(uint32_t)mant;
+			f = (exp10 < 0) ? f / pow10_float[-exp10] : f * pow10_float[exp10];
+			return neg ? -f : f;
+		}
+		if (mant <= (1ull << 53) && exp10 >= -22 && exp10 <= 22) {
+			union { double d; uint64_t u; } u;
+			u.d = (double)mant;
+			u.d = (exp10 < 0) ? u.d / pow10_double[-exp10] : u.d * pow10_double[exp10];
+			if ((u.u & 0x1FFFFFFF) != 0x10000000) {
+				float f = (float)u.d;
+				return neg ? -f : f;
+			}
+		}
+	}
+	return strtof(str, endptr);
+}
@@ -136,7 +136,10 @@ struct digital_pin_bitband_and_config_table_struct { // not really bitband, old
 	volatile uint32_t *pad;
 	uint32_t mask;
 };
-extern const struct digital_pin_bitband_and_config_table_struct digital_pin_to_info_PGM[];
+// Not const: pinFastGPIO() changes a pin's reg between GPIO6-9 and GPIO1-4.
+// Code which declares this table itself, as "extern const", must include
+// this file instead.
+extern struct digital_pin_bitband_and_config_table_struct digital_pin_to_info_PGM[];
 #define digitalPinToPort(pin)    (pin)
 #define digitalPinToBitMask(pin) (digital_pin_to_info_PGM[(pin)].mask)
 #define portOutputRegister(pin)  ((digital_pin_to_info_PGM[(pin)].reg + 0))
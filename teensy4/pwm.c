@@ -136,16 +136,49 @@ const struct pwm_pin_info_struct pwm_pin_info[] = {
 
 #endif // __IMXRT1062__
 
+// While a batch is open, flexpwmWrite() only stages new values.  The
+// submodules written are remembered per module, and analogWriteCommit()
+// sets all their LDOK bits with one MCTRL write, so every output of a
+// module changes on the same PWM reload.
+static uint8_t pwm_batch_active = 0;
+static uint8_t pwm_batch_pending[4];
+
+#ifdef STARTUP_DEFER_INIT
+// Each FlexPWM and QuadTimer module is clocked and initialized when first
+// used, rather than all of them at startup.  Bits 0-3 are FlexPWM1-4,
+// bits 4-7 are QuadTimer1-4.
+static uint8_t pwm_modules_ready = 0;
+static void flexpwm_init_check(IMXRT_FLEXPWM_t *p);
+static void quadtimer_init_check(IMXRT_TMR_t *p);
+#else
+#define flexpwm_init_check(p)
+#define quadtimer_init_check(p)
+#endif
+void flexpwm_init(IMXRT_FLEXPWM_t *p);
+void quadtimer_init(IMXRT_TMR_t *p);
+
+static inline int flexpwm_index(IMXRT_FLEXPWM_t *p)
+{
+	if (p == &IMXRT_FLEXPWM1) return 0;
+	if (p == &IMXRT_FLEXPWM2) return 1;
+	if (p == &IMXRT_FLEXPWM3) return 2;
+	return 3;
+}
+
 void flexpwmWrite(IMXRT_FLEXPWM_t *p, unsigned int submodule, uint8_t channel, uint16_t val)
 {
+	flexpwm_init_check(p);
 	uint16_t mask = 1 << submodule;
+	int batch = pwm_batch_active ? flexpwm_index(p) : -1;
 	uint32_t modulo = p->SM[submodule].VAL1;
 	uint32_t cval = ((uint32_t)val * (modulo + 1)) >> analog_write_res;
 	if (cval > modulo) cval = modulo; // TODO: is this check correct?
 
 	//printf("flexpwmWrite, p=%08lX, sm=%d, ch=%c, cval=%ld\n",
 		//(uint32_t)p, submodule, channel == 0 ? 'X' : (channel == 1 ? 'A' : 'B'), cval);
-	p->MCTRL |= FLEXPWM_MCTRL_CLDOK(mask);
+	if (batch < 0 || !(pwm_batch_pending[batch] & mask)) {
+		p->MCTRL |= FLEXPWM_MCTRL_CLDOK(mask);
+	}
 	switch (channel) {
 	  case 0: // X
 		p->SM[submodule].VAL0 = modulo - cval;
@@ -162,11 +195,16 @@ void flexpwmWrite(IMXRT_FLEXPWM_t *p, unsigned int submodule, uint8_t channel, u
 		p->OUTEN |= FLEXPWM_OUTEN_PWMB_EN(mask);
 		//printf(" write channel B\n");
 	}
-	p->MCTRL |= FLEXPWM_MCTRL_LDOK(mask);
+	if (batch >= 0) {
+		pwm_batch_pending[batch] |= mask;
+	} else {
+		p->MCTRL |= FLEXPWM_MCTRL_LDOK(mask);
+	}
 }
 
 void flexpwmFrequency(IMXRT_FLEXPWM_t *p, unsigned int submodule, uint8_t channel, float frequency)
 {
+	flexpwm_init_check(p);
 	uint16_t mask = 1 << submodule;
 	uint32_t olddiv = p->SM[submodule].VAL1;
 	uint32_t newdiv = (uint32_t)((float)F_BUS_ACTUAL / frequency + 0.5f);
@@ -193,6 +231,7 @@ void flexpwmFrequency(IMXRT_FLEXPWM_t *p, unsigned int submodule, uint8_t channe
 
 void quadtimerWrite(IMXRT_TMR_t *p, unsigned int submodule, uint16_t val)
 {
+	quadtimer_init_check(p);
 	uint32_t modulo = 65537 - p->CH[submodule].LOAD + p->CH[submodule].CMPLD1;
 	uint32_t high = ((uint32_t)val * (modulo - 1)) >> analog_write_res;
 	if (high >= modulo - 1) high = modulo - 2;
@@ -208,6 +247,7 @@ void quadtimerWrite(IMXRT_TMR_t *p, unsigned int submodule, uint16_t val)
 
 void quadtimerFrequency(IMXRT_TMR_t *p, unsigned int submodule, float frequency)
 {
+	quadtimer_init_check(p);
 	uint32_t newdiv = (uint32_t)((float)F_BUS_ACTUAL / frequency + 0.5f);
 	uint32_t prescale = 0;
 	//printf(" div=%lu\n", newdiv);
@@ -267,6 +307,75 @@ void analogWrite(uint8_t pin, int val)
 	// TODO: pad config register
 }
 
+// Begin staging analogWrite() changes on FlexPWM pins.  Nothing changes
+// at the outputs until analogWriteCommit().  QuadTimer pins already use
+// buffered compare registers and update at their next period as usual.
+void analogWriteBegin(void)
+{
+	pwm_batch_pending[0] = 0;
+	pwm_batch_pending[1] = 0;
+	pwm_batch_pending[2] = 0;
+	pwm_batch_pending[3] = 0;
+	pwm_batch_active = 1;
+}
+
+// Load all staged FlexPWM values, one LDOK write per module
+void analogWriteCommit(void)
+{
+	static IMXRT_FLEXPWM_t * const flexpwm[4] = {
+		&IMXRT_FLEXPWM1, &IMXRT_FLEXPWM2, &IMXRT_FLEXPWM3, &IMXRT_FLEXPWM4
+	};
+	uint8_t pending[4];
+	int i;
+
+	__disable_irq();
+	for (i=0; i < 4; i++) {
+		pending[i] = pwm_batch_pending[i];
+		pwm_batch_pending[i] = 0;
+	}
+	pwm_batch_active = 0;
+	// keep the 4 modules as close together in time as possible
+	for (i=0; i < 4; i++) {
+		if (pending[i]) flexpwm[i]->MCTRL |= FLEXPWM_MCTRL_LDOK(pending[i]);
+	}
+	__enable_irq();
+}
+
+// Write many pins, updating all their FlexPWM outputs together
+void analogWriteMulti(const uint8_t *pins, const int *vals, unsigned int count)
+{
+	unsigned int i;
+
+	analogWriteBegin();
+	for (i=0; i < count; i++) {
+		analogWrite(pins[i], vals[i]);
+	}
+	analogWriteCommit();
+}
+
+// FlexPWM used by a pin, as (module << 4) | (submodule << 2) | channel,
+// or 255 if the pin has no FlexPWM output
+uint8_t pwm_pin_flexpwm(uint8_t pin)
+{
+	const struct pwm_pin_info_struct *info;
+
+	if (pin >= CORE_NUM_DIGITAL) return 255;
+	info = pwm_pin_info + pin;
+	if (info->type != 1) return 255;
+	return ((info->module >> 4) << 4) | ((info->module & 3) << 2) | info->channel;
+}
+
+// QuadTimer used by a pin, as (module << 4) | channel, or 255 if none
+uint8_t pwm_pin_quadtimer(uint8_t pin)
+{
+	const struct pwm_pin_info_struct *info;
+
+	if (pin >= CORE_NUM_DIGITAL) return 255;
+	info = pwm_pin_info + pin;
+	if (info->type != 2) return 255;
+	return info->module;
+}
+
 void analogWriteFrequency(uint8_t pin, float frequency)
 {
 	const struct pwm_pin_info_struct *info;
@@ -341,9 +450,56 @@ void quadtimer_init(IMXRT_TMR_t *p)
 	}
 }
 
+#ifdef STARTUP_DEFER_INIT
+static void flexpwm_init_check(IMXRT_FLEXPWM_t *p)
+{
+	int n = flexpwm_index(p);
+	if (pwm_modules_ready & (1 << n)) return;
+	pwm_modules_ready |= (1 << n);
+	CCM_CCGR4 |= CCM_CCGR4_PWM1(CCM_CCGR_ON) << (n * 2);
+	flexpwm_init(p);
+}
+
+static void quadtimer_init_check(IMXRT_TMR_t *p)
+{
+	int n;
+	uint32_t gate;
+	if (p == &IMXRT_TMR1) {
+		n = 4;
+		gate = CCM_CCGR6_QTIMER1(CCM_CCGR_ON);
+	} else if (p == &IMXRT_TMR2) {
+		n = 5;
+		gate = CCM_CCGR6_QTIMER2(CCM_CCGR_ON);
+	} else if (p == &IMXRT_TMR3) {
+		n = 6;
+		gate = CCM_CCGR6_QTIMER3(CCM_CCGR_ON);
+	} else {
+		n = 7;
+		gate = CCM_CCGR6_QTIMER4(CCM_CCGR_ON);
+	}
+	if (pwm_modules_ready & (1 << n)) return;
+	pwm_modules_ready |= (1 << n);
+	CCM_CCGR6 |= gate;
+	if (n < 7) quadtimer_init(p); // as pwm_init(), QuadTimer4 is only clocked
+}
+#endif
+
+void flexpwm_module_enable(IMXRT_FLEXPWM_t *p)
+{
+	flexpwm_init_check(p);
+}
+
+void quadtimer_module_enable(IMXRT_TMR_t *p)
+{
+	quadtimer_init_check(p);
+}
+
 void pwm_init(void)
 {
 	//printf("pwm init\n");
+#ifdef STARTUP_DEFER_INIT
+	pwm_modules_ready = 0xFF;
+#endif
 	CCM_CCGR4 |= CCM_CCGR4_PWM1(CCM_CCGR_ON) | CCM_CCGR4_PWM2(CCM_CCGR_ON) |
 		CCM_CCGR4_PWM3(CCM_CCGR_ON) | CCM_CCGR4_PWM4(CCM_CCGR_ON);
 	CCM_CCGR6 |= CCM_CCGR6_QTIMER1(CCM_CCGR_ON) | CCM_CCGR6_QTIMER2(CCM_CCGR_ON) |
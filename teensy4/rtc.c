@@ -47,6 +47,33 @@ unsigned long rtc_get(void)
 	}
 }
 
+// The RTC counts 32768 Hz ticks in a 47 bit counter, seconds in the upper
+// 32 bits.  Reading the low 15 bits gives timestamps finer than 1 second.
+uint64_t rtc_get_ticks(void)
+{
+	uint32_t hi1 = SNVS_HPRTCMR;
+	uint32_t lo1 = SNVS_HPRTCLR;
+	while (1) {
+		uint32_t hi2 = SNVS_HPRTCMR;
+		uint32_t lo2 = SNVS_HPRTCLR;
+		if (lo1 == lo2 && hi1 == hi2) {
+			return ((uint64_t)hi2 << 32) | lo2;
+		}
+		hi1 = hi2;
+		lo1 = lo2;
+	}
+}
+
+unsigned long rtc_get_us(uint32_t *microseconds)
+{
+	uint64_t ticks = rtc_get_ticks();
+	if (microseconds) {
+		// 1000000 / 32768 = 15625 / 512, rounded down
+		*microseconds = ((uint32_t)ticks & 0x7FFF) * 15625 >> 9;
+	}
+	return ticks >> 15;
+}
+
 void rtc_set(unsigned long t)
 {
 	// stop the RTC
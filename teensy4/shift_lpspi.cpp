@@ -0,0 +1,207 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "core_pins.h"
+#include "DMAChannel.h"
+
+// shiftOutBuffer() uses LPSPI hardware when the data and clock pins are
+// an LPSPI port's SDO and SCK.  The pins are muxed to LPSPI only while
+// sending, then given back to GPIO, so digitalWrite() and shiftOut()
+// keep working on them.  SPI mode 0 matches shiftOut()'s timing: data
+// changes while the clock is low and is sampled on the rising edge.
+//
+// Any other pins, or an LPSPI port already enabled by the SPI library,
+// use the normal shiftOut() bit-bang code.
+
+struct shift_lpspi_struct {
+	volatile uint32_t *sdo_mux;
+	volatile uint32_t *sck_mux;
+	uint8_t alt;
+	uint8_t dma_source;
+	uint32_t ccgr1;
+	IMXRT_LPSPI_t *lpspi;
+};
+
+static const struct shift_lpspi_struct shift_lpspi[] = {
+	// pins 11 & 13
+	{&IOMUXC_SW_MUX_CTL_PAD_GPIO_B0_02, &IOMUXC_SW_MUX_CTL_PAD_GPIO_B0_03, 3,
+		DMAMUX_SOURCE_LPSPI4_TX, CCM_CCGR1_LPSPI4(CCM_CCGR_ON), &IMXRT_LPSPI4_S},
+	// pins 26 & 27
+	{&IOMUXC_SW_MUX_CTL_PAD_GPIO_AD_B1_14, &IOMUXC_SW_MUX_CTL_PAD_GPIO_AD_B1_15, 2,
+		DMAMUX_SOURCE_LPSPI3_TX, CCM_CCGR1_LPSPI3(CCM_CCGR_ON), &IMXRT_LPSPI3_S},
+	// pins 35 & 37 (Teensy 4.0), 43 & 45 (Teensy 4.1)
+	{&IOMUXC_SW_MUX_CTL_PAD_GPIO_SD_B0_02, &IOMUXC_SW_MUX_CTL_PAD_GPIO_SD_B0_00, 4,
+		DMAMUX_SOURCE_LPSPI1_TX, CCM_CCGR1_LPSPI1(CCM_CCGR_ON), &IMXRT_LPSPI1_S},
+};
+
+#define SHIFT_DMA_MIN  16  // shorter buffers are written by the CPU
+
+static uint32_t shift_clock = 10000000;
+static DMAChannel shift_dma(false);
+static const struct shift_lpspi_struct *shift_busy = nullptr;
+static uint32_t shift_sdo_mux, shift_sck_mux;
+
+static const struct shift_lpspi_struct * shift_lookup(uint8_t dataPin, uint8_t clockPin)
+{
+	if (dataPin >= CORE_NUM_DIGITAL || clockPin >= CORE_NUM_DIGITAL) return nullptr;
+	for (unsigned int i=0; i < sizeof(shift_lpspi) / sizeof(shift_lpspi[0]); i++) {
+		if (portConfigRegister(dataPin) == shift_lpspi[i].sdo_mux
+		  && portConfigRegister(clockPin) == shift_lpspi[i].sck_mux) {
+			return shift_lpspi + i;
+		}
+	}
+	return nullptr;
+}
+
+// LPSPI clock root, same as the SPI library's calculation
+static uint32_t shift_lpspi_clock(void)
+{
+	static const uint32_t clk_sel[4] = {664615384, 720000000, 528000000, 396000000};
+	uint32_t cbcmr = CCM_CBCMR;
+	return clk_sel[(cbcmr >> 4) & 0x03] / (((cbcmr >> 26) & 0x07) + 1);
+}
+
+// wait for the previous transfer, then give its pins back to GPIO
+static void shift_finish(void)
+{
+	const struct shift_lpspi_struct *p = shift_busy;
+	if (!p) return;
+	while (DMA_ERQ & (1 << shift_dma.channel)) ; // DMA still feeding
+	while (p->lpspi->FSR & LPSPI_FSR_TXCOUNT(31)) ; // FIFO not empty
+	while (p->lpspi->SR & LPSPI_SR_MBF) ; // last frame shifting out
+	*(p->sdo_mux) = shift_sdo_mux;
+	*(p->sck_mux) = shift_sck_mux;
+	p->lpspi->DER = 0;
+	p->lpspi->CR = 0;
+	shift_busy = nullptr;
+}
+
+static int shift_start(const struct shift_lpspi_struct *p, uint8_t bitOrder,
+	const uint8_t *buffer, uint32_t length, int async)
+{
+	IMXRT_LPSPI_t *lpspi = p->lpspi;
+
+	CCM_CCGR1 |= p->ccgr1;
+	if (lpspi->CR & LPSPI_CR_MEN) return 0; // in use by SPI library
+
+	uint32_t clk = shift_lpspi_clock();
+	uint32_t prescale = 0, div;
+	while (1) {
+		div = ((clk >> prescale) + shift_clock - 1) / shift_clock;
+		if (div <= 257 || prescale >= 7) break;
+		prescale++;
+	}
+	if (div < 2) div = 2;
+	if (div > 257) div = 257;
+
+	lpspi->CR = LPSPI_CR_RST;
+	lpspi->CR = 0;
+	lpspi->CFGR1 = LPSPI_CFGR1_MASTER;
+	lpspi->CCR = LPSPI_CCR_SCKDIV(div - 2) | LPSPI_CCR_DBT((div - 2) / 2);
+	lpspi->FCR = LPSPI_FCR_TXWATER(15);
+	lpspi->CR = LPSPI_CR_MEN;
+	lpspi->TCR = LPSPI_TCR_FRAMESZ(7) | LPSPI_TCR_RXMSK | LPSPI_TCR_PRESCALE(prescale)
+		| ((bitOrder == LSBFIRST) ? LPSPI_TCR_LSBF : 0);
+
+	shift_sdo_mux = *(p->sdo_mux);
+	shift_sck_mux = *(p->sck_mux);
+	*(p->sdo_mux) = p->alt;
+	*(p->sck_mux) = p->alt;
+	shift_busy = p;
+
+	if (length < SHIFT_DMA_MIN) {
+		while (length > 0) {
+			if (lpspi->FSR & LPSPI_FSR_TXCOUNT(16)) continue; // FIFO full
+			lpspi->TDR = *buffer++;
+			length--;
+		}
+		shift_finish();
+		return 1;
+	}
+	arm_dcache_flush((void *)buffer, length);
+	shift_dma.begin();
+	shift_dma.sourceBuffer(buffer, length);
+	shift_dma.destination(*(volatile uint8_t *)&lpspi->TDR);
+	shift_dma.disableOnCompletion();
+	shift_dma.triggerAtHardwareEvent(p->dma_source);
+	shift_dma.enable();
+	lpspi->DER = LPSPI_DER_TDDE;
+	if (!async) shift_finish();
+	return 1;
+}
+
+extern "C" {
+
+void shiftOutBuffer(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder,
+	const void *buffer, uint32_t length)
+{
+	const uint8_t *p = (const uint8_t *)buffer;
+
+	shift_finish();
+	const struct shift_lpspi_struct *hw = shift_lookup(dataPin, clockPin);
+	if (hw && shift_start(hw, bitOrder, p, length, 0)) return;
+	while (length > 0) {
+		_shiftOut(dataPin, clockPin, bitOrder, *p++);
+		length--;
+	}
+}
+
+int shiftOutBufferAsync(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder,
+	const void *buffer, uint32_t length)
+{
+	shift_finish();
+	const struct shift_lpspi_struct *hw = shift_lookup(dataPin, clockPin);
+	if (hw && length >= SHIFT_DMA_MIN
+	  && shift_start(hw, bitOrder, (const uint8_t *)buffer, length, 1)) {
+		return 1;
+	}
+	shiftOutBuffer(dataPin, clockPin, bitOrder, buffer, length);
+	return 0;
+}
+
+int shiftOutBusy(void)
+{
+	const struct shift_lpspi_struct *p = shift_busy;
+	if (!p) return 0;
+	if (DMA_ERQ & (1 << shift_dma.channel)) return 1;
+	if (p->lpspi->FSR & LPSPI_FSR_TXCOUNT(31)) return 1;
+	if (p->lpspi->SR & LPSPI_SR_MBF) return 1;
+	shift_finish();
+	return 0;
+}
+
+uint32_t shiftOutClock(uint32_t hz)
+{
+	uint32_t prior = shift_clock;
+	if (hz > 0) shift_clock = hz;
+	return prior;
+}
+
+} // extern "C"
@@ -0,0 +1,124 @@
+/*
+ * This file is a part of SMalloc.
+ * SMalloc is MIT licensed.
+ * Copyright (c) 2017 Andrey Rys.
+ */
+
+#include "smalloc_i.h"
+
+/*
+ * Small freed blocks are not returned to the pool, but kept on a list
+ * for their exact size, so the next allocation of that size needs no
+ * search.  A binned block keeps its header with usz of zero and an
+ * inverted tag, followed by hashed tag words like a normal allocation,
+ * then the pointer to the next binned block of the same size.  The
+ * pool search skips these blocks as if they were allocated, and every
+ * other function sees them as free.
+ */
+
+#define BIN_MAX_SZ (HEADER_SZ*SMALLOC_NUM_BINS)
+#define BIN_NEXT(shdr) (CHAR_PTR(HEADER_TO_USER(shdr))+HEADER_SZ)
+
+void *smalloc_bin_get(struct smalloc_pool *spool, size_t n)
+{
+	struct smalloc_hdr *shdr;
+	size_t rsz, x;
+	uintptr_t tag;
+	char *s;
+
+	rsz = (n%HEADER_SZ)?(((n/HEADER_SZ)+1)*HEADER_SZ):n;
+	if (rsz > BIN_MAX_SZ) return NULL;
+	shdr = spool->bins[rsz/HEADER_SZ - 1];
+	if (!shdr) return NULL;
+	if (!smalloc_is_binned(spool, shdr)) {
+		/* list was overwritten by some stray write */
+		smalloc_UB(spool, HEADER_TO_USER(shdr));
+		return NULL;
+	}
+	memcpy(&spool->bins[rsz/HEADER_SZ - 1], BIN_NEXT(shdr), sizeof(void *));
+
+	if (spool->do_zero) memset(HEADER_TO_USER(shdr), 0, shdr->rsz);
+	shdr->usz = n;
+	shdr->tag = tag = smalloc_mktag(shdr);
+	s = CHAR_PTR(HEADER_TO_USER(shdr));
+	s += shdr->usz;
+	for (x = 0; x < sizeof(struct smalloc_hdr); x += sizeof(uintptr_t)) {
+		tag = smalloc_uinthash(tag);
+		memcpy(s+x, &tag, sizeof(uintptr_t));
+	}
+	memset(s+x, 0xff, shdr->rsz - shdr->usz);
+	return HEADER_TO_USER(shdr);
+}
+
+int smalloc_bin_put(struct smalloc_pool *spool, struct smalloc_hdr *shdr)
+{
+	struct smalloc_hdr **bin, *next;
+	size_t x;
+	uintptr_t tag;
+	char *s;
+
+	if (shdr->rsz > BIN_MAX_SZ) return 0;
+	/* if free space follows, really free so it can be merged */
+	s = CHAR_PTR(HEADER_TO_USER(shdr));
+	s += shdr->rsz + HEADER_SZ;
+	next = HEADER_PTR(s);
+	if (CHAR_PTR(next) - CHAR_PTR(spool->pool) >= spool->pool_size
+	|| !smalloc_is_used(spool, next)) return 0;
+	bin = (struct smalloc_hdr **)&spool->bins[shdr->rsz/HEADER_SZ - 1];
+
+	s = CHAR_PTR(HEADER_TO_USER(shdr));
+	if (spool->do_zero) memset(s, 0, shdr->rsz + HEADER_SZ);
+	shdr->usz = 0;
+	shdr->tag = tag = ~smalloc_mktag(shdr);
+	for (x = 0; x < sizeof(struct smalloc_hdr); x += sizeof(uintptr_t)) {
+		tag = smalloc_uinthash(tag);
+		memcpy(s+x, &tag, sizeof(uintptr_t));
+	}
+	memcpy(BIN_NEXT(shdr), bin, sizeof(void *));
+	*bin = shdr;
+	return 1;
+}
+
+/*
+ * Take one binned block off its list and return it to the pool, so it
+ * merges with free space around it.  Used when a neighboring block is
+ * freed or grows, rather than waiting for smalloc_bin_flush().
+ */
+int smalloc_bin_remove(struct smalloc_pool *spool, struct smalloc_hdr *shdr)
+{
+	struct smalloc_hdr *p, *next;
+	char *link;
+
+	if (!smalloc_is_binned(spool, shdr)) return 0;
+	link = (char *)&spool->bins[shdr->rsz/HEADER_SZ - 1];
+	while (1) {
+		memcpy(&p, link, sizeof(void *));
+		if (!p) return 0; /* not on its list, leave it alone */
+		if (p == shdr) break;
+		link = BIN_NEXT(p);
+	}
+	memcpy(&next, BIN_NEXT(shdr), sizeof(void *));
+	memcpy(link, &next, sizeof(void *));
+	memset(shdr, 0, HEADER_SZ + shdr->rsz + HEADER_SZ);
+	return 1;
+}
+
+/* return all binned blocks to the pool, so they can be merged again */
+int smalloc_bin_flush(struct smalloc_pool *spool)
+{
+	struct smalloc_hdr *shdr, *next;
+	int i, r = 0;
+
+	for (i = 0; i < SMALLOC_NUM_BINS; i++) {
+		shdr = spool->bins[i];
+		while (shdr) {
+			memcpy(&next, BIN_NEXT(shdr), sizeof(void *));
+			memset(shdr, 0, HEADER_SZ + shdr->rsz + HEADER_SZ);
+			shdr = next;
+			r++;
+		}
+		spool->bins[i] = NULL;
+	}
+
+	return r;
+}
@@ -9,7 +9,8 @@
 void sm_free_pool(struct smalloc_pool *spool, void *p)
 {
 	struct smalloc_hdr *shdr;
-	char *s;
+	char *s, *next;
+	size_t rsz;
 
 	if (!smalloc_verify_pool(spool)) {
 		errno = EINVAL;
@@ -19,13 +20,23 @@ void sm_free_pool(struct smalloc_pool *spool, void *p)
 	if (!p) return;
 
 	shdr = USER_TO_HEADER(p);
-	if (smalloc_is_alloc(spool, shdr)) {
+	if (smalloc_check_alloc(spool, shdr)) {
+		heap_profile_free(p, shdr->usz);
+		if (smalloc_bin_put(spool, shdr)) return;
+		next = CHAR_PTR(p) + shdr->rsz + HEADER_SZ;
 		if (spool->do_zero) memset(p, 0, shdr->rsz);
 		s = CHAR_PTR(p);
 		s += shdr->usz;
 		memset(s, 0, HEADER_SZ);
 		if (spool->do_zero) memset(s+HEADER_SZ, 0, shdr->rsz - shdr->usz);
 		memset(shdr, 0, HEADER_SZ);
+		/* merge with small freed blocks which follow, rather than
+		 * leaving them in bins to break up this free space */
+		while (next - CHAR_PTR(spool->pool) < spool->pool_size) {
+			rsz = HEADER_PTR(next)->rsz;
+			if (!smalloc_bin_remove(spool, HEADER_PTR(next))) break;
+			next += HEADER_SZ + rsz + HEADER_SZ;
+		}
 		return;
 	}
 
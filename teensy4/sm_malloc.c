@@ -6,7 +6,7 @@
 
 #include "smalloc_i.h"
 
-void *sm_malloc_pool(struct smalloc_pool *spool, size_t n)
+static void *smalloc_alloc(struct smalloc_pool *spool, size_t n)
 {
 	struct smalloc_hdr *basehdr, *shdr, *dhdr;
 	char *s;
@@ -22,13 +22,17 @@ again:	if (!smalloc_verify_pool(spool)) {
 	if (n > SIZE_MAX
 	|| n > (spool->pool_size - HEADER_SZ)) goto oom;
 
+	/* small sizes are usually found ready in a bin */
+	s = smalloc_bin_get(spool, n);
+	if (s) return s;
+
 	shdr = basehdr = spool->pool;
 	while (CHAR_PTR(shdr)-CHAR_PTR(basehdr) < spool->pool_size) {
 		/*
 		 * Already allocated block.
 		 * Skip it by jumping over it.
 		 */
-		if (smalloc_is_alloc(spool, shdr)) {
+		if (smalloc_is_used(spool, shdr)) {
 			s = CHAR_PTR(HEADER_TO_USER(shdr));
 			s += shdr->rsz + HEADER_SZ;
 			shdr = HEADER_PTR(s);
@@ -48,7 +52,7 @@ again:	if (!smalloc_verify_pool(spool)) {
 				 * ugh, found next allocated block.
 				 * skip this candidate then.
 				 */
-				if (smalloc_is_alloc(spool, dhdr))
+				if (smalloc_is_used(spool, dhdr))
 					goto allocblock;
 				/*
 				 * did not see allocated block yet,
@@ -90,7 +94,10 @@ allocblock:		shdr = dhdr;
 		shdr++;
 	}
 
-oom:	if (spool->oomfn) {
+oom:	/* binned blocks may be keeping free blocks from merging */
+	if (smalloc_bin_flush(spool)) goto again;
+
+	if (spool->oomfn) {
 		x = spool->oomfn(spool, n);
 		if (x > spool->pool_size) {
 			spool->pool_size = x;
@@ -102,6 +109,13 @@ oom:	if (spool->oomfn) {
 	return NULL;
 }
 
+void *sm_malloc_pool(struct smalloc_pool *spool, size_t n)
+{
+	void *p = smalloc_alloc(spool, n);
+	heap_profile_alloc(p, n, __builtin_return_address(0));
+	return p;
+}
+
 void *sm_malloc(size_t n)
 {
 	return sm_malloc_pool(&smalloc_curr_pool, n);
@@ -40,6 +40,47 @@ int sm_malloc_stats_pool(struct smalloc_pool *spool, size_t *total, size_t *user
 	return r;
 }
 
+int sm_malloc_frag_pool(struct smalloc_pool *spool, size_t *free, size_t *largest, int *nr_free)
+{
+	struct smalloc_hdr *shdr, *basehdr;
+	size_t run = 0, total = 0, max = 0;
+	int runs = 0;
+	char *s;
+
+	if (!smalloc_verify_pool(spool)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	shdr = basehdr = spool->pool;
+	while (CHAR_PTR(shdr)-CHAR_PTR(basehdr) < spool->pool_size) {
+		if (smalloc_is_used(spool, shdr)) {
+			if (run) {
+				if (run > max) max = run;
+				total += run;
+				runs++;
+				run = 0;
+			}
+			s = CHAR_PTR(HEADER_TO_USER(shdr));
+			s += shdr->rsz + HEADER_SZ;
+			shdr = HEADER_PTR(s);
+			continue;
+		}
+		run += HEADER_SZ;
+		shdr++;
+	}
+	if (run) {
+		if (run > max) max = run;
+		total += run;
+		runs++;
+	}
+
+	if (free) *free = total;
+	if (largest) *largest = max;
+	if (nr_free) *nr_free = runs;
+	return 1;
+}
+
 int sm_malloc_stats(size_t *total, size_t *user, size_t *free, int *nr_blocks)
 {
 	return sm_malloc_stats_pool(&smalloc_curr_pool, total, user, free, nr_blocks);
@@ -52,6 +52,9 @@ int sm_set_pool(struct smalloc_pool *spool, void *new_pool, size_t new_pool_size
 	spool->pool = new_pool;
 	spool->pool_size = new_pool_size;
 	spool->oomfn = oom_handler;
+	memset(spool->bins, 0, sizeof(spool->bins));
+	spool->validate = SMALLOC_VALIDATE;
+	spool->sample_count = 0;
 	if (!sm_align_pool(spool)) return 0;
 
 	if (do_zero) {
@@ -33,7 +33,7 @@ void *sm_realloc_pool_i(struct smalloc_pool *spool, void *p, size_t n, int nomov
 
 	/* determine user size */
 	shdr = USER_TO_HEADER(p);
-	if (!smalloc_is_alloc(spool, shdr)) smalloc_UB(spool, p);
+	if (!smalloc_check_alloc(spool, shdr)) smalloc_UB(spool, p);
 	usz = shdr->usz;
 	rsz = shdr->rsz;
 
@@ -54,6 +54,7 @@ void *sm_realloc_pool_i(struct smalloc_pool *spool, void *p, size_t n, int nomov
 			memcpy(s+x, &tag, sizeof(uintptr_t));
 		}
 		memset(s+x, 0xff, shdr->rsz - shdr->usz);
+		heap_profile_resize(p, usz, n);
 		return p;
 	}
 
@@ -73,15 +74,22 @@ void *sm_realloc_pool_i(struct smalloc_pool *spool, void *p, size_t n, int nomov
 			memcpy(s+x, &tag, sizeof(uintptr_t));
 		}
 		memset(s+x, 0xff, shdr->rsz - shdr->usz);
+		heap_profile_resize(p, usz, n);
 		return p;
 	}
 
-	/* newsize is bigger, larger than rsz but there are free blocks beyond - extend */
+	/*
+	 * newsize is bigger, larger than rsz but there are free blocks beyond - extend.
+	 * Small freed blocks waiting in bins are free too, so take them back.
+	 */
 	basehdr = spool->pool; dhdr = shdr+(rsz/HEADER_SZ); found = 0;
 	while (CHAR_PTR(dhdr)-CHAR_PTR(basehdr) < spool->pool_size) {
 		x = CHAR_PTR(dhdr)-CHAR_PTR(shdr);
 		if (smalloc_is_alloc(spool, dhdr))
 			goto allocblock;
+		if (smalloc_is_binned(spool, dhdr)
+		&& !smalloc_bin_remove(spool, dhdr))
+			goto allocblock;
 		if (n + HEADER_SZ <= x) {
 			x -= HEADER_SZ;
 			found = 1;
@@ -109,6 +117,7 @@ outfound:
 			memcpy(s+x, &tag, sizeof(uintptr_t));
 		}
 		memset(s+x, 0xff, shdr->rsz - shdr->usz);
+		heap_profile_resize(p, usz, n);
 		return p;
 	}
 
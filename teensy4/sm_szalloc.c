@@ -18,7 +18,7 @@ size_t sm_szalloc_pool(struct smalloc_pool *spool, const void *p)
 	if (!p) return 0;
 
 	shdr = USER_TO_HEADER(p);
-	if (smalloc_is_alloc(spool, shdr)) return shdr->usz;
+	if (smalloc_check_alloc(spool, shdr)) return shdr->usz;
 	smalloc_UB(spool, p);
 	return 0;
 }
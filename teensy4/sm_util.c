@@ -52,7 +52,7 @@ void sm_set_ub_handler(smalloc_ub_handler handler)
 	else smalloc_UB = handler;
 }
 
-int smalloc_is_alloc(struct smalloc_pool *spool, struct smalloc_hdr *shdr)
+static int smalloc_is_alloc_i(struct smalloc_pool *spool, struct smalloc_hdr *shdr, int guard)
 {
 	if (!smalloc_check_bounds(spool, shdr)) return 0;
 	if (shdr->rsz == 0) return 0;
@@ -60,6 +60,64 @@ int smalloc_is_alloc(struct smalloc_pool *spool, struct smalloc_hdr *shdr)
 	if (shdr->usz > SIZE_MAX) return 0;
 	if (shdr->usz > shdr->rsz) return 0;
 	if (shdr->rsz % HEADER_SZ) return 0;
-	if (!smalloc_valid_tag(shdr)) return 0;
+	if (guard) return smalloc_valid_tag(shdr);
+	return shdr->tag == smalloc_mktag(shdr);
+}
+
+/* is this header an allocated block, while searching the pool */
+int smalloc_is_alloc(struct smalloc_pool *spool, struct smalloc_hdr *shdr)
+{
+	return smalloc_is_alloc_i(spool, shdr, spool->validate == SMALLOC_VALIDATE_FULL);
+}
+
+/* is a pointer given to free, realloc or szalloc an allocated block */
+int smalloc_check_alloc(struct smalloc_pool *spool, struct smalloc_hdr *shdr)
+{
+	switch (spool->validate) {
+	case SMALLOC_VALIDATE_NONE:
+		return 1;
+	case SMALLOC_VALIDATE_SAMPLE:
+		if (++spool->sample_count < SMALLOC_SAMPLE_INTERVAL) {
+			return smalloc_is_alloc_i(spool, shdr, 0);
+		}
+		spool->sample_count = 0;
+		return smalloc_is_alloc_i(spool, shdr, 1);
+	default:
+		return smalloc_is_alloc_i(spool, shdr, 1);
+	}
+}
+
+void sm_set_validation(struct smalloc_pool *spool, int level)
+{
+	if (level < SMALLOC_VALIDATE_FULL || level > SMALLOC_VALIDATE_NONE) return;
+	spool->validate = level;
+	spool->sample_count = 0;
+}
+
+int smalloc_is_binned(struct smalloc_pool *spool, struct smalloc_hdr *shdr)
+{
+	char *s;
+	uintptr_t r;
+	size_t x;
+
+	if (!smalloc_check_bounds(spool, shdr)) return 0;
+	if (shdr->usz != 0) return 0;
+	if (shdr->rsz == 0) return 0;
+	if (shdr->rsz > HEADER_SZ*SMALLOC_NUM_BINS) return 0;
+	if (shdr->rsz % HEADER_SZ) return 0;
+	r = ~smalloc_mktag(shdr);
+	if (shdr->tag != r) return 0;
+	s = CHAR_PTR(HEADER_TO_USER(shdr));
+	for (x = 0; x < sizeof(struct smalloc_hdr); x += sizeof(uintptr_t)) {
+		r = smalloc_uinthash(r);
+		if (memcmp(s+x, &r, sizeof(uintptr_t)) != 0) return 0;
+	}
 	return 1;
 }
+
+/* allocated, or kept in a bin: either way not free for a new block */
+int smalloc_is_used(struct smalloc_pool *spool, struct smalloc_hdr *shdr)
+{
+	if (smalloc_is_alloc(spool, shdr)) return 1;
+	return smalloc_is_binned(spool, shdr);
+}
@@ -35,12 +35,39 @@ struct smalloc_pool;
 
 typedef size_t (*smalloc_oom_handler)(struct smalloc_pool *, size_t);
 
+/* freed small blocks are kept on per size lists, one per header size step */
+#define SMALLOC_NUM_BINS 16
+
+/*
+ * How thoroughly a pool checks its blocks.  Every block header carries a
+ * hashed tag, which is how allocated blocks are told apart from free
+ * memory, so headers are always checked.  Full validation also checks
+ * the guard bytes after every block, both while searching the pool and
+ * on every free, realloc or size query, catching buffer overruns early.
+ * Sampled validation checks guard bytes on 1 of every
+ * SMALLOC_SAMPLE_INTERVAL frees, reallocs or size queries.  None trusts
+ * the pointers given to free, realloc and size queries entirely, so a
+ * bad pointer corrupts the pool rather than calling the UB handler.
+ * Blocks are always written with tags and guard bytes, so the level may
+ * be changed at any time.  sm_set_pool() uses SMALLOC_VALIDATE.
+ */
+#define SMALLOC_VALIDATE_FULL	0
+#define SMALLOC_VALIDATE_SAMPLE	1
+#define SMALLOC_VALIDATE_NONE	2
+#ifndef SMALLOC_VALIDATE
+#define SMALLOC_VALIDATE SMALLOC_VALIDATE_FULL
+#endif
+#define SMALLOC_SAMPLE_INTERVAL	16
+
 /* describes static pool, if you're going to use multiple pools at same time */
 struct smalloc_pool {
 	void *pool; /* pointer to your pool */
 	size_t pool_size; /* it's size. Must be aligned with sm_align_pool. */
 	int do_zero; /* zero pool before use and all the new allocations from it. */
 	smalloc_oom_handler oomfn; /* this will be called, if non-NULL, on OOM condition in pool */
+	void *bins[SMALLOC_NUM_BINS]; /* freed blocks ready for reuse, by size */
+	unsigned char validate; /* SMALLOC_VALIDATE_FULL, _SAMPLE or _NONE */
+	unsigned char sample_count; /* checks since the last sampled full check */
 };
 
 /* a default one which is initialised with sm_set_default_pool. */
@@ -49,6 +76,8 @@ extern struct smalloc_pool smalloc_curr_pool;
 #ifdef ARDUINO_TEENSY41
 extern struct smalloc_pool extmem_smalloc_pool;
 #endif
+/* DTCM pool used by malloc_fast(), set up on first use */
+extern struct smalloc_pool dtcm_smalloc_pool;
 
 /* undefined behavior handler is called on typical malloc UB situations */
 typedef void (*smalloc_ub_handler)(struct smalloc_pool *, const void *);
@@ -57,6 +86,7 @@ void sm_set_ub_handler(smalloc_ub_handler);
 
 int sm_align_pool(struct smalloc_pool *);
 int sm_set_pool(struct smalloc_pool *, void *, size_t, int, smalloc_oom_handler);
+void sm_set_validation(struct smalloc_pool *, int);
 int sm_set_default_pool(void *, size_t, int, smalloc_oom_handler);
 int sm_release_pool(struct smalloc_pool *);
 int sm_release_default_pool(void);
@@ -75,6 +105,11 @@ int sm_alloc_valid_pool(struct smalloc_pool *spool, const void *p);
 
 size_t sm_szalloc_pool(struct smalloc_pool *, const void *);
 int sm_malloc_stats_pool(struct smalloc_pool *, size_t *, size_t *, size_t *, int *);
+/*
+ * get fragmentation: total free, largest contiguous free, nr. of free runs.
+ * blocks held in bins count as used.
+ */
+int sm_malloc_frag_pool(struct smalloc_pool *, size_t *, size_t *, int *);
 
 /* Use these when you use just default smalloc_curr_pool pool */
 
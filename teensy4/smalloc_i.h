@@ -8,6 +8,7 @@
 #define _SMALLOC_I_H
 
 #include "smalloc.h"
+#include "heap_profile.h"
 #include <string.h>
 #include <limits.h>
 #include <errno.h>
@@ -38,6 +39,14 @@ uintptr_t smalloc_uinthash(uintptr_t x);
 uintptr_t smalloc_mktag(struct smalloc_hdr *shdr);
 int smalloc_verify_pool(struct smalloc_pool *spool);
 int smalloc_is_alloc(struct smalloc_pool *spool, struct smalloc_hdr *shdr);
+int smalloc_check_alloc(struct smalloc_pool *spool, struct smalloc_hdr *shdr);
+int smalloc_is_binned(struct smalloc_pool *spool, struct smalloc_hdr *shdr);
+int smalloc_is_used(struct smalloc_pool *spool, struct smalloc_hdr *shdr);
+
+void *smalloc_bin_get(struct smalloc_pool *spool, size_t n);
+int smalloc_bin_put(struct smalloc_pool *spool, struct smalloc_hdr *shdr);
+int smalloc_bin_remove(struct smalloc_pool *spool, struct smalloc_hdr *shdr);
+int smalloc_bin_flush(struct smalloc_pool *spool);
 
 void *sm_realloc_pool_i(struct smalloc_pool *spool, void *p, size_t n, int nomove);
 
@@ -26,6 +26,7 @@ void (* volatile _VectorsRam[NVIC_NUM_INTERRUPTS+16])(void);
 
 static void memory_copy(uint32_t *dest, const uint32_t *src, uint32_t *dest_end);
 static void memory_clear(uint32_t *dest, uint32_t *dest_end);
+static void memory_paint(uint32_t *dest, uint32_t *dest_end);
 static void configure_systick(void);
 static void reset_PFD();
 extern void systick_isr(void);
@@ -43,6 +44,28 @@ uint32_t set_arm_clock(uint32_t frequency); // clockspeed.c
 extern void __libc_init_array(void); // C++ standard library
 
 uint8_t external_psram_size = 0;
+
+// Microseconds from reset to the end of each startup phase, STARTUP_TIME_*
+uint32_t startup_time_usec[STARTUP_TIME_NUM];
+
+// USB begins at TEENSY_INIT_USB_DELAY_BEFORE ms after reset, and setup()
+// runs TEENSY_INIT_USB_DELAY_AFTER ms later, so the PC has time to detect
+// the device before the program prints anything.
+#ifndef TEENSY_INIT_USB_DELAY_BEFORE
+#define TEENSY_INIT_USB_DELAY_BEFORE 20
+#endif
+#ifndef TEENSY_INIT_USB_DELAY_AFTER
+#define TEENSY_INIT_USB_DELAY_AFTER 280
+#endif
+
+// The cycle counter runs at the ARM clock, which set_arm_clock() changes,
+// so elapsed cycles are converted at the current speed at each phase.
+#define STARTUP_TIME(phase) do { \
+	uint32_t now = ARM_DWT_CYCCNT; \
+	startup_usec += (now - startup_cycles) / (F_CPU_ACTUAL / 1000000); \
+	startup_cycles = now; \
+	startup_time_usec[phase] = startup_usec; \
+} while (0)
 #ifdef ARDUINO_TEENSY41
 struct smalloc_pool extmem_smalloc_pool;
 #endif
@@ -54,10 +77,23 @@ FLASHMEM void startup_default_middle_hook(void) {}
 void startup_middle_hook(void)	__attribute__ ((weak, alias("startup_default_middle_hook")));
 FLASHMEM void startup_default_late_hook(void) {}
 void startup_late_hook(void)	__attribute__ ((weak, alias("startup_default_late_hook")));
+// A sketch may define startup_mpu_regions() to add MPU regions, for example
+// a non-cacheable area for DMA or write-through cached EXTMEM:
+//   static const mpu_region_t regions[] = {
+//     {0x20280000, MPU_MEM_NOCACHE | MPU_READWRITE | MPU_NOEXEC | MPU_SIZE(65536)},
+//   };
+//   extern "C" uint32_t startup_mpu_regions(const mpu_region_t **table) {
+//     *table = regions;
+//     return sizeof(regions) / sizeof(regions[0]);
+//   }
+// It is called before the caches are enabled.  Up to 6 regions may be added.
+FLASHMEM uint32_t startup_default_mpu_regions(const mpu_region_t **table) { return 0; }
+uint32_t startup_mpu_regions(const mpu_region_t **table) __attribute__ ((weak, alias("startup_default_mpu_regions")));
 __attribute__((section(".startup"), optimize("no-tree-loop-distribute-patterns")))
 void ResetHandler(void)
 {
 	unsigned int i;
+	uint32_t startup_cycles, startup_usec = 0;
 
 #if defined(__IMXRT1062__)
 	IOMUXC_GPR_GPR17 = (uint32_t)&_flexram_bank_config;
@@ -67,6 +103,9 @@ void ResetHandler(void)
 	__asm__ volatile("dsb":::"memory");
 	__asm__ volatile("isb":::"memory");
 #endif
+	ARM_DEMCR |= ARM_DEMCR_TRCENA;
+	ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA; // cycle counter, for startup_time_usec
+	startup_cycles = ARM_DWT_CYCCNT;
 	startup_early_hook(); // must be in FLASHMEM, as ITCM is not yet initialized!
 	PMU_MISC0_SET = 1<<3; //Use bandgap-based bias currents for best performance (Page 1175)
 	// pin 13 - if startup crashes, use this to turn on the LED early for troubleshooting
@@ -80,13 +119,18 @@ void ResetHandler(void)
 	memory_copy(&_stext, &_stextload, &_etext);
 	memory_copy(&_sdata, &_sdataload, &_edata);
 	memory_clear(&_sbss, &_ebss);
+	uint32_t *sp;
+	__asm__ volatile("mov %0, sp" : "=r" (sp) : : );
+	memory_paint(&_ebss + 8, sp - 64); // above MPU guard, below this function
+	crashreport_counter_add(CRASHREPORT_COUNTER_RESETS, 1);
+	STARTUP_TIME(STARTUP_TIME_MEMORY);
 
 	// enable FPU
 	SCB_CPACR = 0x00F00000;
 
 	// set up blank interrupt & exception vector table
 	for (i=0; i < NVIC_NUM_INTERRUPTS + 16; i++) _VectorsRam[i] = &unused_interrupt_vector;
-	for (i=0; i < NVIC_NUM_INTERRUPTS; i++) NVIC_SET_PRIORITY(i, 128);
+	for (i=0; i < NVIC_NUM_INTERRUPTS; i++) NVIC_SET_PRIORITY(i, IRQ_PRIORITY_DEFAULT);
 	SCB_VTOR = (uint32_t)_VectorsRam;
 
 	reset_PFD();
@@ -118,9 +162,11 @@ void ResetHandler(void)
 	configure_systick();
 	usb_pll_start();	
 	reset_PFD(); //TODO: is this really needed?
+	STARTUP_TIME(STARTUP_TIME_USB_PLL);
 #ifdef F_CPU
 	set_arm_clock(F_CPU);
 #endif
+	STARTUP_TIME(STARTUP_TIME_ARM_CLOCK);
 
 	// Undo PIT timer usage by ROM startup
 	CCM_CCGR1 |= CCM_CCGR1_PIT(CCM_CCGR_ON);
@@ -138,21 +184,39 @@ void ResetHandler(void)
 		SNVS_LPCR |= SNVS_LPCR_SRTC_ENV;
 	}
 	SNVS_HPCR |= SNVS_HPCR_RTC_EN | SNVS_HPCR_HP_TS;
+	STARTUP_TIME(STARTUP_TIME_RTC);
 
 #ifdef ARDUINO_TEENSY41
 	configure_external_ram();
 #endif
+	STARTUP_TIME(STARTUP_TIME_EXTERNAL_RAM);
+#ifndef STARTUP_DEFER_INIT
+	// with STARTUP_DEFER_INIT, the ADC initializes at the first analogRead(),
+	// and each PWM module when a pin using it is first written
 	analog_init();
+	STARTUP_TIME(STARTUP_TIME_ANALOG);
 	pwm_init();
+	STARTUP_TIME(STARTUP_TIME_PWM);
+#endif
+#ifndef STARTUP_DEFER_TEMPMON
+	// tempmon also arms the overheat panic shutdown, so deferring it to the
+	// first tempmonGetTemp() with STARTUP_DEFER_TEMPMON is a separate choice
 	tempmon_init();
+	STARTUP_TIME(STARTUP_TIME_TEMPMON);
+#endif
 	startup_middle_hook();
-	while (millis() < 20) ; // wait at least 20ms before starting USB
+	STARTUP_TIME(STARTUP_TIME_MIDDLE_HOOK);
+	while (millis() < TEENSY_INIT_USB_DELAY_BEFORE) ; // wait before starting USB
 	usb_init();
+	STARTUP_TIME(STARTUP_TIME_USB);
 
-	while (millis() < 300) ; // wait at least 300ms before calling user code
+	// wait before calling user code
+	while (millis() < TEENSY_INIT_USB_DELAY_BEFORE + TEENSY_INIT_USB_DELAY_AFTER) ;
+	STARTUP_TIME(STARTUP_TIME_USB_DELAY);
 	//printf("before C++ constructors\n");
 	startup_late_hook();
 	__libc_init_array();
+	STARTUP_TIME(STARTUP_TIME_CONSTRUCTORS);
 	//printf("after C++ constructors\n");
 	//printf("before setup\n");
 	main();
@@ -181,7 +245,7 @@ static void configure_systick(void)
 	SYST_RVR = (SYSTICK_EXT_FREQ / 1000) - 1;
 	SYST_CVR = 0;
 	SYST_CSR = SYST_CSR_TICKINT | SYST_CSR_ENABLE;
-	SCB_SHPR3 = 0x20200000;  // Systick, pendablesrvreq_isr = priority 32;
+	SCB_SHPR3 = (IRQ_PRIORITY_SYSTICK << 24) | (IRQ_PRIORITY_SYSTICK << 16); // Systick, pendablesrvreq_isr
 	ARM_DEMCR |= ARM_DEMCR_TRCENA;
 	ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA; // turn on cycle counter
 	systick_cycle_count = ARM_DWT_CYCCNT; // compiled 0, corrected w/1st systick
@@ -270,6 +334,15 @@ FLASHMEM void configure_cache(void)
 	SCB_MPU_RBAR = 0x70000000 | REGION(i++); // FlexSPI2
 	SCB_MPU_RASR = MEM_CACHE_WBWA | READWRITE | NOEXEC | SIZE_16M;
 
+	// regions added by startup_mpu_regions() come last, so they take
+	// priority over the defaults where they overlap
+	const mpu_region_t *table;
+	uint32_t count = startup_mpu_regions(&table);
+	for (uint32_t n=0; n < count && i < 16; n++) {
+		SCB_MPU_RBAR = (table[n].addr & SCB_MPU_RBAR_ADDR_MASK) | REGION(i++);
+		SCB_MPU_RASR = table[n].attr;
+	}
+
 	// TODO: protect access to power supply config
 
 	SCB_MPU_CTRL = SCB_MPU_CTRL_ENABLE;
@@ -316,6 +389,41 @@ FLASHMEM static uint32_t flexspi2_psram_id(uint32_t addr)
 	return id & 0xFFFF;
 }
 
+// PSRAM clock, divided from the 528 MHz PLL2.  88 MHz is the cautious
+// default.  The PSRAM chips are rated for 133 MHz, so -DEXTMEM_CLOCK_MHZ=106
+// or 132 gives more bandwidth where the board layout allows it.
+#ifndef EXTMEM_CLOCK_MHZ
+#define EXTMEM_CLOCK_MHZ 88
+#endif
+#if EXTMEM_CLOCK_MHZ >= 132
+#define EXTMEM_CLOCK_PODF 3	// 132 MHz
+#elif EXTMEM_CLOCK_MHZ >= 105
+#define EXTMEM_CLOCK_PODF 4	// 105.6 MHz
+#elif EXTMEM_CLOCK_MHZ >= 88
+#define EXTMEM_CLOCK_PODF 5	// 88 MHz
+#else
+#define EXTMEM_CLOCK_PODF 7	// 66 MHz
+#endif
+
+// -DEXTMEM_PREFETCH=1 lets FlexSPI2 read ahead into its AHB buffers, so
+// sequential reads stream while earlier data is consumed.
+// -DEXTMEM_BUFFERABLE=1 lets AHB writes finish before reaching the PSRAM.
+#ifndef EXTMEM_PREFETCH
+#define EXTMEM_PREFETCH 0
+#endif
+#ifndef EXTMEM_BUFFERABLE
+#define EXTMEM_BUFFERABLE 0
+#endif
+
+// A sketch may define extmem_ahb_buffers() to give FlexSPI2's AHB read
+// buffers to specific bus masters (IDs in the FlexSPI chapter of the
+// reference manual), so for example DMA streaming an audio delay line
+// doesn't evict the CPU's buffered frame buffer reads.  Entries set
+// buffers 0, 1, 2 and 3 in order.  Returning 0 keeps the default, 2
+// buffers of 512 bytes for master 0, the CPU.
+FLASHMEM uint32_t extmem_default_ahb_buffers(const extmem_ahb_buffer_t **table) { return 0; }
+uint32_t extmem_ahb_buffers(const extmem_ahb_buffer_t **table) __attribute__ ((weak, alias("extmem_default_ahb_buffers")));
+
 FLASHMEM void configure_external_ram()
 {
 	// initialize pins
@@ -344,9 +452,9 @@ FLASHMEM void configure_external_ram()
 	IOMUXC_FLEXSPI2_IPP_IND_IO_FA_BIT3_SELECT_INPUT = 1; // GPIO_EMC_29 for Mode: ALT8
 	IOMUXC_FLEXSPI2_IPP_IND_SCK_FA_SELECT_INPUT = 1; // GPIO_EMC_25 for Mode: ALT8
 
-	// turn on clock  (TODO: increase clock speed later, slow & cautious for first release)
+	// turn on clock, PLL2 / (EXTMEM_CLOCK_PODF + 1)
 	CCM_CBCMR = (CCM_CBCMR & ~(CCM_CBCMR_FLEXSPI2_PODF_MASK | CCM_CBCMR_FLEXSPI2_CLK_SEL_MASK))
-		| CCM_CBCMR_FLEXSPI2_PODF(5) | CCM_CBCMR_FLEXSPI2_CLK_SEL(3); // 88 MHz
+		| CCM_CBCMR_FLEXSPI2_PODF(EXTMEM_CLOCK_PODF) | CCM_CBCMR_FLEXSPI2_CLK_SEL(3);
 	CCM_CCGR7 |= CCM_CCGR7_FLEXSPI2(CCM_CCGR_ON);
 
 	FLEXSPI2_MCR0 |= FLEXSPI_MCR0_MDIS;
@@ -363,16 +471,43 @@ FLASHMEM void configure_external_ram()
 		 | FLEXSPI_MCR2_CLRLEARNPHASE | FLEXSPI_MCR2_CLRAHBBUFOPT))
 		| FLEXSPI_MCR2_RESUMEWAIT(0x20) /*| FLEXSPI_MCR2_SAMEDEVICEEN*/;
 
-	FLEXSPI2_AHBCR = FLEXSPI2_AHBCR & ~(FLEXSPI_AHBCR_READADDROPT | FLEXSPI_AHBCR_PREFETCHEN
-		| FLEXSPI_AHBCR_BUFFERABLEEN | FLEXSPI_AHBCR_CACHABLEEN);
+	FLEXSPI2_AHBCR = (FLEXSPI2_AHBCR & ~(FLEXSPI_AHBCR_READADDROPT | FLEXSPI_AHBCR_PREFETCHEN
+		| FLEXSPI_AHBCR_BUFFERABLEEN | FLEXSPI_AHBCR_CACHABLEEN))
+#if EXTMEM_PREFETCH
+		| FLEXSPI_AHBCR_PREFETCHEN
+#endif
+#if EXTMEM_BUFFERABLE
+		| FLEXSPI_AHBCR_BUFFERABLEEN
+#endif
+		;
 	uint32_t mask = (FLEXSPI_AHBRXBUFCR0_PREFETCHEN | FLEXSPI_AHBRXBUFCR0_PRIORITY_MASK
 		| FLEXSPI_AHBRXBUFCR0_MSTRID_MASK | FLEXSPI_AHBRXBUFCR0_BUFSZ_MASK);
-	FLEXSPI2_AHBRXBUF0CR0 = (FLEXSPI2_AHBRXBUF0CR0 & ~mask)
-		| FLEXSPI_AHBRXBUFCR0_PREFETCHEN | FLEXSPI_AHBRXBUFCR0_BUFSZ(64);
-	FLEXSPI2_AHBRXBUF1CR0 = (FLEXSPI2_AHBRXBUF0CR0 & ~mask)
-		| FLEXSPI_AHBRXBUFCR0_PREFETCHEN | FLEXSPI_AHBRXBUFCR0_BUFSZ(64);
-	FLEXSPI2_AHBRXBUF2CR0 = mask;
-	FLEXSPI2_AHBRXBUF3CR0 = mask;
+	const extmem_ahb_buffer_t *buffers;
+	uint32_t count = extmem_ahb_buffers(&buffers);
+	if (count == 0) {
+		FLEXSPI2_AHBRXBUF0CR0 = (FLEXSPI2_AHBRXBUF0CR0 & ~mask)
+			| FLEXSPI_AHBRXBUFCR0_PREFETCHEN | FLEXSPI_AHBRXBUFCR0_BUFSZ(64);
+		FLEXSPI2_AHBRXBUF1CR0 = (FLEXSPI2_AHBRXBUF1CR0 & ~mask)
+			| FLEXSPI_AHBRXBUFCR0_PREFETCHEN | FLEXSPI_AHBRXBUFCR0_BUFSZ(64);
+		FLEXSPI2_AHBRXBUF2CR0 = mask;
+		FLEXSPI2_AHBRXBUF3CR0 = mask;
+	} else {
+		volatile uint32_t *cr0 = &FLEXSPI2_AHBRXBUF0CR0;
+		for (uint32_t n=0; n < 4; n++) {
+			// the CR0 registers are 4 bytes apart
+			if (n < count) {
+				// BUFSZ is 8 bits of 64 bit units, so at most 2040 bytes
+				uint32_t units = buffers[n].size >> 3;
+				if (units > 255) units = 255;
+				cr0[n] = (buffers[n].prefetch ? FLEXSPI_AHBRXBUFCR0_PREFETCHEN : 0)
+					| FLEXSPI_AHBRXBUFCR0_PRIORITY(buffers[n].priority)
+					| FLEXSPI_AHBRXBUFCR0_MSTRID(buffers[n].master)
+					| FLEXSPI_AHBRXBUFCR0_BUFSZ(units);
+			} else {
+				cr0[n] = mask;
+			}
+		}
+	}
 
 	// RX watermark = one 64 bit line
 	FLEXSPI2_IPRXFCR = (FLEXSPI_IPRXFCR & 0xFFFFFFC0) | FLEXSPI_IPRXFCR_CLRIPRXF;
@@ -622,6 +757,28 @@ static void memory_clear(uint32_t *dest, uint32_t *dest_end)
 	}
 }
 
+__attribute__((section(".startup"), optimize("O1")))
+static void memory_paint(uint32_t *dest, uint32_t *dest_end)
+{
+	while (dest < dest_end) {
+		*dest++ = STACK_PAINT;
+	}
+}
+
+uint32_t stackHighWater(void)
+{
+	const uint32_t *p = (uint32_t *)&_ebss + 8;
+	const uint32_t *end = (uint32_t *)&_estack;
+
+	while (p < end && *p == STACK_PAINT) p++;
+	return (uint32_t)end - (uint32_t)p;
+}
+
+uint32_t stackSize(void)
+{
+	return (uint32_t)&_estack - (uint32_t)((uint32_t *)&_ebss + 8);
+}
+
 
 
 // syscall functions need to be in the same C file as the entry point "ResetVector"
@@ -631,6 +788,8 @@ static void memory_clear(uint32_t *dest, uint32_t *dest_end)
 
 // from the linker script
 extern unsigned long _heap_start;
+extern unsigned long _heap_gap_start; // CrashReport area at the top of RAM2
+extern unsigned long _heap_gap_end;
 extern unsigned long _heap_end;
 
 char *__brkval = (char *)&_heap_start;
@@ -639,6 +798,10 @@ void * _sbrk(int incr)
 {
         char *prev = __brkval;
         if (incr != 0) {
+                if (prev <= (char *)&_heap_gap_start && prev + incr > (char *)&_heap_gap_start) {
+                        // continue in the FlexRAM OCRAM banks above, if any
+                        prev = (char *)&_heap_gap_end;
+                }
                 if (prev + incr > (char *)&_heap_end) {
                         errno = ENOMEM;
                         return (void *)-1;
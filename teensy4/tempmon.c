@@ -1,4 +1,5 @@
 #include "imxrt.h"
+#include "irq_priority.h"
 #include "core_pins.h"
 #include "avr/pgmspace.h"
 #include "debug/printf.h"
@@ -10,6 +11,11 @@ static uint32_t lowAlarmTemp    = 25U;
 static uint32_t panicAlarmTemp  = 90U;
 
 static uint32_t s_hotTemp, s_hotCount;
+#ifdef STARTUP_DEFER_TEMPMON
+// tempmon_init() runs at the first tempmonGetTemp(), rather than at startup.
+// Until then the overheat panic shutdown is not armed.
+static uint8_t tempmon_ready = 0;
+#endif
 static float s_hot_ROOM, s_roomC_hotC;
 
 extern void unused_interrupt_vector(void); // startup.c
@@ -31,6 +37,9 @@ FLASHMEM void tempmon_init(void)
   uint32_t roomCount;
   uint32_t tempCodeVal;
       
+#ifdef STARTUP_DEFER_TEMPMON
+  tempmon_ready = 1;
+#endif
   //first power on the temperature sensor - no register change
   TEMPMON_TEMPSENSE0 &= ~0x1U;
 
@@ -68,11 +77,24 @@ FLASHMEM void tempmon_init(void)
 }
 
 
+// Convert degrees C to a temperature code for the alarm registers.  Codes
+// decrease as temperature increases.
+static uint32_t tempmon_code(float temp)
+{
+  float code = (float)s_hotCount + ((float)s_hotTemp - temp) * s_roomC_hotC / s_hot_ROOM;
+  if (code < 0.0f) return 0;
+  if (code > 4095.0f) return 0xFFF;
+  return (uint32_t)code;
+}
+
 float tempmonGetTemp(void)
 {
     uint32_t nmeas;
     float tmeas;
 
+#ifdef STARTUP_DEFER_TEMPMON
+    if (!tempmon_ready) tempmon_init();
+#endif
     while (!(TEMPMON_TEMPSENSE0 & 0x4U))
     {
     }
@@ -99,3 +121,109 @@ void tempmon_PwrDwn()
 {
     TEMPMON_TEMPSENSE0 |= 0x1U;
 }
+
+
+// Thermal throttling.  Above the hot temperature, the ARM clock steps down
+// by 1/8 for each degree hotter, up to TEMPMON_THROTTLE_LEVELS steps.  Each
+// step is undone as the chip cools, one degree at a time, to the cool
+// temperature.  The alarm thresholds move with every step, so the
+// interrupt only occurs when a step is needed.  set_arm_clock() waits for
+// the PLL and voltage regulator, so the interrupt only chooses the level
+// and yield() changes the clock.  The panic shutdown stays armed in case
+// throttling is not enough.
+#ifndef TEMPMON_THROTTLE_LEVELS
+#define TEMPMON_THROTTLE_LEVELS 6
+#endif
+
+volatile uint8_t tempmon_throttle_level = 0;
+volatile uint8_t tempmon_throttle_pending = 0;
+struct tempmon_throttle_stats_struct tempmon_throttle_stats;
+static volatile uint8_t throttle_target = 0;
+static uint32_t throttle_hot, throttle_cool;
+static uint32_t throttle_base_freq;
+static uint32_t throttle_millis;
+
+static void tempmon_throttle_alarms(uint32_t level)
+{
+  // high alarm: next step down, or none at the last level
+  uint32_t high = (level < TEMPMON_THROTTLE_LEVELS) ? tempmon_code(throttle_hot + level) : 0;
+  // low alarm: next step up, or none when not throttled
+  uint32_t low = (level > 0) ? tempmon_code(throttle_cool + level - 1) : 0xFFF;
+  TEMPMON_TEMPSENSE0 = (TEMPMON_TEMPSENSE0 & ~0xFFF00000U) | (high << 20);
+  TEMPMON_TEMPSENSE2 = (TEMPMON_TEMPSENSE2 & ~0xFFFU) | low;
+}
+
+static void tempmon_throttle_set(uint32_t level)
+{
+  uint32_t now = systick_millis_count;
+  if (tempmon_throttle_level > 0) {
+    tempmon_throttle_stats.throttled_msec += now - throttle_millis;
+  } else {
+    throttle_base_freq = F_CPU_ACTUAL;
+  }
+  throttle_millis = now;
+  if (level > tempmon_throttle_level) {
+    if (tempmon_throttle_level == 0) {
+      crashreport_counter_add(CRASHREPORT_COUNTER_THERMAL, 1);
+    }
+    tempmon_throttle_stats.steps_down++;
+  } else {
+    tempmon_throttle_stats.steps_up++;
+  }
+  if (level > tempmon_throttle_stats.max_level) tempmon_throttle_stats.max_level = level;
+  tempmon_throttle_level = level;
+  set_arm_clock(throttle_base_freq - throttle_base_freq / 8 * level);
+}
+
+static void tempmon_throttle_isr(void)
+{
+  uint32_t level = throttle_target;
+  float temp = tempmonGetTemp();
+
+  if (temp > tempmon_throttle_stats.max_temp) tempmon_throttle_stats.max_temp = temp;
+  if (level < TEMPMON_THROTTLE_LEVELS && temp >= (float)(throttle_hot + level)) {
+    level++;
+  } else if (level > 0 && temp < (float)(throttle_cool + level - 1)) {
+    level--;
+  }
+  // move the alarms now, so this interrupt doesn't repeat until yield()
+  tempmon_throttle_alarms(level);
+  if (level != throttle_target) {
+    throttle_target = level;
+    tempmon_throttle_pending = 1;
+  }
+}
+
+// called by yield() when the interrupt chose a new level
+void tempmon_throttle_update(void)
+{
+  tempmon_throttle_pending = 0;
+  uint32_t level = throttle_target;
+  if (level != tempmon_throttle_level) tempmon_throttle_set(level);
+}
+
+void tempmon_throttle_begin(uint32_t hot_temp, uint32_t cool_temp)
+{
+#ifdef STARTUP_DEFER_TEMPMON
+  if (!tempmon_ready) tempmon_init();
+#endif
+  if (cool_temp >= hot_temp) cool_temp = hot_temp - 1;
+  NVIC_DISABLE_IRQ(IRQ_TEMPERATURE);
+  throttle_hot = hot_temp;
+  throttle_cool = cool_temp;
+  throttle_target = tempmon_throttle_level;
+  tempmon_throttle_alarms(tempmon_throttle_level);
+  NVIC_SET_PRIORITY(IRQ_TEMPERATURE, IRQ_PRIORITY_BACKGROUND);
+  attachInterruptVector(IRQ_TEMPERATURE, &tempmon_throttle_isr);
+  NVIC_ENABLE_IRQ(IRQ_TEMPERATURE);
+}
+
+void tempmon_throttle_end(void)
+{
+  NVIC_DISABLE_IRQ(IRQ_TEMPERATURE);
+  tempmon_throttle_pending = 0;
+  throttle_target = 0;
+  if (tempmon_throttle_level > 0) tempmon_throttle_set(0);
+  TEMPMON_TEMPSENSE0 = (TEMPMON_TEMPSENSE0 & ~0xFFF00000U) | (tempmon_code(highAlarmTemp) << 20);
+  TEMPMON_TEMPSENSE2 = (TEMPMON_TEMPSENSE2 & ~0xFFFU) | tempmon_code(lowAlarmTemp);
+}
@@ -12,6 +12,9 @@
 #include "usb_midi.h"
 #include "usb_audio.h"
 #include "usb_mtp.h"
+#include "usb_vendor.h"
+#include "usb_ncm.h"
+#include "usb_video.h"
 #include "core_pins.h" // for delay()
 #include "avr/pgmspace.h"
 #include <string.h>
@@ -91,6 +94,10 @@ typedef union {
 static setup_t endpoint0_setupdata;
 static uint32_t endpoint0_notify_mask=0;
 static uint32_t endpointN_notify_mask=0;
+static uint32_t endpointN_ioc_on_request=0; // only USB_TRANSFER_IOC transfers interrupt
+// marks the middle of a receive chain, in transfer_t callback_param, which
+// the controller never reads.  Cleared before the callback sees it.
+#define TRANSFER_CHAIN_MIDDLE 0x80000000
 //static int reset_count=0;
 volatile uint8_t usb_configuration = 0; // non-zero when USB host as configured device
 volatile uint8_t usb_high_speed = 0;    // non-zero if running at 480 Mbit/sec speed
@@ -105,6 +112,45 @@ extern const uint8_t usb_config_descriptor_12[];
 void (*usb_timer0_callback)(void) = NULL;
 void (*usb_timer1_callback)(void) = NULL;
 
+volatile uint8_t usb_suspended = 0;
+volatile uint8_t usb_power_save_pending = 0;
+static void (*usb_suspend_callback)(void) = NULL;
+static void (*usb_resume_callback)(void) = NULL;
+static uint32_t usb_suspend_arm_freq = 0;
+static uint32_t usb_resume_arm_freq = 0;	// speed before suspend, 0 = not lowered
+static uint8_t usb_resume_governor = 0;
+#ifdef USB_REMOTE_WAKEUP
+static uint8_t usb_remote_wakeup_enabled = 0;
+#endif
+
+#ifdef USB_STATS
+usb_stats_t usb_stats;
+// cycle count when each endpoint's oldest transfer began waiting
+static uint32_t stats_begin[(NUM_ENDPOINTS+1)*2];
+
+static usb_endpoint_stats_t * stats_for_endpoint(endpoint_t *ep)
+{
+	uint32_t n = ep - endpoint_queue_head;
+	return (n & 1) ? &usb_stats.tx[n >> 1] : &usb_stats.rx[n >> 1];
+}
+
+static void stats_latency(usb_endpoint_stats_t *s, uint32_t cycles)
+{
+	uint32_t usec = cycles / (F_CPU_ACTUAL / 1000000);
+	if (usec > s->latency_max) s->latency_max = usec;
+	uint32_t bucket = usec ? 32 - __builtin_clz(usec) : 0;
+	if (bucket >= USB_STATS_HISTOGRAM_SIZE) bucket = USB_STATS_HISTOGRAM_SIZE - 1;
+	s->latency_histogram[bucket]++;
+}
+
+void usb_stats_clear(void)
+{
+	__disable_irq();
+	memset(&usb_stats, 0, sizeof(usb_stats));
+	__enable_irq();
+}
+#endif
+
 void usb_isr(void);
 static void endpoint0_setup(uint64_t setupdata);
 static void endpoint0_transmit(const void *data, uint32_t len, int notify);
@@ -200,6 +246,7 @@ FLASHMEM void usb_init(void)
 		USB_USBINTR_URE | USB_USBINTR_SLE;
 	//_VectorsRam[IRQ_USB1+16] = &usb_isr;
 	attachInterruptVector(IRQ_USB1, &usb_isr);
+	NVIC_SET_PRIORITY(IRQ_USB1, IRQ_PRIORITY_USB);
 	NVIC_ENABLE_IRQ(IRQ_USB1);
 	//printf("USB1_ENDPTCTRL0=%08lX\n", USB1_ENDPTCTRL0);
 	//printf("USB1_ENDPTCTRL1=%08lX\n", USB1_ENDPTCTRL1);
@@ -234,6 +281,23 @@ FLASHMEM void _reboot_Teensyduino_(void)
 void usb_isr(void)
 {
 	//printf("*");
+#ifdef USB_STATS
+	uint32_t isr_begin = ARM_DWT_CYCCNT;
+	usb_stats.isr_count++;
+	uint32_t nak = USB1_ENDPTNAK;
+	if (nak) {
+		USB1_ENDPTNAK = nak;
+		while (nak) {
+			int p = __builtin_ctz(nak);
+			if (p < USB_STATS_NUM_ENDPOINTS) {
+				usb_stats.rx[p].naks++;
+			} else if (p >= 16 && p - 16 < USB_STATS_NUM_ENDPOINTS) {
+				usb_stats.tx[p - 16].naks++;
+			}
+			nak &= ~(1 << p);
+		}
+	}
+#endif
 
 	//  Port control in device mode is only used for
 	//  status port reset, suspend, and current connect status.
@@ -308,6 +372,15 @@ void usb_isr(void)
 
 		}
 	}
+	if (usb_suspended && ((status & USB_USBSTS_URI) || ((status & USB_USBSTS_PCI)
+	  && !(USB1_PORTSC1 & USB_PORTSC1_SUSP)))) {
+		// host resumed the bus, or reset it
+		//printf("resume\n");
+		usb_suspended = 0;
+		USB1_USBINTR &= ~USB_USBINTR_PCE;
+		if (usb_suspend_arm_freq) usb_power_save_pending = 1;
+		if (usb_resume_callback) usb_resume_callback();
+	}
 	if (status & USB_USBSTS_URI) { // page 3164
 		USB1_ENDPTSETUPSTAT = USB1_ENDPTSETUPSTAT; // Clear all setup token semaphores
 		USB1_ENDPTCOMPLETE = USB1_ENDPTCOMPLETE; // Clear all the endpoint complete status
@@ -324,6 +397,10 @@ void usb_isr(void)
 		usb_serial_reset();
 		#endif
 		endpointN_notify_mask = 0;
+		endpointN_ioc_on_request = 0;
+		#ifdef USB_REMOTE_WAKEUP
+		usb_remote_wakeup_enabled = 0;
+		#endif
 		// TODO: Free all allocated dTDs
 		//if (++reset_count >= 3) {
 			// shut off USB - easier to see results in protocol analyzer
@@ -348,9 +425,17 @@ void usb_isr(void)
 	}
 	if (status & USB_USBSTS_SLI) { // page 3165
 		//printf("suspend\n");
+		if (!usb_suspended && (USB1_PORTSC1 & USB_PORTSC1_SUSP)) {
+			usb_suspended = 1;
+			// port change interrupt detects resume
+			USB1_USBINTR |= USB_USBINTR_PCE;
+			if (usb_suspend_arm_freq) usb_power_save_pending = 1;
+			if (usb_suspend_callback) usb_suspend_callback();
+		}
 	}
 	if (status & USB_USBSTS_UEI) {
 		//printf("error\n");
+		crashreport_counter_add(CRASHREPORT_COUNTER_USB_ERRORS, 1);
 	}
 	if ((USB1_USBINTR & USB_USBINTR_SRE) && (status & USB_USBSTS_SRI)) {
 		//printf("sof %d\n", usb_reboot_timer);
@@ -361,7 +446,16 @@ void usb_isr(void)
 			}
 		}
 		#ifdef MIDI_INTERFACE
-		usb_midi_flush_output();
+		usb_midi_sof_flush();
+		#endif
+		#ifdef KEYBOARD_INTERFACE
+		usb_keyboard_sof_flush();
+		#endif
+		#ifdef JOYSTICK_INTERFACE
+		usb_joystick_sof_flush();
+		#endif
+		#ifdef MOUSE_INTERFACE
+		usb_mouse_sof_flush();
 		#endif
 		#ifdef MULTITOUCH_INTERFACE
 		usb_touchscreen_update_callback();
@@ -370,9 +464,60 @@ void usb_isr(void)
 		usb_flightsim_flush_output();
 		#endif
 	}
+#ifdef USB_STATS
+	uint32_t isr_cycles = ARM_DWT_CYCCNT - isr_begin;
+	usb_stats.isr_cycles += isr_cycles;
+	if (isr_cycles > usb_stats.isr_cycles_max) usb_stats.isr_cycles_max = isr_cycles;
+#endif
 }
 
 
+void usb_set_suspend_callbacks(void (*suspend)(void), void (*resume)(void))
+{
+	NVIC_DISABLE_IRQ(IRQ_USB1);
+	usb_suspend_callback = suspend;
+	usb_resume_callback = resume;
+	NVIC_ENABLE_IRQ(IRQ_USB1);
+}
+
+void usb_suspend_power_save(uint32_t arm_freq)
+{
+	usb_suspend_arm_freq = arm_freq;
+	usb_power_save_pending = 1;
+}
+
+// Called by yield() when the USB interrupt has seen suspend or resume.
+// set_arm_clock() waits for the PLL, so it can't run in the interrupt.
+void usb_power_save_update(void)
+{
+	usb_power_save_pending = 0;
+	if (usb_suspended && usb_suspend_arm_freq) {
+		if (usb_resume_arm_freq) return; // already lowered
+		usb_resume_arm_freq = F_CPU_ACTUAL;
+		// the clock governor would speed up again, so pause it
+		usb_resume_governor = clock_governor_active;
+		clock_governor_active = 0;
+		set_arm_clock(usb_suspend_arm_freq);
+	} else if (usb_resume_arm_freq) {
+		set_arm_clock(usb_resume_arm_freq);
+		usb_resume_arm_freq = 0;
+		clock_governor_active = usb_resume_governor;
+	}
+}
+
+int usb_remote_wakeup(void)
+{
+#ifdef USB_REMOTE_WAKEUP
+	if (!usb_suspended || !usb_remote_wakeup_enabled) return 0;
+	// the controller drives resume (K state) and clears FPR when done,
+	// then the port change interrupt marks the bus as resumed
+	USB1_PORTSC1 |= USB_PORTSC1_FPR;
+	return 1;
+#else
+	return 0;
+#endif
+}
+
 void usb_start_sof_interrupts(int interface)
 {
 	__disable_irq();
@@ -420,6 +565,37 @@ static void endpoint0_setup(uint64_t setupdata)
 	const usb_descriptor_list_t *list;
 
 	setup.bothwords = setupdata;
+#if defined(VIDEO_INTERFACE)
+	// UVC requests to the streaming interface use the same codes as audio
+	// class requests, so they are matched by interface number first
+	if (setup.wIndex == VIDEO_INTERFACE+1) {
+		if (setup.wRequestAndType == 0x0B01) { // SET_INTERFACE
+			usb_video_set_interface(setup.wValue);
+			endpoint0_receive(NULL, 0, 0);
+			return;
+		}
+		if (setup.wRequestAndType == 0x0A81) { // GET_INTERFACE
+			endpoint0_buffer[0] = usb_video_get_interface();
+			endpoint0_transmit(endpoint0_buffer, 1, 0);
+			return;
+		}
+		if (setup.wRequestAndType == 0x0121 && setup.wLength <= 48) { // SET_CUR
+			// probe or commit, which can only select the one format
+			endpoint0_receive(usb_video_control_buffer, setup.wLength, 0);
+			return;
+		}
+		if (setup.bmRequestType == 0xA1) { // GET_CUR, GET_MIN, etc
+			uint32_t datalen = usb_video_get_control(setup.bRequest,
+				setup.wValue >> 8, usb_descriptor_buffer);
+			if (datalen > 0) {
+				if (datalen > setup.wLength) datalen = setup.wLength;
+				dma_buffer_to_device(usb_descriptor_buffer, datalen);
+				endpoint0_transmit(usb_descriptor_buffer, datalen, 0);
+				return;
+			}
+		}
+	}
+#endif
 	switch (setup.wRequestAndType) {
 	  case 0x0500: // SET_ADDRESS
 		endpoint0_receive(NULL, 0, 0);
@@ -484,6 +660,15 @@ static void endpoint0_setup(uint64_t setupdata)
 		#if defined(MTP_INTERFACE)
 		usb_mtp_configure();
 		#endif
+		#if defined(VENDOR_INTERFACE)
+		usb_vendor_configure();
+		#endif
+		#if defined(NCM_STATUS_INTERFACE)
+		usb_ncm_configure();
+		#endif
+		#if defined(VIDEO_INTERFACE)
+		usb_video_configure();
+		#endif
 		#if defined(EXPERIMENTAL_INTERFACE)
 		endpoint_queue_head[2].unused1 = (uint32_t)experimental_buffer;
 		#endif
@@ -495,9 +680,20 @@ static void endpoint0_setup(uint64_t setupdata)
 		return;
 	  case 0x0080: // GET_STATUS (device)
 		reply_buffer[0] = 0;
+		#ifdef USB_REMOTE_WAKEUP
+		if (usb_remote_wakeup_enabled) reply_buffer[0] = 2;
+		#endif
 		reply_buffer[1] = 0;
 		endpoint0_transmit(reply_buffer, 2, 0);
 		return;
+#ifdef USB_REMOTE_WAKEUP
+	  case 0x0300: // SET_FEATURE (device)
+	  case 0x0100: // CLEAR_FEATURE (device)
+		if (setup.wValue != 1) break; // 1 = DEVICE_REMOTE_WAKEUP
+		usb_remote_wakeup_enabled = (setup.bRequest == 3);
+		endpoint0_receive(NULL, 0, 0);
+		return;
+#endif
 	  case 0x0082: // GET_STATUS (endpoint)
 		endpoint = setup.wIndex & 0x7F;
 		if (endpoint > 7) break;
@@ -562,12 +758,86 @@ static void endpoint0_setup(uint64_t setupdata)
 					memcpy(usb_descriptor_buffer, list->addr, datalen);
 				}
 				// prep transmit
-				arm_dcache_flush_delete(usb_descriptor_buffer, datalen);
+				dma_buffer_to_device(usb_descriptor_buffer, datalen);
 				endpoint0_transmit(usb_descriptor_buffer, datalen, 0);
 				return;
 			}
 		}
 		break;
+#if defined(VENDOR_INTERFACE)
+	  case (VENDOR_MSOS20_CODE << 8) | 0xC0: // vendor request, device to host
+		if (setup.wIndex == 7) { // MS_OS_20_DESCRIPTOR_INDEX
+			uint32_t datalen = VENDOR_MSOS20_DESC_SIZE;
+			if (datalen > setup.wLength) datalen = setup.wLength;
+			memcpy(usb_descriptor_buffer, &usb_msos20_descriptor, datalen);
+			dma_buffer_to_device(usb_descriptor_buffer, datalen);
+			endpoint0_transmit(usb_descriptor_buffer, datalen, 0);
+			return;
+		}
+		break;
+#endif
+#if defined(NCM_STATUS_INTERFACE)
+	  case 0x80A1: // NCM GET_NTB_PARAMETERS
+		if (setup.wIndex == NCM_STATUS_INTERFACE) {
+			uint32_t datalen = usb_ncm_get_ntb_parameters(usb_descriptor_buffer);
+			if (datalen > setup.wLength) datalen = setup.wLength;
+			dma_buffer_to_device(usb_descriptor_buffer, datalen);
+			endpoint0_transmit(usb_descriptor_buffer, datalen, 0);
+			return;
+		}
+		break;
+	  case 0x83A1: // NCM GET_NTB_FORMAT
+		if (setup.wIndex == NCM_STATUS_INTERFACE && setup.wLength >= 2) {
+			endpoint0_buffer[0] = 0; // 0 = NTB-16
+			endpoint0_buffer[1] = 0;
+			endpoint0_transmit(endpoint0_buffer, 2, 0);
+			return;
+		}
+		break;
+	  case 0x8421: // NCM SET_NTB_FORMAT
+		if (setup.wIndex == NCM_STATUS_INTERFACE && setup.wValue == 0) {
+			endpoint0_receive(NULL, 0, 0);
+			return;
+		}
+		break;
+	  case 0x85A1: // NCM GET_NTB_INPUT_SIZE
+		if (setup.wIndex == NCM_STATUS_INTERFACE && setup.wLength >= 4) {
+			uint32_t size = usb_ncm_get_ntb_input_size();
+			memcpy(endpoint0_buffer, &size, 4);
+			endpoint0_transmit(endpoint0_buffer, 4, 0);
+			return;
+		}
+		break;
+	  case 0x8621: // NCM SET_NTB_INPUT_SIZE
+		if (setup.wIndex == NCM_STATUS_INTERFACE && (setup.wLength == 4
+		  || setup.wLength == 8)) {
+			endpoint0_setupdata.bothwords = setupdata;
+			endpoint0_receive(endpoint0_buffer, setup.wLength, 1);
+			return;
+		}
+		break;
+	  case 0x4321: // NCM SET_ETHERNET_PACKET_FILTER
+		if (setup.wIndex == NCM_STATUS_INTERFACE) {
+			// the host is the only other node, so all frames are for us
+			endpoint0_receive(NULL, 0, 0);
+			return;
+		}
+		break;
+	  case 0x0B01: // SET_INTERFACE (alternate setting)
+		if (setup.wIndex == NCM_DATA_INTERFACE && setup.wValue <= 1) {
+			usb_ncm_set_interface(setup.wValue);
+			endpoint0_receive(NULL, 0, 0);
+			return;
+		}
+		break;
+	  case 0x0A81: // GET_INTERFACE (alternate setting)
+		if (setup.wIndex == NCM_DATA_INTERFACE) {
+			endpoint0_buffer[0] = usb_ncm_get_interface();
+			endpoint0_transmit(endpoint0_buffer, 1, 0);
+			return;
+		}
+		break;
+#endif
 #if defined(CDC_STATUS_INTERFACE)
 	  case 0x2221: // CDC_SET_CONTROL_LINE_STATE
 		#ifdef CDC_STATUS_INTERFACE
@@ -609,6 +879,22 @@ static void endpoint0_setup(uint64_t setupdata)
 		}
 		break;
 #endif
+#if defined(KEYBOARD_INTERFACE)
+	  case 0x0B21: // HID SET_PROTOCOL
+		if (setup.wIndex == KEYBOARD_INTERFACE) {
+			keyboard_protocol = setup.wValue;
+			endpoint0_receive(NULL, 0, 0);
+			return;
+		}
+		break;
+	  case 0x03A1: // HID GET_PROTOCOL
+		if (setup.wIndex == KEYBOARD_INTERFACE) {
+			endpoint0_buffer[0] = keyboard_protocol;
+			endpoint0_transmit(endpoint0_buffer, 1, 0);
+			return;
+		}
+		break;
+#endif
 #if defined(AUDIO_INTERFACE)
 	  case 0x0B01: // SET_INTERFACE (alternate setting)
 		if (setup.wIndex == AUDIO_INTERFACE+1) {
@@ -816,6 +1102,13 @@ static void endpoint0_complete(void)
 		}
 	}
 #endif
+#ifdef NCM_STATUS_INTERFACE
+	if (setup.wRequestAndType == 0x8621 && setup.wIndex == NCM_STATUS_INTERFACE) {
+		uint32_t size;
+		memcpy(&size, endpoint0_buffer, 4);
+		usb_ncm_set_ntb_input_size(size);
+	}
+#endif
 #ifdef KEYBOARD_INTERFACE
 	if (setup.word1 == 0x02000921 && setup.word2 == ((1 << 16) | KEYBOARD_INTERFACE)) {
 		keyboard_leds = endpoint0_buffer[0];
@@ -874,6 +1167,16 @@ void usb_config_tx(uint32_t ep, uint32_t packet_size, int do_zlp, void (*cb)(tra
 	if (ep < 2 || ep > NUM_ENDPOINTS) return;
 	usb_endpoint_config(endpoint_queue_head + ep * 2 + 1, config, cb);
 	if (cb) endpointN_notify_mask |= (1 << (ep + 16));
+	endpointN_ioc_on_request &= ~(1 << (ep + 16));
+}
+
+// After usb_config_tx(), the callback normally runs for every transfer.
+// With this, only transfers whose status has USB_TRANSFER_IOC set before
+// usb_transmit() interrupt and run the callback.
+void usb_config_tx_ioc_on_request(uint32_t ep)
+{
+	if (ep < 2 || ep > NUM_ENDPOINTS) return;
+	endpointN_ioc_on_request |= (1 << (ep + 16));
 }
 
 void usb_config_rx_iso(uint32_t ep, uint32_t packet_size, int mult, void (*cb)(transfer_t *))
@@ -892,6 +1195,7 @@ void usb_config_tx_iso(uint32_t ep, uint32_t packet_size, int mult, void (*cb)(t
 	if (ep < 2 || ep > NUM_ENDPOINTS) return;
 	usb_endpoint_config(endpoint_queue_head + ep * 2 + 1, config, cb);
 	if (cb) endpointN_notify_mask |= (1 << (ep + 16));
+	endpointN_ioc_on_request &= ~(1 << (ep + 16));
 }
 
 
@@ -926,16 +1230,59 @@ void usb_print_transfer_log(void)
 }
 #endif
 
+// Prepare a chain of transfers for a large buffer.  Each transfer_t
+// carries up to 16384 bytes (a multiple of every packet size, and always
+// within the 5 page pointers regardless of alignment).  Returns the number
+// of transfers used, or 0 if "num" is not enough for "len" bytes.  Only
+// the last transfer causes a callback, with callback_param = param, except
+// a receive chain which ends with a short packet (see usb_receive_chain).
+// The top bit of param is used by usb_receive_chain, so it must be zero.
+uint32_t usb_prepare_transfer_chain(transfer_t *transfer, uint32_t num, const void *data, uint32_t len, uint32_t param)
+{
+	const uint8_t *p = (const uint8_t *)data;
+	uint32_t count = (len + 16383) >> 14;
+	if (count == 0) count = 1;
+	if (count > num) return 0;
+	for (uint32_t i=0; i < count; i++) {
+		uint32_t n = (len > 16384) ? 16384 : len;
+		usb_prepare_transfer(transfer + i, p, n, param);
+		if (i + 1 < count) transfer[i].next = (uint32_t)(transfer + i + 1);
+		p += n;
+		len -= n;
+	}
+	return count;
+}
+
+static void schedule_transfer_chain(endpoint_t *endpoint, uint32_t epmask, transfer_t *transfer, transfer_t *last_in_chain);
+
 static void schedule_transfer(endpoint_t *endpoint, uint32_t epmask, transfer_t *transfer)
+{
+	schedule_transfer_chain(endpoint, epmask, transfer, transfer);
+}
+
+// add a linked list of transfers to an endpoint's queue.  Only the last
+// transfer of the chain interrupts when complete.
+static void schedule_transfer_chain(endpoint_t *endpoint, uint32_t epmask, transfer_t *transfer, transfer_t *last_in_chain)
 {
 	// when we stop at 6, why is the last transfer missing from the USB output?
 	//if (transfer_log_count >= 6) return;
 
 	//uint32_t ret = (*(const uint8_t *)transfer->pointer0) << 8;
-	if (endpoint->callback_function) {
-		transfer->status |= (1<<15);
+	if (endpoint->callback_function && !(endpointN_ioc_on_request & epmask)) {
+		last_in_chain->status |= USB_TRANSFER_IOC;
 	}
+#ifdef USB_STATS
+	uint32_t bytes = 0;
+	for (transfer_t *t = transfer; ; t = (transfer_t *)t->next) {
+		bytes += (t->status >> 16) & 0x7FFF;
+		if (t == last_in_chain) break;
+	}
+#endif
 	__disable_irq();
+#ifdef USB_STATS
+	stats_for_endpoint(endpoint)->bytes += bytes;
+	if (!endpoint->last_transfer) stats_begin[endpoint - endpoint_queue_head] = ARM_DWT_CYCCNT;
+#endif
 	//digitalWriteFast(1, HIGH);
 	// Executing A Transfer Descriptor, page 2468 (RT1060 manual, Rev 1, 12/2018)
 	transfer_t *last = endpoint->last_transfer;
@@ -963,7 +1310,7 @@ static void schedule_transfer(endpoint_t *endpoint, uint32_t epmask, transfer_t
 	USB1_ENDPTPRIME |= epmask;
 	endpoint->first_transfer = transfer;
 end:
-	endpoint->last_transfer = transfer;
+	endpoint->last_transfer = last_in_chain;
 	__enable_irq();
 	//digitalWriteFast(4, LOW);
 	//digitalWriteFast(3, LOW);
@@ -1040,13 +1387,43 @@ static void run_callbacks(endpoint_t *ep)
 			break;
 		}
 	}
-	// do all the callbacks
+#ifdef USB_STATS
+	usb_endpoint_stats_t *stats = stats_for_endpoint(ep);
+	uint32_t now = ARM_DWT_CYCCNT;
+	if (count) {
+		uint32_t *begin = stats_begin + (ep - endpoint_queue_head);
+		stats_latency(stats, now - *begin);
+		*begin = now;  // next transfer is now at the head of the queue
+		t = first;
+		for (uint32_t n=0; n < count; n++) {
+			uint32_t status = t->status;
+			stats->transfers++;
+			stats->bytes -= (status >> 16) & 0x7FFF; // unused length
+			if (status & 0x68) stats->errors++;
+			t = (transfer_t *)t->next;
+		}
+	}
+#endif
+	// do all the callbacks, except middle of chains which don't interrupt,
+	// or in a receive chain only interrupt to report a short packet
 	while (count) {
 		transfer_t *next = (transfer_t *)first->next;
-		ep->callback_function(first);
+		uint32_t status = first->status;
+		if (status & USB_TRANSFER_IOC) {
+			uint32_t param = first->callback_param;
+			if (!(param & TRANSFER_CHAIN_MIDDLE)) {
+				ep->callback_function(first);
+			} else if (status & 0x7FFF0068) {
+				first->callback_param = param & ~TRANSFER_CHAIN_MIDDLE;
+				ep->callback_function(first);
+			}
+		}
 		first = next;
 		count--;
 	}
+#ifdef USB_STATS
+	stats->callback_cycles += ARM_DWT_CYCCNT - now;
+#endif
 }
 
 void usb_transmit(int endpoint_number, transfer_t *transfer)
@@ -1065,6 +1442,33 @@ void usb_receive(int endpoint_number, transfer_t *transfer)
 	schedule_transfer(endpoint, mask, transfer);
 }
 
+// queue a chain of transfers made by usb_prepare_transfer_chain()
+void usb_transmit_chain(int endpoint_number, transfer_t *transfer, uint32_t num)
+{
+	if (endpoint_number < 2 || endpoint_number > NUM_ENDPOINTS || num == 0) return;
+	endpoint_t *endpoint = endpoint_queue_head + endpoint_number * 2 + 1;
+	uint32_t mask = 1 << (endpoint_number + 16);
+	schedule_transfer_chain(endpoint, mask, transfer, transfer + num - 1);
+}
+
+// The host may end its data early with a short packet in any transfer of a
+// receive chain.  The controller then goes on to the next transfer, so the
+// middle ones also interrupt, and the callback runs for any which ended
+// short (or with an error), as well as for the last.
+void usb_receive_chain(int endpoint_number, transfer_t *transfer, uint32_t num)
+{
+	if (endpoint_number < 2 || endpoint_number > NUM_ENDPOINTS || num == 0) return;
+	endpoint_t *endpoint = endpoint_queue_head + endpoint_number * 2;
+	uint32_t mask = 1 << endpoint_number;
+	if (endpoint->callback_function) {
+		for (uint32_t i=0; i + 1 < num; i++) {
+			transfer[i].status |= USB_TRANSFER_IOC;
+			transfer[i].callback_param |= TRANSFER_CHAIN_MIDDLE;
+		}
+	}
+	schedule_transfer_chain(endpoint, mask, transfer, transfer + num - 1);
+}
+
 uint32_t usb_transfer_status(const transfer_t *transfer)
 {
 #if defined(USB_MTPDISK) || defined(USB_MTPDISK_SERIAL)
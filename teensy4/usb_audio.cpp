@@ -31,15 +31,21 @@
 #include <Arduino.h>
 #include "usb_dev.h"
 #include "usb_audio.h"
+#include "audio_dsp.h"
 #include "debug/printf.h"
 
 #ifdef AUDIO_INTERFACE
 
+// 12 Mbit/sec isochronous packets are limited to 1023 bytes, so larger
+// formats only work on 480 Mbit/sec ports, unless the host drops samples.
+#ifndef AUDIO_USB_HIGH_SPEED_ONLY
+static_assert(AUDIO_USB_PACKET_SIZE <= 1023, "USB audio format is too large for "
+	"12 Mbit/sec, define AUDIO_USB_HIGH_SPEED_ONLY if only used at 480 Mbit/sec");
+#endif
+
 bool AudioInputUSB::update_responsibility;
-audio_block_t * AudioInputUSB::incoming_left;
-audio_block_t * AudioInputUSB::incoming_right;
-audio_block_t * AudioInputUSB::ready_left;
-audio_block_t * AudioInputUSB::ready_right;
+audio_block_t * AudioInputUSB::incoming[AUDIO_USB_CHANNELS];
+audio_block_t * AudioInputUSB::ready[AUDIO_USB_CHANNELS];
 uint16_t AudioInputUSB::incoming_count;
 uint8_t AudioInputUSB::receive_flag;
 
@@ -52,8 +58,10 @@ static void tx_event(transfer_t *t);
 /*static*/ transfer_t rx_transfer __attribute__ ((used, aligned(32)));
 /*static*/ transfer_t sync_transfer __attribute__ ((used, aligned(32)));
 /*static*/ transfer_t tx_transfer __attribute__ ((used, aligned(32)));
-DMAMEM static uint8_t rx_buffer[AUDIO_RX_SIZE] __attribute__ ((aligned(32)));
-DMAMEM static uint8_t tx_buffer[AUDIO_RX_SIZE] __attribute__ ((aligned(32)));
+// whole cache rows, so dma_buffer_from_device() can't discard neighboring data
+#define AUDIO_RX_BUFFER_SIZE	((AUDIO_RX_SIZE + 31) & ~31)
+#define AUDIO_TX_BUFFER_SIZE	((AUDIO_TX_SIZE + 31) & ~31)
+DMAMEM static uint8_t rx_buffer[AUDIO_RX_BUFFER_SIZE] __attribute__ ((aligned(32)));
 DMAMEM uint32_t usb_audio_sync_feedback __attribute__ ((aligned(32)));
 
 uint8_t usb_audio_receive_setting=0;
@@ -66,6 +74,23 @@ uint32_t feedback_accumulator;
 volatile uint32_t usb_audio_underrun_count;
 volatile uint32_t usb_audio_overrun_count;
 
+// Asynchronous feedback, USB 2.0 Specification, 5.12.4.2.  The PC sends
+// samples at the rate we report, which must follow the audio library's
+// sample clock as seen from USB.  Every AudioInputUSB::update() consumes
+// one block at the audio clock and is timestamped with the USB frame
+// counter, which advances with each SOF.  Samples per elapsed frame
+// over a long window give the rate, which is low-pass filtered (the
+// PLL's frequency term).  A small correction proportional to the average
+// buffer fill error (the phase term) keeps latency at the target.
+// All rates are samples per millisecond, 8.24 fixed point.
+#define FEEDBACK_WINDOW		(8 * 512)	// microframes per rate measurement
+static uint32_t feedback_nominal;
+static uint32_t feedback_rate;
+static uint32_t feedback_frindex;
+static uint32_t feedback_frames;
+static uint32_t feedback_samples;
+static int32_t feedback_fill;		// average buffered samples, 24.8
+
 
 static void rx_event(transfer_t *t)
 {
@@ -75,7 +100,7 @@ static void rx_event(transfer_t *t)
 		usb_audio_receive_callback(len);
 	}
 	usb_prepare_transfer(&rx_transfer, rx_buffer, AUDIO_RX_SIZE, 0);
-	arm_dcache_delete(&rx_buffer, AUDIO_RX_SIZE);
+	dma_buffer_from_device(&rx_buffer, AUDIO_RX_SIZE);
 	usb_receive(AUDIO_RX_ENDPOINT, &rx_transfer);
 }
 
@@ -85,7 +110,7 @@ static void sync_event(transfer_t *t)
 	//printf("sync %x\n", sync_transfer.status); // too slow, can't print this much
 	usb_audio_sync_feedback = feedback_accumulator >> usb_audio_sync_rshift;
 	usb_prepare_transfer(&sync_transfer, &usb_audio_sync_feedback, usb_audio_sync_nbytes, 0);
-	arm_dcache_flush(&usb_audio_sync_feedback, usb_audio_sync_nbytes);
+	dma_buffer_to_device(&usb_audio_sync_feedback, usb_audio_sync_nbytes);
 	usb_transmit(AUDIO_SYNC_ENDPOINT, &sync_transfer);
 }
 
@@ -94,7 +119,12 @@ void usb_audio_configure(void)
 	printf("usb_audio_configure\n");
 	usb_audio_underrun_count = 0;
 	usb_audio_overrun_count = 0;
-	feedback_accumulator = 739875226; // 44.1 * 2^24
+	feedback_nominal = (uint32_t)(AUDIO_USB_SAMPLE_RATE * 16777.216 + 0.5); // kHz * 2^24
+	feedback_accumulator = feedback_nominal;
+	feedback_rate = feedback_nominal;
+	feedback_frames = 0;
+	feedback_samples = 0;
+	feedback_fill = (AudioStream::block_samples/2) << 8;
 	if (usb_high_speed) {
 		usb_audio_sync_nbytes = 4;
 		usb_audio_sync_rshift = 8;
@@ -102,24 +132,26 @@ void usb_audio_configure(void)
 		usb_audio_sync_nbytes = 3;
 		usb_audio_sync_rshift = 10;
 	}
+	uint32_t packet_size = usb_high_speed ? AUDIO_USB_PACKET_480 : AUDIO_USB_PACKET_12;
+	int mult = usb_high_speed ? AUDIO_USB_PACKET_MULT : 1;
 	memset(&rx_transfer, 0, sizeof(rx_transfer));
-	usb_config_rx_iso(AUDIO_RX_ENDPOINT, AUDIO_RX_SIZE, 1, rx_event);
+	usb_config_rx_iso(AUDIO_RX_ENDPOINT, packet_size, mult, rx_event);
 	rx_event(NULL);
 	memset(&sync_transfer, 0, sizeof(sync_transfer));
 	usb_config_tx_iso(AUDIO_SYNC_ENDPOINT, usb_audio_sync_nbytes, 1, sync_event);
 	sync_event(NULL);
 	memset(&tx_transfer, 0, sizeof(tx_transfer));
-	usb_config_tx_iso(AUDIO_TX_ENDPOINT, AUDIO_TX_SIZE, 1, tx_event);
+	usb_config_tx_iso(AUDIO_TX_ENDPOINT, packet_size, mult, tx_event);
 	tx_event(NULL);
 }
 
 void AudioInputUSB::begin(void)
 {
 	incoming_count = 0;
-	incoming_left = NULL;
-	incoming_right = NULL;
-	ready_left = NULL;
-	ready_right = NULL;
+	for (int i=0; i < AUDIO_USB_CHANNELS; i++) {
+		incoming[i] = NULL;
+		ready[i] = NULL;
+	}
 	receive_flag = 0;
 	// update_responsibility = update_setup();
 	// TODO: update responsibility is tough, partly because the USB
@@ -129,29 +161,76 @@ void AudioInputUSB::begin(void)
 	update_responsibility = false;
 }
 
-static void copy_to_buffers(const uint32_t *src, int16_t *left, int16_t *right, unsigned int len)
+// Copy "len" sample frames between USB packet data and audio blocks,
+// starting at "offset" within the blocks.
+static void deinterleave_from_usb(const uint8_t *src, int16_t * const *dst, unsigned int len)
 {
-	uint32_t *target = (uint32_t*) src + len; 
-	while ((src < target) && (((uintptr_t) left & 0x02) != 0)) {
-		uint32_t n = *src++;
-		*left++ = n & 0xFFFF;
-		*right++ = n >> 16;
-	}
+#if AUDIO_USB_CHANNELS == 2 && AUDIO_USB_RESOLUTION == 16
+	audio_block_deinterleave((const uint32_t *)src, dst[0], dst[1], len);
+#elif AUDIO_USB_RESOLUTION == 24
+	audio_block_deinterleave24(src, dst, AUDIO_USB_CHANNELS, len);
+#else
+	audio_block_deinterleave16((const int16_t *)src, dst, AUDIO_USB_CHANNELS, len);
+#endif
+}
 
-	while ((src < target - 2)) {
-		uint32_t n1 = *src++;
-		uint32_t n = *src++;
-		*(uint32_t *)left = (n1 & 0xFFFF) | ((n & 0xFFFF) << 16);
-		left+=2;
-		*(uint32_t *)right = (n1 >> 16) | ((n & 0xFFFF0000)) ;
-		right+=2;
-	}
+static void copy_from_usb(const uint8_t *src, audio_block_t * const *blocks,
+	unsigned int offset, unsigned int len)
+{
+	int16_t *dst[AUDIO_USB_CHANNELS];
+	for (int i=0; i < AUDIO_USB_CHANNELS; i++) dst[i] = blocks[i]->data + offset;
+	deinterleave_from_usb(src, dst, len);
+}
 
-	while ((src < target)) {
-		uint32_t n = *src++;
-		*left++ = n & 0xFFFF;
-		*right++ = n >> 16;
+static void copy_to_usb(uint8_t *dst, audio_block_t * const *blocks,
+	unsigned int offset, unsigned int len)
+{
+#if AUDIO_USB_CHANNELS == 2 && AUDIO_USB_RESOLUTION == 16
+	audio_block_interleave((uint32_t *)dst, blocks[0]->data + offset,
+		blocks[1]->data + offset, len);
+#else
+	const int16_t *src[AUDIO_USB_CHANNELS];
+	for (int i=0; i < AUDIO_USB_CHANNELS; i++) src[i] = blocks[i]->data + offset;
+#if AUDIO_USB_RESOLUTION == 24
+	audio_block_interleave24(dst, src, AUDIO_USB_CHANNELS, len);
+#else
+	audio_block_interleave16((int16_t *)dst, src, AUDIO_USB_CHANNELS, len);
+#endif
+#endif
+}
+
+uint32_t AudioInputUSB::underruns(void)
+{
+	return usb_audio_underrun_count;
+}
+
+uint32_t AudioInputUSB::overruns(void)
+{
+	return usb_audio_overrun_count;
+}
+
+void AudioInputUSB::clearCounters(void)
+{
+	__disable_irq();
+	usb_audio_underrun_count = 0;
+	usb_audio_overrun_count = 0;
+	__enable_irq();
+}
+
+float AudioInputUSB::feedbackRate(void)
+{
+	return (float)feedback_accumulator * (1000.0f / 16777216.0f);
+}
+
+bool AudioInputUSB::allocate_incoming(void)
+{
+	for (int i=0; i < AUDIO_USB_CHANNELS; i++) {
+		if (incoming[i] == NULL) {
+			incoming[i] = allocate();
+			if (incoming[i] == NULL) return false;
+		}
 	}
+	return true;
 }
 
 // Called from the USB interrupt when an isochronous packet arrives
@@ -161,37 +240,29 @@ static void copy_to_buffers(const uint32_t *src, int16_t *left, int16_t *right,
 void usb_audio_receive_callback(unsigned int len)
 {
 	unsigned int count, avail;
-	audio_block_t *left, *right;
-	const uint32_t *data;
+	const uint8_t *data;
 
+	if (AudioInputUSBAsync::active) {
+		AudioInputUSBAsync::receive(rx_buffer, len / AUDIO_USB_FRAME_SIZE);
+		return;
+	}
 	AudioInputUSB::receive_flag = 1;
-	len >>= 2; // 1 sample = 4 bytes: 2 left, 2 right
-	data = (const uint32_t *)rx_buffer;
+	len /= AUDIO_USB_FRAME_SIZE; // 1 sample frame = all channels
+	data = rx_buffer;
 
 	count = AudioInputUSB::incoming_count;
-	left = AudioInputUSB::incoming_left;
-	right = AudioInputUSB::incoming_right;
-	if (left == NULL) {
-		left = AudioStream::allocate();
-		if (left == NULL) return;
-		AudioInputUSB::incoming_left = left;
-	}
-	if (right == NULL) {
-		right = AudioStream::allocate();
-		if (right == NULL) return;
-		AudioInputUSB::incoming_right = right;
-	}
+	if (!AudioInputUSB::allocate_incoming()) return;
 	while (len > 0) {
-		avail = AUDIO_BLOCK_SAMPLES - count;
+		avail = (count < AudioStream::block_samples) ? AudioStream::block_samples - count : 0;
 		if (len < avail) {
-			copy_to_buffers(data, left->data + count, right->data + count, len);
+			copy_from_usb(data, AudioInputUSB::incoming, count, len);
 			AudioInputUSB::incoming_count = count + len;
 			return;
 		} else if (avail > 0) {
-			copy_to_buffers(data, left->data + count, right->data + count, avail);
-			data += avail;
+			copy_from_usb(data, AudioInputUSB::incoming, count, avail);
+			data += avail * AUDIO_USB_FRAME_SIZE;
 			len -= avail;
-			if (AudioInputUSB::ready_left || AudioInputUSB::ready_right) {
+			if (AudioInputUSB::ready[0]) {
 				// buffer overrun, PC sending too fast
 				AudioInputUSB::incoming_count = count + avail;
 				if (len > 0) {
@@ -202,29 +273,18 @@ void usb_audio_receive_callback(unsigned int len)
 				return;
 			}
 			send:
-			AudioInputUSB::ready_left = left;
-			AudioInputUSB::ready_right = right;
-			//if (AudioInputUSB::update_responsibility) AudioStream::update_all();
-			left = AudioStream::allocate();
-			if (left == NULL) {
-				AudioInputUSB::incoming_left = NULL;
-				AudioInputUSB::incoming_right = NULL;
-				AudioInputUSB::incoming_count = 0;
-				return;
+			for (int i=0; i < AUDIO_USB_CHANNELS; i++) {
+				AudioInputUSB::ready[i] = AudioInputUSB::incoming[i];
+				AudioInputUSB::incoming[i] = NULL;
 			}
-			right = AudioStream::allocate();
-			if (right == NULL) {
-				AudioStream::release(left);
-				AudioInputUSB::incoming_left = NULL;
-				AudioInputUSB::incoming_right = NULL;
+			//if (AudioInputUSB::update_responsibility) AudioStream::update_all();
+			if (!AudioInputUSB::allocate_incoming()) {
 				AudioInputUSB::incoming_count = 0;
 				return;
 			}
-			AudioInputUSB::incoming_left = left;
-			AudioInputUSB::incoming_right = right;
 			count = 0;
 		} else {
-			if (AudioInputUSB::ready_left || AudioInputUSB::ready_right) return;
+			if (AudioInputUSB::ready[0]) return;
 			goto send; // recover from buffer overrun
 		}
 	}
@@ -234,40 +294,201 @@ void usb_audio_receive_callback(unsigned int len)
 
 void AudioInputUSB::update(void)
 {
-	audio_block_t *left, *right;
+	audio_block_t *blocks[AUDIO_USB_CHANNELS];
+	bool complete = true;
 
 	__disable_irq();
-	left = ready_left;
-	ready_left = NULL;
-	right = ready_right;
-	ready_right = NULL;
+	for (int i=0; i < AUDIO_USB_CHANNELS; i++) {
+		blocks[i] = ready[i];
+		ready[i] = NULL;
+	}
 	uint16_t c = incoming_count;
 	uint8_t f = receive_flag;
 	receive_flag = 0;
 	__enable_irq();
+	// USB1_FRINDEX counts microframes, or frames * 8 at 12 Mbit/sec
+	uint32_t frindex = USB1_FRINDEX;
 	if (f) {
-		int diff = AUDIO_BLOCK_SAMPLES/2 - (int)c;
-		feedback_accumulator += diff * 1;
-		//uint32_t feedback = (feedback_accumulator >> 8) + diff * 100;
-		//usb_audio_sync_feedback = feedback;
-
-		//printf(diff >= 0 ? "." : "^");
+		feedback_frames += (frindex - feedback_frindex) & 0x3FFF;
+		feedback_samples += AudioStream::block_samples;
+		if (feedback_frames >= FEEDBACK_WINDOW) {
+			uint32_t rate = ((uint64_t)feedback_samples << 27) / feedback_frames;
+			// ignore windows disturbed by stalls, more than 1.5% off nominal
+			if (rate > feedback_nominal - (feedback_nominal >> 6)
+			  && rate < feedback_nominal + (feedback_nominal >> 6)) {
+				feedback_rate += ((int32_t)(rate - feedback_rate)) >> 2;
+			}
+			feedback_frames = 0;
+			feedback_samples = 0;
+		}
+		feedback_fill += (((int32_t)c << 8) - feedback_fill) >> 4;
+		int32_t error = ((AudioStream::block_samples/2) << 8) - feedback_fill;
+		// correct 1 sample of error in about 1 second
+		feedback_accumulator = feedback_rate + (error << 6);
+	} else {
+		feedback_frames = 0;
+		feedback_samples = 0;
 	}
+	feedback_frindex = frindex;
 	//serial_phex(c);
 	//serial_print(".");
-	if (!left || !right) {
+	for (int i=0; i < AUDIO_USB_CHANNELS; i++) {
+		if (blocks[i]) {
+			transmit(blocks[i], i);
+			release(blocks[i]);
+		} else {
+			complete = false;
+		}
+	}
+	if (!complete) {
 		usb_audio_underrun_count++;
 		//printf("#"); // buffer underrun - PC sending too slow
-		if (f) feedback_accumulator += 3500;
 	}
-	if (left) {
-		transmit(left, 0);
-		release(left);
+}
+
+
+// AudioInputUSBAsync keeps the PC's samples in a fifo, with every sample
+// stored twice, AUDIO_USB_ASRC_FIFO apart, so the resampling filter
+// always reads contiguous memory.  The feedback endpoint stays at the
+// nominal rate, so the PC sends exactly AUDIO_USB_SAMPLE_RATE as seen
+// from USB.  Like the feedback calculation, each update is timestamped
+// by the SOF frame counter, which gives the USB samples per audio
+// library sample without the jitter of counting arriving packets.  A
+// small correction from the average fifo fill error holds latency at
+// the target.
+bool AudioInputUSBAsync::active = false;
+bool AudioInputUSBAsync::running;
+volatile uint8_t AudioInputUSBAsync::receive_flag;
+int16_t AudioInputUSBAsync::fifo[AUDIO_USB_CHANNELS][AUDIO_USB_ASRC_FIFO * 2] __attribute__ ((aligned(4)));
+volatile uint32_t AudioInputUSBAsync::head;
+uint32_t AudioInputUSBAsync::tail;
+uint32_t AudioInputUSBAsync::position;
+uint32_t AudioInputUSBAsync::step;
+float AudioInputUSBAsync::rate;
+float AudioInputUSBAsync::fill;
+uint32_t AudioInputUSBAsync::frindex;
+uint32_t AudioInputUSBAsync::frames;
+uint32_t AudioInputUSBAsync::samples;
+volatile uint32_t AudioInputUSBAsync::underrun_count;
+volatile uint32_t AudioInputUSBAsync::overrun_count;
+
+#define ASRC_NOMINAL	((float)AUDIO_USB_SAMPLE_RATE / (float)AUDIO_SAMPLE_RATE_EXACT)
+#define ASRC_PACKET	(AUDIO_USB_SAMPLE_RATE / 1000 + 1)
+
+void AudioInputUSBAsync::begin(void)
+{
+	audio_asrc_init();
+	running = false;
+	receive_flag = 0;
+	head = 0;
+	tail = 0;
+	step = ASRC_NOMINAL * 1073741824.0f;
+	active = true;
+}
+
+// Called from usb_audio_receive_callback(), in the USB interrupt
+void AudioInputUSBAsync::receive(const uint8_t *data, unsigned int len)
+{
+	uint32_t h = head;
+
+	receive_flag = 1;
+	if (h + len - tail > AUDIO_USB_ASRC_FIFO) {
+		overrun_count++;
+		return;
 	}
-	if (right) {
-		transmit(right, 1);
-		release(right);
+	while (len > 0) {
+		uint32_t i = h & (AUDIO_USB_ASRC_FIFO - 1);
+		unsigned int n = AUDIO_USB_ASRC_FIFO - i;
+		if (n > len) n = len;
+		int16_t *dst[AUDIO_USB_CHANNELS];
+		for (int c=0; c < AUDIO_USB_CHANNELS; c++) dst[c] = fifo[c] + i;
+		deinterleave_from_usb(data, dst, n);
+		for (int c=0; c < AUDIO_USB_CHANNELS; c++) {
+			memcpy(fifo[c] + i + AUDIO_USB_ASRC_FIFO, fifo[c] + i, n * 2);
+		}
+		data += n * AUDIO_USB_FRAME_SIZE;
+		len -= n;
+		h += n;
 	}
+	head = h;
+}
+
+void AudioInputUSBAsync::update(void)
+{
+	audio_block_t *blocks[AUDIO_USB_CHANNELS];
+	const uint32_t target = AudioStream::block_samples * ASRC_NOMINAL
+		+ AUDIO_ASRC_TAPS + ASRC_PACKET * 2;
+	const float ratio_now = step * (1.0f / 1073741824.0f);
+	uint32_t need = AudioStream::block_samples * ratio_now + AUDIO_ASRC_TAPS + 1;
+
+	uint32_t h = head;
+	uint8_t f = receive_flag;
+	receive_flag = 0;
+	// USB1_FRINDEX counts microframes, or frames * 8 at 12 Mbit/sec
+	uint32_t now = USB1_FRINDEX;
+	uint32_t avail = h - tail;
+	if (!running) {
+		// wait for the fifo to fill to the target, then start
+		if (avail < target) return;
+		tail = h - target;
+		avail = target;
+		position = 0;
+		rate = ASRC_NOMINAL;
+		fill = target;
+		frames = 0;
+		samples = 0;
+		running = true;
+	} else if (avail < need) {
+		// PC stopped sending, or drift beyond what the fifo can absorb
+		underrun_count++;
+		running = false;
+		return;
+	} else if (avail > AUDIO_USB_ASRC_FIFO - ASRC_PACKET) {
+		overrun_count++;
+		tail = h - target;
+		avail = target;
+	} else if (f) {
+		frames += (now - frindex) & 0x3FFF;
+		samples += AudioStream::block_samples;
+		if (frames >= FEEDBACK_WINDOW) {
+			float r = (float)frames * ((float)AUDIO_USB_SAMPLE_RATE / 8000.0f) / (float)samples;
+			// ignore windows disturbed by stalls, more than 1.5% off nominal
+			if (r > ASRC_NOMINAL * 0.985f && r < ASRC_NOMINAL * 1.015f) {
+				rate += (r - rate) * 0.25f;
+			}
+			frames = 0;
+			samples = 0;
+		}
+	} else {
+		frames = 0;
+		samples = 0;
+	}
+	frindex = now;
+	fill += ((float)avail - fill) * (1.0f / 16.0f);
+	float adjust = (fill - (float)target) * (1.0f / 32768.0f);
+	if (adjust > 0.005f) adjust = 0.005f;
+	else if (adjust < -0.005f) adjust = -0.005f;
+	step = rate * (1.0f + adjust) * 1073741824.0f;
+
+	for (int c=0; c < AUDIO_USB_CHANNELS; c++) {
+		blocks[c] = allocate();
+		if (!blocks[c]) {
+			while (--c >= 0) release(blocks[c]);
+			return;
+		}
+	}
+	const uint32_t start = tail & (AUDIO_USB_ASRC_FIFO - 1);
+	uint32_t pos = position;
+	unsigned int consumed = 0;
+	for (int c=0; c < AUDIO_USB_CHANNELS; c++) {
+		pos = position;
+		consumed = audio_asrc_resample(blocks[c]->data, fifo[c] + start,
+			AudioStream::block_samples, &pos, step);
+		transmit(blocks[c], c);
+		release(blocks[c]);
+	}
+	position = pos;
+	tail += consumed;
 }
 
 
@@ -288,13 +509,14 @@ void AudioInputUSB::update(void)
 
 #if 1
 bool AudioOutputUSB::update_responsibility;
-audio_block_t * AudioOutputUSB::left_1st;
-audio_block_t * AudioOutputUSB::left_2nd;
-audio_block_t * AudioOutputUSB::right_1st;
-audio_block_t * AudioOutputUSB::right_2nd;
+audio_block_t * AudioOutputUSB::queue[AUDIO_OUTPUT_USB_QUEUE][AUDIO_USB_CHANNELS];
+uint8_t AudioOutputUSB::queue_first;
+uint8_t AudioOutputUSB::queue_count;
 uint16_t AudioOutputUSB::offset_1st;
+uint16_t AudioOutputUSB::latency;
+int32_t AudioOutputUSB::depth_average;
 
-/*DMAMEM*/ uint16_t usb_audio_transmit_buffer[AUDIO_TX_SIZE/2] __attribute__ ((used, aligned(32)));
+/*DMAMEM*/ uint16_t usb_audio_transmit_buffer[AUDIO_TX_BUFFER_SIZE/2] __attribute__ ((used, aligned(32)));
 
 
 static void tx_event(transfer_t *t)
@@ -302,83 +524,92 @@ static void tx_event(transfer_t *t)
 	int len = usb_audio_transmit_callback();
 	usb_audio_sync_feedback = feedback_accumulator >> usb_audio_sync_rshift;
 	usb_prepare_transfer(&tx_transfer, usb_audio_transmit_buffer, len, 0);
-	arm_dcache_flush_delete(usb_audio_transmit_buffer, len);
+	dma_buffer_to_device(usb_audio_transmit_buffer, len);
 	usb_transmit(AUDIO_TX_ENDPOINT, &tx_transfer);
 }
 
 
+// Average number of samples buffered when each packet is sent.  Lower is
+// less delay to the PC, but leaves less margin for late audio updates.
+// Buffered samples rise and fall by a whole block as blocks arrive, so the
+// average must stay at least half a block plus one packet away from empty
+// and from a full queue.  Smaller blocks allow lower latency.
+#define LATENCY_MIN	(AudioStream::block_samples / 2 + AUDIO_USB_SAMPLE_RATE / 1000 + 8)
+#define LATENCY_MAX	(AUDIO_OUTPUT_USB_QUEUE * AudioStream::block_samples - LATENCY_MIN - 1)
+
 void AudioOutputUSB::begin(void)
 {
 	update_responsibility = false;
-	left_1st = NULL;
-	right_1st = NULL;
+	queue_first = 0;
+	queue_count = 0;
+	offset_1st = 0;
+	latency = (AudioStream::block_samples > LATENCY_MIN) ? AudioStream::block_samples : LATENCY_MIN;
+	depth_average = latency << 8;
 }
 
-static void copy_from_buffers(uint32_t *dst, int16_t *left, int16_t *right, unsigned int len)
+void AudioOutputUSB::setLatency(unsigned int samples)
 {
-	// TODO: optimize...
-	while (len > 0) {
-		*dst++ = (*right++ << 16) | (*left++ & 0xFFFF);
-		len--;
+	if (samples < LATENCY_MIN) samples = LATENCY_MIN;
+	if (samples > LATENCY_MAX) samples = LATENCY_MAX;
+	__disable_irq();
+	latency = samples;
+	__enable_irq();
+}
+
+void AudioOutputUSB::release_blocks(audio_block_t **blocks)
+{
+	for (int i=0; i < AUDIO_USB_CHANNELS; i++) {
+		if (blocks[i]) {
+			AudioStream::release(blocks[i]);
+			blocks[i] = NULL;
+		}
 	}
 }
 
 void AudioOutputUSB::update(void)
 {
-	audio_block_t *left, *right;
+	audio_block_t *blocks[AUDIO_USB_CHANNELS];
 
 	// TODO: we shouldn't be writing to these......
-	//left = receiveReadOnly(0); // input 0 = left channel
-	//right = receiveReadOnly(1); // input 1 = right channel
-	left = receiveWritable(0); // input 0 = left channel
-	right = receiveWritable(1); // input 1 = right channel
+	//blocks[i] = receiveReadOnly(i);
+	for (int i=0; i < AUDIO_USB_CHANNELS; i++) {
+		blocks[i] = receiveWritable(i); // input 0 = left channel, 1 = right...
+	}
 	if (usb_audio_transmit_setting == 0) {
-		if (left) release(left);
-		if (right) release(right);
-		if (left_1st) { release(left_1st); left_1st = NULL; }
-		if (left_2nd) { release(left_2nd); left_2nd = NULL; }
-		if (right_1st) { release(right_1st); right_1st = NULL; }
-		if (right_2nd) { release(right_2nd); right_2nd = NULL; }
+		release_blocks(blocks);
+		__disable_irq();
+		while (queue_count > 0) {
+			release_blocks(queue[queue_first]);
+			if (++queue_first >= AUDIO_OUTPUT_USB_QUEUE) queue_first = 0;
+			queue_count--;
+		}
 		offset_1st = 0;
+		__enable_irq();
 		return;
 	}
-	if (left == NULL) {
-		left = allocate();
-		if (left == NULL) {
-			if (right) release(right);
-			return;
-		}
-		memset(left->data, 0, sizeof(left->data));
-	}
-	if (right == NULL) {
-		right = allocate();
-		if (right == NULL) {
-			release(left);
-			return;
+	for (int i=0; i < AUDIO_USB_CHANNELS; i++) {
+		if (blocks[i] == NULL) {
+			blocks[i] = allocate();
+			if (blocks[i] == NULL) {
+				release_blocks(blocks);
+				return;
+			}
+			memset(blocks[i]->data, 0, sizeof(blocks[i]->data));
 		}
-		memset(right->data, 0, sizeof(right->data));
 	}
 	__disable_irq();
-	if (left_1st == NULL) {
-		left_1st = left;
-		right_1st = right;
-		offset_1st = 0;
-	} else if (left_2nd == NULL) {
-		left_2nd = left;
-		right_2nd = right;
-	} else {
+	if (queue_count >= AUDIO_OUTPUT_USB_QUEUE) {
 		// buffer overrun - PC is consuming too slowly
-		audio_block_t *discard1 = left_1st;
-		left_1st = left_2nd;
-		left_2nd = left;
-		audio_block_t *discard2 = right_1st;
-		right_1st = right_2nd;
-		right_2nd = right;
+		release_blocks(queue[queue_first]);
+		if (++queue_first >= AUDIO_OUTPUT_USB_QUEUE) queue_first = 0;
+		queue_count--;
 		offset_1st = 0; // TODO: discard part of this data?
 		//serial_print("*");
-		release(discard1);
-		release(discard2);
 	}
+	unsigned int n = queue_first + queue_count;
+	if (n >= AUDIO_OUTPUT_USB_QUEUE) n -= AUDIO_OUTPUT_USB_QUEUE;
+	for (int i=0; i < AUDIO_USB_CHANNELS; i++) queue[n][i] = blocks[i];
+	queue_count++;
 	__enable_irq();
 }
 
@@ -389,48 +620,64 @@ void AudioOutputUSB::update(void)
 // no data to transmit
 unsigned int usb_audio_transmit_callback(void)
 {
-	static uint32_t count=5;
+	static uint32_t remainder = 500;
 	uint32_t avail, num, target, offset, len=0;
-	audio_block_t *left, *right;
+	uint8_t *dst = (uint8_t *)usb_audio_transmit_buffer;
 
-	if (++count < 10) {   // TODO: dynamic adjust to match USB rate
-		target = 44;
-	} else {
-		count = 0;
-		target = 45;
+	target = AUDIO_USB_SAMPLE_RATE / 1000;
+	remainder += AUDIO_USB_SAMPLE_RATE % 1000;
+	if (remainder >= 1000) {
+		remainder -= 1000;
+		target++; // eg, 44.1 kHz sends 44 nine times, then 45
+	}
+	// The PC accepts any packet size, so the packets follow the audio
+	// library's clock (implicit feedback) by holding the average number
+	// of buffered samples near the latency setting.  The average smooths
+	// the sawtooth of whole blocks arriving.
+	uint32_t count = AudioOutputUSB::queue_count;
+	int32_t depth = 0;
+	if (count > 0) depth = count * AudioStream::block_samples - AudioOutputUSB::offset_1st;
+	int32_t avg = AudioOutputUSB::depth_average;
+	avg += ((depth << 8) - avg) >> 5;
+	AudioOutputUSB::depth_average = avg;
+	int32_t error = avg - ((int32_t)AudioOutputUSB::latency << 8);
+	if (error > (4 << 8) && target <= AUDIO_USB_SAMPLE_RATE / 1000) {
+		target++;
+	} else if (error < -(4 << 8)) {
+		target--;
 	}
 	while (len < target) {
 		num = target - len;
-		left = AudioOutputUSB::left_1st;
-		if (left == NULL) {
+		if (AudioOutputUSB::queue_count == 0) {
 			// buffer underrun - PC is consuming too quickly
-			memset(usb_audio_transmit_buffer + len, 0, num * 4);
+			memset(dst + len * AUDIO_USB_FRAME_SIZE, 0, num * AUDIO_USB_FRAME_SIZE);
 			//serial_print("%");
 			break;
 		}
-		right = AudioOutputUSB::right_1st;
+		audio_block_t **blocks = AudioOutputUSB::queue[AudioOutputUSB::queue_first];
 		offset = AudioOutputUSB::offset_1st;
 
-		avail = AUDIO_BLOCK_SAMPLES - offset;
+		avail = AudioStream::block_samples - offset;
 		if (num > avail) num = avail;
 
-		copy_from_buffers((uint32_t *)usb_audio_transmit_buffer + len,
-			left->data + offset, right->data + offset, num);
+		copy_to_usb(dst + len * AUDIO_USB_FRAME_SIZE, blocks, offset, num);
 		len += num;
 		offset += num;
-		if (offset >= AUDIO_BLOCK_SAMPLES) {
-			AudioStream::release(left);
-			AudioStream::release(right);
-			AudioOutputUSB::left_1st = AudioOutputUSB::left_2nd;
-			AudioOutputUSB::left_2nd = NULL;
-			AudioOutputUSB::right_1st = AudioOutputUSB::right_2nd;
-			AudioOutputUSB::right_2nd = NULL;
+		if (offset >= AudioStream::block_samples) {
+			for (int i=0; i < AUDIO_USB_CHANNELS; i++) {
+				AudioStream::release(blocks[i]);
+				blocks[i] = NULL;
+			}
+			if (++AudioOutputUSB::queue_first >= AUDIO_OUTPUT_USB_QUEUE) {
+				AudioOutputUSB::queue_first = 0;
+			}
+			AudioOutputUSB::queue_count--;
 			AudioOutputUSB::offset_1st = 0;
 		} else {
 			AudioOutputUSB::offset_1st = offset;
 		}
 	}
-	return target * 4;
+	return target * AUDIO_USB_FRAME_SIZE;
 }
 #endif
 
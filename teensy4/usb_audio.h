@@ -62,6 +62,11 @@ struct usb_audio_features_struct {
 #ifdef __cplusplus
 #include "AudioStream.h"
 
+// Blocks queued for transmit to the PC.  Enough for 2 packets plus 2
+// blocks, so the smallest block size chosen at startup works.
+#define AUDIO_OUTPUT_USB_QUEUE	((2 * (AUDIO_USB_SAMPLE_RATE / 1000 + 1) + AUDIO_BLOCK_SAMPLES_MIN - 1) \
+				  / AUDIO_BLOCK_SAMPLES_MIN + 2)
+
 class AudioInputUSB : public AudioStream
 {
 public:
@@ -76,31 +81,91 @@ public:
 		if (features.mute) return 0.0;
 		return (float)(features.volume) * (1.0 / (float)FEATURE_MAX_VOLUME);
 	}
+	// blocks the PC failed to deliver in time, or sent too early
+	static uint32_t underruns(void);
+	static uint32_t overruns(void);
+	static void clearCounters(void);
+	// sample rate currently requested from the PC, in Hz
+	static float feedbackRate(void);
 private:
 	static bool update_responsibility;
-	static audio_block_t *incoming_left;
-	static audio_block_t *incoming_right;
-	static audio_block_t *ready_left;
-	static audio_block_t *ready_right;
+	static audio_block_t *incoming[AUDIO_USB_CHANNELS];
+	static audio_block_t *ready[AUDIO_USB_CHANNELS];
 	static uint16_t incoming_count;
 	static uint8_t receive_flag;
+	static bool allocate_incoming(void);
+};
+
+// Samples buffered by AudioInputUSBAsync, per channel.  Must be a power
+// of 2 with room for 2 packets, 1 block and the resampling filter.
+#ifndef AUDIO_USB_ASRC_FIFO
+#if AUDIO_USB_SAMPLE_RATE > 96000
+#define AUDIO_USB_ASRC_FIFO	1024
+#else
+#define AUDIO_USB_ASRC_FIFO	512
+#endif
+#endif
+
+// Like AudioInputUSB, but the PC's sample clock runs free and a resampler
+// converts to the audio library's clock, which also allows different
+// USB and audio library sample rates.  Use for hosts which ignore the
+// feedback endpoint, or when the audio library's clock is set by other
+// hardware.  Only one of AudioInputUSB or AudioInputUSBAsync may be used.
+class AudioInputUSBAsync : public AudioStream
+{
+public:
+	AudioInputUSBAsync(void) : AudioStream(0, NULL) { begin(); }
+	virtual void update(void);
+	void begin(void);
+	friend void usb_audio_receive_callback(unsigned int len);
+	float volume(void) {
+		if (AudioInputUSB::features.mute) return 0.0;
+		return (float)(AudioInputUSB::features.volume) * (1.0 / (float)FEATURE_MAX_VOLUME);
+	}
+	static uint32_t underruns(void) { return underrun_count; }
+	static uint32_t overruns(void) { return overrun_count; }
+	static void clearCounters(void) { underrun_count = 0; overrun_count = 0; }
+	// USB samples consumed per audio library sample, nominally
+	// AUDIO_USB_SAMPLE_RATE / AUDIO_SAMPLE_RATE_EXACT
+	static float ratio(void) { return step * (1.0f / 1073741824.0f); }
+private:
+	static void receive(const uint8_t *data, unsigned int len);
+	static bool active;
+	static bool running;
+	static volatile uint8_t receive_flag;
+	static int16_t fifo[AUDIO_USB_CHANNELS][AUDIO_USB_ASRC_FIFO * 2];
+	static volatile uint32_t head;
+	static uint32_t tail;
+	static uint32_t position;
+	static uint32_t step;
+	static float rate;
+	static float fill;
+	static uint32_t frindex;
+	static uint32_t frames;
+	static uint32_t samples;
+	static volatile uint32_t underrun_count;
+	static volatile uint32_t overrun_count;
 };
 
 class AudioOutputUSB : public AudioStream
 {
 public:
-	AudioOutputUSB(void) : AudioStream(2, inputQueueArray) { begin(); }
+	AudioOutputUSB(void) : AudioStream(AUDIO_USB_CHANNELS, inputQueueArray) { begin(); }
 	virtual void update(void);
 	void begin(void);
 	friend unsigned int usb_audio_transmit_callback(void);
+	// average samples buffered for the PC, default 1 block
+	static void setLatency(unsigned int samples);
 private:
 	static bool update_responsibility;
-	static audio_block_t *left_1st;
-	static audio_block_t *left_2nd;
-	static audio_block_t *right_1st;
-	static audio_block_t *right_2nd;
+	static audio_block_t *queue[AUDIO_OUTPUT_USB_QUEUE][AUDIO_USB_CHANNELS];
+	static uint8_t queue_first;
+	static uint8_t queue_count;
 	static uint16_t offset_1st;
-	audio_block_t *inputQueueArray[2];
+	static uint16_t latency;
+	static int32_t depth_average;
+	static void release_blocks(audio_block_t **blocks);
+	audio_block_t *inputQueueArray[AUDIO_USB_CHANNELS];
 };
 #endif // __cplusplus
 
@@ -0,0 +1,745 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "usb_dev.h"
+#include "usb_serial.h"
+#include "usb_cdc.h"
+#include "core_pins.h"
+#include <string.h> // for memcpy()
+#include "avr/pgmspace.h" // for PROGMEM, DMAMEM, FASTRUN
+
+#include "debug/printf.h"
+
+#if (defined(CDC_STATUS_INTERFACE) && defined(CDC_DATA_INTERFACE)) \
+  || (defined(CDC2_STATUS_INTERFACE) && defined(CDC2_DATA_INTERFACE)) \
+  || (defined(CDC3_STATUS_INTERFACE) && defined(CDC3_DATA_INTERFACE))
+
+extern volatile uint8_t usb_high_speed;
+extern volatile uint32_t systick_millis_count;
+
+// How long to wait for more data before transmitting a partially filled
+// buffer.  At 12 Mbit/sec packets are only sent once per 1 ms frame, so a
+// longer timeout costs little latency and allows fuller packets.
+#define TRANSMIT_FLUSH_TIMEOUT_480	75   /* in microseconds */
+#define TRANSMIT_FLUSH_TIMEOUT_12	250  /* in microseconds */
+// Range used by USB_SERIAL_FLUSH_ADAPTIVE, when not specified
+#define TRANSMIT_FLUSH_TIMEOUT_MIN	20
+#define TRANSMIT_FLUSH_TIMEOUT_MAX	1000
+
+// When the PC isn't listening, how long do we wait before discarding data?  If this is
+// too short, we risk losing data during the stalls that are common with ordinary desktop
+// software.  If it's too long, we stall the user's program when no software is running.
+#define TX_TIMEOUT_MSEC 120
+
+#define RX_DIRECT_PARAM  0x100  /* callback_param for direct transfers */
+
+static void rx_queue_transfer(usb_cdc_port_t *p, int i);
+static void flush_policy_update(usb_cdc_port_t *p);
+
+static inline uint8_t * rx_buf(usb_cdc_port_t *p, uint32_t i)
+{
+	if (i < USB_CDC_RX_NUM) return p->config->rx_buffer + i * CDC_RX_SIZE_480;
+	return p->rx_extra_buffer + (i - USB_CDC_RX_NUM) * CDC_RX_SIZE_480;
+}
+
+
+/*************************************************************************/
+/**                            Flush Timers                             **/
+/*************************************************************************/
+
+// The USB controller has only 2 timers.  With USB_TRIPLE_SERIAL the third
+// port commandeers Quad Timer #1 channel 3, which isn't used by any PWM
+// pin.  The other 3 channels of Quad Timer #1 are normally used for PWM
+// which doesn't use interrupts, so this is (probably) the safest Quad
+// Timer channel to use for an interrupt.  InputCapture on pins 10-12 also
+// needs the Quad Timer #1 interrupt, so whichever attaches it services
+// both.
+
+static void (*qtimer_callback)(void) = NULL;
+static uint16_t qtimer_compare = 0;
+static uint8_t qtimer_pcs = 12;
+
+extern void input_capture_qtimer1_isr(void) __attribute__((weak));
+
+void usb_cdc_qtimer1_isr(void)
+{
+	if (TMR1_SCTRL3 & TMR_SCTRL_TCF) {
+		TMR1_SCTRL3 = 0;
+		if (qtimer_callback) (*qtimer_callback)();
+	}
+	if (input_capture_qtimer1_isr) input_capture_qtimer1_isr();
+}
+
+static void timer_set_timeout(usb_cdc_port_t *p, uint32_t microseconds)
+{
+	uint64_t ticks;
+	uint32_t pcs;
+
+	// takes effect the next time the timer is started
+	switch (p->config->timer) {
+	case USB_CDC_TIMER_GPT0:
+		USB1_GPTIMER0LD = microseconds - 1;
+		break;
+	case USB_CDC_TIMER_GPT1:
+		USB1_GPTIMER1LD = microseconds - 1;
+		break;
+	default: // quad timer counts the IP bus clock, divided by 1 to 128
+		ticks = (uint64_t)microseconds * F_BUS_ACTUAL / 1000000;
+		pcs = 8;
+		while (ticks > 65535 && pcs < 15) {
+			ticks >>= 1;
+			pcs++;
+		}
+		if (ticks > 65535) ticks = 65535; // about 55 ms at 150 MHz
+		qtimer_compare = ticks;
+		qtimer_pcs = pcs;
+		break;
+	}
+}
+
+static void timer_config(usb_cdc_port_t *p)
+{
+	switch (p->config->timer) {
+	case USB_CDC_TIMER_GPT0:
+		usb_timer0_callback = p->config->flush_callback;
+		USB1_GPTIMER0CTRL = 0;
+		USB1_USBINTR |= USB_USBINTR_TIE0;
+		break;
+	case USB_CDC_TIMER_GPT1:
+		usb_timer1_callback = p->config->flush_callback;
+		USB1_GPTIMER1CTRL = 0;
+		USB1_USBINTR |= USB_USBINTR_TIE1;
+		break;
+	default:
+		qtimer_callback = p->config->flush_callback;
+		quadtimer_module_enable(&IMXRT_TMR1);
+		TMR1_CTRL3 = 0;
+		TMR1_SCTRL3 = 0;
+		attachInterruptVector(IRQ_QTIMER1, usb_cdc_qtimer1_isr);
+		NVIC_ENABLE_IRQ(IRQ_QTIMER1);
+		break;
+	}
+	timer_set_timeout(p, p->flush_timeout);
+}
+
+static void timer_start_oneshot(usb_cdc_port_t *p)
+{
+	// restarts timer if already running (retriggerable one-shot)
+	switch (p->config->timer) {
+	case USB_CDC_TIMER_GPT0:
+		USB1_GPTIMER0CTRL = USB_GPTIMERCTRL_GPTRUN | USB_GPTIMERCTRL_GPTRST;
+		break;
+	case USB_CDC_TIMER_GPT1:
+		USB1_GPTIMER1CTRL = USB_GPTIMERCTRL_GPTRUN | USB_GPTIMERCTRL_GPTRST;
+		break;
+	default:
+		TMR1_CTRL3 = 0;
+		TMR1_CNTR3 = 0;
+		TMR1_COMP13 = qtimer_compare;
+		TMR1_SCTRL3 = TMR_SCTRL_TCFIE;
+		TMR1_CTRL3 = TMR_CTRL_CM(1) | TMR_CTRL_PCS(qtimer_pcs) | TMR_CTRL_ONCE;
+		break;
+	}
+}
+
+static void timer_stop(usb_cdc_port_t *p)
+{
+	switch (p->config->timer) {
+	case USB_CDC_TIMER_GPT0:
+		USB1_GPTIMER0CTRL = 0;
+		break;
+	case USB_CDC_TIMER_GPT1:
+		USB1_GPTIMER1CTRL = 0;
+		break;
+	default:
+		TMR1_CTRL3 = 0;
+		break;
+	}
+}
+
+
+void usb_cdc_configure(usb_cdc_port_t *p)
+{
+	const usb_cdc_config_t *cfg = p->config;
+	int i;
+
+	if (usb_high_speed) {
+		p->tx_packet_size = CDC_TX_SIZE_480;
+		p->rx_packet_size = CDC_RX_SIZE_480;
+	} else {
+		p->tx_packet_size = CDC_TX_SIZE_12;
+		p->rx_packet_size = CDC_RX_SIZE_12;
+	}
+	memset(p->tx_transfer, 0, sizeof(p->tx_transfer));
+	p->tx_head = 0;
+	p->tx_available = 0;
+	memset(p->rx_transfer, 0, sizeof(p->rx_transfer));
+	memset(p->rx_count, 0, sizeof(p->rx_count));
+	memset(p->rx_index, 0, sizeof(p->rx_index));
+	p->rx_head = 0;
+	p->rx_tail = 0;
+	p->rx_available = 0;
+	memset(p->rx_direct_buffer, 0, sizeof(p->rx_direct_buffer));
+	p->rx_direct_pending = 0;
+	p->rx_parked = 0;
+	usb_config_tx(cfg->acm_endpoint, CDC_ACM_SIZE, 0, NULL); // size same 12 & 480
+	usb_config_rx(cfg->rx_endpoint, p->rx_packet_size, 0, cfg->rx_event);
+	usb_config_tx(cfg->tx_endpoint, p->tx_packet_size, 1, cfg->tx_event);
+	usb_config_tx_ioc_on_request(cfg->tx_endpoint);
+	for (i=0; i < p->rx_num; i++) rx_queue_transfer(p, i);
+	flush_policy_update(p);
+	timer_config(p);
+}
+
+
+/*************************************************************************/
+/**                               Receive                               **/
+/*************************************************************************/
+
+static void rx_queue_transfer(usb_cdc_port_t *p, int i)
+{
+	NVIC_DISABLE_IRQ(IRQ_USB1);
+	if (p->rx_direct_pending) {
+		p->rx_parked |= (1 << i);
+		NVIC_ENABLE_IRQ(IRQ_USB1);
+		return;
+	}
+	void *buffer = rx_buf(p, i);
+	usb_prepare_transfer(p->rx_transfer + i, buffer, p->rx_packet_size, i);
+	dma_buffer_from_device(buffer, p->rx_packet_size);
+	usb_receive(p->config->rx_endpoint, p->rx_transfer + i);
+	NVIC_ENABLE_IRQ(IRQ_USB1);
+}
+
+// called by USB interrupt when a direct read completes
+static void rx_direct_event(usb_cdc_port_t *p, transfer_t *t, uint32_t n)
+{
+	uint32_t len = p->rx_direct_size[n] - ((t->status >> 16) & 0x7FFF);
+	void *buffer = p->rx_direct_buffer[n];
+	void (*callback)(void *buffer, uint32_t count) = p->rx_direct_callback[n];
+	p->rx_direct_buffer[n] = NULL;
+	p->rx_direct_pending--;
+	if (callback) (*callback)(buffer, len);
+	// if the callback did not post another direct read, resume normal receive
+	if (!p->rx_direct_pending) {
+		uint32_t parked = p->rx_parked;
+		p->rx_parked = 0;
+		while (parked) {
+			int i = __builtin_ctz(parked);
+			rx_queue_transfer(p, i);
+			parked &= ~(1 << i);
+		}
+	}
+}
+
+// called by USB interrupt when any packet is received
+void usb_cdc_rx_event(usb_cdc_port_t *p, transfer_t *t)
+{
+	if (t->callback_param >= RX_DIRECT_PARAM) {
+		rx_direct_event(p, t, t->callback_param - RX_DIRECT_PARAM);
+		return;
+	}
+	int len = p->rx_packet_size - ((t->status >> 16) & 0x7FFF);
+	int i = t->callback_param;
+	printf("rx event, len=%d, i=%d\n", len, i);
+	if (len > 0) {
+		// received a packet with data
+		uint32_t head = p->rx_head;
+		if (head != p->rx_tail) {
+			// a previous packet is still buffered
+			uint32_t ii = p->rx_list[head];
+			uint32_t count = p->rx_count[ii];
+			if (len <= CDC_RX_SIZE_480 - count) {
+				// previous buffer has enough free space for this packet's data
+				memcpy(rx_buf(p, ii) + count, rx_buf(p, i), len);
+				p->rx_count[ii] = count + len;
+				p->rx_available += len;
+				yield_ready(p->config->yield_flag);
+				rx_queue_transfer(p, i);
+				if (p->rx_callback) (*p->rx_callback)(p->rx_available);
+				return;
+			}
+		}
+		// add this packet to rx_list
+		p->rx_count[i] = len;
+		p->rx_index[i] = 0;
+		if (++head > p->rx_num) head = 0;
+		p->rx_list[head] = i;
+		p->rx_head = head;
+		p->rx_available += len;
+		yield_ready(p->config->yield_flag);
+		if (p->rx_callback) (*p->rx_callback)(p->rx_available);
+	} else {
+		// received a zero length packet
+		rx_queue_transfer(p, i);
+	}
+}
+
+// set a function to be called (from the USB interrupt) each time data
+// is added to the receive buffer.  NULL disables the notification.
+void usb_cdc_set_rx_callback(usb_cdc_port_t *p, void (*callback)(uint32_t available))
+{
+	NVIC_DISABLE_IRQ(IRQ_USB1);
+	p->rx_callback = callback;
+	NVIC_ENABLE_IRQ(IRQ_USB1);
+}
+
+// read a block of bytes to a buffer
+int usb_cdc_read(usb_cdc_port_t *p, void *buffer, uint32_t size)
+{
+	uint8_t *dest = (uint8_t *)buffer;
+	uint32_t count=0;
+
+	NVIC_DISABLE_IRQ(IRQ_USB1);
+	uint32_t tail = p->rx_tail;
+	while (count < size && tail != p->rx_head) {
+		if (++tail > p->rx_num) tail = 0;
+		uint32_t i = p->rx_list[tail];
+		uint32_t len = size - count;
+		uint32_t avail = p->rx_count[i] - p->rx_index[i];
+		if (avail > len) {
+			// partially consume this packet
+			memcpy(dest, rx_buf(p, i) + p->rx_index[i], len);
+			p->rx_available -= len;
+			p->rx_index[i] += len;
+			count += len;
+		} else {
+			// fully consume this packet
+			memcpy(dest, rx_buf(p, i) + p->rx_index[i], avail);
+			dest += avail;
+			p->rx_available -= avail;
+			count += avail;
+			p->rx_tail = tail;
+			rx_queue_transfer(p, i);
+		}
+	}
+	NVIC_ENABLE_IRQ(IRQ_USB1);
+	return count;
+}
+
+// get the next character, or -1 if nothing received
+int usb_cdc_getchar(usb_cdc_port_t *p)
+{
+	uint8_t c;
+	if (usb_cdc_read(p, &c, 1)) return c;
+	return -1;
+}
+
+// peek at the next character, or -1 if nothing received
+int usb_cdc_peekchar(usb_cdc_port_t *p)
+{
+	uint32_t tail = p->rx_tail;
+	if (tail == p->rx_head) return -1;
+	if (++tail > p->rx_num) tail = 0;
+	uint32_t i = p->rx_list[tail];
+	return rx_buf(p, i)[p->rx_index[i]];
+}
+
+// number of bytes available in the receive buffer
+int usb_cdc_available(usb_cdc_port_t *p)
+{
+	uint32_t n = p->rx_available;
+	if (n == 0) yield();
+	return n;
+}
+
+// discard any buffered input
+void usb_cdc_flush_input(usb_cdc_port_t *p)
+{
+	uint32_t tail = p->rx_tail;
+	while (tail != p->rx_head) {
+		if (++tail > p->rx_num) tail = 0;
+		uint32_t i = p->rx_list[tail];
+		p->rx_available -= p->rx_count[i] - p->rx_index[i];
+		rx_queue_transfer(p, i);
+		p->rx_tail = tail;
+	}
+}
+
+// add extra receive buffers, to allow more data to be buffered when the
+// USB host sends bursts faster than the program reads.  Each 512 bytes of
+// memory adds one receive transfer, up to USB_SERIAL_RX_NUM_MAX total.
+// The memory is used by USB DMA, so DTCM, DMAMEM or EXTMEM may be used.
+// Memory may be added only once; later calls are ignored.
+void usb_cdc_add_memory_for_read(usb_cdc_port_t *p, void *buffer, uint32_t length)
+{
+	uint32_t addr = ((uint32_t)buffer + 31) & ~31;
+	if (!buffer || p->rx_extra_buffer) return;
+	if (length < addr - (uint32_t)buffer) return;
+	uint32_t num = (length - (addr - (uint32_t)buffer)) / CDC_RX_SIZE_480;
+	if (num > USB_SERIAL_RX_NUM_MAX - USB_CDC_RX_NUM) num = USB_SERIAL_RX_NUM_MAX - USB_CDC_RX_NUM;
+	if (num == 0) return;
+	NVIC_DISABLE_IRQ(IRQ_USB1);
+	// rx_list wraps at rx_num, so move any buffered packets to
+	// the beginning of the list before making it longer
+	uint8_t list[USB_CDC_RX_NUM];
+	uint32_t count = 0;
+	uint32_t tail = p->rx_tail;
+	while (tail != p->rx_head) {
+		if (++tail > p->rx_num) tail = 0;
+		list[count++] = p->rx_list[tail];
+	}
+	for (uint32_t n=0; n < count; n++) p->rx_list[n + 1] = list[n];
+	p->rx_tail = 0;
+	p->rx_head = count;
+	p->rx_extra_buffer = (uint8_t *)addr;
+	uint32_t first = p->rx_num;
+	p->rx_num = USB_CDC_RX_NUM + num;
+	if (usb_configuration && p->rx_packet_size) {
+		for (uint32_t i=first; i < p->rx_num; i++) {
+			memset(p->rx_transfer + i, 0, sizeof(transfer_t));
+			rx_queue_transfer(p, i);
+		}
+	}
+	NVIC_ENABLE_IRQ(IRQ_USB1);
+}
+
+// Receive directly into the caller's buffer, avoiding copies for large
+// uploads.  The buffer must be 32 byte aligned and its size a multiple of
+// 512, up to 16384 bytes.  The callback is called from the USB interrupt
+// with the number of bytes received, which is less than size if the host
+// ended the transfer with a short packet.  Data already buffered, and up
+// to the number of receive buffers already waiting for the host, arrive
+// through the normal read functions first.  Up to 2 direct reads may be
+// pending.  Returns 0 if the buffer could not be posted.
+int usb_cdc_read_direct(usb_cdc_port_t *p, void *buffer, uint32_t size,
+	void (*callback)(void *buffer, uint32_t count))
+{
+	if (!usb_configuration || !buffer) return 0;
+	if (((uint32_t)buffer & 31) || (size & 511) || size == 0 || size > 16384) return 0;
+	NVIC_DISABLE_IRQ(IRQ_USB1);
+	uint32_t n;
+	for (n=0; n < USB_CDC_RX_DIRECT_NUM; n++) {
+		if (p->rx_direct_buffer[n] == NULL) break;
+	}
+	if (n >= USB_CDC_RX_DIRECT_NUM) {
+		NVIC_ENABLE_IRQ(IRQ_USB1);
+		return 0;
+	}
+	p->rx_direct_buffer[n] = buffer;
+	p->rx_direct_size[n] = size;
+	p->rx_direct_callback[n] = callback;
+	p->rx_direct_pending++;
+	transfer_t *t = p->rx_direct_transfer + n;
+	usb_prepare_transfer(t, buffer, size, RX_DIRECT_PARAM + n);
+	dma_buffer_from_device(buffer, size);
+	usb_receive(p->config->rx_endpoint, t);
+	NVIC_ENABLE_IRQ(IRQ_USB1);
+	return 1;
+}
+
+
+/*************************************************************************/
+/**                               Transmit                              **/
+/*************************************************************************/
+
+// compute the flush timeout range for the current policy and USB speed
+static void flush_policy_update(usb_cdc_port_t *p)
+{
+	uint32_t def = usb_high_speed ? TRANSMIT_FLUSH_TIMEOUT_480 : TRANSMIT_FLUSH_TIMEOUT_12;
+	if (p->flush_policy == USB_SERIAL_FLUSH_ADAPTIVE) {
+		p->flush_timeout_min = p->flush_timeout_setting ? p->flush_timeout_setting : TRANSMIT_FLUSH_TIMEOUT_MIN;
+		p->flush_timeout_max = p->flush_timeout_max_setting ? p->flush_timeout_max_setting : TRANSMIT_FLUSH_TIMEOUT_MAX;
+		if (p->flush_timeout_max < p->flush_timeout_min) p->flush_timeout_max = p->flush_timeout_min;
+		if (def < p->flush_timeout_min) def = p->flush_timeout_min;
+		if (def > p->flush_timeout_max) def = p->flush_timeout_max;
+	} else {
+		if (p->flush_timeout_setting) def = p->flush_timeout_setting;
+		p->flush_timeout_min = def;
+		p->flush_timeout_max = def;
+	}
+	p->flush_timeout = def;
+}
+
+// Select how long partially filled buffers wait for more data.
+//  USB_SERIAL_FLUSH_FIXED: wait "microseconds", or 0 for the default
+//     of 75 us at 480 Mbit/sec or 250 us at 12 Mbit/sec.
+//  USB_SERIAL_FLUSH_ADAPTIVE: the timeout varies between "microseconds"
+//     and "max_microseconds" (0 for defaults of 20 and 1000).  It grows
+//     while the program writes quickly, so packets are more completely
+//     filled, and shrinks for sparse interactive writes.
+void usb_cdc_set_flush_policy(usb_cdc_port_t *p, uint8_t policy,
+	uint32_t microseconds, uint32_t max_microseconds)
+{
+	if (microseconds > 65535) microseconds = 65535;
+	if (max_microseconds > 65535) max_microseconds = 65535;
+	p->tx_noautoflush = 1;
+	p->flush_policy = policy;
+	p->flush_timeout_setting = microseconds;
+	p->flush_timeout_max_setting = max_microseconds;
+	flush_policy_update(p);
+	if (usb_configuration) timer_set_timeout(p, p->flush_timeout);
+	asm("dsb" ::: "memory");
+	p->tx_noautoflush = 0;
+}
+
+// adaptive policy: "count" bytes accumulated while the timer ran
+static void flush_policy_adapt(usb_cdc_port_t *p, uint32_t count)
+{
+	uint32_t timeout = p->flush_timeout;
+	if (count >= p->tx_packet_size) {
+		// writing rapidly, wait longer to send full packets
+		timeout += (timeout >> 2) + 1;
+		if (timeout > p->flush_timeout_max) timeout = p->flush_timeout_max;
+	} else if (count < (uint32_t)(p->tx_packet_size >> 3)) {
+		// sparse writes, respond more quickly
+		timeout -= timeout >> 2;
+		if (timeout < p->flush_timeout_min) timeout = p->flush_timeout_min;
+	} else {
+		return;
+	}
+	if (timeout != p->flush_timeout) {
+		p->flush_timeout = timeout;
+		timer_set_timeout(p, timeout);
+	}
+}
+
+// wait for the current tx buffer to have space.  Returns non-zero when
+// tx_available is ready, or zero if the host isn't listening.  Must be
+// called with tx_noautoflush set; it is cleared while waiting.
+static int tx_wait_available(usb_cdc_port_t *p)
+{
+	transfer_t *xfer = p->tx_transfer + p->tx_head;
+	int waiting=0;
+	uint32_t wait_begin_at=0;
+	while (!p->tx_available) {
+		uint32_t status = usb_transfer_status(xfer);
+		if (!(status & 0x80)) {
+			if (status & 0x68) {
+				// TODO: what if status has errors???
+				printf("ERROR status = %x, i=%d, ms=%u\n",
+					status, p->tx_head, systick_millis_count);
+			}
+			p->tx_available = USB_CDC_TX_SIZE;
+			// When we've suffered the transmit timeout, don't wait again
+			// until the computer begins accepting data.  If no software is
+			// running to receive, we'll just discard data as rapidly as
+			// Serial.print() can generate it.
+			p->transmit_previous_timeout = 0;
+			break;
+		}
+		if (p->write_nonblocking) {
+			// don't wait, tx_event will tell when space is available.
+			// Check again, in case the transfer completed before the
+			// flag was set.
+			p->tx_space_wanted = 1;
+			asm("dsb" ::: "memory");
+			if (usb_transfer_status(xfer) & 0x80) return 0;
+			continue;
+		}
+		asm("dsb" ::: "memory");
+		p->tx_noautoflush = 0;
+		if (!waiting) {
+			wait_begin_at = systick_millis_count;
+			waiting = 1;
+		}
+		if (p->transmit_previous_timeout) return 0;
+		if (systick_millis_count - wait_begin_at > TX_TIMEOUT_MSEC) {
+			// waited too long, assume the USB host isn't listening
+			p->transmit_previous_timeout = 1;
+			p->tx_space_wanted = 1;
+			return 0;
+		}
+		if (!usb_configuration) return 0;
+		yield();
+		p->tx_noautoflush = 1;
+	}
+	return 1;
+}
+
+// transmit "len" bytes of the current tx buffer, and move to the next
+static void tx_send_buffer(usb_cdc_port_t *p, uint32_t len)
+{
+	transfer_t *xfer = p->tx_transfer + p->tx_head;
+	uint8_t *txbuf = usb_cdc_tx_buf(p, p->tx_head);
+	usb_prepare_transfer(xfer, txbuf, len, 0);
+	// interrupt only when a write event needs to know about free space
+	if (p->tx_callback) xfer->status |= USB_TRANSFER_IOC;
+	dma_buffer_to_device(txbuf, len);
+	usb_transmit(p->config->tx_endpoint, xfer);
+	if (++p->tx_head >= p->tx_num) p->tx_head = 0;
+	p->tx_available = 0;
+}
+
+int usb_cdc_write(usb_cdc_port_t *p, const void *buffer, uint32_t size)
+{
+	uint32_t sent=0;
+	const uint8_t *data = (const uint8_t *)buffer;
+
+	if (!usb_configuration) return 0;
+	while (size > 0) {
+		p->tx_noautoflush = 1;
+		if (!tx_wait_available(p)) {
+			p->tx_noautoflush = 0;
+			return sent;
+		}
+		uint8_t *txdata = usb_cdc_tx_buf(p, p->tx_head) + (USB_CDC_TX_SIZE - p->tx_available);
+		if (size >= p->tx_available) {
+			uint32_t len = p->tx_available;
+			memcpy(txdata, data, len);
+			tx_send_buffer(p, USB_CDC_TX_SIZE);
+			timer_stop(p);
+			size -= len;
+			sent += len;
+			data += len;
+		} else {
+			memcpy(txdata, data, size);
+			p->tx_available -= size;
+			sent += size;
+			size = 0;
+			timer_start_oneshot(p);
+		}
+		asm("dsb" ::: "memory");
+		p->tx_noautoflush = 0;
+	}
+	return sent;
+}
+
+// Zero-copy transmit: get a pointer directly into the USB transmit buffer.
+// The caller may write up to *len bytes, then must call
+// usb_cdc_commit_write() to release the buffer.  Until commit, the
+// automatic flush timer will not send the partially written buffer.
+// Returns NULL (and *len = 0) if the host isn't listening.
+uint8_t * usb_cdc_get_write_buffer(usb_cdc_port_t *p, uint32_t *len)
+{
+	*len = 0;
+	if (!usb_configuration) return NULL;
+	p->tx_noautoflush = 1;
+	if (!tx_wait_available(p)) {
+		p->tx_noautoflush = 0;
+		return NULL;
+	}
+	*len = p->tx_available;
+	return usb_cdc_tx_buf(p, p->tx_head) + (USB_CDC_TX_SIZE - p->tx_available);
+}
+
+// Finish a zero-copy write, after the caller has placed "size" bytes into
+// the buffer returned by usb_cdc_get_write_buffer().  A full buffer is
+// transmitted immediately, otherwise the normal flush timeout applies.
+int usb_cdc_commit_write(usb_cdc_port_t *p, uint32_t size)
+{
+	if (!usb_configuration || p->tx_available == 0) {
+		p->tx_noautoflush = 0;
+		return 0;
+	}
+	if (size >= p->tx_available) {
+		size = p->tx_available;
+		tx_send_buffer(p, USB_CDC_TX_SIZE);
+		timer_stop(p);
+	} else if (size > 0) {
+		p->tx_available -= size;
+		timer_start_oneshot(p);
+	}
+	asm("dsb" ::: "memory");
+	p->tx_noautoflush = 0;
+	return size;
+}
+
+int usb_cdc_write_buffer_free(usb_cdc_port_t *p)
+{
+	return usb_cdc_tx_free(p);
+}
+
+// Non-blocking writes return at once with the number of bytes accepted,
+// instead of waiting up to TX_TIMEOUT_MSEC for the host to read.
+void usb_cdc_set_write_blocking(usb_cdc_port_t *p, uint8_t blocking)
+{
+	p->write_nonblocking = blocking ? 0 : 1;
+}
+
+// set a function to be called (from the USB interrupt) when transmit
+// buffer space becomes available, after a write could not be completed.
+// The callback receives the number of bytes which may be written.  Only
+// buffers sent after it is set interrupt when done, so set it before
+// writing.
+void usb_cdc_set_tx_callback(usb_cdc_port_t *p, void (*callback)(uint32_t space))
+{
+	NVIC_DISABLE_IRQ(IRQ_USB1);
+	p->tx_callback = callback;
+	NVIC_ENABLE_IRQ(IRQ_USB1);
+}
+
+// called by USB interrupt when a transmit buffer has been sent, only for
+// transfers sent while a tx callback is set
+void usb_cdc_tx_event(usb_cdc_port_t *p, transfer_t *t)
+{
+	if (!p->tx_space_wanted) return;
+	p->tx_space_wanted = 0;
+	if (p->tx_callback) (*p->tx_callback)(usb_cdc_tx_free(p) + p->tx_available);
+}
+
+// add extra transmit buffers, so more data may be written without waiting
+// for the USB host.  Each 2048 bytes of memory adds one transmit buffer, up
+// to USB_SERIAL_TX_NUM_MAX total.  The memory is used by USB DMA, so DTCM,
+// DMAMEM or EXTMEM may be used.  Memory may be added only once.
+void usb_cdc_add_memory_for_write(usb_cdc_port_t *p, void *buffer, uint32_t length)
+{
+	uint32_t addr = ((uint32_t)buffer + 31) & ~31;
+	if (!buffer || p->tx_extra_buffer) return;
+	if (length < addr - (uint32_t)buffer) return;
+	uint32_t num = (length - (addr - (uint32_t)buffer)) / USB_CDC_TX_SIZE;
+	if (num > USB_SERIAL_TX_NUM_MAX - USB_CDC_TX_NUM) num = USB_SERIAL_TX_NUM_MAX - USB_CDC_TX_NUM;
+	if (num == 0) return;
+	// the new transfers are idle, so the ring may grow at any time
+	p->tx_noautoflush = 1;
+	memset(p->tx_transfer + USB_CDC_TX_NUM, 0, num * sizeof(transfer_t));
+	p->tx_extra_buffer = (uint8_t *)addr;
+	asm("dsb" ::: "memory");
+	p->tx_num = USB_CDC_TX_NUM + num;
+	p->tx_noautoflush = 0;
+}
+
+void usb_cdc_flush_output(usb_cdc_port_t *p)
+{
+	if (!usb_configuration) return;
+	if (p->tx_available == 0) return;
+	p->tx_noautoflush = 1;
+	tx_send_buffer(p, USB_CDC_TX_SIZE - p->tx_available);
+	asm("dsb" ::: "memory");
+	p->tx_noautoflush = 0;
+}
+
+// called by the port's flush timer
+void usb_cdc_flush_callback(usb_cdc_port_t *p)
+{
+	if (p->tx_noautoflush) {
+		// try again later, because usb_cdc_putchar() relies on the
+		// timer to send a partially filled buffer
+		timer_start_oneshot(p);
+		return;
+	}
+	if (!usb_configuration) return;
+	if (p->tx_available == 0) return;
+	uint32_t txnum = USB_CDC_TX_SIZE - p->tx_available;
+	tx_send_buffer(p, txnum);
+	if (p->flush_policy == USB_SERIAL_FLUSH_ADAPTIVE) flush_policy_adapt(p, txnum);
+}
+
+#endif // CDC_STATUS_INTERFACE && CDC_DATA_INTERFACE
@@ -0,0 +1,200 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include "usb_dev.h"
+#include <stdint.h>
+
+#if !defined(USB_DISABLED)
+
+// CDC serial engine shared by usb_serial.c, usb_serial2.c and usb_serial3.c.
+// Each port describes its endpoints, flush timer and buffers with a
+// usb_cdc_config_t in flash and keeps its state in a usb_cdc_port_t, which
+// must be in DTCM because it holds the USB transfer descriptors.  A port
+// file only defines these, the line coding variables and thin wrappers
+// with its usb_serialN_ names.  More ports need only another file like
+// usb_serial2.c, and a flush timer.
+
+#define USB_CDC_TX_NUM   4
+#define USB_CDC_TX_SIZE  2048 /* should be a multiple of CDC_TX_SIZE */
+#define USB_CDC_RX_NUM   8
+
+// addMemoryForWrite() and addMemoryForRead() can grow the transmit and
+// receive rings at runtime, up to these maximum sizes.  Only the transfer
+// descriptors are reserved.
+#ifndef USB_SERIAL_TX_NUM_MAX
+#define USB_SERIAL_TX_NUM_MAX  16
+#endif
+#ifndef USB_SERIAL_RX_NUM_MAX
+#define USB_SERIAL_RX_NUM_MAX  32
+#endif
+#if USB_SERIAL_RX_NUM_MAX > 32
+#error "USB_SERIAL_RX_NUM_MAX must be 32 or less"
+#endif
+#define USB_CDC_RX_DIRECT_NUM  2
+
+// Timers for the transmit flush timeout, one per port
+#define USB_CDC_TIMER_GPT0    0	// USB1 general purpose timer 0
+#define USB_CDC_TIMER_GPT1    1	// USB1 general purpose timer 1
+#define USB_CDC_TIMER_QTIMER  2	// Quad Timer 1 channel 3
+
+typedef struct {
+	uint8_t acm_endpoint;
+	uint8_t rx_endpoint;
+	uint8_t tx_endpoint;
+	uint8_t timer;			// USB_CDC_TIMER_xxx
+	uint32_t yield_flag;		// YIELD_CHECK_USB_SERIALxxx
+	uint8_t *tx_buffer;		// USB_CDC_TX_NUM * USB_CDC_TX_SIZE
+	uint8_t *rx_buffer;		// USB_CDC_RX_NUM * CDC_RX_SIZE_480
+	void (*rx_event)(transfer_t *t);	// calls usb_cdc_rx_event for this port
+	void (*tx_event)(transfer_t *t);	// calls usb_cdc_tx_event
+	void (*flush_callback)(void);		// calls usb_cdc_flush_callback
+} usb_cdc_config_t;
+
+typedef struct {
+	transfer_t tx_transfer[USB_SERIAL_TX_NUM_MAX] __attribute__ ((aligned(32)));
+	transfer_t rx_transfer[USB_SERIAL_RX_NUM_MAX] __attribute__ ((aligned(32)));
+	transfer_t rx_direct_transfer[USB_CDC_RX_DIRECT_NUM] __attribute__ ((aligned(32)));
+	const usb_cdc_config_t *config;
+	// transmit
+	uint8_t *tx_extra_buffer;
+	volatile uint8_t tx_noautoflush;
+	uint8_t transmit_previous_timeout;
+	uint8_t write_nonblocking;	// write returns at once when buffers are full
+	volatile uint8_t tx_space_wanted;	// a write could not be accepted
+	void (*tx_callback)(uint32_t space);
+	uint8_t tx_num;
+	uint8_t tx_head;
+	uint16_t tx_available;
+	uint16_t tx_packet_size;
+	uint8_t flush_policy;
+	uint16_t flush_timeout_setting;	// 0 = use default for speed
+	uint16_t flush_timeout_max_setting;
+	uint16_t flush_timeout;
+	uint16_t flush_timeout_min;
+	uint16_t flush_timeout_max;
+	// receive
+	uint8_t *rx_extra_buffer;
+	uint8_t rx_num;
+	volatile uint8_t rx_head;
+	volatile uint8_t rx_tail;
+	uint16_t rx_packet_size;
+	volatile uint32_t rx_available;
+	uint16_t rx_count[USB_SERIAL_RX_NUM_MAX];
+	uint16_t rx_index[USB_SERIAL_RX_NUM_MAX];
+	uint8_t rx_list[USB_SERIAL_RX_NUM_MAX + 1];
+	void (*rx_callback)(uint32_t available);
+	// direct reads into the caller's buffer
+	void *rx_direct_buffer[USB_CDC_RX_DIRECT_NUM];
+	uint16_t rx_direct_size[USB_CDC_RX_DIRECT_NUM];
+	void (*rx_direct_callback[USB_CDC_RX_DIRECT_NUM])(void *buffer, uint32_t count);
+	volatile uint8_t rx_direct_pending;
+	volatile uint32_t rx_parked;
+} usb_cdc_port_t;
+
+#define USB_CDC_PORT_INIT(cfg) { .config = &(cfg), \
+	.tx_num = USB_CDC_TX_NUM, .rx_num = USB_CDC_RX_NUM }
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+extern volatile uint8_t usb_configuration;
+void usb_cdc_configure(usb_cdc_port_t *p);
+void usb_cdc_rx_event(usb_cdc_port_t *p, transfer_t *t);
+void usb_cdc_flush_callback(usb_cdc_port_t *p);
+void usb_cdc_tx_event(usb_cdc_port_t *p, transfer_t *t);
+void usb_cdc_set_rx_callback(usb_cdc_port_t *p, void (*callback)(uint32_t available));
+int usb_cdc_read(usb_cdc_port_t *p, void *buffer, uint32_t size);
+int usb_cdc_getchar(usb_cdc_port_t *p);
+int usb_cdc_peekchar(usb_cdc_port_t *p);
+int usb_cdc_available(usb_cdc_port_t *p);
+void usb_cdc_flush_input(usb_cdc_port_t *p);
+void usb_cdc_add_memory_for_read(usb_cdc_port_t *p, void *buffer, uint32_t length);
+int usb_cdc_read_direct(usb_cdc_port_t *p, void *buffer, uint32_t size,
+	void (*callback)(void *buffer, uint32_t count));
+int usb_cdc_write(usb_cdc_port_t *p, const void *buffer, uint32_t size);
+uint8_t * usb_cdc_get_write_buffer(usb_cdc_port_t *p, uint32_t *len);
+int usb_cdc_commit_write(usb_cdc_port_t *p, uint32_t size);
+int usb_cdc_write_buffer_free(usb_cdc_port_t *p);
+void usb_cdc_add_memory_for_write(usb_cdc_port_t *p, void *buffer, uint32_t length);
+void usb_cdc_flush_output(usb_cdc_port_t *p);
+void usb_cdc_set_write_blocking(usb_cdc_port_t *p, uint8_t blocking);
+void usb_cdc_set_tx_callback(usb_cdc_port_t *p, void (*callback)(uint32_t space));
+void usb_cdc_set_flush_policy(usb_cdc_port_t *p, uint8_t policy,
+	uint32_t microseconds, uint32_t max_microseconds);
+#ifdef __cplusplus
+}
+#endif
+
+// buffers beyond the built-in ones come from memory added by the user
+static inline uint8_t * usb_cdc_tx_buf(usb_cdc_port_t *p, uint32_t i)
+{
+	if (i < USB_CDC_TX_NUM) return p->config->tx_buffer + i * USB_CDC_TX_SIZE;
+	return p->tx_extra_buffer + (i - USB_CDC_TX_NUM) * USB_CDC_TX_SIZE;
+}
+
+// Transmit one byte.  The common case, appending to a partially filled
+// buffer, is done inline.  The flush timer is already running for that
+// buffer, so it doesn't need to be restarted.  An empty buffer, or the
+// last byte which fills a buffer, goes through usb_cdc_write().
+static inline int usb_cdc_putchar(usb_cdc_port_t *p, uint8_t c)
+{
+	__disable_irq();
+	uint32_t avail = p->tx_available;
+	if (avail > 1 && avail < USB_CDC_TX_SIZE && usb_configuration) {
+		usb_cdc_tx_buf(p, p->tx_head)[USB_CDC_TX_SIZE - avail] = c;
+		p->tx_available = avail - 1;
+		__enable_irq();
+		return 1;
+	}
+	__enable_irq();
+	return usb_cdc_write(p, &c, 1);
+}
+
+// Bytes which could be written without waiting, not counting any space
+// left in the partially filled current buffer.  Transfers complete in the
+// order they were queued, so the busy buffers are the ones just before
+// tx_head, and tx_head itself is busy only when all of them are.  Most
+// transfers don't interrupt, so their status is checked, newest first,
+// stopping at the first one finished.
+static inline int usb_cdc_tx_free(usb_cdc_port_t *p)
+{
+	uint32_t busy = 0, i = p->tx_head;
+	while (busy < p->tx_num) {
+		i = i ? i - 1 : p->tx_num - 1;
+		if (!(usb_transfer_status(p->tx_transfer + i) & 0x80)) break;
+		busy++;
+	}
+	if (busy >= p->tx_num) return 0;
+	return (p->tx_num - 1 - busy) * USB_CDC_TX_SIZE;
+}
+
+#endif // !defined(USB_DISABLED)
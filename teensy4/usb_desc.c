@@ -37,6 +37,9 @@
 #include "imxrt.h"
 #include "avr_functions.h"
 #include "avr/pgmspace.h"
+#ifdef NCM_STATUS_INTERFACE
+#include "usb_ncm.h"
+#endif
 
 // At very slow CPU speeds, the OCRAM just isn't fast enough for
 // USB to work reliably.  But the precious/limited DTCM is.  So
@@ -90,7 +93,11 @@
 static uint8_t device_descriptor[] = {
         18,                                     // bLength
         1,                                      // bDescriptorType
+#ifdef VENDOR_INTERFACE
+        0x10, 0x02,                             // bcdUSB, 2.1 has a BOS descriptor
+#else
         0x00, 0x02,                             // bcdUSB
+#endif
 #ifdef DEVICE_CLASS
         DEVICE_CLASS,                           // bDeviceClass
 #else
@@ -155,6 +162,73 @@ PROGMEM static const uint8_t qualifier_descriptor[] = {	// 9.6.2 Device_Qualifie
         0                                       // bReserved
 };
 
+#ifdef VENDOR_INTERFACE
+// Binary Object Store, USB 3.2 spec 9.6.2.  Its platform capability tells
+// Windows to ask for the Microsoft OS 2.0 descriptor set below, with a
+// vendor request using bRequest = VENDOR_MSOS20_CODE.
+PROGMEM static const uint8_t bos_descriptor[VENDOR_BOS_DESC_SIZE] = {
+        5,                                      // bLength
+        15,                                     // bDescriptorType (15=BOS)
+        LSB(VENDOR_BOS_DESC_SIZE),              // wTotalLength
+        MSB(VENDOR_BOS_DESC_SIZE),
+        1,                                      // bNumDeviceCaps
+        // platform capability, MS OS 2.0 Descriptors spec, Table 4
+        28,                                     // bLength
+        16,                                     // bDescriptorType (16=capability)
+        5,                                      // bDevCapabilityType (5=platform)
+        0,                                      // bReserved
+        0xDF, 0x60, 0xDD, 0xD8, 0x89, 0x45, 0xC7, 0x4C, // PlatformCapabilityUUID
+        0x9C, 0xD2, 0x65, 0x9D, 0x9E, 0x64, 0x8A, 0x9F, // D8DD60DF-4589-4CC7-9CD2-659D9E648A9F
+        0x00, 0x00, 0x03, 0x06,                 // dwWindowsVersion (Windows 8.1)
+        LSB(VENDOR_MSOS20_DESC_SIZE),           // wMSOSDescriptorSetTotalLength
+        MSB(VENDOR_MSOS20_DESC_SIZE),
+        VENDOR_MSOS20_CODE,                     // bMS_VendorCode
+        0                                       // bAltEnumCode
+};
+
+// Microsoft OS 2.0 descriptor set, MS OS 2.0 Descriptors spec, Table 9-16.
+// The function subset applies WinUSB only to VENDOR_INTERFACE, so the
+// other interfaces still use their normal class drivers.  Strings are
+// UTF-16, so they're stored as 16 bit arrays.
+PROGMEM const usb_msos20_descriptor_t usb_msos20_descriptor = {
+        {
+        // descriptor set header
+        10, 0,                                  // wLength
+        0, 0,                                   // wDescriptorType (0=set header)
+        0x00, 0x00, 0x03, 0x06,                 // dwWindowsVersion (Windows 8.1)
+        LSB(VENDOR_MSOS20_DESC_SIZE),           // wTotalLength
+        MSB(VENDOR_MSOS20_DESC_SIZE),
+        // configuration subset header
+        8, 0,                                   // wLength
+        1, 0,                                   // wDescriptorType (1=configuration)
+        0,                                      // bConfigurationValue (index)
+        0,                                      // bReserved
+        LSB(VENDOR_MSOS20_DESC_SIZE - 10),      // wTotalLength
+        MSB(VENDOR_MSOS20_DESC_SIZE - 10),
+        // function subset header
+        8, 0,                                   // wLength
+        2, 0,                                   // wDescriptorType (2=function)
+        VENDOR_INTERFACE,                       // bFirstInterface
+        0,                                      // bReserved
+        LSB(VENDOR_MSOS20_DESC_SIZE - 18),      // wSubsetLength
+        MSB(VENDOR_MSOS20_DESC_SIZE - 18),
+        // compatible ID descriptor
+        20, 0,                                  // wLength
+        3, 0,                                   // wDescriptorType (3=compatible ID)
+        'W', 'I', 'N', 'U', 'S', 'B', 0, 0,     // CompatibleID
+        0, 0, 0, 0, 0, 0, 0, 0,                 // SubCompatibleID
+        // registry property descriptor
+        10+42+80, 0,                            // wLength
+        4, 0,                                   // wDescriptorType (4=registry property)
+        7, 0,                                   // wPropertyDataType (7=REG_MULTI_SZ)
+        42, 0                                   // wPropertyNameLength
+        },
+        {'D','e','v','i','c','e','I','n','t','e','r','f','a','c','e','G','U','I','D','s',0},
+        80,                                     // wPropertyDataLength
+        VENDOR_INTERFACE_GUID                   // PropertyData, 2 null terminators
+};
+#endif
+
 // These descriptors must NOT be "const", because the USB DMA
 // has trouble accessing flash memory with enough bandwidth
 // while the processor is executing from flash.
@@ -169,6 +243,40 @@ PROGMEM static const uint8_t qualifier_descriptor[] = {	// 9.6.2 Device_Qualifie
 // the meaning and format of the data.
 
 #ifdef KEYBOARD_INTERFACE
+#ifdef KEYBOARD_NKRO
+// N-key rollover keyboard, modifier byte followed by 1 bit for every key
+static uint8_t keyboard_report_desc[] = {
+        0x05, 0x01,                     // Usage Page (Generic Desktop),
+        0x09, 0x06,                     // Usage (Keyboard),
+        0xA1, 0x01,                     // Collection (Application),
+        0x75, 0x01,                     //   Report Size (1),
+        0x95, 0x08,                     //   Report Count (8),
+        0x05, 0x07,                     //   Usage Page (Key Codes),
+        0x19, 0xE0,                     //   Usage Minimum (224),
+        0x29, 0xE7,                     //   Usage Maximum (231),
+        0x15, 0x00,                     //   Logical Minimum (0),
+        0x25, 0x01,                     //   Logical Maximum (1),
+        0x81, 0x02,                     //   Input (Data, Variable, Absolute), ;Modifier keys
+        0x95, 0x05,                     //   Report Count (5),
+        0x75, 0x01,                     //   Report Size (1),
+        0x05, 0x08,                     //   Usage Page (LEDs),
+        0x19, 0x01,                     //   Usage Minimum (1),
+        0x29, 0x05,                     //   Usage Maximum (5),
+        0x91, 0x02,                     //   Output (Data, Variable, Absolute), ;LED report
+        0x95, 0x01,                     //   Report Count (1),
+        0x75, 0x03,                     //   Report Size (3),
+        0x91, 0x03,                     //   Output (Constant),         ;LED report padding
+        0x95, KEYBOARD_NKRO_KEYS,       //   Report Count (224),
+        0x75, 0x01,                     //   Report Size (1),
+        0x15, 0x00,                     //   Logical Minimum (0),
+        0x25, 0x01,                     //   Logical Maximum (1),
+        0x05, 0x07,                     //   Usage Page (Key Codes),
+        0x19, 0x00,                     //   Usage Minimum (0),
+        0x29, KEYBOARD_NKRO_KEYS - 1,   //   Usage Maximum (223),
+        0x81, 0x02,                     //   Input (Data, Variable, Absolute), ;Normal keys
+        0xC0                            // End Collection
+};
+#else
 // Keyboard Protocol 1, HID 1.11 spec, Appendix B, page 59-60
 static uint8_t keyboard_report_desc[] = {
         0x05, 0x01,                     // Usage Page (Generic Desktop),
@@ -205,6 +313,7 @@ static uint8_t keyboard_report_desc[] = {
         0xC0                            // End Collection
 };
 #endif
+#endif
 
 #ifdef KEYMEDIA_INTERFACE
 static uint8_t keymedia_report_desc[] = {
@@ -399,37 +508,53 @@ static uint8_t joystick_report_desc[] = {
 // https://msdn.microsoft.com/en-us/library/windows/hardware/ff553734%28v=vs.85%29.aspx
 // https://msdn.microsoft.com/en-us/library/windows/hardware/jj151564%28v=vs.85%29.aspx
 // download.microsoft.com/download/a/d/f/adf1347d-08dc-41a4-9084-623b1194d4b2/digitizerdrvs_touch.docx
+// one finger contact, 6 bytes of each report
+#define MULTITOUCH_CONTACT_DESC \
+        0x09, 0x22,                     /* Usage (Finger) */ \
+        0xA1, 0x02,                     /* Collection (Logical) */ \
+        0x09, 0x42,                     /* Usage (Tip Switch) */ \
+        0x15, 0x00,                     /* Logical Minimum (0) */ \
+        0x25, 0x01,                     /* Logical Maximum (1) */ \
+        0x75, 0x01,                     /* Report Size (1) */ \
+        0x95, 0x01,                     /* Report Count (1) */ \
+        0x81, 0x02,                     /* Input (variable,absolute) */ \
+        0x09, 0x51,                     /* Usage (Contact Identifier) */ \
+        0x25, 0x7F,                     /* Logical Maximum (127) */ \
+        0x75, 0x07,                     /* Report Size (7) */ \
+        0x95, 0x01,                     /* Report Count (1) */ \
+        0x81, 0x02,                     /* Input (variable,absolute) */ \
+        0x09, 0x30,                     /* Usage (Pressure) */ \
+        0x26, 0xFF, 0x00,               /* Logical Maximum (255) */ \
+        0x75, 0x08,                     /* Report Size (8) */ \
+        0x95, 0x01,                     /* Report Count (1) */ \
+        0x81, 0x02,                     /* Input (variable,absolute) */ \
+        0x05, 0x01,                     /* Usage Page (Generic Desktop) */ \
+        0x09, 0x30,                     /* Usage (X) */ \
+        0x09, 0x31,                     /* Usage (Y) */ \
+        0x26, 0xFF, 0x7F,               /* Logical Maximum (32767) */ \
+        0x65, 0x00,                     /* Unit (None)  <-- probably needs real units? */ \
+        0x75, 0x10,                     /* Report Size (16) */ \
+        0x95, 0x02,                     /* Report Count (2) */ \
+        0x81, 0x02,                     /* Input (variable,absolute) */ \
+        0xC0,                           /* End Collection */
+// the 2nd and later contacts must also set the Digitizer usage page again
+#define MULTITOUCH_CONTACTS_DESC_1	MULTITOUCH_CONTACT_DESC
+#define MULTITOUCH_CONTACTS_DESC_2	MULTITOUCH_CONTACTS_DESC_1 0x05, 0x0D, MULTITOUCH_CONTACT_DESC
+#define MULTITOUCH_CONTACTS_DESC_3	MULTITOUCH_CONTACTS_DESC_2 0x05, 0x0D, MULTITOUCH_CONTACT_DESC
+#define MULTITOUCH_CONTACTS_DESC_4	MULTITOUCH_CONTACTS_DESC_3 0x05, 0x0D, MULTITOUCH_CONTACT_DESC
+#define MULTITOUCH_CONTACTS_DESC_5	MULTITOUCH_CONTACTS_DESC_4 0x05, 0x0D, MULTITOUCH_CONTACT_DESC
+#define MULTITOUCH_CONTACTS_DESC_6	MULTITOUCH_CONTACTS_DESC_5 0x05, 0x0D, MULTITOUCH_CONTACT_DESC
+#define MULTITOUCH_CONTACTS_DESC_7	MULTITOUCH_CONTACTS_DESC_6 0x05, 0x0D, MULTITOUCH_CONTACT_DESC
+#define MULTITOUCH_CONTACTS_DESC_8	MULTITOUCH_CONTACTS_DESC_7 0x05, 0x0D, MULTITOUCH_CONTACT_DESC
+#define MULTITOUCH_CONTACTS_DESC_9	MULTITOUCH_CONTACTS_DESC_8 0x05, 0x0D, MULTITOUCH_CONTACT_DESC
+#define MULTITOUCH_CONTACTS_DESC_10	MULTITOUCH_CONTACTS_DESC_9 0x05, 0x0D, MULTITOUCH_CONTACT_DESC
+#define MULTITOUCH_CONTACTS_DESC_N(n)	MULTITOUCH_CONTACTS_DESC_##n
+#define MULTITOUCH_CONTACTS_DESC_X(n)	MULTITOUCH_CONTACTS_DESC_N(n)
 static uint8_t multitouch_report_desc[] = {
         0x05, 0x0D,                     // Usage Page (Digitizer)
         0x09, 0x04,                     // Usage (Touch Screen)
         0xa1, 0x01,                     // Collection (Application)
-        0x09, 0x22,                     //   Usage (Finger)
-        0xA1, 0x02,                     //   Collection (Logical)
-        0x09, 0x42,                     //     Usage (Tip Switch)
-        0x15, 0x00,                     //     Logical Minimum (0)
-        0x25, 0x01,                     //     Logical Maximum (1)
-        0x75, 0x01,                     //     Report Size (1)
-        0x95, 0x01,                     //     Report Count (1)
-        0x81, 0x02,                     //     Input (variable,absolute)
-        0x09, 0x51,                     //     Usage (Contact Identifier)
-        0x25, 0x7F,                     //     Logical Maximum (127)
-        0x75, 0x07,                     //     Report Size (7)
-        0x95, 0x01,                     //     Report Count (1)
-        0x81, 0x02,                     //     Input (variable,absolute)
-        0x09, 0x30,                     //     Usage (Pressure)
-        0x26, 0xFF, 0x00,               //     Logical Maximum (255)
-        0x75, 0x08,                     //     Report Size (8)
-        0x95, 0x01,                     //     Report Count (1)
-        0x81, 0x02,                     //     Input (variable,absolute)
-        0x05, 0x01,                     //     Usage Page (Generic Desktop)
-        0x09, 0x30,                     //     Usage (X)
-        0x09, 0x31,                     //     Usage (Y)
-        0x26, 0xFF, 0x7F,               //     Logical Maximum (32767)
-        0x65, 0x00,                     //     Unit (None)  <-- probably needs real units?
-        0x75, 0x10,                     //     Report Size (16)
-        0x95, 0x02,                     //     Report Count (2)
-        0x81, 0x02,                     //     Input (variable,absolute)
-        0xC0,                           //   End Collection
+        MULTITOUCH_CONTACTS_DESC_X(MULTITOUCH_CONTACTS_PER_REPORT)
         0x05, 0x0D,                     //   Usage Page (Digitizer)
         0x27, 0xFF, 0xFF, 0, 0,         //   Logical Maximum (65535)
         0x75, 0x10,                     //   Report Size (16)
@@ -480,10 +605,10 @@ static uint8_t rawhid_report_desc[] = {
         0x75, 0x08,                     //   report size = 8 bits
         0x15, 0x00,                     //   logical minimum = 0
         0x26, 0xFF, 0x00,               //   logical maximum = 255
-        0x95, RAWHID_TX_SIZE,           //   report count
+        0x96, LSB(RAWHID_TX_SIZE), MSB(RAWHID_TX_SIZE), // report count
         0x09, 0x01,                     //   usage
         0x81, 0x02,                     //   Input (array)
-        0x95, RAWHID_RX_SIZE,           //   report count
+        0x96, LSB(RAWHID_RX_SIZE), MSB(RAWHID_RX_SIZE), // report count
         0x09, 0x02,                     //   usage
         0x91, 0x02,                     //   Output (array)
         0xC0                            // end collection
@@ -620,7 +745,32 @@ static uint8_t flightsim_report_desc[] = {
 
 #define AUDIO_INTERFACE_DESC_POS	KEYMEDIA_INTERFACE_DESC_POS+KEYMEDIA_INTERFACE_DESC_SIZE
 #ifdef  AUDIO_INTERFACE
-#define AUDIO_INTERFACE_DESC_SIZE	8 + 9+10+12+9+12+10+9 + 9+9+7+11+9+7 + 9+9+7+11+9+7+9
+// speaker positions for wChannelConfig, USB DCD for Audio Devices 1.0, 3.7.2.3
+#if AUDIO_USB_CHANNELS == 1
+#define AUDIO_CHANNEL_CONFIG		0x0004	// Center Front
+#elif AUDIO_USB_CHANNELS == 2
+#define AUDIO_CHANNEL_CONFIG		0x0003	// Left & Right Front
+#elif AUDIO_USB_CHANNELS == 4
+#define AUDIO_CHANNEL_CONFIG		0x0033	// Left, Right, Left & Right Surround
+#elif AUDIO_USB_CHANNELS == 6
+#define AUDIO_CHANNEL_CONFIG		0x003F	// 5.1
+#elif AUDIO_USB_CHANNELS == 8
+#define AUDIO_CHANNEL_CONFIG		0x063F	// 7.1
+#else
+#define AUDIO_CHANNEL_CONFIG		0x0000	// no spatial positions
+#endif
+#define AUDIO_VOLUME_CONTROLS_1		0x02
+#define AUDIO_VOLUME_CONTROLS_2		AUDIO_VOLUME_CONTROLS_1, 0x02
+#define AUDIO_VOLUME_CONTROLS_3		AUDIO_VOLUME_CONTROLS_2, 0x02
+#define AUDIO_VOLUME_CONTROLS_4		AUDIO_VOLUME_CONTROLS_3, 0x02
+#define AUDIO_VOLUME_CONTROLS_5		AUDIO_VOLUME_CONTROLS_4, 0x02
+#define AUDIO_VOLUME_CONTROLS_6		AUDIO_VOLUME_CONTROLS_5, 0x02
+#define AUDIO_VOLUME_CONTROLS_7		AUDIO_VOLUME_CONTROLS_6, 0x02
+#define AUDIO_VOLUME_CONTROLS_8		AUDIO_VOLUME_CONTROLS_7, 0x02
+#define AUDIO_VOLUME_CONTROLS_N(n)	AUDIO_VOLUME_CONTROLS_##n
+#define AUDIO_VOLUME_CONTROLS_X(n)	AUDIO_VOLUME_CONTROLS_N(n)
+#define AUDIO_VOLUME_CONTROLS		AUDIO_VOLUME_CONTROLS_X(AUDIO_USB_CHANNELS)
+#define AUDIO_INTERFACE_DESC_SIZE	8 + 9+10+12+9+12+(8+AUDIO_USB_CHANNELS)+9 + 9+9+7+11+9+7 + 9+9+7+11+9+7+9
 #else
 #define AUDIO_INTERFACE_DESC_SIZE	0
 #endif
@@ -641,7 +791,35 @@ static uint8_t flightsim_report_desc[] = {
 #define EXPERIMENTAL_INTERFACE_DESC_SIZE 0
 #endif
 
-#define CONFIG_DESC_SIZE		EXPERIMENTAL_INTERFACE_DESC_POS+EXPERIMENTAL_INTERFACE_DESC_SIZE
+#define VENDOR_INTERFACE_DESC_POS	EXPERIMENTAL_INTERFACE_DESC_POS+EXPERIMENTAL_INTERFACE_DESC_SIZE
+#ifdef  VENDOR_INTERFACE
+#define VENDOR_INTERFACE_DESC_SIZE	9+7+7
+#else
+#define VENDOR_INTERFACE_DESC_SIZE	0
+#endif
+
+#define NCM_INTERFACE_DESC_POS		VENDOR_INTERFACE_DESC_POS+VENDOR_INTERFACE_DESC_SIZE
+#ifdef  NCM_STATUS_INTERFACE
+#define NCM_INTERFACE_DESC_SIZE		8+9+5+5+13+6+7+9+9+7+7
+#else
+#define NCM_INTERFACE_DESC_SIZE		0
+#endif
+
+#define VIDEO_INTERFACE_DESC_POS	NCM_INTERFACE_DESC_POS+NCM_INTERFACE_DESC_SIZE
+#ifdef  VIDEO_INTERFACE
+#define VIDEO_INTERFACE_DESC_SIZE	8+9+13+18+9+9+14+27+30+6+9+7
+#else
+#define VIDEO_INTERFACE_DESC_SIZE	0
+#endif
+
+#define CONFIG_DESC_SIZE		VIDEO_INTERFACE_DESC_POS+VIDEO_INTERFACE_DESC_SIZE
+
+// bmAttributes: bit 7 must be set, bit 6 = self powered, bit 5 = remote wakeup
+#ifdef USB_REMOTE_WAKEUP
+#define CONFIG_ATTRIBUTES		0xE0
+#else
+#define CONFIG_ATTRIBUTES		0xC0
+#endif
 
 
 
@@ -661,7 +839,7 @@ PROGMEM const uint8_t usb_config_descriptor_480[CONFIG_DESC_SIZE] = {
         NUM_INTERFACE,                          // bNumInterfaces
         1,                                      // bConfigurationValue
         0,                                      // iConfiguration
-        0xC0,                                   // bmAttributes
+        CONFIG_ATTRIBUTES,                      // bmAttributes
         50,                                     // bMaxPower
 
 #ifdef CDC_IAD_DESCRIPTOR
@@ -1146,7 +1324,7 @@ PROGMEM const uint8_t usb_config_descriptor_480[CONFIG_DESC_SIZE] = {
         5,                                      // bDescriptorType
         KEYBOARD_ENDPOINT | 0x80,               // bEndpointAddress
         0x03,                                   // bmAttributes (0x03=intr)
-        KEYBOARD_SIZE, 0,                       // wMaxPacketSize
+        KEYBOARD_PACKET_SIZE, 0,                // wMaxPacketSize
         KEYBOARD_INTERVAL,                      // bInterval
 #endif // KEYBOARD_INTERFACE
 
@@ -1206,14 +1384,16 @@ PROGMEM const uint8_t usb_config_descriptor_480[CONFIG_DESC_SIZE] = {
         5,                                      // bDescriptorType
         RAWHID_TX_ENDPOINT | 0x80,              // bEndpointAddress
         0x03,                                   // bmAttributes (0x03=intr)
-        RAWHID_TX_SIZE, 0,                      // wMaxPacketSize
+        LSB(RAWHID_TX_SIZE),                    // wMaxPacketSize
+        MSB(RAWHID_TX_SIZE) | ((RAWHID_TX_MULT - 1) << 3),
         RAWHID_TX_INTERVAL,                     // bInterval
         // endpoint descriptor, USB spec 9.6.6, page 269-271, Table 9-13
         7,                                      // bLength
         5,                                      // bDescriptorType
         RAWHID_RX_ENDPOINT,                     // bEndpointAddress
         0x03,                                   // bmAttributes (0x03=intr)
-        RAWHID_RX_SIZE, 0,                      // wMaxPacketSize
+        LSB(RAWHID_RX_SIZE),                    // wMaxPacketSize
+        MSB(RAWHID_RX_SIZE) | ((RAWHID_RX_MULT - 1) << 3),
         RAWHID_RX_INTERVAL,			// bInterval
 #endif // RAWHID_INTERFACE
 
@@ -1414,7 +1594,7 @@ PROGMEM const uint8_t usb_config_descriptor_480[CONFIG_DESC_SIZE] = {
 	0x24,					// bDescriptorType, 0x24 = CS_INTERFACE
 	0x01,					// bDescriptorSubtype, 1 = HEADER
 	0x00, 0x01,				// bcdADC (version 1.0)
-	LSB(62), MSB(62),			// wTotalLength
+	LSB(60+AUDIO_USB_CHANNELS), MSB(60+AUDIO_USB_CHANNELS), // wTotalLength
 	2,					// bInCollection
 	AUDIO_INTERFACE+1,			// baInterfaceNr(1) - Transmit to PC
 	AUDIO_INTERFACE+2,			// baInterfaceNr(2) - Receive from PC
@@ -1428,8 +1608,8 @@ PROGMEM const uint8_t usb_config_descriptor_480[CONFIG_DESC_SIZE] = {
 	//0x03, 0x06,				// wTerminalType, 0x0603 = Line Connector
 	0x02, 0x06,				// wTerminalType, 0x0602 = Digital Audio
 	0,					// bAssocTerminal, 0 = unidirectional
-	2,					// bNrChannels
-	0x03, 0x00,				// wChannelConfig, 0x0003 = Left & Right Front
+	AUDIO_USB_CHANNELS,			// bNrChannels
+	LSB(AUDIO_CHANNEL_CONFIG), MSB(AUDIO_CHANNEL_CONFIG), // wChannelConfig
 	0,					// iChannelNames
 	0, 					// iTerminal
 	// Output Terminal Descriptor
@@ -1450,20 +1630,19 @@ PROGMEM const uint8_t usb_config_descriptor_480[CONFIG_DESC_SIZE] = {
 	3,					// bTerminalID
 	0x01, 0x01,				// wTerminalType, 0x0101 = USB_STREAMING
 	0,					// bAssocTerminal, 0 = unidirectional
-	2,					// bNrChannels
-	0x03, 0x00,				// wChannelConfig, 0x0003 = Left & Right Front
+	AUDIO_USB_CHANNELS,			// bNrChannels
+	LSB(AUDIO_CHANNEL_CONFIG), MSB(AUDIO_CHANNEL_CONFIG), // wChannelConfig
 	0,					// iChannelNames
 	0, 					// iTerminal
 	// Volume feature descriptor
-	10,					// bLength
+	8+AUDIO_USB_CHANNELS,		// bLength
 	0x24, 				// bDescriptorType = CS_INTERFACE
 	0x06, 				// bDescriptorSubType = FEATURE_UNIT
 	0x31, 				// bUnitID
 	0x03, 				// bSourceID (Input Terminal)
-	0x01, 				// bControlSize (each channel is 1 byte, 3 channels)
+	0x01, 				// bControlSize (each channel is 1 byte)
 	0x01, 				// bmaControls(0) Master: Mute
-	0x02, 				// bmaControls(1) Left: Volume
-	0x02, 				// bmaControls(2) Right: Volume
+	AUDIO_VOLUME_CONTROLS,		// bmaControls(1..n) each channel: Volume
 	0x00,				// iFeature
 	// Output Terminal Descriptor
 	// USB DCD for Audio Devices 1.0, Table 4-4, page 40
@@ -1512,18 +1691,18 @@ PROGMEM const uint8_t usb_config_descriptor_480[CONFIG_DESC_SIZE] = {
 	0x24,					// bDescriptorType = CS_INTERFACE
 	2,					// bDescriptorSubtype = FORMAT_TYPE
 	1,					// bFormatType = FORMAT_TYPE_I
-	2,					// bNrChannels = 2
-	2,					// bSubFrameSize = 2 byte
-	16,					// bBitResolution = 16 bits
+	AUDIO_USB_CHANNELS,			// bNrChannels
+	AUDIO_USB_SUBFRAME_SIZE,		// bSubFrameSize
+	AUDIO_USB_RESOLUTION,			// bBitResolution
 	1,					// bSamFreqType = 1 frequency
-	LSB(44100), MSB(44100), 0,		// tSamFreq
+	LSB(AUDIO_USB_SAMPLE_RATE), MSB(AUDIO_USB_SAMPLE_RATE), AUDIO_USB_SAMPLE_RATE >> 16, // tSamFreq
 	// Standard AS Isochronous Audio Data Endpoint Descriptor
 	// USB DCD for Audio Devices 1.0, Section 4.6.1.1, Table 4-20, page 61-62
 	9, 					// bLength
 	5, 					// bDescriptorType, 5 = ENDPOINT_DESCRIPTOR
 	AUDIO_TX_ENDPOINT | 0x80,		// bEndpointAddress
 	0x09, 					// bmAttributes = isochronous, adaptive
-	LSB(AUDIO_TX_SIZE), MSB(AUDIO_TX_SIZE),	// wMaxPacketSize
+	LSB(AUDIO_USB_PACKET_480), MSB(AUDIO_USB_PACKET_480) | ((AUDIO_USB_PACKET_MULT-1) << 3), // wMaxPacketSize
 	4,			 		// bInterval, 4 = every 8 micro-frames
 	0,					// bRefresh
 	0,					// bSynchAddress
@@ -1571,18 +1750,18 @@ PROGMEM const uint8_t usb_config_descriptor_480[CONFIG_DESC_SIZE] = {
 	0x24,					// bDescriptorType = CS_INTERFACE
 	2,					// bDescriptorSubtype = FORMAT_TYPE
 	1,					// bFormatType = FORMAT_TYPE_I
-	2,					// bNrChannels = 2
-	2,					// bSubFrameSize = 2 byte
-	16,					// bBitResolution = 16 bits
+	AUDIO_USB_CHANNELS,			// bNrChannels
+	AUDIO_USB_SUBFRAME_SIZE,		// bSubFrameSize
+	AUDIO_USB_RESOLUTION,			// bBitResolution
 	1,					// bSamFreqType = 1 frequency
-	LSB(44100), MSB(44100), 0,		// tSamFreq
+	LSB(AUDIO_USB_SAMPLE_RATE), MSB(AUDIO_USB_SAMPLE_RATE), AUDIO_USB_SAMPLE_RATE >> 16, // tSamFreq
 	// Standard AS Isochronous Audio Data Endpoint Descriptor
 	// USB DCD for Audio Devices 1.0, Section 4.6.1.1, Table 4-20, page 61-62
 	9, 					// bLength
 	5, 					// bDescriptorType, 5 = ENDPOINT_DESCRIPTOR
 	AUDIO_RX_ENDPOINT,			// bEndpointAddress
 	0x05, 					// bmAttributes = isochronous, asynchronous
-	LSB(AUDIO_RX_SIZE), MSB(AUDIO_RX_SIZE),	// wMaxPacketSize
+	LSB(AUDIO_USB_PACKET_480), MSB(AUDIO_USB_PACKET_480) | ((AUDIO_USB_PACKET_MULT-1) << 3), // wMaxPacketSize
 	4,			 		// bInterval, 4 = every 8 micro-frames
 	0,					// bRefresh
 	AUDIO_SYNC_ENDPOINT | 0x80,		// bSynchAddress
@@ -1632,7 +1811,7 @@ PROGMEM const uint8_t usb_config_descriptor_480[CONFIG_DESC_SIZE] = {
         5,                                      // bDescriptorType
         MULTITOUCH_ENDPOINT | 0x80,             // bEndpointAddress
         0x03,                                   // bmAttributes (0x03=intr)
-        MULTITOUCH_SIZE, 0,                     // wMaxPacketSize
+        MULTITOUCH_REPORT_SIZE, 0,              // wMaxPacketSize
         4,                                      // bInterval, 4 = 1ms
 #endif // MULTITOUCH_INTERFACE
 
@@ -1663,6 +1842,266 @@ PROGMEM const uint8_t usb_config_descriptor_480[CONFIG_DESC_SIZE] = {
         LSB(512), MSB(512),                     // wMaxPacketSize
         1,                                      // bInterval
 #endif // EXPERIMENTAL_INTERFACE
+#ifdef VENDOR_INTERFACE
+        // interface descriptor, USB spec 9.6.5, page 267-269, Table 9-12
+        9,                                      // bLength
+        4,                                      // bDescriptorType
+        VENDOR_INTERFACE,                       // bInterfaceNumber
+        0,                                      // bAlternateSetting
+        2,                                      // bNumEndpoints
+        0xFF,                                   // bInterfaceClass (0xFF = Vendor)
+        0x00,                                   // bInterfaceSubClass
+        0x00,                                   // bInterfaceProtocol
+        0,                                      // iInterface
+        // endpoint descriptor, USB spec 9.6.6, page 269-271, Table 9-13
+        7,                                      // bLength
+        5,                                      // bDescriptorType
+        VENDOR_TX_ENDPOINT | 0x80,              // bEndpointAddress
+        0x02,                                   // bmAttributes (0x02=bulk)
+        LSB(VENDOR_TX_SIZE_480), MSB(VENDOR_TX_SIZE_480),   // wMaxPacketSize
+        0,                                      // bInterval
+        // endpoint descriptor, USB spec 9.6.6, page 269-271, Table 9-13
+        7,                                      // bLength
+        5,                                      // bDescriptorType
+        VENDOR_RX_ENDPOINT,                     // bEndpointAddress
+        0x02,                                   // bmAttributes (0x02=bulk)
+        LSB(VENDOR_RX_SIZE_480), MSB(VENDOR_RX_SIZE_480),   // wMaxPacketSize
+        0,                                      // bInterval
+#endif // VENDOR_INTERFACE
+#ifdef NCM_STATUS_INTERFACE
+        // interface association descriptor, USB ECN, Table 9-Z
+        8,                                      // bLength
+        11,                                     // bDescriptorType
+        NCM_STATUS_INTERFACE,                   // bFirstInterface
+        2,                                      // bInterfaceCount
+        0x02,                                   // bFunctionClass
+        0x0D,                                   // bFunctionSubClass (0x0D = NCM)
+        0x00,                                   // bFunctionProtocol
+        0,                                      // iFunction
+        // communication interface descriptor, USB spec 9.6.5, page 267-269, Table 9-12
+        9,                                      // bLength
+        4,                                      // bDescriptorType
+        NCM_STATUS_INTERFACE,                   // bInterfaceNumber
+        0,                                      // bAlternateSetting
+        1,                                      // bNumEndpoints
+        0x02,                                   // bInterfaceClass
+        0x0D,                                   // bInterfaceSubClass (0x0D = NCM)
+        0x00,                                   // bInterfaceProtocol
+        0,                                      // iInterface
+        // CDC Header Functional Descriptor, CDC Spec 5.2.3.1, Table 26
+        5,                                      // bFunctionLength
+        0x24,                                   // bDescriptorType
+        0x00,                                   // bDescriptorSubtype
+        0x10, 0x01,                             // bcdCDC
+        // Union Functional Descriptor, CDC Spec 5.2.3.8, Table 33
+        5,                                      // bFunctionLength
+        0x24,                                   // bDescriptorType
+        0x06,                                   // bDescriptorSubtype
+        NCM_STATUS_INTERFACE,                   // bMasterInterface
+        NCM_DATA_INTERFACE,                     // bSlaveInterface0
+        // Ethernet Networking Functional Descriptor, ECM Spec 5.4, Table 3
+        13,                                     // bFunctionLength
+        0x24,                                   // bDescriptorType
+        0x0F,                                   // bDescriptorSubtype
+        NCM_MAC_STRING,                         // iMACAddress
+        0, 0, 0, 0,                             // bmEthernetStatistics
+        LSB(NCM_MAX_SEGMENT_SIZE),              // wMaxSegmentSize
+        MSB(NCM_MAX_SEGMENT_SIZE),
+        0, 0,                                   // wNumberMCFilters
+        0,                                      // bNumberPowerFilters
+        // NCM Functional Descriptor, NCM Spec 5.2.1, Table 5-2
+        6,                                      // bFunctionLength
+        0x24,                                   // bDescriptorType
+        0x1A,                                   // bDescriptorSubtype
+        0x00, 0x01,                             // bcdNcmVersion
+        0,                                      // bmNetworkCapabilities
+        // endpoint descriptor, USB spec 9.6.6, page 269-271, Table 9-13
+        7,                                      // bLength
+        5,                                      // bDescriptorType
+        NCM_NOTIFY_ENDPOINT | 0x80,             // bEndpointAddress
+        0x03,                                   // bmAttributes (0x03=intr)
+        NCM_NOTIFY_SIZE, 0,                     // wMaxPacketSize
+        5,                                      // bInterval, 5 = 2 ms
+        // data interface, alternate 0 has no endpoints, NCM Spec 5.3
+        9,                                      // bLength
+        4,                                      // bDescriptorType
+        NCM_DATA_INTERFACE,                     // bInterfaceNumber
+        0,                                      // bAlternateSetting
+        0,                                      // bNumEndpoints
+        0x0A,                                   // bInterfaceClass
+        0x00,                                   // bInterfaceSubClass
+        0x01,                                   // bInterfaceProtocol (0x01 = NCM data)
+        0,                                      // iInterface
+        // data interface, alternate 1 moves the network data
+        9,                                      // bLength
+        4,                                      // bDescriptorType
+        NCM_DATA_INTERFACE,                     // bInterfaceNumber
+        1,                                      // bAlternateSetting
+        2,                                      // bNumEndpoints
+        0x0A,                                   // bInterfaceClass
+        0x00,                                   // bInterfaceSubClass
+        0x01,                                   // bInterfaceProtocol (0x01 = NCM data)
+        0,                                      // iInterface
+        // endpoint descriptor, USB spec 9.6.6, page 269-271, Table 9-13
+        7,                                      // bLength
+        5,                                      // bDescriptorType
+        NCM_TX_ENDPOINT | 0x80,                 // bEndpointAddress
+        0x02,                                   // bmAttributes (0x02=bulk)
+        LSB(NCM_TX_SIZE_480), MSB(NCM_TX_SIZE_480),  // wMaxPacketSize
+        0,                                      // bInterval
+        // endpoint descriptor, USB spec 9.6.6, page 269-271, Table 9-13
+        7,                                      // bLength
+        5,                                      // bDescriptorType
+        NCM_RX_ENDPOINT,                        // bEndpointAddress
+        0x02,                                   // bmAttributes (0x02=bulk)
+        LSB(NCM_RX_SIZE_480), MSB(NCM_RX_SIZE_480),  // wMaxPacketSize
+        0,                                      // bInterval
+#endif // NCM_STATUS_INTERFACE
+#ifdef VIDEO_INTERFACE
+        // interface association descriptor, USB ECN, Table 9-Z
+        8,                                      // bLength
+        11,                                     // bDescriptorType
+        VIDEO_INTERFACE,                        // bFirstInterface
+        2,                                      // bInterfaceCount
+        0x0E,                                   // bFunctionClass (0x0E = Video)
+        0x03,                                   // bFunctionSubClass (0x03 = Interface Collection)
+        0x00,                                   // bFunctionProtocol
+        0,                                      // iFunction
+        // Standard VC Interface Descriptor, UVC 1.0, 3.7.1, Table 3-1
+        9,                                      // bLength
+        4,                                      // bDescriptorType
+        VIDEO_INTERFACE,                        // bInterfaceNumber
+        0,                                      // bAlternateSetting
+        0,                                      // bNumEndpoints
+        0x0E,                                   // bInterfaceClass (0x0E = Video)
+        0x01,                                   // bInterfaceSubClass (0x01 = Control)
+        0x00,                                   // bInterfaceProtocol
+        0,                                      // iInterface
+        // Class-specific VC Interface Header Descriptor, UVC 1.0, 3.7.2, Table 3-3
+        13,                                     // bLength
+        0x24,                                   // bDescriptorType = CS_INTERFACE
+        0x01,                                   // bDescriptorSubtype = VC_HEADER
+        0x00, 0x01,                             // bcdUVC = 1.00
+        LSB(13+18+9), MSB(13+18+9),             // wTotalLength
+        0x00, 0x6C, 0xDC, 0x02,                 // dwClockFrequency = 48 MHz
+        1,                                      // bInCollection
+        VIDEO_INTERFACE+1,                      // baInterfaceNr
+        // Camera Terminal Descriptor, UVC 1.0, 3.7.2.3, Table 3-6
+        18,                                     // bLength
+        0x24,                                   // bDescriptorType = CS_INTERFACE
+        0x02,                                   // bDescriptorSubtype = VC_INPUT_TERMINAL
+        1,                                      // bTerminalID
+        0x01, 0x02,                             // wTerminalType = ITT_CAMERA
+        0,                                      // bAssocTerminal
+        0,                                      // iTerminal
+        0, 0,                                   // wObjectiveFocalLengthMin
+        0, 0,                                   // wObjectiveFocalLengthMax
+        0, 0,                                   // wOcularFocalLength
+        3,                                      // bControlSize
+        0, 0, 0,                                // bmControls, none
+        // Output Terminal Descriptor, UVC 1.0, 3.7.2.2, Table 3-5
+        9,                                      // bLength
+        0x24,                                   // bDescriptorType = CS_INTERFACE
+        0x03,                                   // bDescriptorSubtype = VC_OUTPUT_TERMINAL
+        2,                                      // bTerminalID
+        0x01, 0x01,                             // wTerminalType = TT_STREAMING
+        0,                                      // bAssocTerminal
+        1,                                      // bSourceID
+        0,                                      // iTerminal
+        // Standard VS Interface Descriptor, UVC 1.0, 3.9.1, Table 3-13
+        // alternate 0 has no bandwidth, for when the host isn't streaming
+        9,                                      // bLength
+        4,                                      // bDescriptorType
+        VIDEO_INTERFACE+1,                      // bInterfaceNumber
+        0,                                      // bAlternateSetting
+        0,                                      // bNumEndpoints
+        0x0E,                                   // bInterfaceClass (0x0E = Video)
+        0x02,                                   // bInterfaceSubClass (0x02 = Streaming)
+        0x00,                                   // bInterfaceProtocol
+        0,                                      // iInterface
+        // Class-specific VS Input Header Descriptor, UVC 1.0, 3.9.2.1, Table 3-14
+        14,                                     // bLength
+        0x24,                                   // bDescriptorType = CS_INTERFACE
+        0x01,                                   // bDescriptorSubtype = VS_INPUT_HEADER
+        1,                                      // bNumFormats
+        LSB(14+27+30+6), MSB(14+27+30+6),       // wTotalLength
+        VIDEO_TX_ENDPOINT | 0x80,               // bEndpointAddress
+        0,                                      // bmInfo
+        2,                                      // bTerminalLink
+        0,                                      // bStillCaptureMethod
+        0,                                      // bTriggerSupport
+        0,                                      // bTriggerUsage
+        1,                                      // bControlSize
+        0,                                      // bmaControls
+        // Uncompressed Video Format Descriptor, UVC Payload Uncompressed 1.0, 3.1.1, Table 3-1
+        27,                                     // bLength
+        0x24,                                   // bDescriptorType = CS_INTERFACE
+        0x04,                                   // bDescriptorSubtype = VS_FORMAT_UNCOMPRESSED
+        1,                                      // bFormatIndex
+        1,                                      // bNumFrameDescriptors
+        'Y', 'U', 'Y', '2', 0x00, 0x00, 0x10, 0x00, // guidFormat = YUY2
+        0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71,
+        16,                                     // bBitsPerPixel
+        1,                                      // bDefaultFrameIndex
+        0,                                      // bAspectRatioX
+        0,                                      // bAspectRatioY
+        0,                                      // bmInterlaceFlags
+        0,                                      // bCopyProtect
+        // Uncompressed Video Frame Descriptor, UVC Payload Uncompressed 1.0, 3.1.2, Table 3-2
+        30,                                     // bLength
+        0x24,                                   // bDescriptorType = CS_INTERFACE
+        0x05,                                   // bDescriptorSubtype = VS_FRAME_UNCOMPRESSED
+        1,                                      // bFrameIndex
+        0,                                      // bmCapabilities
+        LSB(VIDEO_WIDTH), MSB(VIDEO_WIDTH),     // wWidth
+        LSB(VIDEO_HEIGHT), MSB(VIDEO_HEIGHT),   // wHeight
+        LSB((uint32_t)VIDEO_FRAME_SIZE * 8 * VIDEO_FPS), // dwMinBitRate
+        (((uint32_t)VIDEO_FRAME_SIZE * 8 * VIDEO_FPS) >> 8) & 255,
+        (((uint32_t)VIDEO_FRAME_SIZE * 8 * VIDEO_FPS) >> 16) & 255,
+        (((uint32_t)VIDEO_FRAME_SIZE * 8 * VIDEO_FPS) >> 24) & 255,
+        LSB(VIDEO_PACKET_SIZE_480 * VIDEO_PACKET_MULT * 8000 * 8), // dwMaxBitRate
+        ((VIDEO_PACKET_SIZE_480 * VIDEO_PACKET_MULT * 8000 * 8) >> 8) & 255,
+        ((VIDEO_PACKET_SIZE_480 * VIDEO_PACKET_MULT * 8000 * 8) >> 16) & 255,
+        ((VIDEO_PACKET_SIZE_480 * VIDEO_PACKET_MULT * 8000 * 8) >> 24) & 255,
+        LSB(VIDEO_FRAME_SIZE),                  // dwMaxVideoFrameBufferSize
+        (VIDEO_FRAME_SIZE >> 8) & 255,
+        (VIDEO_FRAME_SIZE >> 16) & 255,
+        (VIDEO_FRAME_SIZE >> 24) & 255,
+        LSB(VIDEO_FRAME_INTERVAL),              // dwDefaultFrameInterval
+        (VIDEO_FRAME_INTERVAL >> 8) & 255,
+        (VIDEO_FRAME_INTERVAL >> 16) & 255,
+        (VIDEO_FRAME_INTERVAL >> 24) & 255,
+        1,                                      // bFrameIntervalType, 1 discrete rate
+        LSB(VIDEO_FRAME_INTERVAL),              // dwFrameInterval
+        (VIDEO_FRAME_INTERVAL >> 8) & 255,
+        (VIDEO_FRAME_INTERVAL >> 16) & 255,
+        (VIDEO_FRAME_INTERVAL >> 24) & 255,
+        // Color Matching Descriptor, UVC 1.0, 3.9.2.6, Table 3-19
+        6,                                      // bLength
+        0x24,                                   // bDescriptorType = CS_INTERFACE
+        0x0D,                                   // bDescriptorSubtype = VS_COLORFORMAT
+        1,                                      // bColorPrimaries = BT.709, sRGB
+        1,                                      // bTransferCharacteristics = BT.709
+        4,                                      // bMatrixCoefficients = SMPTE 170M
+        // Standard VS Interface Descriptor, UVC 1.0, 3.9.1, Table 3-13
+        // alternate 1 streams, with the isochronous endpoint
+        9,                                      // bLength
+        4,                                      // bDescriptorType
+        VIDEO_INTERFACE+1,                      // bInterfaceNumber
+        1,                                      // bAlternateSetting
+        1,                                      // bNumEndpoints
+        0x0E,                                   // bInterfaceClass (0x0E = Video)
+        0x02,                                   // bInterfaceSubClass (0x02 = Streaming)
+        0x00,                                   // bInterfaceProtocol
+        0,                                      // iInterface
+        // Standard VS Isochronous Video Data Endpoint Descriptor, UVC 1.0, 3.10.1.1, Table 3-21
+        7,                                      // bLength
+        5,                                      // bDescriptorType
+        VIDEO_TX_ENDPOINT | 0x80,               // bEndpointAddress
+        0x05,                                   // bmAttributes = isochronous, asynchronous
+        LSB(VIDEO_PACKET_SIZE_480), MSB(VIDEO_PACKET_SIZE_480) | ((VIDEO_PACKET_MULT-1) << 3), // wMaxPacketSize
+        1,                                      // bInterval, 1 = every microframe
+#endif // VIDEO_INTERFACE
 };
 
 
@@ -1675,7 +2114,7 @@ PROGMEM const uint8_t usb_config_descriptor_12[CONFIG_DESC_SIZE] = {
         NUM_INTERFACE,                          // bNumInterfaces
         1,                                      // bConfigurationValue
         0,                                      // iConfiguration
-        0xC0,                                   // bmAttributes
+        CONFIG_ATTRIBUTES,                      // bmAttributes
         50,                                     // bMaxPower
 
 #ifdef CDC_IAD_DESCRIPTOR
@@ -2160,7 +2599,7 @@ PROGMEM const uint8_t usb_config_descriptor_12[CONFIG_DESC_SIZE] = {
         5,                                      // bDescriptorType
         KEYBOARD_ENDPOINT | 0x80,               // bEndpointAddress
         0x03,                                   // bmAttributes (0x03=intr)
-        KEYBOARD_SIZE, 0,                       // wMaxPacketSize
+        KEYBOARD_PACKET_SIZE, 0,                // wMaxPacketSize
         KEYBOARD_INTERVAL,                      // bInterval
 #endif // KEYBOARD_INTERFACE
 
@@ -2220,14 +2659,14 @@ PROGMEM const uint8_t usb_config_descriptor_12[CONFIG_DESC_SIZE] = {
         5,                                      // bDescriptorType
         RAWHID_TX_ENDPOINT | 0x80,              // bEndpointAddress
         0x03,                                   // bmAttributes (0x03=intr)
-        RAWHID_TX_SIZE, 0,                      // wMaxPacketSize
+        RAWHID_TX_PACKET_12, 0,                 // wMaxPacketSize
         RAWHID_TX_INTERVAL,                     // bInterval
         // endpoint descriptor, USB spec 9.6.6, page 269-271, Table 9-13
         7,                                      // bLength
         5,                                      // bDescriptorType
         RAWHID_RX_ENDPOINT,                     // bEndpointAddress
         0x03,                                   // bmAttributes (0x03=intr)
-        RAWHID_RX_SIZE, 0,                      // wMaxPacketSize
+        RAWHID_RX_PACKET_12, 0,                 // wMaxPacketSize
         RAWHID_RX_INTERVAL,			// bInterval
 #endif // RAWHID_INTERFACE
 
@@ -2428,7 +2867,7 @@ PROGMEM const uint8_t usb_config_descriptor_12[CONFIG_DESC_SIZE] = {
 	0x24,					// bDescriptorType, 0x24 = CS_INTERFACE
 	0x01,					// bDescriptorSubtype, 1 = HEADER
 	0x00, 0x01,				// bcdADC (version 1.0)
-	LSB(62), MSB(62),			// wTotalLength
+	LSB(60+AUDIO_USB_CHANNELS), MSB(60+AUDIO_USB_CHANNELS), // wTotalLength
 	2,					// bInCollection
 	AUDIO_INTERFACE+1,			// baInterfaceNr(1) - Transmit to PC
 	AUDIO_INTERFACE+2,			// baInterfaceNr(2) - Receive from PC
@@ -2442,8 +2881,8 @@ PROGMEM const uint8_t usb_config_descriptor_12[CONFIG_DESC_SIZE] = {
 	//0x03, 0x06,				// wTerminalType, 0x0603 = Line Connector
 	0x02, 0x06,				// wTerminalType, 0x0602 = Digital Audio
 	0,					// bAssocTerminal, 0 = unidirectional
-	2,					// bNrChannels
-	0x03, 0x00,				// wChannelConfig, 0x0003 = Left & Right Front
+	AUDIO_USB_CHANNELS,			// bNrChannels
+	LSB(AUDIO_CHANNEL_CONFIG), MSB(AUDIO_CHANNEL_CONFIG), // wChannelConfig
 	0,					// iChannelNames
 	0, 					// iTerminal
 	// Output Terminal Descriptor
@@ -2464,20 +2903,19 @@ PROGMEM const uint8_t usb_config_descriptor_12[CONFIG_DESC_SIZE] = {
 	3,					// bTerminalID
 	0x01, 0x01,				// wTerminalType, 0x0101 = USB_STREAMING
 	0,					// bAssocTerminal, 0 = unidirectional
-	2,					// bNrChannels
-	0x03, 0x00,				// wChannelConfig, 0x0003 = Left & Right Front
+	AUDIO_USB_CHANNELS,			// bNrChannels
+	LSB(AUDIO_CHANNEL_CONFIG), MSB(AUDIO_CHANNEL_CONFIG), // wChannelConfig
 	0,					// iChannelNames
 	0, 					// iTerminal
 	// Volume feature descriptor
-	10,					// bLength
+	8+AUDIO_USB_CHANNELS,		// bLength
 	0x24, 				// bDescriptorType = CS_INTERFACE
 	0x06, 				// bDescriptorSubType = FEATURE_UNIT
 	0x31, 				// bUnitID
 	0x03, 				// bSourceID (Input Terminal)
-	0x01, 				// bControlSize (each channel is 1 byte, 3 channels)
+	0x01, 				// bControlSize (each channel is 1 byte)
 	0x01, 				// bmaControls(0) Master: Mute
-	0x02, 				// bmaControls(1) Left: Volume
-	0x02, 				// bmaControls(2) Right: Volume
+	AUDIO_VOLUME_CONTROLS,		// bmaControls(1..n) each channel: Volume
 	0x00,				// iFeature
 	// Output Terminal Descriptor
 	// USB DCD for Audio Devices 1.0, Table 4-4, page 40
@@ -2526,18 +2964,18 @@ PROGMEM const uint8_t usb_config_descriptor_12[CONFIG_DESC_SIZE] = {
 	0x24,					// bDescriptorType = CS_INTERFACE
 	2,					// bDescriptorSubtype = FORMAT_TYPE
 	1,					// bFormatType = FORMAT_TYPE_I
-	2,					// bNrChannels = 2
-	2,					// bSubFrameSize = 2 byte
-	16,					// bBitResolution = 16 bits
+	AUDIO_USB_CHANNELS,			// bNrChannels
+	AUDIO_USB_SUBFRAME_SIZE,		// bSubFrameSize
+	AUDIO_USB_RESOLUTION,			// bBitResolution
 	1,					// bSamFreqType = 1 frequency
-	LSB(44100), MSB(44100), 0,		// tSamFreq
+	LSB(AUDIO_USB_SAMPLE_RATE), MSB(AUDIO_USB_SAMPLE_RATE), AUDIO_USB_SAMPLE_RATE >> 16, // tSamFreq
 	// Standard AS Isochronous Audio Data Endpoint Descriptor
 	// USB DCD for Audio Devices 1.0, Section 4.6.1.1, Table 4-20, page 61-62
 	9, 					// bLength
 	5, 					// bDescriptorType, 5 = ENDPOINT_DESCRIPTOR
 	AUDIO_TX_ENDPOINT | 0x80,		// bEndpointAddress
 	0x09, 					// bmAttributes = isochronous, adaptive
-	LSB(AUDIO_TX_SIZE), MSB(AUDIO_TX_SIZE),	// wMaxPacketSize
+	LSB(AUDIO_USB_PACKET_12), MSB(AUDIO_USB_PACKET_12),	// wMaxPacketSize
 	1,			 		// bInterval, 1 = every frame
 	0,					// bRefresh
 	0,					// bSynchAddress
@@ -2585,18 +3023,18 @@ PROGMEM const uint8_t usb_config_descriptor_12[CONFIG_DESC_SIZE] = {
 	0x24,					// bDescriptorType = CS_INTERFACE
 	2,					// bDescriptorSubtype = FORMAT_TYPE
 	1,					// bFormatType = FORMAT_TYPE_I
-	2,					// bNrChannels = 2
-	2,					// bSubFrameSize = 2 byte
-	16,					// bBitResolution = 16 bits
+	AUDIO_USB_CHANNELS,			// bNrChannels
+	AUDIO_USB_SUBFRAME_SIZE,		// bSubFrameSize
+	AUDIO_USB_RESOLUTION,			// bBitResolution
 	1,					// bSamFreqType = 1 frequency
-	LSB(44100), MSB(44100), 0,		// tSamFreq
+	LSB(AUDIO_USB_SAMPLE_RATE), MSB(AUDIO_USB_SAMPLE_RATE), AUDIO_USB_SAMPLE_RATE >> 16, // tSamFreq
 	// Standard AS Isochronous Audio Data Endpoint Descriptor
 	// USB DCD for Audio Devices 1.0, Section 4.6.1.1, Table 4-20, page 61-62
 	9, 					// bLength
 	5, 					// bDescriptorType, 5 = ENDPOINT_DESCRIPTOR
 	AUDIO_RX_ENDPOINT,			// bEndpointAddress
 	0x05, 					// bmAttributes = isochronous, asynchronous
-	LSB(AUDIO_RX_SIZE), MSB(AUDIO_RX_SIZE),	// wMaxPacketSize
+	LSB(AUDIO_USB_PACKET_12), MSB(AUDIO_USB_PACKET_12),	// wMaxPacketSize
 	1,			 		// bInterval, 1 = every frame
 	0,					// bRefresh
 	AUDIO_SYNC_ENDPOINT | 0x80,		// bSynchAddress
@@ -2646,7 +3084,7 @@ PROGMEM const uint8_t usb_config_descriptor_12[CONFIG_DESC_SIZE] = {
         5,                                      // bDescriptorType
         MULTITOUCH_ENDPOINT | 0x80,             // bEndpointAddress
         0x03,                                   // bmAttributes (0x03=intr)
-        MULTITOUCH_SIZE, 0,                     // wMaxPacketSize
+        MULTITOUCH_REPORT_SIZE, 0,              // wMaxPacketSize
         1,                                      // bInterval
 #endif // MULTITOUCH_INTERFACE
 
@@ -2677,11 +3115,275 @@ PROGMEM const uint8_t usb_config_descriptor_12[CONFIG_DESC_SIZE] = {
         LSB(64), MSB(64),                       // wMaxPacketSize
         1,                                      // bInterval
 #endif // EXPERIMENTAL_INTERFACE
+#ifdef VENDOR_INTERFACE
+        // interface descriptor, USB spec 9.6.5, page 267-269, Table 9-12
+        9,                                      // bLength
+        4,                                      // bDescriptorType
+        VENDOR_INTERFACE,                       // bInterfaceNumber
+        0,                                      // bAlternateSetting
+        2,                                      // bNumEndpoints
+        0xFF,                                   // bInterfaceClass (0xFF = Vendor)
+        0x00,                                   // bInterfaceSubClass
+        0x00,                                   // bInterfaceProtocol
+        0,                                      // iInterface
+        // endpoint descriptor, USB spec 9.6.6, page 269-271, Table 9-13
+        7,                                      // bLength
+        5,                                      // bDescriptorType
+        VENDOR_TX_ENDPOINT | 0x80,              // bEndpointAddress
+        0x02,                                   // bmAttributes (0x02=bulk)
+        LSB(VENDOR_TX_SIZE_12), MSB(VENDOR_TX_SIZE_12),   // wMaxPacketSize
+        0,                                      // bInterval
+        // endpoint descriptor, USB spec 9.6.6, page 269-271, Table 9-13
+        7,                                      // bLength
+        5,                                      // bDescriptorType
+        VENDOR_RX_ENDPOINT,                     // bEndpointAddress
+        0x02,                                   // bmAttributes (0x02=bulk)
+        LSB(VENDOR_RX_SIZE_12), MSB(VENDOR_RX_SIZE_12),   // wMaxPacketSize
+        0,                                      // bInterval
+#endif // VENDOR_INTERFACE
+#ifdef NCM_STATUS_INTERFACE
+        // interface association descriptor, USB ECN, Table 9-Z
+        8,                                      // bLength
+        11,                                     // bDescriptorType
+        NCM_STATUS_INTERFACE,                   // bFirstInterface
+        2,                                      // bInterfaceCount
+        0x02,                                   // bFunctionClass
+        0x0D,                                   // bFunctionSubClass (0x0D = NCM)
+        0x00,                                   // bFunctionProtocol
+        0,                                      // iFunction
+        // communication interface descriptor, USB spec 9.6.5, page 267-269, Table 9-12
+        9,                                      // bLength
+        4,                                      // bDescriptorType
+        NCM_STATUS_INTERFACE,                   // bInterfaceNumber
+        0,                                      // bAlternateSetting
+        1,                                      // bNumEndpoints
+        0x02,                                   // bInterfaceClass
+        0x0D,                                   // bInterfaceSubClass (0x0D = NCM)
+        0x00,                                   // bInterfaceProtocol
+        0,                                      // iInterface
+        // CDC Header Functional Descriptor, CDC Spec 5.2.3.1, Table 26
+        5,                                      // bFunctionLength
+        0x24,                                   // bDescriptorType
+        0x00,                                   // bDescriptorSubtype
+        0x10, 0x01,                             // bcdCDC
+        // Union Functional Descriptor, CDC Spec 5.2.3.8, Table 33
+        5,                                      // bFunctionLength
+        0x24,                                   // bDescriptorType
+        0x06,                                   // bDescriptorSubtype
+        NCM_STATUS_INTERFACE,                   // bMasterInterface
+        NCM_DATA_INTERFACE,                     // bSlaveInterface0
+        // Ethernet Networking Functional Descriptor, ECM Spec 5.4, Table 3
+        13,                                     // bFunctionLength
+        0x24,                                   // bDescriptorType
+        0x0F,                                   // bDescriptorSubtype
+        NCM_MAC_STRING,                         // iMACAddress
+        0, 0, 0, 0,                             // bmEthernetStatistics
+        LSB(NCM_MAX_SEGMENT_SIZE),              // wMaxSegmentSize
+        MSB(NCM_MAX_SEGMENT_SIZE),
+        0, 0,                                   // wNumberMCFilters
+        0,                                      // bNumberPowerFilters
+        // NCM Functional Descriptor, NCM Spec 5.2.1, Table 5-2
+        6,                                      // bFunctionLength
+        0x24,                                   // bDescriptorType
+        0x1A,                                   // bDescriptorSubtype
+        0x00, 0x01,                             // bcdNcmVersion
+        0,                                      // bmNetworkCapabilities
+        // endpoint descriptor, USB spec 9.6.6, page 269-271, Table 9-13
+        7,                                      // bLength
+        5,                                      // bDescriptorType
+        NCM_NOTIFY_ENDPOINT | 0x80,             // bEndpointAddress
+        0x03,                                   // bmAttributes (0x03=intr)
+        NCM_NOTIFY_SIZE, 0,                     // wMaxPacketSize
+        2,                                      // bInterval, 2 ms
+        // data interface, alternate 0 has no endpoints, NCM Spec 5.3
+        9,                                      // bLength
+        4,                                      // bDescriptorType
+        NCM_DATA_INTERFACE,                     // bInterfaceNumber
+        0,                                      // bAlternateSetting
+        0,                                      // bNumEndpoints
+        0x0A,                                   // bInterfaceClass
+        0x00,                                   // bInterfaceSubClass
+        0x01,                                   // bInterfaceProtocol (0x01 = NCM data)
+        0,                                      // iInterface
+        // data interface, alternate 1 moves the network data
+        9,                                      // bLength
+        4,                                      // bDescriptorType
+        NCM_DATA_INTERFACE,                     // bInterfaceNumber
+        1,                                      // bAlternateSetting
+        2,                                      // bNumEndpoints
+        0x0A,                                   // bInterfaceClass
+        0x00,                                   // bInterfaceSubClass
+        0x01,                                   // bInterfaceProtocol (0x01 = NCM data)
+        0,                                      // iInterface
+        // endpoint descriptor, USB spec 9.6.6, page 269-271, Table 9-13
+        7,                                      // bLength
+        5,                                      // bDescriptorType
+        NCM_TX_ENDPOINT | 0x80,                 // bEndpointAddress
+        0x02,                                   // bmAttributes (0x02=bulk)
+        NCM_TX_SIZE_12, 0,                       // wMaxPacketSize
+        0,                                      // bInterval
+        // endpoint descriptor, USB spec 9.6.6, page 269-271, Table 9-13
+        7,                                      // bLength
+        5,                                      // bDescriptorType
+        NCM_RX_ENDPOINT,                        // bEndpointAddress
+        0x02,                                   // bmAttributes (0x02=bulk)
+        NCM_RX_SIZE_12, 0,                       // wMaxPacketSize
+        0,                                      // bInterval
+#endif // NCM_STATUS_INTERFACE
+#ifdef VIDEO_INTERFACE
+        // interface association descriptor, USB ECN, Table 9-Z
+        8,                                      // bLength
+        11,                                     // bDescriptorType
+        VIDEO_INTERFACE,                        // bFirstInterface
+        2,                                      // bInterfaceCount
+        0x0E,                                   // bFunctionClass (0x0E = Video)
+        0x03,                                   // bFunctionSubClass (0x03 = Interface Collection)
+        0x00,                                   // bFunctionProtocol
+        0,                                      // iFunction
+        // Standard VC Interface Descriptor, UVC 1.0, 3.7.1, Table 3-1
+        9,                                      // bLength
+        4,                                      // bDescriptorType
+        VIDEO_INTERFACE,                        // bInterfaceNumber
+        0,                                      // bAlternateSetting
+        0,                                      // bNumEndpoints
+        0x0E,                                   // bInterfaceClass (0x0E = Video)
+        0x01,                                   // bInterfaceSubClass (0x01 = Control)
+        0x00,                                   // bInterfaceProtocol
+        0,                                      // iInterface
+        // Class-specific VC Interface Header Descriptor, UVC 1.0, 3.7.2, Table 3-3
+        13,                                     // bLength
+        0x24,                                   // bDescriptorType = CS_INTERFACE
+        0x01,                                   // bDescriptorSubtype = VC_HEADER
+        0x00, 0x01,                             // bcdUVC = 1.00
+        LSB(13+18+9), MSB(13+18+9),             // wTotalLength
+        0x00, 0x6C, 0xDC, 0x02,                 // dwClockFrequency = 48 MHz
+        1,                                      // bInCollection
+        VIDEO_INTERFACE+1,                      // baInterfaceNr
+        // Camera Terminal Descriptor, UVC 1.0, 3.7.2.3, Table 3-6
+        18,                                     // bLength
+        0x24,                                   // bDescriptorType = CS_INTERFACE
+        0x02,                                   // bDescriptorSubtype = VC_INPUT_TERMINAL
+        1,                                      // bTerminalID
+        0x01, 0x02,                             // wTerminalType = ITT_CAMERA
+        0,                                      // bAssocTerminal
+        0,                                      // iTerminal
+        0, 0,                                   // wObjectiveFocalLengthMin
+        0, 0,                                   // wObjectiveFocalLengthMax
+        0, 0,                                   // wOcularFocalLength
+        3,                                      // bControlSize
+        0, 0, 0,                                // bmControls, none
+        // Output Terminal Descriptor, UVC 1.0, 3.7.2.2, Table 3-5
+        9,                                      // bLength
+        0x24,                                   // bDescriptorType = CS_INTERFACE
+        0x03,                                   // bDescriptorSubtype = VC_OUTPUT_TERMINAL
+        2,                                      // bTerminalID
+        0x01, 0x01,                             // wTerminalType = TT_STREAMING
+        0,                                      // bAssocTerminal
+        1,                                      // bSourceID
+        0,                                      // iTerminal
+        // Standard VS Interface Descriptor, UVC 1.0, 3.9.1, Table 3-13
+        // alternate 0 has no bandwidth, for when the host isn't streaming
+        9,                                      // bLength
+        4,                                      // bDescriptorType
+        VIDEO_INTERFACE+1,                      // bInterfaceNumber
+        0,                                      // bAlternateSetting
+        0,                                      // bNumEndpoints
+        0x0E,                                   // bInterfaceClass (0x0E = Video)
+        0x02,                                   // bInterfaceSubClass (0x02 = Streaming)
+        0x00,                                   // bInterfaceProtocol
+        0,                                      // iInterface
+        // Class-specific VS Input Header Descriptor, UVC 1.0, 3.9.2.1, Table 3-14
+        14,                                     // bLength
+        0x24,                                   // bDescriptorType = CS_INTERFACE
+        0x01,                                   // bDescriptorSubtype = VS_INPUT_HEADER
+        1,                                      // bNumFormats
+        LSB(14+27+30+6), MSB(14+27+30+6),       // wTotalLength
+        VIDEO_TX_ENDPOINT | 0x80,               // bEndpointAddress
+        0,                                      // bmInfo
+        2,                                      // bTerminalLink
+        0,                                      // bStillCaptureMethod
+        0,                                      // bTriggerSupport
+        0,                                      // bTriggerUsage
+        1,                                      // bControlSize
+        0,                                      // bmaControls
+        // Uncompressed Video Format Descriptor, UVC Payload Uncompressed 1.0, 3.1.1, Table 3-1
+        27,                                     // bLength
+        0x24,                                   // bDescriptorType = CS_INTERFACE
+        0x04,                                   // bDescriptorSubtype = VS_FORMAT_UNCOMPRESSED
+        1,                                      // bFormatIndex
+        1,                                      // bNumFrameDescriptors
+        'Y', 'U', 'Y', '2', 0x00, 0x00, 0x10, 0x00, // guidFormat = YUY2
+        0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71,
+        16,                                     // bBitsPerPixel
+        1,                                      // bDefaultFrameIndex
+        0,                                      // bAspectRatioX
+        0,                                      // bAspectRatioY
+        0,                                      // bmInterlaceFlags
+        0,                                      // bCopyProtect
+        // Uncompressed Video Frame Descriptor, UVC Payload Uncompressed 1.0, 3.1.2, Table 3-2
+        30,                                     // bLength
+        0x24,                                   // bDescriptorType = CS_INTERFACE
+        0x05,                                   // bDescriptorSubtype = VS_FRAME_UNCOMPRESSED
+        1,                                      // bFrameIndex
+        0,                                      // bmCapabilities
+        LSB(VIDEO_WIDTH), MSB(VIDEO_WIDTH),     // wWidth
+        LSB(VIDEO_HEIGHT), MSB(VIDEO_HEIGHT),   // wHeight
+        LSB((uint32_t)VIDEO_FRAME_SIZE * 8 * VIDEO_FPS), // dwMinBitRate
+        (((uint32_t)VIDEO_FRAME_SIZE * 8 * VIDEO_FPS) >> 8) & 255,
+        (((uint32_t)VIDEO_FRAME_SIZE * 8 * VIDEO_FPS) >> 16) & 255,
+        (((uint32_t)VIDEO_FRAME_SIZE * 8 * VIDEO_FPS) >> 24) & 255,
+        LSB(VIDEO_PACKET_SIZE_12 * 1000 * 8), // dwMaxBitRate
+        ((VIDEO_PACKET_SIZE_12 * 1000 * 8) >> 8) & 255,
+        ((VIDEO_PACKET_SIZE_12 * 1000 * 8) >> 16) & 255,
+        ((VIDEO_PACKET_SIZE_12 * 1000 * 8) >> 24) & 255,
+        LSB(VIDEO_FRAME_SIZE),                  // dwMaxVideoFrameBufferSize
+        (VIDEO_FRAME_SIZE >> 8) & 255,
+        (VIDEO_FRAME_SIZE >> 16) & 255,
+        (VIDEO_FRAME_SIZE >> 24) & 255,
+        LSB(VIDEO_FRAME_INTERVAL),              // dwDefaultFrameInterval
+        (VIDEO_FRAME_INTERVAL >> 8) & 255,
+        (VIDEO_FRAME_INTERVAL >> 16) & 255,
+        (VIDEO_FRAME_INTERVAL >> 24) & 255,
+        1,                                      // bFrameIntervalType, 1 discrete rate
+        LSB(VIDEO_FRAME_INTERVAL),              // dwFrameInterval
+        (VIDEO_FRAME_INTERVAL >> 8) & 255,
+        (VIDEO_FRAME_INTERVAL >> 16) & 255,
+        (VIDEO_FRAME_INTERVAL >> 24) & 255,
+        // Color Matching Descriptor, UVC 1.0, 3.9.2.6, Table 3-19
+        6,                                      // bLength
+        0x24,                                   // bDescriptorType = CS_INTERFACE
+        0x0D,                                   // bDescriptorSubtype = VS_COLORFORMAT
+        1,                                      // bColorPrimaries = BT.709, sRGB
+        1,                                      // bTransferCharacteristics = BT.709
+        4,                                      // bMatrixCoefficients = SMPTE 170M
+        // Standard VS Interface Descriptor, UVC 1.0, 3.9.1, Table 3-13
+        // alternate 1 streams, with the isochronous endpoint
+        9,                                      // bLength
+        4,                                      // bDescriptorType
+        VIDEO_INTERFACE+1,                      // bInterfaceNumber
+        1,                                      // bAlternateSetting
+        1,                                      // bNumEndpoints
+        0x0E,                                   // bInterfaceClass (0x0E = Video)
+        0x02,                                   // bInterfaceSubClass (0x02 = Streaming)
+        0x00,                                   // bInterfaceProtocol
+        0,                                      // iInterface
+        // Standard VS Isochronous Video Data Endpoint Descriptor, UVC 1.0, 3.10.1.1, Table 3-21
+        7,                                      // bLength
+        5,                                      // bDescriptorType
+        VIDEO_TX_ENDPOINT | 0x80,               // bEndpointAddress
+        0x05,                                   // bmAttributes = isochronous, asynchronous
+        LSB(VIDEO_PACKET_SIZE_12), MSB(VIDEO_PACKET_SIZE_12), // wMaxPacketSize
+        1,                                      // bInterval, 1 = every frame
+#endif // VIDEO_INTERFACE
 };
 
 
 __attribute__ ((section(".dmabuffers"), aligned(32)))
+#if defined(VENDOR_INTERFACE) && VENDOR_MSOS20_DESC_SIZE > CONFIG_DESC_SIZE
+uint8_t usb_descriptor_buffer[VENDOR_MSOS20_DESC_SIZE];
+#else
 uint8_t usb_descriptor_buffer[CONFIG_DESC_SIZE];
+#endif
 
 
 
@@ -2731,6 +3433,14 @@ struct usb_string_descriptor_struct usb_string_serial_number_default = {
         3,
         {0,0,0,0,0,0,0,0,0,0}
 };
+#ifdef NCM_STATUS_INTERFACE
+// MAC address of the host's end of the network link, filled in at startup
+static struct usb_string_descriptor_struct usb_string_ncm_mac = {
+	2 + 12 * 2,
+	3,
+	{'0','0','0','0','0','0','0','0','0','0','0','0'}
+};
+#endif
 #ifdef MTP_INTERFACE
 PROGMEM const struct usb_string_descriptor_struct usb_string_mtp = {
 	2 + 3 * 2,
@@ -2754,6 +3464,14 @@ void usb_init_serialnumber(void)
 		usb_string_serial_number_default.wString[i] = c;
 	}
 	usb_string_serial_number_default.bLength = i * 2 + 2;
+#ifdef NCM_STATUS_INTERFACE
+	uint8_t mac[6];
+	usb_ncm_get_mac(mac, NULL);
+	for (i=0; i < 12; i++) {
+		uint32_t n = (mac[i >> 1] >> ((i & 1) ? 0 : 4)) & 15;
+		usb_string_ncm_mac.wString[i] = (n < 10) ? '0' + n : 'A' - 10 + n;
+	}
+#endif
 }
 
 
@@ -2769,6 +3487,9 @@ const usb_descriptor_list_t usb_descriptor_list[] = {
 	{0x0600, 0x0000, qualifier_descriptor, sizeof(qualifier_descriptor)},
 	{0x0200, 0x0000, usb_config_descriptor_480, CONFIG_DESC_SIZE},
 	{0x0700, 0x0000, usb_config_descriptor_12, CONFIG_DESC_SIZE},
+#ifdef VENDOR_INTERFACE
+	{0x0F00, 0x0000, bos_descriptor, sizeof(bos_descriptor)},
+#endif
 #ifdef SEREMU_INTERFACE
 	{0x2200, SEREMU_INTERFACE, seremu_report_desc, sizeof(seremu_report_desc)},
 	{0x2100, SEREMU_INTERFACE, usb_config_descriptor_480+SEREMU_HID_DESC_OFFSET, 9},
@@ -2803,6 +3524,9 @@ const usb_descriptor_list_t usb_descriptor_list[] = {
 #endif
 #ifdef MTP_INTERFACE
 	{0x0304, 0x0409, (const uint8_t *)&usb_string_mtp, 0},
+#endif
+#ifdef NCM_STATUS_INTERFACE
+	{0x0300 + NCM_MAC_STRING, 0x0409, (const uint8_t *)&usb_string_ncm_mac, 0},
 #endif
         {0x0300, 0x0000, (const uint8_t *)&string0, 0},
         {0x0301, 0x0409, (const uint8_t *)&usb_string_manufacturer_name, 0},
@@ -614,6 +614,93 @@ let me know?  http://forum.pjrc.com/forums/4-Suggestions-amp-Bug-Reports
   #define ENDPOINT3_CONFIG	ENDPOINT_RECEIVE_UNUSED + ENDPOINT_TRANSMIT_INTERRUPT
   #define ENDPOINT4_CONFIG	ENDPOINT_RECEIVE_INTERRUPT + ENDPOINT_TRANSMIT_UNUSED
 
+#elif defined(USB_VENDOR_BULK)
+  #define VENDOR_ID		0x16C0
+  #define PRODUCT_ID		0x04D5
+  #define MANUFACTURER_NAME	{'T','e','e','n','s','y','d','u','i','n','o'}
+  #define MANUFACTURER_NAME_LEN	11
+  #define PRODUCT_NAME		{'T','e','e','n','s','y',' ','V','e','n','d','o','r',' ','B','u','l','k'}
+  #define PRODUCT_NAME_LEN	18
+  #define EP0_SIZE		64
+  #define NUM_ENDPOINTS         3
+  #define NUM_INTERFACE		2
+  #define VENDOR_INTERFACE	0	// Vendor bulk, WinUSB on Windows
+  #define VENDOR_TX_ENDPOINT	3
+  #define VENDOR_TX_SIZE_12	64
+  #define VENDOR_TX_SIZE_480	512
+  #define VENDOR_RX_ENDPOINT	3
+  #define VENDOR_RX_SIZE_12	64
+  #define VENDOR_RX_SIZE_480	512
+  #define SEREMU_INTERFACE      1	// Serial emulation
+  #define SEREMU_TX_ENDPOINT    2
+  #define SEREMU_TX_SIZE        64
+  #define SEREMU_TX_INTERVAL    1
+  #define SEREMU_RX_ENDPOINT    2
+  #define SEREMU_RX_SIZE        32
+  #define SEREMU_RX_INTERVAL    2
+  #define ENDPOINT2_CONFIG	ENDPOINT_RECEIVE_INTERRUPT + ENDPOINT_TRANSMIT_INTERRUPT
+  #define ENDPOINT3_CONFIG	ENDPOINT_RECEIVE_BULK + ENDPOINT_TRANSMIT_BULK
+
+#elif defined(USB_NCM)
+  #define VENDOR_ID		0x16C0
+  #define PRODUCT_ID		0x04D6
+  #define DEVICE_CLASS		0xEF
+  #define DEVICE_SUBCLASS	0x02
+  #define DEVICE_PROTOCOL	0x01
+  #define MANUFACTURER_NAME	{'T','e','e','n','s','y','d','u','i','n','o'}
+  #define MANUFACTURER_NAME_LEN	11
+  #define PRODUCT_NAME		{'T','e','e','n','s','y',' ','N','e','t','w','o','r','k'}
+  #define PRODUCT_NAME_LEN	14
+  #define EP0_SIZE		64
+  #define NUM_ENDPOINTS         4
+  #define NUM_INTERFACE		3
+  #define NCM_STATUS_INTERFACE	0	// CDC-NCM Ethernet
+  #define NCM_DATA_INTERFACE	1
+  #define NCM_NOTIFY_ENDPOINT	2
+  #define NCM_NOTIFY_SIZE	16
+  #define NCM_TX_ENDPOINT	3
+  #define NCM_TX_SIZE_12	64
+  #define NCM_TX_SIZE_480	512
+  #define NCM_RX_ENDPOINT	3
+  #define NCM_RX_SIZE_12	64
+  #define NCM_RX_SIZE_480	512
+  #define NCM_MAC_STRING	5	// iMACAddress string index
+  #define SEREMU_INTERFACE      2	// Serial emulation
+  #define SEREMU_TX_ENDPOINT    4
+  #define SEREMU_TX_SIZE        64
+  #define SEREMU_TX_INTERVAL    1
+  #define SEREMU_RX_ENDPOINT    4
+  #define SEREMU_RX_SIZE        32
+  #define SEREMU_RX_INTERVAL    2
+  #define ENDPOINT2_CONFIG	ENDPOINT_RECEIVE_UNUSED + ENDPOINT_TRANSMIT_INTERRUPT
+  #define ENDPOINT3_CONFIG	ENDPOINT_RECEIVE_BULK + ENDPOINT_TRANSMIT_BULK
+  #define ENDPOINT4_CONFIG	ENDPOINT_RECEIVE_INTERRUPT + ENDPOINT_TRANSMIT_INTERRUPT
+
+#elif defined(USB_VIDEO)
+  #define VENDOR_ID		0x16C0
+  #define PRODUCT_ID		0x04D7
+  #define DEVICE_CLASS		0xEF
+  #define DEVICE_SUBCLASS	0x02
+  #define DEVICE_PROTOCOL	0x01
+  #define MANUFACTURER_NAME	{'T','e','e','n','s','y','d','u','i','n','o'}
+  #define MANUFACTURER_NAME_LEN	11
+  #define PRODUCT_NAME		{'T','e','e','n','s','y',' ','V','i','d','e','o'}
+  #define PRODUCT_NAME_LEN	12
+  #define EP0_SIZE		64
+  #define NUM_ENDPOINTS         3
+  #define NUM_INTERFACE		3
+  #define VIDEO_INTERFACE	0	// UVC, control + streaming (2 interfaces)
+  #define VIDEO_TX_ENDPOINT	3
+  #define SEREMU_INTERFACE      2	// Serial emulation
+  #define SEREMU_TX_ENDPOINT    2
+  #define SEREMU_TX_SIZE        64
+  #define SEREMU_TX_INTERVAL    1
+  #define SEREMU_RX_ENDPOINT    2
+  #define SEREMU_RX_SIZE        32
+  #define SEREMU_RX_INTERVAL    2
+  #define ENDPOINT2_CONFIG	ENDPOINT_RECEIVE_INTERRUPT + ENDPOINT_TRANSMIT_INTERRUPT
+  #define ENDPOINT3_CONFIG	ENDPOINT_RECEIVE_UNUSED + ENDPOINT_TRANSMIT_ISOCHRONOUS
+
 #elif defined(USB_FLIGHTSIM)
   #define VENDOR_ID		0x16C0
   #define PRODUCT_ID		0x0488
@@ -725,9 +812,9 @@ let me know?  http://forum.pjrc.com/forums/4-Suggestions-amp-Bug-Reports
   #define SEREMU_RX_INTERVAL    2
   #define AUDIO_INTERFACE	1	// Audio (uses 3 consecutive interfaces)
   #define AUDIO_TX_ENDPOINT     3
-  #define AUDIO_TX_SIZE         180
+  #define AUDIO_TX_SIZE         AUDIO_USB_PACKET_SIZE
   #define AUDIO_RX_ENDPOINT     3
-  #define AUDIO_RX_SIZE         180
+  #define AUDIO_RX_SIZE         AUDIO_USB_PACKET_SIZE
   #define AUDIO_SYNC_ENDPOINT	4
   #define ENDPOINT2_CONFIG	ENDPOINT_RECEIVE_INTERRUPT + ENDPOINT_TRANSMIT_INTERRUPT
   #define ENDPOINT3_CONFIG	ENDPOINT_RECEIVE_ISOCHRONOUS + ENDPOINT_TRANSMIT_ISOCHRONOUS
@@ -764,9 +851,9 @@ let me know?  http://forum.pjrc.com/forums/4-Suggestions-amp-Bug-Reports
   #define MIDI_RX_SIZE_480      512
   #define AUDIO_INTERFACE	3	// Audio (uses 3 consecutive interfaces)
   #define AUDIO_TX_ENDPOINT     5
-  #define AUDIO_TX_SIZE         180
+  #define AUDIO_TX_SIZE         AUDIO_USB_PACKET_SIZE
   #define AUDIO_RX_ENDPOINT     5
-  #define AUDIO_RX_SIZE         180
+  #define AUDIO_RX_SIZE         AUDIO_USB_PACKET_SIZE
   #define AUDIO_SYNC_ENDPOINT	6
   #define ENDPOINT2_CONFIG	ENDPOINT_RECEIVE_UNUSED + ENDPOINT_TRANSMIT_INTERRUPT
   #define ENDPOINT3_CONFIG	ENDPOINT_RECEIVE_BULK + ENDPOINT_TRANSMIT_BULK
@@ -806,9 +893,9 @@ let me know?  http://forum.pjrc.com/forums/4-Suggestions-amp-Bug-Reports
   #define MIDI_RX_SIZE_480      512
   #define AUDIO_INTERFACE	3	// Audio (uses 3 consecutive interfaces)
   #define AUDIO_TX_ENDPOINT     5
-  #define AUDIO_TX_SIZE         180
+  #define AUDIO_TX_SIZE         AUDIO_USB_PACKET_SIZE
   #define AUDIO_RX_ENDPOINT     5
-  #define AUDIO_RX_SIZE         180
+  #define AUDIO_RX_SIZE         AUDIO_USB_PACKET_SIZE
   #define AUDIO_SYNC_ENDPOINT	6
   #define ENDPOINT2_CONFIG	ENDPOINT_RECEIVE_UNUSED + ENDPOINT_TRANSMIT_INTERRUPT
   #define ENDPOINT3_CONFIG	ENDPOINT_RECEIVE_BULK + ENDPOINT_TRANSMIT_BULK
@@ -888,9 +975,9 @@ let me know?  http://forum.pjrc.com/forums/4-Suggestions-amp-Bug-Reports
   #define KEYMEDIA_INTERVAL     4
   #define AUDIO_INTERFACE	9	// Audio (uses 3 consecutive interfaces)
   #define AUDIO_TX_ENDPOINT     13
-  #define AUDIO_TX_SIZE         180
+  #define AUDIO_TX_SIZE         AUDIO_USB_PACKET_SIZE
   #define AUDIO_RX_ENDPOINT     13
-  #define AUDIO_RX_SIZE         180
+  #define AUDIO_RX_SIZE         AUDIO_USB_PACKET_SIZE
   #define AUDIO_SYNC_ENDPOINT	14
   #define MULTITOUCH_INTERFACE  12	// Touchscreen
   #define MULTITOUCH_ENDPOINT   15
@@ -914,6 +1001,143 @@ let me know?  http://forum.pjrc.com/forums/4-Suggestions-amp-Bug-Reports
 
 #endif
 
+#ifdef RAWHID_INTERFACE
+// Raw HID reports may be up to 1024 bytes.  At 480 Mbit/sec each report is
+// a single packet, and RAWHID_TX_MULT / RAWHID_RX_MULT (1 to 3) allow the
+// host to move that many per microframe, up to 24 Mbyte/sec each way.  At
+// 12 Mbit/sec reports larger than 64 bytes are sent as several packets.
+#if RAWHID_TX_SIZE > 1024 || RAWHID_RX_SIZE > 1024
+#error "Raw HID reports can not be larger than 1024 bytes"
+#endif
+#ifndef RAWHID_TX_MULT
+#define RAWHID_TX_MULT		1
+#endif
+#ifndef RAWHID_RX_MULT
+#define RAWHID_RX_MULT		1
+#endif
+#define RAWHID_TX_PACKET_12	(RAWHID_TX_SIZE > 64 ? 64 : RAWHID_TX_SIZE)
+#define RAWHID_RX_PACKET_12	(RAWHID_RX_SIZE > 64 ? 64 : RAWHID_RX_SIZE)
+#endif
+
+#ifdef VENDOR_INTERFACE
+// The vendor interface has no class driver, so the device answers the
+// Microsoft OS 2.0 descriptor request, which makes Windows 8.1 and later
+// load WinUSB without an INF file.  Linux and macOS need no driver.  The
+// host finds it by VENDOR_ID and PRODUCT_ID, or on Windows by this
+// DeviceInterfaceGUID, and moves data with libusb or WinUsb_ReadPipe.
+#ifndef VENDOR_MSOS20_CODE
+#define VENDOR_MSOS20_CODE	0x01	// bRequest for the MS OS 2.0 descriptor set
+#endif
+#ifndef VENDOR_INTERFACE_GUID
+#define VENDOR_INTERFACE_GUID	{'{','5','8','3','F','F','E','B','D','-','C','F','1','D','-','4','4','B','B', \
+				 '-','8','4','0','0','-','6','7','5','3','4','4','9','B','1','D','B','1','}'}
+#endif
+#define VENDOR_MSOS20_DESC_SIZE	(10 + 8 + 8 + 20 + 10+42+80)
+#define VENDOR_BOS_DESC_SIZE	(5 + 28)
+#endif
+
+#ifdef NCM_STATUS_INTERFACE
+// CDC-NCM moves Ethernet frames in NCM Transfer Blocks (NTBs), each holding
+// many frames, so one bulk transfer carries a burst of small packets.  The
+// device offers the host NTBs up to NCM_NTB_IN_SIZE, and accepts NTBs up
+// to NCM_NTB_OUT_SIZE.  Only the 16 bit NTB format is supported.
+#ifndef NCM_NTB_IN_SIZE
+#define NCM_NTB_IN_SIZE		16384
+#endif
+#ifndef NCM_NTB_OUT_SIZE
+#define NCM_NTB_OUT_SIZE	8192
+#endif
+#define NCM_MAX_SEGMENT_SIZE	1514	// Ethernet frame, without CRC
+#if NCM_NTB_IN_SIZE > 16384 || NCM_NTB_OUT_SIZE > 16384
+#error "NCM transfer blocks can not be larger than 16384 bytes"
+#endif
+#endif
+
+#ifdef VIDEO_INTERFACE
+// UVC video stream format.  Frames are uncompressed YUY2 (2 bytes per
+// pixel) at one size and rate.  At 480 Mbit/sec each microframe carries
+// 3 isochronous packets of 1024 bytes, about 24 Mbyte/sec, enough for
+// 640x480 at 30 fps or 320x240 at 150 fps.  At 12 Mbit/sec only 1023
+// bytes per millisecond fit, so frames must be much smaller or slower.
+#ifndef VIDEO_WIDTH
+#define VIDEO_WIDTH		320
+#endif
+#ifndef VIDEO_HEIGHT
+#define VIDEO_HEIGHT		240
+#endif
+#ifndef VIDEO_FPS
+#define VIDEO_FPS		30
+#endif
+#define VIDEO_FRAME_SIZE	(VIDEO_WIDTH * VIDEO_HEIGHT * 2)
+#define VIDEO_FRAME_INTERVAL	(10000000 / VIDEO_FPS)	// 100 ns units
+#define VIDEO_PACKET_SIZE_480	1024
+#define VIDEO_PACKET_MULT	3	// packets per microframe, 1 to 3
+#define VIDEO_PACKET_SIZE_12	1023
+#endif
+
+#ifdef AUDIO_INTERFACE
+// USB audio stream format.  Samples move between USB packets and audio
+// library blocks without rate conversion, so AUDIO_USB_SAMPLE_RATE must
+// match the audio library's AUDIO_SAMPLE_RATE_EXACT.  Each packet carries
+// one millisecond of audio, plus room for 1 extra sample frame when the
+// host adjusts its rate.  At 480 Mbit/sec packets larger than 1024 bytes
+// use 2 or 3 transactions per microframe.  At 12 Mbit/sec packets are
+// limited to 1023 bytes, which the largest formats exceed.
+#ifndef AUDIO_USB_CHANNELS
+#define AUDIO_USB_CHANNELS	2	// 1 to 8
+#endif
+#ifndef AUDIO_USB_RESOLUTION
+#define AUDIO_USB_RESOLUTION	16	// 16 or 24 bits
+#endif
+#ifndef AUDIO_USB_SAMPLE_RATE
+#define AUDIO_USB_SAMPLE_RATE	44100	// 44100, 48000 or 96000
+#endif
+#if AUDIO_USB_CHANNELS < 1 || AUDIO_USB_CHANNELS > 8
+#error "AUDIO_USB_CHANNELS must be 1 to 8"
+#endif
+#if AUDIO_USB_RESOLUTION != 16 && AUDIO_USB_RESOLUTION != 24
+#error "AUDIO_USB_RESOLUTION must be 16 or 24"
+#endif
+#define AUDIO_USB_SUBFRAME_SIZE	(AUDIO_USB_RESOLUTION / 8)
+#define AUDIO_USB_FRAME_SIZE	(AUDIO_USB_CHANNELS * AUDIO_USB_SUBFRAME_SIZE)
+#define AUDIO_USB_PACKET_SIZE	(AUDIO_USB_FRAME_SIZE * (AUDIO_USB_SAMPLE_RATE / 1000 + 1))
+#if AUDIO_USB_PACKET_SIZE > 3072
+#error "USB audio format needs more than 3072 bytes per millisecond"
+#endif
+#define AUDIO_USB_PACKET_MULT	((AUDIO_USB_PACKET_SIZE + 1023) / 1024)
+#define AUDIO_USB_PACKET_480	((AUDIO_USB_PACKET_SIZE + AUDIO_USB_PACKET_MULT - 1) / AUDIO_USB_PACKET_MULT)
+#define AUDIO_USB_PACKET_12	(AUDIO_USB_PACKET_SIZE > 1023 ? 1023 : AUDIO_USB_PACKET_SIZE) // see usb_audio.cpp
+#endif
+
+#ifdef MULTITOUCH_INTERFACE
+// Touchscreen report format.  Each report carries up to this many contacts.
+// With more than 1, a scan of all touches needs fewer reports (hybrid mode),
+// or only 1 report when equal to MULTITOUCH_FINGERS (parallel mode).
+#ifndef MULTITOUCH_CONTACTS_PER_REPORT
+#define MULTITOUCH_CONTACTS_PER_REPORT	1
+#endif
+#if MULTITOUCH_CONTACTS_PER_REPORT < 1 || MULTITOUCH_CONTACTS_PER_REPORT > MULTITOUCH_FINGERS || MULTITOUCH_CONTACTS_PER_REPORT > 10
+#error "MULTITOUCH_CONTACTS_PER_REPORT must be 1 to MULTITOUCH_FINGERS (at most 10)"
+#endif
+#define MULTITOUCH_REPORT_SIZE	(6 * MULTITOUCH_CONTACTS_PER_REPORT + 3)
+#endif
+
+#ifdef KEYBOARD_INTERFACE
+// Keyboard report format.  Define KEYBOARD_NKRO for N-key rollover, where
+// every key has a bit in the report, instead of the 6 key boot report.
+// The host may still select boot protocol, which sends the 6 key report.
+// The keyboard endpoint is polled every KEYBOARD_INTERVAL frames: 125 us
+// microframes at 480 Mbit/sec, 1 ms frames at 12 Mbit/sec.
+#ifdef KEYBOARD_NKRO
+#define KEYBOARD_NKRO_KEYS	224	// usage codes 0 to 223, modifiers are separate
+#define KEYBOARD_REPORT_SIZE	(1 + KEYBOARD_NKRO_KEYS / 8)
+#define KEYBOARD_PACKET_SIZE	32
+#else
+#define KEYBOARD_REPORT_SIZE	8
+#define KEYBOARD_PACKET_SIZE	KEYBOARD_SIZE
+#endif
+#endif
+
 #ifdef USB_DESC_LIST_DEFINE
 #if defined(NUM_ENDPOINTS) && NUM_ENDPOINTS > 0
 // NUM_ENDPOINTS = number of non-zero endpoints (0 to 7)
@@ -928,5 +1152,17 @@ typedef struct {
 
 extern const usb_descriptor_list_t usb_descriptor_list[];
 #endif // NUM_ENDPOINTS
+
+#ifdef VENDOR_INTERFACE
+// Microsoft OS 2.0 descriptor set, VENDOR_MSOS20_DESC_SIZE bytes
+typedef struct {
+	uint8_t		header[54];
+	uint16_t	name[21];
+	uint16_t	data_length;
+	uint16_t	data[40];
+} __attribute__ ((packed)) usb_msos20_descriptor_t;
+
+extern const usb_msos20_descriptor_t usb_msos20_descriptor;
+#endif // VENDOR_INTERFACE
 #endif // USB_DESC_LIST_DEFINE
 
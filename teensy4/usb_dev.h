@@ -1,5 +1,6 @@
 #pragma once
 #include "imxrt.h"
+#include "dma_buffer.h"
 
 #if !defined(USB_DISABLED)
 
@@ -26,10 +27,15 @@ void usb_config_rx(uint32_t ep, uint32_t packet_size, int do_zlp, void (*cb)(tra
 void usb_config_tx(uint32_t ep, uint32_t packet_size, int do_zlp, void (*cb)(transfer_t *));
 void usb_config_rx_iso(uint32_t ep, uint32_t packet_size, int mult, void (*cb)(transfer_t *));
 void usb_config_tx_iso(uint32_t ep, uint32_t packet_size, int mult, void (*cb)(transfer_t *));
+void usb_config_tx_ioc_on_request(uint32_t ep);
+#define USB_TRANSFER_IOC (1<<15)	// interrupt on complete, in transfer_t status
 
 void usb_prepare_transfer(transfer_t *transfer, const void *data, uint32_t len, uint32_t param);
 void usb_transmit(int endpoint_number, transfer_t *transfer);
 void usb_receive(int endpoint_number, transfer_t *transfer);
+uint32_t usb_prepare_transfer_chain(transfer_t *transfer, uint32_t num, const void *data, uint32_t len, uint32_t param);
+void usb_transmit_chain(int endpoint_number, transfer_t *transfer, uint32_t num);
+void usb_receive_chain(int endpoint_number, transfer_t *transfer, uint32_t num);
 uint32_t usb_transfer_status(const transfer_t *transfer);
 
 void usb_start_sof_interrupts(int interface);
@@ -38,6 +44,47 @@ void usb_stop_sof_interrupts(int interface);
 extern void (*usb_timer0_callback)(void);
 extern void (*usb_timer1_callback)(void);
 
+// Suspend and resume.  The host suspends the bus when it sleeps, or when
+// the cable is unplugged.  The callbacks run from the USB interrupt, so
+// they should only set flags or turn off peripherals quickly.
+extern volatile uint8_t usb_suspended;
+void usb_set_suspend_callbacks(void (*suspend)(void), void (*resume)(void));
+// While suspended, lower the ARM clock to arm_freq, from yield(), and
+// restore the prior speed on resume.  0 disables.
+void usb_suspend_power_save(uint32_t arm_freq);
+extern volatile uint8_t usb_power_save_pending;
+void usb_power_save_update(void);
+// Wake a sleeping host, like a keyboard key press.  Only works when built
+// with -DUSB_REMOTE_WAKEUP and the host has enabled it.  Returns 1 if
+// resume signaling started.
+int usb_remote_wakeup(void);
+
+#ifdef USB_STATS
+// Optional per-endpoint statistics, enabled by compiling with -DUSB_STATS.
+// Latency is the time each transfer spent at the head of its endpoint's
+// queue (or since queued, if the endpoint was idle) before completing.
+#define USB_STATS_HISTOGRAM_SIZE 16
+#define USB_STATS_NUM_ENDPOINTS  8   /* hardware has endpoints 0 to 7 */
+typedef struct {
+	uint32_t transfers;      // completed dTDs
+	uint32_t bytes;          // queued bytes, less unused length of completed
+	uint32_t errors;         // halted, data buffer or transaction errors
+	uint32_t naks;           // USB interrupts where this endpoint NAKed
+	uint32_t latency_max;    // microseconds
+	uint32_t latency_histogram[USB_STATS_HISTOGRAM_SIZE]; // [n] = 2^(n-1) to 2^n-1 us
+	uint32_t callback_cycles; // CPU cycles in completion callbacks
+} usb_endpoint_stats_t;
+typedef struct {
+	usb_endpoint_stats_t rx[USB_STATS_NUM_ENDPOINTS];
+	usb_endpoint_stats_t tx[USB_STATS_NUM_ENDPOINTS];
+	uint32_t isr_count;
+	uint32_t isr_cycles;     // total CPU cycles in usb_isr
+	uint32_t isr_cycles_max;
+} usb_stats_t;
+extern usb_stats_t usb_stats;
+void usb_stats_clear(void);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -34,8 +34,10 @@ extern "C" {
 #include "usb_flightsim.h"
 #include "debug/printf.h"
 #include "avr/pgmspace.h"
+#include "SPSCRing.h"
 #include "core_pins.h" // for yield(), millis()
 #include <string.h>    // for memcpy()
+#include <stdlib.h>    // for realloc()
 
 #ifdef FLIGHTSIM_INTERFACE // defined by usb_dev.h -> usb_desc.h
 #if F_CPU >= 20000000
@@ -60,7 +62,23 @@ elapsedMillis FlightSimClass::enableTimeout;
 
 static unsigned int unassigned_id = 1;  // TODO: move into FlightSimClass
 
+// Incoming data is found by its id in this table, built when the ids are
+// sent to the host.  Items created later are found by searching the lists.
+struct flightsim_id_entry {
+	void *item;
+	uint8_t type;  // 1=Integer, 2=Float, 3=Event, 4=Data
+};
+static struct flightsim_id_entry *id_table = NULL;
+static unsigned int id_table_size = 0;
+
+static void * find_by_id(unsigned int n, uint8_t type)
+{
+	if (id_table[n].type != type) return NULL;
+	return id_table[n].item;
+}
+
 static uint8_t tx_noautoflush=0;
+static volatile uint8_t tx_batch=0;
 static uint8_t transmit_previous_timeout=0;
 
 #define TX_NUM   8
@@ -72,10 +90,9 @@ static uint16_t tx_available=0;
 #define RX_NUM  6
 static transfer_t rx_transfer[RX_NUM] __attribute__ ((used, aligned(32)));
 DMAMEM static uint8_t rx_buffer[RX_NUM * FLIGHTSIM_RX_SIZE] __attribute__ ((aligned(32)));
-static volatile uint8_t rx_head;
-static volatile uint8_t rx_tail;
-static uint8_t rx_list[RX_NUM + 1];
-static volatile uint32_t rx_available;
+// received packets, filled by rx_event() and emptied by free_packet()
+static SPSCRing<uint8_t, 8> rx_list;
+static_assert(RX_NUM <= 8, "rx_list too small for RX_NUM");
 
 extern "C" {
 static void rx_queue_transfer(int i);
@@ -198,6 +215,7 @@ void FlightSimEvent::update(long val)
 
 FlightSimEvent * FlightSimEvent::find(unsigned int n)
 {
+	if (n < id_table_size) return (FlightSimEvent *)find_by_id(n, 3);
 	for (FlightSimEvent *p = first; p; p = p->next) {
 		if (p->id == n) return p;
 	}
@@ -265,6 +283,7 @@ void FlightSimData::update(char *val, size_t len)
 
 FlightSimData * FlightSimData::find(unsigned int n)
 {
+	if (n < id_table_size) return (FlightSimData *)find_by_id(n, 4);
 	for (FlightSimData *p = first; p; p = p->next) {
 		if (p->id == n) return p;
 	}
@@ -335,6 +354,7 @@ void FlightSimInteger::update(long val)
 
 FlightSimInteger * FlightSimInteger::find(unsigned int n)
 {
+	if (n < id_table_size) return (FlightSimInteger *)find_by_id(n, 1);
 	for (FlightSimInteger *p = first; p; p = p->next) {
 		if (p->id == n) return p;
 	}
@@ -406,6 +426,7 @@ void FlightSimFloat::update(float val)
 
 FlightSimFloat * FlightSimFloat::find(unsigned int n)
 {
+	if (n < id_table_size) return (FlightSimFloat *)find_by_id(n, 2);
 	for (FlightSimFloat *p = first; p; p = p->next) {
 		if (p->id == n) return p;
 	}
@@ -433,6 +454,10 @@ void FlightSimClass::update(void)
 	void *rx_packet;
 	uint16_t id;
 
+	// Messages written while update() runs, by callbacks or by the id
+	// messages, are packed together into full packets.  The start of
+	// frame interrupt flushes a partial packet only after update() ends.
+	tx_batch = 1;
 	while (1) {
 		if (!usb_configuration) break;
 		rx_packet = usb_flightsim_get_packet();
@@ -501,6 +526,7 @@ void FlightSimClass::update(void)
 	}
 	if (enabled && request_id_messages) {
 		request_id_messages = 0;
+		build_id_table();
 		for (FlightSimCommand *p = FlightSimCommand::first; p; p = p->next) {
 			p->identify();
 		}
@@ -521,6 +547,37 @@ void FlightSimClass::update(void)
 			// TODO: send any dirty data
 		}
 	}
+	tx_batch = 0;
+}
+
+
+void FlightSimClass::build_id_table(void)
+{
+	unsigned int size = unassigned_id;
+	if (size != id_table_size) {
+		struct flightsim_id_entry *table = (struct flightsim_id_entry *)
+			realloc(id_table, size * sizeof(struct flightsim_id_entry));
+		if (!table) return; // keep the old table, find() searches beyond it
+		id_table = table;
+	}
+	memset(id_table, 0, size * sizeof(struct flightsim_id_entry));
+	for (FlightSimInteger *p = FlightSimInteger::first; p; p = p->next) {
+		id_table[p->id].item = p;
+		id_table[p->id].type = 1;
+	}
+	for (FlightSimFloat *p = FlightSimFloat::first; p; p = p->next) {
+		id_table[p->id].item = p;
+		id_table[p->id].type = 2;
+	}
+	for (FlightSimEvent *p = FlightSimEvent::first; p; p = p->next) {
+		id_table[p->id].item = p;
+		id_table[p->id].type = 3;
+	}
+	for (FlightSimData *p = FlightSimData::first; p; p = p->next) {
+		id_table[p->id].item = p;
+		id_table[p->id].type = 4;
+	}
+	id_table_size = size;
 }
 
 
@@ -706,9 +763,7 @@ void usb_flightsim_configure() {
 	printf("txbuffer:    %x\n", txbuffer);
 	printf("rx_transfer: %x\n", rx_transfer);
 	printf("rxbuffer:    %x\n", rx_buffer);
-	rx_head = 0;
-	rx_tail = 0;
-	rx_available = 0;
+	rx_list.clear();
 	usb_config_rx(FLIGHTSIM_RX_ENDPOINT, FLIGHTSIM_RX_SIZE, 0, rx_event);
 	usb_config_tx(FLIGHTSIM_TX_ENDPOINT, FLIGHTSIM_TX_SIZE, 0, NULL); // TODO: is ZLP needed?
 	int i;
@@ -720,11 +775,11 @@ void usb_flightsim_configure() {
 
 // This gets called from usb_isr when a USB start token arrives.
 // If we have a packet to transmit AND transmission isn't disabled 
-// by tx_noautoflush, we fill it up with zeros and send it out 
-// to USB
+// by tx_noautoflush or tx_batch, we fill it up with zeros and send
+// it out to USB
 void usb_flightsim_flush_output(void)
 {
-	if (tx_noautoflush == 0 && tx_available > 0) {
+	if (tx_noautoflush == 0 && tx_batch == 0 && tx_available > 0) {
 		printf(" flush, %d %d\n", FLIGHTSIM_TX_SIZE, tx_available);
 		uint32_t head = tx_head;
 		transfer_t *xfer = tx_transfer + head;
@@ -735,7 +790,7 @@ void usb_flightsim_flush_output(void)
 			tx_available--;
 		}
 		usb_prepare_transfer(xfer, txbuf, FLIGHTSIM_TX_SIZE, 0);
-		arm_dcache_flush_delete(txbuf, FLIGHTSIM_TX_SIZE);
+		dma_buffer_to_device(txbuf, FLIGHTSIM_TX_SIZE);
 		usb_transmit(FLIGHTSIM_TX_ENDPOINT, xfer);
 		if (++head >= TX_NUM) head = 0;
 		tx_head = head;
@@ -772,7 +827,7 @@ static void send_packet(transfer_t *xfer) {
 	uint32_t head = tx_head;
 	uint8_t *txbuf = txbuffer + (tx_head * FLIGHTSIM_TX_SIZE);
 	usb_prepare_transfer(xfer, txbuf, FLIGHTSIM_TX_SIZE, 0);
-	arm_dcache_flush_delete(txbuf, FLIGHTSIM_TX_SIZE);
+	dma_buffer_to_device(txbuf, FLIGHTSIM_TX_SIZE);
 	usb_transmit(FLIGHTSIM_TX_ENDPOINT, xfer);
 	if (++head >= TX_NUM) head = 0;
 	tx_head = head;
@@ -784,7 +839,7 @@ static void rx_queue_transfer(int i)
 	NVIC_DISABLE_IRQ(IRQ_USB1);
 	void *buffer = rx_buffer + i * FLIGHTSIM_RX_SIZE;
 	usb_prepare_transfer(rx_transfer + i, buffer, FLIGHTSIM_RX_SIZE, i);
-	arm_dcache_delete(buffer, FLIGHTSIM_RX_SIZE);
+	dma_buffer_from_device(buffer, FLIGHTSIM_RX_SIZE);
 	usb_receive(FLIGHTSIM_RX_ENDPOINT, rx_transfer + i);
 	NVIC_ENABLE_IRQ(IRQ_USB1);
 }
@@ -796,11 +851,7 @@ static void rx_event(transfer_t *t)
 	int i = t->callback_param;
 //	printf("Flight sim rx event, len=%d, i=%d", len, i);
 	if (len == FLIGHTSIM_RX_SIZE) {
-		uint32_t head = rx_head;
-		if (++head > RX_NUM) head = 0;
-		rx_list[head] = i;
-		rx_head = head;
-		rx_available += len;
+		rx_list.push(i);
 	} else {
 		// received packet with invalid length
 		rx_queue_transfer(i);
@@ -810,29 +861,14 @@ static void rx_event(transfer_t *t)
 
 static void* usb_flightsim_get_packet(void)
 {
-	void *result = NULL;
-	NVIC_DISABLE_IRQ(IRQ_USB1);
-	uint32_t tail = rx_tail;
-	if (tail != rx_head) {
-		if (++tail > RX_NUM) tail = 0;
-		uint32_t i = rx_list[tail];
-		result = rx_buffer + i * FLIGHTSIM_RX_SIZE;
-		rx_available -= FLIGHTSIM_RX_SIZE;
-	}
-	NVIC_ENABLE_IRQ(IRQ_USB1);
-	return result;
+	uint8_t *i = rx_list.peek();
+	if (!i) return NULL;
+	return rx_buffer + *i * FLIGHTSIM_RX_SIZE;
 }
 
 static void usb_flightsim_free_packet() {
-	NVIC_DISABLE_IRQ(IRQ_USB1);
-	uint32_t tail = rx_tail;
-	if (tail != rx_head) {
-		if (++tail > RX_NUM) tail = 0;
-		uint32_t i = rx_list[tail];
-		rx_tail = tail;
-		rx_queue_transfer(i);
-	}
-	NVIC_ENABLE_IRQ(IRQ_USB1);
+	uint8_t i;
+	if (rx_list.pop(i)) rx_queue_transfer(i);
 }
 
 }  // extern "C"
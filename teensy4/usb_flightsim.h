@@ -76,6 +76,7 @@ private:
 	static void disable(void) { enabled = 0; }
 	static void xmit(const void *p1, uint8_t n1, const void *p2, uint8_t n2);
 	static void xmit_big_packet(const void *p1, uint8_t n1, const void *p2, uint8_t n2);
+	static void build_id_table(void);
 	friend class FlightSimCommand;
 	friend class FlightSimInteger;
 	friend class FlightSimFloat;
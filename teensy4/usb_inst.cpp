@@ -30,12 +30,53 @@
 
 #include <Arduino.h>
 #include "usb_desc.h"
+#include "EventResponder.h"
 
 #if F_CPU >= 20000000
 
 #ifdef CDC_DATA_INTERFACE
 #ifdef CDC_STATUS_INTERFACE
 usb_serial_class Serial;
+
+static EventResponder *usb_serial_rx_responder = nullptr;
+
+static void usb_serial_rx_trigger(uint32_t available)
+{
+	EventResponder *event = usb_serial_rx_responder;
+	if (event) event->triggerEvent(available, &Serial);
+}
+
+void usb_serial_class::attachRxEvent(EventResponder &event)
+{
+	usb_serial_rx_responder = &event;
+	usb_serial_set_rx_callback(usb_serial_rx_trigger);
+}
+
+void usb_serial_class::detachRxEvent()
+{
+	usb_serial_set_rx_callback(NULL);
+	usb_serial_rx_responder = nullptr;
+}
+
+static EventResponder *usb_serial_tx_responder = nullptr;
+
+static void usb_serial_tx_trigger(uint32_t space)
+{
+	EventResponder *event = usb_serial_tx_responder;
+	if (event) event->triggerEvent(space, &Serial);
+}
+
+void usb_serial_class::attachWriteEvent(EventResponder &event)
+{
+	usb_serial_tx_responder = &event;
+	usb_serial_set_tx_callback(usb_serial_tx_trigger);
+}
+
+void usb_serial_class::detachWriteEvent()
+{
+	usb_serial_set_tx_callback(NULL);
+	usb_serial_tx_responder = nullptr;
+}
 #endif
 #endif
 
@@ -51,6 +92,34 @@ usb_serial3_class SerialUSB2;
 #endif
 #endif
 
+#ifdef MTP_INTERFACE
+#include "usb_mtp.h"
+
+static EventResponder *usb_mtp_rx_responder = nullptr;
+static usb_mtp_class *usb_mtp_rx_object = nullptr;
+
+static void usb_mtp_rx_trigger(uint32_t len)
+{
+	EventResponder *event = usb_mtp_rx_responder;
+	if (event) event->triggerEvent(len, usb_mtp_rx_object);
+}
+
+// the mtp instance itself belongs to the MTP library, so remember which
+// object attached rather than referring to it here
+void usb_mtp_class::attachRxEvent(EventResponder &event)
+{
+	usb_mtp_rx_responder = &event;
+	usb_mtp_rx_object = this;
+	usb_mtp_set_rx_callback(usb_mtp_rx_trigger);
+}
+
+void usb_mtp_class::detachRxEvent()
+{
+	usb_mtp_set_rx_callback(NULL);
+	usb_mtp_rx_responder = nullptr;
+}
+#endif
+
 #ifdef MIDI_INTERFACE
 usb_midi_class usbMIDI;
 #endif
@@ -65,6 +134,61 @@ usb_mouse_class Mouse;
 
 #ifdef RAWHID_INTERFACE
 usb_rawhid_class RawHID;
+
+static EventResponder *usb_rawhid_rx_responder = nullptr;
+
+static int usb_rawhid_rx_trigger(const void *report, uint32_t len)
+{
+	EventResponder *event = usb_rawhid_rx_responder;
+	if (event) event->triggerEvent(len, &RawHID);
+	return 0;
+}
+
+void usb_rawhid_class::attachRxEvent(EventResponder &event)
+{
+	usb_rawhid_rx_responder = &event;
+	usb_rawhid_set_rx_callback(usb_rawhid_rx_trigger);
+}
+#endif
+
+#ifdef VENDOR_INTERFACE
+usb_vendor_class VendorUSB;
+
+static EventResponder *usb_vendor_rx_responder = nullptr;
+
+static void usb_vendor_rx_trigger(uint32_t len)
+{
+	EventResponder *event = usb_vendor_rx_responder;
+	if (event) event->triggerEvent(len, &VendorUSB);
+}
+
+void usb_vendor_class::attachRxEvent(EventResponder &event)
+{
+	usb_vendor_rx_responder = &event;
+	usb_vendor_set_rx_callback(usb_vendor_rx_trigger);
+}
+#endif
+
+#ifdef NCM_STATUS_INTERFACE
+usb_ncm_class NetUSB;
+
+static EventResponder *usb_ncm_rx_responder = nullptr;
+
+static void usb_ncm_rx_trigger(void)
+{
+	EventResponder *event = usb_ncm_rx_responder;
+	if (event) event->triggerEvent(0, &NetUSB);
+}
+
+void usb_ncm_class::attachRxEvent(EventResponder &event)
+{
+	usb_ncm_rx_responder = &event;
+	usb_ncm_set_rx_callback(usb_ncm_rx_trigger);
+}
+#endif
+
+#ifdef VIDEO_INTERFACE
+usb_video_class VideoUSB;
 #endif
 
 #ifdef FLIGHTSIM_INTERFACE
@@ -44,6 +44,11 @@ uint32_t usb_joystick_data[(JOYSTICK_SIZE+3)/4];
 
 static uint8_t transmit_previous_timeout=0;
 
+// the last report given to the USB controller, for frame mode
+static uint8_t sent_data[JOYSTICK_SIZE];
+static uint8_t frame_mode=0;
+static volatile uint8_t update_nesting=0;
+
 // When the PC isn't listening, how long do we wait before discarding data?
 #define TX_TIMEOUT_MSEC 30
 
@@ -65,45 +70,97 @@ void usb_joystick_configure(void)
 {
 	memset(tx_transfer, 0, sizeof(tx_transfer));
 	tx_head = 0;
+	memset(sent_data, 0, sizeof(sent_data));
 	usb_config_tx(JOYSTICK_ENDPOINT, JOYSTICK_SIZE, 0, NULL);
 }
 
 
-int usb_joystick_send()
+// Give the report to the USB controller, if the next transfer_t is free.
+// Must be called with the USB interrupt disabled, or from the interrupt.
+static int tx_send(void)
 {
-        if (!usb_configuration) return -1;
-        uint32_t head = tx_head;
-        transfer_t *xfer = tx_transfer + head;
-        uint32_t wait_begin_at = systick_millis_count;
-        while (1) {
-                uint32_t status = usb_transfer_status(xfer);
-                if (!(status & 0x80)) {
-                        if (status & 0x68) {
-                                // TODO: what if status has errors???
-                                printf("ERROR status = %x, i=%d, ms=%u\n",
-                                        status, tx_head, systick_millis_count);
-                        }
-                        transmit_previous_timeout = 0;
-                        break;
-                }
-                if (transmit_previous_timeout) return -1;
-                if (systick_millis_count - wait_begin_at > TX_TIMEOUT_MSEC) {
-                        // waited too long, assume the USB host isn't listening
-                        transmit_previous_timeout = 1;
-                        return -1;
-                }
-                if (!usb_configuration) return -1;
-                yield();
-        }
+	uint32_t head = tx_head;
+	transfer_t *xfer = tx_transfer + head;
+	uint32_t status = usb_transfer_status(xfer);
+	if (status & 0x80) return -1;
+	if (status & 0x68) {
+		// TODO: what if status has errors???
+		printf("ERROR status = %x, i=%d, ms=%u\n",
+			status, tx_head, systick_millis_count);
+	}
 	delayNanoseconds(30); // TODO: why is status ready too soon?
-        uint8_t *buffer = txbuffer + head * TX_BUFSIZE;
+	uint8_t *buffer = txbuffer + head * TX_BUFSIZE;
 	memcpy(buffer, usb_joystick_data, JOYSTICK_SIZE);
-        usb_prepare_transfer(xfer, buffer, JOYSTICK_SIZE, 0);
-        arm_dcache_flush_delete(buffer, TX_BUFSIZE);
-        usb_transmit(JOYSTICK_ENDPOINT, xfer);
-        if (++head >= TX_NUM) head = 0;
-        tx_head = head;
-        return 0;
+	memcpy(sent_data, buffer, JOYSTICK_SIZE);
+	usb_prepare_transfer(xfer, buffer, JOYSTICK_SIZE, 0);
+	dma_buffer_to_device(buffer, TX_BUFSIZE);
+	usb_transmit(JOYSTICK_ENDPOINT, xfer);
+	if (++head >= TX_NUM) head = 0;
+	tx_head = head;
+	return 0;
+}
+
+int usb_joystick_send()
+{
+	if (!usb_configuration) return -1;
+	uint32_t wait_begin_at = systick_millis_count;
+	while (1) {
+		NVIC_DISABLE_IRQ(IRQ_USB1);
+		int r = tx_send();
+		NVIC_ENABLE_IRQ(IRQ_USB1);
+		if (r == 0) {
+			transmit_previous_timeout = 0;
+			return 0;
+		}
+		if (transmit_previous_timeout) return -1;
+		if (systick_millis_count - wait_begin_at > TX_TIMEOUT_MSEC) {
+			// waited too long, assume the USB host isn't listening
+			transmit_previous_timeout = 1;
+			return -1;
+		}
+		if (!usb_configuration) return -1;
+		yield();
+	}
+}
+
+// In frame mode, the start of frame interrupt sends the report only when
+// usb_joystick_data differs from the last report sent.  With bInterval 1
+// at 480 Mbit/sec, the host receives changes within 125 us.
+void usb_joystick_frame_mode(uint8_t enable)
+{
+	if (enable) {
+		frame_mode = 1;
+		usb_start_sof_interrupts(JOYSTICK_INTERFACE);
+	} else if (frame_mode) {
+		frame_mode = 0;
+		usb_stop_sof_interrupts(JOYSTICK_INTERFACE);
+	}
+}
+
+// Changes between begin and end of an update are sent together, never as
+// a partially updated report.  Updates may be nested.
+void usb_joystick_begin_update(void)
+{
+	__disable_irq();
+	update_nesting++;
+	__enable_irq();
+}
+
+void usb_joystick_end_update(void)
+{
+	__disable_irq();
+	if (update_nesting) update_nesting--;
+	__enable_irq();
+}
+
+// called by the start of frame interrupt, when in frame mode
+void usb_joystick_sof_flush(void)
+{
+	if (!frame_mode || update_nesting || !usb_configuration) return;
+	if (memcmp(sent_data, usb_joystick_data, JOYSTICK_SIZE) != 0) {
+		// if the controller still holds every buffer, try again next frame
+		tx_send();
+	}
 }
 
 
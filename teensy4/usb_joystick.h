@@ -43,6 +43,10 @@ extern "C" {
 #endif
 void usb_joystick_configure(void);
 int usb_joystick_send(void);
+void usb_joystick_frame_mode(uint8_t enable);
+void usb_joystick_begin_update(void);
+void usb_joystick_end_update(void);
+void usb_joystick_sof_flush(void);
 extern uint32_t usb_joystick_data[(JOYSTICK_SIZE+3)/4];
 extern volatile uint8_t usb_configuration;
 #ifdef __cplusplus
@@ -168,12 +172,29 @@ class usb_joystick_class
         }
 #endif
 	void useManualSend(bool mode) {
-		manual_mode = mode;
+		if (mode) manual_mode |= MANUAL_SEND;
+		else manual_mode &= ~MANUAL_SEND;
+	}
+	// send only changes, at most once per USB frame (125 us at 480 Mbit/sec)
+	void useFrameSend(bool mode) {
+		if (mode) manual_mode |= FRAME_SEND;
+		else manual_mode &= ~FRAME_SEND;
+		usb_joystick_frame_mode(mode);
+	}
+	// keep many axes & buttons together in the same report (frame mode)
+	void beginUpdate(void) {
+		usb_joystick_begin_update();
+	}
+	void endUpdate(void) {
+		usb_joystick_end_update();
 	}
 	void send_now(void) {
 		usb_joystick_send();
 	}
 	private:
+	// nonzero if changes are not sent immediately, for either reason
+	static const uint8_t MANUAL_SEND = 0x01;
+	static const uint8_t FRAME_SEND = 0x02;
 	static uint8_t manual_mode;
 #if JOYSTICK_SIZE == 64
 	void analog16(unsigned int num, unsigned int value) {
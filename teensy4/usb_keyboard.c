@@ -47,14 +47,36 @@ uint8_t keyboard_modifier_keys=0;
 // which keys are currently pressed, up to 6 keys may be down at once
 uint8_t keyboard_keys[6]={0,0,0,0,0,0};
 
+#ifdef KEYBOARD_NKRO
+// with N-key rollover, a bitmap of every pressed key, by HID usage code.
+// keyboard_keys also holds the first 6, for boot protocol.
+uint8_t keyboard_nkro_keys[KEYBOARD_NKRO_KEYS / 8];
+#endif
+
+// the keys and modifiers in the last report given to the USB controller
+static uint8_t keyboard_sent_modifier=0;
+static uint8_t keyboard_sent_keys[224 / 8];
+
+// when coalescing, key changes are only recorded and the report is sent
+// at the next USB start of frame (every 125 us at 480 Mbit/sec)
+static uint8_t keyboard_coalesce=0;
+static volatile uint8_t keyboard_report_pending=0;
+
+// a key pressed by usb_keyboard_write, waiting to be released
+static volatile uint8_t typing_active=0;
+static uint8_t typing_key=0, typing_modifier=0;
+static uint8_t typing_next_key, typing_next_modifier;
+static volatile uint8_t typing_idle=0;
+
 #ifdef KEYMEDIA_INTERFACE
 uint16_t keymedia_consumer_keys[4];
 uint8_t keymedia_system_keys[3];
 #endif
 
-// protocol setting from the host.  We use exactly the same report
-// either way, so this variable only stores the setting since we
-// are required to be able to report which setting is in use.
+// protocol setting from the host.  Without KEYBOARD_NKRO we use exactly
+// the same report either way, so this variable only stores the setting
+// since we are required to be able to report which setting is in use.
+// With KEYBOARD_NKRO, boot protocol (0) sends the standard 6 key report.
 uint8_t keyboard_protocol=1;
 
 // the idle configuration, how often we send the report to the
@@ -75,6 +97,12 @@ static uint8_t keycode_to_modifier(KEYCODE_TYPE keycode);
 static uint8_t keycode_to_key(KEYCODE_TYPE keycode);
 static void usb_keyboard_press_key(uint8_t key, uint8_t modifier);
 static void usb_keyboard_release_key(uint8_t key, uint8_t modifier);
+static void usb_keyboard_changed(uint8_t key, uint8_t modifier);
+static void usb_keyboard_report_changed(void);
+static void typing_release(void);
+static int usb_keyboard_transmit(int endpoint, uint32_t (*report)(uint8_t *buffer));
+static int tx_send(int endpoint, uint32_t (*report)(uint8_t *buffer));
+static uint32_t keyboard_report(uint8_t *buffer);
 #ifdef DEADKEYS_MASK
 static KEYCODE_TYPE deadkey_to_keycode(KEYCODE_TYPE keycode);
 #endif
@@ -92,7 +120,7 @@ static int usb_keymedia_send(void);
 static transfer_t tx_transfer[TX_NUM] __attribute__ ((used, aligned(32)));
 DMAMEM static uint8_t txbuffer[TX_NUM * TX_BUFSIZE] __attribute__ ((aligned(32)));
 static uint8_t tx_head=0;
-#if KEYBOARD_SIZE > TX_BUFSIZE
+#if KEYBOARD_PACKET_SIZE > TX_BUFSIZE
 #error "Internal error, transmit buffer size is too small for keyboard endpoint"
 #endif
 #if defined(KEYMEDIA_INTERFACE) && KEYMEDIA_SIZE > TX_BUFSIZE
@@ -104,7 +132,9 @@ void usb_keyboard_configure(void)
 {
 	memset(tx_transfer, 0, sizeof(tx_transfer));
 	tx_head = 0;
-	usb_config_tx(KEYBOARD_ENDPOINT, KEYBOARD_SIZE, 0, NULL);  // normal keys use 8 byte packet
+	keyboard_protocol = 1;
+	typing_active = 0;
+	usb_config_tx(KEYBOARD_ENDPOINT, KEYBOARD_PACKET_SIZE, 0, NULL);  // normal keys use 8 byte packet
 #ifdef KEYMEDIA_INTERFACE
 	usb_config_tx(KEYMEDIA_ENDPOINT, KEYMEDIA_SIZE, 0, NULL);  // media keys use 8 byte packet
 #endif
@@ -274,27 +304,65 @@ void usb_keyboard_write_unicode(uint16_t cpoint)
 
 // Step #4: do each keystroke
 //
+// Text is typed by queueing reports into the transmit ring, which the
+// host drains at its polling rate.  When the next character uses a
+// different key with the same modifiers, one report releases the prior
+// key and presses the next, so most characters need only 1 report.  The
+// last key is released by the start of frame interrupt, after it has
+// been held for at least 1 frame with no more typing.
+static uint32_t typing_keys(uint8_t *buffer, uint8_t key, uint8_t modifier)
+{
+	keyboard_modifier_keys = modifier;
+	keyboard_keys[0] = key;
+	keyboard_keys[1] = 0;
+	keyboard_keys[2] = 0;
+	keyboard_keys[3] = 0;
+	keyboard_keys[4] = 0;
+	keyboard_keys[5] = 0;
+#ifdef KEYBOARD_NKRO
+	memset(keyboard_nkro_keys, 0, sizeof(keyboard_nkro_keys));
+#endif
+	typing_key = key;
+	typing_modifier = modifier;
+	typing_active = (key || modifier);
+	return keyboard_report(buffer);
+}
+
+static uint32_t typing_report(uint8_t *buffer)
+{
+	return typing_keys(buffer, typing_next_key, typing_next_modifier);
+}
+
+// release everything, used from the start of frame interrupt
+static uint32_t typing_release_report(uint8_t *buffer)
+{
+	return typing_keys(buffer, 0, 0);
+}
+
+// release the last typed key, before other keyboard functions use the keys
+static void typing_release(void)
+{
+	if (typing_active) {
+		typing_next_key = 0;
+		typing_next_modifier = 0;
+		usb_keyboard_transmit(KEYBOARD_ENDPOINT, typing_report);
+	}
+}
+
 static void write_key(KEYCODE_TYPE keycode)
 {
-/*
-	uint8_t key, modifier=0;
+	uint8_t key = keycode_to_key(keycode);
+	uint8_t modifier = keycode_to_modifier(keycode);
 
-	#ifdef SHIFT_MASK
-	if (keycode & SHIFT_MASK) modifier |= MODIFIERKEY_SHIFT;
-	#endif
-	#ifdef ALTGR_MASK
-	if (keycode & ALTGR_MASK) modifier |= MODIFIERKEY_RIGHT_ALT;
-	#endif
-	#ifdef RCTRL_MASK
-	if (keycode & RCTRL_MASK) modifier |= MODIFIERKEY_RIGHT_CTRL;
-	#endif
-	key = keycode & 0x3F;
-	#ifdef KEY_NON_US_100
-	if (key == KEY_NON_US_100) key = 100;
-	#endif
-	usb_keyboard_press(key, modifier);
-*/
-	usb_keyboard_press(keycode_to_key(keycode), keycode_to_modifier(keycode));
+	if (typing_active && (typing_key == key || typing_modifier != modifier)) {
+		typing_release();
+	}
+	typing_next_key = key;
+	typing_next_modifier = modifier;
+	typing_idle = 0;
+	if (usb_keyboard_transmit(KEYBOARD_ENDPOINT, typing_report) == 0) {
+		usb_start_sof_interrupts(KEYBOARD_INTERFACE);
+	}
 }
 
 static uint8_t keycode_to_modifier(KEYCODE_TYPE keycode)
@@ -425,6 +493,7 @@ static void usb_keyboard_press_key(uint8_t key, uint8_t modifier)
 {
 	int i, send_required = 0;
 
+	usb_keyboard_changed(key, modifier);
 	if (modifier) {
 		if ((keyboard_modifier_keys & modifier) != modifier) {
 			keyboard_modifier_keys |= modifier;
@@ -432,6 +501,15 @@ static void usb_keyboard_press_key(uint8_t key, uint8_t modifier)
 		}
 	}
 	if (key) {
+#ifdef KEYBOARD_NKRO
+		if (key < KEYBOARD_NKRO_KEYS) {
+			uint8_t mask = 1 << (key & 7);
+			if (!(keyboard_nkro_keys[key >> 3] & mask)) {
+				keyboard_nkro_keys[key >> 3] |= mask;
+				send_required = 1;
+			}
+		}
+#endif
 		for (i=0; i < 6; i++) {
 			if (keyboard_keys[i] == key) goto end;
 		}
@@ -444,7 +522,7 @@ static void usb_keyboard_press_key(uint8_t key, uint8_t modifier)
 		}
 	}
 	end:
-	if (send_required) usb_keyboard_send();
+	if (send_required) usb_keyboard_report_changed();
 }
 
 
@@ -452,6 +530,7 @@ static void usb_keyboard_release_key(uint8_t key, uint8_t modifier)
 {
 	int i, send_required = 0;
 
+	usb_keyboard_changed(key, modifier);
 	if (modifier) {
 		if ((keyboard_modifier_keys & modifier) != 0) {
 			keyboard_modifier_keys &= ~modifier;
@@ -459,6 +538,15 @@ static void usb_keyboard_release_key(uint8_t key, uint8_t modifier)
 		}
 	}
 	if (key) {
+#ifdef KEYBOARD_NKRO
+		if (key < KEYBOARD_NKRO_KEYS) {
+			uint8_t mask = 1 << (key & 7);
+			if (keyboard_nkro_keys[key >> 3] & mask) {
+				keyboard_nkro_keys[key >> 3] &= ~mask;
+				send_required = 1;
+			}
+		}
+#endif
 		for (i=0; i < 6; i++) {
 			if (keyboard_keys[i] == key) {
 				keyboard_keys[i] = 0;
@@ -466,19 +554,65 @@ static void usb_keyboard_release_key(uint8_t key, uint8_t modifier)
 			}
 		}
 	}
-	if (send_required) usb_keyboard_send();
+	if (send_required) usb_keyboard_report_changed();
+}
+
+// is a key currently pressed?
+static int key_is_pressed(uint8_t key)
+{
+	int i;
+#ifdef KEYBOARD_NKRO
+	if (key < KEYBOARD_NKRO_KEYS && (keyboard_nkro_keys[key >> 3] & (1 << (key & 7)))) {
+		return 1;
+	}
+#endif
+	for (i=0; i < 6; i++) {
+		if (keyboard_keys[i] == key) return 1;
+	}
+	return 0;
+}
+
+// Before changing a key or modifier, send any coalesced report where it
+// already differs from what the host last saw.  Otherwise a quick press
+// and release (as from Keyboard.write) would merge into no change at all.
+static void usb_keyboard_changed(uint8_t key, uint8_t modifier)
+{
+	typing_release();
+	if (!keyboard_report_pending) return;
+	if ((keyboard_modifier_keys ^ keyboard_sent_modifier) & modifier) {
+		usb_keyboard_send();
+	} else if (key && key < 224) {
+		int sent = (keyboard_sent_keys[key >> 3] >> (key & 7)) & 1;
+		if (sent != key_is_pressed(key)) usb_keyboard_send();
+	}
+}
+
+static void usb_keyboard_report_changed(void)
+{
+	if (keyboard_coalesce) {
+		keyboard_report_pending = 1;
+	} else {
+		usb_keyboard_send();
+	}
 }
 
 void usb_keyboard_release_all(void)
 {
 	uint8_t i, anybits;
 
+	typing_release();
 	anybits = keyboard_modifier_keys;
 	keyboard_modifier_keys = 0;
 	for (i=0; i < 6; i++) {
 		anybits |= keyboard_keys[i];
 		keyboard_keys[i] = 0;
 	}
+#ifdef KEYBOARD_NKRO
+	for (i=0; i < KEYBOARD_NKRO_KEYS / 8; i++) {
+		anybits |= keyboard_nkro_keys[i];
+		keyboard_nkro_keys[i] = 0;
+	}
+#endif
 	if (anybits) usb_keyboard_send();
 #ifdef KEYMEDIA_INTERFACE
 	anybits = 0;
@@ -505,6 +639,9 @@ int usb_keyboard_press(uint8_t key, uint8_t modifier)
 	keyboard_keys[3] = 0;
 	keyboard_keys[4] = 0;
 	keyboard_keys[5] = 0;
+#ifdef KEYBOARD_NKRO
+	memset(keyboard_nkro_keys, 0, sizeof(keyboard_nkro_keys));
+#endif
 	r = usb_keyboard_send();
 	if (r) return r;
 	keyboard_modifier_keys = 0;
@@ -518,22 +655,17 @@ static uint8_t transmit_previous_timeout=0;
 // When the PC isn't listening, how long do we wait before discarding data?
 #define TX_TIMEOUT_MSEC 50
 
-static int usb_keyboard_transmit(int endpoint, const uint8_t *data, uint32_t len)
+static int usb_keyboard_transmit(int endpoint, uint32_t (*report)(uint8_t *buffer))
 {
 	if (!usb_configuration) return -1;
-	uint32_t head = tx_head;
-	transfer_t *xfer = tx_transfer + head;
 	uint32_t wait_begin_at = systick_millis_count;
 	while (1) {
-		uint32_t status = usb_transfer_status(xfer);
-		if (!(status & 0x80)) {
-			if (status & 0x68) {
-				// TODO: what if status has errors???
-				printf("ERROR status = %x, i=%d, ms=%u\n",
-					status, tx_head, systick_millis_count);
-			}
+		NVIC_DISABLE_IRQ(IRQ_USB1);
+		int r = tx_send(endpoint, report);
+		NVIC_ENABLE_IRQ(IRQ_USB1);
+		if (r == 0) {
 			transmit_previous_timeout = 0;
-			break;
+			return 0;
 		}
 		if (transmit_previous_timeout) return -1;
 		if (systick_millis_count - wait_begin_at > TX_TIMEOUT_MSEC) {
@@ -544,11 +676,26 @@ static int usb_keyboard_transmit(int endpoint, const uint8_t *data, uint32_t len
 		if (!usb_configuration) return -1;
 		yield();
 	}
+}
+
+// Give a report to the USB controller, if the next transfer_t is free.
+// Must be called with the USB interrupt disabled, or from the interrupt.
+static int tx_send(int endpoint, uint32_t (*report)(uint8_t *buffer))
+{
+	uint32_t head = tx_head;
+	transfer_t *xfer = tx_transfer + head;
+	uint32_t status = usb_transfer_status(xfer);
+	if (status & 0x80) return -1;
+	if (status & 0x68) {
+		// TODO: what if status has errors???
+		printf("ERROR status = %x, i=%d, ms=%u\n",
+			status, tx_head, systick_millis_count);
+	}
 	delayNanoseconds(30); // min req'd 11 ns, TODO: why is status ready too soon?
 	uint8_t *buffer = txbuffer + head * TX_BUFSIZE;
-	memcpy(buffer, data, len);
+	uint32_t len = report(buffer);
 	usb_prepare_transfer(xfer, buffer, len, 0);
-	arm_dcache_flush_delete(buffer, TX_BUFSIZE);
+	dma_buffer_to_device(buffer, TX_BUFSIZE);
 	usb_transmit(endpoint, xfer);
 	if (++head >= TX_NUM) head = 0;
 	tx_head = head;
@@ -556,19 +703,74 @@ static int usb_keyboard_transmit(int endpoint, const uint8_t *data, uint32_t len
 }
 
 
-// send the contents of keyboard_keys and keyboard_modifier_keys
-int usb_keyboard_send(void)
+// build a report from keyboard_keys and keyboard_modifier_keys, and
+// remember what it contained for usb_keyboard_changed()
+static uint32_t keyboard_report(uint8_t *buffer)
 {
-	uint8_t buffer[KEYBOARD_SIZE];
+	uint32_t i, len;
+
+	keyboard_report_pending = 0;
 	buffer[0] = keyboard_modifier_keys;
+	keyboard_sent_modifier = keyboard_modifier_keys;
+	memset(keyboard_sent_keys, 0, sizeof(keyboard_sent_keys));
+#ifdef KEYBOARD_NKRO
+	if (keyboard_protocol) {
+		// report protocol: modifiers, then one bit per key
+		memcpy(keyboard_sent_keys, keyboard_nkro_keys, KEYBOARD_NKRO_KEYS / 8);
+		for (i=0; i < 6; i++) {
+			uint8_t key = keyboard_keys[i];
+			if (key && key < 224) keyboard_sent_keys[key >> 3] |= 1 << (key & 7);
+		}
+		memcpy(buffer + 1, keyboard_sent_keys, KEYBOARD_NKRO_KEYS / 8);
+		return KEYBOARD_REPORT_SIZE;
+	}
+#endif
+	// boot protocol: modifiers, reserved, and up to 6 keys
 	buffer[1] = 0;
-	buffer[2] = keyboard_keys[0];
-	buffer[3] = keyboard_keys[1];
-	buffer[4] = keyboard_keys[2];
-	buffer[5] = keyboard_keys[3];
-	buffer[6] = keyboard_keys[4];
-	buffer[7] = keyboard_keys[5];
-	return usb_keyboard_transmit(KEYBOARD_ENDPOINT, buffer, KEYBOARD_SIZE);
+	len = 2;
+	for (i=0; i < 6; i++) {
+		uint8_t key = keyboard_keys[i];
+		buffer[len++] = key;
+		if (key && key < 224) keyboard_sent_keys[key >> 3] |= 1 << (key & 7);
+	}
+	return 8;
+}
+
+// send the contents of keyboard_keys and keyboard_modifier_keys
+int usb_keyboard_send(void)
+{
+	return usb_keyboard_transmit(KEYBOARD_ENDPOINT, keyboard_report);
+}
+
+// Enable or disable coalescing of key changes.  When enabled, presses and
+// releases only update the key state, and the report is transmitted once
+// per USB frame (125 us microframe at 480 Mbit/sec, 1 ms at 12 Mbit/sec).
+void usb_keyboard_set_coalesce(uint8_t enable)
+{
+	if (enable) {
+		keyboard_coalesce = 1;
+		usb_start_sof_interrupts(KEYBOARD_INTERFACE);
+	} else if (keyboard_coalesce) {
+		keyboard_coalesce = 0;
+		if (!typing_active) usb_stop_sof_interrupts(KEYBOARD_INTERFACE);
+		if (keyboard_report_pending) usb_keyboard_send();
+	}
+}
+
+// called by the start of frame interrupt, when coalescing key changes
+// or a typed key remains pressed
+void usb_keyboard_sof_flush(void)
+{
+	if (!usb_configuration) return;
+	// if the controller still holds every buffer, try again next frame
+	if (keyboard_report_pending) {
+		tx_send(KEYBOARD_ENDPOINT, keyboard_report);
+	}
+	if (typing_active && ++typing_idle >= 2) {
+		if (tx_send(KEYBOARD_ENDPOINT, typing_release_report) == 0) {
+			if (!keyboard_coalesce) usb_stop_sof_interrupts(KEYBOARD_INTERFACE);
+		}
+	}
 }
 
 
@@ -652,10 +854,9 @@ void usb_keymedia_release_all(void)
 	if (anybits) usb_keymedia_send();
 }
 
-// send the contents of keyboard_keys and keyboard_modifier_keys
-static int usb_keymedia_send(void)
+// build a report from keymedia_consumer_keys and keymedia_system_keys
+static uint32_t keymedia_report(uint8_t *buffer)
 {
-	uint8_t buffer[8];
 	const uint16_t *consumer = keymedia_consumer_keys;
 	// 44444444 44333333 33332222 22222211 11111111
 	// 98765432 10987654 32109876 54321098 76543210
@@ -667,7 +868,13 @@ static int usb_keymedia_send(void)
 	buffer[5] = keymedia_system_keys[0];
 	buffer[6] = keymedia_system_keys[1];
 	buffer[7] = keymedia_system_keys[2];
-	return usb_keyboard_transmit(KEYMEDIA_ENDPOINT, buffer, KEYMEDIA_SIZE);
+	return KEYMEDIA_SIZE;
+}
+
+// send the contents of keymedia_consumer_keys and keymedia_system_keys
+static int usb_keymedia_send(void)
+{
+	return usb_keyboard_transmit(KEYMEDIA_ENDPOINT, keymedia_report);
 }
 
 #endif // KEYMEDIA_INTERFACE
@@ -50,11 +50,16 @@ void usb_keyboard_release_keycode(uint16_t n);
 void usb_keyboard_release_all(void);
 int usb_keyboard_press(uint8_t key, uint8_t modifier);
 int usb_keyboard_send(void);
+void usb_keyboard_set_coalesce(uint8_t enable);
+void usb_keyboard_sof_flush(void);
 #ifdef KEYMEDIA_INTERFACE
 void usb_keymedia_release_all(void);
 #endif
 extern uint8_t keyboard_modifier_keys;
 extern uint8_t keyboard_keys[6];
+#ifdef KEYBOARD_NKRO
+extern uint8_t keyboard_nkro_keys[KEYBOARD_NKRO_KEYS / 8];
+#endif
 extern uint8_t keyboard_protocol;
 extern uint8_t keyboard_idle_config;
 extern uint8_t keyboard_idle_count;
@@ -101,6 +106,8 @@ public:
 	void press(uint16_t n) { usb_keyboard_press_keycode(n); }
 	void release(uint16_t n) { usb_keyboard_release_keycode(n); }
 	void releaseAll(void) { usb_keyboard_release_all(); }
+	// send at most one report per USB frame, combining all changes
+	void setCoalesce(bool enable) { usb_keyboard_set_coalesce(enable); }
 };
 
 extern usb_keyboard_class Keyboard;
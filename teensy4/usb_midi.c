@@ -46,6 +46,11 @@ uint8_t usb_midi_msg_data2;
 // TODO: separate sysex buffers for each cable...
 uint8_t usb_midi_msg_sysex[USB_MIDI_SYSEX_MAX];
 uint16_t usb_midi_msg_sysex_len;
+// optional application buffer, receives large sysex messages in one piece
+uint8_t *usb_midi_sysex_buffer = NULL;
+static uint32_t sysex_buffer_size = 0;
+static uint32_t sysex_buffer_len = 0;
+static void (*sysex_buffer_handler)(uint8_t *data, uint32_t length) = NULL;
 void (*usb_midi_handleNoteOff)(uint8_t ch, uint8_t note, uint8_t vel) = NULL;
 void (*usb_midi_handleNoteOn)(uint8_t ch, uint8_t note, uint8_t vel) = NULL;
 void (*usb_midi_handleVelocityChange)(uint8_t ch, uint8_t note, uint8_t vel) = NULL;
@@ -72,6 +77,8 @@ void (*usb_midi_handleRealTimeSystem)(uint8_t rtb) = NULL;
 //static usb_packet_t *tx_packet=NULL;
 static uint8_t transmit_previous_timeout=0;
 static uint8_t tx_noautoflush=0;
+static uint8_t tx_coalesce_sof=1;
+static volatile uint8_t tx_sof_remaining=0;
 extern volatile uint8_t usb_high_speed;
 
 
@@ -139,11 +146,13 @@ void usb_midi_configure(void)
 // of this 32 bit input.
 void usb_midi_write_packed(uint32_t n)
 {
-	printf("usb_midi_write_packed\n");
-	if (!usb_configuration) return;
-	tx_noautoflush = 1;
-	uint32_t head = tx_head;
-	transfer_t *xfer = tx_transfer + head;
+	usb_midi_write_packed_buffer(&n, 1);
+}
+
+// wait for the current transmit buffer to be usable, return 0 on timeout
+static int tx_wait_buffer(void)
+{
+	transfer_t *xfer = tx_transfer + tx_head;
 	uint32_t wait_begin_at = systick_millis_count;
 	while (!tx_available) {
 		uint32_t status = usb_transfer_status(xfer);
@@ -158,25 +167,46 @@ void usb_midi_write_packed(uint32_t n)
 		if (systick_millis_count - wait_begin_at > TX_TIMEOUT_MSEC) {
 			transmit_previous_timeout = 1;
 		}
-		if (transmit_previous_timeout) return;
-		if (!usb_configuration) return;
+		if (transmit_previous_timeout) return 0;
+		if (!usb_configuration) return 0;
 		yield();
 	}
-	uint32_t *txdata = (uint32_t *)(txbuffer + (tx_head * TX_SIZE) + (TX_SIZE - tx_available));
-	*txdata = n;
-	tx_available -= 4;
-	if (tx_available == 0) {
-		uint8_t *txbuf = txbuffer + (tx_head * TX_SIZE);
-		usb_prepare_transfer(xfer, txbuf, tx_packet_size, 0);
-		arm_dcache_flush_delete(txbuf, TX_SIZE);
-		usb_transmit(MIDI_TX_ENDPOINT, xfer);
-		if (++head >= TX_NUM) head = 0;
-		tx_head = head;
-		usb_stop_sof_interrupts(MIDI_INTERFACE);
-	} else {
-		usb_start_sof_interrupts(MIDI_INTERFACE);
+	return 1;
+}
+
+// Write many packed events, copying as many as fit into each transmit
+// buffer at once.  Returns the number written, less than count only if
+// the PC isn't listening.
+uint32_t usb_midi_write_packed_buffer(const uint32_t *data, uint32_t count)
+{
+	uint32_t written = 0;
+
+	if (!usb_configuration) return 0;
+	tx_noautoflush = 1;
+	while (written < count) {
+		if (!tx_wait_buffer()) break;
+		uint32_t head = tx_head;
+		uint8_t *txbuf = txbuffer + (head * TX_SIZE);
+		uint32_t n = tx_available >> 2;
+		if (n > count - written) n = count - written;
+		if (tx_available == tx_packet_size) tx_sof_remaining = tx_coalesce_sof;
+		memcpy(txbuf + (tx_packet_size - tx_available), data + written, n * 4);
+		tx_available -= n * 4;
+		written += n;
+		if (tx_available == 0) {
+			transfer_t *xfer = tx_transfer + head;
+			usb_prepare_transfer(xfer, txbuf, tx_packet_size, 0);
+			dma_buffer_to_device(txbuf, tx_packet_size);
+			usb_transmit(MIDI_TX_ENDPOINT, xfer);
+			if (++head >= TX_NUM) head = 0;
+			tx_head = head;
+			usb_stop_sof_interrupts(MIDI_INTERFACE);
+		} else {
+			usb_start_sof_interrupts(MIDI_INTERFACE);
+		}
 	}
 	tx_noautoflush = 0;
+	return written;
 }
 
 void usb_midi_flush_output(void)
@@ -189,7 +219,7 @@ void usb_midi_flush_output(void)
 		uint8_t *txbuf = txbuffer + (head * TX_SIZE);
 		uint32_t len = tx_packet_size - tx_available;
 		usb_prepare_transfer(xfer, txbuf, len, 0);
-		arm_dcache_flush_delete(txbuf, TX_SIZE);
+		dma_buffer_to_device(txbuf, len);
 		usb_transmit(MIDI_TX_ENDPOINT, xfer);
 		if (++head >= TX_NUM) head = 0;
 		tx_head = head;
@@ -198,25 +228,60 @@ void usb_midi_flush_output(void)
 	}
 }
 
+// A partly filled packet is normally sent at the next USB start of frame,
+// so events written close together share one packet.  This sets how many
+// frames (1 ms at 12 Mbit/sec, 125 us microframes at 480) it may wait for
+// more events first, trading latency for fewer, fuller packets.  Default 1.
+void usb_midi_set_coalesce_frames(uint8_t frames)
+{
+	tx_coalesce_sof = frames ? frames : 1;
+}
+
+// called by the USB interrupt at each start of frame, while a partly
+// filled packet is waiting
+void usb_midi_sof_flush(void)
+{
+	if (tx_noautoflush == 0 && tx_sof_remaining > 1) {
+		tx_sof_remaining--;
+		return;
+	}
+	usb_midi_flush_output();
+}
+
+// sysex is sent through a small array of packed events, so long messages
+// need one usb_midi_write_packed_buffer() per 16 events rather than per 3 bytes
+#define SYSEX_CHUNK 16
+
 void usb_midi_send_sysex_buffer_has_term(const uint8_t *data, uint32_t length, uint8_t cable)
 {
+	uint32_t buf[SYSEX_CHUNK];
+	uint32_t n = 0;
+
 	cable = (cable & 0x0F) << 4;
-        while (length > 3) {
-                usb_midi_write_packed(0x04 | cable | (data[0] << 8) | (data[1] << 16) | (data[2] << 24));
-                data += 3;
-                length -= 3;
-        }
-        if (length == 3) {
-                usb_midi_write_packed(0x07 | cable | (data[0] << 8) | (data[1] << 16) | (data[2] << 24));
-        } else if (length == 2) {
-                usb_midi_write_packed(0x06 | cable | (data[0] << 8) | (data[1] << 16));
-        } else if (length == 1) {
-                usb_midi_write_packed(0x05 | cable | (data[0] << 8));
-        }
+	while (length > 3) {
+		buf[n++] = 0x04 | cable | (data[0] << 8) | (data[1] << 16) | (data[2] << 24);
+		if (n >= SYSEX_CHUNK) {
+			usb_midi_write_packed_buffer(buf, n);
+			n = 0;
+		}
+		data += 3;
+		length -= 3;
+	}
+	if (length == 3) {
+		buf[n++] = 0x07 | cable | (data[0] << 8) | (data[1] << 16) | (data[2] << 24);
+	} else if (length == 2) {
+		buf[n++] = 0x06 | cable | (data[0] << 8) | (data[1] << 16);
+	} else if (length == 1) {
+		buf[n++] = 0x05 | cable | (data[0] << 8);
+	}
+	if (n > 0) usb_midi_write_packed_buffer(buf, n);
 }
 
 void usb_midi_send_sysex_add_term_bytes(const uint8_t *data, uint32_t length, uint8_t cable)
 {
+	uint32_t buf[SYSEX_CHUNK];
+	uint32_t n = 0;
+
 	cable = (cable & 0x0F) << 4;
 
 	if (length == 0) {
@@ -226,22 +291,27 @@ void usb_midi_send_sysex_add_term_bytes(const uint8_t *data, uint32_t length, ui
 		usb_midi_write_packed(0x07 | cable | (0xF0 << 8) | (data[0] << 16) | (0xF7 << 24));
 		return;
 	} else {
-		usb_midi_write_packed(0x04 | cable | (0xF0 << 8) | (data[0] << 16) | (data[1] << 24));
+		buf[n++] = 0x04 | cable | (0xF0 << 8) | (data[0] << 16) | (data[1] << 24);
 		data += 2;
 		length -= 2;
 	}
 	while (length >= 3) {
-		usb_midi_write_packed(0x04 | cable | (data[0] << 8) | (data[1] << 16) | (data[2] << 24));
+		buf[n++] = 0x04 | cable | (data[0] << 8) | (data[1] << 16) | (data[2] << 24);
+		if (n >= SYSEX_CHUNK) {
+			usb_midi_write_packed_buffer(buf, n);
+			n = 0;
+		}
 		data += 3;
 		length -= 3;
 	}
 	if (length == 2) {
-		usb_midi_write_packed(0x07 | cable | (data[0] << 8) | (data[1] << 16) | (0xF7 << 24));
+		buf[n++] = 0x07 | cable | (data[0] << 8) | (data[1] << 16) | (0xF7 << 24);
 	} else if (length == 1) {
-                usb_midi_write_packed(0x06 | cable | (data[0] << 8) | (0xF7 << 16));
+		buf[n++] = 0x06 | cable | (data[0] << 8) | (0xF7 << 16);
 	} else {
-                usb_midi_write_packed(0x05 | cable | (0xF7 << 8));
+		buf[n++] = 0x05 | cable | (0xF7 << 8);
 	}
+	usb_midi_write_packed_buffer(buf, n);
 }
 
 void static sysex_byte(uint8_t b)
@@ -256,6 +326,43 @@ void static sysex_byte(uint8_t b)
 	}
 }
 
+// Store "count" data bytes of a packed event directly into the application's
+// buffer.  Bytes beyond its size are counted but discarded, so the length
+// given to the handler tells the application how much it missed.
+void static sysex_buffer_bytes(uint32_t n, uint32_t count)
+{
+	uint32_t len = sysex_buffer_len;
+	uint32_t size = sysex_buffer_size;
+	uint8_t *p = usb_midi_sysex_buffer + len;
+
+	if (len + count <= size) {
+		*p++ = n >> 8;
+		if (count > 1) *p++ = n >> 16;
+		if (count > 2) *p = n >> 24;
+	} else {
+		for (uint32_t i=0; i < count; i++) {
+			if (len + i < size) *p++ = n >> (8 + i * 8);
+		}
+	}
+	sysex_buffer_len = len + count;
+}
+
+// Register a buffer for incoming sysex.  While set, sysex bytes are decoded
+// from the USB packets straight into this buffer and the handler is called
+// once per message, with the total length.  A length larger than size means
+// the message was truncated.  The buffer may be in any memory, including
+// EXTMEM.  Pass NULL to go back to the built-in buffer and handlers.
+void usb_midi_set_sysex_buffer(uint8_t *buffer, uint32_t size,
+	void (*handler)(uint8_t *data, uint32_t length))
+{
+	__disable_irq();
+	usb_midi_sysex_buffer = buffer;
+	sysex_buffer_size = buffer ? size : 0;
+	sysex_buffer_len = 0;
+	sysex_buffer_handler = buffer ? handler : NULL;
+	__enable_irq();
+}
+
 
 
 
@@ -266,7 +373,7 @@ static void rx_queue_transfer(int i)
 	NVIC_DISABLE_IRQ(IRQ_USB1);
 	void *buffer = rx_buffer + i * MIDI_RX_SIZE_480;
 	usb_prepare_transfer(rx_transfer + i, buffer, rx_packet_size, i);
-	arm_dcache_delete(buffer, rx_packet_size);
+	dma_buffer_from_device(buffer, rx_packet_size);
 	usb_receive(MIDI_RX_ENDPOINT, rx_transfer + i);
 	NVIC_ENABLE_IRQ(IRQ_USB1);
 }
@@ -322,183 +429,362 @@ uint32_t usb_midi_read_message(void)
 	return n;
 }
 
-int usb_midi_read(uint32_t channel)
+// Incoming events are decoded through two tables of small functions.  The
+// first is indexed by the Code Index Number (low 4 bits of the 32 bit USB
+// event), the second by the low nibble of system common / realtime status
+// bytes.  Each function runs the user's handler and fills in the usbMIDI
+// message variables, returning 1 when a complete message was received.
+
+typedef int (*midi_cin_function_t)(uint32_t n, uint32_t channel);
+typedef int (*midi_system_function_t)(uint32_t n);
+
+static inline int midi_message(uint32_t n, uint32_t type)
 {
-	uint32_t n, ch, type1, type2, b1;
-	
-	n = usb_midi_read_message();
-	if (n == 0) return 0;
-	type1 = n & 15;
-	type2 = (n >> 12) & 15;
-	b1 = (n >> 8) & 0xFF;
-	ch = (b1 & 15) + 1;
-	usb_midi_msg_cable = (n >> 4) & 15;
-	if (type1 >= 0x08 && type1 <= 0x0E) {
-		if (channel && channel != ch) {
-			// ignore other channels when user wants single channel read
-			return 0;
-		}
-		if (type1 == 0x08 && type2 == 0x08) {
-			usb_midi_msg_type = 0x80;		// 0x80 = usbMIDI.NoteOff
-			if (usb_midi_handleNoteOff)
-				(*usb_midi_handleNoteOff)(ch, (n >> 16), (n >> 24));
-		} else
-		if (type1 == 0x09 && type2 == 0x09) {
-			if ((n >> 24) > 0) {
-				usb_midi_msg_type = 0x90;	// 0x90 = usbMIDI.NoteOn
-				if (usb_midi_handleNoteOn)
-					(*usb_midi_handleNoteOn)(ch, (n >> 16), (n >> 24));
-			} else {
-				usb_midi_msg_type = 0x80;	// 0x80 = usbMIDI.NoteOff
-				if (usb_midi_handleNoteOff)
-					(*usb_midi_handleNoteOff)(ch, (n >> 16), (n >> 24));
-			}
-		} else
-		if (type1 == 0x0A && type2 == 0x0A) {
-			usb_midi_msg_type = 0xA0;		// 0xA0 = usbMIDI.AfterTouchPoly
-			if (usb_midi_handleVelocityChange)
-				(*usb_midi_handleVelocityChange)(ch, (n >> 16), (n >> 24));
-		} else
-		if (type1 == 0x0B && type2 == 0x0B) {
-			usb_midi_msg_type = 0xB0;		// 0xB0 = usbMIDI.ControlChange
-			if (usb_midi_handleControlChange)
-				(*usb_midi_handleControlChange)(ch, (n >> 16), (n >> 24));
-		} else
-		if (type1 == 0x0C && type2 == 0x0C) {
-			usb_midi_msg_type = 0xC0;		// 0xC0 = usbMIDI.ProgramChange
-			if (usb_midi_handleProgramChange)
-				(*usb_midi_handleProgramChange)(ch, (n >> 16));
-		} else
-		if (type1 == 0x0D && type2 == 0x0D) {
-			usb_midi_msg_type = 0xD0;		// 0xD0 = usbMIDI.AfterTouchChannel
-			if (usb_midi_handleAfterTouch)
-				(*usb_midi_handleAfterTouch)(ch, (n >> 16));
-		} else
-		if (type1 == 0x0E && type2 == 0x0E) {
-			usb_midi_msg_type = 0xE0;		// 0xE0 = usbMIDI.PitchBend
-			if (usb_midi_handlePitchChange) {
-				int value = ((n >> 16) & 0x7F) | ((n >> 17) & 0x3F80);
-				value -= 8192; // 0 to 16383 --> -8192 to +8191
-				(*usb_midi_handlePitchChange)(ch, value);
-			}
-		} else {
-			return 0;
-		}
-		return_message:
-		usb_midi_msg_channel = ch;
-		usb_midi_msg_data1 = (n >> 16);
-		usb_midi_msg_data2 = (n >> 24);
-		return 1;
+	usb_midi_msg_type = type;
+	usb_midi_msg_channel = ((n >> 8) & 15) + 1;
+	usb_midi_msg_data1 = (n >> 16);
+	usb_midi_msg_data2 = (n >> 24);
+	return 1;
+}
+
+// channel voice messages: returns the MIDI channel if the message should be
+// processed, or zero if it is malformed or for another channel
+static inline uint32_t voice_channel(uint32_t n, uint32_t channel)
+{
+	uint32_t ch = ((n >> 8) & 15) + 1;
+	if (((n >> 12) & 15) != (n & 15)) return 0;
+	if (channel && channel != ch) {
+		// ignore other channels when user wants single channel read
+		return 0;
 	}
-	if (type1 == 0x02 || type1 == 0x03 || (type1 == 0x05 && b1 >= 0xF1 && b1 != 0xF7)) {
-		// system common or system realtime message
-		system_common_or_realtime:
-		switch (b1) {
-		  case 0xF1: // usbMIDI.TimeCodeQuarterFrame
-			if (usb_midi_handleTimeCodeQuarterFrame) {
-				(*usb_midi_handleTimeCodeQuarterFrame)(n >> 16);
-			}
-			break;
-		  case 0xF2: // usbMIDI.SongPosition
-			if (usb_midi_handleSongPosition) {
-				(*usb_midi_handleSongPosition)(
-				  ((n >> 16) & 0x7F) | ((n >> 17) & 0x3F80));
-			}
-			break;
-		  case 0xF3: // usbMIDI.SongSelect
-			if (usb_midi_handleSongSelect) {
-				(*usb_midi_handleSongSelect)(n >> 16);
-			}
-			break;
-		  case 0xF6: // usbMIDI.TuneRequest
-			if (usb_midi_handleTuneRequest) {
-				(*usb_midi_handleTuneRequest)();
-			}
-			break;
-		  case 0xF8: // usbMIDI.Clock
-			if (usb_midi_handleClock) {
-				(*usb_midi_handleClock)();
-			} else if (usb_midi_handleRealTimeSystem) {
-				(*usb_midi_handleRealTimeSystem)(0xF8);
-			}
-			break;
-		  case 0xFA: // usbMIDI.Start
-			if (usb_midi_handleStart) {
-				(*usb_midi_handleStart)();
-			} else if (usb_midi_handleRealTimeSystem) {
-				(*usb_midi_handleRealTimeSystem)(0xFA);
-			}
-			break;
-		  case 0xFB: // usbMIDI.Continue
-			if (usb_midi_handleContinue) {
-				(*usb_midi_handleContinue)();
-			} else if (usb_midi_handleRealTimeSystem) {
-				(*usb_midi_handleRealTimeSystem)(0xFB);
-			}
-			break;
-		  case 0xFC: // usbMIDI.Stop
-			if (usb_midi_handleStop) {
-				(*usb_midi_handleStop)();
-			} else if (usb_midi_handleRealTimeSystem) {
-				(*usb_midi_handleRealTimeSystem)(0xFC);
-			}
-			break;
-		  case 0xFE: // usbMIDI.ActiveSensing
-			if (usb_midi_handleActiveSensing) {
-				(*usb_midi_handleActiveSensing)();
-			} else if (usb_midi_handleRealTimeSystem) {
-				(*usb_midi_handleRealTimeSystem)(0xFE);
-			}
-			break;
-		  case 0xFF: // usbMIDI.SystemReset
-			if (usb_midi_handleSystemReset) {
-				(*usb_midi_handleSystemReset)();
-			} else if (usb_midi_handleRealTimeSystem) {
-				(*usb_midi_handleRealTimeSystem)(0xFF);
-			}
-			break;
-		  default:
-			return 0; // unknown message, ignore it
-		}
-		usb_midi_msg_type = b1;
-		goto return_message;
+	return ch;
+}
+
+static int cin_ignore(uint32_t n, uint32_t channel)
+{
+	return 0;
+}
+
+static int cin_note_off(uint32_t n, uint32_t channel)
+{
+	uint32_t ch = voice_channel(n, channel);
+	if (!ch) return 0;
+	if (usb_midi_handleNoteOff)
+		(*usb_midi_handleNoteOff)(ch, (n >> 16), (n >> 24));
+	return midi_message(n, 0x80);			// 0x80 = usbMIDI.NoteOff
+}
+
+static int cin_note_on(uint32_t n, uint32_t channel)
+{
+	uint32_t ch = voice_channel(n, channel);
+	if (!ch) return 0;
+	if ((n >> 24) > 0) {
+		if (usb_midi_handleNoteOn)
+			(*usb_midi_handleNoteOn)(ch, (n >> 16), (n >> 24));
+		return midi_message(n, 0x90);		// 0x90 = usbMIDI.NoteOn
 	}
-	if (type1 == 0x04) {
-		sysex_byte(n >> 8);
-		sysex_byte(n >> 16);
-		sysex_byte(n >> 24);
+	if (usb_midi_handleNoteOff)
+		(*usb_midi_handleNoteOff)(ch, (n >> 16), (n >> 24));
+	return midi_message(n, 0x80);			// 0x80 = usbMIDI.NoteOff
+}
+
+static int cin_poly_pressure(uint32_t n, uint32_t channel)
+{
+	uint32_t ch = voice_channel(n, channel);
+	if (!ch) return 0;
+	if (usb_midi_handleVelocityChange)
+		(*usb_midi_handleVelocityChange)(ch, (n >> 16), (n >> 24));
+	return midi_message(n, 0xA0);			// 0xA0 = usbMIDI.AfterTouchPoly
+}
+
+static int cin_control_change(uint32_t n, uint32_t channel)
+{
+	uint32_t ch = voice_channel(n, channel);
+	if (!ch) return 0;
+	if (usb_midi_handleControlChange)
+		(*usb_midi_handleControlChange)(ch, (n >> 16), (n >> 24));
+	return midi_message(n, 0xB0);			// 0xB0 = usbMIDI.ControlChange
+}
+
+static int cin_program_change(uint32_t n, uint32_t channel)
+{
+	uint32_t ch = voice_channel(n, channel);
+	if (!ch) return 0;
+	if (usb_midi_handleProgramChange)
+		(*usb_midi_handleProgramChange)(ch, (n >> 16));
+	return midi_message(n, 0xC0);			// 0xC0 = usbMIDI.ProgramChange
+}
+
+static int cin_channel_pressure(uint32_t n, uint32_t channel)
+{
+	uint32_t ch = voice_channel(n, channel);
+	if (!ch) return 0;
+	if (usb_midi_handleAfterTouch)
+		(*usb_midi_handleAfterTouch)(ch, (n >> 16));
+	return midi_message(n, 0xD0);			// 0xD0 = usbMIDI.AfterTouchChannel
+}
+
+static int cin_pitch_bend(uint32_t n, uint32_t channel)
+{
+	uint32_t ch = voice_channel(n, channel);
+	if (!ch) return 0;
+	if (usb_midi_handlePitchChange) {
+		int value = ((n >> 16) & 0x7F) | ((n >> 17) & 0x3F80);
+		value -= 8192; // 0 to 16383 --> -8192 to +8191
+		(*usb_midi_handlePitchChange)(ch, value);
+	}
+	return midi_message(n, 0xE0);			// 0xE0 = usbMIDI.PitchBend
+}
+
+static int sys_ignore(uint32_t n)
+{
+	return 0; // unknown message, ignore it
+}
+
+static int sys_time_code(uint32_t n)
+{
+	if (usb_midi_handleTimeCodeQuarterFrame) {
+		(*usb_midi_handleTimeCodeQuarterFrame)(n >> 16);
+	}
+	return midi_message(n, 0xF1);			// usbMIDI.TimeCodeQuarterFrame
+}
+
+static int sys_song_position(uint32_t n)
+{
+	if (usb_midi_handleSongPosition) {
+		(*usb_midi_handleSongPosition)(
+		  ((n >> 16) & 0x7F) | ((n >> 17) & 0x3F80));
+	}
+	return midi_message(n, 0xF2);			// usbMIDI.SongPosition
+}
+
+static int sys_song_select(uint32_t n)
+{
+	if (usb_midi_handleSongSelect) {
+		(*usb_midi_handleSongSelect)(n >> 16);
+	}
+	return midi_message(n, 0xF3);			// usbMIDI.SongSelect
+}
+
+static int sys_tune_request(uint32_t n)
+{
+	if (usb_midi_handleTuneRequest) {
+		(*usb_midi_handleTuneRequest)();
+	}
+	return midi_message(n, 0xF6);			// usbMIDI.TuneRequest
+}
+
+static inline int realtime_message(uint32_t n, void (*fptr)(void))
+{
+	uint32_t b1 = (n >> 8) & 0xFF;
+	if (fptr) {
+		(*fptr)();
+	} else if (usb_midi_handleRealTimeSystem) {
+		(*usb_midi_handleRealTimeSystem)(b1);
+	}
+	return midi_message(n, b1);
+}
+
+static int sys_clock(uint32_t n)
+{
+	return realtime_message(n, usb_midi_handleClock);	// usbMIDI.Clock
+}
+
+static int sys_start(uint32_t n)
+{
+	return realtime_message(n, usb_midi_handleStart);	// usbMIDI.Start
+}
+
+static int sys_continue(uint32_t n)
+{
+	return realtime_message(n, usb_midi_handleContinue);	// usbMIDI.Continue
+}
+
+static int sys_stop(uint32_t n)
+{
+	return realtime_message(n, usb_midi_handleStop);	// usbMIDI.Stop
+}
+
+static int sys_active_sensing(uint32_t n)
+{
+	return realtime_message(n, usb_midi_handleActiveSensing); // usbMIDI.ActiveSensing
+}
+
+static int sys_reset(uint32_t n)
+{
+	return realtime_message(n, usb_midi_handleSystemReset);	// usbMIDI.SystemReset
+}
+
+static const midi_system_function_t system_dispatch[16] = {
+	sys_ignore,		// 0xF0 SystemExclusive, handled by CIN
+	sys_time_code,		// 0xF1
+	sys_song_position,	// 0xF2
+	sys_song_select,	// 0xF3
+	sys_ignore,		// 0xF4 undefined
+	sys_ignore,		// 0xF5 undefined
+	sys_tune_request,	// 0xF6
+	sys_ignore,		// 0xF7 end of SystemExclusive
+	sys_clock,		// 0xF8
+	sys_ignore,		// 0xF9 undefined
+	sys_start,		// 0xFA
+	sys_continue,		// 0xFB
+	sys_stop,		// 0xFC
+	sys_ignore,		// 0xFD undefined
+	sys_active_sensing,	// 0xFE
+	sys_reset		// 0xFF
+};
+
+static int cin_system(uint32_t n, uint32_t channel)
+{
+	// system common or system realtime message
+	if (((n >> 12) & 15) != 0x0F) return 0;
+	return (*system_dispatch[(n >> 8) & 15])(n);
+}
+
+static int cin_sysex(uint32_t n, uint32_t channel)
+{
+	if (usb_midi_sysex_buffer) {
+		sysex_buffer_bytes(n, 3);
 		return 0;
 	}
-	if (type1 >= 0x05 && type1 <= 0x07) {
-		sysex_byte(b1);
-		if (type1 >= 0x06) sysex_byte(n >> 16);
-		if (type1 == 0x07) sysex_byte(n >> 24);
-		uint16_t len = usb_midi_msg_sysex_len;
-		usb_midi_msg_data1 = len;
-		usb_midi_msg_data2 = len >> 8;
-		usb_midi_msg_sysex_len = 0;
+	sysex_byte(n >> 8);
+	sysex_byte(n >> 16);
+	sysex_byte(n >> 24);
+	return 0;
+}
+
+static int cin_sysex_end(uint32_t n, uint32_t channel)
+{
+	uint32_t type1 = n & 15;
+	if (usb_midi_sysex_buffer) {
+		sysex_buffer_bytes(n, type1 - 4);
+		uint32_t len = sysex_buffer_len;
+		uint32_t stored = (len < sysex_buffer_size) ? len : sysex_buffer_size;
+		sysex_buffer_len = 0;
+		if (stored > 0xFFFF) stored = 0xFFFF;
+		usb_midi_msg_data1 = stored;
+		usb_midi_msg_data2 = stored >> 8;
 		usb_midi_msg_type = 0xF0;			// 0xF0 = usbMIDI.SystemExclusive
-		if (usb_midi_handleSysExPartial) {
-			(*usb_midi_handleSysExPartial)(usb_midi_msg_sysex, len, 1);
-		} else if (usb_midi_handleSysExComplete) {
-			(*usb_midi_handleSysExComplete)(usb_midi_msg_sysex, len);
+		if (sysex_buffer_handler) {
+			(*sysex_buffer_handler)(usb_midi_sysex_buffer, len);
 		}
 		return 1;
 	}
-	if (type1 == 0x0F) {
-		if (b1 >= 0xF8) {
-			// From Sebastian Tomczak, seb.tomczak at gmail.com
-			// http://little-scale.blogspot.com/2011/08/usb-midi-game-boy-sync-for-16.html
-			goto system_common_or_realtime;
+	sysex_byte(n >> 8);
+	if (type1 >= 0x06) sysex_byte(n >> 16);
+	if (type1 == 0x07) sysex_byte(n >> 24);
+	uint16_t len = usb_midi_msg_sysex_len;
+	usb_midi_msg_data1 = len;
+	usb_midi_msg_data2 = len >> 8;
+	usb_midi_msg_sysex_len = 0;
+	usb_midi_msg_type = 0xF0;			// 0xF0 = usbMIDI.SystemExclusive
+	if (usb_midi_handleSysExPartial) {
+		(*usb_midi_handleSysExPartial)(usb_midi_msg_sysex, len, 1);
+	} else if (usb_midi_handleSysExComplete) {
+		(*usb_midi_handleSysExComplete)(usb_midi_msg_sysex, len);
+	}
+	return 1;
+}
+
+static int cin_single_byte_common(uint32_t n, uint32_t channel)
+{
+	uint32_t b1 = (n >> 8) & 0xFF;
+	if (b1 >= 0xF1 && b1 != 0xF7) return cin_system(n, channel);
+	return cin_sysex_end(n, channel);
+}
+
+static int cin_single_byte(uint32_t n, uint32_t channel)
+{
+	uint32_t b1 = (n >> 8) & 0xFF;
+	if (b1 >= 0xF8) {
+		// From Sebastian Tomczak, seb.tomczak at gmail.com
+		// http://little-scale.blogspot.com/2011/08/usb-midi-game-boy-sync-for-16.html
+		return (*system_dispatch[b1 & 15])(n);
+	}
+	if (usb_midi_sysex_buffer) {
+		if (b1 == 0xF0 || sysex_buffer_len > 0) sysex_buffer_bytes(n, 1);
+	} else if (b1 == 0xF0 || usb_midi_msg_sysex_len > 0) {
+		// From David Sorlien, dsorlien at gmail.com, http://axe4live.wordpress.com
+		// OSX sometimes uses Single Byte Unparsed to
+		// send bytes in the middle of a SYSEX message.
+		sysex_byte(b1);
+	}
+	return 0;
+}
+
+static const midi_cin_function_t cin_dispatch[16] = {
+	cin_ignore,		// 0x0 reserved
+	cin_ignore,		// 0x1 reserved, cable events
+	cin_system,		// 0x2 two byte system common
+	cin_system,		// 0x3 three byte system common
+	cin_sysex,		// 0x4 SysEx starts or continues
+	cin_single_byte_common,	// 0x5 single byte system common, or SysEx ends
+	cin_sysex_end,		// 0x6 SysEx ends with two bytes
+	cin_sysex_end,		// 0x7 SysEx ends with three bytes
+	cin_note_off,		// 0x8
+	cin_note_on,		// 0x9
+	cin_poly_pressure,	// 0xA
+	cin_control_change,	// 0xB
+	cin_program_change,	// 0xC
+	cin_channel_pressure,	// 0xD
+	cin_pitch_bend,		// 0xE
+	cin_single_byte		// 0xF
+};
+
+// Decode one 32 bit USB-MIDI event, as returned by usb_midi_read_message()
+int usb_midi_decode(uint32_t n, uint32_t channel)
+{
+	if (n == 0) return 0;
+	usb_midi_msg_cable = (n >> 4) & 15;
+	return (*cin_dispatch[n & 15])(n, channel);
+}
+
+int usb_midi_read(uint32_t channel)
+{
+	return usb_midi_decode(usb_midi_read_message(), channel);
+}
+
+// Process every event remaining in the oldest received packet with a single
+// pass over the packet memory, then give the buffer back to the USB
+// controller.  Each event is passed to handler, or decoded to the usbMIDI
+// setHandle functions when handler is NULL.  Returns the number of events
+// given to handler, or of complete messages decoded.
+uint32_t usb_midi_read_all(void (*handler)(uint32_t event))
+{
+	uint32_t count = 0;
+
+	NVIC_DISABLE_IRQ(IRQ_USB1);
+	uint32_t tail = rx_tail;
+	if (tail == rx_head) {
+		NVIC_ENABLE_IRQ(IRQ_USB1);
+		return 0;
+	}
+	if (++tail > RX_NUM) tail = 0;
+	uint32_t i = rx_list[tail];
+	uint32_t index = rx_index[i];
+	uint32_t len = rx_count[i];
+	rx_available -= len - index;
+	rx_index[i] = len;
+	rx_tail = tail;
+	NVIC_ENABLE_IRQ(IRQ_USB1);
+
+	const uint32_t *p = (const uint32_t *)(rx_buffer + i * MIDI_RX_SIZE_480 + index);
+	const uint32_t *end = (const uint32_t *)(rx_buffer + i * MIDI_RX_SIZE_480 + len);
+	if (handler) {
+		while (p < end) {
+			uint32_t n = *p++;
+			if (n) {
+				(*handler)(n);
+				count++;
+			}
 		}
-		if (b1 == 0xF0 || usb_midi_msg_sysex_len > 0) {
-			// From David Sorlien, dsorlien at gmail.com, http://axe4live.wordpress.com
-			// OSX sometimes uses Single Byte Unparsed to
-			// send bytes in the middle of a SYSEX message.
-			sysex_byte(b1);
+	} else {
+		while (p < end) {
+			count += usb_midi_decode(*p++, 0);
 		}
 	}
-	return 0;
+	rx_queue_transfer(i);
+	return count;
 }
 
 
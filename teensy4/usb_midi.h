@@ -46,10 +46,16 @@ extern "C" {
 #endif
 void usb_midi_configure(void);
 void usb_midi_write_packed(uint32_t n);
+uint32_t usb_midi_write_packed_buffer(const uint32_t *data, uint32_t count);
+void usb_midi_set_coalesce_frames(uint8_t frames);
+void usb_midi_sof_flush(void);
+void usb_midi_set_sysex_buffer(uint8_t *buffer, uint32_t size, void (*handler)(uint8_t *data, uint32_t length));
 void usb_midi_send_sysex_buffer_has_term(const uint8_t *data, uint32_t length, uint8_t cable);
 void usb_midi_send_sysex_add_term_bytes(const uint8_t *data, uint32_t length, uint8_t cable);
 void usb_midi_flush_output(void);
 int usb_midi_read(uint32_t channel);
+int usb_midi_decode(uint32_t n, uint32_t channel);
+uint32_t usb_midi_read_all(void (*handler)(uint32_t event));
 uint32_t usb_midi_available(void);
 uint32_t usb_midi_read_message(void);
 extern uint8_t usb_midi_msg_cable;
@@ -59,6 +65,7 @@ extern uint8_t usb_midi_msg_data1;
 extern uint8_t usb_midi_msg_data2;
 extern uint8_t usb_midi_msg_sysex[USB_MIDI_SYSEX_MAX];
 extern uint16_t usb_midi_msg_sysex_len;
+extern uint8_t *usb_midi_sysex_buffer;
 extern volatile uint8_t usb_configuration;
 extern void (*usb_midi_handleNoteOff)(uint8_t ch, uint8_t note, uint8_t vel);
 extern void (*usb_midi_handleNoteOn)(uint8_t ch, uint8_t note, uint8_t vel);
@@ -258,10 +265,26 @@ class usb_midi_class
         void send_now(void) __attribute__((always_inline)) {
 		usb_midi_flush_output();
 	}
+	// Send many 32 bit USB MIDI event packets, in the format used by
+	// usb_midi_write_packed(), with one copy per USB packet.  Returns how
+	// many were sent.
+	uint32_t sendPackets(const uint32_t *events, uint32_t count) {
+		return usb_midi_write_packed_buffer(events, count);
+	}
+	// How many USB frames a partly filled packet may wait for more events
+	void setCoalesceFrames(uint8_t frames) {
+		usb_midi_set_coalesce_frames(frames);
+	}
         uint8_t analog2velocity(uint16_t val, uint8_t range);
         bool read(uint8_t channel=0) __attribute__((always_inline)) {
 		return usb_midi_read(channel);
 	}
+	// Process all events in the oldest received USB packet at once.  With no
+	// handler, messages go to the setHandle functions.  Returns the number
+	// of events or messages processed.
+	uint32_t readAll(void (*handler)(uint32_t event) = nullptr) {
+		return usb_midi_read_all(handler);
+	}
         uint8_t getType(void) __attribute__((always_inline)) {
                 return usb_midi_msg_type;
         }
@@ -278,6 +301,7 @@ class usb_midi_class
                 return usb_midi_msg_data2;
         }
         uint8_t * getSysExArray(void) __attribute__((always_inline)) {
+		if (usb_midi_sysex_buffer) return usb_midi_sysex_buffer;
                 return usb_midi_msg_sysex;
         }
 	uint16_t getSysExArrayLength(void) __attribute__((always_inline)) {
@@ -332,6 +356,11 @@ class usb_midi_class
 		// type: 0xF0  SystemExclusive - single call, message larger than buffer is truncated
 		usb_midi_handleSysExComplete = fptr;
 	}
+	void setSysExBuffer(uint8_t *buffer, uint32_t size, void (*fptr)(uint8_t *data, uint32_t length) = nullptr) {
+		// type: 0xF0  SystemExclusive - received directly into buffer, single call.
+		// length larger than size means the message was truncated.
+		usb_midi_set_sysex_buffer(buffer, size, fptr);
+	}
         void setHandleTimeCodeQuarterFrame(void (*fptr)(uint8_t data)) {
 		// type: 0xF1  TimeCodeQuarterFrame
                 usb_midi_handleTimeCodeQuarterFrame = fptr;
@@ -104,10 +104,20 @@ static uint8_t tx_head=0;
 #endif
 
 
+// Frame mode: motion is summed until the next start of frame interrupt,
+// which sends it in one report.  Buttons pressed since the last report
+// are included even if already released, so a click is never lost.
+static uint8_t frame_mode=0;
+static int32_t pending_x, pending_y, pending_wheel, pending_horiz;
+static uint8_t pending_pressed=0;
+static uint8_t sent_buttons=0;
+static uint8_t pending_position=0;
+
 void usb_mouse_configure(void)
 {
 	memset(tx_transfer, 0, sizeof(tx_transfer));
 	tx_head = 0;
+	sent_buttons = 0;
 	usb_config_tx(MOUSE_ENDPOINT, MOUSE_SIZE, 0, NULL);
 }
 
@@ -124,6 +134,12 @@ int usb_mouse_buttons(uint8_t left, uint8_t middle, uint8_t right, uint8_t back,
         if (back) mask    |= 8;
         if (forward) mask |= 16;
         usb_mouse_buttons_state = mask;
+	if (frame_mode) {
+		NVIC_DISABLE_IRQ(IRQ_USB1);
+		pending_pressed |= mask;
+		NVIC_ENABLE_IRQ(IRQ_USB1);
+		return 0;
+	}
         return usb_mouse_move(0, 0, 0, 0);
 }
 
@@ -133,41 +149,137 @@ static uint8_t transmit_previous_timeout=0;
 // When the PC isn't listening, how long do we wait before discarding data?
 #define TX_TIMEOUT_MSEC 30
 
-static int usb_mouse_transmit(const uint8_t *data, uint32_t len)
+// Give a report to the USB controller, if the next transfer_t is free.
+// Must be called with the USB interrupt disabled, or from the interrupt.
+static int tx_send(const uint8_t *data, uint32_t len)
 {
-        if (!usb_configuration) return -1;
-        uint32_t head = tx_head;
-        transfer_t *xfer = tx_transfer + head;
-        uint32_t wait_begin_at = systick_millis_count;
-        while (1) {
-                uint32_t status = usb_transfer_status(xfer);
-                if (!(status & 0x80)) {
-                        if (status & 0x68) {
-                                // TODO: what if status has errors???
-                                printf("ERROR status = %x, i=%d, ms=%u\n",
-                                        status, tx_head, systick_millis_count);
-                        }
-                        transmit_previous_timeout = 0;
-                        break;
-                }
-                if (transmit_previous_timeout) return -1;
-                if (systick_millis_count - wait_begin_at > TX_TIMEOUT_MSEC) {
-                        // waited too long, assume the USB host isn't listening
-                        transmit_previous_timeout = 1;
-                        return -1;
-                }
-                if (!usb_configuration) return -1;
-                yield();
-        }
+	uint32_t head = tx_head;
+	transfer_t *xfer = tx_transfer + head;
+	uint32_t status = usb_transfer_status(xfer);
+	if (status & 0x80) return -1;
+	if (status & 0x68) {
+		// TODO: what if status has errors???
+		printf("ERROR status = %x, i=%d, ms=%u\n",
+			status, tx_head, systick_millis_count);
+	}
 	delayNanoseconds(30); // TODO: why is status ready too soon?
-        uint8_t *buffer = txbuffer + head * TX_BUFSIZE;
-        memcpy(buffer, data, len);
-        usb_prepare_transfer(xfer, buffer, len, 0);
-        arm_dcache_flush_delete(buffer, TX_BUFSIZE);
-        usb_transmit(MOUSE_ENDPOINT, xfer);
-        if (++head >= TX_NUM) head = 0;
-        tx_head = head;
-        return 0;
+	uint8_t *buffer = txbuffer + head * TX_BUFSIZE;
+	memcpy(buffer, data, len);
+	if (data[0] == 1) sent_buttons = data[1];
+	usb_prepare_transfer(xfer, buffer, len, 0);
+	dma_buffer_to_device(buffer, TX_BUFSIZE);
+	usb_transmit(MOUSE_ENDPOINT, xfer);
+	if (++head >= TX_NUM) head = 0;
+	tx_head = head;
+	return 0;
+}
+
+static int usb_mouse_transmit(const uint8_t *data, uint32_t len)
+{
+	if (!usb_configuration) return -1;
+	uint32_t wait_begin_at = systick_millis_count;
+	while (1) {
+		NVIC_DISABLE_IRQ(IRQ_USB1);
+		int r = tx_send(data, len);
+		NVIC_ENABLE_IRQ(IRQ_USB1);
+		if (r == 0) {
+			transmit_previous_timeout = 0;
+			return 0;
+		}
+		if (transmit_previous_timeout) return -1;
+		if (systick_millis_count - wait_begin_at > TX_TIMEOUT_MSEC) {
+			// waited too long, assume the USB host isn't listening
+			transmit_previous_timeout = 1;
+			return -1;
+		}
+		if (!usb_configuration) return -1;
+		yield();
+	}
+}
+
+void usb_mouse_frame_mode(uint8_t enable)
+{
+	if (enable) {
+		frame_mode = 1;
+		usb_start_sof_interrupts(MOUSE_INTERFACE);
+	} else if (frame_mode) {
+		frame_mode = 0;
+		usb_stop_sof_interrupts(MOUSE_INTERFACE);
+	}
+}
+
+// Add motion to be sent at the next USB frame, in frame mode.  Large
+// sums are sent over several frames, up to 127 each.
+int usb_mouse_accumulate(int16_t x, int16_t y, int16_t wheel, int16_t horiz)
+{
+	if (!frame_mode) {
+		// without frame mode, send right away in 127 steps
+		while (x || y || wheel || horiz) {
+			int8_t dx = (x > 127) ? 127 : ((x < -127) ? -127 : x);
+			int8_t dy = (y > 127) ? 127 : ((y < -127) ? -127 : y);
+			int8_t dw = (wheel > 127) ? 127 : ((wheel < -127) ? -127 : wheel);
+			int8_t dh = (horiz > 127) ? 127 : ((horiz < -127) ? -127 : horiz);
+			if (usb_mouse_move(dx, dy, dw, dh)) return -1;
+			x -= dx;
+			y -= dy;
+			wheel -= dw;
+			horiz -= dh;
+		}
+		return 0;
+	}
+	NVIC_DISABLE_IRQ(IRQ_USB1);
+	pending_x += x;
+	pending_y += y;
+	pending_wheel += wheel;
+	pending_horiz += horiz;
+	NVIC_ENABLE_IRQ(IRQ_USB1);
+	return 0;
+}
+
+static int8_t take_pending(int32_t *pending)
+{
+	int32_t n = *pending;
+	if (n > 127) n = 127;
+	else if (n < -127) n = -127;
+	*pending -= n;
+	return n;
+}
+
+// called by the start of frame interrupt, when in frame mode
+void usb_mouse_sof_flush(void)
+{
+	if (!frame_mode || !usb_configuration) return;
+	uint8_t buttons = usb_mouse_buttons_state | pending_pressed;
+	if (pending_x || pending_y || pending_wheel || pending_horiz || buttons != sent_buttons) {
+		uint8_t buffer[6];
+		buffer[0] = 1;
+		buffer[1] = buttons;
+		buffer[2] = take_pending(&pending_x);
+		buffer[3] = take_pending(&pending_y);
+		buffer[4] = take_pending(&pending_wheel);
+		buffer[5] = take_pending(&pending_horiz);
+		if (tx_send(buffer, 6) == 0) {
+			pending_pressed = 0;
+		} else {
+			// every buffer still busy, so try again next frame
+			pending_x += (int8_t)buffer[2];
+			pending_y += (int8_t)buffer[3];
+			pending_wheel += (int8_t)buffer[4];
+			pending_horiz += (int8_t)buffer[5];
+			return;
+		}
+	}
+	if (pending_position) {
+		uint8_t buffer[5];
+		buffer[0] = 2;
+		uint32_t val32 = usb_mouse_position_x * usb_mouse_scale_x + usb_mouse_offset_x;
+		buffer[1] = val32 >> 16;
+		buffer[2] = val32 >> 24;
+		val32 = usb_mouse_position_y * usb_mouse_scale_y + usb_mouse_offset_y;
+		buffer[3] = val32 >> 16;
+		buffer[4] = val32 >> 24;
+		if (tx_send(buffer, 5) == 0) pending_position = 0;
+	}
 }
 
 
@@ -175,6 +287,13 @@ static int usb_mouse_transmit(const uint8_t *data, uint32_t len)
 int usb_mouse_move(int8_t x, int8_t y, int8_t wheel, int8_t horiz)
 {
         //printf("move\n");
+	if (frame_mode) {
+		// latch the buttons, so press then release is seen as a click
+		NVIC_DISABLE_IRQ(IRQ_USB1);
+		pending_pressed |= usb_mouse_buttons_state;
+		NVIC_ENABLE_IRQ(IRQ_USB1);
+		return usb_mouse_accumulate(x, y, wheel, horiz);
+	}
         if (x == -128) x = -127;
         if (y == -128) y = -127;
         if (wheel == -128) wheel = -127;
@@ -196,6 +315,11 @@ int usb_mouse_position(uint16_t x, uint16_t y)
 	usb_mouse_position_x = x;
 	if (y >= usb_mouse_resolution_y) y = usb_mouse_resolution_y - 1;
 	usb_mouse_position_y = y;
+	if (frame_mode) {
+		// only the latest position is sent at the next frame
+		pending_position = 1;
+		return 0;
+	}
 	uint8_t buffer[5];
 	buffer[0] = 2;
 	uint32_t val32 = usb_mouse_position_x * usb_mouse_scale_x + usb_mouse_offset_x;
@@ -45,6 +45,9 @@ void usb_mouse_configure(void);
 int usb_mouse_buttons(uint8_t left, uint8_t middle, uint8_t right, uint8_t back, uint8_t forward);
 int usb_mouse_move(int8_t x, int8_t y, int8_t wheel, int8_t horiz);
 int usb_mouse_position(uint16_t x, uint16_t y);
+int usb_mouse_accumulate(int16_t x, int16_t y, int16_t wheel, int16_t horiz);
+void usb_mouse_frame_mode(uint8_t enable);
+void usb_mouse_sof_flush(void);
 void usb_mouse_screen_size(uint16_t width, uint16_t height, uint8_t mac);
 extern uint8_t usb_mouse_buttons_state;
 extern volatile uint8_t usb_configuration;
@@ -70,7 +73,14 @@ class usb_mouse_class
         void move(int8_t x, int8_t y, int8_t wheel=0, int8_t horiz=0) {
 		usb_mouse_move(x, y, wheel, horiz);
 	}
+	// larger movement, sent as several reports of up to 127 each
+	void moveBy(int16_t x, int16_t y, int16_t wheel=0, int16_t horiz=0) {
+		usb_mouse_accumulate(x, y, wheel, horiz);
+	}
 	void moveTo(uint16_t x, uint16_t y) { usb_mouse_position(x, y); }
+	// With frame mode, movement is summed and sent once per USB frame
+	// (every 125 us at 480 Mbit/sec), rather than one report per call.
+	void useFrameSend(bool enable) { usb_mouse_frame_mode(enable ? 1 : 0); }
 	void screenSize(uint16_t width, uint16_t height, bool isMacintosh = false) {
 		usb_mouse_screen_size(width, height, isMacintosh ? 1 : 0);
 	}
@@ -57,6 +57,26 @@ static int rx_list_transfer_len[RX_NUM + 1];
 static uint16_t rx_packet_size=0;
 static void rx_queue_transfer(int i);
 static void rx_event(transfer_t *t);
+
+// Direct transfers move file data straight between the USB controller and
+// the caller's buffer, without copying through the packet buffers above.
+// Two of each may be queued, so one can be refilled while the other moves.
+#define TX_DIRECT_NUM    2
+#define TX_DIRECT_CHAIN  4      /* 4 x 16K = up to 64K per send */
+#define RX_DIRECT_NUM    2
+#define DIRECT_PARAM     0x100  /* callback_param for direct transfers */
+static transfer_t tx_direct_transfer[TX_DIRECT_NUM][TX_DIRECT_CHAIN] __attribute__ ((used, aligned(32)));
+static const void *tx_direct_buffer[TX_DIRECT_NUM];
+static uint32_t tx_direct_len[TX_DIRECT_NUM];
+static void (*tx_direct_callback[TX_DIRECT_NUM])(const void *buffer, uint32_t len);
+static transfer_t rx_direct_transfer[RX_DIRECT_NUM] __attribute__ ((used, aligned(32)));
+static void *rx_direct_buffer[RX_DIRECT_NUM];
+static uint16_t rx_direct_size[RX_DIRECT_NUM];
+static void (*rx_direct_callback[RX_DIRECT_NUM])(void *buffer, uint32_t count);
+static volatile uint8_t rx_direct_pending=0;
+static volatile uint32_t rx_parked=0;
+static void tx_event(transfer_t *t);
+static void (*rx_callback)(uint32_t len) = NULL;
 extern volatile uint8_t usb_configuration;
 
 uint32_t mtp_txEventCount = 0;
@@ -81,10 +101,16 @@ void usb_mtp_configure(void)
 	printf("usb_mtp_configure: TX:%u RX:%u\n", tx_packet_size, rx_packet_size);
 	memset(tx_transfer, 0, sizeof(tx_transfer));
 	memset(rx_transfer, 0, sizeof(rx_transfer));
+	memset(tx_direct_transfer, 0, sizeof(tx_direct_transfer));
+	memset(rx_direct_transfer, 0, sizeof(rx_direct_transfer));
+	memset(tx_direct_buffer, 0, sizeof(tx_direct_buffer));
+	memset(rx_direct_buffer, 0, sizeof(rx_direct_buffer));
+	rx_direct_pending = 0;
+	rx_parked = 0;
 	tx_head = 0;
 	rx_head = 0;
 	rx_tail = 0;
-	usb_config_tx(MTP_TX_ENDPOINT, tx_packet_size, 0, NULL);
+	usb_config_tx(MTP_TX_ENDPOINT, tx_packet_size, 0, tx_event);
 	usb_config_rx(MTP_RX_ENDPOINT, rx_packet_size, 0, rx_event);
 	usb_config_tx(MTP_EVENT_ENDPOINT, MTP_EVENT_SIZE, 0, txEvent_event);
 	int i;
@@ -108,17 +134,47 @@ int usb_mtp_txSize(void)
 static void rx_queue_transfer(int i)
 {
 	void *buffer = rx_buffer + i * MTP_RX_SIZE_480;
-	arm_dcache_delete(buffer, rx_packet_size);
-	//memset(buffer, )
 	NVIC_DISABLE_IRQ(IRQ_USB1);
+	if (rx_direct_pending) {
+		// keep packet buffers off the endpoint while direct reads wait
+		rx_parked |= (1 << i);
+		NVIC_ENABLE_IRQ(IRQ_USB1);
+		return;
+	}
+	dma_buffer_from_device(buffer, rx_packet_size);
 	usb_prepare_transfer(rx_transfer + i, buffer, rx_packet_size, i);
 	NVIC_DISABLE_IRQ(IRQ_USB1);
 	usb_receive(MTP_RX_ENDPOINT, rx_transfer + i);
 	NVIC_ENABLE_IRQ(IRQ_USB1);
 }
 
+// called by USB interrupt when a direct read completes
+static void rx_direct_event(transfer_t *t, uint32_t n)
+{
+	uint32_t len = rx_direct_size[n] - ((t->status >> 16) & 0x7FFF);
+	void *buffer = rx_direct_buffer[n];
+	void (*callback)(void *buffer, uint32_t count) = rx_direct_callback[n];
+	rx_direct_buffer[n] = NULL;
+	rx_direct_pending--;
+	if (callback) (*callback)(buffer, len);
+	// if the callback did not post another direct read, resume normal receive
+	if (!rx_direct_pending) {
+		uint32_t parked = rx_parked;
+		rx_parked = 0;
+		while (parked) {
+			int i = __builtin_ctz(parked);
+			rx_queue_transfer(i);
+			parked &= ~(1 << i);
+		}
+	}
+}
+
 static void rx_event(transfer_t *t)
 {
+	if (t->callback_param >= DIRECT_PARAM) {
+		rx_direct_event(t, t->callback_param - DIRECT_PARAM);
+		return;
+	}
 	int i = t->callback_param;
 	//printf("rx event i=%d\n", i);
 	// received a packet with data
@@ -129,6 +185,16 @@ static void rx_event(transfer_t *t)
 	int len = rx_packet_size - ((t->status >> 16) & 0x7FFF);
 	rx_list_transfer_len[head] = len;
 	rx_head = head;
+	if (rx_callback) (*rx_callback)(len);
+}
+
+// set a function to be called (from the USB interrupt) each time a packet
+// is received into the packet buffers.  NULL disables the notification.
+void usb_mtp_set_rx_callback(void (*callback)(uint32_t len))
+{
+	NVIC_DISABLE_IRQ(IRQ_USB1);
+	rx_callback = callback;
+	NVIC_ENABLE_IRQ(IRQ_USB1);
 }
 
 
@@ -159,6 +225,36 @@ int usb_mtp_recv(void *buffer, uint32_t timeout)
 	return len;
 }
 
+// Receive up to size bytes of a data phase straight into a 32 byte aligned
+// buffer.  size must be a multiple of 512, max 16384.  A short packet from
+// the host ends the read early.  Packets which already arrived before this
+// call are still returned by usb_mtp_recv() first.  The callback runs from
+// the USB interrupt with the number of bytes received.
+int usb_mtp_recv_direct(void *buffer, uint32_t size, void (*callback)(void *buffer, uint32_t count))
+{
+	if (!usb_configuration || !buffer) return 0;
+	if (((uint32_t)buffer & 31) || (size & 511) || size == 0 || size > 16384) return 0;
+	NVIC_DISABLE_IRQ(IRQ_USB1);
+	uint32_t n;
+	for (n=0; n < RX_DIRECT_NUM; n++) {
+		if (rx_direct_buffer[n] == NULL) break;
+	}
+	if (n >= RX_DIRECT_NUM) {
+		NVIC_ENABLE_IRQ(IRQ_USB1);
+		return 0;
+	}
+	rx_direct_buffer[n] = buffer;
+	rx_direct_size[n] = size;
+	rx_direct_callback[n] = callback;
+	rx_direct_pending++;
+	transfer_t *t = rx_direct_transfer + n;
+	usb_prepare_transfer(t, buffer, size, DIRECT_PARAM + n);
+	dma_buffer_from_device(buffer, size);
+	usb_receive(MTP_RX_ENDPOINT, t);
+	NVIC_ENABLE_IRQ(IRQ_USB1);
+	return 1;
+}
+
 int usb_mtp_available(void)
 {
 	if (!usb_configuration) return 0;
@@ -184,11 +280,60 @@ int usb_mtp_send(const void *buffer, uint32_t len, uint32_t timeout)
 	}
 	uint8_t *txdata = txbuffer + (tx_head * MTP_TX_SIZE_480);
 	memcpy(txdata, buffer, len);
-	arm_dcache_flush_delete(txdata, tx_packet_size );
+	dma_buffer_to_device(txdata, len);
 	usb_prepare_transfer(xfer, txdata, len, 0);
 	usb_transmit(MTP_TX_ENDPOINT, xfer);
 	if (++tx_head >= TX_NUM) tx_head = 0;
 	return len;
 }
 
+// called by USB interrupt when any transmit completes
+static void tx_event(transfer_t *t)
+{
+	if (t->callback_param < DIRECT_PARAM) return;
+	uint32_t n = t->callback_param - DIRECT_PARAM;
+	const void *buffer = tx_direct_buffer[n];
+	uint32_t len = tx_direct_len[n];
+	void (*callback)(const void *buffer, uint32_t len) = tx_direct_callback[n];
+	tx_direct_buffer[n] = NULL;
+	if (callback) (*callback)(buffer, len);
+}
+
+// Send up to 64K of a data phase straight from the caller's buffer as one
+// chain of transfers, so the controller moves it at full bus speed with
+// no copies and no per-packet waiting.  The buffer must not change until
+// the callback, which runs from the USB interrupt.  Returns 0 if both
+// direct transfers are still busy; usb_mtp_send() calls queued before or
+// after keep their order.  As with usb_mtp_send(), ending the data phase
+// with a zero length packet when needed is left to the caller.
+int usb_mtp_send_direct(const void *buffer, uint32_t len, void (*callback)(const void *buffer, uint32_t len))
+{
+	if (!usb_configuration || !buffer || len == 0) return 0;
+	if (len > TX_DIRECT_CHAIN * 16384) return 0;
+	dma_buffer_to_device(buffer, len);
+	NVIC_DISABLE_IRQ(IRQ_USB1);
+	uint32_t n;
+	for (n=0; n < TX_DIRECT_NUM; n++) {
+		if (tx_direct_buffer[n] == NULL) break;
+	}
+	if (n >= TX_DIRECT_NUM) {
+		NVIC_ENABLE_IRQ(IRQ_USB1);
+		return 0;
+	}
+	tx_direct_buffer[n] = buffer;
+	tx_direct_len[n] = len;
+	tx_direct_callback[n] = callback;
+	uint32_t num = usb_prepare_transfer_chain(tx_direct_transfer[n], TX_DIRECT_CHAIN,
+		buffer, len, DIRECT_PARAM + n);
+	usb_transmit_chain(MTP_TX_ENDPOINT, tx_direct_transfer[n], num);
+	NVIC_ENABLE_IRQ(IRQ_USB1);
+	return len;
+}
+
+// true while either direct send is still moving data
+int usb_mtp_send_direct_busy(void)
+{
+	return tx_direct_buffer[0] != NULL || tx_direct_buffer[1] != NULL;
+}
+
 #endif // MTP_INTERFACE
@@ -46,6 +46,10 @@ int usb_mtp_available(void);
 int usb_mtp_send(const void *buffer, uint32_t len, uint32_t timeout);
 int usb_mtp_rxSize(void);
 int usb_mtp_txSize(void);
+int usb_mtp_send_direct(const void *buffer, uint32_t len, void (*callback)(const void *buffer, uint32_t len));
+int usb_mtp_send_direct_busy(void);
+void usb_mtp_set_rx_callback(void (*callback)(uint32_t len));
+int usb_mtp_recv_direct(void *buffer, uint32_t size, void (*callback)(void *buffer, uint32_t count));
 
 extern uint32_t mtp_txEventCount;
 extern volatile uint8_t usb_mtp_status;
@@ -57,6 +61,7 @@ extern volatile uint8_t usb_mtp_status;
 
 // C++ interface
 #ifdef __cplusplus
+class EventResponder;
 class usb_mtp_class
 {
 public:
@@ -65,8 +70,23 @@ public:
 	int send(const void *buffer, uint32_t len, uint32_t timeout) { return usb_mtp_send(buffer, len, timeout); }
     int rxSize(void) {return usb_mtp_rxSize(); }
     int txSize(void) {return usb_mtp_txSize(); }
+    // Move file data without copying through packet buffers.  sendDirect
+    // takes up to 64K, recvDirect a 32 byte aligned buffer of a multiple
+    // of 512 bytes, max 16384.  Up to 2 of each may be queued.  Callbacks
+    // run from the USB interrupt when the buffer is free again.
+    int sendDirect(const void *buffer, uint32_t len, void (*callback)(const void *buffer, uint32_t len)=nullptr) {
+        return usb_mtp_send_direct(buffer, len, callback); }
+    bool sendDirectBusy(void) { return usb_mtp_send_direct_busy(); }
+    bool recvDirect(void *buffer, uint32_t size, void (*callback)(void *buffer, uint32_t count)) {
+        return usb_mtp_recv_direct(buffer, size, callback); }
 
     uint32_t txEventCount() { return mtp_txEventCount; }
+    // Trigger an EventResponder when a packet arrives from the USB host,
+    // so a new container can be handled at once instead of at the next
+    // poll of available().  The event's status is the packet length and
+    // its data is this usb_mtp_class.
+    void attachRxEvent(EventResponder &event);
+    void detachRxEvent();
 };
 
 extern usb_mtp_class mtp;
@@ -0,0 +1,436 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "usb_dev.h"
+#include "usb_ncm.h"
+#include "core_pins.h" // for systick_millis_count
+#include "avr/pgmspace.h" // for PROGMEM, DMAMEM, FASTRUN
+#include <string.h> // for memcpy()
+
+#include "debug/printf.h"
+#ifdef NCM_STATUS_INTERFACE // defined by usb_dev.h -> usb_desc.h
+
+// CDC-NCM network function.  Ethernet frames are packed into NCM Transfer
+// Blocks (NTBs), each a 12 byte NTH16 header, the datagrams, and an NDP16
+// table of offsets and lengths.  When the transmit endpoint is idle, a frame
+// goes out right away in a NTB of its own.  While a NTB is moving, frames
+// are gathered into the other buffer, so under load many frames share one
+// USB transfer and one interrupt.
+
+extern volatile uint8_t usb_high_speed;
+extern volatile uint8_t usb_configuration;
+
+#define NTH16_SIGNATURE  0x484D434E	// "NCMH"
+#define NDP16_SIGNATURE  0x304D434E	// "NCM0", datagrams without CRC
+#define NTB_ALIGN(n)     (((n) + 3) & ~3)
+
+static volatile uint8_t ncm_alt_setting=0;
+static uint32_t ntb_in_size=NCM_NTB_IN_SIZE;
+static uint16_t ntb_sequence=0;
+
+#define TX_NUM   2
+#define TX_MAX_DATAGRAMS  40
+static transfer_t tx_transfer[TX_NUM] __attribute__ ((used, aligned(32)));
+DMAMEM static uint8_t txbuffer[NCM_NTB_IN_SIZE * TX_NUM] __attribute__ ((aligned(32)));
+static uint16_t tx_datagram[TX_MAX_DATAGRAMS][2];	// index and length of each frame
+static uint8_t tx_count=0;	// frames in the buffer being filled
+static uint16_t tx_used=0;	// bytes used in the buffer being filled
+static uint8_t tx_head=0;	// buffer being filled
+static volatile uint8_t tx_busy=0;	// a NTB is being transmitted
+
+#define RX_NUM   4
+static transfer_t rx_transfer[RX_NUM] __attribute__ ((used, aligned(32)));
+DMAMEM static uint8_t rx_buffer[NCM_NTB_OUT_SIZE * RX_NUM] __attribute__ ((aligned(32)));
+static uint16_t rx_count[RX_NUM];
+static uint8_t rx_list[RX_NUM + 1];
+static volatile uint8_t rx_head;
+static volatile uint8_t rx_tail;
+static uint16_t rx_ndp;		// offset of NDP being read, 0 = NTB not yet parsed
+static uint16_t rx_entry;	// offset of next datagram pointer within NTB
+static void (*rx_callback)(void) = NULL;
+static void rx_queue_transfer(int i);
+static void rx_event(transfer_t *t);
+static void tx_event(transfer_t *t);
+
+static transfer_t notify_transfer[2] __attribute__ ((used, aligned(32)));
+DMAMEM static uint8_t notify_buffer[32] __attribute__ ((aligned(32)));
+
+static inline uint32_t get16(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+static inline uint32_t get32(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | (p[3] << 24);
+}
+
+static inline void put16(uint8_t *p, uint32_t n)
+{
+	p[0] = n;
+	p[1] = n >> 8;
+}
+
+static inline void put32(uint8_t *p, uint32_t n)
+{
+	p[0] = n;
+	p[1] = n >> 8;
+	p[2] = n >> 16;
+	p[3] = n >> 24;
+}
+
+void usb_ncm_configure(void)
+{
+	uint32_t tx_packet_size, rx_packet_size;
+
+	if (usb_high_speed) {
+		tx_packet_size = NCM_TX_SIZE_480;
+		rx_packet_size = NCM_RX_SIZE_480;
+	} else {
+		tx_packet_size = NCM_TX_SIZE_12;
+		rx_packet_size = NCM_RX_SIZE_12;
+	}
+	printf("usb_ncm_configure: TX:%u RX:%u\n", tx_packet_size, rx_packet_size);
+	memset(tx_transfer, 0, sizeof(tx_transfer));
+	memset(rx_transfer, 0, sizeof(rx_transfer));
+	memset(notify_transfer, 0, sizeof(notify_transfer));
+	ncm_alt_setting = 0;
+	ntb_in_size = NCM_NTB_IN_SIZE;
+	ntb_sequence = 0;
+	tx_count = 0;
+	tx_used = 0;
+	tx_head = 0;
+	tx_busy = 0;
+	rx_head = 0;
+	rx_tail = 0;
+	rx_ndp = 0;
+	usb_config_tx(NCM_NOTIFY_ENDPOINT, NCM_NOTIFY_SIZE, 0, NULL);
+	// NTBs are variable length, so a zero length packet ends any which
+	// are an exact multiple of the packet size
+	usb_config_tx(NCM_TX_ENDPOINT, tx_packet_size, 1, tx_event);
+	usb_config_rx(NCM_RX_ENDPOINT, rx_packet_size, 0, rx_event);
+	int i;
+	for (i=0; i < RX_NUM; i++) rx_queue_transfer(i);
+}
+
+
+/*************************************************************************/
+/**                            Control Requests                         **/
+/*************************************************************************/
+
+// The host selects alternate setting 1 of the data interface to start the
+// network, and 0 to stop it.  Called from the USB interrupt.
+void usb_ncm_set_interface(uint32_t alt)
+{
+	ncm_alt_setting = alt;
+	if (alt != 1) {
+		tx_count = 0;
+		tx_used = 0;
+		return;
+	}
+	// tell the host the link speed, then that the network is connected
+	if (usb_transfer_status(notify_transfer + 1) & 0x80) return;
+	uint32_t speed = usb_high_speed ? 480000000 : 12000000;
+	uint8_t *p = notify_buffer;
+	p[0] = 0xA1;		// bmRequestType
+	p[1] = 0x2A;		// CONNECTION_SPEED_CHANGE
+	put16(p + 2, 0);	// wValue
+	put16(p + 4, NCM_STATUS_INTERFACE);
+	put16(p + 6, 8);	// wLength
+	put32(p + 8, speed);	// DLBitRRate
+	put32(p + 12, speed);	// ULBitRate
+	p = notify_buffer + 16;
+	p[0] = 0xA1;		// bmRequestType
+	p[1] = 0x00;		// NETWORK_CONNECTION
+	put16(p + 2, 1);	// wValue, 1 = connected
+	put16(p + 4, NCM_STATUS_INTERFACE);
+	put16(p + 6, 0);	// wLength
+	dma_buffer_to_device(notify_buffer, sizeof(notify_buffer));
+	usb_prepare_transfer(notify_transfer + 0, notify_buffer, 16, 0);
+	usb_transmit(NCM_NOTIFY_ENDPOINT, notify_transfer + 0);
+	usb_prepare_transfer(notify_transfer + 1, notify_buffer + 16, 8, 0);
+	usb_transmit(NCM_NOTIFY_ENDPOINT, notify_transfer + 1);
+}
+
+uint32_t usb_ncm_get_interface(void)
+{
+	return ncm_alt_setting;
+}
+
+// GET_NTB_PARAMETERS reply, NCM Spec 6.2.1, Table 6-3.  Returns its length.
+uint32_t usb_ncm_get_ntb_parameters(uint8_t *buffer)
+{
+	put16(buffer + 0, 28);		// wLength
+	put16(buffer + 2, 0x0001);	// bmNtbFormatsSupported, 16 bit only
+	put32(buffer + 4, NCM_NTB_IN_SIZE);	// dwNtbInMaxSize
+	put16(buffer + 8, 4);		// wNdpInDivisor
+	put16(buffer + 10, 0);		// wNdpInPayloadRemainder
+	put16(buffer + 12, 4);		// wNdpInAlignment
+	put16(buffer + 14, 0);		// reserved
+	put32(buffer + 16, NCM_NTB_OUT_SIZE);	// dwNtbOutMaxSize
+	put16(buffer + 20, 4);		// wNdpOutDivisor
+	put16(buffer + 22, 0);		// wNdpOutPayloadRemainder
+	put16(buffer + 24, 4);		// wNdpOutAlignment
+	put16(buffer + 26, 0);		// wNtbOutMaxDatagrams, 0 = no limit
+	return 28;
+}
+
+uint32_t usb_ncm_get_ntb_input_size(void)
+{
+	return ntb_in_size;
+}
+
+// the host may ask for smaller NTBs than GET_NTB_PARAMETERS offered
+void usb_ncm_set_ntb_input_size(uint32_t size)
+{
+	if (size > NCM_NTB_IN_SIZE) size = NCM_NTB_IN_SIZE;
+	if (size < 2048) size = 2048;
+	ntb_in_size = size;
+}
+
+// The host and this device each need a MAC address on the link.  Both are
+// locally administered addresses made from the chip's unique ID, so every
+// Teensy gets different ones.  Either pointer may be NULL.
+void usb_ncm_get_mac(uint8_t *host, uint8_t *device)
+{
+	uint32_t m1 = HW_OCOTP_MAC1;
+	uint32_t m0 = HW_OCOTP_MAC0;
+	uint8_t mac[6];
+
+	mac[0] = 0x02;
+	mac[1] = m1 >> 0;
+	mac[2] = m0 >> 24;
+	mac[3] = m0 >> 16;
+	mac[4] = m0 >> 8;
+	mac[5] = m0 >> 0;
+	if (host) memcpy(host, mac, 6);
+	mac[0] = 0x06;
+	if (device) memcpy(device, mac, 6);
+}
+
+int usb_ncm_link_up(void)
+{
+	return usb_configuration && ncm_alt_setting == 1;
+}
+
+
+/*************************************************************************/
+/**                               Receive                               **/
+/*************************************************************************/
+
+// called from the USB interrupt, or with it disabled
+static void rx_queue_transfer(int i)
+{
+	void *buffer = rx_buffer + i * NCM_NTB_OUT_SIZE;
+	usb_prepare_transfer(rx_transfer + i, buffer, NCM_NTB_OUT_SIZE, i);
+	dma_buffer_from_device(buffer, NCM_NTB_OUT_SIZE);
+	usb_receive(NCM_RX_ENDPOINT, rx_transfer + i);
+}
+
+// called by USB interrupt when a NTB arrives from the host
+static void rx_event(transfer_t *t)
+{
+	int i = t->callback_param;
+	uint32_t len = NCM_NTB_OUT_SIZE - ((t->status >> 16) & 0x7FFF);
+	if (len < 12 + 12) {
+		// too short for any datagram, or a zero length packet
+		rx_queue_transfer(i);
+		return;
+	}
+	rx_count[i] = len;
+	uint32_t head = rx_head;
+	if (++head > RX_NUM) head = 0;
+	rx_list[head] = i;
+	rx_head = head;
+	if (rx_callback) (*rx_callback)();
+}
+
+// Find the next received datagram.  NTBs are parsed as they are read, and
+// given back to the USB controller when all their datagrams are used.
+// Called with the USB interrupt disabled.
+static const uint8_t * rx_find(uint32_t *len)
+{
+	while (rx_tail != rx_head) {
+		uint32_t tail = rx_tail;
+		if (++tail > RX_NUM) tail = 0;
+		uint32_t i = rx_list[tail];
+		const uint8_t *ntb = rx_buffer + i * NCM_NTB_OUT_SIZE;
+		uint32_t count = rx_count[i];
+		if (rx_ndp == 0) {
+			// new NTB, check its NTH16 header
+			if (get32(ntb) == NTH16_SIGNATURE && get16(ntb + 4) == 12) {
+				rx_ndp = get16(ntb + 10);
+				rx_entry = rx_ndp + 8;
+			}
+		}
+		while (rx_ndp >= 12 && rx_ndp + 8 <= count) {
+			const uint8_t *ndp = ntb + rx_ndp;
+			if (get32(ndp) != NDP16_SIGNATURE) break;
+			uint32_t ndp_end = rx_ndp + get16(ndp + 4);
+			if (ndp_end > count) ndp_end = count;
+			while (rx_entry + 4 <= ndp_end) {
+				uint32_t index = get16(ntb + rx_entry);
+				uint32_t length = get16(ntb + rx_entry + 2);
+				if (index == 0 || length == 0) break; // end of table
+				if (index + length <= count) {
+					*len = length;
+					return ntb + index;
+				}
+				rx_entry += 4; // skip a datagram outside the NTB
+			}
+			// this NDP is used up, follow wNextNdpIndex
+			uint32_t next = get16(ndp + 6);
+			if (next <= rx_ndp) break;
+			rx_ndp = next;
+			rx_entry = next + 8;
+		}
+		// all datagrams in this NTB are used
+		rx_tail = tail;
+		rx_ndp = 0;
+		rx_queue_transfer(i);
+	}
+	return NULL;
+}
+
+// set a function to be called (from the USB interrupt) each time frames
+// are received.  NULL disables the notification.
+void usb_ncm_set_rx_callback(void (*callback)(void))
+{
+	NVIC_DISABLE_IRQ(IRQ_USB1);
+	rx_callback = callback;
+	NVIC_ENABLE_IRQ(IRQ_USB1);
+}
+
+// length of the next received frame, or 0 if none
+int usb_ncm_available(void)
+{
+	uint32_t len = 0;
+
+	if (!usb_configuration) return 0;
+	NVIC_DISABLE_IRQ(IRQ_USB1);
+	if (rx_find(&len) == NULL) len = 0;
+	NVIC_ENABLE_IRQ(IRQ_USB1);
+	return len;
+}
+
+// read one frame.  Returns its length, or 0 if none has arrived.  Frames
+// longer than size are truncated.
+int usb_ncm_recv(void *frame, uint32_t size)
+{
+	uint32_t len = 0;
+
+	if (!usb_configuration) return 0;
+	NVIC_DISABLE_IRQ(IRQ_USB1);
+	const uint8_t *p = rx_find(&len);
+	if (p) {
+		if (len > size) len = size;
+		memcpy(frame, p, len);
+		rx_entry += 4;
+	} else {
+		len = 0;
+	}
+	NVIC_ENABLE_IRQ(IRQ_USB1);
+	return len;
+}
+
+
+/*************************************************************************/
+/**                               Transmit                              **/
+/*************************************************************************/
+
+// write the NTH16 header and NDP16 table, and start transmitting the
+// buffer being filled.  Called with the USB interrupt disabled.
+static void tx_send_ntb(void)
+{
+	uint8_t *ntb = txbuffer + tx_head * NCM_NTB_IN_SIZE;
+	uint32_t ndp = NTB_ALIGN(tx_used);
+	uint32_t ndp_len = 8 + (tx_count + 1) * 4;
+	uint32_t len = ndp + ndp_len;
+	uint32_t i;
+
+	put32(ntb + 0, NTH16_SIGNATURE);
+	put16(ntb + 4, 12);		// wHeaderLength
+	put16(ntb + 6, ntb_sequence++);	// wSequence
+	put16(ntb + 8, len);		// wBlockLength
+	put16(ntb + 10, ndp);		// wNdpIndex
+	put32(ntb + ndp, NDP16_SIGNATURE);
+	put16(ntb + ndp + 4, ndp_len);	// wLength
+	put16(ntb + ndp + 6, 0);	// wNextNdpIndex
+	for (i=0; i < tx_count; i++) {
+		put16(ntb + ndp + 8 + i * 4, tx_datagram[i][0]);
+		put16(ntb + ndp + 10 + i * 4, tx_datagram[i][1]);
+	}
+	put32(ntb + ndp + 8 + i * 4, 0);	// end of table
+	dma_buffer_to_device(ntb, len);
+	usb_prepare_transfer(tx_transfer + tx_head, ntb, len, 0);
+	usb_transmit(NCM_TX_ENDPOINT, tx_transfer + tx_head);
+	tx_busy = 1;
+	if (++tx_head >= TX_NUM) tx_head = 0;
+	tx_count = 0;
+	tx_used = 0;
+}
+
+// called by USB interrupt when a NTB has been sent.  Frames which were
+// gathered while it moved go out together in the next NTB.
+static void tx_event(transfer_t *t)
+{
+	tx_busy = 0;
+	if (tx_count > 0) tx_send_ntb();
+}
+
+// Queue one Ethernet frame to the host.  Returns len, or 0 if the link is
+// down or both NTB buffers are full.
+int usb_ncm_send(const void *frame, uint32_t len)
+{
+	if (!usb_ncm_link_up()) return 0;
+	if (len == 0 || len > NCM_MAX_SEGMENT_SIZE) return 0;
+	NVIC_DISABLE_IRQ(IRQ_USB1);
+	uint32_t index = NTB_ALIGN(tx_used ? tx_used : 12);
+	// room for the frame, plus the NDP16 with one more entry
+	uint32_t end = NTB_ALIGN(index + len) + 8 + (tx_count + 2) * 4;
+	if (tx_count >= TX_MAX_DATAGRAMS || end > ntb_in_size) {
+		if (tx_busy) {
+			NVIC_ENABLE_IRQ(IRQ_USB1);
+			return 0;
+		}
+		tx_send_ntb();
+		index = 12;
+	}
+	memcpy(txbuffer + tx_head * NCM_NTB_IN_SIZE + index, frame, len);
+	tx_datagram[tx_count][0] = index;
+	tx_datagram[tx_count][1] = len;
+	tx_count++;
+	tx_used = index + len;
+	if (!tx_busy) tx_send_ntb();
+	NVIC_ENABLE_IRQ(IRQ_USB1);
+	return len;
+}
+
+#endif // NCM_STATUS_INTERFACE
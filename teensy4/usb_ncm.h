@@ -0,0 +1,158 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include "usb_desc.h"
+
+#if defined(NCM_STATUS_INTERFACE)
+
+#include <inttypes.h>
+
+// C language implementation
+#ifdef __cplusplus
+extern "C" {
+#endif
+void usb_ncm_configure(void);
+void usb_ncm_set_interface(uint32_t alt);
+uint32_t usb_ncm_get_interface(void);
+uint32_t usb_ncm_get_ntb_parameters(uint8_t *buffer);
+uint32_t usb_ncm_get_ntb_input_size(void);
+void usb_ncm_set_ntb_input_size(uint32_t size);
+void usb_ncm_get_mac(uint8_t *host, uint8_t *device);
+int usb_ncm_link_up(void);
+int usb_ncm_send(const void *frame, uint32_t len);
+int usb_ncm_available(void);
+int usb_ncm_recv(void *frame, uint32_t size);
+void usb_ncm_set_rx_callback(void (*callback)(void));
+#ifdef __cplusplus
+}
+#endif
+
+
+// C++ interface
+#ifdef __cplusplus
+#include "IPAddress.h"
+#include "Udp.h"
+
+class EventResponder;
+class NetUSBUDP;
+
+// A point-to-point Ethernet link to the USB host.  The host sees a network
+// adapter, so normal sockets and tools work.  Only the host is on the link,
+// so every frame is sent to the host's MAC address.  ARP requests for
+// localIP() and ping (ICMP echo) are answered, and UDP is delivered to
+// NetUSBUDP sockets.  TCP is not implemented.
+class usb_ncm_class
+{
+public:
+	// set this end's IP address, typically 192.168.x.2 with the host
+	// configured as 192.168.x.1
+	void begin(IPAddress ip) { local_ip = ip; }
+	IPAddress localIP() { return local_ip; }
+	// true when the host has enabled the link
+	bool linkStatus(void) { return usb_ncm_link_up(); }
+	void macAddress(uint8_t *mac) { usb_ncm_get_mac(nullptr, mac); }
+	// Process received frames.  NetUSBUDP::parsePacket() calls this, so it
+	// only needs to be called when no socket is read often.
+	void poll(void);
+	// Raw Ethernet frames, without CRC.  Frames are gathered into NCM
+	// transfer blocks, so many small frames move in one USB transfer.
+	// Frames read here are not seen by poll().
+	int sendFrame(const void *frame, uint32_t len) { return usb_ncm_send(frame, len); }
+	int frameAvailable(void) { return usb_ncm_available(); }
+	int receiveFrame(void *frame, uint32_t size) { return usb_ncm_recv(frame, size); }
+	// Trigger an EventResponder when frames arrive from the host.  The
+	// event's data is this usb_ncm_class.
+	void attachRxEvent(EventResponder &event);
+	void detachRxEvent() { usb_ncm_set_rx_callback(nullptr); }
+private:
+	friend class NetUSBUDP;
+	void handle_frame(uint8_t *frame, uint32_t len);
+	int send_ip(uint8_t *frame, uint32_t len);
+	IPAddress local_ip;
+	NetUSBUDP *sockets = nullptr;
+	uint16_t ip_id = 0;
+};
+
+extern usb_ncm_class NetUSB;
+
+// UDP over the USB network link.  Each socket buffers one received packet.
+// Packets which arrive while it is still unread are dropped.
+class NetUSBUDP : public UDP
+{
+public:
+	NetUSBUDP() {}
+	~NetUSBUDP() { stop(); }
+	virtual uint8_t begin(uint16_t port);
+	virtual void stop();
+	virtual int beginPacket(IPAddress ip, uint16_t port);
+	// host names are not supported, there is no DNS on the link
+	virtual int beginPacket(const char *host, uint16_t port) { return 0; }
+	virtual int endPacket();
+	virtual size_t write(uint8_t b) { return write(&b, 1); }
+	virtual size_t write(const uint8_t *buffer, size_t size);
+	using Print::write;
+	virtual int parsePacket();
+	virtual int available() { return rx_len - rx_pos; }
+	virtual int read();
+	virtual int read(unsigned char* buffer, size_t len);
+	virtual int read(char* buffer, size_t len) { return read((unsigned char *)buffer, len); }
+	virtual int peek();
+	virtual void flush() { rx_pos = rx_len; }
+	virtual IPAddress remoteIP() { return remote_ip; }
+	virtual uint16_t remotePort() { return remote_port; }
+	// zero copy, the packet is built in and read from the socket's buffers
+	virtual int beginPacketBuffer(uint8_t **buffer, size_t *capacity);
+	virtual int endPacketBuffer(size_t len);
+	virtual int readBuffer(const uint8_t **buffer);
+	static const uint32_t max_payload = 1472;
+private:
+	friend class usb_ncm_class;
+	NetUSBUDP *next = nullptr;
+	uint16_t local_port = 0;
+	uint16_t remote_port = 0;
+	IPAddress remote_ip;
+	uint16_t rx_len = 0;
+	uint16_t rx_pos = 0;
+	uint16_t rx_pending = 0; // length of a packet not yet given by parsePacket
+	uint16_t rx_pending_port = 0;
+	IPAddress rx_pending_ip;
+	uint16_t tx_len = 0;
+	uint16_t tx_port = 0;
+	IPAddress tx_ip;
+	bool tx_active = false;
+	uint8_t rx_buffer[max_payload];
+	uint8_t tx_frame[14 + 20 + 8 + max_payload];
+};
+
+#endif // __cplusplus
+
+#endif // NCM_STATUS_INTERFACE
@@ -0,0 +1,296 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "usb_dev.h"
+#include "usb_ncm.h"
+#include <string.h>
+
+#ifdef NCM_STATUS_INTERFACE // defined by usb_dev.h -> usb_desc.h
+
+// Minimal IPv4 for the point-to-point USB network.  The host is the only
+// other node, so there is no routing and no ARP table: frames always go to
+// the host's MAC address.  Only ARP replies, ping replies and UDP are
+// handled.  Everything else the host sends is ignored.
+
+#define ETH_HEADER  14
+#define IP_HEADER   20
+#define UDP_HEADER  8
+
+static inline uint32_t get16(const uint8_t *p)
+{
+	return (p[0] << 8) | p[1];
+}
+
+static inline void put16(uint8_t *p, uint32_t n)
+{
+	p[0] = n >> 8;
+	p[1] = n;
+}
+
+static void put_ip(uint8_t *p, const IPAddress &ip)
+{
+	for (int i=0; i < 4; i++) p[i] = ip[i];
+}
+
+// ones complement sum of 16 bit big endian words, RFC 1071
+static uint32_t checksum_add(uint32_t sum, const uint8_t *data, uint32_t len)
+{
+	while (len > 1) {
+		sum += (data[0] << 8) | data[1];
+		data += 2;
+		len -= 2;
+	}
+	if (len) sum += data[0] << 8;
+	return sum;
+}
+
+static uint32_t checksum_final(uint32_t sum)
+{
+	while (sum >> 16) sum = (sum & 0xFFFF) + (sum >> 16);
+	return ~sum & 0xFFFF;
+}
+
+void usb_ncm_class::poll(void)
+{
+	static uint8_t frame[NCM_MAX_SEGMENT_SIZE];
+
+	while (1) {
+		int len = usb_ncm_recv(frame, sizeof(frame));
+		if (len <= 0) break;
+		handle_frame(frame, len);
+	}
+}
+
+void usb_ncm_class::handle_frame(uint8_t *frame, uint32_t len)
+{
+	uint8_t *ip = frame + ETH_HEADER;
+	uint32_t ethertype = get16(frame + 12);
+
+	if (ethertype == 0x0806 && len >= ETH_HEADER + 28) {
+		// ARP, reply to requests for our address
+		if (get16(ip + 0) != 1 || get16(ip + 2) != 0x0800) return;
+		if (ip[4] != 6 || ip[5] != 4 || get16(ip + 6) != 1) return;
+		if (!(local_ip == ip + 24)) return;
+		put16(ip + 6, 2);		// ARP reply
+		memcpy(ip + 18, ip + 8, 10);	// requester becomes target
+		usb_ncm_get_mac(NULL, ip + 8);
+		put_ip(ip + 14, local_ip);
+		memcpy(frame, ip + 18, 6);
+		memcpy(frame + 6, ip + 8, 6);
+		usb_ncm_send(frame, ETH_HEADER + 28);
+		return;
+	}
+	if (ethertype != 0x0800 || len < ETH_HEADER + IP_HEADER) return;
+	uint32_t ihl = (ip[0] & 15) * 4;
+	uint32_t total = get16(ip + 2);
+	if ((ip[0] >> 4) != 4 || ihl < IP_HEADER || total < ihl) return;
+	if (total > len - ETH_HEADER) return;
+	if (get16(ip + 6) & 0x3FFF) return;	// fragments are not supported
+	if (!(local_ip == ip + 16)) return;
+	uint8_t *payload = ip + ihl;
+	uint32_t payload_len = total - ihl;
+
+	if (ip[9] == 1) {
+		// ICMP, answer echo requests (ping)
+		if (payload_len < 8 || payload[0] != 8) return;
+		payload[0] = 0;		// echo reply
+		put16(payload + 2, 0);
+		put16(payload + 2, checksum_final(checksum_add(0, payload, payload_len)));
+		memcpy(ip + 16, ip + 12, 4);
+		if (ihl > IP_HEADER) {
+			// drop any IP options from the reply
+			memmove(ip + IP_HEADER, payload, payload_len);
+			ip[0] = 0x45;
+		}
+		send_ip(frame, payload_len);
+	} else if (ip[9] == 17) {
+		// UDP, give to the socket listening on the port
+		if (payload_len < UDP_HEADER) return;
+		uint32_t udp_len = get16(payload + 4);
+		if (udp_len < UDP_HEADER || udp_len > payload_len) return;
+		uint32_t port = get16(payload + 2);
+		for (NetUSBUDP *s = sockets; s; s = s->next) {
+			if (s->local_port != port) continue;
+			// keep the packet only if the socket is done with its buffer
+			if (s->rx_pending || s->rx_pos < s->rx_len) return;
+			uint32_t n = udp_len - UDP_HEADER;
+			if (n > NetUSBUDP::max_payload) n = NetUSBUDP::max_payload;
+			memcpy(s->rx_buffer, payload + UDP_HEADER, n);
+			s->rx_pending = n;
+			s->rx_pending_port = get16(payload);
+			s->rx_pending_ip = ip + 12;
+			return;
+		}
+	}
+}
+
+// Fill in the Ethernet and IP headers of a frame with "len" bytes of
+// payload after a 20 byte IP header, and send it to the host.  The IP
+// protocol and destination address must already be set.
+int usb_ncm_class::send_ip(uint8_t *frame, uint32_t len)
+{
+	uint8_t *ip = frame + ETH_HEADER;
+
+	usb_ncm_get_mac(frame, frame + 6);
+	put16(frame + 12, 0x0800);
+	ip[0] = 0x45;		// IPv4, 20 byte header
+	ip[1] = 0;
+	put16(ip + 2, IP_HEADER + len);
+	put16(ip + 4, ip_id++);
+	put16(ip + 6, 0x4000);	// don't fragment
+	ip[8] = 64;		// time to live
+	put16(ip + 10, 0);
+	put_ip(ip + 12, local_ip);
+	put16(ip + 10, checksum_final(checksum_add(0, ip, IP_HEADER)));
+	return usb_ncm_send(frame, ETH_HEADER + IP_HEADER + len);
+}
+
+
+uint8_t NetUSBUDP::begin(uint16_t port)
+{
+	stop();
+	local_port = port;
+	rx_len = rx_pos = rx_pending = 0;
+	next = NetUSB.sockets;
+	NetUSB.sockets = this;
+	return 1;
+}
+
+void NetUSBUDP::stop()
+{
+	for (NetUSBUDP **p = &NetUSB.sockets; *p; p = &(*p)->next) {
+		if (*p == this) {
+			*p = next;
+			break;
+		}
+	}
+	next = nullptr;
+	local_port = 0;
+}
+
+int NetUSBUDP::beginPacket(IPAddress ip, uint16_t port)
+{
+	tx_ip = ip;
+	tx_port = port;
+	tx_len = 0;
+	tx_active = true;
+	return 1;
+}
+
+size_t NetUSBUDP::write(const uint8_t *buffer, size_t size)
+{
+	if (!tx_active) return 0;
+	if (size > max_payload - tx_len) size = max_payload - tx_len;
+	memcpy(tx_frame + ETH_HEADER + IP_HEADER + UDP_HEADER + tx_len, buffer, size);
+	tx_len += size;
+	return size;
+}
+
+int NetUSBUDP::endPacket()
+{
+	if (!tx_active) return 0;
+	tx_active = false;
+	uint8_t *ip = tx_frame + ETH_HEADER;
+	uint8_t *udp = ip + IP_HEADER;
+	uint32_t len = UDP_HEADER + tx_len;
+
+	ip[9] = 17;
+	put_ip(ip + 12, NetUSB.local_ip);
+	put_ip(ip + 16, tx_ip);
+	put16(udp + 0, local_port);
+	put16(udp + 2, tx_port);
+	put16(udp + 4, len);
+	put16(udp + 6, 0);
+	// checksum covers a pseudo header of addresses, protocol and length
+	uint32_t sum = checksum_add(0, ip + 12, 8);
+	sum += 17 + len;
+	sum = checksum_final(checksum_add(sum, udp, len));
+	put16(udp + 6, sum ? sum : 0xFFFF);
+	return NetUSB.send_ip(tx_frame, len) > 0;
+}
+
+int NetUSBUDP::beginPacketBuffer(uint8_t **buffer, size_t *capacity)
+{
+	if (!tx_active) return 0;
+	*buffer = tx_frame + ETH_HEADER + IP_HEADER + UDP_HEADER;
+	*capacity = max_payload;
+	return 1;
+}
+
+int NetUSBUDP::endPacketBuffer(size_t len)
+{
+	if (len > max_payload) return 0;
+	tx_len = len;
+	return endPacket();
+}
+
+int NetUSBUDP::readBuffer(const uint8_t **buffer)
+{
+	int len = rx_len - rx_pos;
+	if (len <= 0) return 0;
+	*buffer = rx_buffer + rx_pos;
+	rx_pos = rx_len;
+	return len;
+}
+
+int NetUSBUDP::parsePacket()
+{
+	rx_len = rx_pos = 0;
+	NetUSB.poll();
+	if (!rx_pending) return 0;
+	rx_len = rx_pending;
+	rx_pending = 0;
+	remote_ip = rx_pending_ip;
+	remote_port = rx_pending_port;
+	return rx_len;
+}
+
+int NetUSBUDP::read()
+{
+	if (rx_pos >= rx_len) return -1;
+	return rx_buffer[rx_pos++];
+}
+
+int NetUSBUDP::read(unsigned char* buffer, size_t len)
+{
+	size_t avail = rx_len - rx_pos;
+	if (len > avail) len = avail;
+	memcpy(buffer, rx_buffer + rx_pos, len);
+	rx_pos += len;
+	return len;
+}
+
+int NetUSBUDP::peek()
+{
+	if (rx_pos >= rx_len) return -1;
+	return rx_buffer[rx_pos];
+}
+
+#endif // NCM_STATUS_INTERFACE
@@ -39,12 +39,24 @@
 
 #ifdef RAWHID_INTERFACE // defined by usb_dev.h -> usb_desc.h
 
-#define TX_NUM   4
+// Queue depth, in reports.  More allow send_batch() and recv_batch() to
+// keep the bus busy longer between calls, each costing RAWHID_TX_SIZE or
+// RAWHID_RX_SIZE of DMAMEM.
+#ifndef RAWHID_TX_NUM
+#define RAWHID_TX_NUM  4
+#endif
+#ifndef RAWHID_RX_NUM
+#define RAWHID_RX_NUM  4
+#endif
+
+extern volatile uint8_t usb_high_speed;
+
+#define TX_NUM   RAWHID_TX_NUM
 static transfer_t tx_transfer[TX_NUM] __attribute__ ((used, aligned(32)));
-DMAMEM static uint8_t txbuffer[RAWHID_TX_SIZE * TX_NUM];
+DMAMEM static uint8_t txbuffer[RAWHID_TX_SIZE * TX_NUM] __attribute__ ((aligned(32)));
 static uint8_t tx_head=0;
 
-#define RX_NUM  4
+#define RX_NUM   RAWHID_RX_NUM
 static transfer_t rx_transfer[RX_NUM] __attribute__ ((used, aligned(32)));
 DMAMEM static uint8_t rx_buffer[RAWHID_RX_SIZE * RX_NUM] __attribute__ ((aligned(32)));
 static volatile uint8_t rx_head;
@@ -53,6 +65,7 @@ static uint8_t rx_list[RX_NUM + 1];
 static volatile uint32_t rx_available;
 static void rx_queue_transfer(int i);
 static void rx_event(transfer_t *t);
+static int (*rx_callback)(const void *report, uint32_t len) = NULL;
 extern volatile uint8_t usb_configuration;
 
 
@@ -64,8 +77,9 @@ void usb_rawhid_configure(void)
 	tx_head = 0;
 	rx_head = 0;
 	rx_tail = 0;
-	usb_config_tx(RAWHID_TX_ENDPOINT, RAWHID_TX_SIZE, 0, NULL);
-	usb_config_rx(RAWHID_RX_ENDPOINT, RAWHID_RX_SIZE, 0, rx_event);
+	// at 12 Mbit/sec, reports over 64 bytes are split into several packets
+	usb_config_tx(RAWHID_TX_ENDPOINT, usb_high_speed ? RAWHID_TX_SIZE : RAWHID_TX_PACKET_12, 0, NULL);
+	usb_config_rx(RAWHID_RX_ENDPOINT, usb_high_speed ? RAWHID_RX_SIZE : RAWHID_RX_PACKET_12, 0, rx_event);
 	int i;
 	for (i=0; i < RX_NUM; i++) rx_queue_transfer(i);
 }
@@ -77,7 +91,7 @@ void usb_rawhid_configure(void)
 static void rx_queue_transfer(int i)
 {
 	void *buffer = rx_buffer + i * RAWHID_RX_SIZE;
-	arm_dcache_delete(buffer, RAWHID_RX_SIZE);
+	dma_buffer_from_device(buffer, RAWHID_RX_SIZE);
 	//memset(buffer, )
 	NVIC_DISABLE_IRQ(IRQ_USB1);
 	usb_prepare_transfer(rx_transfer + i, buffer, RAWHID_RX_SIZE, i);
@@ -90,6 +104,13 @@ static void rx_event(transfer_t *t)
 	int i = t->callback_param;
 	//printf("rx event i=%d\n", i);
 	// received a packet with data
+	if (rx_callback) {
+		// a callback which consumes the report lets it skip the queue
+		if ((*rx_callback)(rx_buffer + i * RAWHID_RX_SIZE, RAWHID_RX_SIZE)) {
+			rx_queue_transfer(i);
+			return;
+		}
+	}
 	uint32_t head = rx_head;
 	if (++head > RX_NUM) head = 0;
 	rx_list[head] = i;
@@ -97,10 +118,34 @@ static void rx_event(transfer_t *t)
 }
 
 
+// set a function to be called from the USB interrupt as each report
+// arrives, with a pointer to it in the receive buffer.  If the function
+// returns non-zero the report is consumed and its buffer is reused right
+// away, otherwise it is kept for usb_rawhid_recv().  NULL disables.
+void usb_rawhid_set_rx_callback(int (*callback)(const void *report, uint32_t len))
+{
+	NVIC_DISABLE_IRQ(IRQ_USB1);
+	rx_callback = callback;
+	NVIC_ENABLE_IRQ(IRQ_USB1);
+}
+
 int usb_rawhid_recv(void *buffer, uint32_t timeout)
+{
+	int r = usb_rawhid_recv_batch(buffer, 1, timeout);
+	return (r > 0) ? RAWHID_RX_SIZE : r;
+}
+
+// receive up to count reports into buffer (RAWHID_RX_SIZE bytes apart).
+// Waits up to timeout for the first, then takes all which have arrived.
+// Returns the number of reports, 0 on timeout, -1 if not enumerated.
+int usb_rawhid_recv_batch(void *buffer, uint32_t count, uint32_t timeout)
 {
 	uint32_t wait_begin_at = systick_millis_count;
 	uint32_t tail = rx_tail;
+	uint8_t *p = (uint8_t *)buffer;
+	uint32_t n = 0;
+
+	if (count == 0) return 0;
 	while (1) {
 		if (!usb_configuration) return -1; // usb not enumerated by host
 		if (tail != rx_head) break;
@@ -109,38 +154,52 @@ int usb_rawhid_recv(void *buffer, uint32_t timeout)
 		}
 		yield();
 	}
-//	digitalWriteFast(0, LOW);
-	if (++tail > RX_NUM) tail = 0;
-	uint32_t i = rx_list[tail];
-	rx_tail = tail;
-
-	memcpy(buffer,  rx_buffer + i * RAWHID_RX_SIZE, RAWHID_RX_SIZE);
-	rx_queue_transfer(i);
-	//memset(rx_transfer, 0, sizeof(rx_transfer));
-	//usb_prepare_transfer(rx_transfer + 0, rx_buffer, RAWHID_RX_SIZE, 0);
-	//usb_receive(RAWHID_RX_ENDPOINT, rx_transfer + 0);
-	return RAWHID_RX_SIZE;
+	do {
+		if (++tail > RX_NUM) tail = 0;
+		uint32_t i = rx_list[tail];
+		rx_tail = tail;
+		memcpy(p, rx_buffer + i * RAWHID_RX_SIZE, RAWHID_RX_SIZE);
+		rx_queue_transfer(i);
+		p += RAWHID_RX_SIZE;
+		n++;
+	} while (n < count && tail != rx_head);
+	return n;
 }
 
 int usb_rawhid_send(const void *buffer, uint32_t timeout)
 {
-	transfer_t *xfer = tx_transfer + tx_head;
-	uint32_t wait_begin_at = systick_millis_count;
+	int r = usb_rawhid_send_batch(buffer, 1, timeout);
+	return (r > 0) ? RAWHID_TX_SIZE : r;
+}
 
-	while (1) {
-		if (!usb_configuration) return -1; // usb not enumerated by host
-		uint32_t status = usb_transfer_status(xfer);
-		if (!(status & 0x80)) break; // transfer descriptor ready
-		if (systick_millis_count - wait_begin_at > timeout) return 0;
-		yield();
+// send count reports from buffer (RAWHID_TX_SIZE bytes apart).  Each is
+// queued as soon as a transmit buffer is free, for up to timeout in total.
+// Returns the number queued, which is less than count on timeout, or -1
+// if not enumerated.
+int usb_rawhid_send_batch(const void *buffer, uint32_t count, uint32_t timeout)
+{
+	uint32_t wait_begin_at = systick_millis_count;
+	const uint8_t *p = (const uint8_t *)buffer;
+	uint32_t n;
+
+	for (n=0; n < count; n++) {
+		transfer_t *xfer = tx_transfer + tx_head;
+		while (1) {
+			if (!usb_configuration) return -1; // usb not enumerated by host
+			uint32_t status = usb_transfer_status(xfer);
+			if (!(status & 0x80)) break; // transfer descriptor ready
+			if (systick_millis_count - wait_begin_at > timeout) return n;
+			yield();
+		}
+		uint8_t *txdata = txbuffer + (tx_head * RAWHID_TX_SIZE);
+		memcpy(txdata, p, RAWHID_TX_SIZE);
+		dma_buffer_to_device(txdata, RAWHID_TX_SIZE );
+		usb_prepare_transfer(xfer, txdata, RAWHID_TX_SIZE, 0);
+		usb_transmit(RAWHID_TX_ENDPOINT, xfer);
+		if (++tx_head >= TX_NUM) tx_head = 0;
+		p += RAWHID_TX_SIZE;
 	}
-	uint8_t *txdata = txbuffer + (tx_head * RAWHID_TX_SIZE);
-	memcpy(txdata, buffer, RAWHID_TX_SIZE);
-	arm_dcache_flush_delete(txdata, RAWHID_TX_SIZE );
-	usb_prepare_transfer(xfer, txdata, RAWHID_TX_SIZE, 0);
-	usb_transmit(RAWHID_TX_ENDPOINT, xfer);
-	if (++tx_head >= TX_NUM) tx_head = 0;
-	return RAWHID_TX_SIZE;
+	return n;
 }
 
 int usb_rawhid_available(void)
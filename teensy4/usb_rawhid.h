@@ -44,6 +44,9 @@ void usb_rawhid_configure(void);
 int usb_rawhid_recv(void *buffer, uint32_t timeout);
 int usb_rawhid_available(void);
 int usb_rawhid_send(const void *buffer, uint32_t timeout);
+int usb_rawhid_recv_batch(void *buffer, uint32_t count, uint32_t timeout);
+int usb_rawhid_send_batch(const void *buffer, uint32_t count, uint32_t timeout);
+void usb_rawhid_set_rx_callback(int (*callback)(const void *report, uint32_t len));
 #ifdef __cplusplus
 }
 #endif
@@ -51,12 +54,26 @@ int usb_rawhid_send(const void *buffer, uint32_t timeout);
 
 // C++ interface
 #ifdef __cplusplus
+class EventResponder;
 class usb_rawhid_class
 {
 public:
 	int available(void) {return usb_rawhid_available(); }
 	int recv(void *buffer, uint16_t timeout) { return usb_rawhid_recv(buffer, timeout); }
 	int send(const void *buffer, uint16_t timeout) { return usb_rawhid_send(buffer, timeout); }
+	// Move many reports per call, packed back to back in buffer.  These
+	// return the number of reports transferred, or -1 if not enumerated.
+	int recvBatch(void *buffer, uint32_t count, uint16_t timeout) { return usb_rawhid_recv_batch(buffer, count, timeout); }
+	int sendBatch(const void *buffer, uint32_t count, uint16_t timeout) { return usb_rawhid_send_batch(buffer, count, timeout); }
+	// Run a function from the USB interrupt as each report arrives, with
+	// the report still in the receive buffer.  Return true to consume it,
+	// or false to leave it for recv().  Keep it short: the next report
+	// can not be received into this buffer until it returns.
+	void attachRxInterrupt(int (*function)(const void *report, uint32_t len)) { usb_rawhid_set_rx_callback(function); }
+	// Or trigger an EventResponder, with status RAWHID_RX_SIZE and data
+	// this object.  The report stays queued for recv().
+	void attachRxEvent(EventResponder &event);
+	void detachRx() { usb_rawhid_set_rx_callback(nullptr); }
 };
 
 extern usb_rawhid_class RawHID;
@@ -42,14 +42,22 @@ static volatile uint8_t tx_noautoflush=0;
 extern volatile uint8_t usb_high_speed;
 volatile uint8_t usb_seremu_online=0;
 
-// TODO: should be 2 different timeouts, high speed (480) vs full speed (12)
-#define TRANSMIT_FLUSH_TIMEOUT  75   /* in microseconds */
+// How long to wait for more data before transmitting a partially filled
+// report.  At 12 Mbit/sec reports are only sent once per 1 ms frame, so a
+// longer timeout costs little latency and allows fuller reports.
+#define TRANSMIT_FLUSH_TIMEOUT_480	75   /* in microseconds */
+#define TRANSMIT_FLUSH_TIMEOUT_12	250  /* in microseconds */
 static void timer_config(void (*callback)(void), uint32_t microseconds);
 static void timer_start_oneshot();
 static void timer_stop();
 static void usb_seremu_flush_callback(void);
 
-#define TX_NUM   12
+// At 480 Mbit/sec the host polls every 125 us microframe, up to 8000 reports
+// per second.  A deep queue lets Serial.print() run ahead without waiting.
+#ifndef SEREMU_TX_NUM
+#define SEREMU_TX_NUM  32
+#endif
+#define TX_NUM   SEREMU_TX_NUM
 static transfer_t tx_transfer[TX_NUM] __attribute__ ((used, aligned(32)));
 DMAMEM static uint8_t txbuffer[SEREMU_TX_SIZE * TX_NUM] __attribute__ ((aligned(32)));
 static uint8_t tx_head=0;
@@ -82,7 +90,8 @@ void usb_seremu_configure(void)
 	usb_config_tx(SEREMU_TX_ENDPOINT, SEREMU_TX_SIZE, 0, NULL);     // SEREMU_TX_SIZE = 64
 	int i;
 	for (i=0; i < RX_NUM; i++) rx_queue_transfer(i);
-	timer_config(usb_seremu_flush_callback, TRANSMIT_FLUSH_TIMEOUT);
+	timer_config(usb_seremu_flush_callback, usb_high_speed ?
+		TRANSMIT_FLUSH_TIMEOUT_480 : TRANSMIT_FLUSH_TIMEOUT_12);
 }
 
 
@@ -95,7 +104,7 @@ static void rx_queue_transfer(int i)
 	NVIC_DISABLE_IRQ(IRQ_USB1);
 	void *buffer = rx_buffer + i * SEREMU_RX_SIZE;
 	usb_prepare_transfer(rx_transfer + i, buffer, SEREMU_RX_SIZE, i);
-	arm_dcache_delete(buffer, SEREMU_RX_SIZE);
+	dma_buffer_from_device(buffer, SEREMU_RX_SIZE);
 	usb_receive(SEREMU_RX_ENDPOINT, rx_transfer + i);
 	NVIC_ENABLE_IRQ(IRQ_USB1);
 }
@@ -114,7 +123,7 @@ static void rx_event(transfer_t *t)
 		rx_list[head] = i;
 		rx_head = head;
 		rx_available += len;
-		// TODO: trigger serialEvent
+		yield_ready(YIELD_CHECK_USB_SERIAL);
 	} else {
 		// received a short packet - should never happen with HID
 		rx_queue_transfer(i);
@@ -237,7 +246,7 @@ void tx_queue_transfer(void)
 	transfer_t *xfer = tx_transfer + tx_head;
 	uint8_t *txbuf = txbuffer + (tx_head * SEREMU_TX_SIZE);
 	usb_prepare_transfer(xfer, txbuf, SEREMU_TX_SIZE, 0);
-	arm_dcache_flush_delete(txbuf, SEREMU_TX_SIZE);
+	dma_buffer_to_device(txbuf, SEREMU_TX_SIZE);
 	usb_transmit(SEREMU_TX_ENDPOINT, xfer);
 	if (++tx_head >= TX_NUM) tx_head = 0;
 }
@@ -302,7 +311,20 @@ int usb_seremu_write(const void *buffer, uint32_t size)
 
 int usb_seremu_write_buffer_free(void)
 {
-	return 1;
+	uint32_t sum = 0;
+	tx_noautoflush = 1;
+	for (uint32_t i=0; i < TX_NUM; i++) {
+		if (i == tx_head) continue;
+		if (!(usb_transfer_status(tx_transfer + i) & 0x80)) sum += SEREMU_TX_SIZE;
+	}
+	if (tx_available) {
+		sum += tx_available;
+	} else if (!(usb_transfer_status(tx_transfer + tx_head) & 0x80)) {
+		sum += SEREMU_TX_SIZE;
+	}
+	asm("dsb" ::: "memory");
+	tx_noautoflush = 0;
+	return sum;
 }
 
 void usb_seremu_flush_output(void)
@@ -30,17 +30,14 @@
 
 #include "usb_dev.h"
 #include "usb_serial.h"
-#include "core_pins.h"// for delay()
-//#include "HardwareSerial.h"
-#include <string.h> // for memcpy()
+#include "usb_cdc.h"
+#include "core_pins.h"
 #include "avr/pgmspace.h" // for PROGMEM, DMAMEM, FASTRUN
 
 #include "debug/printf.h"
-#include "core_pins.h"
 
 // defined by usb_dev.h -> usb_desc.h
 #if defined(CDC_STATUS_INTERFACE) && defined(CDC_DATA_INTERFACE)
-//#if F_CPU >= 20000000
 
 // At very slow CPU speeds, the OCRAM just isn't fast enough for
 // USB to work reliably.  But the precious/limited DTCM is.  So
@@ -56,38 +53,40 @@ volatile uint32_t usb_cdc_line_rtsdtr_millis;
 volatile uint8_t usb_cdc_line_rtsdtr=0;
 volatile uint8_t usb_cdc_transmit_flush_timer=0;
 
-static volatile uint8_t tx_noautoflush=0;
-extern volatile uint8_t usb_high_speed;
-
-// TODO: should be 2 different timeouts, high speed (480) vs full speed (12)
-#define TRANSMIT_FLUSH_TIMEOUT	75   /* in microseconds */
-
-static void timer_config(void (*callback)(void), uint32_t microseconds);
-static void timer_start_oneshot();
-static void timer_stop();
-static void usb_serial_flush_callback(void);
+DMAMEM static uint8_t txbuffer[USB_CDC_TX_SIZE * USB_CDC_TX_NUM] __attribute__ ((aligned(32)));
+DMAMEM static uint8_t rx_buffer[USB_CDC_RX_NUM * CDC_RX_SIZE_480] __attribute__ ((aligned(32)));
+static void rx_event(transfer_t *t);
+static void tx_event(transfer_t *t);
+static void flush_callback(void);
+
+static const usb_cdc_config_t config = {
+	.acm_endpoint = CDC_ACM_ENDPOINT,
+	.rx_endpoint = CDC_RX_ENDPOINT,
+	.tx_endpoint = CDC_TX_ENDPOINT,
+	.timer = USB_CDC_TIMER_GPT0,
+	.yield_flag = YIELD_CHECK_USB_SERIAL,
+	.tx_buffer = txbuffer,
+	.rx_buffer = rx_buffer,
+	.rx_event = rx_event,
+	.tx_event = tx_event,
+	.flush_callback = flush_callback
+};
+usb_cdc_port_t usb_serial_port = USB_CDC_PORT_INIT(config);
 
-#define TX_NUM   4
-#define TX_SIZE  2048 /* should be a multiple of CDC_TX_SIZE */
-static transfer_t tx_transfer[TX_NUM] __attribute__ ((used, aligned(32)));
-DMAMEM static uint8_t txbuffer[TX_SIZE * TX_NUM] __attribute__ ((aligned(32)));
-static uint8_t tx_head=0;
-static uint16_t tx_available=0;
-static uint16_t tx_packet_size=0;
+static void rx_event(transfer_t *t)
+{
+	usb_cdc_rx_event(&usb_serial_port, t);
+}
 
-#define RX_NUM  8
-static transfer_t rx_transfer[RX_NUM] __attribute__ ((used, aligned(32)));
-DMAMEM static uint8_t rx_buffer[RX_NUM * CDC_RX_SIZE_480] __attribute__ ((aligned(32)));
-static uint16_t rx_count[RX_NUM];
-static uint16_t rx_index[RX_NUM];
-static uint16_t rx_packet_size=0;
-static volatile uint8_t rx_head;
-static volatile uint8_t rx_tail;
-static uint8_t rx_list[RX_NUM + 1];
-static volatile uint32_t rx_available;
-static void rx_queue_transfer(int i);
-static void rx_event(transfer_t *t);
+static void tx_event(transfer_t *t)
+{
+	usb_cdc_tx_event(&usb_serial_port, t);
+}
 
+static void flush_callback(void)
+{
+	usb_cdc_flush_callback(&usb_serial_port);
+}
 
 void usb_serial_reset(void)
 {
@@ -97,350 +96,99 @@ void usb_serial_reset(void)
 
 void usb_serial_configure(void)
 {
-	int i;
-
 	printf("usb_serial_configure\n");
-	if (usb_high_speed) {
-		tx_packet_size = CDC_TX_SIZE_480;
-		rx_packet_size = CDC_RX_SIZE_480;
-	} else {
-		tx_packet_size = CDC_TX_SIZE_12;
-		rx_packet_size = CDC_RX_SIZE_12;
-	}
-	memset(tx_transfer, 0, sizeof(tx_transfer));
-	tx_head = 0;
-	tx_available = 0;
-	memset(rx_transfer, 0, sizeof(rx_transfer));
-	memset(rx_count, 0, sizeof(rx_count));
-	memset(rx_index, 0, sizeof(rx_index));
-	rx_head = 0;
-	rx_tail = 0;
-	rx_available = 0;
-	usb_config_tx(CDC_ACM_ENDPOINT, CDC_ACM_SIZE, 0, NULL); // size same 12 & 480
-	usb_config_rx(CDC_RX_ENDPOINT, rx_packet_size, 0, rx_event);
-	usb_config_tx(CDC_TX_ENDPOINT, tx_packet_size, 1, NULL);
-	for (i=0; i < RX_NUM; i++) rx_queue_transfer(i);
-	timer_config(usb_serial_flush_callback, TRANSMIT_FLUSH_TIMEOUT);
+	usb_cdc_configure(&usb_serial_port);
 }
 
-
-/*************************************************************************/
-/**                               Receive                               **/
-/*************************************************************************/
-
-static void rx_queue_transfer(int i)
+int usb_serial_getchar(void)
 {
-	NVIC_DISABLE_IRQ(IRQ_USB1);
-	printf("rx queue i=%d\n", i);
-	void *buffer = rx_buffer + i * CDC_RX_SIZE_480;
-	usb_prepare_transfer(rx_transfer + i, buffer, rx_packet_size, i);
-	arm_dcache_delete(buffer, rx_packet_size);
-	usb_receive(CDC_RX_ENDPOINT, rx_transfer + i);
-	NVIC_ENABLE_IRQ(IRQ_USB1);
+	return usb_cdc_getchar(&usb_serial_port);
 }
 
-// called by USB interrupt when any packet is received
-static void rx_event(transfer_t *t)
+int usb_serial_peekchar(void)
 {
-	int len = rx_packet_size - ((t->status >> 16) & 0x7FFF);
-	int i = t->callback_param;
-	printf("rx event, len=%d, i=%d\n", len, i);
-	if (len > 0) {
-		// received a packet with data
-		uint32_t head = rx_head;
-		if (head != rx_tail) {
-			// a previous packet is still buffered
-			uint32_t ii = rx_list[head];
-			uint32_t count = rx_count[ii];
-			if (len <= CDC_RX_SIZE_480 - count) {
-				// previous buffer has enough free space for this packet's data
-				memcpy(rx_buffer + ii * CDC_RX_SIZE_480 + count,
-					rx_buffer + i * CDC_RX_SIZE_480, len);
-				rx_count[ii] = count + len;
-				rx_available += len;
-				rx_queue_transfer(i);
-				// TODO: trigger serialEvent
-				return;
-			}
-		}
-		// add this packet to rx_list
-		rx_count[i] = len;
-		rx_index[i] = 0;
-		if (++head > RX_NUM) head = 0;
-		rx_list[head] = i;
-		rx_head = head;
-		rx_available += len;
-		// TODO: trigger serialEvent
-	} else {
-		// received a zero length packet
-		rx_queue_transfer(i);
-	}
+	return usb_cdc_peekchar(&usb_serial_port);
 }
 
-//static int maxtimes=0;
+int usb_serial_available(void)
+{
+	return usb_cdc_available(&usb_serial_port);
+}
 
-// read a block of bytes to a buffer
 int usb_serial_read(void *buffer, uint32_t size)
 {
-	uint8_t *p = (uint8_t *)buffer;
-	uint32_t count=0;
-
-	NVIC_DISABLE_IRQ(IRQ_USB1);
-	//if (++maxtimes > 15) while (1) ;
-	uint32_t tail = rx_tail;
-	//printf("usb_serial_read, size=%d, tail=%d, head=%d\n", size, tail, rx_head);
-	while (count < size && tail != rx_head) {
-		if (++tail > RX_NUM) tail = 0;
-		uint32_t i = rx_list[tail];
-		uint32_t len = size - count;
-		uint32_t avail = rx_count[i] - rx_index[i];
-		 //printf("usb_serial_read, count=%d, size=%d, i=%d, index=%d, len=%d, avail=%d, c=%c\n",
-		  //count, size, i, rx_index[i], len, avail, rx_buffer[i * CDC_RX_SIZE_480]);
-		if (avail > len) {
-			// partially consume this packet
-			memcpy(p, rx_buffer + i * CDC_RX_SIZE_480 + rx_index[i], len);
-			rx_available -= len;
-			rx_index[i] += len;
-			count += len;
-		} else {
-			// fully consume this packet
-			memcpy(p, rx_buffer + i * CDC_RX_SIZE_480 + rx_index[i], avail);
-			p += avail;
-			rx_available -= avail;
-			count += avail;
-			rx_tail = tail;
-			rx_queue_transfer(i);
-		}
-	}
-	NVIC_ENABLE_IRQ(IRQ_USB1);
-	return count;
+	return usb_cdc_read(&usb_serial_port, buffer, size);
 }
 
-// peek at the next character, or -1 if nothing received
-int usb_serial_peekchar(void)
+void usb_serial_flush_input(void)
 {
-	uint32_t tail = rx_tail;
-	if (tail == rx_head) return -1;
-	if (++tail > RX_NUM) tail = 0;
-	uint32_t i = rx_list[tail];
-	return rx_buffer[i * CDC_RX_SIZE_480 + rx_index[i]];
+	usb_cdc_flush_input(&usb_serial_port);
 }
 
-// number of bytes available in the receive buffer
-int usb_serial_available(void)
+void usb_serial_set_rx_callback(void (*callback)(uint32_t available))
 {
-	uint32_t n = rx_available;
-	if (n == 0) yield();
-	return n;
+	usb_cdc_set_rx_callback(&usb_serial_port, callback);
 }
 
-// discard any buffered input
-void usb_serial_flush_input(void)
+void usb_serial_add_memory_for_read(void *buffer, uint32_t length)
 {
-	uint32_t tail = rx_tail;
-	while (tail != rx_head) {
-		if (++tail > RX_NUM) tail = 0;
-		uint32_t i = rx_list[tail];
-		rx_available -= rx_count[i] - rx_index[i];
-		rx_queue_transfer(i);
-		rx_tail = tail;
-	}
+	usb_cdc_add_memory_for_read(&usb_serial_port, buffer, length);
 }
 
-
-// get the next character, or -1 if nothing received
-int usb_serial_getchar(void)
+int usb_serial_read_direct(void *buffer, uint32_t size, void (*callback)(void *buffer, uint32_t count))
 {
-	uint8_t c;
-	if (usb_serial_read(&c, 1)) return c;
-	return -1;
+	return usb_cdc_read_direct(&usb_serial_port, buffer, size, callback);
 }
 
-
-
-
-
-
-
-
-
-
-
-
-
-/*************************************************************************/
-/**                               Transmit                              **/
-/*************************************************************************/
-
-
-// When the PC isn't listening, how long do we wait before discarding data?  If this is
-// too short, we risk losing data during the stalls that are common with ordinary desktop
-// software.  If it's too long, we stall the user's program when no software is running.
-#define TX_TIMEOUT_MSEC 120
-
-
-// When we've suffered the transmit timeout, don't wait again until the computer
-// begins accepting data.  If no software is running to receive, we'll just discard
-// data as rapidly as Serial.print() can generate it, until there's something to
-// actually receive it.
-static uint8_t transmit_previous_timeout=0;
-
-
-// transmit a character.  0 returned on success, -1 on error
+// transmit a character.  1 returned on success, 0 on error
 int usb_serial_putchar(uint8_t c)
 {
-	return usb_serial_write(&c, 1);
+	return usb_cdc_putchar(&usb_serial_port, c);
 }
 
-extern volatile uint32_t systick_millis_count;
-
-static void timer_config(void (*callback)(void), uint32_t microseconds);
-static void timer_start_oneshot();
-static void timer_stop();
-
-static void timer_config(void (*callback)(void), uint32_t microseconds)
+int usb_serial_write(const void *buffer, uint32_t size)
 {
-	usb_timer0_callback = callback;
-	USB1_GPTIMER0CTRL = 0;
-	USB1_GPTIMER0LD = microseconds - 1;
-	USB1_USBINTR |= USB_USBINTR_TIE0;
+	return usb_cdc_write(&usb_serial_port, buffer, size);
 }
 
-static void timer_start_oneshot(void)
+int usb_serial_write_buffer_free(void)
 {
-	// restarts timer if already running (retriggerable one-shot)
-	USB1_GPTIMER0CTRL = USB_GPTIMERCTRL_GPTRUN | USB_GPTIMERCTRL_GPTRST;
+	return usb_cdc_tx_free(&usb_serial_port);
 }
 
-static void timer_stop(void)
+uint8_t * usb_serial_get_write_buffer(uint32_t *len)
 {
-	USB1_GPTIMER0CTRL = 0;
+	return usb_cdc_get_write_buffer(&usb_serial_port, len);
 }
 
-
-int usb_serial_write(const void *buffer, uint32_t size)
+int usb_serial_commit_write(uint32_t size)
 {
-	uint32_t sent=0;
-	const uint8_t *data = (const uint8_t *)buffer;
-
-	if (!usb_configuration) return 0;
-	while (size > 0) {
-		tx_noautoflush = 1;
-		transfer_t *xfer = tx_transfer + tx_head;
-		int waiting=0;
-		uint32_t wait_begin_at=0;
-		while (!tx_available) {
-			//digitalWriteFast(3, HIGH);
-			uint32_t status = usb_transfer_status(xfer);
-			if (!(status & 0x80)) {
-				if (status & 0x68) {
-					// TODO: what if status has errors???
-					printf("ERROR status = %x, i=%d, ms=%u\n",
-						status, tx_head, systick_millis_count);
-				}
-				tx_available = TX_SIZE;
-				transmit_previous_timeout = 0;
-				break;
-			}
-			asm("dsb" ::: "memory");
-			tx_noautoflush = 0;
-			if (!waiting) {
-				wait_begin_at = systick_millis_count;
-				waiting = 1;
-			}
-			if (transmit_previous_timeout) return sent;
-			if (systick_millis_count - wait_begin_at > TX_TIMEOUT_MSEC) {
-				// waited too long, assume the USB host isn't listening
-				transmit_previous_timeout = 1;
-				return sent;
-				//printf("\nstop, waited too long\n");
-				//printf("status = %x\n", status);
-				//printf("tx head=%d\n", tx_head);
-				//printf("TXFILLTUNING=%08lX\n", USB1_TXFILLTUNING);
-				//usb_print_transfer_log();
-				//while (1) ;
-			}
-			if (!usb_configuration) return sent;
-			yield();
-			tx_noautoflush = 1;
-		}
-		//digitalWriteFast(3, LOW);
-		uint8_t *txdata = txbuffer + (tx_head * TX_SIZE) + (TX_SIZE - tx_available);
-		if (size >= tx_available) {
-			memcpy(txdata, data, tx_available);
-			//*(txbuffer + (tx_head * TX_SIZE)) = 'A' + tx_head; // to see which buffer
-			//*(txbuffer + (tx_head * TX_SIZE) + 1) = ' '; // really see it
-			uint8_t *txbuf = txbuffer + (tx_head * TX_SIZE);
-			usb_prepare_transfer(xfer, txbuf, TX_SIZE, 0);
-			arm_dcache_flush_delete(txbuf, TX_SIZE);
-			usb_transmit(CDC_TX_ENDPOINT, xfer);
-			if (++tx_head >= TX_NUM) tx_head = 0;
-			size -= tx_available;
-			sent += tx_available;
-			data += tx_available;
-			tx_available = 0;
-			timer_stop();
-		} else {
-			memcpy(txdata, data, size);
-			tx_available -= size;
-			sent += size;
-			size = 0;
-			timer_start_oneshot();
-		}
-		asm("dsb" ::: "memory");
-		tx_noautoflush = 0;
-	}
-	return sent;
+	return usb_cdc_commit_write(&usb_serial_port, size);
 }
 
-int usb_serial_write_buffer_free(void)
+void usb_serial_add_memory_for_write(void *buffer, uint32_t length)
 {
-	uint32_t sum = 0;
-	tx_noautoflush = 1;
-	for (uint32_t i=0; i < TX_NUM; i++) {
-		if (i == tx_head) continue;
-		if (!(usb_transfer_status(tx_transfer + i) & 0x80)) sum += TX_SIZE;
-	}
-	asm("dsb" ::: "memory");
-	tx_noautoflush = 0;
-	return sum;
+	usb_cdc_add_memory_for_write(&usb_serial_port, buffer, length);
 }
 
 void usb_serial_flush_output(void)
 {
-
-	if (!usb_configuration) return;
-	if (tx_available == 0) return;
-	tx_noautoflush = 1;
-	transfer_t *xfer = tx_transfer + tx_head;
-	uint8_t *txbuf = txbuffer + (tx_head * TX_SIZE);
-	uint32_t txnum = TX_SIZE - tx_available;
-	usb_prepare_transfer(xfer, txbuf, txnum, 0);
-	arm_dcache_flush_delete(txbuf, txnum);
-	usb_transmit(CDC_TX_ENDPOINT, xfer);
-	if (++tx_head >= TX_NUM) tx_head = 0;
-	tx_available = 0;
-	asm("dsb" ::: "memory");
-	tx_noautoflush = 0;
+	usb_cdc_flush_output(&usb_serial_port);
 }
 
-static void usb_serial_flush_callback(void)
+void usb_serial_set_write_blocking(uint8_t blocking)
 {
-	if (tx_noautoflush) return;
-	if (!usb_configuration) return;
-	if (tx_available == 0) return;
-	//printf("flush callback, %d bytes\n", TX_SIZE - tx_available);
-	transfer_t *xfer = tx_transfer + tx_head;
-	uint8_t *txbuf = txbuffer + (tx_head * TX_SIZE);
-	uint32_t txnum = TX_SIZE - tx_available;
-	usb_prepare_transfer(xfer, txbuf, txnum, 0);
-	arm_dcache_flush_delete(txbuf, txnum);
-	usb_transmit(CDC_TX_ENDPOINT, xfer);
-	if (++tx_head >= TX_NUM) tx_head = 0;
-	tx_available = 0;
+	usb_cdc_set_write_blocking(&usb_serial_port, blocking);
 }
 
+void usb_serial_set_tx_callback(void (*callback)(uint32_t space))
+{
+	usb_cdc_set_tx_callback(&usb_serial_port, callback);
+}
 
+void usb_serial_set_flush_policy(uint8_t policy, uint32_t microseconds, uint32_t max_microseconds)
+{
+	usb_cdc_set_flush_policy(&usb_serial_port, policy, microseconds, max_microseconds);
+}
 
-//#endif // F_CPU
 #endif // CDC_STATUS_INTERFACE && CDC_DATA_INTERFACE
@@ -32,6 +32,9 @@
 
 #include "usb_desc.h"
 #include <stdint.h>
+#if !defined(USB_DISABLED) && defined(CDC_STATUS_INTERFACE) && defined(CDC_DATA_INTERFACE)
+#include "usb_cdc.h"
+#endif
 
 #if (defined(CDC_STATUS_INTERFACE) && defined(CDC_DATA_INTERFACE)) || defined(USB_DISABLED)
 
@@ -48,10 +51,20 @@ int usb_serial_peekchar(void);
 int usb_serial_available(void);
 int usb_serial_read(void *buffer, uint32_t size);
 void usb_serial_flush_input(void);
+void usb_serial_set_rx_callback(void (*callback)(uint32_t available));
+void usb_serial_add_memory_for_read(void *buffer, uint32_t length);
+int usb_serial_read_direct(void *buffer, uint32_t size, void (*callback)(void *buffer, uint32_t count));
+void usb_serial_add_memory_for_write(void *buffer, uint32_t length);
 int usb_serial_putchar(uint8_t c);
+extern usb_cdc_port_t usb_serial_port;
 int usb_serial_write(const void *buffer, uint32_t size);
 int usb_serial_write_buffer_free(void);
+uint8_t * usb_serial_get_write_buffer(uint32_t *len);
+int usb_serial_commit_write(uint32_t size);
 void usb_serial_flush_output(void);
+void usb_serial_set_flush_policy(uint8_t policy, uint32_t microseconds, uint32_t max_microseconds);
+void usb_serial_set_write_blocking(uint8_t blocking);
+void usb_serial_set_tx_callback(void (*callback)(uint32_t space));
 extern uint32_t usb_cdc_line_coding[2];
 extern volatile uint32_t usb_cdc_line_rtsdtr_millis;
 extern volatile uint32_t systick_millis_count;
@@ -65,9 +78,13 @@ extern volatile uint8_t usb_configuration;
 #define USB_SERIAL_DTR  0x01
 #define USB_SERIAL_RTS  0x02
 
+#define USB_SERIAL_FLUSH_FIXED     0
+#define USB_SERIAL_FLUSH_ADAPTIVE  1
+
 // C++ interface
 #ifdef __cplusplus
 #include "Stream.h"
+class EventResponder;
 class usb_serial_class : public Stream
 {
 public:
@@ -93,15 +110,52 @@ public:
         virtual int peek() { return usb_serial_peekchar(); }
         virtual void flush() { usb_serial_flush_output(); }  // TODO: actually wait for data to leave USB...
         virtual void clear(void) { usb_serial_flush_input(); }
-        virtual size_t write(uint8_t c) { return usb_serial_putchar(c); }
+        virtual size_t write(uint8_t c) { return usb_cdc_putchar(&usb_serial_port, c); }
         virtual size_t write(const uint8_t *buffer, size_t size) { return usb_serial_write(buffer, size); }
 	size_t write(unsigned long n) { return write((uint8_t)n); }
 	size_t write(long n) { return write((uint8_t)n); }
 	size_t write(unsigned int n) { return write((uint8_t)n); }
 	size_t write(int n) { return write((uint8_t)n); }
-	virtual int availableForWrite() { return usb_serial_write_buffer_free(); }
+	virtual int availableForWrite() { return usb_cdc_tx_free(&usb_serial_port); }
 	using Print::write;
+	// Zero-copy transmit: format data directly into the USB buffer, then
+	// call commitWrite() with the number of bytes actually written.
+	uint8_t * getWriteBuffer(size_t *len) {
+		uint32_t n;
+		uint8_t *p = usb_serial_get_write_buffer(&n);
+		*len = n;
+		return p;
+	}
+	size_t commitWrite(size_t n) { return usb_serial_commit_write(n); }
+	// Trigger an EventResponder when data arrives from the USB host.  The
+	// event's status is the number of bytes available and its data is
+	// &Serial.  How your function is called (immediate, interrupt or
+	// yield) depends on how it was attached to the EventResponder.
+	void attachRxEvent(EventResponder &event);
+	void detachRxEvent();
+	// Add memory for deeper USB buffering.  Receive memory is used in
+	// 512 byte units, transmit memory in 2048 byte units.
+	void addMemoryForRead(void *buffer, size_t length) { usb_serial_add_memory_for_read(buffer, length); }
+	void addMemoryForWrite(void *buffer, size_t length) { usb_serial_add_memory_for_write(buffer, length); }
+	// Receive directly into a 32 byte aligned buffer (size a multiple of
+	// 512, max 16384).  The callback runs from the USB interrupt when done.
+	bool readDirect(void *buffer, size_t size, void (*callback)(void *buffer, uint32_t count)) {
+		return usb_serial_read_direct(buffer, size, callback);
+	}
         void send_now(void) { usb_serial_flush_output(); }
+	// With blocking off, write() returns immediately with the number of
+	// bytes accepted, rather than waiting up to 120 ms when the host is
+	// not reading.  attachWriteEvent() triggers an EventResponder when
+	// space becomes available after a write could not be completed.  Its
+	// status is the number of bytes which may be written.
+	void setWriteBlocking(bool blocking) { usb_serial_set_write_blocking(blocking); }
+	void attachWriteEvent(EventResponder &event);
+	void detachWriteEvent();
+	// Control how long partially filled buffers wait before automatic
+	// transmit: USB_SERIAL_FLUSH_FIXED or USB_SERIAL_FLUSH_ADAPTIVE.
+	void setFlushPolicy(uint8_t policy, uint32_t microseconds=0, uint32_t max_microseconds=0) {
+		usb_serial_set_flush_policy(policy, microseconds, max_microseconds);
+	}
         uint32_t baud(void) { return usb_cdc_line_coding[0]; }
         uint8_t stopbits(void) { uint8_t b = usb_cdc_line_coding[1]; if (!b) b = 1; return b; }
         uint8_t paritytype(void) { return usb_cdc_line_coding[1] >> 8; } // 0=none, 1=odd, 2=even
@@ -113,15 +167,8 @@ public:
 		return usb_configuration && (usb_cdc_line_rtsdtr & USB_SERIAL_DTR) &&
 		((uint32_t)(systick_millis_count - usb_cdc_line_rtsdtr_millis) >= 15);
 	}
-	size_t readBytes(char *buffer, size_t length) {
-		size_t count=0;
-		unsigned long startMillis = millis();
-		do {
-			count += usb_serial_read(buffer + count, length - count);
-			if (count >= length) return count;
-		} while(millis() - startMillis < _timeout);
-		setReadError();
-		return count;
+	virtual size_t readBulk(uint8_t *buffer, size_t length) {
+		return usb_serial_read(buffer, length);
 	}
 
 };
@@ -134,6 +181,7 @@ extern void serialEvent(void);
 // Allow Arduino programs using Serial to compile, but Serial will do nothing.
 #ifdef __cplusplus
 #include "Stream.h"
+class EventResponder;
 class usb_serial_class : public Stream
 {
 public:
@@ -153,6 +201,17 @@ public:
     size_t write(int n) { return 1; }
     int availableForWrite() { return 0; }
     using Print::write;
+    uint8_t * getWriteBuffer(size_t *len) { *len = 0; return nullptr; }
+    size_t commitWrite(size_t n) { return 0; }
+    void attachRxEvent(EventResponder &event) { }
+    void detachRxEvent() { }
+    void addMemoryForRead(void *buffer, size_t length) { }
+    void addMemoryForWrite(void *buffer, size_t length) { }
+    bool readDirect(void *buffer, size_t size, void (*callback)(void *buffer, uint32_t count)) { return false; }
+    void setFlushPolicy(uint8_t policy, uint32_t microseconds=0, uint32_t max_microseconds=0) { }
+    void setWriteBlocking(bool blocking) { }
+    void attachWriteEvent(EventResponder &event) { }
+    void detachWriteEvent() { }
         void send_now(void) { }
         uint32_t baud(void) { return 0; }
         uint8_t stopbits(void) { return 1; }
@@ -187,9 +246,19 @@ int usb_serial2_available(void);
 int usb_serial2_read(void *buffer, uint32_t size);
 void usb_serial2_flush_input(void);
 int usb_serial2_putchar(uint8_t c);
+extern usb_cdc_port_t usb_serial2_port;
 int usb_serial2_write(const void *buffer, uint32_t size);
 int usb_serial2_write_buffer_free(void);
 void usb_serial2_flush_output(void);
+void usb_serial2_set_rx_callback(void (*callback)(uint32_t available));
+void usb_serial2_add_memory_for_read(void *buffer, uint32_t length);
+int usb_serial2_read_direct(void *buffer, uint32_t size, void (*callback)(void *buffer, uint32_t count));
+void usb_serial2_add_memory_for_write(void *buffer, uint32_t length);
+uint8_t * usb_serial2_get_write_buffer(uint32_t *len);
+int usb_serial2_commit_write(uint32_t size);
+void usb_serial2_set_flush_policy(uint8_t policy, uint32_t microseconds, uint32_t max_microseconds);
+void usb_serial2_set_write_blocking(uint8_t blocking);
+void usb_serial2_set_tx_callback(void (*callback)(uint32_t space));
 extern uint32_t usb_cdc2_line_coding[2];
 extern volatile uint32_t usb_cdc2_line_rtsdtr_millis;
 extern volatile uint8_t usb_cdc2_line_rtsdtr;
@@ -224,14 +293,31 @@ public:
         virtual int peek() { return usb_serial2_peekchar(); }
         virtual void flush() { usb_serial2_flush_output(); }  // TODO: actually wait for data to leave USB...
         virtual void clear(void) { usb_serial2_flush_input(); }
-        virtual size_t write(uint8_t c) { return usb_serial2_putchar(c); }
+        virtual size_t write(uint8_t c) { return usb_cdc_putchar(&usb_serial2_port, c); }
         virtual size_t write(const uint8_t *buffer, size_t size) { return usb_serial2_write(buffer, size); }
         size_t write(unsigned long n) { return write((uint8_t)n); }
         size_t write(long n) { return write((uint8_t)n); }
         size_t write(unsigned int n) { return write((uint8_t)n); }
         size_t write(int n) { return write((uint8_t)n); }
-        virtual int availableForWrite() { return usb_serial2_write_buffer_free(); }
+        virtual int availableForWrite() { return usb_cdc_tx_free(&usb_serial2_port); }
         using Print::write;
+        // same as Serial, see usb_serial_class
+        uint8_t * getWriteBuffer(size_t *len) {
+                uint32_t n;
+                uint8_t *p = usb_serial2_get_write_buffer(&n);
+                *len = n;
+                return p;
+        }
+        size_t commitWrite(size_t n) { return usb_serial2_commit_write(n); }
+        void addMemoryForRead(void *buffer, size_t length) { usb_serial2_add_memory_for_read(buffer, length); }
+        void addMemoryForWrite(void *buffer, size_t length) { usb_serial2_add_memory_for_write(buffer, length); }
+        bool readDirect(void *buffer, size_t size, void (*callback)(void *buffer, uint32_t count)) {
+                return usb_serial2_read_direct(buffer, size, callback);
+        }
+        void setFlushPolicy(uint8_t policy, uint32_t microseconds=0, uint32_t max_microseconds=0) {
+                usb_serial2_set_flush_policy(policy, microseconds, max_microseconds);
+        }
+        void setWriteBlocking(bool blocking) { usb_serial2_set_write_blocking(blocking); }
         void send_now(void) { usb_serial2_flush_output(); }
         uint32_t baud(void) { return usb_cdc2_line_coding[0]; }
         uint8_t stopbits(void) { uint8_t b = usb_cdc2_line_coding[1]; if (!b) b = 1; return b; }
@@ -242,15 +328,8 @@ public:
         operator bool() { return usb_configuration && (usb_cdc2_line_rtsdtr & USB_SERIAL_DTR) &&
                 ((uint32_t)(systick_millis_count - usb_cdc2_line_rtsdtr_millis) >= 15);
         }
-        size_t readBytes(char *buffer, size_t length) {
-                size_t count=0;
-                unsigned long startMillis = millis();
-                do {
-                        count += usb_serial2_read(buffer + count, length - count);
-                        if (count >= length) return count;
-                } while(millis() - startMillis < _timeout);
-                setReadError();
-                return count;
+        virtual size_t readBulk(uint8_t *buffer, size_t length) {
+                return usb_serial2_read(buffer, length);
         }
 
 };
@@ -275,9 +354,19 @@ int usb_serial3_available(void);
 int usb_serial3_read(void *buffer, uint32_t size);
 void usb_serial3_flush_input(void);
 int usb_serial3_putchar(uint8_t c);
+extern usb_cdc_port_t usb_serial3_port;
 int usb_serial3_write(const void *buffer, uint32_t size);
 int usb_serial3_write_buffer_free(void);
 void usb_serial3_flush_output(void);
+void usb_serial3_set_rx_callback(void (*callback)(uint32_t available));
+void usb_serial3_add_memory_for_read(void *buffer, uint32_t length);
+int usb_serial3_read_direct(void *buffer, uint32_t size, void (*callback)(void *buffer, uint32_t count));
+void usb_serial3_add_memory_for_write(void *buffer, uint32_t length);
+uint8_t * usb_serial3_get_write_buffer(uint32_t *len);
+int usb_serial3_commit_write(uint32_t size);
+void usb_serial3_set_flush_policy(uint8_t policy, uint32_t microseconds, uint32_t max_microseconds);
+void usb_serial3_set_write_blocking(uint8_t blocking);
+void usb_serial3_set_tx_callback(void (*callback)(uint32_t space));
 extern uint32_t usb_cdc3_line_coding[2];
 extern volatile uint32_t usb_cdc3_line_rtsdtr_millis;
 extern volatile uint8_t usb_cdc3_line_rtsdtr;
@@ -312,14 +401,31 @@ public:
         virtual int peek() { return usb_serial3_peekchar(); }
         virtual void flush() { usb_serial3_flush_output(); }  // TODO: actually wait for data to leave USB...
         virtual void clear(void) { usb_serial3_flush_input(); }
-        virtual size_t write(uint8_t c) { return usb_serial3_putchar(c); }
+        virtual size_t write(uint8_t c) { return usb_cdc_putchar(&usb_serial3_port, c); }
         virtual size_t write(const uint8_t *buffer, size_t size) { return usb_serial3_write(buffer, size); }
         size_t write(unsigned long n) { return write((uint8_t)n); }
         size_t write(long n) { return write((uint8_t)n); }
         size_t write(unsigned int n) { return write((uint8_t)n); }
         size_t write(int n) { return write((uint8_t)n); }
-        virtual int availableForWrite() { return usb_serial3_write_buffer_free(); }
+        virtual int availableForWrite() { return usb_cdc_tx_free(&usb_serial3_port); }
         using Print::write;
+        // same as Serial, see usb_serial_class
+        uint8_t * getWriteBuffer(size_t *len) {
+                uint32_t n;
+                uint8_t *p = usb_serial3_get_write_buffer(&n);
+                *len = n;
+                return p;
+        }
+        size_t commitWrite(size_t n) { return usb_serial3_commit_write(n); }
+        void addMemoryForRead(void *buffer, size_t length) { usb_serial3_add_memory_for_read(buffer, length); }
+        void addMemoryForWrite(void *buffer, size_t length) { usb_serial3_add_memory_for_write(buffer, length); }
+        bool readDirect(void *buffer, size_t size, void (*callback)(void *buffer, uint32_t count)) {
+                return usb_serial3_read_direct(buffer, size, callback);
+        }
+        void setFlushPolicy(uint8_t policy, uint32_t microseconds=0, uint32_t max_microseconds=0) {
+                usb_serial3_set_flush_policy(policy, microseconds, max_microseconds);
+        }
+        void setWriteBlocking(bool blocking) { usb_serial3_set_write_blocking(blocking); }
         void send_now(void) { usb_serial3_flush_output(); }
         uint32_t baud(void) { return usb_cdc3_line_coding[0]; }
         uint8_t stopbits(void) { uint8_t b = usb_cdc3_line_coding[1]; if (!b) b = 1; return b; }
@@ -330,15 +436,8 @@ public:
         operator bool() { return usb_configuration && (usb_cdc3_line_rtsdtr & USB_SERIAL_DTR) &&
                 ((uint32_t)(systick_millis_count - usb_cdc3_line_rtsdtr_millis) >= 15);
         }
-        size_t readBytes(char *buffer, size_t length) {
-                size_t count=0;
-                unsigned long startMillis = millis();
-                do {
-                        count += usb_serial3_read(buffer + count, length - count);
-                        if (count >= length) return count;
-                } while(millis() - startMillis < _timeout);
-                setReadError();
-                return count;
+        virtual size_t readBulk(uint8_t *buffer, size_t length) {
+                return usb_serial3_read(buffer, length);
         }
 
 };
@@ -41,18 +41,25 @@
 
 static uint8_t  prev_id=0;
 static uint8_t  scan_index=0;
-static uint8_t  scan_count=0;
 static uint8_t  contactid[MULTITOUCH_FINGERS];
 static uint8_t  pressure[MULTITOUCH_FINGERS];
 static uint16_t xpos[MULTITOUCH_FINGERS];
 static uint16_t ypos[MULTITOUCH_FINGERS];
 static uint16_t scan_timestamp;
+static uint8_t  scan_contact_count;
+static volatile uint8_t touch_changed=0;
+static volatile uint8_t frame_nesting=0;
+static uint8_t  refresh_count=0;
 
-#define TX_BUFSIZE 32
+// Unchanged touches are sent again after this many ms, so the host never
+// considers a contact lost.
+#define REFRESH_MSEC 10
+
+#define TX_BUFSIZE 64
 static transfer_t tx_transfer __attribute__ ((used, aligned(32)));
 DMAMEM static uint8_t txbuffer[TX_BUFSIZE] __attribute__ ((aligned(32)));
 extern volatile uint8_t usb_high_speed;
-#if MULTITOUCH_SIZE > TX_BUFSIZE
+#if MULTITOUCH_REPORT_SIZE > TX_BUFSIZE
 #error "Internal error, transmit buffer size is too small for touchscreen endpoint"
 #endif
 
@@ -60,7 +67,7 @@ extern volatile uint8_t usb_high_speed;
 void usb_touchscreen_configure(void)
 {
 	memset(&tx_transfer, 0, sizeof(tx_transfer));
-	usb_config_tx(MULTITOUCH_ENDPOINT, MULTITOUCH_SIZE, 0, NULL);
+	usb_config_tx(MULTITOUCH_ENDPOINT, MULTITOUCH_REPORT_SIZE, 0, NULL);
 	usb_start_sof_interrupts(MULTITOUCH_INTERFACE);
 }
 
@@ -80,9 +87,12 @@ void usb_touchscreen_press(uint8_t finger, uint32_t x, uint32_t y, uint32_t pres
 		prev_id = id;
 		contactid[finger] = (id << 1) | 1;
 	}
-	xpos[finger] = x;
-	ypos[finger] = y;
-	pressure[finger] = press;
+	if (xpos[finger] != x || ypos[finger] != y || pressure[finger] != press) {
+		xpos[finger] = x;
+		ypos[finger] = y;
+		pressure[finger] = press;
+		touch_changed = 1;
+	}
 	__enable_irq();
 }
 
@@ -93,32 +103,55 @@ void usb_touchscreen_press(uint8_t finger, uint32_t x, uint32_t y, uint32_t pres
 void usb_touchscreen_release(uint8_t finger)
 {
 	if (finger >= MULTITOUCH_FINGERS) return;
-	pressure[finger] = 0;
+	if (pressure[finger]) {
+		pressure[finger] = 0;
+		touch_changed = 1;
+	}
+}
+
+// Touches pressed and released between begin and end of a frame are
+// reported together in the same scan, never partially updated.  Frames
+// may be nested.
+void usb_touchscreen_begin_frame(void)
+{
+	__disable_irq();
+	frame_nesting++;
+	__enable_irq();
+}
+
+void usb_touchscreen_end_frame(void)
+{
+	__disable_irq();
+	if (frame_nesting) frame_nesting--;
+	__enable_irq();
 }
 
-// touch report
+// touch report, each contact
 //  0: contact id + on/off
 //  1: pressure
 //  2: X lsb
 //  3: X msb
 //  4: Y lsb
 //  5: Y msb
-//  6: scan time lsb
-//  7: scan time msb
-//  8: contact count
-
-// Called by the start-of-frame interrupt.
+// after MULTITOUCH_CONTACTS_PER_REPORT contacts
+//  0: scan time lsb
+//  1: scan time msb
+//  2: contact count
+
+// Called by the start-of-frame interrupt.  A scan sends every contact,
+// MULTITOUCH_CONTACTS_PER_REPORT per report, 1 report per ms.  A new
+// scan begins only when touches changed, or every REFRESH_MSEC.
 //
 void usb_touchscreen_update_callback(void)
 {
 	static uint8_t microframe_count=0;
-	uint8_t contact_count = 0;
 
 	if (usb_high_speed) {
 		// if 480 speed, run only every 8th micro-frame
 		if (++microframe_count < 8) return;
 		microframe_count = 0;
 	}
+	if (refresh_count < 255) refresh_count++;
 
 	// do nothing if previous packet not yet sent
 	uint32_t status = usb_transfer_status(&tx_transfer);
@@ -129,17 +162,25 @@ void usb_touchscreen_update_callback(void)
 		// TODO: what if status has errors???
 	}
 
+	if (frame_nesting) return;
 	if (scan_index == 0) {
-		scan_timestamp = millis() * 10;
-		scan_count = 0;
 		// Get the contact count (usage 0x54)
-		// Only set this value on first contact
-		// Subsequent concurrent contacts should report 0
+		// Only set this value in the first report of a scan
+		// Subsequent reports in the same scan should report 0
+		uint8_t contact_count = 0;
 		for (uint8_t i = 0; i < MULTITOUCH_FINGERS; i++) {
 			if (contactid[i]) contact_count++;
 		}
+		if (contact_count == 0) return;
+		if (!touch_changed && refresh_count < REFRESH_MSEC) return;
+		touch_changed = 0;
+		refresh_count = 0;
+		scan_timestamp = millis() * 10;
+		scan_contact_count = contact_count;
 	}
-	while (scan_index < MULTITOUCH_FINGERS) {
+	uint8_t *p = txbuffer;
+	uint32_t n = 0;
+	while (scan_index < MULTITOUCH_FINGERS && n < MULTITOUCH_CONTACTS_PER_REPORT) {
 		uint32_t press = pressure[scan_index];
 		uint32_t id = contactid[scan_index];
 		if (id) {
@@ -150,29 +191,37 @@ void usb_touchscreen_update_callback(void)
 				id &= 0xFE;
 				contactid[scan_index] = 0;
 			}
-			//uint8_t buffer[MULTITOUCH_SIZE]; // MULTITOUCH_SIZE = 8
-			txbuffer[0] = id;
-			txbuffer[1] = press;
-			txbuffer[2] = xpos[scan_index];
-			txbuffer[3] = xpos[scan_index] >> 8;
-			txbuffer[4] = ypos[scan_index];
-			txbuffer[5] = ypos[scan_index] >> 8;
-			txbuffer[6] = scan_timestamp;
-			txbuffer[7] = scan_timestamp >> 8;
-			txbuffer[8] = contact_count;
-			//delayNanoseconds(30);
-			usb_prepare_transfer(&tx_transfer, txbuffer, MULTITOUCH_SIZE, 0);
-			arm_dcache_flush_delete(txbuffer, TX_BUFSIZE);
-			usb_transmit(MULTITOUCH_ENDPOINT, &tx_transfer);
-			scan_index++;
-			return;
+			*p++ = id;
+			*p++ = press;
+			*p++ = xpos[scan_index];
+			*p++ = xpos[scan_index] >> 8;
+			*p++ = ypos[scan_index];
+			*p++ = ypos[scan_index] >> 8;
+			n++;
 		}
 		scan_index++;
 	}
-	if (++scan_count >= MULTITOUCH_FINGERS) {
-		// when done early, wait to restart another scan
+	if (n == 0) {
+		// touches ended since this scan began
 		scan_index = 0;
+		return;
+	}
+	if (n < MULTITOUCH_CONTACTS_PER_REPORT) {
+		// unused contacts in the last report
+		memset(p, 0, (MULTITOUCH_CONTACTS_PER_REPORT - n) * 6);
+		p += (MULTITOUCH_CONTACTS_PER_REPORT - n) * 6;
 	}
+	*p++ = scan_timestamp;
+	*p++ = scan_timestamp >> 8;
+	*p++ = scan_contact_count;
+	scan_contact_count = 0;
+	//delayNanoseconds(30);
+	usb_prepare_transfer(&tx_transfer, txbuffer, MULTITOUCH_REPORT_SIZE, 0);
+	dma_buffer_to_device(txbuffer, TX_BUFSIZE);
+	usb_transmit(MULTITOUCH_ENDPOINT, &tx_transfer);
+	// the scan is complete when no more contacts remain
+	while (scan_index < MULTITOUCH_FINGERS && !contactid[scan_index]) scan_index++;
+	if (scan_index >= MULTITOUCH_FINGERS) scan_index = 0;
 }
 
 
@@ -44,6 +44,8 @@ extern "C" {
 void usb_touchscreen_configure(void);
 void usb_touchscreen_press(uint8_t finger, uint32_t x, uint32_t y, uint32_t pressure);
 void usb_touchscreen_release(uint8_t finger);
+void usb_touchscreen_begin_frame(void);
+void usb_touchscreen_end_frame(void);
 void usb_touchscreen_update_callback(void);
 extern volatile uint8_t usb_configuration;
 #ifdef __cplusplus
@@ -63,6 +65,13 @@ class usb_touchscreen_class
 	void release(uint8_t finger) {
 		usb_touchscreen_release(finger);
 	}
+	// set all touches between begin and end, to send them together
+	void beginFrame(void) {
+		usb_touchscreen_begin_frame();
+	}
+	void endFrame(void) {
+		usb_touchscreen_end_frame();
+	}
 };
 extern usb_touchscreen_class TouchscreenUSB;
 
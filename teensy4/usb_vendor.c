@@ -0,0 +1,318 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "usb_dev.h"
+#include "usb_vendor.h"
+#include "core_pins.h" // for yield()
+#include "avr/pgmspace.h" // for PROGMEM, DMAMEM, FASTRUN
+#include <string.h> // for memcpy()
+
+#include "debug/printf.h"
+#ifdef VENDOR_INTERFACE // defined by usb_dev.h -> usb_desc.h
+
+// Vendor specific bulk interface, for moving data to and from a program on
+// the host without the overhead of a CDC or HID class.  Transmit buffers are
+// large, so each one is a single transfer of many packets, and the host can
+// read at nearly the full 480 Mbit/sec bulk rate.  No zero length packets
+// are sent, so the data is a plain stream and the host should read in
+// multiples of the packet size.
+
+extern volatile uint8_t usb_high_speed;
+extern volatile uint8_t usb_configuration;
+
+#define TX_NUM   4
+#define TX_SIZE  8192	/* at most 16384, one transfer per buffer */
+static transfer_t tx_transfer[TX_NUM] __attribute__ ((used, aligned(32)));
+DMAMEM static uint8_t txbuffer[TX_SIZE * TX_NUM] __attribute__ ((aligned(32)));
+static uint8_t tx_head=0;
+static uint16_t tx_available=0;	// free space in tx_head buffer, 0 = not yet checked
+static uint8_t transmit_previous_timeout=0;
+#define TX_TIMEOUT_MSEC 120
+
+#define RX_NUM   8
+#define RX_SIZE  4096	/* multiple of 512 */
+static transfer_t rx_transfer[RX_NUM] __attribute__ ((used, aligned(32)));
+DMAMEM static uint8_t rx_buffer[RX_SIZE * RX_NUM] __attribute__ ((aligned(32)));
+static uint16_t rx_count[RX_NUM];
+static uint16_t rx_index[RX_NUM];
+static uint8_t rx_list[RX_NUM + 1];
+static volatile uint8_t rx_head;
+static volatile uint8_t rx_tail;
+static volatile uint32_t rx_available;
+static void (*rx_callback)(uint32_t len) = NULL;
+static void rx_queue_transfer(int i);
+static void rx_event(transfer_t *t);
+
+// Direct transfers send straight from the caller's buffer, as a chain of
+// up to 4 transfers of 16K each.  Two may be queued, so one can be refilled
+// while the other moves.
+#define TX_DIRECT_NUM    2
+#define TX_DIRECT_CHAIN  4      /* 4 x 16K = up to 64K per write */
+#define DIRECT_PARAM     0x100  /* callback_param for direct transfers */
+static transfer_t tx_direct_transfer[TX_DIRECT_NUM][TX_DIRECT_CHAIN] __attribute__ ((used, aligned(32)));
+static const void *tx_direct_buffer[TX_DIRECT_NUM];
+static uint32_t tx_direct_len[TX_DIRECT_NUM];
+static void (*tx_direct_callback[TX_DIRECT_NUM])(const void *buffer, uint32_t len);
+static void tx_event(transfer_t *t);
+
+void usb_vendor_configure(void)
+{
+	uint32_t tx_packet_size, rx_packet_size;
+
+	if (usb_high_speed) {
+		tx_packet_size = VENDOR_TX_SIZE_480;
+		rx_packet_size = VENDOR_RX_SIZE_480;
+	} else {
+		tx_packet_size = VENDOR_TX_SIZE_12;
+		rx_packet_size = VENDOR_RX_SIZE_12;
+	}
+	printf("usb_vendor_configure: TX:%u RX:%u\n", tx_packet_size, rx_packet_size);
+	memset(tx_transfer, 0, sizeof(tx_transfer));
+	memset(rx_transfer, 0, sizeof(rx_transfer));
+	memset(tx_direct_transfer, 0, sizeof(tx_direct_transfer));
+	memset(tx_direct_buffer, 0, sizeof(tx_direct_buffer));
+	tx_head = 0;
+	tx_available = 0;
+	rx_head = 0;
+	rx_tail = 0;
+	rx_available = 0;
+	usb_config_tx(VENDOR_TX_ENDPOINT, tx_packet_size, 0, tx_event);
+	usb_config_rx(VENDOR_RX_ENDPOINT, rx_packet_size, 0, rx_event);
+	int i;
+	for (i=0; i < RX_NUM; i++) rx_queue_transfer(i);
+}
+
+
+/*************************************************************************/
+/**                               Receive                               **/
+/*************************************************************************/
+
+// called from the USB interrupt, or with it disabled
+static void rx_queue_transfer(int i)
+{
+	void *buffer = rx_buffer + i * RX_SIZE;
+	usb_prepare_transfer(rx_transfer + i, buffer, RX_SIZE, i);
+	dma_buffer_from_device(buffer, RX_SIZE);
+	usb_receive(VENDOR_RX_ENDPOINT, rx_transfer + i);
+}
+
+// called by USB interrupt when a receive transfer completes, either full or
+// ended early by a short packet from the host
+static void rx_event(transfer_t *t)
+{
+	int i = t->callback_param;
+	uint32_t len = RX_SIZE - ((t->status >> 16) & 0x7FFF);
+	if (len == 0) {
+		// received a zero length packet
+		rx_queue_transfer(i);
+		return;
+	}
+	rx_count[i] = len;
+	rx_index[i] = 0;
+	uint32_t head = rx_head;
+	if (++head > RX_NUM) head = 0;
+	rx_list[head] = i;
+	rx_head = head;
+	rx_available += len;
+	if (rx_callback) (*rx_callback)(len);
+}
+
+// set a function to be called (from the USB interrupt) each time data is
+// received.  NULL disables the notification.
+void usb_vendor_set_rx_callback(void (*callback)(uint32_t len))
+{
+	NVIC_DISABLE_IRQ(IRQ_USB1);
+	rx_callback = callback;
+	NVIC_ENABLE_IRQ(IRQ_USB1);
+}
+
+// number of bytes received and not yet read
+int usb_vendor_available(void)
+{
+	if (!usb_configuration) return 0;
+	return rx_available;
+}
+
+// read up to size bytes, without waiting
+int usb_vendor_read(void *buffer, uint32_t size)
+{
+	uint8_t *dest = (uint8_t *)buffer;
+	uint32_t count=0;
+
+	NVIC_DISABLE_IRQ(IRQ_USB1);
+	uint32_t tail = rx_tail;
+	while (count < size && tail != rx_head) {
+		if (++tail > RX_NUM) tail = 0;
+		uint32_t i = rx_list[tail];
+		uint32_t len = size - count;
+		uint32_t avail = rx_count[i] - rx_index[i];
+		uint8_t *src = rx_buffer + i * RX_SIZE + rx_index[i];
+		if (avail > len) {
+			// partially consume this buffer
+			memcpy(dest, src, len);
+			rx_available -= len;
+			rx_index[i] += len;
+			count += len;
+		} else {
+			// fully consume this buffer
+			memcpy(dest, src, avail);
+			dest += avail;
+			rx_available -= avail;
+			count += avail;
+			rx_tail = tail;
+			rx_queue_transfer(i);
+		}
+	}
+	NVIC_ENABLE_IRQ(IRQ_USB1);
+	return count;
+}
+
+
+/*************************************************************************/
+/**                               Transmit                              **/
+/*************************************************************************/
+
+// called by USB interrupt when any transmit completes
+static void tx_event(transfer_t *t)
+{
+	if (t->callback_param < DIRECT_PARAM) return;
+	uint32_t n = t->callback_param - DIRECT_PARAM;
+	const void *buffer = tx_direct_buffer[n];
+	uint32_t len = tx_direct_len[n];
+	void (*callback)(const void *buffer, uint32_t len) = tx_direct_callback[n];
+	tx_direct_buffer[n] = NULL;
+	if (callback) (*callback)(buffer, len);
+}
+
+// transmit "len" bytes of the current tx buffer, and move to the next
+static void tx_send_buffer(uint32_t len)
+{
+	transfer_t *xfer = tx_transfer + tx_head;
+	uint8_t *txbuf = txbuffer + tx_head * TX_SIZE;
+	usb_prepare_transfer(xfer, txbuf, len, 0);
+	dma_buffer_to_device(txbuf, len);
+	NVIC_DISABLE_IRQ(IRQ_USB1);
+	usb_transmit(VENDOR_TX_ENDPOINT, xfer);
+	NVIC_ENABLE_IRQ(IRQ_USB1);
+	if (++tx_head >= TX_NUM) tx_head = 0;
+	tx_available = 0;
+}
+
+int usb_vendor_write(const void *buffer, uint32_t size)
+{
+	const uint8_t *data = (const uint8_t *)buffer;
+	uint32_t sent=0;
+
+	if (!usb_configuration) return 0;
+	while (size > 0) {
+		if (!tx_available) {
+			transfer_t *xfer = tx_transfer + tx_head;
+			uint32_t wait_begin_at = systick_millis_count;
+			while (usb_transfer_status(xfer) & 0x80) {
+				// when we've suffered the transmit timeout, don't wait
+				// again until the host begins reading
+				if (transmit_previous_timeout) return sent;
+				if (systick_millis_count - wait_begin_at > TX_TIMEOUT_MSEC) {
+					transmit_previous_timeout = 1;
+					return sent;
+				}
+				if (!usb_configuration) return sent;
+				yield();
+			}
+			transmit_previous_timeout = 0;
+			tx_available = TX_SIZE;
+		}
+		uint32_t len = (size < tx_available) ? size : tx_available;
+		memcpy(txbuffer + tx_head * TX_SIZE + (TX_SIZE - tx_available), data, len);
+		tx_available -= len;
+		data += len;
+		size -= len;
+		sent += len;
+		if (tx_available == 0) tx_send_buffer(TX_SIZE);
+	}
+	return sent;
+}
+
+// bytes which could be written without waiting
+int usb_vendor_write_buffer_free(void)
+{
+	uint32_t sum = tx_available;
+	for (uint32_t i=0; i < TX_NUM; i++) {
+		if (i == tx_head && tx_available) continue;
+		if (!(usb_transfer_status(tx_transfer + i) & 0x80)) sum += TX_SIZE;
+	}
+	return sum;
+}
+
+// send any partially filled buffer
+void usb_vendor_flush_output(void)
+{
+	if (!usb_configuration) return;
+	if (tx_available == 0 || tx_available == TX_SIZE) return;
+	tx_send_buffer(TX_SIZE - tx_available);
+}
+
+// Send up to 64K straight from the caller's buffer as one chain of
+// transfers, so the controller moves it at full bus speed with no copies.
+// Any data from usb_vendor_write() is flushed first, so the order is kept.
+// The buffer must not change until the callback, which runs from the USB
+// interrupt.  Returns 0 if both direct transfers are still busy.
+int usb_vendor_write_direct(const void *buffer, uint32_t len, void (*callback)(const void *buffer, uint32_t len))
+{
+	if (!usb_configuration || !buffer || len == 0) return 0;
+	if (len > TX_DIRECT_CHAIN * 16384) return 0;
+	usb_vendor_flush_output();
+	dma_buffer_to_device(buffer, len);
+	NVIC_DISABLE_IRQ(IRQ_USB1);
+	uint32_t n;
+	for (n=0; n < TX_DIRECT_NUM; n++) {
+		if (tx_direct_buffer[n] == NULL) break;
+	}
+	if (n >= TX_DIRECT_NUM) {
+		NVIC_ENABLE_IRQ(IRQ_USB1);
+		return 0;
+	}
+	tx_direct_buffer[n] = buffer;
+	tx_direct_len[n] = len;
+	tx_direct_callback[n] = callback;
+	uint32_t num = usb_prepare_transfer_chain(tx_direct_transfer[n], TX_DIRECT_CHAIN,
+		buffer, len, DIRECT_PARAM + n);
+	usb_transmit_chain(VENDOR_TX_ENDPOINT, tx_direct_transfer[n], num);
+	NVIC_ENABLE_IRQ(IRQ_USB1);
+	return len;
+}
+
+// true while either direct write is still moving data
+int usb_vendor_write_direct_busy(void)
+{
+	return tx_direct_buffer[0] != NULL || tx_direct_buffer[1] != NULL;
+}
+
+#endif // VENDOR_INTERFACE
@@ -0,0 +1,90 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include "usb_desc.h"
+
+#if defined(VENDOR_INTERFACE)
+
+#include <inttypes.h>
+
+// C language implementation
+#ifdef __cplusplus
+extern "C" {
+#endif
+void usb_vendor_configure(void);
+int usb_vendor_available(void);
+int usb_vendor_read(void *buffer, uint32_t size);
+int usb_vendor_write(const void *buffer, uint32_t size);
+int usb_vendor_write_buffer_free(void);
+void usb_vendor_flush_output(void);
+int usb_vendor_write_direct(const void *buffer, uint32_t len, void (*callback)(const void *buffer, uint32_t len));
+int usb_vendor_write_direct_busy(void);
+void usb_vendor_set_rx_callback(void (*callback)(uint32_t len));
+#ifdef __cplusplus
+}
+#endif
+
+
+// C++ interface
+#ifdef __cplusplus
+class EventResponder;
+class usb_vendor_class
+{
+public:
+	// bytes received from the host and not yet read
+	int available(void) { return usb_vendor_available(); }
+	int read(void *buffer, uint32_t size) { return usb_vendor_read(buffer, size); }
+	// Data is copied into 8K transmit buffers, each sent when full.  Call
+	// flush() to send a partially filled buffer.  write() waits for a free
+	// buffer, up to 120 ms if the host is not reading.
+	int write(const void *buffer, uint32_t size) { return usb_vendor_write(buffer, size); }
+	int availableForWrite(void) { return usb_vendor_write_buffer_free(); }
+	void flush(void) { usb_vendor_flush_output(); }
+	// Send up to 64K straight from the caller's buffer, as one chain of
+	// transfers.  The buffer must not change until the callback, which runs
+	// from the USB interrupt.  Up to 2 may be queued, in order after any
+	// data given to write().
+	int writeDirect(const void *buffer, uint32_t len, void (*callback)(const void *buffer, uint32_t len)=nullptr) {
+		return usb_vendor_write_direct(buffer, len, callback); }
+	bool writeDirectBusy(void) { return usb_vendor_write_direct_busy(); }
+	// Trigger an EventResponder when data arrives from the host.  The
+	// event's status is the number of bytes received and its data is this
+	// usb_vendor_class.
+	void attachRxEvent(EventResponder &event);
+	void detachRxEvent() { usb_vendor_set_rx_callback(nullptr); }
+};
+
+extern usb_vendor_class VendorUSB;
+
+#endif // __cplusplus
+
+#endif // VENDOR_INTERFACE
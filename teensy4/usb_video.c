@@ -0,0 +1,243 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "usb_dev.h"
+#include "usb_video.h"
+#include "avr/pgmspace.h" // for PROGMEM, DMAMEM, FASTRUN
+#include <string.h> // for memcpy()
+
+#include "debug/printf.h"
+#ifdef VIDEO_INTERFACE // defined by usb_dev.h -> usb_desc.h
+
+// USB Video Class camera.  The host requests an isochronous payload every
+// microframe.  Each payload is a 2 byte UVC header and the next part of the
+// frame, copied from the caller's buffer as the payload is prepared.  Eight
+// payloads are kept queued, so the USB interrupt may be delayed by up to
+// 1 ms without a gap in the stream.
+
+extern volatile uint8_t usb_high_speed;
+extern volatile uint8_t usb_configuration;
+
+#define TX_NUM   8
+#define TX_SIZE  (VIDEO_PACKET_SIZE_480 * VIDEO_PACKET_MULT)
+static transfer_t tx_transfer[TX_NUM] __attribute__ ((used, aligned(32)));
+DMAMEM static uint8_t txbuffer[TX_NUM][TX_SIZE] __attribute__ ((aligned(32)));
+static uint32_t payload_size;
+static uint32_t packet_size;
+static volatile uint8_t video_alt_setting=0;
+static uint8_t frame_id=0;		// FID bit, toggles with each frame
+static uint32_t frame_offset=0;
+static const uint8_t *frame_data[2];	// [0] is sending, [1] waits
+static void (*frame_callback[2])(const void *frame);
+
+// buffer for SET_CUR data, which all fits the one format this device has
+uint8_t usb_video_control_buffer[48] __attribute__ ((aligned(32)));
+
+static void tx_event(transfer_t *t);
+
+void usb_video_configure(void)
+{
+	int mult;
+
+	if (usb_high_speed) {
+		packet_size = VIDEO_PACKET_SIZE_480;
+		mult = VIDEO_PACKET_MULT;
+	} else {
+		packet_size = VIDEO_PACKET_SIZE_12;
+		mult = 1;
+	}
+	payload_size = packet_size * mult;
+	printf("usb_video_configure: payload %u\n", payload_size);
+	memset(tx_transfer, 0, sizeof(tx_transfer));
+	video_alt_setting = 0;
+	frame_id = 0;
+	frame_offset = 0;
+	frame_data[0] = NULL;
+	frame_data[1] = NULL;
+	usb_config_tx_iso(VIDEO_TX_ENDPOINT, packet_size, mult, tx_event);
+}
+
+
+/*************************************************************************/
+/**                            Control Requests                         **/
+/*************************************************************************/
+
+// Video Probe and Commit Controls, UVC 1.0, 4.3.1.1, Table 4-47.  Only one
+// format, frame size and rate exist, so every negotiation ends the same.
+static void put32(uint8_t *p, uint32_t n)
+{
+	p[0] = n;
+	p[1] = n >> 8;
+	p[2] = n >> 16;
+	p[3] = n >> 24;
+}
+
+static uint32_t get_probe(uint8_t *p)
+{
+	memset(p, 0, 26);
+	p[2] = 1;			// bFormatIndex
+	p[3] = 1;			// bFrameIndex
+	put32(p + 4, VIDEO_FRAME_INTERVAL);	// dwFrameInterval
+	put32(p + 18, VIDEO_FRAME_SIZE);	// dwMaxVideoFrameSize
+	put32(p + 22, payload_size);	// dwMaxPayloadTransferSize
+	return 26;
+}
+
+// Reply to a GET request for the streaming interface's probe (selector 1)
+// or commit (selector 2) control.  Returns the length, or 0 if unsupported.
+uint32_t usb_video_get_control(uint32_t request, uint32_t selector, uint8_t *buffer)
+{
+	if (selector != 1 && selector != 2) return 0;
+	switch (request) {
+	  case 0x81: // GET_CUR
+	  case 0x82: // GET_MIN
+	  case 0x83: // GET_MAX
+	  case 0x87: // GET_DEF
+		return get_probe(buffer);
+	  case 0x84: // GET_RES
+		memset(buffer, 0, 26);
+		return 26;
+	  case 0x85: // GET_LEN
+		buffer[0] = 26;
+		buffer[1] = 0;
+		return 2;
+	  case 0x86: // GET_INFO
+		buffer[0] = 0x03; // supports GET and SET
+		return 1;
+	}
+	return 0;
+}
+
+// The host selects alternate setting 1 of the streaming interface to start
+// video, and 0 to stop.  Called from the USB interrupt.
+void usb_video_set_interface(uint32_t alt)
+{
+	video_alt_setting = alt;
+	if (alt == 1) {
+		frame_offset = 0;
+		for (uint32_t i=0; i < TX_NUM; i++) {
+			if (!(usb_transfer_status(tx_transfer + i) & 0x80)) {
+				tx_event(tx_transfer + i);
+			}
+		}
+	} else {
+		// give back any frames, the host will not read them
+		for (uint32_t i=0; i < 2; i++) {
+			const uint8_t *frame = frame_data[i];
+			void (*callback)(const void *frame) = frame_callback[i];
+			frame_data[i] = NULL;
+			if (frame && callback) (*callback)(frame);
+		}
+	}
+}
+
+uint32_t usb_video_get_interface(void)
+{
+	return video_alt_setting;
+}
+
+
+/*************************************************************************/
+/**                               Transmit                              **/
+/*************************************************************************/
+
+// Prepare the next payload in a transfer which has completed, and queue it.
+// Called from the USB interrupt.
+static void tx_event(transfer_t *t)
+{
+	if (video_alt_setting != 1) return;
+	uint32_t i = t - tx_transfer;
+	uint8_t *buf = txbuffer[i];
+	uint32_t len = 0;
+	const uint8_t *frame = frame_data[0];
+	if (frame) {
+		// Payload Header, UVC 1.0, 2.4.3.3, Table 2-5
+		uint32_t n = VIDEO_FRAME_SIZE - frame_offset;
+		if (n > payload_size - 2) n = payload_size - 2;
+		buf[0] = 2;			// bHeaderLength
+		buf[1] = 0x80 | frame_id;	// bmHeaderInfo, EOH + FID
+		memcpy(buf + 2, frame + frame_offset, n);
+		frame_offset += n;
+		len = n + 2;
+		if (frame_offset >= VIDEO_FRAME_SIZE) {
+			// all of this frame is copied, so the caller may reuse it
+			void (*callback)(const void *frame) = frame_callback[0];
+			buf[1] |= 0x02;		// EOF, end of frame
+			frame_id ^= 1;
+			frame_offset = 0;
+			frame_data[0] = frame_data[1];
+			frame_callback[0] = frame_callback[1];
+			frame_data[1] = NULL;
+			if (callback) (*callback)(frame);
+		}
+		dma_buffer_to_device(buf, len);
+	}
+	// with no frame ready, zero length payloads keep the stream running
+	usb_prepare_transfer(t, buf, len, i);
+	// MultO, the number of packets this microframe.  Without it the
+	// controller picks the data PIDs for the endpoint's full mult, which
+	// is wrong for a short payload.  A zero length payload is 1 packet.
+	uint32_t packets = (len + packet_size - 1) / packet_size;
+	if (packets == 0) packets = 1;
+	t->status |= packets << 10;
+	usb_transmit(VIDEO_TX_ENDPOINT, t);
+}
+
+int usb_video_streaming(void)
+{
+	return usb_configuration && video_alt_setting == 1;
+}
+
+int usb_video_write_frame(const void *frame, void (*callback)(const void *frame))
+{
+	int ret = 1;
+
+	if (!usb_video_streaming() || !frame) return 0;
+	NVIC_DISABLE_IRQ(IRQ_USB1);
+	if (frame_data[0] == NULL) {
+		frame_data[0] = (const uint8_t *)frame;
+		frame_callback[0] = callback;
+		frame_offset = 0;
+	} else if (frame_data[1] == NULL) {
+		frame_data[1] = (const uint8_t *)frame;
+		frame_callback[1] = callback;
+	} else {
+		ret = 0;
+	}
+	NVIC_ENABLE_IRQ(IRQ_USB1);
+	return ret;
+}
+
+int usb_video_busy(void)
+{
+	return frame_data[1] != NULL;
+}
+
+#endif // VIDEO_INTERFACE
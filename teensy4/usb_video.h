@@ -0,0 +1,80 @@
+/* Teensyduino Core Library
+ * http://www.pjrc.com/teensy/
+ * Copyright (c) 2026 PJRC.COM, LLC.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * 1. The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * 2. If the Software is incorporated into a build system that allows
+ * selection among a list of target devices, then similar target
+ * devices manufactured by PJRC.COM must be included in the list of
+ * target devices and selectable in the same manner.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include "usb_desc.h"
+
+#if defined(VIDEO_INTERFACE)
+
+#include <inttypes.h>
+
+// C language implementation
+#ifdef __cplusplus
+extern "C" {
+#endif
+void usb_video_configure(void);
+void usb_video_set_interface(uint32_t alt);
+uint32_t usb_video_get_interface(void);
+uint32_t usb_video_get_control(uint32_t request, uint32_t selector, uint8_t *buffer);
+extern uint8_t usb_video_control_buffer[];
+int usb_video_streaming(void);
+int usb_video_write_frame(const void *frame, void (*callback)(const void *frame));
+int usb_video_busy(void);
+#ifdef __cplusplus
+}
+#endif
+
+
+// C++ interface
+#ifdef __cplusplus
+class usb_video_class
+{
+public:
+	// true while the host has a program showing the video
+	bool streaming(void) { return usb_video_streaming(); }
+	// Queue a frame of VIDEO_WIDTH x VIDEO_HEIGHT YUY2 pixels (2 bytes per
+	// pixel) to send.  The data is read as it is sent, so the buffer must
+	// not change until the callback, which runs from the USB interrupt.
+	// One frame may wait while another is sending.  Returns 0 if both
+	// are busy, or if the host is not streaming.
+	int writeFrame(const void *frame, void (*callback)(const void *frame)=nullptr) {
+		return usb_video_write_frame(frame, callback); }
+	// true when writeFrame() would not accept another frame
+	bool busy(void) { return usb_video_busy(); }
+	int width(void) { return VIDEO_WIDTH; }
+	int height(void) { return VIDEO_HEIGHT; }
+};
+
+extern usb_video_class VideoUSB;
+
+#endif // __cplusplus
+
+#endif // VIDEO_INTERFACE
@@ -19,6 +19,8 @@
 #ifndef _CORTEX_M3_ATOMIC_H_
 #define _CORTEX_M3_ATOMIC_H_
 
+#include "irq_priority.h"
+
 static __inline__ uint32_t __get_primask(void) \
 { uint32_t primask = 0; \
   __asm__ volatile ("MRS %[result], PRIMASK\n\t":[result]"=r"(primask)::); \
@@ -67,5 +69,34 @@ uint32_t primask_save __attribute__((__cleanup__(__iRestore))) = __get_primask()
 #define NONATOMIC_FORCEOFF \
 uint32_t primask_save __attribute__((__cleanup__(__iCliParam))) = 0
 
+// ATOMIC_BLOCK_PRIORITY(level) masks only interrupts at level and lower
+// priority (numerically greater or equal) using BASEPRI, so more urgent
+// interrupts keep running.  Use it when the data is shared only with
+// interrupts at known priorities, see irq_priority.h.  Blocks may nest.
+//
+//   ATOMIC_BLOCK_PRIORITY(IRQ_PRIORITY_USB) {
+//     ... code shared with the USB interrupt
+//   }
+static __inline__ void __iRestoreBasepri(const uint32_t *__s) \
+{ irq_restore_priority(*__s); }
+
+#define ATOMIC_BLOCK_PRIORITY(level) \
+for ( uint32_t basepri_save __attribute__((__cleanup__(__iRestoreBasepri))) = \
+  irq_mask_priority(level), __ToDo = 1; __ToDo ; __ToDo = 0 )
+
+#ifdef __cplusplus
+// The same as a scoped guard, masking until the end of the enclosing block
+//   { AtomicPriorityGuard guard(IRQ_PRIORITY_USB);  ... }
+class AtomicPriorityGuard {
+public:
+	explicit AtomicPriorityGuard(uint32_t level) : save(irq_mask_priority(level)) { }
+	~AtomicPriorityGuard() { irq_restore_priority(save); }
+	AtomicPriorityGuard(const AtomicPriorityGuard &) = delete;
+	AtomicPriorityGuard & operator = (const AtomicPriorityGuard &) = delete;
+private:
+	uint32_t save;
+};
+#endif
+
 #endif 
 #endif
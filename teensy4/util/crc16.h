@@ -35,6 +35,7 @@
 #define _UTIL_CRC16_H_
 
 #include <stdint.h>
+#include <stddef.h>
 
 static inline uint16_t _crc16_update(uint16_t crc, uint8_t data) __attribute__((always_inline, unused));
 static inline uint16_t _crc16_update(uint16_t crc, uint8_t data)
@@ -94,5 +95,23 @@ static inline uint8_t _crc_ibutton_update(uint8_t crc, uint8_t data)
 	return crc;
 }
 
+// Block versions, table driven (crc.c).  Pass the previous result to
+// continue across several blocks.  crc16, xmodem and ccitt match calling
+// the _update functions above for every byte.  crc32 and crc32c are the
+// usual zlib / iSCSI convention: start with 0, the inversion is done here.
+// crc32_mpeg2 is non-reflected 0x04C11DB7, with no final inversion; start
+// with 0xFFFFFFFF.  On Teensy 4, it is computed by the DCP hardware.
+#ifdef __cplusplus
+extern "C" {
+#endif
+uint16_t crc16_block(uint16_t crc, const void *data, size_t len);
+uint16_t crc_xmodem_block(uint16_t crc, const void *data, size_t len);
+uint16_t crc_ccitt_block(uint16_t crc, const void *data, size_t len);
+uint32_t crc32_block(uint32_t crc, const void *data, size_t len);
+uint32_t crc32c_block(uint32_t crc, const void *data, size_t len);
+uint32_t crc32_mpeg2_block(uint32_t crc, const void *data, size_t len);
+#ifdef __cplusplus
+}
 #endif
 
+#endif
@@ -211,6 +211,52 @@ void extmem_free(void *ptr);
 void *extmem_calloc(size_t nmemb, size_t size);
 void *extmem_realloc(void *ptr, size_t size);
 
+// The functions above must not be used from interrupts.  For interrupt
+// use, reserve fixed size blocks from setup() with extmem_isr_reserve().
+// extmem_malloc_isr() and extmem_free_isr() then disable interrupts only
+// for a few instructions, constant regardless of heap state.  Blocks
+// are 32 byte aligned and padded, safe for cache maintenance and DMA.
+// extmem_free() and extmem_realloc() also accept these blocks, and
+// extmem_realloc() moves one to the heap if it must grow.
+int extmem_isr_reserve(size_t size, unsigned int count);
+void *extmem_malloc_isr(size_t size);
+void extmem_free_isr(void *ptr);
+
+// Allocate by intended use rather than by address.  malloc_fast() uses
+// DTCM for small, frequently accessed structures.  malloc_dma() uses
+// OCRAM with 32 byte aligned and padded buffers, safe for cache
+// maintenance.  malloc_large() uses EXTMEM for bulk data.  When the
+// preferred memory is full or absent, malloc_fast() and malloc_large()
+// fall back to OCRAM.  Memory from any of these must be freed with
+// free_tiered().  None of these may be used from interrupts.
+#define MALLOC_TIER_DTCM	0
+#define MALLOC_TIER_OCRAM	1
+#define MALLOC_TIER_EXTMEM	2
+#define MALLOC_TIER_COUNT	3
+typedef struct {
+	size_t size;		// total memory in this tier
+	size_t used;		// bytes now allocated by these functions
+	size_t peak;		// largest "used" ever seen
+	uint32_t allocs;	// successful allocations
+	uint32_t fails;		// requests this tier could not satisfy
+} malloc_tier_stats_t;
+void *malloc_fast(size_t size);
+void *malloc_dma(size_t size);
+void *malloc_large(size_t size);
+void free_tiered(void *ptr);
+int malloc_tier_stats(int tier, malloc_tier_stats_t *stats);
+
+// Routing for C++ new and delete.  The alloc hook may return NULL to use
+// the normal heap, and the free hook returns non-zero if it owned the
+// pointer.  The size given to the free hook is 0 when not known.  A hook
+// may send small fixed size objects to an ObjectPool, for example.
+// new_set_large_size() sends new of that many bytes or more to
+// extmem_malloc(), or 0 (the default) to never do so.
+typedef void * (*new_alloc_hook_t)(size_t size);
+typedef int (*new_free_hook_t)(void *ptr, size_t size);
+void new_set_hooks(new_alloc_hook_t alloc, new_free_hook_t release);
+void new_set_large_size(size_t size);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -30,54 +30,153 @@
 
 #include <Arduino.h>
 #include "EventResponder.h"
+#include "usb_dev.h"
+#include "debug/trace.h"
+
+#ifdef TRACE_LOG
+#define YIELD_CHECK_TRACE_DEFAULT YIELD_CHECK_TRACE
+#else
+#define YIELD_CHECK_TRACE_DEFAULT 0
+#endif
 
 #ifdef USB_TRIPLE_SERIAL
-uint8_t yield_active_check_flags = YIELD_CHECK_USB_SERIAL | YIELD_CHECK_USB_SERIALUSB1 | YIELD_CHECK_USB_SERIALUSB2; // default to check USB.
+uint8_t yield_active_check_flags = YIELD_CHECK_USB_SERIAL | YIELD_CHECK_USB_SERIALUSB1 | YIELD_CHECK_USB_SERIALUSB2 | YIELD_CHECK_TRACE_DEFAULT; // default to check USB.
 extern const uint8_t _serialEventUSB2_default;	
 extern const uint8_t _serialEventUSB1_default;	
 
 #elif defined(USB_DUAL_SERIAL)
-uint8_t yield_active_check_flags = YIELD_CHECK_USB_SERIAL | YIELD_CHECK_USB_SERIALUSB1; // default to check USB.
+uint8_t yield_active_check_flags = YIELD_CHECK_USB_SERIAL | YIELD_CHECK_USB_SERIALUSB1 | YIELD_CHECK_TRACE_DEFAULT; // default to check USB.
 extern const uint8_t _serialEventUSB1_default;	
 
 #else
-uint8_t yield_active_check_flags = YIELD_CHECK_USB_SERIAL; // default to check USB.
+uint8_t yield_active_check_flags = YIELD_CHECK_USB_SERIAL | YIELD_CHECK_TRACE_DEFAULT; // default to check USB.
 #endif
 
 extern const uint8_t _serialEvent_default;	
 
-void yield(void) __attribute__ ((weak));
-void yield(void)
-{
-	static uint8_t running=0;
-	if (!yield_active_check_flags) return;	// nothing to do
-	if (running) return; // TODO: does this need to be atomic?
-	running = 1;
+// Everything is ready at startup, so each check runs at least once.
+volatile uint32_t yield_ready_flags = 0xFF;
 
+// Atomically clear ready bits, returning the ones which were set.
+static uint32_t yield_take_ready(uint32_t mask)
+{
+	uint32_t val, fail;
+	do {
+		__asm__ volatile("ldrex %0, [%1]" : "=r" (val) : "r" (&yield_ready_flags));
+		__asm__ volatile("strex %0, %1, [%2]" : "=&r" (fail) : "r" (val & ~mask), "r" (&yield_ready_flags) : "memory");
+	} while (fail);
+	return val & mask;
+}
 
-	// USB Serial - Add hack to minimize impact...
-	if (yield_active_check_flags & YIELD_CHECK_USB_SERIAL) {
-		if (Serial.available()) serialEvent();
-		if (_serialEvent_default) yield_active_check_flags &= ~YIELD_CHECK_USB_SERIAL;
+// USB Serial - Add hack to minimize impact...
+static void yield_usb_serial(void)
+{
+	if (Serial.available()) {
+		serialEvent();
+		if (Serial.available()) yield_ready(YIELD_CHECK_USB_SERIAL);
 	}
+	if (_serialEvent_default) yield_active_check_flags &= ~YIELD_CHECK_USB_SERIAL;
+}
+
+// Current workaround until integrate with EventResponder.
+static void yield_hardware_serial(void)
+{
+	if (HardwareSerial::processSerialEventsList()) yield_ready(YIELD_CHECK_HARDWARE_SERIAL);
+}
 
 #if defined(USB_DUAL_SERIAL) || defined(USB_TRIPLE_SERIAL)
-	if (yield_active_check_flags & YIELD_CHECK_USB_SERIALUSB1) {
-		if (SerialUSB1.available()) serialEventUSB1();
-		if (_serialEventUSB1_default) yield_active_check_flags &= ~YIELD_CHECK_USB_SERIALUSB1;
+static void yield_usb_serial1(void)
+{
+	if (SerialUSB1.available()) {
+		serialEventUSB1();
+		if (SerialUSB1.available()) yield_ready(YIELD_CHECK_USB_SERIALUSB1);
 	}
+	if (_serialEventUSB1_default) yield_active_check_flags &= ~YIELD_CHECK_USB_SERIALUSB1;
+}
 #endif
+
 #ifdef USB_TRIPLE_SERIAL
-	if (yield_active_check_flags & YIELD_CHECK_USB_SERIALUSB2) {
-		if (SerialUSB2.available()) serialEventUSB2();
-		if (_serialEventUSB2_default) yield_active_check_flags &= ~YIELD_CHECK_USB_SERIALUSB2;
+static void yield_usb_serial2(void)
+{
+	if (SerialUSB2.available()) {
+		serialEventUSB2();
+		if (SerialUSB2.available()) yield_ready(YIELD_CHECK_USB_SERIALUSB2);
 	}
+	if (_serialEventUSB2_default) yield_active_check_flags &= ~YIELD_CHECK_USB_SERIALUSB2;
+}
+#endif
+
+#ifdef TRACE_LOG
+static void yield_trace(void)
+{
+	if (trace_drain()) yield_ready(YIELD_CHECK_TRACE);
+}
+#endif
+
+// One function for each YIELD_CHECK bit, except YIELD_CHECK_EVENT_RESPONDER
+// which runs after the others, outside the recursion check.
+static void (* const yield_pollers[])(void) = {
+	yield_usb_serial,		// YIELD_CHECK_USB_SERIAL
+	yield_hardware_serial,		// YIELD_CHECK_HARDWARE_SERIAL
+	nullptr,			// YIELD_CHECK_EVENT_RESPONDER
+#if defined(USB_DUAL_SERIAL) || defined(USB_TRIPLE_SERIAL)
+	yield_usb_serial1,		// YIELD_CHECK_USB_SERIALUSB1
+#else
+	nullptr,
+#endif
+#ifdef USB_TRIPLE_SERIAL
+	yield_usb_serial2,		// YIELD_CHECK_USB_SERIALUSB2
+#elif defined(TRACE_LOG)
+	nullptr,
+#endif
+#ifdef TRACE_LOG
+	yield_trace,			// YIELD_CHECK_TRACE
 #endif
+};
+#define YIELD_NUM_POLLERS (sizeof(yield_pollers) / sizeof(yield_pollers[0]))
 
-	// Current workaround until integrate with EventResponder.
-	if (yield_active_check_flags & YIELD_CHECK_HARDWARE_SERIAL) HardwareSerial::processSerialEventsList();
+void yield(void) __attribute__ ((weak));
+void yield(void)
+{
+	static uint8_t running=0;
+#if !defined(USB_DISABLED)
+	if (usb_power_save_pending) usb_power_save_update();
+#endif
+	if (tempmon_throttle_pending) tempmon_throttle_update();
+	if (clock_governor_active) clock_governor_update();
+	if (!(yield_ready_flags & yield_active_check_flags)) {	// nothing to do
+		// delay() decides for itself when to sleep
+		if ((idle_wfi_mode & IDLE_WFI_YIELD) && !delay_active) idle_wfi();
+		return;
+	}
+	if (running) return; // TODO: does this need to be atomic?
+	running = 1;
+
+#ifdef LOOP_STATS
+	uint32_t begin = ARM_DWT_CYCCNT;
+#endif
+	uint32_t ready = yield_take_ready(yield_active_check_flags & ~YIELD_CHECK_EVENT_RESPONDER);
+	while (ready) {
+		uint32_t bit = __builtin_ctz(ready);
+		ready &= ready - 1;
+		if (bit < YIELD_NUM_POLLERS && yield_pollers[bit]) yield_pollers[bit]();
+	}
+#ifdef LOOP_STATS
+	loop_stats.serial_event_cycles += ARM_DWT_CYCCNT - begin;
+#endif
 
 	running = 0;
-	if (yield_active_check_flags & YIELD_CHECK_EVENT_RESPONDER) EventResponder::runFromYield();
-	
+	if (yield_active_check_flags & YIELD_CHECK_EVENT_RESPONDER) {
+		if (yield_take_ready(YIELD_CHECK_EVENT_RESPONDER)) {
+#ifdef LOOP_STATS
+			uint32_t begin = ARM_DWT_CYCCNT;
+#endif
+			EventResponder::runFromYield();
+			EventResponder::runThreads();
+			if (EventResponder::yieldPending()) yield_ready(YIELD_CHECK_EVENT_RESPONDER);
+#ifdef LOOP_STATS
+			loop_stats.event_responder_cycles += ARM_DWT_CYCCNT - begin;
+#endif
+		}
+	}
 };
@@ -11,7 +11,7 @@ void media_init(void);
 uint8_t media_lock(void);
 void media_unlock(void);
 void media_poll(void);
-static void media_send_begin(uint32_t lba);
+static void media_send_begin(uint32_t lba, uint16_t count);
 static void media_send_chunk(uint32_t lba, uint8_t chunk);
 static void media_send_end(void);
 static void media_receive_begin(uint32_t lba);
@@ -166,7 +166,17 @@ uint8_t media_read_sector(uint32_t lba, uint8_t *buffer)
 }
 
 
-static void media_send_begin(uint32_t lba)
+uint8_t media_read_sectors(uint32_t lba, uint8_t *buffer, uint16_t count)
+{
+	for (; count > 0; count--) {
+		if (!media_read_sector(lba++, buffer)) return 0;
+		buffer += 512;
+	}
+	return 1;
+}
+
+
+static void media_send_begin(uint32_t lba, uint16_t count)
 {
 }
 
@@ -250,6 +260,15 @@ uint8_t media_write_sector(uint32_t lba, const uint8_t *buffer)
 #endif
 }
 
+uint8_t media_write_sectors(uint32_t lba, const uint8_t *buffer, uint16_t count)
+{
+	for (; count > 0; count--) {
+		if (!media_write_sector(lba++, buffer)) return 0;
+		buffer += 512;
+	}
+	return 1;
+}
+
 static void media_receive_begin(uint32_t lba)
 {
 	// TODO: check media_rdonly, return error is read only mode
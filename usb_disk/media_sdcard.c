@@ -13,9 +13,10 @@ void media_init(void);
 uint8_t media_lock(void);
 void media_unlock(void);
 void media_poll(void);
-static void media_send_begin(uint32_t lba);
+static void media_send_begin(uint32_t lba, uint16_t count);
 static void media_send_chunk(uint32_t lba, uint8_t chunk);
 static void media_send_end(void);
+static void media_send_stop(void);
 static void media_receive_begin(uint32_t lba);
 static void media_receive_chunk(uint32_t lba, uint8_t chunk);
 static void media_receive_end(void);
@@ -157,6 +158,95 @@ volatile uint8_t media_state USBSTATE;
 uint8_t media_type USBSTATE;
 
 
+// Hosts reread the FAT and directory sectors constantly, almost always
+// with short requests, while file data arrives in long runs.  Sectors
+// from short reads are kept in a tiny least recently used cache, and
+// after each short read the next sector is read ahead, since the card is
+// already streaming it.  Long reads bypass the cache.  Teensy 2.0 has
+// only 2.5K of RAM, so it has no cache unless MEDIA_CACHE_SECTORS is set.
+// With 0 sectors, the arrays are empty and every lookup misses.
+#ifndef MEDIA_CACHE_SECTORS
+#if defined(__AVR_AT90USB1286__)
+#define MEDIA_CACHE_SECTORS	4
+#elif defined(__AVR_AT90USB646__)
+#define MEDIA_CACHE_SECTORS	2
+#else
+#define MEDIA_CACHE_SECTORS	0
+#endif
+#endif
+#define MEDIA_CACHE_NONE	0xFF
+#define MEDIA_CACHE_INVALID	0xFFFFFFFF
+
+static uint8_t media_cache_buf[MEDIA_CACHE_SECTORS][512];
+static uint32_t media_cache_lba[MEDIA_CACHE_SECTORS];
+static uint8_t media_cache_age[MEDIA_CACHE_SECTORS];
+
+static void media_cache_clear(void)
+{
+	uint8_t i;
+
+	for (i=0; i < MEDIA_CACHE_SECTORS; i++) {
+		media_cache_lba[i] = MEDIA_CACHE_INVALID;
+	}
+}
+
+static void media_cache_touch(uint8_t n)
+{
+	uint8_t i;
+
+	for (i=0; i < MEDIA_CACHE_SECTORS; i++) {
+		if (media_cache_age[i] < 255) media_cache_age[i]++;
+	}
+	media_cache_age[n] = 0;
+}
+
+static uint8_t media_cache_find(uint32_t lba)
+{
+	uint8_t i;
+
+	for (i=0; i < MEDIA_CACHE_SECTORS; i++) {
+		if (media_cache_lba[i] == lba) {
+			media_cache_touch(i);
+			return i;
+		}
+	}
+	return MEDIA_CACHE_NONE;
+}
+
+// pick the empty or least recently used sector, which the caller fills
+static uint8_t media_cache_alloc(void)
+{
+	uint8_t i, n=MEDIA_CACHE_NONE, age=0;
+
+	for (i=0; i < MEDIA_CACHE_SECTORS; i++) {
+		if (media_cache_lba[i] == MEDIA_CACHE_INVALID) {
+			n = i;
+			break;
+		}
+		if (n == MEDIA_CACHE_NONE || media_cache_age[i] >= age) {
+			n = i;
+			age = media_cache_age[i];
+		}
+	}
+	if (n != MEDIA_CACHE_NONE) {
+		media_cache_lba[n] = MEDIA_CACHE_INVALID;
+		media_cache_touch(n);
+	}
+	return n;
+}
+
+static void media_cache_invalidate(uint32_t lba, uint16_t count)
+{
+	uint8_t i;
+
+	for (i=0; i < MEDIA_CACHE_SECTORS; i++) {
+		if (media_cache_lba[i] - lba < count) {
+			media_cache_lba[i] = MEDIA_CACHE_INVALID;
+		}
+	}
+}
+
+
 void media_restart(void)
 {
 	SPI_PORT |= (1<<SPI_SS_PIN);
@@ -173,6 +263,7 @@ void media_init(void)
 	media_state = MEDIA_STATE_NOCARD;
 	media_type = MEDIA_TYPE_SDv1;
 	media_rdonly = READ_ONLY;
+	media_cache_clear();
 	media_poll();
 }
 
@@ -249,6 +340,7 @@ void media_poll(void)
 				}
 			}
 			sd_deselect();
+			media_cache_clear(); // possibly a different card
 			media_state = MEDIA_STATE_INITIALIZING;
 		}
 	} else {
@@ -404,10 +496,78 @@ done:
 }
 
 
-static void media_send_begin(uint32_t lba)
+// Read several consecutive sectors with one READ_MULTIPLE_BLOCK command,
+// rather than paying the command overhead for every 512 bytes.
+uint8_t media_read_sectors(uint32_t lba, uint8_t *buffer, uint16_t count)
+{
+	uint8_t r, i, ret=0;
+
+	if (count <= 1) {
+		if (count == 0) return 1;
+		return media_read_sector(lba, buffer);
+	}
+	while (!media_lock()) /*wait*/ ;
+	if (media_type != MEDIA_TYPE_SDHC) lba = (lba << 9);
+	r = sd_command(SD_CMD_READ_MULTIPLE_BLOCK, lba);
+	if (r) {
+		print("User Read Error, r=");
+		phex(r);
+		print("\n");
+		sd_deselect();
+		goto done;
+	}
+	do {
+		if (sd_wait_data() != 0xFE) {
+			print("User Read Error, bad token\n");
+			break;
+		}
+		for (i=0; i<64; i++) {
+			*buffer++ = spi_xfer(0xFF);
+			*buffer++ = spi_xfer(0xFF);
+			*buffer++ = spi_xfer(0xFF);
+			*buffer++ = spi_xfer(0xFF);
+			*buffer++ = spi_xfer(0xFF);
+			*buffer++ = spi_xfer(0xFF);
+			*buffer++ = spi_xfer(0xFF);
+			*buffer++ = spi_xfer(0xFF);
+		}
+		spi_write(0xFF);	// ignore CRC
+		spi_write(0xFF);
+	} while (--count);
+	if (count == 0) ret = 1;
+	media_send_stop();
+done:
+	media_unlock();
+	return ret;
+}
+
+
+static uint8_t send_cacheable;	// request is short enough to cache
+static uint8_t send_streaming;	// card is sending READ_MULTIPLE_BLOCK data
+static uint32_t send_card_lba;	// next sector the card will send
+static uint8_t send_cache;	// sector sending from cache
+static uint8_t send_fill;	// cache sector filling while sending from card
+
+// The card is only asked for data when a sector isn't cached, so
+// READ_MULTIPLE_BLOCK begins at the first miss rather than here.
+static void media_send_begin(uint32_t lba, uint16_t count)
+{
+	send_cacheable = (count <= MEDIA_CACHE_SECTORS);
+	send_streaming = 0;
+	send_cache = MEDIA_CACHE_NONE;
+	send_fill = MEDIA_CACHE_NONE;
+}
+
+static void media_send_stream(uint32_t lba)
 {
 	uint8_t r;
 
+	if (send_streaming) {
+		if (send_card_lba == lba) return;
+		media_send_stop();
+	}
+	send_card_lba = lba;
+	send_streaming = 1;
 	if (media_type != MEDIA_TYPE_SDHC) lba = (lba << 9);
 	r = sd_command(SD_CMD_READ_MULTIPLE_BLOCK, lba);
 	if (r) {
@@ -420,44 +580,121 @@ static void media_send_begin(uint32_t lba)
 	}
 }
 
-static void media_send_chunk(uint32_t lba, uint8_t chunk)
+static void media_send_token(void)
 {
 	uint8_t i;
 
+	i = sd_wait_data();
+	//phex(i);
+	if (i != 0xFE) {
+		print("Read error, token=");
+		phex(i);
+		print("\n");
+	}
+}
+
+static void media_send_chunk(uint32_t lba, uint8_t chunk)
+{
+	uint8_t i, *p;
+
 	if (chunk == 0) {
-		i = sd_wait_data();
-		//phex(i);
-		if (i != 0xFE) {
-			print("Read error, token=");
-			phex(i);
-			print("\n");
+		send_cache = media_cache_find(lba);
+		if (send_cache == MEDIA_CACHE_NONE) {
+			media_send_stream(lba);
+			media_send_token();
+			send_fill = send_cacheable ? media_cache_alloc() : MEDIA_CACHE_NONE;
 		}
 	}
 
-	for (i=0; i<8; i++) {
-		// TODO: asm optimization
-		UEDATX = spi_xfer(0xFF);
-		UEDATX = spi_xfer(0xFF);
-		UEDATX = spi_xfer(0xFF);
-		UEDATX = spi_xfer(0xFF);
-		UEDATX = spi_xfer(0xFF);
-		UEDATX = spi_xfer(0xFF);
-		UEDATX = spi_xfer(0xFF);
-		UEDATX = spi_xfer(0xFF);
+	if (send_cache != MEDIA_CACHE_NONE) {
+		p = media_cache_buf[send_cache] + chunk * 64;
+		for (i=0; i<8; i++) {
+			UEDATX = *p++;
+			UEDATX = *p++;
+			UEDATX = *p++;
+			UEDATX = *p++;
+			UEDATX = *p++;
+			UEDATX = *p++;
+			UEDATX = *p++;
+			UEDATX = *p++;
+		}
+		UEINTX = 0x3A;
+		return;
+	}
+	if (send_fill != MEDIA_CACHE_NONE) {
+		p = media_cache_buf[send_fill] + chunk * 64;
+		for (i=0; i<8; i++) {
+			UEDATX = *p++ = spi_xfer(0xFF);
+			UEDATX = *p++ = spi_xfer(0xFF);
+			UEDATX = *p++ = spi_xfer(0xFF);
+			UEDATX = *p++ = spi_xfer(0xFF);
+			UEDATX = *p++ = spi_xfer(0xFF);
+			UEDATX = *p++ = spi_xfer(0xFF);
+			UEDATX = *p++ = spi_xfer(0xFF);
+			UEDATX = *p++ = spi_xfer(0xFF);
+		}
+	} else {
+		for (i=0; i<8; i++) {
+			// TODO: asm optimization
+			UEDATX = spi_xfer(0xFF);
+			UEDATX = spi_xfer(0xFF);
+			UEDATX = spi_xfer(0xFF);
+			UEDATX = spi_xfer(0xFF);
+			UEDATX = spi_xfer(0xFF);
+			UEDATX = spi_xfer(0xFF);
+			UEDATX = spi_xfer(0xFF);
+			UEDATX = spi_xfer(0xFF);
+		}
 	}
 	UEINTX = 0x3A;
 
 	if (chunk == 7) {
 		spi_write(0xFF);
 		spi_write(0xFF);
+		send_card_lba++;
+		if (send_fill != MEDIA_CACHE_NONE) {
+			media_cache_lba[send_fill] = lba;
+			send_fill = MEDIA_CACHE_NONE;
+		}
 	}
 	//print(".");
 }
 
 static void media_send_end(void)
+{
+	uint8_t n, i, *p;
+
+	if (!send_streaming) return;
+	if (send_cacheable && media_cache_find(send_card_lba) == MEDIA_CACHE_NONE) {
+		// read ahead the sector the card is already sending
+		n = media_cache_alloc();
+		if (n != MEDIA_CACHE_NONE) {
+			if (sd_wait_data() == 0xFE) {
+				p = media_cache_buf[n];
+				for (i=0; i<64; i++) {
+					*p++ = spi_xfer(0xFF);
+					*p++ = spi_xfer(0xFF);
+					*p++ = spi_xfer(0xFF);
+					*p++ = spi_xfer(0xFF);
+					*p++ = spi_xfer(0xFF);
+					*p++ = spi_xfer(0xFF);
+					*p++ = spi_xfer(0xFF);
+					*p++ = spi_xfer(0xFF);
+				}
+				spi_write(0xFF);
+				spi_write(0xFF);
+				media_cache_lba[n] = send_card_lba;
+			}
+		}
+	}
+	media_send_stop();
+}
+
+static void media_send_stop(void)
 {
 	//uint8_t r;
 
+	send_streaming = 0;
 	/* r = */ sd_command(SD_CMD_STOP_TRANSMISSION, 0);
 	// TODO: proper handling of stop transaction.....
 	// but what is the proper way?	Older cards stop instantly,
@@ -523,6 +760,7 @@ uint8_t media_write_sector(uint32_t lba, const uint8_t *buffer)
 	uint8_t r, i, ret=0;
 
 	while (!media_lock()) /*wait*/ ;
+	media_cache_invalidate(lba, 1);
 	if (media_type != MEDIA_TYPE_SDHC) lba = (lba << 9);
 
 	r = sd_command(SD_CMD_WRITE_SINGLE_BLOCK, lba);
@@ -561,13 +799,67 @@ done:
 }
 
 
+// Write several consecutive sectors with one WRITE_MULTIPLE_BLOCK command,
+// so the card can program them together instead of one at a time.
+uint8_t media_write_sectors(uint32_t lba, const uint8_t *buffer, uint16_t count)
+{
+	uint8_t r, i, ret=0;
+
+	if (count <= 1) {
+		if (count == 0) return 1;
+		return media_write_sector(lba, buffer);
+	}
+	while (!media_lock()) /*wait*/ ;
+	media_cache_invalidate(lba, count);
+	if (media_type != MEDIA_TYPE_SDHC) lba = (lba << 9);
+	r = sd_command(SD_CMD_WRITE_MULTIPLE_BLOCK, lba);
+	if (r) {
+		print("User Write Error, r=");
+		phex(r);
+		print("\n");
+		sd_deselect();
+		goto done;
+	}
+	do {
+		spi_write(0xFC);  // multiple block start token
+		for (i=0; i<64; i++) {
+			spi_write(*buffer++);
+			spi_write(*buffer++);
+			spi_write(*buffer++);
+			spi_write(*buffer++);
+			spi_write(*buffer++);
+			spi_write(*buffer++);
+			spi_write(*buffer++);
+			spi_write(*buffer++);
+		}
+		spi_write(0xFF);	// CRC
+		spi_write(0xFF);
+		r = spi_xfer(0xFF);	// data response
+		if ((r & 0x1F) != 0x05) {
+			print("User Write Error, response=");
+			phex(r);
+			print("\n");
+			break;
+		}
+		do {
+			r = spi_xfer(0xFF);	// wait for busy
+		} while (r != 0xFF);
+	} while (--count);
+	if (count == 0) ret = 1;
+	media_receive_end();
+done:
+	media_unlock();
+	return ret;
+}
+
+
 static void media_receive_begin(uint32_t lba)
 {
 	uint8_t r;
 
 	// TODO: check media_rdonly, return error is read only mode
 	if (media_type != MEDIA_TYPE_SDHC) lba = (lba << 9);
-	sd_command(SD_CMD_WRITE_MULTIPLE_BLOCK, lba);
+	r = sd_command(SD_CMD_WRITE_MULTIPLE_BLOCK, lba);
 	if (r) {
 		// TODO: check for errors...
 	}
@@ -579,6 +871,7 @@ static void media_receive_chunk(uint32_t lba, uint8_t chunk)
 	uint8_t i, r;
 
 	if (chunk == 0) {
+		media_cache_invalidate(lba, 1);
 		spi_write(0xFC);
 	}
 	for (i=0; i<8; i++) {
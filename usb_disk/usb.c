@@ -690,7 +690,7 @@ static inline uint8_t mass_storage_isr(uint8_t need_rx, uint8_t need_tx)
 					UENUM = DISK_TX_ENDPOINT;
 					goto send_finishup;
 				}
-				media_send_begin(lba);
+				media_send_begin(lba, sector_count);
 				sector_chunk = 0;
 				ms_state = MS_STATE_SEND_DATA;
 				goto send_data;
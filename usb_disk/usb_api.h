@@ -83,6 +83,8 @@ extern "C" {
 extern void media_claim(void);
 extern uint8_t media_read_sector(uint32_t lba, uint8_t *buffer);
 extern uint8_t media_write_sector(uint32_t lba, const uint8_t *buffer);
+extern uint8_t media_read_sectors(uint32_t lba, uint8_t *buffer, uint16_t count);
+extern uint8_t media_write_sectors(uint32_t lba, const uint8_t *buffer, uint16_t count);
 extern void media_release(uint8_t read_only_mode);
 uint8_t media_lock(void);
 void media_unlock(void);
@@ -106,6 +108,12 @@ class usb_disk_class
 	inline uint8_t writeSector(uint32_t addr, const uint8_t *buffer) {
 		return media_write_sector(addr, buffer);
 	}
+	inline uint8_t readSectors(uint32_t addr, uint8_t *buffer, uint16_t count) {
+		return media_read_sectors(addr, buffer, count);
+	}
+	inline uint8_t writeSectors(uint32_t addr, const uint8_t *buffer, uint16_t count) {
+		return media_write_sectors(addr, buffer, count);
+	}
 	inline void release(void) {
 		media_release(0);
 	}
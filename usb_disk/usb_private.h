@@ -90,6 +90,8 @@ extern uint8_t mouse_buttons;
 void media_claim(void);
 uint8_t media_read_sector(uint32_t lba, uint8_t *buffer);
 uint8_t media_write_sector(uint32_t lba, const uint8_t *buffer);
+uint8_t media_read_sectors(uint32_t lba, uint8_t *buffer, uint16_t count);
+uint8_t media_write_sectors(uint32_t lba, const uint8_t *buffer, uint16_t count);
 void media_release(uint8_t read_only_mode);
 
 
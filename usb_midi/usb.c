@@ -325,6 +325,7 @@ volatile uint8_t usb_suspended USBSTATE;
 // the time remaining before we transmit any partially full
 // packet, or send a zero length packet.
 volatile uint8_t debug_flush_timer USBSTATE;
+volatile uint8_t midi_tx_hold_timer USBSTATE;
 
 
 
@@ -354,6 +355,7 @@ void usb_init(void)
 	usb_configuration = 0;
 	usb_suspended = 0;
 	debug_flush_timer = 0;
+	midi_tx_hold_timer = 0;
 	UDINT = 0;
         UDIEN = (1<<EORSTE)|(1<<SOFE);
 	//sei();  // init() in wiring.c does this
@@ -409,8 +411,13 @@ ISR(USB_GEN_vect)
                                 UEINTX = 0x3A;
                         }
                 }
-                UENUM = MIDI_TX_ENDPOINT;
-		if (UEBCLX) UEINTX = 0x3A;
+                t = midi_tx_hold_timer;
+                if (t) {
+                        midi_tx_hold_timer = t - 1;
+                } else {
+                        UENUM = MIDI_TX_ENDPOINT;
+                        if (UEBCLX) UEINTX = 0x3A;
+                }
         }
 	if (intbits & (1<<SUSPI)) {
 		// USB Suspend (inactivity for 3ms)
@@ -107,10 +107,55 @@ void usb_midi_class::send_raw(uint8_t b0, uint8_t b1, uint8_t b2, uint8_t b3)
 	SREG = intr_state;
 }
 
+void usb_midi_class::sendMany(const void *ptr, uint16_t count)
+{
+	const uint8_t *p = (const uint8_t *)ptr;
+	uint8_t intr_state, timeout;
+
+	if (!usb_configuration) return;
+	intr_state = SREG;
+	cli();
+	UENUM = MIDI_TX_ENDPOINT;
+	while (count) {
+		timeout = UDFNUML + 2;
+		while (1) {
+			// are we ready to transmit?
+			if (UEINTX & (1<<RWAL)) break;
+			SREG = intr_state;
+			if (UDFNUML == timeout) return;
+			if (!usb_configuration) return;
+			intr_state = SREG;
+			cli();
+			UENUM = MIDI_TX_ENDPOINT;
+		}
+		// fill the rest of this packet
+		do {
+			UEDATX = *p++;
+			UEDATX = *p++;
+			UEDATX = *p++;
+			UEDATX = *p++;
+		} while (--count && (UEINTX & (1<<RWAL)));
+		if (!(UEINTX & (1<<RWAL))) UEINTX = 0x3A;
+	}
+	SREG = intr_state;
+}
+
+void usb_midi_class::beginBatch(void)
+{
+	midi_tx_hold_timer = MIDI_TX_HOLD_FRAMES;
+}
+
+// main() calls this after each loop(), ending any batch
+void _loop_end_hook(void)
+{
+	if (midi_tx_hold_timer) usbMIDI.send_now();
+}
+
 void usb_midi_class::send_now(void)
 {
 	uint8_t intr_state;
 
+	midi_tx_hold_timer = 0;
 	if (!usb_configuration) return;
 	intr_state = SREG;
 	cli();
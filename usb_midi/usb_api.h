@@ -149,6 +149,11 @@ public:
 		}
 	}
 	void send_now(void);
+	// Send many 4 byte USB-MIDI event packets, 16 to each USB packet
+	void sendMany(const void *events, uint16_t count);
+	// Hold partial packets until send_now() or the end of loop(), so
+	// events sent close together share USB packets
+	void beginBatch(void);
 	uint8_t analog2velocity(uint16_t val, uint8_t range);
 	bool read(uint8_t channel=0);
 	inline uint8_t getType(void) {
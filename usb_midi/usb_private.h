@@ -83,6 +83,9 @@ void usb_shutdown(void);		// shut off USB
 extern volatile uint8_t usb_configuration;
 extern volatile uint8_t usb_suspended;
 extern volatile uint8_t debug_flush_timer;
+// frames remaining while usbMIDI.beginBatch() holds back partial packets
+extern volatile uint8_t midi_tx_hold_timer;
+#define MIDI_TX_HOLD_FRAMES	8
 
 
 #ifdef __cplusplus
@@ -268,6 +268,203 @@ int usb_rawhid_class::recv(void *ptr, uint16_t timeout)
 }
 
 
+// write one report into the FIFO, unrolled for speed
+static void rawhid_write_report(const uint8_t *buffer)
+{
+	#if (RAWHID_TX_SIZE >= 64)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 63)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 62)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 61)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 60)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 59)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 58)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 57)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 56)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 55)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 54)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 53)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 52)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 51)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 50)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 49)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 48)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 47)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 46)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 45)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 44)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 43)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 42)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 41)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 40)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 39)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 38)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 37)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 36)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 35)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 34)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 33)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 32)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 31)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 30)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 29)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 28)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 27)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 26)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 25)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 24)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 23)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 22)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 21)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 20)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 19)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 18)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 17)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 16)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 15)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 14)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 13)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 12)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 11)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 10)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 9)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 8)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 7)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 6)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 5)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 4)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 3)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 2)
+	UEDATX = *buffer++;
+	#endif
+	#if (RAWHID_TX_SIZE >= 1)
+	UEDATX = *buffer++;
+	#endif
+}
+
 // send a packet, with timeout
 int usb_rawhid_class::send(const void *ptr, uint16_t timeout)
 {
@@ -290,205 +487,49 @@ int usb_rawhid_class::send(const void *ptr, uint16_t timeout)
                 cli();
                 UENUM = RAWHID_TX_ENDPOINT;
         }
-        // write bytes from the FIFO
-        #if (RAWHID_TX_SIZE >= 64)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 63)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 62)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 61)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 60)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 59)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 58)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 57)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 56)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 55)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 54)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 53)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 52)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 51)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 50)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 49)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 48)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 47)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 46)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 45)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 44)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 43)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 42)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 41)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 40)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 39)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 38)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 37)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 36)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 35)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 34)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 33)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 32)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 31)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 30)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 29)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 28)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 27)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 26)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 25)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 24)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 23)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 22)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 21)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 20)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 19)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 18)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 17)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 16)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 15)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 14)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 13)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 12)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 11)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 10)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 9)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 8)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 7)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 6)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 5)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 4)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 3)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 2)
-        UEDATX = *buffer++;
-        #endif
-        #if (RAWHID_TX_SIZE >= 1)
-        UEDATX = *buffer++;
-        #endif
+        rawhid_write_report(buffer);
         // transmit it now
         UEINTX = 0x3A;
         SREG = intr_state;
         return RAWHID_TX_SIZE;
 }
 
+// send several consecutive packets, with timeout for the whole group.
+// The endpoint is double buffered, so the next packet is written while
+// the previous one waits for the host, and a report goes every frame.
+// Returns the number of packets sent, or -1 if USB is offline.
+int usb_rawhid_class::send(const void *ptr, uint16_t count, uint16_t timeout)
+{
+	const uint8_t *buffer = (const uint8_t *)ptr;
+	uint8_t intr_state;
+	int sent=0;
+
+	if (!usb_configuration) return -1;
+	intr_state = SREG;
+	cli();
+	rawhid_tx_timeout_count = timeout;
+	UENUM = RAWHID_TX_ENDPOINT;
+	while (count) {
+		if (UEINTX & (1<<RWAL)) {
+			rawhid_write_report(buffer);
+			UEINTX = 0x3A;
+			buffer += RAWHID_TX_SIZE;
+			sent++;
+			count--;
+			continue;
+		}
+		// wait with interrupts enabled, so the timeout counts
+		SREG = intr_state;
+		if (rawhid_tx_timeout_count == 0) return sent;
+		if (!usb_configuration) return sent ? sent : -1;
+		intr_state = SREG;
+		cli();
+		UENUM = RAWHID_TX_ENDPOINT;
+	}
+	SREG = intr_state;
+	return sent;
+}
+
 
 
 
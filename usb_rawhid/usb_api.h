@@ -12,6 +12,7 @@ class usb_rawhid_class
 	int available(void);
 	int recv(void *buffer, uint16_t timeout);
 	int send(const void *buffer, uint16_t timeout);
+	int send(const void *buffer, uint16_t count, uint16_t timeout);
 };
 
 extern usb_rawhid_class RawHID;
@@ -223,6 +223,12 @@ uint8_t transmit_previous_timeout=0;
 volatile uint8_t cdc_line_coding[7]={0x00, 0xE1, 0x00, 0x00, 0x00, 0x00, 0x08};
 volatile uint8_t cdc_line_rtsdtr USBSTATE;
 
+#ifdef CDC_RX_RING_SIZE
+volatile uint8_t cdc_rx_ring[CDC_RX_RING_SIZE];
+volatile uint8_t cdc_rx_head;
+volatile uint8_t cdc_rx_tail;
+#endif
+
 
 /**************************************************************************
  *
@@ -361,9 +367,38 @@ static inline void usb_ack_out(void)
 
 
 
+#ifdef CDC_RX_RING_SIZE
+// Copy received packets into the ring while a whole packet fits.  When
+// it doesn't, the endpoint interrupt is left off until a read makes room.
+void usb_serial_rx_fill(void)
+{
+	uint8_t head, n, room;
+
+	UENUM = CDC_RX_ENDPOINT;
+	while (UEINTX & (1<<RXOUTI)) {
+		head = cdc_rx_head;
+		room = (uint8_t)(cdc_rx_tail - head - 1) & (CDC_RX_RING_SIZE - 1);
+		n = UEBCLX;
+		if (n > room) {
+			UEIENX = 0;
+			return;
+		}
+		while (n--) {
+			head = (head + 1) & (CDC_RX_RING_SIZE - 1);
+			cdc_rx_ring[head] = UEDATX;
+		}
+		cdc_rx_head = head;
+		UEINTX = 0x6B;
+	}
+	UEIENX = (1<<RXOUTE);
+}
+#endif
+
+
 // USB Endpoint Interrupt - endpoint 0 is handled here.  The
 // other endpoints are manipulated by the user-callable
-// functions, and the start-of-frame interrupt.
+// functions, and the start-of-frame interrupt, except the
+// receive endpoint when CDC_RX_RING_SIZE is used.
 //
 ISR(USB_COM_vect)
 {
@@ -382,6 +417,9 @@ ISR(USB_COM_vect)
 	const uint8_t *desc_addr;
 	uint8_t	desc_length;
 
+#ifdef CDC_RX_RING_SIZE
+	if (UEINT & (1<<CDC_RX_ENDPOINT)) usb_serial_rx_fill();
+#endif
 	UENUM = 0;
 	intbits = UEINTX;
 	if (intbits & (1<<RXSTPI)) {
@@ -471,6 +509,12 @@ ISR(USB_COM_vect)
 			}
         		UERST = 0x1E;
         		UERST = 0;
+			#ifdef CDC_RX_RING_SIZE
+			cdc_rx_head = 0;
+			cdc_rx_tail = 0;
+			UENUM = CDC_RX_ENDPOINT;
+			UEIENX = (1<<RXOUTE);
+			#endif
 			return;
 		}
 		if (bRequest == GET_CONFIGURATION && bmRequestType == 0x80) {
@@ -68,6 +68,47 @@ void usb_serial_class::end()
 	delay(25);
 }
 
+#ifdef CDC_RX_RING_SIZE
+// with the receive ring, reads only take data from RAM
+
+int usb_serial_class::available()
+{
+	int n;
+
+	n = (uint8_t)(cdc_rx_head - cdc_rx_tail) & (CDC_RX_RING_SIZE - 1);
+	if (peek_buf >= 0) n++;
+	return n;
+}
+
+int usb_serial_class::read(void)
+{
+	uint8_t c, tail, intr_state;
+
+	if (peek_buf >= 0) {
+		c = peek_buf;
+		peek_buf = -1;
+		return c;
+	}
+	intr_state = SREG;
+	cli();
+	tail = cdc_rx_tail;
+	if (tail == cdc_rx_head) {
+		SREG = intr_state;
+		return -1;
+	}
+	tail = (tail + 1) & (CDC_RX_RING_SIZE - 1);
+	c = cdc_rx_ring[tail];
+	cdc_rx_tail = tail;
+	// if a packet was waiting for room, it may fit now
+	if (usb_configuration) {
+		UENUM = CDC_RX_ENDPOINT;
+		if (!UEIENX) usb_serial_rx_fill();
+	}
+	SREG = intr_state;
+	return c;
+}
+
+#else
 // number of bytes available in the receive buffer
 int usb_serial_class::available()
 {
@@ -88,12 +129,6 @@ int usb_serial_class::available()
         return n;
 }
 
-int usb_serial_class::peek()
-{
-	if (peek_buf < 0) peek_buf = read();
-	return peek_buf;
-}
-
 // get the next character, or -1 if nothing received
 int usb_serial_class::read(void)
 {
@@ -132,12 +167,21 @@ int usb_serial_class::read(void)
         SREG = intr_state;
         return c;
 }
+#endif // CDC_RX_RING_SIZE
+
+int usb_serial_class::peek()
+{
+	if (peek_buf < 0) peek_buf = read();
+	return peek_buf;
+}
 
 size_t usb_serial_class::readBytes(char *buffer, size_t length)
 {
 	size_t count=0;
 	unsigned long startMillis;
+#ifndef CDC_RX_RING_SIZE
 	uint8_t num, intr_state;
+#endif
 
 	startMillis = millis();
 	if (length <= 0) return 0;
@@ -149,6 +193,16 @@ size_t usb_serial_class::readBytes(char *buffer, size_t length)
 		count = 1;
 	}
 	do {
+#ifdef CDC_RX_RING_SIZE
+		int c = read();
+		if (c >= 0) {
+			*buffer++ = c;
+			count++;
+			if (--length == 0) return count;
+			continue;
+		}
+		break;
+#else
 		intr_state = SREG;
 		cli();
 		if (!usb_configuration) {
@@ -170,6 +224,7 @@ size_t usb_serial_class::readBytes(char *buffer, size_t length)
 		count += num;
 		length -= num;
 		if (length == 0) return count;
+#endif
 	} while(millis() - startMillis < _timeout);
 	setReadError();
 	return count;
@@ -194,6 +249,10 @@ void usb_serial_class::clear()
                 while ((UEINTX & (1<<RWAL))) {
                         UEINTX = 0x6B;
                 }
+#ifdef CDC_RX_RING_SIZE
+		cdc_rx_tail = cdc_rx_head;
+		UEIENX = (1<<RXOUTE);
+#endif
                 SREG = intr_state;
         }
 	peek_buf = -1;
@@ -316,17 +375,41 @@ size_t usb_serial_class::write(const uint8_t *buffer, uint16_t size)
 			UENUM = CDC_TX_ENDPOINT;
 		}
 
+#define ASM_COPY1(src, dest, tmp) "ld " tmp ", " src "\n\t" "st " dest ", " tmp "\n\t"
+#define ASM_COPY2(src, dest, tmp) ASM_COPY1(src, dest, tmp) ASM_COPY1(src, dest, tmp)
+#define ASM_COPY4(src, dest, tmp) ASM_COPY2(src, dest, tmp) ASM_COPY2(src, dest, tmp)
+#define ASM_COPY8(src, dest, tmp) ASM_COPY4(src, dest, tmp) ASM_COPY4(src, dest, tmp)
+
+		// fast path: a whole packet into an empty bank needs no
+		// size computation, and the bank is certainly full after
+		if (size >= CDC_TX_SIZE && UEBCLX == 0) {
+			uint8_t tmp;
+			asm volatile(
+				#if (CDC_TX_SIZE == 64)
+				ASM_COPY8("Y+", "X", "%1")
+				ASM_COPY8("Y+", "X", "%1")
+				ASM_COPY8("Y+", "X", "%1")
+				ASM_COPY8("Y+", "X", "%1")
+				#endif
+				ASM_COPY8("Y+", "X", "%1")
+				ASM_COPY8("Y+", "X", "%1")
+				ASM_COPY8("Y+", "X", "%1")
+				ASM_COPY8("Y+", "X", "%1")
+				: "+y" (buffer), "=r" (tmp)
+				: "x" (&UEDATX)
+			);
+			UEINTX = 0x3A;
+			size -= CDC_TX_SIZE;
+			count += CDC_TX_SIZE;
+			continue;
+		}
+
 		// compute how many bytes will fit into the next packet
 		write_size = CDC_TX_SIZE - UEBCLX;
 		if (write_size > size) write_size = size;
 		size -= write_size;
 		count += write_size;
 
-#define ASM_COPY1(src, dest, tmp) "ld " tmp ", " src "\n\t" "st " dest ", " tmp "\n\t"
-#define ASM_COPY2(src, dest, tmp) ASM_COPY1(src, dest, tmp) ASM_COPY1(src, dest, tmp)
-#define ASM_COPY4(src, dest, tmp) ASM_COPY2(src, dest, tmp) ASM_COPY2(src, dest, tmp)
-#define ASM_COPY8(src, dest, tmp) ASM_COPY4(src, dest, tmp) ASM_COPY4(src, dest, tmp)
-
 #if 1
 		// write the packet
 		do {
@@ -368,8 +451,9 @@ size_t usb_serial_class::write(const uint8_t *buffer, uint16_t size)
 #endif
 		// if this completed a packet, transmit it now!
 		if (!(UEINTX & (1<<RWAL))) UEINTX = 0x3A;
-		transmit_flush_timer = TRANSMIT_FLUSH_TIMEOUT;
 	}
+	// only a partial packet from the last iteration can be left waiting
+	transmit_flush_timer = TRANSMIT_FLUSH_TIMEOUT;
 	SREG = intr_state;
 end:
 	return count;
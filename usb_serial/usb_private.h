@@ -100,6 +100,18 @@ extern "C"{
 #define CDC_TX_SIZE             64
 #endif
 
+// Optional receive ring buffer.  When defined (a power of 2, 128 or 256),
+// the endpoint interrupt copies each packet into RAM and releases the
+// bank immediately, so the host can send the next one before the program
+// reads.  Packets stay in the endpoint (and the host waits) only while the
+// ring lacks room for a whole packet.
+//#define CDC_RX_RING_SIZE        128
+#ifdef CDC_RX_RING_SIZE
+#if (CDC_RX_RING_SIZE & (CDC_RX_RING_SIZE - 1)) || CDC_RX_RING_SIZE <= CDC_RX_SIZE || CDC_RX_RING_SIZE > 256
+#error "CDC_RX_RING_SIZE must be a power of 2, larger than a packet and no more than 256"
+#endif
+#endif
+
 
 
 
@@ -122,6 +134,14 @@ extern uint8_t transmit_previous_timeout;
 extern volatile uint8_t cdc_line_coding[7];
 extern volatile uint8_t cdc_line_rtsdtr;
 
+#ifdef CDC_RX_RING_SIZE
+// received data, head is the last byte written, tail the last byte read
+extern volatile uint8_t cdc_rx_ring[CDC_RX_RING_SIZE];
+extern volatile uint8_t cdc_rx_head;
+extern volatile uint8_t cdc_rx_tail;
+void usb_serial_rx_fill(void);	// call with interrupts disabled
+#endif
+
 
 
 #ifdef __cplusplus